@@ -0,0 +1,133 @@
+/**
+ * arena.h: Defines types and functions for a linear memory arena. An arena
+ * reserves a single block of virtual memory up front, optionally backed by
+ * huge pages, and satisfies allocations by bumping an offset. Allocations are
+ * not freed individually; the arena is reset to zero, or to a saved mark, in
+ * constant time. The arena tracks the largest offset ever reached so that
+ * callers can size it from observed use.
+ */
+#ifndef __ARENA_H__
+#define __ARENA_H__
+
+#pragma once
+
+#ifndef MNIST_NO_INCLUDES
+#include <stddef.h>
+#include <stdint.h>
+#endif
+
+#ifndef MNIST_API
+#   ifdef  MNIST_STATIC
+#       define MNIST_API(_return_type)                                         \
+            static _return_type
+#else
+#       define MNIST_API(_return_type)                                         \
+            extern _return_type
+#   endif
+#endif
+
+/* @summary Define various constants used internally within this module.
+ * ARENA_ALIGNMENT: The alignment of allocations that do not request a specific alignment, in bytes.
+ * ARENA_HUGE_PAGE_SIZE: The size of the huge pages requested on Linux, in bytes.
+ */
+#ifndef ARENA_CONSTANTS
+#   define ARENA_CONSTANTS
+#   define ARENA_ALIGNMENT                64
+#   define ARENA_HUGE_PAGE_SIZE           (2UL * 1024UL * 1024UL)
+#endif
+
+/* @summary Define a set of flags that can be bitwise-OR'd together to control how arena memory is reserved.
+ */
+typedef enum ARENA_FLAGS {
+    ARENA_FLAGS_NONE            = (0UL <<  0),                                 /* The arena is backed by ordinary pages. */
+    ARENA_FLAG_HUGE_PAGES       = (1UL <<  0),                                 /* Request explicit huge pages (MAP_HUGETLB or MEM_LARGE_PAGES); fall back to ordinary pages with a transparent huge page hint. */
+    ARENA_FLAG_LOCKED_PAGES     = (1UL <<  1),                                 /* Set on return if the arena is backed by explicit huge pages, which are locked into physical memory. */
+} ARENA_FLAGS;
+
+/* @summary Define the state of a linear memory arena.
+ */
+typedef struct MEMORY_ARENA {
+    uint8_t                     *BaseAddress;                                  /* The start of the reserved block. */
+    size_t                       Capacity;                                     /* The size of the reserved block, in bytes. */
+    size_t                       Offset;                                       /* The offset of the first free byte. */
+    size_t                       HighWatermark;                                /* The largest value Offset has reached since the arena was created. */
+    size_t                       PageSize;                                     /* The size of the pages backing the block, in bytes. */
+    uint32_t                     Flags;                                        /* One or more bitwise-OR'd values of the ARENA_FLAGS enumeration. */
+} MEMORY_ARENA;
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* @summary Reserve the memory for an arena. The memory is zero-initialized, and physical pages are committed by the OS on first touch where possible.
+ * @param o_arena The MEMORY_ARENA to initialize. On failure, the structure is zero-initialized.
+ * @param capacity The number of bytes to reserve. The capacity is rounded up to a multiple of the page size.
+ * @param flags One or more bitwise-OR'd values of the ARENA_FLAGS enumeration.
+ * @return Zero if the arena is created, or -1 if an error occurred. Check errno for error information.
+ */
+MNIST_API(int)
+ArenaCreate
+(
+    struct MEMORY_ARENA *o_arena,
+    size_t              capacity,
+    uint32_t               flags
+);
+
+/* @summary Release the memory reserved for an arena. Every allocation made from the arena becomes invalid.
+ * @param arena The MEMORY_ARENA to delete. The structure is zero-initialized on return.
+ */
+MNIST_API(void)
+ArenaDelete
+(
+    struct MEMORY_ARENA *arena
+);
+
+/* @summary Allocate memory from an arena. The memory is not zeroed, except on first use after ArenaCreate.
+ * @param arena The arena to allocate from.
+ * @param size The number of bytes to allocate.
+ * @param alignment The required alignment, a power of two, or zero for ARENA_ALIGNMENT.
+ * @return A pointer to the allocation, or NULL if the arena does not have enough space (errno is set to ENOMEM).
+ */
+MNIST_API(void*)
+ArenaAllocate
+(
+    struct MEMORY_ARENA *arena,
+    size_t                size,
+    size_t           alignment
+);
+
+/* @summary Retrieve a mark that can later be passed to ArenaResetToMark to free every allocation made after this call.
+ * @param arena The arena.
+ * @return The current offset of the arena.
+ */
+MNIST_API(size_t)
+ArenaMark
+(
+    struct MEMORY_ARENA const *arena
+);
+
+/* @summary Free every allocation made after a mark was retrieved.
+ * @param arena The arena.
+ * @param mark A value returned by ArenaMark, no greater than the current offset.
+ */
+MNIST_API(void)
+ArenaResetToMark
+(
+    struct MEMORY_ARENA *arena,
+    size_t                mark
+);
+
+/* @summary Free every allocation made from an arena. The reserved memory and the high-water mark are retained.
+ * @param arena The arena.
+ */
+MNIST_API(void)
+ArenaReset
+(
+    struct MEMORY_ARENA *arena
+);
+
+#ifdef __cplusplus
+}; /* extern "C" */
+#endif
+
+#endif /* __ARENA_H__ */
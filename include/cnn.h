@@ -0,0 +1,282 @@
+/**
+ * cnn.h: Defines types and functions for a convolutional network built from
+ * 2D convolution and max-pool layers, followed by a fully-connected MLP head.
+ * Activations are stored in a channel-blocked NCHWc layout: each image is a
+ * sequence of CNN_CBLOCK-channel blocks, and within a block the CNN_CBLOCK
+ * values of each pixel are contiguous, so one SIMD register holds one pixel of
+ * one block. The network input is the single-channel, row-major image, which
+ * is the NCHWc layout with a block size of one. Convolutions are computed
+ * directly by register-blocked kernels, without an im2col matrix, in both the
+ * forward and backward passes. Convolution layers use ReLU activation. 3x3
+ * convolutions with enough channels instead use the Winograd F(2x2,3x3)
+ * algorithm, which computes each 2x2 output tile from a 4x4 input tile with 16
+ * multiplies per channel pair instead of 36, as 16 GEMMs over the tiles of a
+ * group of images.
+ */
+#ifndef __CNN_H__
+#define __CNN_H__
+
+#pragma once
+
+#ifndef MNIST_NO_INCLUDES
+#include <stddef.h>
+#include <stdint.h>
+#include "arena.h"
+#include "minibatch.h"
+#include "mlp.h"
+#include "taskpool.h"
+#endif
+
+#ifndef MNIST_API
+#   ifdef  MNIST_STATIC
+#       define MNIST_API(_return_type)                                         \
+            static _return_type
+#else
+#       define MNIST_API(_return_type)                                         \
+            extern _return_type
+#   endif
+#endif
+
+/* @summary Define various constants used internally within this module.
+ * CNN_MAX_LAYERS: The maximum number of convolution and pooling layers in a network, not counting the MLP head.
+ * CNN_MAX_KERNEL_SIZE: The largest convolution kernel width and height.
+ * CNN_CBLOCK: The number of channels in each block of the NCHWc layout, one AVX2 register of floats.
+ * CNN_OW_BLOCK: The number of adjacent output columns computed together by the convolution kernel, each in its own accumulator register.
+ * CNN_ALIGNMENT: The alignment of every parameter and activation buffer, in bytes.
+ * CNN_WINOGRAD_TILES: The number of output tiles transformed together by the Winograd path, which bounds the size of its scratch buffers. Whole images are grouped up to this limit.
+ * CNN_WINOGRAD_MIN_CHANNELS: The smallest number of input and output channels for which CNN_ALGORITHM_AUTO selects the Winograd path. With fewer channels the transforms cost more than the multiplies saved.
+ */
+#ifndef CNN_CONSTANTS
+#   define CNN_CONSTANTS
+#   define CNN_MAX_LAYERS                 8
+#   define CNN_MAX_KERNEL_SIZE            7
+#   define CNN_CBLOCK                     8
+#   define CNN_OW_BLOCK                   8
+#   define CNN_ALIGNMENT                  64
+#   define CNN_WINOGRAD_TILES             2048
+#   define CNN_WINOGRAD_MIN_CHANNELS      8
+#endif
+
+/* @summary Define the kinds of layer that can precede the MLP head.
+ */
+typedef enum CNN_LAYER_TYPE {
+    CNN_LAYER_CONV               = 0,                                          /* A stride-1 2D convolution with zero padding, followed by ReLU. */
+    CNN_LAYER_MAXPOOL            = 1,                                          /* A max-pool with a square window whose stride equals its size. */
+} CNN_LAYER_TYPE;
+
+/* @summary Define identifiers for the available implementations of the convolution kernels.
+ */
+typedef enum CNN_KERNEL {
+    CNN_KERNEL_SCALAR            = 0,                                          /* Portable C kernels. */
+    CNN_KERNEL_AVX2              = 1,                                          /* AVX2 and FMA kernels, one ymm register per pixel of a channel block. */
+    CNN_KERNEL_COUNT             = 2,                                          /* The number of kernel identifiers. */
+} CNN_KERNEL;
+
+/* @summary Define the algorithms that can compute a 3x3 convolution.
+ */
+typedef enum CNN_ALGORITHM {
+    CNN_ALGORITHM_AUTO           = 0,                                          /* Use Winograd for 3x3 convolutions with at least CNN_WINOGRAD_MIN_CHANNELS input and output channels, and direct convolution otherwise. */
+    CNN_ALGORITHM_DIRECT         = 1,                                          /* Use direct convolution for every layer. */
+    CNN_ALGORITHM_WINOGRAD       = 2,                                          /* Use Winograd F(2x2,3x3) for every 3x3 convolution, and direct convolution otherwise. */
+} CNN_ALGORITHM;
+
+/* @summary Describe a layer to be created by CnnCreate.
+ */
+typedef struct CNN_LAYER_DESC {
+    uint32_t                     Type;                                         /* One of the values of the CNN_LAYER_TYPE enumeration. */
+    uint32_t                     OutputChannels;                               /* The number of output channels of a convolution. Ignored for a max-pool, which preserves the channel count. */
+    uint32_t                     KernelSize;                                   /* The width and height of the convolution kernel, or of the pooling window. */
+    uint32_t                     Padding;                                      /* The number of zero rows and columns added on each side of the input of a convolution, less than KernelSize. Ignored for a max-pool. */
+} CNN_LAYER_DESC;
+
+/* @summary Define the parameters, gradients and per-batch state of a single convolution or max-pool layer.
+ * Outputs and Deltas hold one image per row, each image stored as [OutputChannels / CNN_CBLOCK][OutputHeight][OutputWidth][CNN_CBLOCK] with OutputChannels rounded up.
+ * Channels past OutputChannels have zero weights and bias, so their activations are always zero.
+ */
+typedef struct CNN_LAYER {
+    float                       *Weights;                                      /* The convolution weights, with dimensions [OutputChannels / CNN_CBLOCK][InputChannels][KernelSize][KernelSize][CNN_CBLOCK], or NULL for a max-pool. */
+    float                       *Bias;                                         /* The convolution bias, with one entry per output channel rounded up to CNN_CBLOCK, or NULL. */
+    float                       *WeightGrad;                                   /* The gradient of the loss with respect to Weights, with the same dimensions, or NULL. */
+    float                       *BiasGrad;                                     /* The gradient of the loss with respect to Bias, or NULL. */
+    float                       *WeightsFlipped;                               /* Scratch for the backward pass: the weights transposed between input and output channels and rotated by 180 degrees, or NULL. */
+    float                       *Outputs;                                      /* The activations from the last forward pass, with dimensions [count][OutputStride], allocated from the frame arena. */
+    float                       *Deltas;                                       /* The gradient of the loss with respect to Outputs, with dimensions [count][OutputStride], allocated from the frame arena. */
+    uint32_t                     Type;                                         /* One of the values of the CNN_LAYER_TYPE enumeration. */
+    uint32_t                     KernelSize;                                   /* The width and height of the convolution kernel or pooling window. */
+    uint32_t                     Padding;                                      /* The zero padding on each side of the input of a convolution. */
+    uint32_t                     InputChannels;                                /* The number of input channels. */
+    uint32_t                     InputBlock;                                   /* The channel block size of the input layout: 1 for the network input, otherwise CNN_CBLOCK. */
+    uint32_t                     InputHeight;                                  /* The number of rows in each input channel. */
+    uint32_t                     InputWidth;                                   /* The number of columns in each input channel. */
+    uint32_t                     OutputChannels;                               /* The number of output channels. */
+    uint32_t                     OutputHeight;                                 /* The number of rows in each output channel. */
+    uint32_t                     OutputWidth;                                  /* The number of columns in each output channel. */
+    uint32_t                     OutputStride;                                 /* The distance between the start of consecutive images in Outputs and Deltas, in floats. */
+    uint32_t                     Winograd;                                     /* Non-zero if the forward pass and the input gradient of the layer use the Winograd path. */
+} CNN_LAYER;
+
+/* @summary Define the state of a convolutional network.
+ */
+typedef struct CNN {
+    CNN_LAYER                    Layers[CNN_MAX_LAYERS];                       /* The convolution and pooling layers, from input to the head. */
+    MLP                          Head;                                         /* The fully-connected layers. Its inputs are the flattened Outputs of the last layer. */
+    MINIBATCH                    EvaluateBatch;                                /* The batch used by CnnEvaluate to gather samples. */
+    float                       *WinogradWeights;                              /* The transformed weights of the current Winograd convolution, with dimensions [16][InputChannels][OutputBlocks * CNN_CBLOCK]. Allocated from the frame arena, or NULL if no layer is a 3x3 convolution. */
+    float                       *WinogradInputs;                               /* The transformed input tiles, with dimensions [16][tiles][InputBlocks * InputBlock]. */
+    float                       *WinogradProducts;                             /* The products of the transformed inputs and weights, with dimensions [16][tiles][OutputBlocks * CNN_CBLOCK]. */
+    float                       *WinogradWorkspace;                            /* The GEMM packing workspace for the Winograd products. */
+    uint32_t                     LayerCount;                                   /* The number of valid entries in Layers. */
+    uint32_t                     InputWidth;                                   /* The number of columns in each input image. */
+    uint32_t                     InputHeight;                                  /* The number of rows in each input image. */
+    uint32_t                     MaxBatchSize;                                 /* The maximum number of images in a single forward or backward pass. */
+    struct TASK_POOL            *TaskPool;                                     /* The task pool used to process the images of a batch in parallel, or NULL. */
+    MEMORY_ARENA                 Storage;                                      /* The arena backing the parameter and gradient buffers, sized exactly at creation. */
+    MEMORY_ARENA                 Frame;                                        /* The arena backing per-batch activations and deltas. */
+} CNN;
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* @summary Allocate and initialize a network. Convolution weights are initialized with He-uniform random values and biases are set to zero.
+ * @param o_cnn The CNN to initialize. On failure, the structure is zero-initialized.
+ * @param input_width The number of columns in each single-channel input image.
+ * @param input_height The number of rows in each single-channel input image.
+ * @param layers An array of layer_count layer descriptions, from input to the head. The first layer must be a convolution.
+ * @param layer_count The number of entries in layers, in [1, CNN_MAX_LAYERS].
+ * @param head_sizes An array of head_count values: the widths of the hidden layers of the head, followed by the number of classes.
+ * @param head_count The number of entries in head_sizes, in [1, MLP_MAX_LAYERS].
+ * @param max_batch_size The maximum number of images in a single forward or backward pass.
+ * @param seed The seed for the weight initialization random number generator.
+ * @return Zero if the network is created, or -1 if an error occurred. Check errno for error information.
+ */
+MNIST_API(int)
+CnnCreate
+(
+    struct CNN                      *o_cnn,
+    uint32_t                   input_width,
+    uint32_t                  input_height,
+    struct CNN_LAYER_DESC const    *layers,
+    uint32_t                   layer_count,
+    uint32_t const             *head_sizes,
+    uint32_t                    head_count,
+    uint32_t                max_batch_size,
+    uint64_t                          seed
+);
+
+/* @summary Free all memory associated with a network.
+ * @param cnn The CNN to free. The structure is zero-initialized on return.
+ */
+MNIST_API(void)
+CnnDelete
+(
+    struct CNN *cnn
+);
+
+/* @summary Attach a task pool to a network. Subsequent passes process the images of each batch concurrently, and the head runs its GEMMs on the pool.
+ * @param cnn The network.
+ * @param pool The task pool to use, or NULL to run on the calling thread. The pool must outlive the network, or be detached first.
+ * @return Zero if the pool is attached, or -1 if an error occurred. On failure the network is unchanged.
+ */
+MNIST_API(int)
+CnnSetTaskPool
+(
+    struct CNN        *cnn,
+    struct TASK_POOL *pool
+);
+
+/* @summary Select the algorithm used to compute the 3x3 convolutions of a network.
+ * Networks are created with CNN_ALGORITHM_AUTO. The scratch space for the Winograd path is reserved at creation, so this may be called at any time.
+ * @param cnn The network.
+ * @param algorithm One of the values of the CNN_ALGORITHM enumeration.
+ * @return Zero if the algorithm is selected, or -1 if algorithm is not valid.
+ */
+MNIST_API(int)
+CnnSetAlgorithm
+(
+    struct CNN      *cnn,
+    uint32_t   algorithm
+);
+
+/* @summary Run the forward pass for a batch of images. The class probabilities are available in the Outputs of the last layer of the head.
+ * @param cnn The network to evaluate.
+ * @param inputs The images, each InputHeight rows of InputWidth floats, with dimensions [count][input_stride].
+ * @param input_stride The distance between the start of consecutive images, in floats.
+ * @param count The number of images, at most MaxBatchSize.
+ */
+MNIST_API(void)
+CnnForward
+(
+    struct CNN           *cnn,
+    float const       *inputs,
+    uint32_t     input_stride,
+    uint32_t            count
+);
+
+/* @summary Run the forward pass, backward pass and SGD update for a single minibatch.
+ * @param cnn The network to train.
+ * @param batch The minibatch. Its FeatureCount must equal InputWidth * InputHeight and its SampleCount must not exceed MaxBatchSize. Any sparse encoding is ignored.
+ * @param learning_rate The step size.
+ * @return The mean cross-entropy loss over the batch, computed before the update.
+ */
+MNIST_API(float)
+CnnTrainBatch
+(
+    struct CNN              *cnn,
+    struct MINIBATCH const *batch,
+    float           learning_rate
+);
+
+/* @summary Classify every sample of a data set and measure the accuracy and mean loss of the network.
+ * Batches are classified one at a time, with the images of each batch processed on the attached task pool.
+ * @param cnn The network to evaluate. The activations of the last forward pass are overwritten.
+ * @param source The data to classify.
+ * @param o_correct On return, set to the number of samples whose most probable class matches the label.
+ * @param o_loss If non-NULL, on return set to the mean cross-entropy loss over the data set.
+ * @return Zero if the evaluation completed, or -1 if an error occurred.
+ */
+MNIST_API(int)
+CnnEvaluate
+(
+    struct CNN                      *cnn,
+    struct MINIBATCH_SOURCE const *source,
+    uint32_t                    *o_correct,
+    float                          *o_loss
+);
+
+/* @summary Compute the number of bytes of parameters and gradients held by a network, including its head.
+ * @param cnn The network.
+ * @return The size of the storage arenas of the network and its head, in bytes.
+ */
+MNIST_API(size_t)
+CnnParameterSize
+(
+    struct CNN const *cnn
+);
+
+/* @summary Select the convolution kernels used by subsequent forward and backward passes.
+ * This is intended for testing and benchmarking. By default, the fastest kernels supported by the host are used.
+ * @param kernel One of the values of the CNN_KERNEL enumeration.
+ * @return Zero if the kernel is selected, or -1 if the kernel is not supported by the host CPU.
+ */
+MNIST_API(int)
+CnnSelectKernel
+(
+    uint32_t kernel
+);
+
+/* @summary Retrieve a short name for a kernel identifier, for use in reports.
+ * @param kernel One of the values of the CNN_KERNEL enumeration.
+ * @return A nul-terminated string such as "avx2".
+ */
+MNIST_API(char const*)
+CnnKernelName
+(
+    uint32_t kernel
+);
+
+#ifdef __cplusplus
+}; /* extern "C" */
+#endif
+
+#endif /* __CNN_H__ */
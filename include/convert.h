@@ -0,0 +1,153 @@
+/**
+ * convert.h: Defines functions for converting 8-bit pixel data to normalized
+ * float32 values. Each kernel widens, converts, scales and biases in a single
+ * pass; the best kernel for the host CPU is selected at runtime. Also defines
+ * conversions between float32 and the 16-bit bfloat16 and IEEE half formats
+ * used to store weights and activations in mixed-precision training.
+ */
+#ifndef __CONVERT_H__
+#define __CONVERT_H__
+
+#pragma once
+
+#ifndef MNIST_NO_INCLUDES
+#include <stddef.h>
+#include <stdint.h>
+#endif
+
+#ifndef MNIST_API
+#   ifdef  MNIST_STATIC
+#       define MNIST_API(_return_type)                                         \
+            static _return_type
+#else
+#       define MNIST_API(_return_type)                                         \
+            extern _return_type
+#   endif
+#endif
+
+/* @summary Define identifiers for the available implementations of the conversion kernels.
+ */
+typedef enum CONVERT_KERNEL {
+    CONVERT_KERNEL_SCALAR        = 0,                                          /* Portable C implementation, one element at a time. */
+    CONVERT_KERNEL_SSE41         = 1,                                          /* SSE4.1 implementation, 16 elements per iteration. */
+    CONVERT_KERNEL_AVX2          = 2,                                          /* AVX2 and FMA implementation, 32 elements per iteration. */
+    CONVERT_KERNEL_AVX512        = 3,                                          /* AVX-512F implementation, 64 elements per iteration. */
+    CONVERT_KERNEL_COUNT         = 4,                                          /* The number of kernel identifiers. */
+} CONVERT_KERNEL;
+
+/* @summary Define the storage formats of floating-point values.
+ * CONVERT_TYPE_BF16 keeps the 8-bit exponent of float32 with a 7-bit mantissa; CONVERT_TYPE_F16 is IEEE 754 binary16, with a 5-bit exponent and a 10-bit mantissa.
+ */
+typedef enum CONVERT_TYPE {
+    CONVERT_TYPE_F32             = 0,                                          /* 32-bit IEEE 754 single precision. */
+    CONVERT_TYPE_BF16            = 1,                                          /* 16-bit bfloat16, the upper half of a float32. */
+    CONVERT_TYPE_F16             = 2,                                          /* 16-bit IEEE 754 half precision. */
+    CONVERT_TYPE_COUNT           = 3,                                          /* The number of type identifiers. */
+} CONVERT_TYPE;
+
+/* @summary Define the signature of a u8-to-float32 conversion kernel.
+ * @param dst The destination buffer, with space for count floats.
+ * @param src The source buffer of count 8-bit values.
+ * @param count The number of values to convert.
+ * @param scale The scale applied to each source value.
+ * @param bias The bias added to each scaled value.
+ */
+typedef void (*CONVERT_U8_F32_FUNC)
+(
+    float         * __restrict dst,
+    uint8_t const * __restrict src,
+    size_t                   count,
+    float                    scale,
+    float                     bias
+);
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* @summary Convert 8-bit values to float32 as dst[i] = (src[i] * scale) + bias using the fastest kernel supported by the host.
+ * @param dst The destination buffer, with space for count floats. No alignment is required, though 32- or 64-byte alignment is fastest.
+ * @param src The source buffer of count 8-bit values.
+ * @param count The number of values to convert.
+ * @param scale The scale applied to each source value.
+ * @param bias The bias added to each scaled value.
+ */
+MNIST_API(void)
+ConvertU8ToF32
+(
+    float         * __restrict dst,
+    uint8_t const * __restrict src,
+    size_t                   count,
+    float                    scale,
+    float                     bias
+);
+
+/* @summary Retrieve a specific implementation of the u8-to-float32 conversion kernel.
+ * This is intended for testing and benchmarking; most callers should use ConvertU8ToF32.
+ * @param kernel One of the values of the CONVERT_KERNEL enumeration.
+ * @return A pointer to the kernel, or NULL if the kernel is not supported by the host CPU.
+ */
+MNIST_API(CONVERT_U8_F32_FUNC)
+ConvertU8ToF32Kernel
+(
+    uint32_t kernel
+);
+
+/* @summary Convert float32 values to a 16-bit format, rounding to nearest even, using the fastest kernel supported by the host.
+ * For CONVERT_TYPE_BF16, NaNs remain NaNs and float32 denormals are flushed to signed zero, matching the AVX-512 BF16 instructions.
+ * For CONVERT_TYPE_F16, values too large for the format become infinity and small values become half-precision denormals, matching F16C.
+ * @param dst The destination buffer, with space for count 16-bit values.
+ * @param src The source buffer of count floats.
+ * @param count The number of values to convert.
+ * @param type Either CONVERT_TYPE_BF16 or CONVERT_TYPE_F16.
+ */
+MNIST_API(void)
+ConvertF32ToHalf
+(
+    uint16_t    * __restrict dst,
+    float const * __restrict src,
+    size_t                 count,
+    uint32_t                type
+);
+
+/* @summary Widen 16-bit values to float32 using the fastest kernel supported by the host. The conversion is exact.
+ * @param dst The destination buffer, with space for count floats.
+ * @param src The source buffer of count 16-bit values.
+ * @param count The number of values to convert.
+ * @param type Either CONVERT_TYPE_BF16 or CONVERT_TYPE_F16.
+ */
+MNIST_API(void)
+ConvertHalfToF32
+(
+    float          * __restrict dst,
+    uint16_t const * __restrict src,
+    size_t                    count,
+    uint32_t                   type
+);
+
+/* @summary Retrieve a short name for a storage format, for use in reports.
+ * @param type One of the values of the CONVERT_TYPE enumeration.
+ * @return A nul-terminated string such as "bf16".
+ */
+MNIST_API(char const*)
+ConvertTypeName
+(
+    uint32_t type
+);
+
+/* @summary Retrieve a short name for a kernel identifier, for use in reports.
+ * @param kernel One of the values of the CONVERT_KERNEL enumeration.
+ * @return A nul-terminated string such as "avx2".
+ */
+MNIST_API(char const*)
+ConvertKernelName
+(
+    uint32_t kernel
+);
+
+#ifdef __cplusplus
+}; /* extern "C" */
+#endif
+
+#endif /* __CONVERT_H__ */
+
@@ -0,0 +1,133 @@
+/**
+ * cpuinfo.h: Defines functions for querying the instruction set extensions
+ * supported by the host CPU, and macros used to compile individual functions
+ * for a specific instruction set so that they can be selected at runtime.
+ */
+#ifndef __CPUINFO_H__
+#define __CPUINFO_H__
+
+#pragma once
+
+#ifndef MNIST_NO_INCLUDES
+#include <stddef.h>
+#include <stdint.h>
+#endif
+
+#ifndef MNIST_API
+#   ifdef  MNIST_STATIC
+#       define MNIST_API(_return_type)                                         \
+            static _return_type
+#else
+#       define MNIST_API(_return_type)                                         \
+            extern _return_type
+#   endif
+#endif
+
+/* @summary Define CPU_ARCH_X86 to 1 when compiling for a 32- or 64-bit x86 target.
+ * SIMD code paths are only compiled when this is non-zero; other targets use the scalar code paths.
+ */
+#ifndef CPU_ARCH_X86
+#   if defined(__x86_64__) || defined(_M_X64) || defined(__i386__) || defined(_M_IX86)
+#       define CPU_ARCH_X86                 1
+#   else
+#       define CPU_ARCH_X86                 0
+#   endif
+#endif
+
+/* @summary Define various constants used internally within this module.
+ * CPU_BRAND_STRING_MAX: The size of a buffer large enough to hold any value returned by CpuBrandString, including the terminating nul.
+ */
+#ifndef CPU_CONSTANTS
+#   define CPU_CONSTANTS
+#   define CPU_BRAND_STRING_MAX           49
+#endif
+
+/* @summary Mark a function as being compiled for a specific set of instruction set extensions.
+ * The function must only be called after checking CpuFeatureFlags for the corresponding features.
+ * Visual C++ allows intrinsics for any instruction set in any function, so the macro expands to nothing.
+ * @param _isa A string literal naming the instruction sets, for example "avx2,fma".
+ */
+#ifndef CPU_TARGET
+#   if defined(_MSC_VER)
+#       define CPU_TARGET(_isa)
+#   else
+#       define CPU_TARGET(_isa)             __attribute__((target(_isa)))
+#   endif
+#endif
+
+/* @summary Define a set of flags that can be bitwise-OR'd together to specify the instruction set extensions supported by the host.
+ * A flag is only set if both the CPU and the operating system support the feature (for example, the OS saves the AVX register state).
+ */
+typedef enum CPU_FEATURE_FLAGS {
+    CPU_FEATURES_NONE           = (0UL <<  0),                                 /* No SIMD extensions are available, or the host is not x86. */
+    CPU_FEATURE_SSE2            = (1UL <<  0),                                 /* SSE2 is supported. */
+    CPU_FEATURE_SSSE3           = (1UL <<  1),                                 /* SSSE3 (pshufb, pmaddubsw) is supported. */
+    CPU_FEATURE_SSE41           = (1UL <<  2),                                 /* SSE4.1 (pmovzx, blend, dpps) is supported. */
+    CPU_FEATURE_SSE42           = (1UL <<  3),                                 /* SSE4.2 (pcmpistri) is supported. */
+    CPU_FEATURE_POPCNT          = (1UL <<  4),                                 /* The POPCNT instruction is supported. */
+    CPU_FEATURE_AVX             = (1UL <<  5),                                 /* AVX is supported. */
+    CPU_FEATURE_AVX2            = (1UL <<  6),                                 /* AVX2 is supported. */
+    CPU_FEATURE_FMA             = (1UL <<  7),                                 /* FMA3 is supported. */
+    CPU_FEATURE_F16C            = (1UL <<  8),                                 /* F16C half-precision conversions are supported. */
+    CPU_FEATURE_BMI2            = (1UL <<  9),                                 /* BMI2 (pdep, pext) is supported. */
+    CPU_FEATURE_AVX512F         = (1UL << 10),                                 /* AVX-512 Foundation is supported. */
+    CPU_FEATURE_AVX512BW        = (1UL << 11),                                 /* AVX-512 byte and word instructions are supported. */
+    CPU_FEATURE_AVX512VL        = (1UL << 12),                                 /* AVX-512 vector length extensions are supported. */
+    CPU_FEATURE_AVX512VNNI      = (1UL << 13),                                 /* AVX-512 VNNI (vpdpbusd) is supported. */
+    CPU_FEATURE_AVX512BF16      = (1UL << 14),                                 /* AVX-512 BF16 conversion and dot-product instructions are supported. */
+    CPU_FEATURE_AVXVNNI         = (1UL << 15),                                 /* The VEX-encoded AVX-VNNI instructions are supported. */
+} CPU_FEATURE_FLAGS;
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* @summary Retrieve the set of instruction set extensions supported by the host CPU and operating system.
+ * The CPU is queried once; subsequent calls return the cached result.
+ * @return One or more bitwise-OR'd values of the CPU_FEATURE_FLAGS enumeration.
+ */
+MNIST_API(uint32_t)
+CpuFeatureFlags
+(
+    void
+);
+
+/* @summary Retrieve the processor brand string reported by the CPU, for example "Intel(R) Core(TM) i7-8700K CPU @ 3.70GHz".
+ * Leading spaces are removed. If the CPU does not report a brand string, the string "unknown" is returned.
+ * @param dst The buffer to write the nul-terminated brand string to. May be NULL.
+ * @param max_dst The size of dst, in bytes. The string is truncated if necessary. CPU_BRAND_STRING_MAX bytes is always sufficient.
+ * @return The length of the brand string, in bytes, not including the terminating nul.
+ */
+MNIST_API(size_t)
+CpuBrandString
+(
+    char    *dst,
+    size_t max_dst
+);
+
+/* @summary Retrieve the number of logical processors the calling process is allowed to run on.
+ * On Linux this respects the process affinity mask (for example, as set by taskset or a container runtime).
+ * @return The number of logical processors, at least one.
+ */
+MNIST_API(uint32_t)
+CpuLogicalCount
+(
+    void
+);
+
+/* @summary Restrict the calling thread to run on a single logical processor.
+ * @param cpu_index The zero-based index of the processor among the CpuLogicalCount processors available to the process. Values past the end wrap around.
+ * @return Zero if the thread affinity was set, or -1 if an error occurred. Check errno for error information.
+ */
+MNIST_API(int)
+CpuPinCurrentThread
+(
+    uint32_t cpu_index
+);
+
+#ifdef __cplusplus
+}; /* extern "C" */
+#endif
+
+#endif /* __CPUINFO_H__ */
+
@@ -1,13 +1,20 @@
 /**
  * data.h: Defines the default data paths and filenames for the test data, and 
  * provides functions for returning the absolute paths to data files given the 
- * relative path portion.
+ * relative path portion. Absolute paths are resolved once per process, relative
+ * to the directory containing the executable or to the directory named by the
+ * DATA_DIRECTORY_ENVIRONMENT_VARIABLE environment variable, and are cached in a
+ * table that is never modified afterwards. No function allocates memory.
  */
 #ifndef __DATA_H__
 #define __DATA_H__
 
 #pragma once
 
+#ifndef MNIST_NO_INCLUDES
+#include <stddef.h>
+#endif
+
 #ifndef MNIST_API
 #   ifdef  MNIST_STATIC
 #       define MNIST_API(_return_type)                                         \
@@ -18,12 +25,22 @@
 #   endif
 #endif
 
+/* @summary Define various constants used internally within this module.
+ * DATA_DIRECTORY_ENVIRONMENT_VARIABLE: The name of the environment variable that, if set, specifies the data directory. Relative values are resolved against the working directory.
+ * DATA_DIRECTORY_DEFAULT: The data directory used when the environment variable is not set, relative to the directory containing the executable.
+ */
+#ifndef DATA_CONSTANTS
+#   define DATA_CONSTANTS
+#   define DATA_DIRECTORY_ENVIRONMENT_VARIABLE "MNIST_DATA_DIR"
+#   define DATA_DIRECTORY_DEFAULT         "data"
+#endif
+
 #ifdef __cplusplus
 extern "C" {
 #endif
 
 /* @summary Retrieve the maximum number of characters that can appear in a path string on the host.
- * @return The maximum number of characters the host operating system can process in a path string.
+ * @return The maximum number of characters the host operating system can process in a path string, not including the terminating nul.
  */
 MNIST_API(size_t)
 GetMaxSystemPathChars
@@ -31,32 +48,12 @@ GetMaxSystemPathChars
     void
 );
 
-/* @summary Allocate a buffer for storing path strings.
- * @param max_chars The maximum number of characters that can be stored in the path buffer, not including the terminating nul.
- * @return A pointer to the start of the path buffer.
- */
-MNIST_API(char*)
-PathBufferCreate
-(
-    size_t max_chars
-);
-
-/* @summary Free a path buffer.
- * @param buf The path buffer to free.
- */
-MNIST_API(void)
-PathBufferDelete
-(
-    char *buf
-);
-
 /* @summary Retrieve the relative path to the default training set image data.
- * @param len_chars Specify the address of a value to store the length of the returned path string, in characters, not including the terminating nul.
- * @param len_bytes Specify the address of a value to store the length of the returned path string, in bytes, including the trailing nul.
- * @return A nul-terminated string specifying the relative path to the default training set image data.
- * Free the returned path string using the PathBufferDelete function.
+ * @param len_chars Optional address of a value to store the length of the returned path string, in characters, not including the terminating nul.
+ * @param len_bytes Optional address of a value to store the length of the returned path string, in bytes, including the trailing nul.
+ * @return A nul-terminated string specifying the path to the default training set image data, relative to the directory containing the executable. The string is static and must not be freed.
  */
-MNIST_API(char*)
+MNIST_API(char const*)
 TrainingSetImages_GetDefaultRelativePath
 (
     size_t *len_chars, 
@@ -64,12 +61,11 @@ TrainingSetImages_GetDefaultRelativePath
 );
 
 /* @summary Retrieve the relative path to the default training set label data.
- * @param len_chars Specify the address of a value to store the length of the returned path string, in characters, not including the terminating nul.
- * @param len_bytes Specify the address of a value to store the length of the returned path string, in bytes, including the trailing nul.
- * @return A nul-terminated string specifying the relative path to the default training set label data.
- * Free the returned path string using the PathBufferDelete function.
+ * @param len_chars Optional address of a value to store the length of the returned path string, in characters, not including the terminating nul.
+ * @param len_bytes Optional address of a value to store the length of the returned path string, in bytes, including the trailing nul.
+ * @return A nul-terminated string specifying the path to the default training set label data, relative to the directory containing the executable. The string is static and must not be freed.
  */
-MNIST_API(char*)
+MNIST_API(char const*)
 TrainingSetLabels_GetDefaultRelativePath
 (
     size_t *len_chars, 
@@ -77,12 +73,11 @@ TrainingSetLabels_GetDefaultRelativePath
 );
 
 /* @summary Retrieve the relative path to the default test set image data.
- * @param len_chars Specify the address of a value to store the length of the returned path string, in characters, not including the terminating nul.
- * @param len_bytes Specify the address of a value to store the length of the returned path string, in bytes, including the trailing nul.
- * @return A nul-terminated string specifying the relative path to the default test set image data.
- * Free the returned path string using the PathBufferDelete function.
+ * @param len_chars Optional address of a value to store the length of the returned path string, in characters, not including the terminating nul.
+ * @param len_bytes Optional address of a value to store the length of the returned path string, in bytes, including the trailing nul.
+ * @return A nul-terminated string specifying the path to the default test set image data, relative to the directory containing the executable. The string is static and must not be freed.
  */
-MNIST_API(char*)
+MNIST_API(char const*)
 TestSetImages_GetDefaultRelativePath
 (
     size_t *len_chars, 
@@ -90,25 +85,49 @@ TestSetImages_GetDefaultRelativePath
 );
 
 /* @summary Retrieve the relative path to the default test set label data.
- * @param len_chars Specify the address of a value to store the length of the returned path string, in characters, not including the terminating nul.
- * @param len_bytes Specify the address of a value to store the length of the returned path string, in bytes, including the trailing nul.
- * @return A nul-terminated string specifying the relative path to the default test set label data.
- * Free the returned path string using the PathBufferDelete function.
+ * @param len_chars Optional address of a value to store the length of the returned path string, in characters, not including the terminating nul.
+ * @param len_bytes Optional address of a value to store the length of the returned path string, in bytes, including the trailing nul.
+ * @return A nul-terminated string specifying the path to the default test set label data, relative to the directory containing the executable. The string is static and must not be freed.
  */
-MNIST_API(char*)
+MNIST_API(char const*)
 TestSetLabels_GetDefaultRelativePath
 (
     size_t *len_chars, 
     size_t *len_bytes
 );
 
-MNIST_API(char*)
+/* @summary Retrieve the absolute path to the default training set image data.
+ * The path is resolved on the first call to any of the *_GetDefaultAbsolutePath functions and cached for the lifetime of the process. This function is safe to call from multiple threads.
+ * @param len_chars Optional address of a value to store the length of the returned path string, in characters, not including the terminating nul.
+ * @param len_bytes Optional address of a value to store the length of the returned path string, in bytes, including the trailing nul.
+ * @return A nul-terminated, normalized string specifying the absolute path to the default training set image data, or NULL if the path could not be resolved (check errno). The string must not be modified or freed.
+ */
+MNIST_API(char const*)
 TrainingSetImages_GetDefaultAbsolutePath
 (
     size_t *len_chars, 
     size_t *len_bytes
 );
 
+/* @summary Retrieve the absolute path to the default training set label data.
+ * The path is resolved on the first call to any of the *_GetDefaultAbsolutePath functions and cached for the lifetime of the process. This function is safe to call from multiple threads.
+ * @param len_chars Optional address of a value to store the length of the returned path string, in characters, not including the terminating nul.
+ * @param len_bytes Optional address of a value to store the length of the returned path string, in bytes, including the trailing nul.
+ * @return A nul-terminated, normalized string specifying the absolute path to the default training set label data, or NULL if the path could not be resolved (check errno). The string must not be modified or freed.
+ */
+MNIST_API(char const*)
+TrainingSetLabels_GetDefaultAbsolutePath
+(
+    size_t *len_chars, 
+    size_t *len_bytes
+);
+
+/* @summary Retrieve the absolute path to the default test set image data.
+ * The path is resolved on the first call to any of the *_GetDefaultAbsolutePath functions and cached for the lifetime of the process. This function is safe to call from multiple threads.
+ * @param len_chars Optional address of a value to store the length of the returned path string, in characters, not including the terminating nul.
+ * @param len_bytes Optional address of a value to store the length of the returned path string, in bytes, including the trailing nul.
+ * @return A nul-terminated, normalized string specifying the absolute path to the default test set image data, or NULL if the path could not be resolved (check errno). The string must not be modified or freed.
+ */
 MNIST_API(char const*)
 TestSetImages_GetDefaultAbsolutePath
 (
@@ -116,6 +135,19 @@ TestSetImages_GetDefaultAbsolutePath
     size_t *len_bytes
 );
 
+/* @summary Retrieve the absolute path to the default test set label data.
+ * The path is resolved on the first call to any of the *_GetDefaultAbsolutePath functions and cached for the lifetime of the process. This function is safe to call from multiple threads.
+ * @param len_chars Optional address of a value to store the length of the returned path string, in characters, not including the terminating nul.
+ * @param len_bytes Optional address of a value to store the length of the returned path string, in bytes, including the trailing nul.
+ * @return A nul-terminated, normalized string specifying the absolute path to the default test set label data, or NULL if the path could not be resolved (check errno). The string must not be modified or freed.
+ */
+MNIST_API(char const*)
+TestSetLabels_GetDefaultAbsolutePath
+(
+    size_t *len_chars, 
+    size_t *len_bytes
+);
+
 #ifdef __cplusplus
 }; /* extern "C" */
 #endif
@@ -0,0 +1,178 @@
+/**
+ * datacache.h: Defines types and functions for building and loading a cache of
+ * pre-converted float32 image data. The cache file is written alongside the IDX
+ * image file it was built from, stores samples in the row layout consumed by
+ * the training code, and is memory-mapped directly on subsequent runs.
+ */
+#ifndef __DATACACHE_H__
+#define __DATACACHE_H__
+
+#pragma once
+
+#ifndef MNIST_NO_INCLUDES
+#include <stddef.h>
+#include <stdint.h>
+#include "filemap.h"
+#include "dataset.h"
+#endif
+
+#ifndef MNIST_API
+#   ifdef  MNIST_STATIC
+#       define MNIST_API(_return_type)                                         \
+            static _return_type
+#else
+#       define MNIST_API(_return_type)                                         \
+            extern _return_type
+#   endif
+#endif
+
+/* @summary Define various constants used internally within this module.
+ * DATA_CACHE_MAGIC: The value stored in the Magic field of every cache file ('MNFC' in host byte order).
+ * DATA_CACHE_VERSION: The version of the cache file layout. Files with a different version are rebuilt.
+ * DATA_CACHE_BYTE_ORDER_MARK: A value written in host byte order used to reject caches built on a host with a different byte order.
+ * DATA_CACHE_ALIGNMENT: The alignment of the sample data and of each sample row within the file, in bytes.
+ * DATA_CACHE_FILE_SUFFIX: The suffix appended to the path of an IDX image file to produce the default cache file path.
+ */
+#ifndef DATACACHE_CONSTANTS
+#   define DATACACHE_CONSTANTS
+#   define DATA_CACHE_MAGIC               0x43464E4DUL
+#   define DATA_CACHE_VERSION             1
+#   define DATA_CACHE_BYTE_ORDER_MARK     0x01020304UL
+#   define DATA_CACHE_ALIGNMENT           64
+#   define DATA_CACHE_FILE_SUFFIX         ".f32cache"
+#endif
+
+/* @summary Define the supported normalizations applied to the 8-bit pixel values when the cache is built.
+ * Every normalization is of the form y = (x * Scale) + Bias, and the Scale and Bias are recorded in the cache header.
+ */
+typedef enum DATA_CACHE_NORMALIZE {
+    DATA_CACHE_NORMALIZE_UNIT    = 0,                                          /* Pixel values are mapped to [0, 1] (y = x / 255). */
+    DATA_CACHE_NORMALIZE_STANDARD= 1,                                          /* Pixel values are mapped to zero mean and unit variance over the whole data set. */
+} DATA_CACHE_NORMALIZE;
+
+/* @summary Define the layout of the 64-byte header at the start of every cache file.
+ * All fields are stored in host byte order.
+ */
+typedef struct DATA_CACHE_HEADER {
+    uint32_t                     Magic;                                        /* Must be DATA_CACHE_MAGIC. */
+    uint32_t                     Version;                                      /* Must be DATA_CACHE_VERSION. */
+    uint32_t                     ByteOrderMark;                                /* Must be DATA_CACHE_BYTE_ORDER_MARK when read on the host. */
+    uint32_t                     NormalizeMode;                                /* One of the values of the DATA_CACHE_NORMALIZE enumeration. */
+    uint32_t                     SampleCount;                                  /* The number of samples stored in the cache. */
+    uint32_t                     FeatureCount;                                 /* The number of valid float values in each sample row. */
+    uint32_t                     RowStride;                                    /* The distance between the start of consecutive sample rows, in floats. */
+    uint32_t                     DataOffset;                                   /* The offset of the first sample row from the start of the file, in bytes. */
+    uint64_t                     SourceSize;                                   /* The size of the source IDX image file when the cache was built, in bytes. */
+    uint64_t                     SourceWriteTime;                              /* The last modification time of the source IDX image file when the cache was built. */
+    float                        Scale;                                        /* The scale applied to each 8-bit pixel value. */
+    float                        Bias;                                         /* The bias added to each scaled pixel value. */
+    uint32_t                     Reserved[2];                                  /* Reserved for future use. Set to zero. */
+} DATA_CACHE_HEADER;
+
+/* @summary Define the data associated with an open, memory-mapped float32 cache file.
+ */
+typedef struct DATA_CACHE {
+    FILE_MAPPING                 Mapping;                                      /* The read-only view of the entire cache file. */
+    DATA_CACHE_HEADER const     *Header;                                       /* Points to the header at the start of the mapped view. */
+    float const                 *Samples;                                      /* Points to the first float of the first sample row. Aligned to DATA_CACHE_ALIGNMENT bytes. */
+    uint32_t                     SampleCount;                                  /* The number of samples stored in the cache. */
+    uint32_t                     FeatureCount;                                 /* The number of valid float values in each sample row. */
+    uint32_t                     RowStride;                                    /* The distance between the start of consecutive sample rows, in floats. */
+    float                        Scale;                                        /* The scale that was applied to each 8-bit pixel value. */
+    float                        Bias;                                         /* The bias that was added to each scaled pixel value. */
+} DATA_CACHE;
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* @summary Compute the scale and bias for a normalization mode from the image data of a data set.
+ * @param o_scale On return, this location is updated with the scale to apply to each 8-bit pixel value.
+ * @param o_bias On return, this location is updated with the bias to add to each scaled pixel value.
+ * @param dataset The data set whose pixel statistics are used for DATA_CACHE_NORMALIZE_STANDARD.
+ * @param normalize_mode One of the values of the DATA_CACHE_NORMALIZE enumeration.
+ * @return Zero if the parameters are computed successfully, or -1 if normalize_mode is not recognized.
+ */
+MNIST_API(int)
+DataCacheNormalization
+(
+    float                      *o_scale,
+    float                       *o_bias,
+    struct MNIST_DATASET const *dataset,
+    uint32_t             normalize_mode
+);
+
+/* @summary Convert the image data of a data set to float32 and write it to a cache file, replacing any existing file.
+ * The file is written to a temporary path and renamed into place, so readers never observe a partially-written cache.
+ * @param dataset The data set whose image data will be converted.
+ * @param cache_path A nul-terminated, UTF-8 encoded string specifying the path of the cache file to write.
+ * @param normalize_mode One of the values of the DATA_CACHE_NORMALIZE enumeration.
+ * @return Zero if the cache file is written successfully, or -1 if an error occurred. Check errno for error information.
+ */
+MNIST_API(int)
+DataCacheBuild
+(
+    struct MNIST_DATASET const *dataset,
+    char const              *cache_path,
+    uint32_t             normalize_mode
+);
+
+/* @summary Map an existing cache file into memory and verify that it is current with respect to a data set.
+ * @param o_cache The DATA_CACHE to initialize. On failure, the structure is zero-initialized.
+ * @param dataset The data set the cache must have been built from. The size and modification time of its image file are compared against the cache header.
+ * @param cache_path A nul-terminated, UTF-8 encoded string specifying the path of the cache file to open.
+ * @param normalize_mode One of the values of the DATA_CACHE_NORMALIZE enumeration. The cache must have been built with the same mode.
+ * @return Zero if the cache is opened and current, or -1 if the cache is missing, stale or invalid. errno is set to ESTALE for a cache that must be rebuilt.
+ */
+MNIST_API(int)
+DataCacheOpen
+(
+    struct DATA_CACHE             *o_cache,
+    struct MNIST_DATASET const    *dataset,
+    char const                 *cache_path,
+    uint32_t                normalize_mode
+);
+
+/* @summary Open a cache file, building or rebuilding it first if it is missing or stale.
+ * @param o_cache The DATA_CACHE to initialize. On failure, the structure is zero-initialized.
+ * @param dataset The data set the cache is built from.
+ * @param cache_path A nul-terminated, UTF-8 encoded string specifying the path of the cache file. By convention, this is the image file path with DATA_CACHE_FILE_SUFFIX appended.
+ * @param normalize_mode One of the values of the DATA_CACHE_NORMALIZE enumeration.
+ * @return Zero if the cache is opened successfully, or -1 if an error occurred. Check errno for error information.
+ */
+MNIST_API(int)
+DataCacheOpenOrBuild
+(
+    struct DATA_CACHE             *o_cache,
+    struct MNIST_DATASET const    *dataset,
+    char const                 *cache_path,
+    uint32_t                normalize_mode
+);
+
+/* @summary Close a cache file opened with DataCacheOpen or DataCacheOpenOrBuild. Any pointers into the sample data are invalid after this function returns.
+ * @param cache The DATA_CACHE to close.
+ */
+MNIST_API(void)
+DataCacheClose
+(
+    struct DATA_CACHE *cache
+);
+
+/* @summary Retrieve a read-only view of a single sample row.
+ * @param cache The DATA_CACHE to query.
+ * @param index The zero-based index of the sample, in [0, SampleCount).
+ * @return A pointer to the first of FeatureCount float values for the sample. The pointer is aligned to DATA_CACHE_ALIGNMENT bytes.
+ */
+MNIST_API(float const*)
+DataCacheSample
+(
+    struct DATA_CACHE const *cache,
+    uint32_t                 index
+);
+
+#ifdef __cplusplus
+}; /* extern "C" */
+#endif
+
+#endif /* __DATACACHE_H__ */
+
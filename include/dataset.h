@@ -0,0 +1,107 @@
+/**
+ * dataset.h: Defines types and functions for accessing an MNIST-style data set
+ * consisting of a pair of IDX files - one storing images and one storing the
+ * corresponding labels. Both files are memory-mapped and accessed in-place.
+ */
+#ifndef __DATASET_H__
+#define __DATASET_H__
+
+#pragma once
+
+#ifndef MNIST_NO_INCLUDES
+#include <stddef.h>
+#include <stdint.h>
+#include "idxfile.h"
+#endif
+
+#ifndef MNIST_API
+#   ifdef  MNIST_STATIC
+#       define MNIST_API(_return_type)                                         \
+            static _return_type
+#else
+#       define MNIST_API(_return_type)                                         \
+            extern _return_type
+#   endif
+#endif
+
+/* @summary Define various constants used internally within this module.
+ * MNIST_CLASS_COUNT: The number of classes. Every label must be less than this value.
+ */
+#ifndef MNIST_DATASET_CONSTANTS
+#   define MNIST_DATASET_CONSTANTS
+#   define MNIST_CLASS_COUNT              10
+#endif
+
+/* @summary Define the data associated with an open image/label data set.
+ * The Pixels and Labels fields point directly into the mapped IDX files and must not be written.
+ */
+typedef struct MNIST_DATASET {
+    IDX_FILE                     ImageFile;                                    /* The IDX file storing the image data, with dimensions [SampleCount][ImageRows][ImageColumns]. */
+    IDX_FILE                     LabelFile;                                    /* The IDX file storing the label data, with dimensions [SampleCount]. */
+    uint8_t const               *Pixels;                                       /* Points to the first pixel of the first image. Images are stored consecutively, row-major. */
+    uint8_t const               *Labels;                                       /* Points to the label of the first image. */
+    uint32_t                     SampleCount;                                  /* The number of image/label pairs in the data set. */
+    uint32_t                     ImageRows;                                    /* The height of each image, in pixels. */
+    uint32_t                     ImageColumns;                                 /* The width of each image, in pixels. */
+    uint32_t                     ImageSize;                                    /* The number of pixels in each image (ImageRows * ImageColumns). */
+} MNIST_DATASET;
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* @summary Open an image/label data set and validate that the two files describe the same set of samples.
+ * The image file must store IDX_TYPE_U8 elements with three dimensions, and the label file must store IDX_TYPE_U8 elements with one dimension.
+ * Every label must be less than MNIST_CLASS_COUNT, since the consumers of the data set use labels as array indices.
+ * @param o_dataset The MNIST_DATASET to initialize. On failure, the structure is zero-initialized.
+ * @param images_path A nul-terminated, UTF-8 encoded string specifying the path of the IDX file containing the image data.
+ * @param labels_path A nul-terminated, UTF-8 encoded string specifying the path of the IDX file containing the label data.
+ * @return Zero if the data set is opened successfully, or -1 if an error occurred. Check errno for error information.
+ */
+MNIST_API(int)
+MnistDatasetOpen
+(
+    struct MNIST_DATASET *o_dataset,
+    char const         *images_path,
+    char const         *labels_path
+);
+
+/* @summary Close a data set opened with MnistDatasetOpen. Any pointers into the image or label data are invalid after this function returns.
+ * @param dataset The MNIST_DATASET to close.
+ */
+MNIST_API(void)
+MnistDatasetClose
+(
+    struct MNIST_DATASET *dataset
+);
+
+/* @summary Retrieve a read-only view of the pixels of a single image.
+ * @param dataset The MNIST_DATASET to query.
+ * @param index The zero-based index of the sample, in [0, SampleCount).
+ * @return A pointer to the first of ImageSize pixels of the image, stored row-major.
+ */
+MNIST_API(uint8_t const*)
+MnistDatasetImage
+(
+    struct MNIST_DATASET const *dataset,
+    uint32_t                      index
+);
+
+/* @summary Retrieve the label of a single sample.
+ * @param dataset The MNIST_DATASET to query.
+ * @param index The zero-based index of the sample, in [0, SampleCount).
+ * @return The label value for the sample.
+ */
+MNIST_API(uint8_t)
+MnistDatasetLabel
+(
+    struct MNIST_DATASET const *dataset,
+    uint32_t                      index
+);
+
+#ifdef __cplusplus
+}; /* extern "C" */
+#endif
+
+#endif /* __DATASET_H__ */
+
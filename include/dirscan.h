@@ -0,0 +1,163 @@
+/**
+ * dirscan.h: Defines types and functions for discovering the IDX shard files
+ * that make up a data set. A directory tree is walked one level at a time, with
+ * the directories of each level enumerated in parallel on a task pool using the
+ * host's bulk directory enumeration API. Candidate files are classified by
+ * parsing their names with pathlib, and the shard paths are interned so that
+ * they can be referred to by a 32-bit id.
+ */
+#ifndef __DIRSCAN_H__
+#define __DIRSCAN_H__
+
+#pragma once
+
+#ifndef MNIST_NO_INCLUDES
+#include <stddef.h>
+#include <stdint.h>
+#include "pathlib.h"
+#include "taskpool.h"
+#endif
+
+#ifndef MNIST_API
+#   ifdef  MNIST_STATIC
+#       define MNIST_API(_return_type)                                         \
+            static _return_type
+#else
+#       define MNIST_API(_return_type)                                         \
+            extern _return_type
+#   endif
+#endif
+
+/* @summary Define various constants used internally within this module.
+ * DIRECTORY_SCAN_BUFFER_SIZE: The size of the buffer each thread uses to receive directory entries from the host, in bytes.
+ * DIRECTORY_SCAN_NO_DEPTH_LIMIT: The value of DIRECTORY_SCAN_INIT::MaxDepth that places no limit on the depth of the walk.
+ */
+#ifndef DIRSCAN_CONSTANTS
+#   define DIRSCAN_CONSTANTS
+#   define DIRECTORY_SCAN_BUFFER_SIZE     (256UL * 1024UL)
+#   define DIRECTORY_SCAN_NO_DEPTH_LIMIT  0xFFFFFFFFU
+#endif
+
+/* @summary Define the data sets a shard file can belong to.
+ */
+typedef enum IDX_SHARD_SET {
+    IDX_SHARD_SET_UNKNOWN        = 0,                                          /* The data set could not be determined from the path. */
+    IDX_SHARD_SET_TRAINING       = 1,                                          /* The shard belongs to the training set ("train" file name prefix or directory). */
+    IDX_SHARD_SET_TEST           = 2,                                          /* The shard belongs to the test set ("t10k" or "test" file name prefix or directory). */
+} IDX_SHARD_SET;
+
+/* @summary Define the kinds of data a shard file can hold.
+ */
+typedef enum IDX_SHARD_CONTENT {
+    IDX_SHARD_CONTENT_UNKNOWN    = 0,                                          /* The content could not be determined from the path. */
+    IDX_SHARD_CONTENT_IMAGES     = 1,                                          /* The shard holds sample images ("images" or "idx3" in the file name). */
+    IDX_SHARD_CONTENT_LABELS     = 2,                                          /* The shard holds sample labels ("labels" or "idx1" in the file name). */
+} IDX_SHARD_CONTENT;
+
+/* @summary Define the attributes of a single IDX shard file derived from its path.
+ */
+typedef struct IDX_SHARD {
+    uint32_t                     PathId;                                       /* The id of the shard path in IDX_SHARD_LIST::Paths. */
+    uint32_t                     DataSet;                                      /* One of the values of the IDX_SHARD_SET enumeration. */
+    uint32_t                     Content;                                      /* One of the values of the IDX_SHARD_CONTENT enumeration. */
+    uint32_t                     ShardIndex;                                   /* The number at the end of the file name or, failing that, of its directory, or zero. */
+} IDX_SHARD;
+
+/* @summary Define the data associated with the set of shard files discovered in a directory tree.
+ * Shards are sorted by data set, then content, then shard index, then path id. The paths added by each call to IdxShardListAddPaths are interned in sorted order.
+ */
+typedef struct IDX_SHARD_LIST {
+    PATH_INTERN_TABLE            Paths;                                        /* The normalized paths of the shard files, with forward slashes as separators. */
+    IDX_SHARD                   *Shards;                                       /* The array of ShardCount shard attributes. */
+    uint32_t                     ShardCount;                                   /* The number of shard files in the list. */
+    uint32_t                     Capacity;                                     /* The maximum number of shard files the list can hold. */
+    uint32_t                     DirectoryCount;                               /* The number of directories enumerated by DirectoryScanIdxShards. */
+    uint32_t                     FileCount;                                    /* The number of files examined by DirectoryScanIdxShards. */
+    uint32_t                     SkippedCount;                                 /* The number of directories that could not be opened, and of paths that were too long. */
+} IDX_SHARD_LIST;
+
+/* @summary Define the configuration used to scan a directory tree for shard files.
+ */
+typedef struct DIRECTORY_SCAN_INIT {
+    char const                  *RootPath;                                     /* The nul-terminated, UTF-8 encoded path of the directory to scan. */
+    struct TASK_POOL            *TaskPool;                                     /* The pool used to enumerate the directories of each level in parallel, or NULL to scan on the calling thread. */
+    uint32_t                     MaxDepth;                                     /* The number of levels of subdirectories to descend into, or DIRECTORY_SCAN_NO_DEPTH_LIMIT. */
+} DIRECTORY_SCAN_INIT;
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* @summary Allocate the storage for a list of shard files.
+ * @param o_list The IDX_SHARD_LIST to initialize. On failure, the structure is zero-initialized.
+ * @param capacity The maximum number of shard files the list can hold.
+ * @param string_bytes The number of bytes reserved for the shard paths, including their nul-terminators.
+ * @return Zero if the list is created, or -1 if an error occurred. Check errno for error information.
+ */
+MNIST_API(int)
+IdxShardListCreate
+(
+    struct IDX_SHARD_LIST *o_list,
+    uint32_t             capacity,
+    size_t           string_bytes
+);
+
+/* @summary Free the storage associated with a list of shard files.
+ * @param list The IDX_SHARD_LIST to delete. The structure is zero-initialized on return.
+ */
+MNIST_API(void)
+IdxShardListDelete
+(
+    struct IDX_SHARD_LIST *list
+);
+
+/* @summary Determine whether a path names an IDX shard file and, if so, which data set and content it holds.
+ * A shard file name contains "idx" followed by a digit and "-ubyte", as in "train-images-idx3-ubyte" or "t10k-labels.idx1-ubyte.0003". Matching is not case-sensitive.
+ * Anything after "ubyte" must be '.' or '-' followed only by digits, so derived files such as "train-images-idx3-ubyte.f32cache" are not shards.
+ * @param o_shard On return, the DataSet, Content and ShardIndex fields are set. The PathId field is not modified.
+ * @param parts The components of the path, as returned by LinuxPathStringParse for a path naming a file.
+ * @return Zero if the path names an IDX shard file, or -1 if it does not.
+ */
+MNIST_API(int)
+IdxShardClassify
+(
+    struct IDX_SHARD             *o_shard,
+    struct PATH_PARTS_LINUX const *parts
+);
+
+/* @summary Classify a set of packed file paths and add those that name IDX shard files to a list. The list is re-sorted on return.
+ * The paths are parsed in batches with LinuxPathStringParseBatch, which normalizes backslashes in blob to forward slashes. Paths already in the list are not added again.
+ * @param list The list to add to.
+ * @param blob The packed file paths, each UTF-8 encoded and nul-terminated, stored one after another.
+ * @param blob_bytes The size of blob, in bytes. Must be less than 4 GB.
+ * @return Zero if every shard path was added, or -1 if an error occurred. errno is ENOSPC if the list is full, or ENOMEM if the path storage is full.
+ */
+MNIST_API(int)
+IdxShardListAddPaths
+(
+    struct IDX_SHARD_LIST *list,
+    char8_t                *blob,
+    size_t            blob_bytes
+);
+
+/* @summary Walk a directory tree and add every IDX shard file found to a list.
+ * Directories are walked one level at a time, and the directories of each level are enumerated in parallel, each thread using a buffer of DIRECTORY_SCAN_BUFFER_SIZE bytes.
+ * File types are taken from the directory entries; a file is only examined when its entry is a symbolic link or the file system does not report its type.
+ * Symbolic links to files are followed; symbolic links to directories are not. Files whose names do not contain "ubyte" are not classified.
+ * @param list The list to add to. DirectoryCount, FileCount and SkippedCount are updated with the totals for this walk.
+ * @param init The scan configuration.
+ * @return Zero if the tree is walked, or -1 if the root directory cannot be opened or an error occurred. Check errno for error information.
+ * Subdirectories that cannot be opened are counted in SkippedCount and do not cause the walk to fail.
+ */
+MNIST_API(int)
+DirectoryScanIdxShards
+(
+    struct IDX_SHARD_LIST           *list,
+    struct DIRECTORY_SCAN_INIT const *init
+);
+
+#ifdef __cplusplus
+}; /* extern "C" */
+#endif
+
+#endif /* __DIRSCAN_H__ */
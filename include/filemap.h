@@ -0,0 +1,79 @@
+/**
+ * filemap.h: Defines the interface for mapping files into the process address
+ * space for read-only, zero-copy access. Mapped views share the host page cache
+ * so multiple processes reading the same data set do not duplicate the data.
+ */
+#ifndef __FILEMAP_H__
+#define __FILEMAP_H__
+
+#pragma once
+
+#ifndef MNIST_NO_INCLUDES
+#include <stddef.h>
+#include <stdint.h>
+#endif
+
+#ifndef MNIST_API
+#   ifdef  MNIST_STATIC
+#       define MNIST_API(_return_type)                                         \
+            static _return_type
+#else
+#       define MNIST_API(_return_type)                                         \
+            extern _return_type
+#   endif
+#endif
+
+/* @summary Define the data associated with a read-only view of an entire file.
+ */
+typedef struct FILE_MAPPING {
+    void const                  *Base;                                         /* The address of the first byte of the mapped view, or NULL if the file is empty. */
+    size_t                       Size;                                         /* The number of bytes in the mapped view. */
+    uint64_t                     FileSize;                                     /* The size of the file at the time it was mapped, in bytes. */
+    uint64_t                     LastWriteTime;                                /* The last modification time of the file, in nanoseconds since the epoch. */
+} FILE_MAPPING;
+
+/* @summary Define a set of flags that can be bitwise-OR'd together to describe the expected access pattern for a mapped file.
+ * The host may use these hints to tune readahead; they never affect correctness.
+ */
+typedef enum FILE_MAPPING_HINTS {
+    FILE_MAPPING_HINTS_NONE     = (0UL <<  0),                                 /* No particular access pattern is expected. */
+    FILE_MAPPING_HINT_SEQUENTIAL= (1UL <<  0),                                 /* The file will be read mostly front-to-back. */
+    FILE_MAPPING_HINT_RANDOM    = (1UL <<  1),                                 /* The file will be read in a scattered order. */
+    FILE_MAPPING_HINT_WILLNEED  = (1UL <<  2),                                 /* The whole file will be read soon; start paging it in now. */
+    FILE_MAPPING_HINT_POPULATE  = (1UL <<  3),                                 /* Fault in the whole file before returning from FileMappingOpen. */
+} FILE_MAPPING_HINTS;
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* @summary Map an entire file into the process address space for read-only access.
+ * @param o_mapping The FILE_MAPPING to initialize. On failure, the structure is zero-initialized.
+ * @param path A nul-terminated, UTF-8 encoded string specifying the path of the file to map.
+ * @param hints One or more bitwise-OR'd values of the FILE_MAPPING_HINTS enumeration.
+ * @return Zero if the file is mapped successfully, or -1 if an error occurred. Check errno for error information.
+ */
+MNIST_API(int)
+FileMappingOpen
+(
+    struct FILE_MAPPING *o_mapping,
+    char const               *path,
+    uint32_t                 hints
+);
+
+/* @summary Unmap a file view returned by FileMappingOpen.
+ * Any pointers into the mapped view are invalid after this function returns.
+ * @param mapping The FILE_MAPPING to close. The structure is zero-initialized on return.
+ */
+MNIST_API(void)
+FileMappingClose
+(
+    struct FILE_MAPPING *mapping
+);
+
+#ifdef __cplusplus
+}; /* extern "C" */
+#endif
+
+#endif /* __FILEMAP_H__ */
+
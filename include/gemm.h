@@ -0,0 +1,196 @@
+/**
+ * gemm.h: Defines functions for single-precision general matrix multiplication.
+ * The implementation follows the usual cache-blocked structure: panels of B
+ * and blocks of A are packed into contiguous buffers sized for the L3 and L2
+ * caches, and a register-tiled micro-kernel computes each MR x NR tile of C.
+ * Inputs stored as bfloat16 or float16 are widened to float32 as they are
+ * packed, so the micro-kernels and the accumulation are always float32.
+ */
+#ifndef __GEMM_H__
+#define __GEMM_H__
+
+#pragma once
+
+#ifndef MNIST_NO_INCLUDES
+#include <stddef.h>
+#include <stdint.h>
+#include "convert.h"
+#include "taskpool.h"
+#endif
+
+#ifndef MNIST_API
+#   ifdef  MNIST_STATIC
+#       define MNIST_API(_return_type)                                         \
+            static _return_type
+#else
+#       define MNIST_API(_return_type)                                         \
+            extern _return_type
+#   endif
+#endif
+
+/* @summary Define the blocking parameters used by the GEMM implementation.
+ * GEMM_MR, GEMM_NR: The dimensions of the tile of C computed by one call to the micro-kernel (6x16 fills 12 of the 16 AVX2 registers).
+ * GEMM_MC: The number of rows of A packed at a time. An MC x KC block of A should fit in the L2 cache.
+ * GEMM_KC: The depth of each packed block of A and panel of B. A KC x NR sliver of B should fit in the L1 cache.
+ * GEMM_NC: The number of columns of B packed at a time. A KC x NC panel of B should fit in the L3 cache.
+ * GEMM_ALIGNMENT: The required alignment of a caller-supplied workspace, in bytes.
+ * GEMM_WORKSPACE_FLOATS: The number of floats required for a GEMM workspace.
+ * GEMM_TILE_M, GEMM_TILE_N: The dimensions of the tile of C computed by one task of a parallel GEMM.
+ * GEMM_PARALLEL_WORKSPACE_FLOATS(_m): The number of floats required for the workspace of a parallel GEMM with _m rows, which packs all of A at once.
+ */
+#ifndef GEMM_CONSTANTS
+#   define GEMM_CONSTANTS
+#   define GEMM_MR                        6
+#   define GEMM_NR                        16
+#   define GEMM_MC                        144
+#   define GEMM_KC                        256
+#   define GEMM_NC                        3072
+#   define GEMM_ALIGNMENT                 64
+#   define GEMM_WORKSPACE_FLOATS          ((GEMM_MC * GEMM_KC) + (GEMM_KC * GEMM_NC))
+#   define GEMM_TILE_M                    (GEMM_MR * 4)
+#   define GEMM_TILE_N                    (GEMM_NR * 4)
+#   define GEMM_PARALLEL_WORKSPACE_FLOATS(_m)                                  \
+        ((((size_t)(_m) + GEMM_MR - 1) / GEMM_MR * GEMM_MR * GEMM_KC) + (GEMM_KC * GEMM_NC))
+#endif
+
+/* @summary Define the operations that can be applied to an input matrix.
+ */
+typedef enum GEMM_OP {
+    GEMM_OP_NONE                = 0,                                           /* The matrix is used as stored. */
+    GEMM_OP_TRANSPOSE           = 1,                                           /* The transpose of the matrix is used. */
+} GEMM_OP;
+
+/* @summary Define identifiers for the available implementations of the GEMM micro-kernel.
+ */
+typedef enum GEMM_KERNEL {
+    GEMM_KERNEL_SCALAR          = 0,                                           /* Portable C micro-kernel. */
+    GEMM_KERNEL_AVX2            = 1,                                           /* AVX2 and FMA micro-kernel. */
+    GEMM_KERNEL_COUNT           = 2,                                           /* The number of kernel identifiers. */
+} GEMM_KERNEL;
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* @summary Compute C = alpha * op(A) * op(B) + beta * C for row-major single-precision matrices.
+ * op(A) is M x K and op(B) is K x N. If beta is zero, C is not read, so it may contain NaN or uninitialized values.
+ * @param trans_a One of the values of the GEMM_OP enumeration. If GEMM_OP_TRANSPOSE, A is stored as K x M.
+ * @param trans_b One of the values of the GEMM_OP enumeration. If GEMM_OP_TRANSPOSE, B is stored as N x K.
+ * @param m The number of rows of op(A) and C.
+ * @param n The number of columns of op(B) and C.
+ * @param k The number of columns of op(A) and rows of op(B).
+ * @param alpha The scale applied to the product op(A) * op(B).
+ * @param a The first element of A.
+ * @param lda The distance between the start of consecutive rows of A as stored, in floats.
+ * @param b The first element of B.
+ * @param ldb The distance between the start of consecutive rows of B as stored, in floats.
+ * @param beta The scale applied to C before the product is added.
+ * @param c The first element of C.
+ * @param ldc The distance between the start of consecutive rows of C, in floats.
+ * @param workspace Optional scratch memory of at least GEMM_WORKSPACE_FLOATS floats, aligned to GEMM_ALIGNMENT bytes. If NULL, the workspace is allocated and freed internally.
+ * @return Zero if the product is computed, or -1 if the workspace could not be allocated.
+ */
+MNIST_API(int)
+GemmF32
+(
+    uint32_t           trans_a,
+    uint32_t           trans_b,
+    uint32_t                 m,
+    uint32_t                 n,
+    uint32_t                 k,
+    float                alpha,
+    float const             *a,
+    uint32_t               lda,
+    float const             *b,
+    uint32_t               ldb,
+    float                 beta,
+    float                   *c,
+    uint32_t               ldc,
+    float           *workspace
+);
+
+/* @summary Compute C = alpha * op(A) * op(B) + beta * C using the threads of a task pool.
+ * For each KC x NC panel, op(A) and op(B) are packed in parallel, and then GEMM_TILE_M x GEMM_TILE_N tiles of C are computed in parallel.
+ * Arguments other than pool and workspace are the same as for GemmF32. If pool is NULL or has a single thread, this is equivalent to GemmF32.
+ * @param pool The task pool to execute on. May be NULL.
+ * @param workspace Optional scratch memory aligned to GEMM_ALIGNMENT bytes, of at least GEMM_PARALLEL_WORKSPACE_FLOATS(m) floats and at least GEMM_WORKSPACE_FLOATS floats. If NULL, the workspace is allocated and freed internally.
+ * @return Zero if the product is computed, or -1 if the workspace could not be allocated.
+ */
+MNIST_API(int)
+GemmF32Parallel
+(
+    struct TASK_POOL     *pool,
+    uint32_t           trans_a,
+    uint32_t           trans_b,
+    uint32_t                 m,
+    uint32_t                 n,
+    uint32_t                 k,
+    float                alpha,
+    float const             *a,
+    uint32_t               lda,
+    float const             *b,
+    uint32_t               ldb,
+    float                 beta,
+    float                   *c,
+    uint32_t               ldc,
+    float           *workspace
+);
+
+/* @summary Compute C = alpha * op(A) * op(B) + beta * C, where A and B may be stored as bfloat16 or float16 values.
+ * Elements of A and B are widened to float32 as they are packed, and C is always float32. Products are accumulated in float32.
+ * Arguments not described here are the same as for GemmF32Parallel. Leading dimensions are measured in elements of the stored type.
+ * @param type_a The storage format of A, one of the values of the CONVERT_TYPE enumeration.
+ * @param type_b The storage format of B, one of the values of the CONVERT_TYPE enumeration.
+ * @param a The first element of A, a float const* or uint16_t const* depending on type_a.
+ * @param b The first element of B, a float const* or uint16_t const* depending on type_b.
+ * @return Zero if the product is computed, or -1 if the workspace could not be allocated.
+ */
+MNIST_API(int)
+GemmMixedParallel
+(
+    struct TASK_POOL     *pool,
+    uint32_t            type_a,
+    uint32_t           trans_a,
+    uint32_t            type_b,
+    uint32_t           trans_b,
+    uint32_t                 m,
+    uint32_t                 n,
+    uint32_t                 k,
+    float                alpha,
+    void const              *a,
+    uint32_t               lda,
+    void const              *b,
+    uint32_t               ldb,
+    float                 beta,
+    float                   *c,
+    uint32_t               ldc,
+    float           *workspace
+);
+
+/* @summary Select the micro-kernel used by subsequent calls to GemmF32, GemmF32Parallel and GemmMixedParallel.
+ * This is intended for testing and benchmarking. By default, the fastest kernel supported by the host is used.
+ * @param kernel One of the values of the GEMM_KERNEL enumeration.
+ * @return Zero if the kernel is selected, or -1 if the kernel is not supported by the host CPU.
+ */
+MNIST_API(int)
+GemmSelectKernel
+(
+    uint32_t kernel
+);
+
+/* @summary Retrieve a short name for a kernel identifier, for use in reports.
+ * @param kernel One of the values of the GEMM_KERNEL enumeration.
+ * @return A nul-terminated string such as "avx2".
+ */
+MNIST_API(char const*)
+GemmKernelName
+(
+    uint32_t kernel
+);
+
+#ifdef __cplusplus
+}; /* extern "C" */
+#endif
+
+#endif /* __GEMM_H__ */
+
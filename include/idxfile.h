@@ -0,0 +1,188 @@
+/**
+ * idxfile.h: Defines types and functions for working with data stored in the
+ * IDX file format described in data/FORMAT. IDX files are memory-mapped, and
+ * the header is validated once when the file is opened; single-byte element
+ * data is then accessed in-place without copying, while multi-byte elements are
+ * converted from MSB-first order into caller-supplied buffers.
+ */
+#ifndef __IDXFILE_H__
+#define __IDXFILE_H__
+
+#pragma once
+
+#ifndef MNIST_NO_INCLUDES
+#include <stddef.h>
+#include <stdint.h>
+#include "filemap.h"
+#endif
+
+#ifndef MNIST_API
+#   ifdef  MNIST_STATIC
+#       define MNIST_API(_return_type)                                         \
+            static _return_type
+#else
+#       define MNIST_API(_return_type)                                         \
+            extern _return_type
+#   endif
+#endif
+
+/* @summary Define various constants used internally within this module.
+ * IDX_MAX_DIMENSIONS: The maximum number of dimensions an IDX file can describe (the count is stored in a single byte).
+ * IDX_MIN_HEADER_SIZE: The size of the smallest valid IDX header (magic number plus one dimension), in bytes.
+ */
+#ifndef IDXFILE_CONSTANTS
+#   define IDXFILE_CONSTANTS
+#   define IDX_MAX_DIMENSIONS             255
+#   define IDX_MIN_HEADER_SIZE            8
+#endif
+
+/* @summary Define the element type codes stored in the third byte of the IDX magic number.
+ */
+typedef enum IDX_TYPE {
+    IDX_TYPE_UNKNOWN             = 0x00,                                       /* The type code is not recognized. */
+    IDX_TYPE_U8                  = 0x08,                                       /* Elements are unsigned 8-bit integers. */
+    IDX_TYPE_I8                  = 0x09,                                       /* Elements are signed 8-bit integers. */
+    IDX_TYPE_I16                 = 0x0B,                                       /* Elements are signed 16-bit integers, MSB first. */
+    IDX_TYPE_I32                 = 0x0C,                                       /* Elements are signed 32-bit integers, MSB first. */
+    IDX_TYPE_F32                 = 0x0D,                                       /* Elements are IEEE-754 single-precision floats, MSB first. */
+    IDX_TYPE_F64                 = 0x0E,                                       /* Elements are IEEE-754 double-precision floats, MSB first. */
+} IDX_TYPE;
+
+/* @summary Define the attributes of an IDX file decoded from its header.
+ */
+typedef struct IDX_HEADER {
+    uint32_t                     TypeCode;                                     /* One of the values of the IDX_TYPE enumeration. */
+    uint32_t                     ElementSize;                                  /* The size of a single element, in bytes. */
+    uint32_t                     DimensionCount;                               /* The number of valid entries in the Dimensions array. */
+    uint32_t                     HeaderSize;                                   /* The size of the header, in bytes. Element data starts at this offset. */
+    uint64_t                     ElementCount;                                 /* The total number of elements (the product of all dimensions). */
+    uint64_t                     DataSize;                                     /* The size of the element data, in bytes. */
+    uint32_t                     Dimensions[IDX_MAX_DIMENSIONS];               /* The size of each dimension, slowest-changing first, in host byte order. */
+} IDX_HEADER;
+
+/* @summary Define the data associated with an open, memory-mapped IDX file.
+ */
+typedef struct IDX_FILE {
+    FILE_MAPPING                 Mapping;                                      /* The read-only view of the entire file. */
+    IDX_HEADER                   Header;                                       /* The validated file header. */
+    void const                  *Data;                                         /* Points to the first byte of element data within the mapped view. */
+} IDX_FILE;
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* @summary Retrieve the size of a single element of a given IDX type.
+ * @param type_code One of the values of the IDX_TYPE enumeration.
+ * @return The size of a single element, in bytes, or zero if type_code is not recognized.
+ */
+MNIST_API(uint32_t)
+IdxElementSize
+(
+    uint32_t type_code
+);
+
+/* @summary Decode and validate the header of an IDX file.
+ * @param o_header The IDX_HEADER to populate.
+ * @param buf Pointer to the start of the IDX file data.
+ * @param buf_size The number of bytes of data available at buf. The header is validated against this size to guarantee that all element data is present.
+ * @return Zero if the header is valid, or -1 if the data does not describe a valid IDX file. Check errno for error information.
+ */
+MNIST_API(int)
+IdxHeaderParse
+(
+    struct IDX_HEADER *o_header,
+    void const             *buf,
+    size_t             buf_size
+);
+
+/* @summary Map an IDX file into memory and validate its header.
+ * @param o_file The IDX_FILE to initialize. On failure, the structure is zero-initialized.
+ * @param path A nul-terminated, UTF-8 encoded string specifying the path of the IDX file to open.
+ * @param hints One or more bitwise-OR'd values of the FILE_MAPPING_HINTS enumeration describing how the data will be accessed.
+ * @return Zero if the file is opened successfully, or -1 if an error occurred. Check errno for error information.
+ */
+MNIST_API(int)
+IdxFileOpen
+(
+    struct IDX_FILE *o_file,
+    char const        *path,
+    uint32_t          hints
+);
+
+/* @summary Close an IDX file opened with IdxFileOpen. Any pointers into the element data are invalid after this function returns.
+ * @param file The IDX_FILE to close.
+ */
+MNIST_API(void)
+IdxFileClose
+(
+    struct IDX_FILE *file
+);
+
+/* @summary Retrieve a read-only view of the element data of an IDX file storing unsigned 8-bit elements.
+ * @param file The IDX_FILE to query.
+ * @return A pointer to the first element, or NULL if the file does not store IDX_TYPE_U8 elements.
+ */
+MNIST_API(uint8_t const*)
+IdxFileDataU8
+(
+    struct IDX_FILE const *file
+);
+
+/* @summary Copy elements from MSB-first (IDX) byte order to host byte order, or from host byte order to MSB-first order.
+ * The conversion is its own inverse, so the same function is used for reading and writing.
+ * @param dst The destination buffer. This buffer must be at least count * element_size bytes and must not overlap src.
+ * @param src The source buffer.
+ * @param count The number of elements to convert.
+ * @param element_size The size of a single element, in bytes. Must be 1, 2, 4 or 8.
+ */
+MNIST_API(void)
+IdxSwapToHost
+(
+    void       * __restrict dst,
+    void const * __restrict src,
+    size_t                count,
+    uint32_t       element_size
+);
+
+/* @summary Copy a range of elements from an IDX file into a caller-supplied buffer, converting them to host byte order.
+ * Elements are addressed as if the file were a one-dimensional array; element i of an N-dimensional file is at the row-major offset of its index tuple.
+ * @param file The IDX_FILE to read from.
+ * @param dst The destination buffer. This buffer must be at least count * file->Header.ElementSize bytes.
+ * @param first The zero-based index of the first element to read.
+ * @param count The number of elements to read.
+ * @return Zero if the elements are copied successfully, or -1 if the range is outside of the file. Check errno for error information.
+ */
+MNIST_API(int)
+IdxFileRead
+(
+    struct IDX_FILE const *file,
+    void                   *dst,
+    uint64_t              first,
+    uint64_t              count
+);
+
+/* @summary Write an N-dimensional array to an IDX file, replacing any existing file.
+ * @param path A nul-terminated, UTF-8 encoded string specifying the path of the file to write.
+ * @param type_code One of the values of the IDX_TYPE enumeration specifying the type of the elements in data.
+ * @param dimension_count The number of dimensions, in [1, IDX_MAX_DIMENSIONS].
+ * @param dimensions An array of dimension_count values specifying the size of each dimension, slowest-changing first.
+ * @param data The element data, stored row-major in host byte order.
+ * @return Zero if the file is written successfully, or -1 if an error occurred. Check errno for error information.
+ */
+MNIST_API(int)
+IdxFileWrite
+(
+    char const            *path,
+    uint32_t          type_code,
+    uint32_t    dimension_count,
+    uint32_t const  *dimensions,
+    void const            *data
+);
+
+#ifdef __cplusplus
+}; /* extern "C" */
+#endif
+
+#endif /* __IDXFILE_H__ */
+
@@ -0,0 +1,250 @@
+/**
+ * minibatch.h: Defines types and functions for assembling minibatches of
+ * training samples. Samples are gathered in shuffled order from a data set (or
+ * its float32 cache) into cache-aligned batch buffers. A producer can run the
+ * gather on a background thread, handing completed batches to the training
+ * loop through a bounded ring so that batch assembly overlaps computation.
+ * A batch can also carry a CSR encoding of its nonzero inputs, built during
+ * the gather, so that the first layer of a network can skip zero pixels.
+ */
+#ifndef __MINIBATCH_H__
+#define __MINIBATCH_H__
+
+#pragma once
+
+#ifndef MNIST_NO_INCLUDES
+#include <stddef.h>
+#include <stdint.h>
+#include "dataset.h"
+#include "datacache.h"
+#include "sparse.h"
+#endif
+
+#ifndef MNIST_API
+#   ifdef  MNIST_STATIC
+#       define MNIST_API(_return_type)                                         \
+            static _return_type
+#else
+#       define MNIST_API(_return_type)                                         \
+            extern _return_type
+#   endif
+#endif
+
+/* @summary Define various constants used internally within this module.
+ * MINIBATCH_ALIGNMENT: The alignment of the input buffer and of each input row in a batch, in bytes.
+ * MINIBATCH_MIN_RING_SIZE: The minimum number of batch buffers in a producer ring (double-buffering).
+ */
+#ifndef MINIBATCH_CONSTANTS
+#   define MINIBATCH_CONSTANTS
+#   define MINIBATCH_ALIGNMENT            64
+#   define MINIBATCH_MIN_RING_SIZE        2
+#endif
+
+/* @summary Define a set of flags that can be bitwise-OR'd together to control how a producer generates batches.
+ */
+typedef enum MINIBATCH_FLAGS {
+    MINIBATCH_FLAGS_NONE        = (0UL <<  0),                                 /* Samples are visited in data set order, and a short final batch is produced if needed. */
+    MINIBATCH_FLAG_SHUFFLE      = (1UL <<  0),                                 /* Samples are visited in a different random order each epoch. */
+    MINIBATCH_FLAG_DROP_LAST    = (1UL <<  1),                                 /* A final batch with fewer than BatchSize samples is not produced. */
+    MINIBATCH_FLAG_LOCK_MEMORY  = (1UL <<  2),                                 /* Batch buffers are locked into physical memory (best-effort). */
+    MINIBATCH_FLAG_SPARSE       = (1UL <<  3),                                 /* Batches are created with MinibatchCreateSparse and carry a CSR encoding of their nonzero inputs. */
+} MINIBATCH_FLAGS;
+
+/* @summary Define the data associated with a single minibatch.
+ * Input row i occupies Inputs[i * RowStride] through Inputs[i * RowStride + FeatureCount - 1]; any padding floats are zero.
+ */
+typedef struct MINIBATCH {
+    float                       *Inputs;                                       /* The input rows, MINIBATCH_ALIGNMENT-aligned, with dimensions [Capacity][RowStride]. */
+    uint8_t                     *Labels;                                       /* The label for each input row. */
+    uint32_t                    *Indices;                                      /* The index of each input row within the source data set. */
+    uint32_t                     SampleCount;                                  /* The number of valid rows in the batch. */
+    uint32_t                     Capacity;                                     /* The maximum number of rows the batch can hold. */
+    uint32_t                     FeatureCount;                                 /* The number of valid floats in each input row. */
+    uint32_t                     RowStride;                                    /* The distance between the start of consecutive input rows, in floats. */
+    uint32_t                     Epoch;                                        /* The zero-based epoch the batch belongs to. */
+    uint32_t                     BatchIndex;                                   /* The zero-based index of the batch within its epoch. */
+    SPARSE_CSR                   Nonzeros;                                     /* The nonzero inputs, with dimensions [SampleCount][FeatureCount]. All fields are zero unless the batch was created with MinibatchCreateSparse. */
+    SPARSE_CSR                   NonzerosByFeature;                            /* The transpose of Nonzeros, with dimensions [FeatureCount][SampleCount]. */
+    void                        *Memory;                                       /* The allocation backing the batch buffers, or NULL if the memory was supplied to MinibatchInitialize. */
+    size_t                       MemorySize;                                   /* The size of the memory backing the batch buffers, in bytes. */
+} MINIBATCH;
+
+/* @summary Define the source data from which minibatches are gathered.
+ * If Cache is non-NULL, pre-converted rows are copied from the cache; otherwise pixels are converted as y = (x * Scale) + Bias.
+ */
+typedef struct MINIBATCH_SOURCE {
+    MNIST_DATASET const         *Dataset;                                      /* The data set providing labels, and pixels if no cache is supplied. */
+    DATA_CACHE const            *Cache;                                        /* An optional float32 cache built from Dataset. */
+    float                        Scale;                                        /* The scale applied to each pixel value when converting from the data set. */
+    float                        Bias;                                         /* The bias added to each scaled pixel value when converting from the data set. */
+} MINIBATCH_SOURCE;
+
+/* @summary Define the configuration used to create a background minibatch producer.
+ */
+typedef struct MINIBATCH_PRODUCER_INIT {
+    MINIBATCH_SOURCE             Source;                                       /* The source data. Must remain valid until the producer is deleted. */
+    uint32_t                     BatchSize;                                    /* The maximum number of samples in each batch. */
+    uint32_t                     RingSize;                                     /* The number of batch buffers, at least MINIBATCH_MIN_RING_SIZE. */
+    uint32_t                     EpochCount;                                   /* The number of passes over the data set to produce, or zero to produce batches until the producer is deleted. */
+    uint32_t                     Flags;                                        /* One or more bitwise-OR'd values of the MINIBATCH_FLAGS enumeration. */
+    uint64_t                     Seed;                                         /* The seed for the shuffle random number generator. */
+} MINIBATCH_PRODUCER_INIT;
+
+/* @summary Forward-declare the opaque background producer type. Its layout is private to the platform implementation.
+ */
+struct MINIBATCH_PRODUCER;
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* @summary Allocate the buffers for a minibatch.
+ * @param o_batch The MINIBATCH to initialize. On failure, the structure is zero-initialized.
+ * @param capacity The maximum number of samples the batch can hold.
+ * @param feature_count The number of floats in each input row.
+ * @return Zero if the buffers are allocated successfully, or -1 if memory allocation failed.
+ */
+MNIST_API(int)
+MinibatchCreate
+(
+    struct MINIBATCH *o_batch,
+    uint32_t         capacity,
+    uint32_t    feature_count
+);
+
+/* @summary Allocate the buffers for a minibatch that also carries a CSR encoding of its nonzero inputs in Nonzeros, and its transpose in NonzerosByFeature.
+ * The encodings need space for every input to be nonzero, so a sparse batch uses about three times the memory of a dense batch.
+ * @param o_batch The MINIBATCH to initialize. On failure, the structure is zero-initialized.
+ * @param capacity The maximum number of samples the batch can hold.
+ * @param feature_count The number of floats in each input row.
+ * @return Zero if the buffers are allocated successfully, or -1 if memory allocation failed.
+ */
+MNIST_API(int)
+MinibatchCreateSparse
+(
+    struct MINIBATCH *o_batch,
+    uint32_t         capacity,
+    uint32_t    feature_count
+);
+
+/* @summary Compute the amount of memory required to hold the buffers for a minibatch.
+ * @param capacity The maximum number of samples the batch can hold.
+ * @param feature_count The number of floats in each input row.
+ * @param flags Zero, or MINIBATCH_FLAG_SPARSE to include space for the Nonzeros and NonzerosByFeature buffers.
+ * @return The required size, in bytes, of a MINIBATCH_ALIGNMENT-aligned block.
+ */
+MNIST_API(size_t)
+MinibatchMemorySize
+(
+    uint32_t      capacity,
+    uint32_t feature_count,
+    uint32_t         flags
+);
+
+/* @summary Initialize a minibatch whose buffers are carved from caller-supplied memory, such as an arena. The memory is zeroed.
+ * The caller retains ownership of the memory; MinibatchDelete need not be called, and does not free it.
+ * @param o_batch The MINIBATCH to initialize. On failure, the structure is zero-initialized.
+ * @param memory A MINIBATCH_ALIGNMENT-aligned block of at least MinibatchMemorySize(capacity, feature_count, flags) bytes.
+ * @param capacity The maximum number of samples the batch can hold.
+ * @param feature_count The number of floats in each input row.
+ * @param flags Zero, or MINIBATCH_FLAG_SPARSE to set up the Nonzeros and NonzerosByFeature buffers.
+ * @return Zero if the batch is initialized, or -1 if an argument is invalid.
+ */
+MNIST_API(int)
+MinibatchInitialize
+(
+    struct MINIBATCH *o_batch,
+    void              *memory,
+    uint32_t         capacity,
+    uint32_t    feature_count,
+    uint32_t            flags
+);
+
+/* @summary Free the buffers for a minibatch allocated with MinibatchCreate or MinibatchCreateSparse.
+ * @param batch The MINIBATCH to free. The structure is zero-initialized on return.
+ */
+MNIST_API(void)
+MinibatchDelete
+(
+    struct MINIBATCH *batch
+);
+
+/* @summary Gather a set of samples into a minibatch on the calling thread. If the batch was created with MinibatchCreateSparse, its Nonzeros and NonzerosByFeature are rebuilt.
+ * @param batch The MINIBATCH to fill. Its Capacity must be at least count, and its FeatureCount must match the source image size.
+ * @param source The data from which samples are gathered.
+ * @param indices An array of count sample indices within the source data set.
+ * @param count The number of samples to gather.
+ */
+MNIST_API(void)
+MinibatchGather
+(
+    struct MINIBATCH              *batch,
+    struct MINIBATCH_SOURCE const *source,
+    uint32_t const               *indices,
+    uint32_t                        count
+);
+
+/* @summary Randomly permute an array of sample indices using a Fisher-Yates shuffle.
+ * @param indices The array of indices to shuffle in-place.
+ * @param count The number of entries in the indices array.
+ * @param rng_state The state of the random number generator, updated on return. Must be non-zero.
+ */
+MNIST_API(void)
+MinibatchShuffle
+(
+    uint32_t   *indices,
+    uint32_t      count,
+    uint64_t *rng_state
+);
+
+/* @summary Create a producer that gathers minibatches on a background thread.
+ * @param o_producer On return, this location is updated with a pointer to the new producer, or NULL if an error occurred.
+ * @param init The producer configuration.
+ * @return Zero if the producer is created and its thread started, or -1 if an error occurred. Check errno for error information.
+ * errno is EINVAL if MINIBATCH_FLAG_DROP_LAST is set and BatchSize exceeds the number of samples, since no epoch could produce a batch.
+ */
+MNIST_API(int)
+MinibatchProducerCreate
+(
+    struct MINIBATCH_PRODUCER           **o_producer,
+    struct MINIBATCH_PRODUCER_INIT const      *init
+);
+
+/* @summary Stop a producer, wait for its thread to exit and free all of its batch buffers.
+ * Any batches acquired from the producer must not be used after this function is called.
+ * @param producer The producer to delete.
+ */
+MNIST_API(void)
+MinibatchProducerDelete
+(
+    struct MINIBATCH_PRODUCER *producer
+);
+
+/* @summary Wait for the next completed minibatch.
+ * Batches are returned in the order they were produced. Each acquired batch must be returned with MinibatchProducerRelease.
+ * @param producer The producer to wait on.
+ * @return A pointer to the completed batch, or NULL if all epochs have been produced and consumed.
+ */
+MNIST_API(struct MINIBATCH*)
+MinibatchProducerAcquire
+(
+    struct MINIBATCH_PRODUCER *producer
+);
+
+/* @summary Return a minibatch acquired from a producer so that its buffer can be refilled.
+ * @param producer The producer that returned the batch.
+ * @param batch The batch returned by MinibatchProducerAcquire.
+ */
+MNIST_API(void)
+MinibatchProducerRelease
+(
+    struct MINIBATCH_PRODUCER *producer,
+    struct MINIBATCH             *batch
+);
+
+#ifdef __cplusplus
+}; /* extern "C" */
+#endif
+
+#endif /* __MINIBATCH_H__ */
+
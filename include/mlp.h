@@ -0,0 +1,286 @@
+/**
+ * mlp.h: Defines types and functions for a multi-layer perceptron built from
+ * fully-connected layers. Hidden layers use ReLU and the output layer uses
+ * softmax with a cross-entropy loss. All of the dense arithmetic in the
+ * forward and backward passes is performed by GemmF32, or GemmF32Parallel
+ * when a task pool is attached to the network. When a minibatch carries a
+ * sparse encoding of its inputs, the first layer uses SparseGemmF32 instead.
+ * In mixed-precision mode, each layer also keeps a bfloat16 or float16 copy of
+ * its weights and hidden activations, which the GEMMs read in place of the
+ * float32 values. Products are accumulated in float32, and updates are applied
+ * to the float32 master weights before they are converted to the 16-bit copy.
+ */
+#ifndef __MLP_H__
+#define __MLP_H__
+
+#pragma once
+
+#ifndef MNIST_NO_INCLUDES
+#include <stddef.h>
+#include <stdint.h>
+#include "arena.h"
+#include "convert.h"
+#include "minibatch.h"
+#include "taskpool.h"
+#endif
+
+#ifndef MNIST_API
+#   ifdef  MNIST_STATIC
+#       define MNIST_API(_return_type)                                         \
+            static _return_type
+#else
+#       define MNIST_API(_return_type)                                         \
+            extern _return_type
+#   endif
+#endif
+
+/* @summary Define various constants used internally within this module.
+ * MLP_MAX_LAYERS: The maximum number of weight layers in a network.
+ * MLP_ALIGNMENT: The alignment of every parameter and activation buffer, in bytes.
+ * MLP_SPARSE_MAX_DENSITY: The largest fraction of nonzero inputs for which the first layer uses the sparse product rather than GEMM.
+ */
+#ifndef MLP_CONSTANTS
+#   define MLP_CONSTANTS
+#   define MLP_MAX_LAYERS                 8
+#   define MLP_ALIGNMENT                  64
+#   define MLP_SPARSE_MAX_DENSITY         0.3f
+#endif
+
+/* @summary Define the activation functions applied to the output of a layer.
+ */
+typedef enum MLP_ACTIVATION {
+    MLP_ACTIVATION_NONE         = 0,                                           /* The layer output is the affine transform of its input. */
+    MLP_ACTIVATION_RELU         = 1,                                           /* The layer output is max(0, x). */
+    MLP_ACTIVATION_SOFTMAX      = 2,                                           /* The layer output is a probability distribution over the outputs. */
+} MLP_ACTIVATION;
+
+/* @summary Define the parameters, gradients and per-batch state of a single fully-connected layer.
+ * The layer computes Outputs = activation(Inputs * Weights + Bias) for a batch of input rows.
+ * All matrices are row-major, and the padding columns of every matrix are kept zero.
+ */
+typedef struct MLP_LAYER {
+    float                       *Weights;                                      /* The weight matrix, with dimensions [InputCount][OutputStride]. */
+    float                       *Bias;                                         /* The bias vector, with OutputStride entries. */
+    float                       *WeightGrad;                                   /* The gradient of the loss with respect to Weights, with dimensions [InputCount][OutputStride]. */
+    float                       *BiasGrad;                                     /* The gradient of the loss with respect to Bias, with OutputStride entries. */
+    float                       *Outputs;                                      /* The activations from the last forward pass, with dimensions [count][OutputStride], allocated from the frame arena. In mixed-precision mode, the hidden layers share one scratch buffer and their activations are kept only in OutputsHalf. */
+    float                       *Deltas;                                       /* The gradient of the loss with respect to the pre-activation outputs, with dimensions [count][OutputStride], allocated from the frame arena. */
+    uint16_t                    *WeightsHalf;                                  /* In mixed-precision mode, the 16-bit copy of Weights read by the GEMMs, with dimensions [InputCount][OutputStride]. Otherwise NULL. */
+    uint16_t                    *OutputsHalf;                                  /* In mixed-precision mode, the 16-bit activations of a hidden layer, with dimensions [count][OutputStride], allocated from the frame arena. Otherwise NULL. */
+    uint32_t                     InputCount;                                   /* The number of inputs to the layer. */
+    uint32_t                     OutputCount;                                  /* The number of outputs from the layer. */
+    uint32_t                     OutputStride;                                 /* The distance between the start of consecutive rows of Weights, Outputs and Deltas, in floats. */
+    uint32_t                     Activation;                                   /* One of the values of the MLP_ACTIVATION enumeration. */
+} MLP_LAYER;
+
+/* @summary Define the state of a multi-layer perceptron.
+ */
+typedef struct MLP {
+    MLP_LAYER                    Layers[MLP_MAX_LAYERS];                       /* The weight layers, from input to output. */
+    uint32_t                     LayerCount;                                   /* The number of valid entries in Layers. */
+    uint32_t                     InputCount;                                   /* The number of features in each input row. */
+    uint32_t                     OutputCount;                                  /* The number of classes produced by the output layer. */
+    uint32_t                     MaxBatchSize;                                 /* The maximum number of rows in a single forward or backward pass. */
+    uint32_t                     Precision;                                    /* The storage format of the weights and activations read by the GEMMs, one of the values of the CONVERT_TYPE enumeration. */
+    float                       *Workspace;                                    /* The GEMM packing workspace, large enough for both GemmF32 and GemmF32Parallel. */
+    struct TASK_POOL            *TaskPool;                                     /* The task pool used to run GEMMs and evaluation in parallel, or NULL. */
+    MEMORY_ARENA                 Storage;                                      /* The arena backing the parameter, gradient and GEMM workspace buffers, sized exactly at creation. */
+    MEMORY_ARENA                 Frame;                                        /* The arena backing per-batch activations, deltas and evaluation scratch, reset at the start of each pass. */
+    MEMORY_ARENA                 HalfStorage;                                  /* The arena backing the 16-bit weight copies in mixed-precision mode, sized exactly by MlpSetPrecision. */
+} MLP;
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* @summary Allocate and initialize a network. Hidden layers use ReLU activation and the output layer uses softmax.
+ * Weights are initialized with He-uniform random values and biases are set to zero.
+ * @param o_mlp The MLP to initialize. On failure, the structure is zero-initialized.
+ * @param layer_sizes An array of size_count values. The first is the number of input features, the last is the number of classes, and any others are hidden layer widths.
+ * @param size_count The number of entries in layer_sizes, in [2, MLP_MAX_LAYERS + 1].
+ * @param max_batch_size The maximum number of rows in a single forward or backward pass.
+ * @param seed The seed for the weight initialization random number generator.
+ * @return Zero if the network is created, or -1 if an error occurred. Check errno for error information.
+ */
+MNIST_API(int)
+MlpCreate
+(
+    struct MLP              *o_mlp,
+    uint32_t const    *layer_sizes,
+    uint32_t            size_count,
+    uint32_t        max_batch_size,
+    uint64_t                  seed
+);
+
+/* @summary Free all memory associated with a network.
+ * @param mlp The MLP to free. The structure is zero-initialized on return.
+ */
+MNIST_API(void)
+MlpDelete
+(
+    struct MLP *mlp
+);
+
+/* @summary Attach a task pool to a network. Subsequent forward and backward passes split their GEMMs into tiles executed on the pool, and MlpEvaluate processes batches concurrently.
+ * The frame arena is grown here, if necessary, to hold evaluation scratch for every thread of the pool, so that no allocation occurs during training or evaluation.
+ * @param mlp The network.
+ * @param pool The task pool to use, or NULL to run on the calling thread. The pool must outlive the network, or be detached first.
+ * @return Zero if the pool is attached, or -1 if the frame arena could not be grown. On failure the network is unchanged.
+ */
+MNIST_API(int)
+MlpSetTaskPool
+(
+    struct MLP        *mlp,
+    struct TASK_POOL *pool
+);
+
+/* @summary Select the storage format of the weights and hidden activations read by the forward and backward passes.
+ * In a 16-bit format, the GEMMs widen their inputs to float32 as they pack them and accumulate in float32. Biases, gradients and the output layer activations remain float32.
+ * The float32 weights remain the master copy: MlpUpdate applies each step to them and then refreshes the 16-bit copy.
+ * The frame arena is grown here, if necessary, to hold the 16-bit activations.
+ * @param mlp The network, created by MlpCreate. Its current float32 weights are converted to the new format.
+ * @param precision One of the values of the CONVERT_TYPE enumeration. CONVERT_TYPE_F32 frees the 16-bit copies.
+ * @return Zero if the format is selected, or -1 if an error occurred. Check errno for error information. On failure the network is unchanged.
+ */
+MNIST_API(int)
+MlpSetPrecision
+(
+    struct MLP        *mlp,
+    uint32_t     precision
+);
+
+/* @summary Apply the activation function of a layer to a batch of pre-activation values.
+ * @param layer The layer whose activation function is applied.
+ * @param outputs The pre-activation values, with dimensions [count][OutputStride], updated in-place.
+ * @param count The number of rows in the batch.
+ */
+MNIST_API(void)
+MlpActivate
+(
+    struct MLP_LAYER const *layer,
+    float                *outputs,
+    uint32_t                count
+);
+
+/* @summary Run the forward pass for a batch of input rows. The class probabilities are available in the Outputs of the last layer.
+ * @param mlp The network to evaluate.
+ * @param inputs The input rows, with dimensions [count][input_stride].
+ * @param input_stride The distance between the start of consecutive input rows, in floats.
+ * @param count The number of input rows, at most MaxBatchSize.
+ */
+MNIST_API(void)
+MlpForward
+(
+    struct MLP           *mlp,
+    float const       *inputs,
+    uint32_t     input_stride,
+    uint32_t            count
+);
+
+/* @summary Run the backward pass for the batch most recently passed to MlpForward, computing the gradient of the mean cross-entropy loss for every layer.
+ * @param mlp The network.
+ * @param inputs The input rows passed to MlpForward.
+ * @param input_stride The distance between the start of consecutive input rows, in floats.
+ * @param labels The class label of each input row.
+ * @param count The number of input rows passed to MlpForward.
+ * @return The mean cross-entropy loss over the batch.
+ */
+MNIST_API(float)
+MlpBackward
+(
+    struct MLP           *mlp,
+    float const       *inputs,
+    uint32_t     input_stride,
+    uint8_t const     *labels,
+    uint32_t            count
+);
+
+/* @summary Apply a stochastic gradient descent step using the gradients from the most recent call to MlpBackward.
+ * In mixed-precision mode, the float32 master weights are updated and then converted to the 16-bit copy.
+ * @param mlp The network to update.
+ * @param learning_rate The step size.
+ */
+MNIST_API(void)
+MlpUpdate
+(
+    struct MLP           *mlp,
+    float       learning_rate
+);
+
+/* @summary Run the forward pass, backward pass and SGD update for a single minibatch.
+ * @param mlp The network to train.
+ * @param batch The minibatch. Its FeatureCount must equal the network InputCount and its SampleCount must not exceed MaxBatchSize.
+ * If the batch carries Nonzeros and at most MLP_SPARSE_MAX_DENSITY of its inputs are nonzero, the first layer skips the zero inputs.
+ * @param learning_rate The step size.
+ * @return The mean cross-entropy loss over the batch, computed before the update.
+ */
+MNIST_API(float)
+MlpTrainBatch
+(
+    struct MLP              *mlp,
+    struct MINIBATCH const *batch,
+    float           learning_rate
+);
+
+/* @summary Retrieve the most probable class for a row of the most recent forward pass.
+ * @param mlp The network.
+ * @param row The zero-based index of the row within the batch.
+ * @return The index of the output with the largest probability.
+ */
+MNIST_API(uint32_t)
+MlpPredict
+(
+    struct MLP const *mlp,
+    uint32_t          row
+);
+
+/* @summary Classify every sample of a data set and measure the accuracy and mean loss of the network.
+ * @param mlp The network to evaluate.
+ * Per-thread scratch is allocated from the frame arena, so the Outputs and Deltas of the last forward pass are invalidated.
+ * @param source The data to classify. Samples are gathered in data set order, MaxBatchSize at a time. If a task pool is attached, batches are classified concurrently.
+ * @param o_correct On return, set to the number of samples whose most probable class matches the label.
+ * @param o_loss If non-NULL, on return set to the mean cross-entropy loss over the data set.
+ * @return Zero if the evaluation completed, or -1 if the frame arena is too small for the attached task pool.
+ */
+MNIST_API(int)
+MlpEvaluate
+(
+    struct MLP                      *mlp,
+    struct MINIBATCH_SOURCE const *source,
+    uint32_t                    *o_correct,
+    float                          *o_loss
+);
+
+/* @summary Run one pass of asynchronous (Hogwild) stochastic gradient descent over a list of samples.
+ * Each thread of the attached task pool takes a disjoint slice of indices and trains on it in minibatches of batch_size samples,
+ * applying every update directly to the shared float32 weights without locks or a barrier between batches.
+ * When the first layer input is sparse, only the weight rows of the nonzero input features are written.
+ * Concurrent updates may overwrite one another; this is accepted by design, since the updates are small and rarely touch the same weights.
+ * Per-thread scratch is allocated from the frame arena, so the Outputs and Deltas of the last forward pass are invalidated.
+ * @param mlp The network to train. Its Precision must be CONVERT_TYPE_F32.
+ * @param source The training data.
+ * @param indices The zero-based indices of the samples to train on, typically shuffled with MinibatchShuffle.
+ * @param count The number of entries in indices.
+ * @param batch_size The number of samples in each minibatch, in [1, MaxBatchSize]. Small batches give more updates per pass.
+ * @param learning_rate The step size.
+ * @param o_loss If non-NULL, on return set to the mean cross-entropy loss over the samples, each computed before its own update.
+ * @return Zero if the pass completed, or -1 if an error occurred. Check errno for error information.
+ */
+MNIST_API(int)
+MlpTrainHogwild
+(
+    struct MLP                      *mlp,
+    struct MINIBATCH_SOURCE const *source,
+    uint32_t const               *indices,
+    uint32_t                        count,
+    uint32_t                   batch_size,
+    float                   learning_rate,
+    float                          *o_loss
+);
+
+#ifdef __cplusplus
+}; /* extern "C" */
+#endif
+
+#endif /* __MLP_H__ */
+
@@ -13,6 +13,7 @@
 #include <stddef.h>
 #include <stdint.h>
 #include "strlib.h"
+#include "arena.h"
 #endif
 
 #ifndef PATHLIB_API
@@ -28,11 +29,15 @@
 /* @summary Define various constants used internally within this module.
  * LINUX_PATH_STRING_MAX_CHARS: The maximum number of characters in a Linux-style path string, not including the nul-terminator.
  * WIN32_PATH_STRING_MAX_CHARS: The maximum number of characters in a Win32-style path string, not including the nul-terminator.
+ * PATH_BUFFER_MAX_BYTES: The size of every path buffer, in bytes, including the nul-terminator. A path string stored in a path buffer is limited to PATH_BUFFER_MAX_BYTES - 1 bytes of UTF-8.
+ * PATH_INTERN_INVALID_ID: The value returned in place of an id when a path is not found in a PATH_INTERN_TABLE.
  */
 #ifndef PATHLIB_CONSTANTS
 #   define PATHLIB_CONSTANTS
 #   define LINUX_PATH_STRING_MAX_CHARS    4095
 #   define WIN32_PATH_STRING_MAX_CHARS    4095
+#   define PATH_BUFFER_MAX_BYTES          4096
+#   define PATH_INTERN_INVALID_ID         0xFFFFFFFFU
 #endif
 
 /* @summary Define the data used to access the path components of a Linux-style path string.
@@ -65,6 +70,45 @@ typedef struct PATH_PARTS_WIN32 {
     uint32_t                     PathFlags;                                    /* One or more bitwise-OR'd values of the PATH_FLAGS enumeration. */
 } PATH_PARTS_WIN32;
 
+/* @summary Define the data used to access the path components of a set of Linux-style path strings parsed by LinuxPathStringParseBatch.
+ * The components are stored as structure-of-arrays. Each value is a byte offset from Base, and the fields correspond to those of PATH_PARTS_LINUX.
+ * Path i occupies Base[Root[i]] through its terminating nul; its filename component is Base[Filename[i]] through Base[FilenameEnd[i] - 1].
+ */
+typedef struct PATH_PARTS_LINUX_BATCH {
+    char8_t                     *Base;                                         /* The start of the packed strings the offsets refer to. */
+    uint32_t                    *Root;                                         /* The offset of the first character of each path root, which is the start of the path string. */
+    uint32_t                    *RootEnd;                                      /* The offset one-past the last character of each path root component. */
+    uint32_t                    *Path;                                         /* The offset of the first character of each directory tree component. */
+    uint32_t                    *PathEnd;                                      /* The offset one-past the last character of each directory tree component. */
+    uint32_t                    *Filename;                                     /* The offset of the first character of each filename component. */
+    uint32_t                    *FilenameEnd;                                  /* The offset one-past the last character of each filename component. */
+    uint32_t                    *Extension;                                    /* The offset of the first character of each file extension component. */
+    uint32_t                    *ExtensionEnd;                                 /* The offset one-past the last character of each file extension component. */
+    uint32_t                    *PathFlags;                                    /* One or more bitwise-OR'd values of the PATH_FLAGS enumeration for each path. */
+    uint32_t                     PathCount;                                    /* The number of paths parsed by the most recent call to LinuxPathStringParseBatch. */
+    uint32_t                     Capacity;                                     /* The maximum number of paths the batch can hold. */
+    void                        *Memory;                                       /* The allocation backing the arrays, or NULL if the memory was supplied to LinuxPathBatchInitialize. */
+    size_t                       MemorySize;                                   /* The size of the memory backing the arrays, in bytes. */
+} PATH_PARTS_LINUX_BATCH;
+
+/* @summary Define the data associated with a table of interned Linux-style path strings.
+ * Each distinct normalized path is stored once, nul-terminated, in a contiguous arena and identified by a 32-bit id assigned in insertion order.
+ * Ids remain valid, and the strings and parsed components never move, until the table is deleted.
+ */
+typedef struct PATH_INTERN_TABLE {
+    MEMORY_ARENA                 Strings;                                      /* The arena storing the normalized path strings. */
+    uint64_t                    *Slots;                                        /* The open-addressed hash table. Each slot stores the upper 32 bits of the hash and id + 1, or zero if the slot is empty. */
+    uint32_t                    *Offsets;                                      /* The byte offset of each path string within the Strings arena. */
+    uint32_t                    *Lengths;                                      /* The length of each path string, in bytes, not including the nul-terminator. */
+    uint32_t                    *Chars;                                        /* The length of each path string, in codepoints. */
+    PATH_PARTS_LINUX            *Parts;                                        /* The components of each path string, parsed when the path is first interned. */
+    uint32_t                     PathCount;                                    /* The number of paths interned. */
+    uint32_t                     Capacity;                                     /* The maximum number of paths the table can hold. */
+    uint32_t                     SlotMask;                                     /* The number of hash table slots, minus one. */
+    void                        *Memory;                                       /* The allocation backing the arrays. */
+    size_t                       MemorySize;                                   /* The size of the allocation backing the arrays, in bytes. */
+} PATH_INTERN_TABLE;
+
 /* @summary Define a set of flags that can be bitwise-OR'd together to specify attributes of a path string.
  */
 typedef enum PATH_FLAGS {
@@ -81,11 +125,6 @@ typedef enum PATH_FLAGS {
     PATH_FLAG_EXTENSION         = (1UL <<  9),                                 /* The path string has a file extension component. */
 } PATH_FLAGS;
 
-// Parse a path into a PATH_PARTS
-// Append one path fragment to another
-// Change the existing file extension in-place
-// Append a file extension
-
 #ifdef __cplusplus
 extern "C" {
 #endif
@@ -108,13 +147,13 @@ Win32PathStringGetMaxChars
     void
 );
 
-/* @summary Allocate a buffer for manipulating a Linux-style path string and optionally initialize the contents with an existing string.
- * The buffer can hold up to the number of characters returned by the LinuxPathStringGetMaxChars function, plus one for the terminating nul.
+/* @summary Allocate a buffer for manipulating a Linux-style path string from the heap and optionally initialize the contents with an existing string.
+ * The buffer is PATH_BUFFER_MAX_BYTES bytes. Use LinuxPathBufferInit or LinuxPathBufferCreateInArena to avoid the heap allocation.
  * @param o_strinfo Pointer to an optional STRING_INFO that if supplied will be initialized with the attributes of the returned string.
  * @param o_bufinfo Pointer to an optional STRING_INFO that if supplied will be initialized with the attributes of the returned buffer.
  * @param strinfo Pointer to an optional STRING_INFO that if supplied contains information about the string pointed to by strbuf.
  * @param strbuf Pointer to an optional UTF-8 encoded, nul-terminated string that will be used as the initial contents of the new buffer.
- * @return A pointer to the start of the allocated buffer, or NULL if memory allocation failed.
+ * @return A pointer to the start of the allocated buffer, or NULL if memory allocation failed or the initial string is longer than PATH_BUFFER_MAX_BYTES - 1 bytes (errno is ENAMETOOLONG).
  */
 PATHLIB_API(char8_t*)
 LinuxPathBufferCreate
@@ -125,13 +164,13 @@ LinuxPathBufferCreate
     char8_t const         *strbuf
 );
 
-/* @summary Allocate a buffer for manipulating a Win32-style path string and optionally initialize the contents with an existing string.
- * The buffer can hold up to the number of characters returned by the Win32PathStringGetMaxChars function, plus one for the terminating nul.
+/* @summary Allocate a buffer for manipulating a Win32-style path string from the heap and optionally initialize the contents with an existing string.
+ * The buffer is PATH_BUFFER_MAX_BYTES bytes. Use Win32PathBufferInit or Win32PathBufferCreateInArena to avoid the heap allocation.
  * @param o_strinfo Pointer to an optional STRING_INFO that if supplied will be initialized with the attributes of the returned string.
  * @param o_bufinfo Pointer to an optional STRING_INFO that if supplied will be initialized with the attributes of the returned buffer.
  * @param strinfo Pointer to an optional STRING_INFO that if supplied contains information about the string pointed to by strbuf.
  * @param strbuf Pointer to an optional UTF-16 encoded, nul-terminated string that will be used as the initial contents of the new buffer.
- * @return A pointer to the start of the allocated buffer, or NULL if memory allocation failed.
+ * @return A pointer to the start of the allocated buffer, or NULL if memory allocation failed or the initial string is longer than PATH_BUFFER_MAX_BYTES - 1 bytes (errno is ENAMETOOLONG).
  */
 PATHLIB_API(char8_t*)
 Win32PathBufferCreate
@@ -142,7 +181,82 @@ Win32PathBufferCreate
     char8_t const         *strbuf
 );
 
+/* @summary Initialize caller-provided storage, such as a local array, as a buffer for manipulating a Linux-style path string. No memory is allocated.
+ * @param o_strinfo Pointer to an optional STRING_INFO that if supplied will be initialized with the attributes of the returned string.
+ * @param o_bufinfo Pointer to an optional STRING_INFO that if supplied will be initialized with the attributes of the returned buffer.
+ * @param storage The storage for the path buffer, at least PATH_BUFFER_MAX_BYTES bytes.
+ * @param strinfo Pointer to an optional STRING_INFO that if supplied contains information about the string pointed to by strbuf.
+ * @param strbuf Pointer to an optional UTF-8 encoded, nul-terminated string that will be used as the initial contents of the buffer.
+ * @return The storage pointer, or NULL if storage is NULL (errno is EINVAL) or the initial string is longer than PATH_BUFFER_MAX_BYTES - 1 bytes (errno is ENAMETOOLONG).
+ */
+PATHLIB_API(char8_t*)
+LinuxPathBufferInit
+(
+    struct STRING_INFO *o_strinfo, 
+    struct STRING_INFO *o_bufinfo, 
+    char8_t              *storage, 
+    struct STRING_INFO   *strinfo, 
+    char8_t const         *strbuf
+);
+
+/* @summary Initialize caller-provided storage, such as a local array, as a buffer for manipulating a Win32-style path string. No memory is allocated.
+ * @param o_strinfo Pointer to an optional STRING_INFO that if supplied will be initialized with the attributes of the returned string.
+ * @param o_bufinfo Pointer to an optional STRING_INFO that if supplied will be initialized with the attributes of the returned buffer.
+ * @param storage The storage for the path buffer, at least PATH_BUFFER_MAX_BYTES bytes.
+ * @param strinfo Pointer to an optional STRING_INFO that if supplied contains information about the string pointed to by strbuf.
+ * @param strbuf Pointer to an optional UTF-8 encoded, nul-terminated string that will be used as the initial contents of the buffer.
+ * @return The storage pointer, or NULL if storage is NULL (errno is EINVAL) or the initial string is longer than PATH_BUFFER_MAX_BYTES - 1 bytes (errno is ENAMETOOLONG).
+ */
+PATHLIB_API(char8_t*)
+Win32PathBufferInit
+(
+    struct STRING_INFO *o_strinfo, 
+    struct STRING_INFO *o_bufinfo, 
+    char8_t              *storage, 
+    struct STRING_INFO   *strinfo, 
+    char8_t const         *strbuf
+);
+
+/* @summary Allocate a buffer for manipulating a Linux-style path string from a memory arena and optionally initialize the contents with an existing string.
+ * The buffer is released when the arena is reset; it must not be passed to PathBufferDelete.
+ * @param o_strinfo Pointer to an optional STRING_INFO that if supplied will be initialized with the attributes of the returned string.
+ * @param o_bufinfo Pointer to an optional STRING_INFO that if supplied will be initialized with the attributes of the returned buffer.
+ * @param arena The arena from which PATH_BUFFER_MAX_BYTES bytes are allocated.
+ * @param strinfo Pointer to an optional STRING_INFO that if supplied contains information about the string pointed to by strbuf.
+ * @param strbuf Pointer to an optional UTF-8 encoded, nul-terminated string that will be used as the initial contents of the new buffer.
+ * @return A pointer to the start of the buffer, or NULL if the arena is full (errno is ENOMEM) or the initial string is too long (errno is ENAMETOOLONG). Nothing is allocated on failure.
+ */
+PATHLIB_API(char8_t*)
+LinuxPathBufferCreateInArena
+(
+    struct STRING_INFO  *o_strinfo, 
+    struct STRING_INFO  *o_bufinfo, 
+    struct MEMORY_ARENA     *arena, 
+    struct STRING_INFO    *strinfo, 
+    char8_t const          *strbuf
+);
+
+/* @summary Allocate a buffer for manipulating a Win32-style path string from a memory arena and optionally initialize the contents with an existing string.
+ * The buffer is released when the arena is reset; it must not be passed to PathBufferDelete.
+ * @param o_strinfo Pointer to an optional STRING_INFO that if supplied will be initialized with the attributes of the returned string.
+ * @param o_bufinfo Pointer to an optional STRING_INFO that if supplied will be initialized with the attributes of the returned buffer.
+ * @param arena The arena from which PATH_BUFFER_MAX_BYTES bytes are allocated.
+ * @param strinfo Pointer to an optional STRING_INFO that if supplied contains information about the string pointed to by strbuf.
+ * @param strbuf Pointer to an optional UTF-8 encoded, nul-terminated string that will be used as the initial contents of the new buffer.
+ * @return A pointer to the start of the buffer, or NULL if the arena is full (errno is ENOMEM) or the initial string is too long (errno is ENAMETOOLONG). Nothing is allocated on failure.
+ */
+PATHLIB_API(char8_t*)
+Win32PathBufferCreateInArena
+(
+    struct STRING_INFO  *o_strinfo, 
+    struct STRING_INFO  *o_bufinfo, 
+    struct MEMORY_ARENA     *arena, 
+    struct STRING_INFO    *strinfo, 
+    char8_t const          *strbuf
+);
+
 /* @summary Free a path buffer returned by the LinuxPathBufferCreate or Win32PathBufferCreate functions.
+ * Buffers initialized with LinuxPathBufferInit, Win32PathBufferInit or allocated from an arena must not be passed to this function.
  * @param pathbuf The path buffer to free.
  */
 PATHLIB_API(void)
@@ -167,6 +281,153 @@ LinuxPathStringParse
     char8_t const            *strbuf
 );
 
+/* @summary Compute the amount of memory required to hold the arrays of a PATH_PARTS_LINUX_BATCH.
+ * @param capacity The maximum number of paths the batch can hold.
+ * @return The required size, in bytes.
+ */
+PATHLIB_API(size_t)
+LinuxPathBatchMemorySize
+(
+    uint32_t capacity
+);
+
+/* @summary Initialize a PATH_PARTS_LINUX_BATCH whose arrays are carved from caller-supplied memory, such as an arena.
+ * The caller retains ownership of the memory; LinuxPathBatchDelete need not be called, and does not free it.
+ * @param o_batch The PATH_PARTS_LINUX_BATCH to initialize. On failure, the structure is zero-initialized.
+ * @param memory A block of at least LinuxPathBatchMemorySize(capacity) bytes, aligned to at least four bytes.
+ * @param capacity The maximum number of paths the batch can hold.
+ * @return Zero if the batch is initialized, or -1 if an argument is invalid.
+ */
+PATHLIB_API(int)
+LinuxPathBatchInitialize
+(
+    struct PATH_PARTS_LINUX_BATCH *o_batch,
+    void                           *memory,
+    uint32_t                      capacity
+);
+
+/* @summary Allocate the arrays of a PATH_PARTS_LINUX_BATCH from the heap.
+ * @param o_batch The PATH_PARTS_LINUX_BATCH to initialize. On failure, the structure is zero-initialized.
+ * @param capacity The maximum number of paths the batch can hold.
+ * @return Zero if the batch is created, or -1 if an error occurred.
+ */
+PATHLIB_API(int)
+LinuxPathBatchCreate
+(
+    struct PATH_PARTS_LINUX_BATCH *o_batch,
+    uint32_t                      capacity
+);
+
+/* @summary Free the arrays of a PATH_PARTS_LINUX_BATCH allocated with LinuxPathBatchCreate.
+ * @param batch The PATH_PARTS_LINUX_BATCH to free. The structure is zero-initialized on return.
+ */
+PATHLIB_API(void)
+LinuxPathBatchDelete
+(
+    struct PATH_PARTS_LINUX_BATCH *batch
+);
+
+/* @summary Parse a set of packed Linux-style path strings in a single pass. Separators, dots and nul terminators are located a vector at a time.
+ * Each path is parsed exactly as LinuxPathStringParse would parse it, and backslashes are normalized to forward slashes in place.
+ * An empty string is recorded with PATH_FLAG_INVALID and does not stop the batch.
+ * @param batch The PATH_PARTS_LINUX_BATCH to fill. On return, PathCount is the number of paths parsed and Base is set to blob.
+ * @param o_consumed On return, the number of bytes of blob occupied by the parsed strings, including their nul terminators.
+ * Parsing stops when the batch is full; call again with blob + o_consumed to continue. Bytes after the last nul are not parsed.
+ * @param blob The packed path strings, each UTF-8 encoded and nul-terminated, stored one after another.
+ * @param blob_bytes The size of blob, in bytes. Must be less than 4 GB.
+ * @return Zero if the blob is parsed, or -1 if an argument is invalid.
+ */
+PATHLIB_API(int)
+LinuxPathStringParseBatch
+(
+    struct PATH_PARTS_LINUX_BATCH *batch,
+    size_t                    *o_consumed,
+    char8_t                          *blob,
+    size_t                      blob_bytes
+);
+
+/* @summary Allocate the arrays and string storage for a table of interned paths.
+ * @param o_table The PATH_INTERN_TABLE to initialize. On failure, the structure is zero-initialized.
+ * @param capacity The maximum number of distinct paths the table can hold.
+ * @param string_bytes The number of bytes reserved for the normalized path strings, including their nul-terminators. Must be less than 4 GB.
+ * @return Zero if the table is created, or -1 if an error occurred. Check errno for error information.
+ */
+PATHLIB_API(int)
+LinuxPathInternTableCreate
+(
+    struct PATH_INTERN_TABLE *o_table,
+    uint32_t                 capacity,
+    size_t               string_bytes
+);
+
+/* @summary Free the memory associated with a table of interned paths. Every id, string and set of components returned by the table becomes invalid.
+ * @param table The PATH_INTERN_TABLE to delete. The structure is zero-initialized on return.
+ */
+PATHLIB_API(void)
+LinuxPathInternTableDelete
+(
+    struct PATH_INTERN_TABLE *table
+);
+
+/* @summary Retrieve the id of a path string, adding it to the table if it is not already present.
+ * The path is normalized as by LinuxPathBufferAppend before it is hashed, so paths that differ only in separators, '.' or '..' components receive the same id.
+ * @param o_id On return, the id of the path, or PATH_INTERN_INVALID_ID if an error occurred.
+ * @param table The table of interned paths. The table may not be modified concurrently with any other operation.
+ * @param strinfo Optional information about the path string strbuf that, if supplied, is used as an optimization.
+ * @param strbuf The nul-terminated, UTF-8 encoded path string.
+ * @return Zero if the id is returned, or -1 if an error occurred. errno is ENAMETOOLONG if the normalized path does not fit in a path buffer, ENOSPC if the table is full, or ENOMEM if the string storage is full.
+ */
+PATHLIB_API(int)
+LinuxPathIntern
+(
+    uint32_t                    *o_id,
+    struct PATH_INTERN_TABLE   *table,
+    struct STRING_INFO       *strinfo,
+    char8_t const             *strbuf
+);
+
+/* @summary Retrieve the id of a path string without adding it to the table. The path is normalized as by LinuxPathIntern.
+ * @param o_id On return, the id of the path, or PATH_INTERN_INVALID_ID if the path is not in the table.
+ * @param table The table of interned paths.
+ * @param strinfo Optional information about the path string strbuf that, if supplied, is used as an optimization.
+ * @param strbuf The nul-terminated, UTF-8 encoded path string.
+ * @return Zero if the path was found, or -1 if the path is not in the table (errno is ENOENT) or cannot be normalized.
+ */
+PATHLIB_API(int)
+LinuxPathInternFind
+(
+    uint32_t                    *o_id,
+    struct PATH_INTERN_TABLE   *table,
+    struct STRING_INFO       *strinfo,
+    char8_t const             *strbuf
+);
+
+/* @summary Retrieve the normalized path string associated with an id.
+ * @param o_strinfo Pointer to an optional STRING_INFO that if supplied will be initialized with the attributes of the string.
+ * @param table The table of interned paths.
+ * @param id An id returned by LinuxPathIntern.
+ * @return A pointer to the nul-terminated path string, or NULL if id is not valid.
+ */
+PATHLIB_API(char8_t const*)
+LinuxPathInternString
+(
+    struct STRING_INFO     *o_strinfo,
+    struct PATH_INTERN_TABLE   *table,
+    uint32_t                       id
+);
+
+/* @summary Retrieve the components of the normalized path string associated with an id. The components were parsed once, when the path was interned.
+ * @param table The table of interned paths.
+ * @param id An id returned by LinuxPathIntern.
+ * @return A pointer to the components of the path, which point into the table's string storage, or NULL if id is not valid.
+ */
+PATHLIB_API(PATH_PARTS_LINUX const*)
+LinuxPathInternParts
+(
+    struct PATH_INTERN_TABLE *table,
+    uint32_t                     id
+);
+
 /* @summary Parse a Win32-style path string into its constituient parts.
  * @param o_parts The PATH_PARTS_WIN32 structure to populate.
  * @oaran o_strinfo Pointer to an optional STRING_INFO that if supplied will be initialized with the attributes of the input string.
@@ -183,13 +444,16 @@ Win32PathStringParse
     char8_t const            *strbuf
 );
 
-/* @summary Append one path fragment to another.
+/* @summary Append one path fragment to another and normalize the result in a single pass over the bytes.
+ * Both '/' and '\\' are accepted as separators and written as '/'. Duplicate separators and '.' components are removed, and '..' removes the preceding component.
+ * Leading '..' components are kept for relative paths and dropped at the root of absolute paths. A fragment starting with a separator replaces the existing path.
+ * The result never has a trailing separator unless it is the root, and an empty relative result is ".".
  * @param o_dstinfo Pointer to an optional STRING_INFO that if supplied will be initialized with the attributes of the destination string buffer after the path fragment is appended.
  * @param dstinfo Optional information about the destination string buffer dstbuf that, if supplied, is used as an optimization.
  * @param appinfo Optional information about the path fragment to append that, if supplied, is used as an optimization.
- * @param dstbuf The buffer, returned by LinuxPathBufferCreate, to which the path fragment will be appended. If this value is NULL, a new path buffer is allocated and initialized with the contents of appstr.
+ * @param dstbuf A path buffer of PATH_BUFFER_MAX_BYTES bytes, returned by LinuxPathBufferCreate or initialized in caller or arena storage, to which the path fragment will be appended. If this value is NULL, a new path buffer is allocated from the heap and initialized with the contents of appstr.
  * @param appstr The path fragment to append to the path fragment stored in dstbuf.
- * @return A pointer to the destination path buffer (or the allocated path buffer, if dstbuf is NULL), or NULL if an error occurred.
+ * @return A pointer to the destination path buffer (or the allocated path buffer, if dstbuf is NULL), or NULL if an error occurred. If the result would not fit, errno is ENAMETOOLONG and dstbuf is not modified.
  */
 PATHLIB_API(char8_t*)
 LinuxPathBufferAppend
@@ -201,13 +465,16 @@ LinuxPathBufferAppend
     char8_t const         *appstr
 );
 
-/* @summary Append one path fragment to another.
+/* @summary Append one path fragment to another and normalize the result in a single pass over the bytes.
+ * Both '/' and '\\' are accepted as separators and written as '\\'. Duplicate separators and '.' components are removed, and '..' removes the preceding component.
+ * The root - a drive letter, a UNC server and share, or a device or long path prefix and its first component - is never removed. A fragment with a root replaces the existing path.
+ * The result never has a trailing separator unless it is the root, and an empty relative result is ".".
  * @param o_dstinfo Pointer to an optional STRING_INFO that if supplied will be initialized with the attributes of the destination string buffer after the path fragment is appended.
  * @param dstinfo Optional information about the destination string buffer dstbuf that, if supplied, is used as an optimization.
  * @param appinfo Optional information about the path fragment to append that, if supplied, is used as an optimization.
- * @param dstbuf The buffer, returned by Win32PathBufferCreate, to which the path fragment will be appended. If this value is NULL, a new path buffer is allocated and initialized with the contents of appstr.
+ * @param dstbuf A path buffer of PATH_BUFFER_MAX_BYTES bytes, returned by Win32PathBufferCreate or initialized in caller or arena storage, to which the path fragment will be appended. If this value is NULL, a new path buffer is allocated from the heap and initialized with the contents of appstr.
  * @param appstr The path fragment to append to the path fragment stored in dstbuf.
- * @return A pointer to the destination path buffer (or the allocated path buffer, if dstbuf is NULL), or NULL if an error occurred.
+ * @return A pointer to the destination path buffer (or the allocated path buffer, if dstbuf is NULL), or NULL if an error occurred. If the result would not fit, errno is ENAMETOOLONG and dstbuf is not modified.
  */
 PATHLIB_API(char8_t*)
 Win32PathBufferAppend
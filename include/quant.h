@@ -0,0 +1,195 @@
+/**
+ * quant.h: Defines types and functions for running inference with an int8
+ * quantized copy of a trained multi-layer perceptron. Weights are quantized
+ * symmetrically with one scale per output channel, and the activation scale of
+ * each layer is calibrated by running the float network over a slice of the
+ * training set. Activations are stored as unsigned 7-bit values so that every
+ * dot-product kernel - scalar, AVX2 pmaddubsw, and VNNI vpdpbusd - produces
+ * identical 32-bit sums. The first layer reads 8-bit pixels directly; the
+ * pixel normalization of the calibration source is folded into its scales.
+ */
+#ifndef __QUANT_H__
+#define __QUANT_H__
+
+#pragma once
+
+#ifndef MNIST_NO_INCLUDES
+#include <stddef.h>
+#include <stdint.h>
+#include "arena.h"
+#include "minibatch.h"
+#include "mlp.h"
+#include "taskpool.h"
+#endif
+
+#ifndef MNIST_API
+#   ifdef  MNIST_STATIC
+#       define MNIST_API(_return_type)                                         \
+            static _return_type
+#else
+#       define MNIST_API(_return_type)                                         \
+            extern _return_type
+#   endif
+#endif
+
+/* @summary Define various constants used internally within this module.
+ * QUANT_MR, QUANT_NR: The dimensions of the tile of the int32 product computed by one call to a dot-product kernel.
+ * QUANT_KR: The number of consecutive inputs multiplied and summed into each int32 lane (the vpdpbusd group size).
+ * QUANT_ALIGNMENT: The alignment of every weight and activation buffer, in bytes.
+ * QUANT_ACTIVATION_MAX: The largest quantized activation value. 127 * 127 * 2 fits in the int16 intermediate of pmaddubsw.
+ * QUANT_WEIGHT_MAX: The largest magnitude of a quantized weight.
+ */
+#ifndef QUANT_CONSTANTS
+#   define QUANT_CONSTANTS
+#   define QUANT_MR                       4
+#   define QUANT_NR                       32
+#   define QUANT_KR                       4
+#   define QUANT_ALIGNMENT                64
+#   define QUANT_ACTIVATION_MAX           127
+#   define QUANT_WEIGHT_MAX               127
+#endif
+
+/* @summary Define identifiers for the available implementations of the int8 dot-product kernel.
+ */
+typedef enum QUANT_KERNEL {
+    QUANT_KERNEL_SCALAR          = 0,                                          /* Portable C kernel. */
+    QUANT_KERNEL_AVX2            = 1,                                          /* AVX2 kernel using vpmaddubsw and vpmaddwd. */
+    QUANT_KERNEL_AVXVNNI         = 2,                                          /* AVX-VNNI kernel using the VEX-encoded vpdpbusd on ymm registers. */
+    QUANT_KERNEL_AVX512VNNI      = 3,                                          /* AVX-512 VNNI kernel using vpdpbusd on zmm registers. */
+    QUANT_KERNEL_COUNT           = 4,                                          /* The number of kernel identifiers. */
+} QUANT_KERNEL;
+
+/* @summary Define the parameters of a single quantized fully-connected layer.
+ * The layer computes Sum[j] = Inputs[i] * Weights[i][j] over i in 32-bit integers, then Outputs[j] = (Sum[j] * Multiplier[j]) + Bias[j] in float.
+ * Hidden layers apply ReLU and requantize their outputs as round(Outputs[j] / OutputScale), clamped to [0, QUANT_ACTIVATION_MAX].
+ */
+typedef struct QUANT_LAYER {
+    int8_t                      *Weights;                                      /* The quantized weights, packed as [OutputStride / QUANT_NR][GroupCount][QUANT_NR][QUANT_KR]. */
+    float                       *Multiplier;                                   /* InputScale times the weight scale of each output channel, with OutputStride entries. */
+    float                       *Bias;                                         /* The float bias of each output channel, with OutputStride entries. */
+    float                        InputScale;                                   /* The real value represented by one step of a quantized input. */
+    float                        OutputScale;                                  /* The real value represented by one step of a quantized output, or zero for the output layer. */
+    uint32_t                     InputCount;                                   /* The number of inputs to the layer. */
+    uint32_t                     OutputCount;                                  /* The number of outputs from the layer. */
+    uint32_t                     GroupCount;                                   /* The number of QUANT_KR-input groups in the dot product, ceil(InputCount / QUANT_KR). Padding weights are zero. */
+    uint32_t                     InputStride;                                  /* The distance between the start of consecutive rows of quantized inputs, in bytes. A multiple of QUANT_ALIGNMENT. */
+    uint32_t                     OutputStride;                                 /* The number of output channels including padding. A multiple of QUANT_NR. */
+} QUANT_LAYER;
+
+/* @summary Define the state of a quantized multi-layer perceptron.
+ */
+typedef struct QUANT_MLP {
+    QUANT_LAYER                  Layers[MLP_MAX_LAYERS];                       /* The quantized layers, from input to output. */
+    uint8_t                      PixelTable[256];                              /* Maps each 8-bit pixel value to its quantized first-layer input. */
+    uint32_t                     LayerCount;                                   /* The number of valid entries in Layers. */
+    uint32_t                     InputCount;                                   /* The number of pixels in each input row. */
+    uint32_t                     OutputCount;                                  /* The number of classes produced by the output layer. */
+    uint32_t                     MaxBatchSize;                                 /* The maximum number of rows in a single call to QuantMlpClassify. */
+    struct TASK_POOL            *TaskPool;                                     /* The task pool used to run evaluation in parallel, or NULL. */
+    MEMORY_ARENA                 Storage;                                      /* The arena backing the weights, multipliers and biases, sized exactly at creation. */
+    MEMORY_ARENA                 Frame;                                        /* The arena backing per-thread activation scratch. */
+} QUANT_MLP;
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* @summary Calibrate and quantize a trained network.
+ * The float network is run over the first calibration_count samples of the calibration source, and the largest output of each hidden layer sets its activation scale.
+ * Weights are quantized with one scale per output channel, the largest weight magnitude of the channel divided by QUANT_WEIGHT_MAX.
+ * @param o_qmlp The QUANT_MLP to initialize. On failure, the structure is zero-initialized.
+ * @param mlp The trained network. The activations of its last forward pass are overwritten.
+ * @param calibration The calibration data, typically the training set. Its Scale and Bias are folded into the first layer, and must be those used to train the network.
+ * @param calibration_count The number of samples to calibrate on, clamped to the size of the data set.
+ * @return Zero if the network is quantized, or -1 if an error occurred. Check errno for error information.
+ */
+MNIST_API(int)
+QuantMlpCreate
+(
+    struct QUANT_MLP                   *o_qmlp,
+    struct MLP                            *mlp,
+    struct MINIBATCH_SOURCE const *calibration,
+    uint32_t                 calibration_count
+);
+
+/* @summary Free all memory associated with a quantized network.
+ * @param qmlp The QUANT_MLP to free. The structure is zero-initialized on return.
+ */
+MNIST_API(void)
+QuantMlpDelete
+(
+    struct QUANT_MLP *qmlp
+);
+
+/* @summary Attach a task pool to a quantized network. Subsequent calls to QuantMlpEvaluate classify batches concurrently.
+ * The frame arena is grown here, if necessary, to hold scratch for every thread of the pool.
+ * @param qmlp The quantized network.
+ * @param pool The task pool to use, or NULL to run on the calling thread. The pool must outlive the network, or be detached first.
+ * @return Zero if the pool is attached, or -1 if the frame arena could not be grown. On failure the network is unchanged.
+ */
+MNIST_API(int)
+QuantMlpSetTaskPool
+(
+    struct QUANT_MLP *qmlp,
+    struct TASK_POOL *pool
+);
+
+/* @summary Classify a batch of 8-bit images on the calling thread.
+ * @param qmlp The quantized network.
+ * @param pixels The images, each InputCount pixels, with dimensions [count][pixel_stride].
+ * @param pixel_stride The distance between the start of consecutive images, in bytes.
+ * @param count The number of images, at most MaxBatchSize.
+ * @param o_classes On return, the most probable class of each image, count entries.
+ */
+MNIST_API(void)
+QuantMlpClassify
+(
+    struct QUANT_MLP     *qmlp,
+    uint8_t const      *pixels,
+    size_t        pixel_stride,
+    uint32_t             count,
+    uint8_t         *o_classes
+);
+
+/* @summary Classify every sample of a data set with a quantized network and measure its accuracy and mean loss.
+ * @param qmlp The quantized network.
+ * @param source The data to classify. Pixels are read from the data set; the Cache, Scale and Bias fields are ignored.
+ * @param o_correct On return, set to the number of samples whose most probable class matches the label.
+ * @param o_loss If non-NULL, on return set to the mean cross-entropy loss over the data set.
+ * @return Zero if the evaluation completed, or -1 if the frame arena is too small for the attached task pool.
+ */
+MNIST_API(int)
+QuantMlpEvaluate
+(
+    struct QUANT_MLP                *qmlp,
+    struct MINIBATCH_SOURCE const *source,
+    uint32_t                    *o_correct,
+    float                          *o_loss
+);
+
+/* @summary Select the dot-product kernel used by subsequent calls to QuantMlpClassify and QuantMlpEvaluate.
+ * This is intended for testing and benchmarking. By default, the fastest kernel supported by the host is used.
+ * @param kernel One of the values of the QUANT_KERNEL enumeration.
+ * @return Zero if the kernel is selected, or -1 if the kernel is not supported by the host CPU.
+ */
+MNIST_API(int)
+QuantSelectKernel
+(
+    uint32_t kernel
+);
+
+/* @summary Retrieve a short name for a kernel identifier, for use in reports.
+ * @param kernel One of the values of the QUANT_KERNEL enumeration.
+ * @return A nul-terminated string such as "avx512vnni".
+ */
+MNIST_API(char const*)
+QuantKernelName
+(
+    uint32_t kernel
+);
+
+#ifdef __cplusplus
+}; /* extern "C" */
+#endif
+
+#endif /* __QUANT_H__ */
@@ -0,0 +1,159 @@
+/**
+ * sparse.h: Defines types and functions for multiplying a sparse matrix, held
+ * in compressed sparse row (CSR) form, by a dense row-major matrix. This is
+ * used for the first layer of a network, where most input pixels are zero and
+ * the work of a dense GEMM is dominated by multiplications by zero.
+ */
+#ifndef __SPARSE_H__
+#define __SPARSE_H__
+
+#pragma once
+
+#ifndef MNIST_NO_INCLUDES
+#include <stddef.h>
+#include <stdint.h>
+#include "taskpool.h"
+#endif
+
+#ifndef MNIST_API
+#   ifdef  MNIST_STATIC
+#       define MNIST_API(_return_type)                                         \
+            static _return_type
+#else
+#       define MNIST_API(_return_type)                                         \
+            extern _return_type
+#   endif
+#endif
+
+/* @summary Define various constants used internally within this module.
+ * SPARSE_TILE_M, SPARSE_TILE_N: The dimensions of the tile of C computed by one task of a parallel product.
+ */
+#ifndef SPARSE_CONSTANTS
+#   define SPARSE_CONSTANTS
+#   define SPARSE_TILE_M                  32
+#   define SPARSE_TILE_N                  64
+#endif
+
+/* @summary Define identifiers for the available implementations of the sparse product kernels.
+ */
+typedef enum SPARSE_KERNEL {
+    SPARSE_KERNEL_SCALAR         = 0,                                          /* Portable C implementation. */
+    SPARSE_KERNEL_AVX2           = 1,                                          /* AVX2 and FMA implementation, accumulating 64 columns of C in registers. */
+    SPARSE_KERNEL_COUNT          = 2,                                          /* The number of kernel identifiers. */
+} SPARSE_KERNEL;
+
+/* @summary Define a sparse matrix in compressed sparse row form.
+ * The nonzero values of row i are Values[RowOffsets[i]] through Values[RowOffsets[i + 1] - 1], with column indices in the same positions of Columns.
+ * RowOffsets holds absolute positions, so a contiguous range of rows can be viewed by offsetting RowOffsets and reducing RowCount.
+ */
+typedef struct SPARSE_CSR {
+    uint32_t                    *RowOffsets;                                   /* The position of the first nonzero of each row, with RowCount + 1 entries. */
+    uint32_t                    *Columns;                                      /* The column index of each nonzero value. */
+    float                       *Values;                                       /* The nonzero values. */
+    uint32_t                     RowCount;                                     /* The number of rows in the matrix. */
+    uint32_t                     ColumnCount;                                  /* The number of columns in the matrix. */
+    uint32_t                     NonzeroCount;                                 /* The total number of nonzero values, RowOffsets[RowCount] - RowOffsets[0]. */
+} SPARSE_CSR;
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* @summary Append the nonzero values of a dense row to the column and value arrays of a CSR matrix.
+ * @param columns The destination for the column index of each nonzero, with space for count entries.
+ * @param values The destination for each nonzero value, with space for count entries.
+ * @param src The dense row.
+ * @param count The number of values in the dense row.
+ * @return The number of nonzero values written.
+ */
+MNIST_API(uint32_t)
+SparseEncodeRowF32
+(
+    uint32_t * __restrict columns,
+    float    * __restrict  values,
+    float const *             src,
+    uint32_t                count
+);
+
+/* @summary Build the transpose of a CSR matrix. The column indices within each row of the transpose are sorted.
+ * Multiplying by the transpose without a transpose flag accumulates each row of C in registers, which is faster than scattering with GEMM_OP_TRANSPOSE.
+ * @param dst The transpose. On entry, RowOffsets must have space for src->ColumnCount + 1 entries, and Columns and Values for src->NonzeroCount entries.
+ * On return, every other field is set.
+ * @param src The matrix to transpose.
+ */
+MNIST_API(void)
+SparseTranspose
+(
+    struct SPARSE_CSR       *dst,
+    struct SPARSE_CSR const *src
+);
+
+/* @summary Compute C = op(A) * B + beta * C, where A is a sparse matrix and B and C are dense and row-major.
+ * If trans_a is GEMM_OP_NONE, C has a->RowCount rows and B has a->ColumnCount rows.
+ * If trans_a is GEMM_OP_TRANSPOSE, C has a->ColumnCount rows and B has a->RowCount rows.
+ * @param trans_a Zero to use A, or non-zero to use its transpose.
+ * @param n The number of columns in B and C.
+ * @param a The sparse matrix.
+ * @param b The dense matrix B.
+ * @param ldb The distance between the start of consecutive rows of B, in floats.
+ * @param beta The scale applied to C. If zero, C is not read.
+ * @param c The dense matrix C.
+ * @param ldc The distance between the start of consecutive rows of C, in floats.
+ */
+MNIST_API(void)
+SparseGemmF32
+(
+    uint32_t            trans_a,
+    uint32_t                  n,
+    struct SPARSE_CSR const  *a,
+    float const              *b,
+    uint32_t                ldb,
+    float                  beta,
+    float                    *c,
+    uint32_t                ldc
+);
+
+/* @summary Compute C = op(A) * B + beta * C using the threads of a task pool.
+ * Without a transpose, SPARSE_TILE_M x SPARSE_TILE_N tiles of C are computed in parallel; with a transpose, the rows of C are scattered, so SPARSE_TILE_N column strips are computed in parallel.
+ * Arguments other than pool are the same as for SparseGemmF32. If pool is NULL or has a single thread, this is equivalent to SparseGemmF32.
+ * @param pool The task pool to execute on. May be NULL.
+ */
+MNIST_API(void)
+SparseGemmF32Parallel
+(
+    struct TASK_POOL       *pool,
+    uint32_t            trans_a,
+    uint32_t                  n,
+    struct SPARSE_CSR const  *a,
+    float const              *b,
+    uint32_t                ldb,
+    float                  beta,
+    float                    *c,
+    uint32_t                ldc
+);
+
+/* @summary Select the kernel used by subsequent sparse products.
+ * @param kernel One of the values of the SPARSE_KERNEL enumeration.
+ * @return Zero if the kernel is selected, or -1 if the host CPU does not support it (errno is set to ENOTSUP).
+ */
+MNIST_API(int)
+SparseSelectKernel
+(
+    uint32_t kernel
+);
+
+/* @summary Retrieve a short display name for a sparse product kernel.
+ * @param kernel One of the values of the SPARSE_KERNEL enumeration.
+ * @return A pointer to a static, nul-terminated string.
+ */
+MNIST_API(char const*)
+SparseKernelName
+(
+    uint32_t kernel
+);
+
+#ifdef __cplusplus
+}; /* extern "C" */
+#endif
+
+#endif /* __SPARSE_H__ */
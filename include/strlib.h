@@ -74,6 +74,34 @@ typedef enum TEXT_ENCODING {
     TEXT_ENCODING_UTF32_LSB      =  5,                                         /* The text encoding was determined to be UTF-32 with the least-significant bit first (little endian). */
 } TEXT_ENCODING;
 
+/* @summary Define identifiers for the available implementations of the UTF-8 kernels used by Utf8StringValidate and the Utf8Transcode* functions.
+ */
+typedef enum UTF8_KERNEL {
+    UTF8_KERNEL_SCALAR           =  0,                                         /* Portable C implementation, one codepoint at a time. */
+    UTF8_KERNEL_SSSE3            =  1,                                         /* SSSE3 implementation using pshufb table lookups, 16 bytes per iteration; SSE2 ASCII transcoding. */
+    UTF8_KERNEL_AVX2             =  2,                                         /* AVX2 implementation using pshufb table lookups, 32 bytes per iteration; AVX2 ASCII transcoding. */
+    UTF8_KERNEL_COUNT            =  3,                                         /* The number of kernel identifiers. */
+} UTF8_KERNEL;
+
+/* @summary Define identifiers for the available implementations of the base64 encoding and decoding kernels.
+ */
+typedef enum BASE64_KERNEL {
+    BASE64_KERNEL_SCALAR         =  0,                                         /* Portable C implementation, one group of three bytes at a time. */
+    BASE64_KERNEL_SSSE3          =  1,                                         /* SSSE3 implementation using pshufb, 12 bytes (16 characters) per iteration. */
+    BASE64_KERNEL_AVX2           =  2,                                         /* AVX2 implementation using pshufb, 24 bytes (32 characters) per iteration. */
+    BASE64_KERNEL_COUNT          =  3,                                         /* The number of kernel identifiers. */
+} BASE64_KERNEL;
+
+/* @summary Define the state carried between the chunks of an incremental base64 encode or decode.
+ * Initialize the structure with Base64StreamInit before the first chunk.
+ */
+typedef struct BASE64_STREAM {
+    uint8_t                      Carry[4];                                     /* Input bytes (encoding) or 6-bit values (decoding) that do not yet form a complete group. */
+    uint32_t                     CarryCount;                                   /* The number of valid entries in Carry. */
+    uint32_t                     PadCount;                                     /* Decoding only: the number of padding characters in the current group. */
+    uint32_t                     Finished;                                     /* Decoding only: non-zero once a padded group has been decoded. No further input is accepted. */
+} BASE64_STREAM;
+
 #ifdef __cplusplus
 extern "C" {
 #endif
@@ -209,6 +237,90 @@ Utf8StringConvertToUtf32
     char8_t const         *strbuf
 );
 
+/* @summary Convert UTF-8 text to UTF-16 in a single pass into a caller-provided buffer. Runs of ASCII are converted a vector at a time. Supplementary-plane codepoints are written as surrogate pairs.
+ * @param o_numdst On return, this location is updated with the number of UTF-16 code units written to the destination buffer, including the terminating nul.
+ * If dst is NULL and max_dst is zero, the call returns zero and this location is updated with the exact number of UTF-16 code units required, including the nul.
+ * @param dst Pointer to the buffer to which the nul-terminated UTF-16 text will be written.
+ * @param max_dst The maximum number of UTF-16 code units that can be written to the destination buffer.
+ * @param src Pointer to the UTF-8 source text.
+ * @param num_src The number of bytes to convert. Specify zero if the source is nul-terminated and the length should be computed.
+ * @return Zero if the text is converted, or -1 if an error occurred.
+ * errno is ENOBUFS if the destination buffer is too small, in which case o_numdst receives zero and the contents of dst are undefined.
+ * errno is EILSEQ if the source is not well-formed UTF-8, in which case o_numdst receives the number of UTF-16 code units converted before the error.
+ */
+STRLIB_API(int)
+Utf8TranscodeToUtf16
+(
+    size_t         * __restrict o_numdst,
+    char16_t       * __restrict      dst,
+    size_t                       max_dst,
+    char8_t const  * __restrict      src,
+    size_t                       num_src
+);
+
+/* @summary Convert UTF-8 text to UTF-32 in a single pass into a caller-provided buffer. Runs of ASCII are converted a vector at a time. 
+ * @param o_numdst On return, this location is updated with the number of UTF-32 code units written to the destination buffer, including the terminating nul.
+ * If dst is NULL and max_dst is zero, the call returns zero and this location is updated with the exact number of UTF-32 code units required, including the nul.
+ * @param dst Pointer to the buffer to which the nul-terminated UTF-32 text will be written.
+ * @param max_dst The maximum number of UTF-32 code units that can be written to the destination buffer.
+ * @param src Pointer to the UTF-8 source text.
+ * @param num_src The number of bytes to convert. Specify zero if the source is nul-terminated and the length should be computed.
+ * @return Zero if the text is converted, or -1 if an error occurred.
+ * errno is ENOBUFS if the destination buffer is too small, in which case o_numdst receives zero and the contents of dst are undefined.
+ * errno is EILSEQ if the source is not well-formed UTF-8, in which case o_numdst receives the number of UTF-32 code units converted before the error.
+ */
+STRLIB_API(int)
+Utf8TranscodeToUtf32
+(
+    size_t         * __restrict o_numdst,
+    char32_t       * __restrict      dst,
+    size_t                       max_dst,
+    char8_t const  * __restrict      src,
+    size_t                       num_src
+);
+
+/* @summary Convert UTF-16 text to UTF-8 in a single pass into a caller-provided buffer. Runs of ASCII are converted a vector at a time. Surrogate pairs are combined; an unpaired surrogate is an error.
+ * @param o_numdst On return, this location is updated with the number of bytes written to the destination buffer, including the terminating nul.
+ * If dst is NULL and max_dst is zero, the call returns zero and this location is updated with the exact number of bytes required, including the nul.
+ * @param dst Pointer to the buffer to which the nul-terminated UTF-8 text will be written.
+ * @param max_dst The maximum number of bytes that can be written to the destination buffer.
+ * @param src Pointer to the UTF-16 source text.
+ * @param num_src The number of UTF-16 code units to convert. Specify zero if the source is nul-terminated and the length should be computed.
+ * @return Zero if the text is converted, or -1 if an error occurred.
+ * errno is ENOBUFS if the destination buffer is too small, in which case o_numdst receives zero and the contents of dst are undefined.
+ * errno is EILSEQ if the source is not well-formed UTF-16, in which case o_numdst receives the number of bytes converted before the error.
+ */
+STRLIB_API(int)
+Utf8TranscodeFromUtf16
+(
+    size_t         * __restrict o_numdst,
+    char8_t        * __restrict      dst,
+    size_t                       max_dst,
+    char16_t const * __restrict      src,
+    size_t                       num_src
+);
+
+/* @summary Convert UTF-32 text to UTF-8 in a single pass into a caller-provided buffer. Runs of ASCII are converted a vector at a time. Surrogate codepoints and values above U+10FFFF are errors.
+ * @param o_numdst On return, this location is updated with the number of bytes written to the destination buffer, including the terminating nul.
+ * If dst is NULL and max_dst is zero, the call returns zero and this location is updated with the exact number of bytes required, including the nul.
+ * @param dst Pointer to the buffer to which the nul-terminated UTF-8 text will be written.
+ * @param max_dst The maximum number of bytes that can be written to the destination buffer.
+ * @param src Pointer to the UTF-32 source text.
+ * @param num_src The number of UTF-32 code units to convert. Specify zero if the source is nul-terminated and the length should be computed.
+ * @return Zero if the text is converted, or -1 if an error occurred.
+ * errno is ENOBUFS if the destination buffer is too small, in which case o_numdst receives zero and the contents of dst are undefined.
+ * errno is EILSEQ if the source is not well-formed UTF-32, in which case o_numdst receives the number of bytes converted before the error.
+ */
+STRLIB_API(int)
+Utf8TranscodeFromUtf32
+(
+    size_t         * __restrict o_numdst,
+    char8_t        * __restrict      dst,
+    size_t                       max_dst,
+    char32_t const * __restrict      src,
+    size_t                       num_src
+);
+
 /* @summary Free a string buffer allocated by Utf8StringCreate or any of the Utf8StringCreateFrom* functions.
  * @param strbuf A pointer to a string buffer returned by Utf8StringCreate or any of the Utf8StringCreateFrom* functions.
  */
@@ -269,6 +381,42 @@ Utf8StringInfo
     char8_t const         *strbuf
 );
 
+/* @summary Validate a nul-terminated UTF-8 string and measure its length in a single pass, independent of the current locale.
+ * Overlong encodings, surrogate codepoints (U+D800-U+DFFF), codepoints above U+10FFFF and truncated or unexpected continuation bytes are rejected.
+ * The string is read in aligned blocks, so bytes past the terminating nul, but within the same 32-byte block, may be read.
+ * @param o_bytecount On return, this location is updated with the number of bytes in the string, not including the terminating nul. May be NULL.
+ * @param o_charcount On return, this location is updated with the number of bytes that are not continuation bytes. For a valid string this is the number of codepoints. May be NULL.
+ * @param strbuf Pointer to the start of a nul-terminated string.
+ * @return Zero if the string is valid UTF-8, or -1 if it is not (errno is set to EILSEQ). The counts are set in either case.
+ */
+STRLIB_API(int)
+Utf8StringValidate
+(
+    size_t   *o_bytecount,
+    size_t   *o_charcount,
+    char8_t const *strbuf
+);
+
+/* @summary Select the kernel used by subsequent calls to Utf8StringValidate and the Utf8Transcode* functions. By default the fastest kernel supported by the host is used.
+ * @param kernel One of the values of the UTF8_KERNEL enumeration.
+ * @return Zero if the kernel is selected, or -1 if the host CPU does not support it (errno is set to ENOTSUP).
+ */
+STRLIB_API(int)
+Utf8SelectKernel
+(
+    uint32_t kernel
+);
+
+/* @summary Retrieve a short display name for a UTF-8 validation kernel.
+ * @param kernel One of the values of the UTF8_KERNEL enumeration.
+ * @return A pointer to a static, nul-terminated string such as "avx2".
+ */
+STRLIB_API(char const*)
+Utf8KernelName
+(
+    uint32_t kernel
+);
+
 /* @summary Compare two UTF-8 encoded, nul-terminated strings.
  * @param a A pointer to the start of the first codepoint of a nul-terminated, UTF-8 encoded string.
  * @param b A pointer to the start of the first codepoint of a nul-terminated, UTF-8 encoded string.
@@ -282,6 +430,8 @@ Utf8StringCompare
 );
 
 /* @summary Compare two UTF-8 encoded, nul-terminated strings, ignoring case differences.
+ * Codepoints are converted to lower case with a table lookup and compared by value. Runs of ASCII are compared a vector at a time using the kernel selected with Utf8SelectKernel.
+ * An invalid sequence compares as the end of the string.
  * @param a A pointer to the start of the first codepoint of a nul-terminated, UTF-8 encoded string.
  * @param b A pointer to the start of the first codepoint of a nul-terminated, UTF-8 encoded string.
  * @return Zero if the strings compare as identical, a negative value if a appears lexographically before b, or a positive value if b appears lexographically before a.
@@ -293,6 +443,26 @@ Utf8StringCompareNoCase
     char8_t const *b
 );
 
+/* @summary Compute the case-folded key of a UTF-8 encoded, nul-terminated string, for use when the same strings are compared many times, for example when sorting.
+ * The key is the string with each codepoint converted to lower case, re-encoded as UTF-8. The key ends at the first invalid sequence, and is never longer than the source.
+ * For any strings a and b, Utf8StringCompare applied to their keys has the same sign as Utf8StringCompareNoCase applied to a and b, and keys are equal exactly when the strings compare equal.
+ * @param o_numdst On return, this location is updated with the number of bytes written to the destination buffer, including the terminating nul.
+ * If dst is NULL, the call returns zero and this location is updated with the exact number of bytes required, including the nul.
+ * @param dst Pointer to the buffer to which the nul-terminated key will be written.
+ * @param max_dst The maximum number of bytes that can be written to the destination buffer. strlen(src) + 1 bytes is always sufficient.
+ * @param src Pointer to the nul-terminated UTF-8 source text.
+ * @return Zero if the key is computed, or -1 if an error occurred.
+ * errno is ENOBUFS if the destination buffer is too small, in which case o_numdst receives zero and the contents of dst are undefined.
+ */
+STRLIB_API(int)
+Utf8StringFoldCase
+(
+    size_t  *o_numdst,
+    char8_t      *dst,
+    size_t    max_dst,
+    char8_t const *src
+);
+
 /* @summary Given a pointer to the start of a UTF-8 codepoint, return a pointer to the start of the next codepoint.
  * @param o_codepoint On return, this location is updated with the value stored in the codepoint at bufitr.
  * @param o_bytecount On return, this location is updated with the number of bytes required to represent the codepoint stored at bufitr.
@@ -429,6 +599,107 @@ Base64Decode
     size_t                   num_src
 );
 
+/* @summary Select the implementation used by Base64Encode, Base64Decode and the streaming functions.
+ * By default, the fastest kernel supported by the host CPU is used.
+ * @param kernel One of the values of the BASE64_KERNEL enumeration.
+ * @return Zero if the kernel is selected, or -1 if the kernel is not supported by the host CPU (errno is set to ENOTSUP).
+ */
+STRLIB_API(int)
+Base64SelectKernel
+(
+    uint32_t kernel
+);
+
+/* @summary Retrieve a short name for a base64 kernel, for display purposes.
+ * @param kernel One of the values of the BASE64_KERNEL enumeration.
+ * @return A pointer to a nul-terminated string constant.
+ */
+STRLIB_API(char const*)
+Base64KernelName
+(
+    uint32_t kernel
+);
+
+/* @summary Reset the state of an incremental base64 encode or decode.
+ * @param stream The stream state to initialize.
+ */
+STRLIB_API(void)
+Base64StreamInit
+(
+    struct BASE64_STREAM *stream
+);
+
+/* @summary Base64-encode the next chunk of a data stream. Complete groups of three bytes are encoded; up to two remaining bytes are carried to the next call.
+ * The output is not nul-terminated and contains no padding until Base64EncodeStreamFinal is called.
+ * @param stream The stream state.
+ * @param o_numdst On return, this location is updated with the number of bytes written to the destination buffer.
+ * If dst is NULL and max_dst is zero, the call returns zero and this location is updated with the number of bytes required to encode the chunk.
+ * @param dst Pointer to the buffer to which the base64-encoded data will be written.
+ * @param max_dst The maximum number of bytes that can be written to the destination buffer.
+ * @param src Pointer to the chunk of source data.
+ * @param num_src The number of bytes in the chunk.
+ * @return Zero if the chunk is encoded, or -1 if the destination buffer is too small (errno is set to ENOBUFS and the stream state is unchanged).
+ */
+STRLIB_API(int)
+Base64EncodeStreamUpdate
+(
+    struct BASE64_STREAM   *stream,
+    size_t     * __restrict o_numdst,
+    void       * __restrict      dst,
+    size_t                   max_dst,
+    void const * __restrict      src,
+    size_t                   num_src
+);
+
+/* @summary Complete an incremental base64 encode by writing the padded final group, if any. The output is not nul-terminated.
+ * @param stream The stream state. The stream is reset on successful return.
+ * @param o_numdst On return, this location is updated with the number of bytes written to the destination buffer, either zero or four.
+ * @param dst Pointer to the buffer to which the final group will be written.
+ * @param max_dst The maximum number of bytes that can be written to the destination buffer.
+ * @return Zero if the stream is completed, or -1 if the destination buffer is too small (errno is set to ENOBUFS).
+ */
+STRLIB_API(int)
+Base64EncodeStreamFinal
+(
+    struct BASE64_STREAM *stream,
+    size_t             *o_numdst,
+    void                    *dst,
+    size_t               max_dst
+);
+
+/* @summary Decode the next chunk of a base64-encoded stream. Chunks may be split at any character; incomplete groups are carried to the next call.
+ * @param stream The stream state.
+ * @param o_numdst On return, this location is updated with the number of bytes written to the destination buffer.
+ * If dst is NULL and max_dst is zero, the call returns zero and this location is updated with the maximum number of bytes the chunk can decode to.
+ * @param dst Pointer to the buffer to which the decoded data will be written.
+ * @param max_dst The maximum number of bytes that can be written to the destination buffer.
+ * @param src Pointer to the chunk of base64-encoded data.
+ * @param num_src The number of bytes in the chunk.
+ * @return Zero if the chunk is decoded, or -1 if an error occurred.
+ * errno is ENOBUFS if the destination buffer is too small, in which case the stream state is unchanged.
+ * errno is EILSEQ if the chunk contains a character outside the base64 alphabet, misplaced padding, or data after the final padded group; o_numdst receives the number of bytes decoded before the error.
+ */
+STRLIB_API(int)
+Base64DecodeStreamUpdate
+(
+    struct BASE64_STREAM   *stream,
+    size_t     * __restrict o_numdst,
+    void       * __restrict      dst,
+    size_t                   max_dst,
+    void const * __restrict      src,
+    size_t                   num_src
+);
+
+/* @summary Complete an incremental base64 decode, checking that the stream did not end in the middle of a group.
+ * @param stream The stream state. The stream is reset on successful return.
+ * @return Zero if the stream ended on a group boundary, or -1 if the input was truncated (errno is set to EILSEQ).
+ */
+STRLIB_API(int)
+Base64DecodeStreamFinal
+(
+    struct BASE64_STREAM *stream
+);
+
 #ifdef __cplusplus
 }; /* extern "C" */
 #endif
@@ -0,0 +1,130 @@
+/**
+ * taskpool.h: Defines types and functions for a work-stealing task pool that
+ * executes data-parallel loops. Each thread owns a deque of index ranges; a
+ * thread splits its range in half repeatedly, pushing one half onto its own
+ * deque, while idle threads steal the oldest (largest) ranges from others.
+ */
+#ifndef __TASKPOOL_H__
+#define __TASKPOOL_H__
+
+#pragma once
+
+#ifndef MNIST_NO_INCLUDES
+#include <stddef.h>
+#include <stdint.h>
+#endif
+
+#ifndef MNIST_API
+#   ifdef  MNIST_STATIC
+#       define MNIST_API(_return_type)                                         \
+            static _return_type
+#else
+#       define MNIST_API(_return_type)                                         \
+            extern _return_type
+#   endif
+#endif
+
+/* @summary Define various constants used internally within this module.
+ * TASK_POOL_MAX_THREADS: The maximum number of threads in a pool, including the thread that submits work.
+ * TASK_POOL_DEQUE_CAPACITY: The number of ranges each per-thread deque can hold. Must be a power of two.
+ */
+#ifndef TASK_POOL_CONSTANTS
+#   define TASK_POOL_CONSTANTS
+#   define TASK_POOL_MAX_THREADS          256
+#   define TASK_POOL_DEQUE_CAPACITY       256
+#endif
+
+/* @summary Define a set of flags that can be bitwise-OR'd together to control the behavior of a task pool.
+ */
+typedef enum TASK_POOL_FLAGS {
+    TASK_POOL_FLAGS_NONE        = (0UL <<  0),                                 /* Worker threads may run on any processor. */
+    TASK_POOL_FLAG_PIN_THREADS  = (1UL <<  0),                                 /* Worker thread i is pinned to logical processor i. The submitting thread is not pinned. */
+} TASK_POOL_FLAGS;
+
+/* @summary Define the configuration used to create a task pool.
+ */
+typedef struct TASK_POOL_INIT {
+    uint32_t                     ThreadCount;                                  /* The number of threads that execute work, including the submitting thread, or zero for one per logical processor. */
+    uint32_t                     Flags;                                        /* One or more bitwise-OR'd values of the TASK_POOL_FLAGS enumeration. */
+} TASK_POOL_INIT;
+
+/* @summary Define the signature of the function called to process a range of loop indices.
+ * @param argp The opaque argument supplied to TaskPoolParallelFor.
+ * @param begin The first index in the range.
+ * @param end One past the last index in the range.
+ * @param thread_index The zero-based index of the calling thread within the pool, in [0, ThreadCount). The submitting thread has index zero.
+ */
+typedef void (*TASK_RANGE_FUNC)
+(
+    void          *argp,
+    uint32_t      begin,
+    uint32_t        end,
+    uint32_t thread_index
+);
+
+/* @summary Forward-declare the opaque task pool type.
+ */
+struct TASK_POOL;
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* @summary Create a task pool and start its worker threads. Worker threads sleep while no work is submitted.
+ * @param o_pool On return, this location is updated with a pointer to the new pool, or NULL if an error occurred.
+ * @param init The pool configuration.
+ * @return Zero if the pool is created, or -1 if an error occurred. Check errno for error information.
+ */
+MNIST_API(int)
+TaskPoolCreate
+(
+    struct TASK_POOL          **o_pool,
+    struct TASK_POOL_INIT const *init
+);
+
+/* @summary Stop the worker threads of a task pool and free its resources.
+ * No call to TaskPoolParallelFor may be in progress.
+ * @param pool The pool to delete.
+ */
+MNIST_API(void)
+TaskPoolDelete
+(
+    struct TASK_POOL *pool
+);
+
+/* @summary Retrieve the number of threads that execute work submitted to a pool, including the submitting thread.
+ * @param pool The pool to query. May be NULL.
+ * @return The number of threads, or one if pool is NULL.
+ */
+MNIST_API(uint32_t)
+TaskPoolThreadCount
+(
+    struct TASK_POOL const *pool
+);
+
+/* @summary Execute func over the index range [0, count) using all of the threads in a pool, and wait for completion.
+ * The calling thread participates in the work. Ranges passed to func contain at least one and, unless count is smaller, roughly grain indices.
+ * If pool is NULL, or the call is made from within a function executing on the pool, func is called once for the whole range on the calling thread.
+ * Calls from different threads are serialized.
+ * @param pool The pool to execute on. May be NULL.
+ * @param count The number of loop indices.
+ * @param grain The number of indices below which a range is not split further. Zero is treated as one.
+ * @param func The function to call for each range.
+ * @param argp An opaque argument passed through to func.
+ */
+MNIST_API(void)
+TaskPoolParallelFor
+(
+    struct TASK_POOL *pool,
+    uint32_t         count,
+    uint32_t         grain,
+    TASK_RANGE_FUNC   func,
+    void             *argp
+);
+
+#ifdef __cplusplus
+}; /* extern "C" */
+#endif
+
+#endif /* __TASKPOOL_H__ */
+
@@ -0,0 +1,2543 @@
+#include <stddef.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <math.h>
+
+#include "cpuinfo.h"
+#include "cnn.h"
+#include "convert.h"
+#include "gemm.h"
+#include "dataset.h"
+#include "datacache.h"
+#include "idxfile.h"
+#include "minibatch.h"
+#include "mlp.h"
+#include "quant.h"
+#include "sparse.h"
+#include "taskpool.h"
+#include "strlib.h"
+#include "pathlib.h"
+#include "dirscan.h"
+
+#ifdef _WIN32
+#include <Windows.h>
+#define END_OF_LINE    "\r\n"
+#else
+#include <time.h>
+#define END_OF_LINE    "\n"
+#endif
+
+/* @summary Define the number of synthetic samples converted by the conversion benchmark.
+ * This matches the size of the MNIST training set.
+ */
+#ifndef BENCH_SAMPLE_COUNT
+#define BENCH_SAMPLE_COUNT            60000
+#endif
+
+/* @summary Define the number of features in each synthetic sample.
+ */
+#ifndef BENCH_FEATURE_COUNT
+#define BENCH_FEATURE_COUNT           784
+#endif
+
+/* @summary Define the number of times each benchmark is repeated. The fastest repetition is reported.
+ */
+#ifndef BENCH_REPEAT_COUNT
+#define BENCH_REPEAT_COUNT            10
+#endif
+
+/* @summary Define the number of samples in each batch for the gather benchmark.
+ */
+#ifndef BENCH_BATCH_SIZE
+#define BENCH_BATCH_SIZE              128
+#endif
+
+/* @summary Define the shapes (M, N, K) timed by the GEMM benchmark.
+ * The last four are the products computed when training a 784-256-10 network on batches of 128 samples.
+ */
+static uint32_t const BENCH_GEMM_SHAPES[][3] = {
+    {  256,  256,  256 },
+    {  512,  512,  512 },
+    { 1024, 1024, 1024 },
+    {  128,  256,  784 },
+    {  128,  784,  256 },
+    {  784,  256,  128 },
+    {  128,   10,  256 },
+};
+
+/* @summary Define the shapes (M, N, K) checked against a naive GEMM. They are not multiples of the register or cache blocking,
+ * so every kernel sees partial micro-tiles and more than one GEMM_MC or GEMM_KC block.
+ */
+static uint32_t const BENCH_GEMM_CHECK_SHAPES[][3] = {
+    {    1,    1,    1 },
+    {    7,   17,    5 },
+    {   37,   61,  300 },
+    {  150,   70,   33 },
+    {   97,  130,  517 },
+};
+
+/* @summary Define the number of threads in the pool used to check GemmF32Parallel. It is fixed, rather than one per
+ * logical processor, so that the parallel packing and tiling run even on a single-processor host.
+ */
+#ifndef BENCH_GEMM_CHECK_THREADS
+#define BENCH_GEMM_CHECK_THREADS      3
+#endif
+
+/* @summary Define the input densities timed by the sparse product benchmark. About 19% of MNIST pixels are nonzero.
+ */
+static float const BENCH_SPARSE_DENSITIES[] = {
+    0.10f, 0.19f, 0.35f, 0.50f
+};
+
+/* @summary Define the number of outputs of the first layer timed by the sparse product benchmark.
+ */
+#ifndef BENCH_SPARSE_OUTPUTS
+#define BENCH_SPARSE_OUTPUTS          256
+#endif
+
+/* @summary Define the shape of the network trained by the end-to-end benchmark. This matches the defaults of the train program.
+ */
+#ifndef BENCH_TRAIN_DEFAULTS
+#   define BENCH_TRAIN_DEFAULTS
+#   define BENCH_TRAIN_HIDDEN             256
+#   define BENCH_TRAIN_RING_SIZE          4
+#   define BENCH_TRAIN_LEARNING_RATE      0.1f
+#   define BENCH_TRAIN_SEED               0x2545F4914F6CDD1DULL
+#   define BENCH_TRAIN_CALIBRATION_COUNT  2048
+#   define BENCH_TRAIN_HOGWILD_BATCH      16
+#endif
+
+/* @summary Define the shapes of the networks timed by the mixed-precision benchmark.
+ * The trained network has hidden layers whose weights do not fit in the L2 cache, but with BENCH_BATCH_SIZE rows each weight is used
+ * for enough multiplies that training is bound by arithmetic rather than memory. The forward pass is also timed with a batch of
+ * BENCH_MIXED_FORWARD_BATCH rows on a wider network, where reading the weights dominates and the 16-bit copies halve the bytes read.
+ */
+#ifndef BENCH_MIXED_DEFAULTS
+#   define BENCH_MIXED_DEFAULTS
+#   define BENCH_MIXED_HIDDEN             1024
+#   define BENCH_MIXED_BATCH_COUNT        20
+#   define BENCH_MIXED_LEARNING_RATE      0.01f
+#   define BENCH_MIXED_FORWARD_HIDDEN     4096
+#   define BENCH_MIXED_FORWARD_BATCH      8
+#   define BENCH_MIXED_FORWARD_COUNT      10
+#endif
+
+/* @summary Define the number of batches timed in each repetition of the convolution benchmark.
+ */
+#ifndef BENCH_CONV_BATCH_COUNT
+#define BENCH_CONV_BATCH_COUNT        2
+#endif
+
+/* @summary Define the largest absolute difference allowed between the first-batch activations or weight gradients of a convolution kernel and the scalar kernel,
+ * or of the Winograd path and direct convolution.
+ */
+#ifndef BENCH_CONV_MAX_DIFF
+#define BENCH_CONV_MAX_DIFF           1.0e-4f
+#endif
+
+/* @summary Define the layers of the LeNet-style network timed by the convolution benchmark. This matches the lenet model of the train program.
+ */
+static CNN_LAYER_DESC const BENCH_CONV_LAYERS[] = {
+    { CNN_LAYER_CONV   ,  8, 5, 2 },
+    { CNN_LAYER_MAXPOOL,  0, 2, 0 },
+    { CNN_LAYER_CONV   , 16, 5, 0 },
+    { CNN_LAYER_MAXPOOL,  0, 2, 0 },
+};
+
+/* @summary Define the layers of the network of 3x3 convolutions timed by the convolution algorithm benchmark. This matches the vgg model of the train program.
+ */
+static CNN_LAYER_DESC const BENCH_CONV3_LAYERS[] = {
+    { CNN_LAYER_CONV   , 16, 3, 1 },
+    { CNN_LAYER_CONV   , 16, 3, 1 },
+    { CNN_LAYER_MAXPOOL,  0, 2, 0 },
+    { CNN_LAYER_CONV   , 32, 3, 1 },
+    { CNN_LAYER_MAXPOOL,  0, 2, 0 },
+};
+
+/* @summary Define a file path checked by the shard name check of the directory scan benchmark, and the shard index it should be classified with.
+ */
+typedef struct BENCH_SHARD_NAME {
+    char const                  *Path;                                         /* The file path. */
+    int32_t                      ShardIndex;                                   /* The expected shard index, or -1 if the path does not name a shard. */
+} BENCH_SHARD_NAME;
+
+/* @summary Define the paths checked by the shard name check, including the float caches written next to the image files.
+ */
+static BENCH_SHARD_NAME const BENCH_SHARD_NAMES[] = {
+    { "/data/mnist/train-images-idx3-ubyte"                ,  0 },
+    { "/data/mnist/train-images-idx3-ubyte.f32cache"       , -1 },
+    { "/data/mnist/t10k-labels.idx1-ubyte.0003"            ,  3 },
+    { "/data/mnist/t10k-labels-idx1-ubyte-12"              , 12 },
+    { "/data/mnist/shard-0007/train-images-idx3-ubyte"     ,  7 },
+    { "/data/mnist/shard-0007/train-images-idx3-ubyte.gz"  , -1 },
+    { "/data/mnist/train-images-idx3-ubyte.3a"             , -1 },
+    { "/data/mnist/train-images-idx3-ubyte."               , -1 },
+};
+
+/* @summary Define the sizes of the inputs to the string and path benchmarks.
+ * BENCH_TEXT_BYTES: The size of the UTF-8 text and the binary data used by the string benchmarks.
+ * BENCH_PATH_COUNT: The number of distinct path strings parsed by the path benchmark.
+ * BENCH_BASE64_BYTES: The size of the binary data encoded and decoded by the base64 benchmark.
+ * BENCH_BASE64_CHUNK: The size of the chunks passed to the streaming base64 functions.
+ */
+#ifndef BENCH_STRING_DEFAULTS
+#   define BENCH_STRING_DEFAULTS
+#   define BENCH_TEXT_BYTES               (1024 * 1024)
+#   define BENCH_PATH_COUNT               4096
+#   define BENCH_BASE64_BYTES             (16 * 1024 * 1024)
+#   define BENCH_BASE64_CHUNK             (64 * 1024)
+#endif
+
+/* @summary Define the array written and read back by the IDX round-trip benchmark. The dimensions are odd so that the byte-swapping kernels see partial vectors.
+ */
+static uint32_t const BENCH_IDX_DIMENSIONS[] = { 61, 127, 131 };
+
+/* @summary Define the path of the scratch file written by the IDX round-trip benchmark, relative to the working directory. It is deleted on return.
+ */
+#ifndef BENCH_IDX_SCRATCH_PATH
+#define BENCH_IDX_SCRATCH_PATH        "bench_idx_roundtrip.tmp"
+#endif
+
+/* @summary Define the default name of the file that receives machine-readable results.
+ */
+#ifndef BENCH_DEFAULT_OUTPUT
+#define BENCH_DEFAULT_OUTPUT          "bench_output.txt"
+#endif
+
+/* @summary Define the compiler flags recorded in the results file. The Makefile passes the flags used to build the program.
+ */
+#ifndef BENCH_BUILD_FLAGS
+#define BENCH_BUILD_FLAGS             "unknown"
+#endif
+
+/* @summary The file receiving machine-readable results, or NULL if results are only printed.
+ */
+static FILE *Global_BenchOutput = NULL;
+
+/* @summary Read a monotonic clock.
+ * @return The current time, in seconds, relative to an arbitrary epoch.
+ */
+static double
+TimestampSeconds
+(
+    void
+)
+{
+#ifdef _WIN32
+    LARGE_INTEGER freq;
+    LARGE_INTEGER  now;
+    QueryPerformanceFrequency(&freq);
+    QueryPerformanceCounter(&now);
+    return (double) now.QuadPart / (double) freq.QuadPart;
+#else
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double) ts.tv_sec + ((double) ts.tv_nsec * 1.0e-9);
+#endif
+}
+
+/* @summary Write one measurement to the results file as a tab-separated record: suite, name, value, unit.
+ * @param suite The benchmark group, for example "gemm".
+ * @param name The measurement name within the group. Must not contain tabs or spaces.
+ * @param value The measured value.
+ * @param unit The unit of value, for example "ms" or "GFLOP/s".
+ */
+static void
+BenchRecord
+(
+    char const *suite,
+    char const  *name,
+    double      value,
+    char const  *unit
+)
+{
+    if (Global_BenchOutput != NULL) {
+        fprintf(Global_BenchOutput, "%s\t%s\t%.6g\t%s\n", suite, name, value, unit);
+    }
+}
+
+/* @summary Write a description of the host and the build to the results file as '#'-prefixed header lines, so that results from different machines and compilers are not compared by mistake.
+ * @param fp The results file.
+ */
+static void
+BenchWriteEnvironment
+(
+    FILE *fp
+)
+{
+    static char const *FEATURE_NAMES[] = {
+        "sse2", "ssse3", "sse4.1", "sse4.2", "popcnt", "avx", "avx2", "fma", "f16c", "bmi2",
+        "avx512f", "avx512bw", "avx512vl", "avx512vnni", "avx512bf16", "avxvnni"
+    };
+    char        brand[CPU_BRAND_STRING_MAX];
+    char     compiler[64];
+    uint32_t features = CpuFeatureFlags();
+    uint32_t        i;
+
+    (void) CpuBrandString(brand, sizeof(brand));
+#if defined(__clang__)
+    (void) snprintf(compiler, sizeof(compiler), "clang %s", __clang_version__);
+#elif defined(__GNUC__)
+    (void) snprintf(compiler, sizeof(compiler), "gcc %s", __VERSION__);
+#elif defined(_MSC_VER)
+    (void) snprintf(compiler, sizeof(compiler), "msvc %d", (int) _MSC_FULL_VER);
+#else
+    (void) snprintf(compiler, sizeof(compiler), "unknown");
+#endif
+    fprintf(fp, "# cpu\t%s\n", brand);
+    fprintf(fp, "# logical_cpus\t%u\n", CpuLogicalCount());
+    fprintf(fp, "# features\t");
+    for (i = 0; i < sizeof(FEATURE_NAMES) / sizeof(FEATURE_NAMES[0]); ++i) {
+        if (features & (1UL << i)) {
+            fprintf(fp, "%s ", FEATURE_NAMES[i]);
+        }
+    }
+    fprintf(fp, "\n");
+    fprintf(fp, "# compiler\t%s\n", compiler);
+    fprintf(fp, "# flags\t%s\n", BENCH_BUILD_FLAGS);
+    fprintf(fp, "# columns\tsuite\tname\tvalue\tunit\n");
+}
+
+/* @summary Time every supported u8-to-float32 conversion kernel over a buffer of synthetic pixel data.
+ * Each kernel's output is compared against the scalar kernel.
+ * @return Zero if all kernels produce matching output, or -1 if a mismatch or allocation failure occurred.
+ */
+static int
+BenchmarkConvert
+(
+    void
+)
+{
+    size_t const   count = (size_t) BENCH_SAMPLE_COUNT * BENCH_FEATURE_COUNT;
+    uint8_t         *src = (uint8_t*) malloc(count);
+    float           *ref = (float  *) malloc(count * sizeof(float));
+    float           *dst = (float  *) malloc(count * sizeof(float));
+    float const    scale = 1.0f / 255.0f;
+    float const     bias =-0.1307f;
+    uint64_t         rng = 0x9E3779B97F4A7C15ULL;
+    int           result = 0;
+    uint32_t      kernel;
+    size_t             i;
+
+    if (src == NULL || ref == NULL || dst == NULL) {
+        fprintf(stderr, "ERROR: Failed to allocate conversion buffers." END_OF_LINE);
+        result = -1;
+        goto cleanup_and_exit;
+    }
+    for (i = 0; i < count; ++i) {
+        rng ^= rng >> 12; rng ^= rng << 25; rng ^= rng >> 27;
+        src[i] = (uint8_t)((rng * 0x2545F4914F6CDD1DULL) >> 56);
+    }
+    ConvertU8ToF32Kernel(CONVERT_KERNEL_SCALAR)(ref, src, count, scale, bias);
+
+    printf("convert: %u samples x %u features" END_OF_LINE, (unsigned) BENCH_SAMPLE_COUNT, (unsigned) BENCH_FEATURE_COUNT);
+    for (kernel = 0; kernel < CONVERT_KERNEL_COUNT; ++kernel) {
+        CONVERT_U8_F32_FUNC func = ConvertU8ToF32Kernel(kernel);
+        double              best = 1.0e30;
+        float           max_diff = 0.0f;
+        uint32_t               r;
+        if (func == NULL) {
+            printf("  %-8s unsupported" END_OF_LINE, ConvertKernelName(kernel));
+            continue;
+        }
+        for (r = 0; r < BENCH_REPEAT_COUNT; ++r) {
+            double t0 = TimestampSeconds();
+            func(dst, src, count, scale, bias);
+            double t1 = TimestampSeconds();
+            if ((t1 - t0) < best) {
+                best = t1 - t0;
+            }
+        }
+        for (i = 0; i < count; ++i) {
+            float d = fabsf(dst[i] - ref[i]);
+            if (d > max_diff) {
+                max_diff = d;
+            }
+        }
+        printf("  %-8s %8.3f ms %8.2f GB/s  max_diff=%g" END_OF_LINE, ConvertKernelName(kernel), best * 1000.0,
+               ((double) count * (1 + sizeof(float))) / best * 1.0e-9, (double) max_diff);
+        BenchRecord("convert", ConvertKernelName(kernel), ((double) count * (1 + sizeof(float))) / best * 1.0e-9, "GB/s");
+        if (max_diff > 1.0e-6f) {
+            result = -1;
+        }
+    }
+
+cleanup_and_exit:
+    free(dst);
+    free(ref);
+    free(src);
+    return result;
+}
+
+/* @summary Compare GemmF32, or GemmF32Parallel, with the selected micro-kernel against a naive triple loop.
+ * Every shape of BENCH_GEMM_CHECK_SHAPES is computed with all four transpose combinations, padded leading dimensions,
+ * a non-unit alpha and a non-zero beta.
+ * @param pool The task pool passed to GemmF32Parallel, or NULL to check GemmF32.
+ * @param o_max_diff On return, set to the largest absolute difference from the reference.
+ * @return Zero if the check ran, or -1 if the buffers could not be allocated.
+ */
+static int
+BenchCheckGemm
+(
+    struct TASK_POOL  *pool,
+    float       *o_max_diff
+)
+{
+    size_t const max_n = 1024 * 1024;
+    float   const alpha = 0.75f;
+    float   const  beta = 0.5f;
+    float            *a = (float*) malloc(max_n * sizeof(float));
+    float            *b = (float*) malloc(max_n * sizeof(float));
+    float            *c = (float*) malloc(max_n * sizeof(float));
+    float          *ref = (float*) malloc(max_n * sizeof(float));
+    float      max_diff = 0.0f;
+    int          result = -1;
+    uint32_t      trans;
+    size_t      s, i, j, p;
+
+    if (a == NULL || b == NULL || c == NULL || ref == NULL) {
+        fprintf(stderr, "ERROR: Failed to allocate GEMM check buffers." END_OF_LINE);
+        goto cleanup_and_exit;
+    }
+    for (i = 0; i < max_n; ++i) {
+        a[i] = (float)((i * 7) % 13) * 0.01f - 0.06f;
+        b[i] = (float)((i * 5) % 11) * 0.01f - 0.05f;
+    }
+    for (s = 0; s < sizeof(BENCH_GEMM_CHECK_SHAPES) / sizeof(BENCH_GEMM_CHECK_SHAPES[0]); ++s) {
+        uint32_t m = BENCH_GEMM_CHECK_SHAPES[s][0];
+        uint32_t n = BENCH_GEMM_CHECK_SHAPES[s][1];
+        uint32_t k = BENCH_GEMM_CHECK_SHAPES[s][2];
+        for (trans = 0; trans < 4; ++trans) {
+            uint32_t trans_a = (trans & 1) ? GEMM_OP_TRANSPOSE : GEMM_OP_NONE;
+            uint32_t trans_b = (trans & 2) ? GEMM_OP_TRANSPOSE : GEMM_OP_NONE;
+            /* A is stored [m][k] or [k][m], and B is stored [k][n] or [n][k]; pad each row by a few floats */
+            uint32_t     lda = (trans_a ? m : k) + 3;
+            uint32_t     ldb = (trans_b ? k : n) + 5;
+            uint32_t     ldc = n + 2;
+            for (i = 0; i < (size_t) m * ldc; ++i) {
+                c[i] = ref[i] = (float)((i * 3) % 7) * 0.1f - 0.3f;
+            }
+            for (i = 0; i < m; ++i) {
+                for (j = 0; j < n; ++j) {
+                    double sum = 0.0;
+                    for (p = 0; p < k; ++p) {
+                        float x = trans_a ? a[p * lda + i] : a[i * lda + p];
+                        float y = trans_b ? b[j * ldb + p] : b[p * ldb + j];
+                        sum += (double) x * (double) y;
+                    }
+                    ref[i * ldc + j] = (float)((double) alpha * sum + (double) beta * ref[i * ldc + j]);
+                }
+            }
+            if (pool != NULL) {
+                (void) GemmF32Parallel(pool, trans_a, trans_b, m, n, k, alpha, a, lda, b, ldb, beta, c, ldc, NULL);
+            } else {
+                (void) GemmF32(trans_a, trans_b, m, n, k, alpha, a, lda, b, ldb, beta, c, ldc, NULL);
+            }
+            /* the padding columns of C must not be written */
+            for (i = 0; i < (size_t) m * ldc; ++i) {
+                float d = fabsf(c[i] - ref[i]);
+                if (d > max_diff) {
+                    max_diff = d;
+                }
+            }
+        }
+    }
+    result = 0;
+
+cleanup_and_exit:
+    *o_max_diff = max_diff;
+    free(ref);
+    free(c);
+    free(b);
+    free(a);
+    return result;
+}
+
+/* @summary Time GemmF32 with every supported micro-kernel over a set of matrix shapes.
+ * Each kernel is first checked against a naive GEMM, both single-threaded and through GemmF32Parallel.
+ * @return Zero if all kernels produce matching output, or -1 if a mismatch or allocation failure occurred.
+ */
+static int
+BenchmarkGemm
+(
+    void
+)
+{
+    size_t const   max_n = 1024 * 1024;
+    float             *a = (float*) malloc(max_n * sizeof(float));
+    float             *b = (float*) malloc(max_n * sizeof(float));
+    float             *c = (float*) malloc(max_n * sizeof(float));
+    TASK_POOL_INIT  init;
+    struct TASK_POOL *pool = NULL;
+    int           result = 0;
+    uint32_t      kernel;
+    size_t             i;
+    char        name[64];
+
+    init.ThreadCount = BENCH_GEMM_CHECK_THREADS;
+    init.Flags       = 0;
+    if (TaskPoolCreate(&pool, &init) != 0) {
+        perror("ERROR: Failed to create the task pool");
+        pool = NULL;
+        result = -1;
+        goto cleanup_and_exit;
+    }
+    if (a == NULL || b == NULL || c == NULL) {
+        fprintf(stderr, "ERROR: Failed to allocate GEMM buffers." END_OF_LINE);
+        result = -1;
+        goto cleanup_and_exit;
+    }
+    for (i = 0; i < max_n; ++i) {
+        a[i] = (float)((i * 7) % 13) * 0.01f - 0.06f;
+        b[i] = (float)((i * 5) % 11) * 0.01f - 0.05f;
+    }
+    printf("gemm: C = A * B, row-major, single-threaded" END_OF_LINE);
+    for (kernel = 0; kernel < GEMM_KERNEL_COUNT; ++kernel) {
+        float serial_diff = 0.0f;
+        float   pool_diff = 0.0f;
+        size_t          s;
+        if (GemmSelectKernel(kernel) != 0) {
+            printf("  %-8s unsupported" END_OF_LINE, GemmKernelName(kernel));
+            continue;
+        }
+        if (BenchCheckGemm(NULL, &serial_diff) != 0 || BenchCheckGemm(pool, &pool_diff) != 0) {
+            result = -1;
+            goto cleanup_and_exit;
+        }
+        printf("  %-8s max_diff=%g vs naive, max_diff=%g vs naive with %u threads" END_OF_LINE, GemmKernelName(kernel),
+               (double) serial_diff, (double) pool_diff, TaskPoolThreadCount(pool));
+        if (serial_diff > 1.0e-5f || pool_diff > 1.0e-5f) {
+            fprintf(stderr, "ERROR: GEMM kernel %s differs from the naive product." END_OF_LINE, GemmKernelName(kernel));
+            result = -1;
+        }
+        for (s = 0; s < sizeof(BENCH_GEMM_SHAPES) / sizeof(BENCH_GEMM_SHAPES[0]); ++s) {
+            uint32_t   m = BENCH_GEMM_SHAPES[s][0];
+            uint32_t   n = BENCH_GEMM_SHAPES[s][1];
+            uint32_t   k = BENCH_GEMM_SHAPES[s][2];
+            double flops = 2.0 * m * n * k;
+            double  best = 1.0e30;
+            uint32_t reps = (uint32_t)(2.0e9 / flops) + 1;
+            uint32_t    r;
+            for (r = 0; r < reps; ++r) {
+                double t0 = TimestampSeconds();
+                (void) GemmF32(GEMM_OP_NONE, GEMM_OP_NONE, m, n, k, 1.0f, a, k, b, n, 0.0f, c, n, NULL);
+                double t1 = TimestampSeconds();
+                if ((t1 - t0) < best) {
+                    best = t1 - t0;
+                }
+            }
+            printf("  %-8s %4u x %4u x %4u %8.3f ms %8.2f GFLOP/s" END_OF_LINE, GemmKernelName(kernel), m, n, k,
+                   best * 1000.0, flops / best * 1.0e-9);
+            (void) snprintf(name, sizeof(name), "%s_%ux%ux%u", GemmKernelName(kernel), m, n, k);
+            BenchRecord("gemm", name, flops / best * 1.0e-9, "GFLOP/s");
+        }
+    }
+    /* restore the default kernel selection */
+    for (kernel = GEMM_KERNEL_COUNT; kernel-- > 0; ) {
+        if (GemmSelectKernel(kernel) == 0) {
+            break;
+        }
+    }
+
+cleanup_and_exit:
+    free(c);
+    free(b);
+    free(a);
+    TaskPoolDelete(pool);
+    return result;
+}
+
+/* @summary Time GemmF32Parallel with the default micro-kernel on a task pool with one thread per logical processor.
+ * @return Zero if the benchmark ran, or -1 if the pool or buffers could not be created.
+ */
+static int
+BenchmarkGemmParallel
+(
+    void
+)
+{
+    size_t const   max_n = 1024 * 1024;
+    TASK_POOL_INIT  init;
+    struct TASK_POOL *pool = NULL;
+    float             *a = NULL;
+    float             *b = NULL;
+    float             *c = NULL;
+    int           result = 0;
+    size_t          i, s;
+    char        name[64];
+
+    init.ThreadCount = 0;
+    init.Flags       = TASK_POOL_FLAG_PIN_THREADS;
+    if (TaskPoolCreate(&pool, &init) != 0) {
+        perror("ERROR: Failed to create the task pool");
+        return -1;
+    }
+    a = (float*) malloc(max_n * sizeof(float));
+    b = (float*) malloc(max_n * sizeof(float));
+    c = (float*) malloc(max_n * sizeof(float));
+    if (a == NULL || b == NULL || c == NULL) {
+        fprintf(stderr, "ERROR: Failed to allocate GEMM buffers." END_OF_LINE);
+        result = -1;
+        goto cleanup_and_exit;
+    }
+    for (i = 0; i < max_n; ++i) {
+        a[i] = (float)((i * 7) % 13) * 0.01f - 0.06f;
+        b[i] = (float)((i * 5) % 11) * 0.01f - 0.05f;
+    }
+    printf("gemm: C = A * B, row-major, %u threads" END_OF_LINE, TaskPoolThreadCount(pool));
+    for (s = 0; s < sizeof(BENCH_GEMM_SHAPES) / sizeof(BENCH_GEMM_SHAPES[0]); ++s) {
+        uint32_t   m = BENCH_GEMM_SHAPES[s][0];
+        uint32_t   n = BENCH_GEMM_SHAPES[s][1];
+        uint32_t   k = BENCH_GEMM_SHAPES[s][2];
+        double flops = 2.0 * m * n * k;
+        double  best = 1.0e30;
+        uint32_t reps = (uint32_t)(2.0e9 / flops) + 1;
+        uint32_t    r;
+        for (r = 0; r < reps; ++r) {
+            double t0 = TimestampSeconds();
+            (void) GemmF32Parallel(pool, GEMM_OP_NONE, GEMM_OP_NONE, m, n, k, 1.0f, a, k, b, n, 0.0f, c, n, NULL);
+            double t1 = TimestampSeconds();
+            if ((t1 - t0) < best) {
+                best = t1 - t0;
+            }
+        }
+        printf("  %-8s %4u x %4u x %4u %8.3f ms %8.2f GFLOP/s" END_OF_LINE, "parallel", m, n, k,
+               best * 1000.0, flops / best * 1.0e-9);
+        (void) snprintf(name, sizeof(name), "parallel%u_%ux%ux%u", TaskPoolThreadCount(pool), m, n, k);
+        BenchRecord("gemm", name, flops / best * 1.0e-9, "GFLOP/s");
+    }
+
+cleanup_and_exit:
+    free(c);
+    free(b);
+    free(a);
+    TaskPoolDelete(pool);
+    return result;
+}
+
+/* @summary Time the first-layer forward product and weight gradient with GEMM and with the sparse product, over a range of input densities.
+ * @return Zero if the sparse products match GEMM, or -1 if a mismatch or allocation failure occurred.
+ */
+static int
+BenchmarkSparse
+(
+    void
+)
+{
+    uint32_t const  m = BENCH_BATCH_SIZE;
+    uint32_t const  k = BENCH_FEATURE_COUNT;
+    uint32_t const  n = BENCH_SPARSE_OUTPUTS;
+    float          *x = (float   *) malloc((size_t) m * k * sizeof(float));
+    float          *w = (float   *) malloc((size_t) k * n * sizeof(float));
+    float          *d = (float   *) malloc((size_t) m * n * sizeof(float));
+    float          *c = (float   *) malloc((size_t) k * n * sizeof(float));
+    float        *ref = (float   *) malloc((size_t) k * n * sizeof(float));
+    uint32_t    *offs = (uint32_t*) malloc((m + 1) * sizeof(uint32_t));
+    uint32_t    *cols = (uint32_t*) malloc((size_t) m * k * sizeof(uint32_t));
+    float       *vals = (float   *) malloc((size_t) m * k * sizeof(float));
+    uint32_t   *toffs = (uint32_t*) malloc((k + 1) * sizeof(uint32_t));
+    uint32_t   *tcols = (uint32_t*) malloc((size_t) m * k * sizeof(uint32_t));
+    float      *tvals = (float   *) malloc((size_t) m * k * sizeof(float));
+    uint64_t      rng = 0x9E3779B97F4A7C15ULL;
+    int        result = 0;
+    size_t       s, i;
+    char     name[64];
+
+    if (x == NULL || w == NULL || d == NULL || c == NULL || ref == NULL || offs == NULL || cols == NULL || vals == NULL ||
+        toffs == NULL || tcols == NULL || tvals == NULL) {
+        fprintf(stderr, "ERROR: Failed to allocate sparse product buffers." END_OF_LINE);
+        result = -1;
+        goto cleanup_and_exit;
+    }
+    for (i = 0; i < (size_t) k * n; ++i) {
+        w[i] = (float)((i * 7) % 13) * 0.01f - 0.06f;
+    }
+    for (i = 0; i < (size_t) m * n; ++i) {
+        d[i] = (float)((i * 5) % 11) * 0.01f - 0.05f;
+    }
+    printf("sparse: %u x %u inputs, %u outputs, %s kernel" END_OF_LINE, m, k, n, SparseKernelName(SPARSE_KERNEL_COUNT - 1));
+    for (s = 0; s < sizeof(BENCH_SPARSE_DENSITIES) / sizeof(BENCH_SPARSE_DENSITIES[0]); ++s) {
+        SPARSE_CSR csr;
+        SPARSE_CSR csr_t;
+        double  time[4];
+        float   max_diff = 0.0f;
+        uint32_t  nnz = 0;
+        uint32_t    r, op;
+
+        for (i = 0; i < (size_t) m * k; ++i) {
+            rng ^= rng >> 12; rng ^= rng << 25; rng ^= rng >> 27;
+            x[i] = ((double)((rng * 0x2545F4914F6CDD1DULL) >> 11) * (1.0 / 9007199254740992.0) < BENCH_SPARSE_DENSITIES[s]) ? (float)(i % 255 + 1) / 255.0f : 0.0f;
+        }
+        for (r = 0; r < m; ++r) {
+            offs[r] = nnz;
+            nnz    += SparseEncodeRowF32(cols + nnz, vals + nnz, x + ((size_t) r * k), k);
+        }
+        offs[m]          = nnz;
+        csr.RowOffsets   = offs;
+        csr.Columns      = cols;
+        csr.Values       = vals;
+        csr.RowCount     = m;
+        csr.ColumnCount  = k;
+        csr.NonzeroCount = nnz;
+        csr_t.RowOffsets = toffs;
+        csr_t.Columns    = tcols;
+        csr_t.Values     = tvals;
+
+        /* 0: dense forward, 1: sparse forward, 2: dense weight gradient, 3: sparse weight gradient, including the transpose */
+        for (op = 0; op < 4; ++op) {
+            time[op] = 1.0e30;
+            for (r = 0; r < BENCH_REPEAT_COUNT; ++r) {
+                double t0 = TimestampSeconds();
+                switch (op) {
+                    case 0: (void) GemmF32(GEMM_OP_NONE, GEMM_OP_NONE, m, n, k, 1.0f, x, k, w, n, 0.0f, c, n, NULL); break;
+                    case 1: SparseGemmF32(GEMM_OP_NONE, n, &csr, w, n, 0.0f, c, n); break;
+                    case 2: (void) GemmF32(GEMM_OP_TRANSPOSE, GEMM_OP_NONE, k, n, m, 1.0f, x, k, d, n, 0.0f, c, n, NULL); break;
+                    case 3: SparseTranspose(&csr_t, &csr); SparseGemmF32(GEMM_OP_NONE, n, &csr_t, d, n, 0.0f, c, n); break;
+                }
+                double t1 = TimestampSeconds();
+                if ((t1 - t0) < time[op]) {
+                    time[op] = t1 - t0;
+                }
+            }
+            if ((op & 1) == 0) {
+                memcpy(ref, c, (size_t)(op == 0 ? m : k) * n * sizeof(float));
+            } else {
+                for (i = 0; i < (size_t)(op == 1 ? m : k) * n; ++i) {
+                    float diff = fabsf(c[i] - ref[i]);
+                    if (diff > max_diff) {
+                        max_diff = diff;
+                    }
+                }
+            }
+        }
+        if (max_diff > 1.0e-3f) {
+            fprintf(stderr, "ERROR: The sparse product differs from GEMM by %g." END_OF_LINE, (double) max_diff);
+            result = -1;
+        }
+        printf("  density %.2f: forward %7.3f ms vs %7.3f ms (%.2fx), weight gradient %7.3f ms vs %7.3f ms (%.2fx)" END_OF_LINE,
+               (double) nnz / ((double) m * k), time[1] * 1000.0, time[0] * 1000.0, time[0] / time[1],
+               time[3] * 1000.0, time[2] * 1000.0, time[2] / time[3]);
+        (void) snprintf(name, sizeof(name), "forward_density%.2f", (double) BENCH_SPARSE_DENSITIES[s]);
+        BenchRecord("sparse", name, time[1] * 1000.0, "ms");
+        (void) snprintf(name, sizeof(name), "weight_gradient_density%.2f", (double) BENCH_SPARSE_DENSITIES[s]);
+        BenchRecord("sparse", name, time[3] * 1000.0, "ms");
+    }
+
+cleanup_and_exit:
+    free(tvals);
+    free(tcols);
+    free(toffs);
+    free(vals);
+    free(cols);
+    free(offs);
+    free(ref);
+    free(c);
+    free(d);
+    free(w);
+    free(x);
+    return result;
+}
+
+/* @summary Time the ReLU and softmax activation functions at the layer shapes of a 784-256-10 network trained on batches of BENCH_BATCH_SIZE samples.
+ * @return Zero if the benchmark ran, or -1 if an allocation failure occurred.
+ */
+static int
+BenchmarkActivation
+(
+    void
+)
+{
+    static uint32_t const SHAPES[][2] = {
+        { BENCH_SPARSE_OUTPUTS, MLP_ACTIVATION_RELU    },
+        { 10                  , MLP_ACTIVATION_SOFTMAX },
+    };
+    uint32_t const   reps = 1000;
+    float           *buf = (float*) malloc((size_t) BENCH_BATCH_SIZE * BENCH_SPARSE_OUTPUTS * sizeof(float));
+    char        name[64];
+    size_t          i, s;
+
+    if (buf == NULL) {
+        fprintf(stderr, "ERROR: Failed to allocate activation buffers." END_OF_LINE);
+        return -1;
+    }
+    printf("activation: %u rows" END_OF_LINE, (unsigned) BENCH_BATCH_SIZE);
+    for (s = 0; s < sizeof(SHAPES) / sizeof(SHAPES[0]); ++s) {
+        MLP_LAYER layer;
+        double     best = 1.0e30;
+        uint32_t      r;
+
+        memset(&layer, 0, sizeof(layer));
+        layer.OutputCount  = SHAPES[s][0];
+        layer.OutputStride = (SHAPES[s][0] + 15) & ~15U;
+        layer.Activation   = SHAPES[s][1];
+        for (r = 0; r < BENCH_REPEAT_COUNT; ++r) {
+            uint32_t j;
+            double  t0, t1;
+            for (i = 0; i < (size_t) BENCH_BATCH_SIZE * layer.OutputStride; ++i) {
+                buf[i] = (float)((i * 7) % 13) * 0.1f - 0.6f;
+            }
+            t0 = TimestampSeconds();
+            for (j = 0; j < reps; ++j) {
+                MlpActivate(&layer, buf, BENCH_BATCH_SIZE);
+            }
+            t1 = TimestampSeconds();
+            if ((t1 - t0) < best) {
+                best = t1 - t0;
+            }
+        }
+        best /= reps;
+        (void) snprintf(name, sizeof(name), "%s_%ux%u", layer.Activation == MLP_ACTIVATION_RELU ? "relu" : "softmax", (unsigned) BENCH_BATCH_SIZE, layer.OutputCount);
+        printf("  %-16s %8.3f us" END_OF_LINE, name, best * 1.0e6);
+        BenchRecord("activation", name, best * 1.0e6, "us");
+    }
+    free(buf);
+    return 0;
+}
+
+/* @summary Time MlpTrainBatch on synthetic data for a network with wide hidden layers, with its weights and activations stored as float32, bfloat16 and float16,
+ * and time MlpForward on a small batch for a wider network in each format.
+ * The same initial weights and batch are used for every format. The loss of the first batch and the forward probabilities are compared against float32.
+ * @return Zero if the benchmark ran, or -1 if an allocation failure occurred or a 16-bit format produced results far from float32.
+ */
+static int
+BenchmarkMixedPrecision
+(
+    void
+)
+{
+    uint32_t const sizes[4] = { BENCH_FEATURE_COUNT, BENCH_MIXED_HIDDEN, BENCH_MIXED_HIDDEN, 10 };
+    uint32_t const  wide[4] = { BENCH_FEATURE_COUNT, BENCH_MIXED_FORWARD_HIDDEN, BENCH_MIXED_FORWARD_HIDDEN, 10 };
+    float f32_probs[BENCH_MIXED_FORWARD_BATCH * 10];
+    TASK_POOL_INIT    init;
+    MINIBATCH        batch;
+    struct TASK_POOL *pool = NULL;
+    float       f32_loss = 0.0f;
+    int           result = 0;
+    uint32_t     i, j, t;
+    char        name[64];
+
+    init.ThreadCount = 0;
+    init.Flags       = TASK_POOL_FLAG_PIN_THREADS;
+    if (TaskPoolCreate(&pool, &init) != 0) {
+        perror("ERROR: Failed to create the task pool");
+        return -1;
+    }
+    if (MinibatchCreate(&batch, BENCH_BATCH_SIZE, BENCH_FEATURE_COUNT) != 0) {
+        fprintf(stderr, "ERROR: Failed to allocate the mixed-precision benchmark batch." END_OF_LINE);
+        TaskPoolDelete(pool);
+        return -1;
+    }
+    for (i = 0; i < BENCH_BATCH_SIZE; ++i) {
+        float *row = batch.Inputs + ((size_t) i * batch.RowStride);
+        for (j = 0; j < BENCH_FEATURE_COUNT; ++j) {
+            row[j] = (float)(((i * 31) + (j * 7)) % 17) * (1.0f / 16.0f);
+        }
+        batch.Labels[i] = (uint8_t)(i % 10);
+    }
+    batch.SampleCount = BENCH_BATCH_SIZE;
+
+    printf("mixed: train %u-%u-%u-%u, batch %u, %u threads" END_OF_LINE, sizes[0], sizes[1], sizes[2], sizes[3],
+           (unsigned) BENCH_BATCH_SIZE, TaskPoolThreadCount(pool));
+    for (t = 0; t < CONVERT_TYPE_COUNT; ++t) {
+        MLP       mlp;
+        double   best = 1.0e30;
+        float    loss = 0.0f;
+        uint32_t    r;
+
+        if (MlpCreate(&mlp, sizes, 4, BENCH_BATCH_SIZE, BENCH_TRAIN_SEED) != 0 || MlpSetTaskPool(&mlp, pool) != 0 || MlpSetPrecision(&mlp, t) != 0) {
+            perror("ERROR: Failed to create the mixed-precision benchmark network");
+            MlpDelete(&mlp);
+            result = -1;
+            break;
+        }
+        loss = MlpTrainBatch(&mlp, &batch, BENCH_MIXED_LEARNING_RATE);
+        for (r = 0; r < BENCH_REPEAT_COUNT; ++r) {
+            double t0 = TimestampSeconds();
+            for (i = 0; i < BENCH_MIXED_BATCH_COUNT; ++i) {
+                (void) MlpTrainBatch(&mlp, &batch, BENCH_MIXED_LEARNING_RATE);
+            }
+            double t1 = TimestampSeconds();
+            if ((t1 - t0) < best) {
+                best = t1 - t0;
+            }
+        }
+        best /= BENCH_MIXED_BATCH_COUNT;
+        if (t == CONVERT_TYPE_F32) {
+            f32_loss = loss;
+        } else if (!(fabsf(loss - f32_loss) <= 0.01f * f32_loss)) {
+            fprintf(stderr, "ERROR: %s first-batch loss %.5f differs from float32 loss %.5f." END_OF_LINE, ConvertTypeName(t), (double) loss, (double) f32_loss);
+            result = -1;
+        }
+        printf("  %-5s %8.3f ms/batch %10.0f samples/s, first-batch loss %.5f" END_OF_LINE, ConvertTypeName(t),
+               best * 1000.0, BENCH_BATCH_SIZE / best, (double) loss);
+        (void) snprintf(name, sizeof(name), "train_%s_%ux%u", ConvertTypeName(t), (unsigned) BENCH_MIXED_HIDDEN, (unsigned) BENCH_BATCH_SIZE);
+        BenchRecord("mixed", name, BENCH_BATCH_SIZE / best, "samples/s");
+        MlpDelete(&mlp);
+    }
+
+    printf("mixed: forward %u-%u-%u-%u, batch %u, %u threads" END_OF_LINE, wide[0], wide[1], wide[2], wide[3],
+           (unsigned) BENCH_MIXED_FORWARD_BATCH, TaskPoolThreadCount(pool));
+    for (t = 0; result == 0 && t < CONVERT_TYPE_COUNT; ++t) {
+        MLP         mlp;
+        MLP_LAYER *out = NULL;
+        double    best = 1.0e30;
+        float max_diff = 0.0f;
+        uint32_t     r;
+
+        if (MlpCreate(&mlp, wide, 4, BENCH_MIXED_FORWARD_BATCH, BENCH_TRAIN_SEED) != 0 || MlpSetTaskPool(&mlp, pool) != 0 || MlpSetPrecision(&mlp, t) != 0) {
+            perror("ERROR: Failed to create the mixed-precision forward benchmark network");
+            MlpDelete(&mlp);
+            result = -1;
+            break;
+        }
+        out = &mlp.Layers[mlp.LayerCount - 1];
+        for (r = 0; r < BENCH_REPEAT_COUNT; ++r) {
+            double t0 = TimestampSeconds();
+            for (i = 0; i < BENCH_MIXED_FORWARD_COUNT; ++i) {
+                MlpForward(&mlp, batch.Inputs, batch.RowStride, BENCH_MIXED_FORWARD_BATCH);
+            }
+            double t1 = TimestampSeconds();
+            if ((t1 - t0) < best) {
+                best = t1 - t0;
+            }
+        }
+        best /= BENCH_MIXED_FORWARD_COUNT;
+        for (i = 0; i < BENCH_MIXED_FORWARD_BATCH; ++i) {
+            for (j = 0; j < out->OutputCount; ++j) {
+                float p = out->Outputs[((size_t) i * out->OutputStride) + j];
+                if (t == CONVERT_TYPE_F32) {
+                    f32_probs[(i * 10) + j] = p;
+                } else if (fabsf(p - f32_probs[(i * 10) + j]) > max_diff) {
+                    max_diff = fabsf(p - f32_probs[(i * 10) + j]);
+                }
+            }
+        }
+        if (max_diff > 0.05f) {
+            fprintf(stderr, "ERROR: %s forward probabilities differ from float32 by %g." END_OF_LINE, ConvertTypeName(t), (double) max_diff);
+            result = -1;
+        }
+        printf("  %-5s %8.3f ms/batch %10.0f samples/s, max_diff=%g" END_OF_LINE, ConvertTypeName(t),
+               best * 1000.0, BENCH_MIXED_FORWARD_BATCH / best, (double) max_diff);
+        (void) snprintf(name, sizeof(name), "forward_%s_%ux%u", ConvertTypeName(t), (unsigned) BENCH_MIXED_FORWARD_HIDDEN, (unsigned) BENCH_MIXED_FORWARD_BATCH);
+        BenchRecord("mixed", name, BENCH_MIXED_FORWARD_BATCH / best, "samples/s");
+        MlpDelete(&mlp);
+    }
+    MinibatchDelete(&batch);
+    TaskPoolDelete(pool);
+    return result;
+}
+
+/* @summary Copy the activations of every layer of a CNN and the weight gradients of every convolution layer, as left by CnnTrainBatch.
+ * Only the channel blocks of each image are copied, not the padding between images.
+ * @param cnn The network.
+ * @param count The number of images in the last batch.
+ * @param dst The destination buffer, or NULL to compute the size only.
+ * @param o_output_count On return, set to the number of activation floats, which are stored before the weight gradients.
+ * @return The total number of floats copied to dst.
+ */
+static size_t
+BenchConvSnapshot
+(
+    CNN const          *cnn,
+    uint32_t          count,
+    float              *dst,
+    size_t  *o_output_count
+)
+{
+    size_t   n = 0;
+    uint32_t l, i;
+
+    for (l = 0; l < cnn->LayerCount; ++l) {
+        CNN_LAYER const *layer = &cnn->Layers[l];
+        size_t           image = (size_t)((layer->OutputChannels + CNN_CBLOCK - 1) / CNN_CBLOCK) * CNN_CBLOCK * layer->OutputHeight * layer->OutputWidth;
+        for (i = 0; i < count; ++i, n += image) {
+            if (dst != NULL) {
+                memcpy(dst + n, layer->Outputs + ((size_t) i * layer->OutputStride), image * sizeof(float));
+            }
+        }
+    }
+    *o_output_count = n;
+    for (l = 0; l < cnn->LayerCount; ++l) {
+        CNN_LAYER const *layer = &cnn->Layers[l];
+        if (layer->Type == CNN_LAYER_CONV) {
+            size_t weights = (size_t)((layer->OutputChannels + CNN_CBLOCK - 1) / CNN_CBLOCK) * CNN_CBLOCK * layer->InputChannels * layer->KernelSize * layer->KernelSize;
+            if (dst != NULL) {
+                memcpy(dst + n, layer->WeightGrad, weights * sizeof(float));
+            }
+            n += weights;
+        }
+    }
+    return n;
+}
+
+/* @summary Compute the largest absolute difference between two float arrays.
+ * @param a The first array.
+ * @param b The second array.
+ * @param n The number of floats in each array.
+ * @return The largest absolute difference between a[i] and b[i].
+ */
+static float
+BenchMaxAbsDiff
+(
+    float const *a,
+    float const *b,
+    size_t       n
+)
+{
+    float max_diff = 0.0f;
+    size_t       i;
+    for (i = 0; i < n; ++i) {
+        float d = fabsf(a[i] - b[i]);
+        max_diff = d > max_diff ? d : max_diff;
+    }
+    return max_diff;
+}
+
+/* @summary Time CnnForward and CnnTrainBatch on synthetic 28x28 images for a LeNet-style network, with each supported convolution kernel.
+ * The same initial weights and batch are used for every kernel, and the loss, the activations and the weight gradients of the first batch are compared against the scalar kernel.
+ * @return Zero if the benchmark ran, or -1 if an allocation failure occurred or a kernel produced results different from the scalar kernel.
+ */
+static int
+BenchmarkConv
+(
+    void
+)
+{
+    uint32_t const  head[2] = { BENCH_TRAIN_HIDDEN, 10 };
+    uint32_t const    width = 28;
+    TASK_POOL_INIT     init;
+    MINIBATCH         batch;
+    struct TASK_POOL  *pool = NULL;
+    float     scalar_loss = 0.0f;
+    float            *ref = NULL;
+    float          *state = NULL;
+    size_t   output_count = 0;
+    size_t    state_count = 0;
+    int            result = 0;
+    uint32_t      i, j, k;
+    char         name[64];
+
+    init.ThreadCount = 0;
+    init.Flags       = TASK_POOL_FLAG_PIN_THREADS;
+    if (TaskPoolCreate(&pool, &init) != 0) {
+        perror("ERROR: Failed to create the task pool");
+        return -1;
+    }
+    if (MinibatchCreate(&batch, BENCH_BATCH_SIZE, width * width) != 0) {
+        fprintf(stderr, "ERROR: Failed to allocate the convolution benchmark batch." END_OF_LINE);
+        TaskPoolDelete(pool);
+        return -1;
+    }
+    for (i = 0; i < BENCH_BATCH_SIZE; ++i) {
+        float *row = batch.Inputs + ((size_t) i * batch.RowStride);
+        for (j = 0; j < width * width; ++j) {
+            row[j] = (float)(((i * 31) + (j * 7)) % 17) * (1.0f / 16.0f);
+        }
+        batch.Labels[i] = (uint8_t)(i % 10);
+    }
+    batch.SampleCount = BENCH_BATCH_SIZE;
+
+    printf("conv: lenet %ux%u conv5x5x8-pool2-conv5x5x16-pool2-400-%u-10, batch %u, %u threads" END_OF_LINE, width, width,
+           (unsigned) BENCH_TRAIN_HIDDEN, (unsigned) BENCH_BATCH_SIZE, TaskPoolThreadCount(pool));
+    for (k = 0; k < CNN_KERNEL_COUNT; ++k) {
+        CNN       cnn;
+        double   best[2] = { 1.0e30, 1.0e30 };
+        float    loss = 0.0f;
+        float out_diff = 0.0f;
+        float grad_diff = 0.0f;
+        uint32_t    r;
+
+        if (CnnSelectKernel(k) != 0) {
+            continue;
+        }
+        if (CnnCreate(&cnn, width, width, BENCH_CONV_LAYERS, sizeof(BENCH_CONV_LAYERS) / sizeof(BENCH_CONV_LAYERS[0]), head, 2, BENCH_BATCH_SIZE, BENCH_TRAIN_SEED) != 0 ||
+            CnnSetTaskPool(&cnn, pool) != 0) {
+            perror("ERROR: Failed to create the convolution benchmark network");
+            CnnDelete(&cnn);
+            result = -1;
+            break;
+        }
+        loss = CnnTrainBatch(&cnn, &batch, BENCH_TRAIN_LEARNING_RATE);
+        /* the activations and weight gradients of the first batch are compared against the scalar kernel before the timed batches overwrite them */
+        state_count = BenchConvSnapshot(&cnn, batch.SampleCount, NULL, &output_count);
+        if (ref == NULL && ((ref = (float*) malloc(state_count * sizeof(float))) == NULL || (state = (float*) malloc(state_count * sizeof(float))) == NULL)) {
+            fprintf(stderr, "ERROR: Failed to allocate the convolution check buffers." END_OF_LINE);
+            CnnDelete(&cnn);
+            result = -1;
+            break;
+        }
+        (void) BenchConvSnapshot(&cnn, batch.SampleCount, k == CNN_KERNEL_SCALAR ? ref : state, &output_count);
+        if (k != CNN_KERNEL_SCALAR) {
+            out_diff  = BenchMaxAbsDiff(ref, state, output_count);
+            grad_diff = BenchMaxAbsDiff(ref + output_count, state + output_count, state_count - output_count);
+        }
+        for (r = 0; r < BENCH_REPEAT_COUNT; ++r) {
+            double t0 = TimestampSeconds();
+            for (i = 0; i < BENCH_CONV_BATCH_COUNT; ++i) {
+                CnnForward(&cnn, batch.Inputs, batch.RowStride, batch.SampleCount);
+            }
+            double t1 = TimestampSeconds();
+            for (i = 0; i < BENCH_CONV_BATCH_COUNT; ++i) {
+                (void) CnnTrainBatch(&cnn, &batch, BENCH_TRAIN_LEARNING_RATE);
+            }
+            double t2 = TimestampSeconds();
+            if ((t1 - t0) < best[0]) {
+                best[0] = t1 - t0;
+            }
+            if ((t2 - t1) < best[1]) {
+                best[1] = t2 - t1;
+            }
+        }
+        best[0] /= BENCH_CONV_BATCH_COUNT;
+        best[1] /= BENCH_CONV_BATCH_COUNT;
+        if (k == CNN_KERNEL_SCALAR) {
+            scalar_loss = loss;
+        } else if (!(fabsf(loss - scalar_loss) <= 1.0e-4f * scalar_loss)) {
+            fprintf(stderr, "ERROR: %s first-batch loss %.6f differs from scalar loss %.6f." END_OF_LINE, CnnKernelName(k), (double) loss, (double) scalar_loss);
+            result = -1;
+        }
+        if (out_diff > BENCH_CONV_MAX_DIFF || grad_diff > BENCH_CONV_MAX_DIFF) {
+            fprintf(stderr, "ERROR: %s activations differ from the scalar kernel by %g and weight gradients by %g." END_OF_LINE, CnnKernelName(k), (double) out_diff, (double) grad_diff);
+            result = -1;
+        }
+        printf("  %-6s forward %8.3f ms/batch, train %8.3f ms/batch %8.0f samples/s, first-batch loss %.5f, max_diff=%g/%g" END_OF_LINE, CnnKernelName(k),
+               best[0] * 1000.0, best[1] * 1000.0, BENCH_BATCH_SIZE / best[1], (double) loss, (double) out_diff, (double) grad_diff);
+        (void) snprintf(name, sizeof(name), "forward_%s_lenet", CnnKernelName(k));
+        BenchRecord("conv", name, BENCH_BATCH_SIZE / best[0], "samples/s");
+        (void) snprintf(name, sizeof(name), "train_%s_lenet", CnnKernelName(k));
+        BenchRecord("conv", name, BENCH_BATCH_SIZE / best[1], "samples/s");
+        CnnDelete(&cnn);
+    }
+    free(state);
+    free(ref);
+    MinibatchDelete(&batch);
+    TaskPoolDelete(pool);
+    return result;
+}
+
+/* @summary Time CnnForward and CnnTrainBatch on synthetic 28x28 images for a network of 3x3 convolutions, with direct convolution, with the Winograd path for every layer, and with the automatic choice.
+ * The same initial weights and batch are used for every algorithm, and the loss, the activations and the weight gradients of the first batch are compared against direct convolution.
+ * @return Zero if the benchmark ran, or -1 if an allocation failure occurred or the Winograd path produced results different from direct convolution.
+ */
+static int
+BenchmarkConvAlgorithm
+(
+    void
+)
+{
+    static char const    *NAMES[] = { "auto", "direct", "winograd" };
+    static uint32_t const ORDER[] = { CNN_ALGORITHM_DIRECT, CNN_ALGORITHM_WINOGRAD, CNN_ALGORITHM_AUTO };
+    uint32_t const  head[2] = { BENCH_TRAIN_HIDDEN, 10 };
+    uint32_t const    width = 28;
+    TASK_POOL_INIT     init;
+    MINIBATCH         batch;
+    struct TASK_POOL  *pool = NULL;
+    float     direct_loss = 0.0f;
+    float            *ref = NULL;
+    float          *state = NULL;
+    size_t   output_count = 0;
+    size_t    state_count = 0;
+    int            result = 0;
+    uint32_t   i, j, a, o;
+    char         name[64];
+
+    init.ThreadCount = 0;
+    init.Flags       = TASK_POOL_FLAG_PIN_THREADS;
+    if (TaskPoolCreate(&pool, &init) != 0) {
+        perror("ERROR: Failed to create the task pool");
+        return -1;
+    }
+    if (MinibatchCreate(&batch, BENCH_BATCH_SIZE, width * width) != 0) {
+        fprintf(stderr, "ERROR: Failed to allocate the convolution algorithm benchmark batch." END_OF_LINE);
+        TaskPoolDelete(pool);
+        return -1;
+    }
+    for (i = 0; i < BENCH_BATCH_SIZE; ++i) {
+        float *row = batch.Inputs + ((size_t) i * batch.RowStride);
+        for (j = 0; j < width * width; ++j) {
+            row[j] = (float)(((i * 31) + (j * 7)) % 17) * (1.0f / 16.0f);
+        }
+        batch.Labels[i] = (uint8_t)(i % 10);
+    }
+    batch.SampleCount = BENCH_BATCH_SIZE;
+
+    printf("conv: %ux%u conv3x3x16-conv3x3x16-pool2-conv3x3x32-pool2-1568-%u-10, batch %u, %u threads" END_OF_LINE, width, width,
+           (unsigned) BENCH_TRAIN_HIDDEN, (unsigned) BENCH_BATCH_SIZE, TaskPoolThreadCount(pool));
+    for (o = 0; o < sizeof(ORDER) / sizeof(ORDER[0]); ++o) {
+        CNN       cnn;
+        double   best[2] = { 1.0e30, 1.0e30 };
+        float    loss = 0.0f;
+        float out_diff = 0.0f;
+        float grad_diff = 0.0f;
+        uint32_t    r;
+
+        a = ORDER[o];
+        if (CnnCreate(&cnn, width, width, BENCH_CONV3_LAYERS, sizeof(BENCH_CONV3_LAYERS) / sizeof(BENCH_CONV3_LAYERS[0]), head, 2, BENCH_BATCH_SIZE, BENCH_TRAIN_SEED) != 0 ||
+            CnnSetTaskPool(&cnn, pool) != 0 || CnnSetAlgorithm(&cnn, a) != 0) {
+            perror("ERROR: Failed to create the convolution algorithm benchmark network");
+            CnnDelete(&cnn);
+            result = -1;
+            break;
+        }
+        loss = CnnTrainBatch(&cnn, &batch, BENCH_MIXED_LEARNING_RATE);
+        state_count = BenchConvSnapshot(&cnn, batch.SampleCount, NULL, &output_count);
+        if (ref == NULL && ((ref = (float*) malloc(state_count * sizeof(float))) == NULL || (state = (float*) malloc(state_count * sizeof(float))) == NULL)) {
+            fprintf(stderr, "ERROR: Failed to allocate the convolution algorithm check buffers." END_OF_LINE);
+            CnnDelete(&cnn);
+            result = -1;
+            break;
+        }
+        (void) BenchConvSnapshot(&cnn, batch.SampleCount, a == CNN_ALGORITHM_DIRECT ? ref : state, &output_count);
+        if (a != CNN_ALGORITHM_DIRECT) {
+            out_diff  = BenchMaxAbsDiff(ref, state, output_count);
+            grad_diff = BenchMaxAbsDiff(ref + output_count, state + output_count, state_count - output_count);
+        }
+        for (r = 0; r < BENCH_REPEAT_COUNT; ++r) {
+            double t0 = TimestampSeconds();
+            for (i = 0; i < BENCH_CONV_BATCH_COUNT; ++i) {
+                CnnForward(&cnn, batch.Inputs, batch.RowStride, batch.SampleCount);
+            }
+            double t1 = TimestampSeconds();
+            for (i = 0; i < BENCH_CONV_BATCH_COUNT; ++i) {
+                (void) CnnTrainBatch(&cnn, &batch, BENCH_MIXED_LEARNING_RATE);
+            }
+            double t2 = TimestampSeconds();
+            if ((t1 - t0) < best[0]) {
+                best[0] = t1 - t0;
+            }
+            if ((t2 - t1) < best[1]) {
+                best[1] = t2 - t1;
+            }
+        }
+        best[0] /= BENCH_CONV_BATCH_COUNT;
+        best[1] /= BENCH_CONV_BATCH_COUNT;
+        if (a == CNN_ALGORITHM_DIRECT) {
+            direct_loss = loss;
+        } else if (!(fabsf(loss - direct_loss) <= 1.0e-4f * direct_loss)) {
+            fprintf(stderr, "ERROR: %s first-batch loss %.6f differs from direct loss %.6f." END_OF_LINE, NAMES[a], (double) loss, (double) direct_loss);
+            result = -1;
+        }
+        if (out_diff > BENCH_CONV_MAX_DIFF || grad_diff > BENCH_CONV_MAX_DIFF) {
+            fprintf(stderr, "ERROR: %s activations differ from direct convolution by %g and weight gradients by %g." END_OF_LINE, NAMES[a], (double) out_diff, (double) grad_diff);
+            result = -1;
+        }
+        printf("  %-8s forward %8.3f ms/batch, train %8.3f ms/batch %8.0f samples/s, first-batch loss %.5f, max_diff=%g/%g" END_OF_LINE, NAMES[a],
+               best[0] * 1000.0, best[1] * 1000.0, BENCH_BATCH_SIZE / best[1], (double) loss, (double) out_diff, (double) grad_diff);
+        (void) snprintf(name, sizeof(name), "forward_%s_3x3", NAMES[a]);
+        BenchRecord("conv", name, BENCH_BATCH_SIZE / best[0], "samples/s");
+        (void) snprintf(name, sizeof(name), "train_%s_3x3", NAMES[a]);
+        BenchRecord("conv", name, BENCH_BATCH_SIZE / best[1], "samples/s");
+        CnnDelete(&cnn);
+    }
+    free(state);
+    free(ref);
+    MinibatchDelete(&batch);
+    TaskPoolDelete(pool);
+    return result;
+}
+
+/* @summary Time the strlib functions on the hot paths of text and path handling: codepoint iteration, case-insensitive comparison and base64 encoding and decoding.
+ * @return Zero if every function produced the expected result, or -1 if a mismatch or allocation failure occurred.
+ */
+static int
+BenchmarkStrings
+(
+    void
+)
+{
+    static char const *WORDS[] = {
+        "mnist/", "train-images ", "\xC3\x9C" "n\xC3\xAF" "c\xC3\xB6" "d\xC3\xA9 ", "\xE3\x83\x87\xE3\x83\xBC\xE3\x82\xBF ", "Path_", "\xF0\x9F\x98\x80 "
+    };
+    size_t const    size = BENCH_TEXT_BYTES;
+    char8_t        *text = (char8_t*) malloc(size);
+    char8_t       *upper = (char8_t*) malloc(size);
+    uint8_t         *bin = (uint8_t*) malloc(size);
+    char8_t         *b64 = NULL;
+    uint8_t         *dec = NULL;
+    char16_t        *u16 = NULL;
+    char32_t        *u32 = NULL;
+    char8_t          *u8 = NULL;
+    char8_t       *ascii = NULL;
+    size_t       b64_max = Base64SizeForBinary(NULL, size);
+    size_t       b64_len = b64_max - 1;
+    size_t           len = 0;
+    size_t         chars = 0;
+    uint64_t         rng = 0x9E3779B97F4A7C15ULL;
+    double          time[4];
+    int           result = 0;
+    size_t          i, w;
+    uint32_t          op;
+
+    if (text == NULL || upper == NULL || bin == NULL || (b64 = (char8_t*) malloc(b64_max)) == NULL ||
+       (dec = (uint8_t*) malloc(BinarySizeForBase64(b64_len))) == NULL) {
+        fprintf(stderr, "ERROR: Failed to allocate string buffers." END_OF_LINE);
+        result = -1;
+        goto cleanup_and_exit;
+    }
+    for (w = 0; ; w = (w + 1) % (sizeof(WORDS) / sizeof(WORDS[0]))) {
+        size_t n = strlen(WORDS[w]);
+        if (len + n >= size) {
+            break;
+        }
+        memcpy(text + len, WORDS[w], n);
+        len += n;
+    }
+    text[len] = 0;
+    for (i = 0; i <= len; ++i) {
+        upper[i] = (text[i] >= 'a' && text[i] <= 'z') ? (char8_t)(text[i] - 'a' + 'A') : text[i];
+    }
+    for (i = 0; i < size; ++i) {
+        rng ^= rng >> 12; rng ^= rng << 25; rng ^= rng >> 27;
+        bin[i] = (uint8_t)((rng * 0x2545F4914F6CDD1DULL) >> 56);
+    }
+
+    /* 0: codepoint iteration, 1: case-insensitive compare, 2: base64 encode, 3: base64 decode */
+    for (op = 0; op < 4; ++op) {
+        uint32_t r;
+        time[op] = 1.0e30;
+        for (r = 0; r < BENCH_REPEAT_COUNT; ++r) {
+            char8_t const *itr = text;
+            char32_t        cp = 0;
+            size_t      numdst = 0;
+            int            res = 0;
+            double t0 = TimestampSeconds();
+            switch (op) {
+                case 0:
+                    chars = 0;
+                    while ((itr = Utf8StringNextCodepoint(&cp, NULL, itr)) != NULL && cp != 0) {
+                        chars++;
+                    }
+                    res = (itr == NULL);
+                    break;
+                case 1:
+                    res = Utf8StringCompareNoCase(text, upper);
+                    break;
+                case 2:
+                    res = Base64Encode(&numdst, b64, b64_max, bin, size);
+                    break;
+                case 3:
+                    res = Base64Decode(&numdst, dec, BinarySizeForBase64(b64_len), b64, b64_len);
+                    break;
+            }
+            double t1 = TimestampSeconds();
+            if (res != 0) {
+                fprintf(stderr, "ERROR: String benchmark %u failed." END_OF_LINE, op);
+                result = -1;
+                goto cleanup_and_exit;
+            }
+            if ((t1 - t0) < time[op]) {
+                time[op] = t1 - t0;
+            }
+        }
+    }
+    if (memcmp(bin, dec, size) != 0) {
+        fprintf(stderr, "ERROR: Base64 round trip does not match." END_OF_LINE);
+        result = -1;
+    }
+    printf("strings: %u KB of UTF-8 text (%u codepoints), %u KB of binary data" END_OF_LINE, (unsigned)(len / 1024), (unsigned) chars, (unsigned)(size / 1024));
+    printf("  %-16s %8.3f ms %8.2f MB/s" END_OF_LINE, "next_codepoint" , time[0] * 1000.0, len / time[0] * 1.0e-6);
+    printf("  %-16s %8.3f ms %8.2f MB/s" END_OF_LINE, "compare_nocase" , time[1] * 1000.0, len / time[1] * 1.0e-6);
+    printf("  %-16s %8.3f ms %8.2f MB/s" END_OF_LINE, "base64_encode"  , time[2] * 1000.0, size / time[2] * 1.0e-6);
+    printf("  %-16s %8.3f ms %8.2f MB/s" END_OF_LINE, "base64_decode"  , time[3] * 1000.0, size / time[3] * 1.0e-6);
+    BenchRecord("strlib", "next_codepoint", len  / time[0] * 1.0e-6, "MB/s");
+    BenchRecord("strlib", "compare_nocase", len  / time[1] * 1.0e-6, "MB/s");
+    BenchRecord("strlib", "base64_encode" , size / time[2] * 1.0e-6, "MB/s");
+    BenchRecord("strlib", "base64_decode" , size / time[3] * 1.0e-6, "MB/s");
+
+    /* UTF-8 validation and transcoding, per kernel; every kernel must agree with the scalar one */
+    if ((u16 = (char16_t*) malloc((len + 1) * sizeof(char16_t))) == NULL ||
+        (u32 = (char32_t*) malloc((len + 1) * sizeof(char32_t))) == NULL ||
+        (u8  = (char8_t *) malloc( len + 1)) == NULL ||
+        (ascii = (char8_t *) malloc(len + 1)) == NULL) {
+        fprintf(stderr, "ERROR: Failed to allocate transcoding buffers." END_OF_LINE);
+        result = -1;
+        goto cleanup_and_exit;
+    }
+    for (i = 0; i <= len; ++i) { /* the upper case text with every non-ASCII byte replaced, to time the ASCII fast paths */
+        ascii[i] = ((uint8_t) upper[i] < 0x80) ? upper[i] : '_';
+    }
+    for (op = 0; op < UTF8_KERNEL_COUNT; ++op) {
+        static char const *OPS[] = { "validate", "to_utf16", "to_utf32", "from_utf16", "from_utf32", "to_utf16_ascii", "from_utf16_ascii", "fold_case_ascii", "compare_nocase", "compare_nocase_ascii" };
+        size_t n16 = 0; /* the UTF-16 and UTF-32 lengths of the text, including the nul */
+        size_t n32 = 0;
+        uint32_t x;
+        if (Utf8SelectKernel(op) != 0) {
+            printf("  %-8s unsupported" END_OF_LINE, Utf8KernelName(op));
+            continue;
+        }
+        for (x = 0; x < sizeof(OPS) / sizeof(OPS[0]); ++x) {
+            double   best = 1.0e30;
+            size_t nbytes = 0;
+            size_t nchars = 0;
+            uint32_t    r;
+            char     name[32];
+            for (r = 0; r < BENCH_REPEAT_COUNT; ++r) {
+                int     res = 0;
+                double   t0 = TimestampSeconds();
+                switch (x) {
+                    case 0: res = Utf8StringValidate(&nbytes, &nchars, text); break;
+                    case 1: res = Utf8TranscodeToUtf16(&n16, u16, len + 1, text, len); break;
+                    case 2: res = Utf8TranscodeToUtf32(&n32, u32, len + 1, text, len); break;
+                    case 3: res = Utf8TranscodeFromUtf16(&nbytes, u8, len + 1, u16, n16 - 1); break;
+                    case 4: res = Utf8TranscodeFromUtf32(&nbytes, u8, len + 1, u32, n32 - 1); break;
+                    case 5: res = Utf8TranscodeToUtf16(&nchars, u16, len + 1, ascii, len); break;
+                    case 6: res = Utf8TranscodeFromUtf16(&nbytes, u8, len + 1, u16, len); break;
+                    case 7: res = Utf8StringFoldCase(&nbytes, u8, len + 1, ascii); break;
+                    case 8: res = Utf8StringCompareNoCase(text, upper); break;
+                    case 9: res = Utf8StringCompareNoCase(ascii, u8); break;
+                }
+                double   t1 = TimestampSeconds();
+                if (res != 0 || (x == 0 && (nbytes != len || nchars != chars)) || (x == 2 && n32 != chars + 1) ||
+                   (x >= 3 && x <= 4 && (nbytes != len + 1 || memcmp(u8, text, len + 1) != 0)) ||
+                   (x >= 6 && x <= 7 && nbytes != len + 1) || (x == 6 && memcmp(u8, ascii, len + 1) != 0)) {
+                    fprintf(stderr, "ERROR: UTF-8 %s with kernel %s returned %d, %zu bytes, %zu units." END_OF_LINE, OPS[x], Utf8KernelName(op), res, nbytes, nchars);
+                    result = -1;
+                    goto cleanup_and_exit;
+                }
+                if ((t1 - t0) < best) {
+                    best = t1 - t0;
+                }
+            }
+            (void) snprintf(name, sizeof(name), "%s_%s", OPS[x], Utf8KernelName(op));
+            printf("  %-28s %8.3f ms %8.2f MB/s" END_OF_LINE, name, best * 1000.0, len / best * 1.0e-6);
+            BenchRecord("strlib", name, len / best * 1.0e-6, "MB/s");
+        }
+    }
+    /* restore the default kernel selection */
+    for (op = UTF8_KERNEL_COUNT; op-- > 0; ) {
+        if (Utf8SelectKernel(op) == 0) {
+            break;
+        }
+    }
+
+cleanup_and_exit:
+    free(ascii);
+    free(u8);
+    free(u32);
+    free(u16);
+    free(b64);
+    free(dec);
+    free(bin);
+    free(upper);
+    free(text);
+    return result;
+}
+
+/* @summary Time base64 encoding and decoding with each supported kernel, both in one call and streamed in fixed-size chunks.
+ * @return Zero if every round trip reproduced the input, or -1 if an allocation or round trip failed.
+ */
+static int
+BenchmarkBase64
+(
+    void
+)
+{
+    size_t const   size = BENCH_BASE64_BYTES;
+    size_t const b64len = Base64SizeForBinary(NULL, size) - 1;
+    uint8_t        *bin = (uint8_t*) malloc(size);
+    size_t const decmax = BinarySizeForBase64(b64len);
+    uint8_t        *dec = (uint8_t*) malloc(decmax);
+    char8_t        *b64 = (char8_t*) malloc(b64len + 1);
+    uint64_t        rng = 0x9E3779B97F4A7C15ULL;
+    int          result = 0;
+    uint32_t     kernel;
+    size_t            i;
+
+    if (bin == NULL || dec == NULL || b64 == NULL) {
+        fprintf(stderr, "ERROR: Failed to allocate base64 buffers." END_OF_LINE);
+        result = -1;
+        goto cleanup_and_exit;
+    }
+    for (i = 0; i < size; ++i) {
+        rng ^= rng >> 12; rng ^= rng << 25; rng ^= rng >> 27;
+        bin[i] = (uint8_t)((rng * 0x2545F4914F6CDD1DULL) >> 56);
+    }
+    printf("base64: %u MB of binary data, %u KB stream chunks" END_OF_LINE, (unsigned)(size >> 20), (unsigned)(BENCH_BASE64_CHUNK / 1024));
+    for (kernel = 0; kernel < BASE64_KERNEL_COUNT; ++kernel) {
+        static char const *OPS[] = { "encode", "decode", "stream_encode", "stream_decode" };
+        uint32_t op;
+        if (Base64SelectKernel(kernel) != 0) {
+            printf("  %-8s unsupported" END_OF_LINE, Base64KernelName(kernel));
+            continue;
+        }
+        for (op = 0; op < 4; ++op) {
+            double best = 1.0e30;
+            char   name[64];
+            uint32_t  r;
+            for (r = 0; r < BENCH_REPEAT_COUNT; ++r) {
+                BASE64_STREAM stream;
+                size_t           num = 0;
+                size_t           out = 0;
+                size_t           pos = 0;
+                int              res = 0;
+                double            t0 = TimestampSeconds();
+                switch (op) {
+                    case 0:
+                        res = Base64Encode(&num, b64, b64len + 1, bin, size);
+                        break;
+                    case 1:
+                        res = Base64Decode(&num, dec, decmax, b64, b64len);
+                        break;
+                    case 2:
+                        Base64StreamInit(&stream);
+                        for (pos = 0; res == 0 && pos < size; pos += BENCH_BASE64_CHUNK, out += num) {
+                            size_t n = (size - pos) < BENCH_BASE64_CHUNK ? (size - pos) : BENCH_BASE64_CHUNK;
+                            res = Base64EncodeStreamUpdate(&stream, &num, b64 + out, b64len - out, bin + pos, n);
+                        }
+                        if (res == 0 && (res = Base64EncodeStreamFinal(&stream, &num, b64 + out, b64len - out)) == 0) {
+                            b64[out + num] = 0;
+                        }
+                        break;
+                    case 3:
+                        Base64StreamInit(&stream);
+                        for (pos = 0; res == 0 && pos < b64len; pos += BENCH_BASE64_CHUNK, out += num) {
+                            size_t n = (b64len - pos) < BENCH_BASE64_CHUNK ? (b64len - pos) : BENCH_BASE64_CHUNK;
+                            res = Base64DecodeStreamUpdate(&stream, &num, dec + out, decmax - out, b64 + pos, n);
+                        }
+                        if (res == 0) {
+                            res = Base64DecodeStreamFinal(&stream);
+                        }
+                        break;
+                }
+                double t1 = TimestampSeconds();
+                if (res != 0) {
+                    fprintf(stderr, "ERROR: Base64 %s with kernel %s failed." END_OF_LINE, OPS[op], Base64KernelName(kernel));
+                    result = -1;
+                    goto cleanup_and_exit;
+                }
+                if ((t1 - t0) < best) {
+                    best = t1 - t0;
+                }
+            }
+            if ((op & 1) != 0 && memcmp(bin, dec, size) != 0) {
+                fprintf(stderr, "ERROR: Base64 %s with kernel %s does not reproduce the input." END_OF_LINE, OPS[op], Base64KernelName(kernel));
+                result = -1;
+                goto cleanup_and_exit;
+            }
+            if ((op & 1) != 0) {
+                memset(dec, 0, size);
+            }
+            (void) snprintf(name, sizeof(name), "%s_%s", OPS[op], Base64KernelName(kernel));
+            printf("  %-22s %8.3f ms %8.2f MB/s" END_OF_LINE, name, best * 1000.0, size / best * 1.0e-6);
+            BenchRecord("base64", name, size / best * 1.0e-6, "MB/s");
+        }
+    }
+    /* restore the default kernel selection */
+    for (kernel = BASE64_KERNEL_COUNT; kernel-- > 0; ) {
+        if (Base64SelectKernel(kernel) == 0) {
+            break;
+        }
+    }
+
+cleanup_and_exit:
+    free(b64);
+    free(dec);
+    free(bin);
+    return result;
+}
+
+/* @summary Time parsing a set of Linux-style path strings into their components one at a time and as a packed batch, and copying each path into a heap, stack or arena path buffer and parsing the copy.
+ * @return Zero if every path parsed, or -1 if a parse or allocation failure occurred.
+ */
+static int
+BenchmarkPaths
+(
+    void
+)
+{
+    static char const *MODES[] = { "linux_parse", "buffer_heap", "buffer_stack", "buffer_arena", "linux_parse_batch", "append" };
+    size_t const  stride = 128;
+    char8_t       *paths = (char8_t*) malloc(BENCH_PATH_COUNT * stride);
+    char8_t        *blob = (char8_t*) malloc(BENCH_PATH_COUNT * stride);
+    size_t      blob_len = 0;
+    MEMORY_ARENA   arena;
+    PATH_PARTS_LINUX_BATCH batch;
+    char8_t const  *base = "/home/user/data/mnist";
+    STRING_INFO baseinfo;
+    double       time[6] = { 1.0e30, 1.0e30, 1.0e30, 1.0e30, 1.0e30, 1.0e30 };
+    int           result = 0;
+    uint32_t     i, r, m;
+
+    Utf8StringInfo(&baseinfo, base);
+    memset(&arena, 0, sizeof(MEMORY_ARENA));
+    memset(&batch, 0, sizeof(PATH_PARTS_LINUX_BATCH));
+    if (paths == NULL || blob == NULL || ArenaCreate(&arena, (size_t) BENCH_PATH_COUNT * PATH_BUFFER_MAX_BYTES, ARENA_FLAGS_NONE) != 0 || LinuxPathBatchCreate(&batch, BENCH_PATH_COUNT) != 0) {
+        fprintf(stderr, "ERROR: Failed to allocate path buffers." END_OF_LINE);
+        result = -1;
+        goto cleanup_and_exit;
+    }
+    for (i = 0; i < BENCH_PATH_COUNT; ++i) {
+        int n = snprintf(paths + (i * stride), stride, "%s/mnist/shard-%04u/%s-images-idx3-ubyte.%u", (i & 1) ? "/home/user/data" : "../data", i, (i & 2) ? "train" : "t10k", i % 7);
+        memcpy(blob + blob_len, paths + (i * stride), (size_t) n + 1);
+        blob_len += (size_t) n + 1;
+    }
+    /* 0: parse in place, 1: copy to a heap buffer, 2: copy to a stack buffer, 3: copy to an arena buffer, 4: parse the packed strings as one batch, 5: join to a base directory in a stack buffer */
+    for (m = 0; m < 6; ++m) {
+        for (r = 0; r < BENCH_REPEAT_COUNT; ++r) {
+            PATH_PARTS_LINUX parts;
+            STRING_INFO      sinfo;
+            char8_t          local[PATH_BUFFER_MAX_BYTES];
+            char8_t         *buf = NULL;
+            size_t          used = 0;
+            double t0 = TimestampSeconds();
+            if (m == 4) {
+                if (LinuxPathStringParseBatch(&batch, &used, blob, blob_len) != 0 || batch.PathCount != BENCH_PATH_COUNT || used != blob_len) {
+                    fprintf(stderr, "ERROR: Failed to parse %u packed paths." END_OF_LINE, (unsigned) BENCH_PATH_COUNT);
+                    result = -1;
+                    goto cleanup_and_exit;
+                }
+            }
+            for (i = 0; m == 5 && i < BENCH_PATH_COUNT; ++i) {
+                (void) LinuxPathBufferInit(&sinfo, NULL, local, &baseinfo, base);
+                if (LinuxPathBufferAppend(&sinfo, &sinfo, NULL, local, paths + (i * stride)) == NULL) {
+                    fprintf(stderr, "ERROR: Failed to append path %s." END_OF_LINE, paths + (i * stride));
+                    result = -1;
+                    goto cleanup_and_exit;
+                }
+            }
+            for (i = 0; m < 4 && i < BENCH_PATH_COUNT; ++i) {
+                switch (m) {
+                    case 0: buf = paths + (i * stride); break;
+                    case 1: buf = LinuxPathBufferCreate(&sinfo, NULL, NULL, paths + (i * stride)); break;
+                    case 2: buf = LinuxPathBufferInit(&sinfo, NULL, local, NULL, paths + (i * stride)); break;
+                    case 3: buf = LinuxPathBufferCreateInArena(&sinfo, NULL, &arena, NULL, paths + (i * stride)); break;
+                }
+                if (buf == NULL || LinuxPathStringParse(&parts, NULL, (m == 0) ? NULL : &sinfo, buf) != 0) {
+                    fprintf(stderr, "ERROR: Failed to parse path %s." END_OF_LINE, paths + (i * stride));
+                    result = -1;
+                    goto cleanup_and_exit;
+                }
+                if (m == 1) {
+                    PathBufferDelete(buf);
+                }
+            }
+            ArenaReset(&arena);
+            double t1 = TimestampSeconds();
+            if ((t1 - t0) < time[m]) {
+                time[m] = t1 - t0;
+            }
+        }
+    }
+    printf("paths: %u Linux path strings" END_OF_LINE, (unsigned) BENCH_PATH_COUNT);
+    for (m = 0; m < 6; ++m) {
+        printf("  %-16s %8.1f ns/path" END_OF_LINE, MODES[m], time[m] / BENCH_PATH_COUNT * 1.0e9);
+        BenchRecord("pathlib", MODES[m], time[m] / BENCH_PATH_COUNT * 1.0e9, "ns/path");
+    }
+
+cleanup_and_exit:
+    LinuxPathBatchDelete(&batch);
+    ArenaDelete(&arena);
+    free(blob);
+    free(paths);
+    return result;
+}
+
+/* @summary Time interning a set of path strings, looking them up again by string, and comparing interned paths by id rather than by string.
+ * @return Zero if every lookup returned the id assigned at insertion, or -1 if an allocation failed or a lookup disagreed.
+ */
+static int
+BenchmarkPathIntern
+(
+    void
+)
+{
+    static char const *MODES[] = { "intern_insert", "intern_find", "compare_strings", "compare_ids" };
+    size_t const  stride = 128;
+    char8_t       *paths = (char8_t *) malloc(BENCH_PATH_COUNT * stride);
+    uint32_t        *ids = (uint32_t*) malloc(BENCH_PATH_COUNT * sizeof(uint32_t));
+    PATH_INTERN_TABLE table;
+    double       time[4] = { 1.0e30, 1.0e30, 1.0e30, 1.0e30 };
+    size_t       matches = 0;
+    int           result = 0;
+    uint32_t     i, r, m;
+
+    memset(&table, 0, sizeof(PATH_INTERN_TABLE));
+    if (paths == NULL || ids == NULL) {
+        fprintf(stderr, "ERROR: Failed to allocate path buffers." END_OF_LINE);
+        result = -1;
+        goto cleanup_and_exit;
+    }
+    for (i = 0; i < BENCH_PATH_COUNT; ++i) {
+        (void) snprintf(paths + (i * stride), stride, "/home/user/data/mnist/shard-%04u/%s-images-idx3-ubyte", i, (i & 1) ? "train" : "t10k");
+    }
+    /* 0: intern into an empty table, 1: find every path, 2: compare adjacent paths by string, 3: compare adjacent paths by id */
+    for (m = 0; m < 4; ++m) {
+        for (r = 0; r < BENCH_REPEAT_COUNT; ++r) {
+            if (m == 0 && LinuxPathInternTableCreate(&table, BENCH_PATH_COUNT, (size_t) BENCH_PATH_COUNT * stride) != 0) {
+                fprintf(stderr, "ERROR: Failed to create path intern table." END_OF_LINE);
+                result = -1;
+                goto cleanup_and_exit;
+            }
+            double t0 = TimestampSeconds();
+            for (i = 0; i < BENCH_PATH_COUNT; ++i) {
+                uint32_t id = PATH_INTERN_INVALID_ID;
+                switch (m) {
+                    case 0: (void) LinuxPathIntern(&ids[i], &table, NULL, paths + (i * stride)); break;
+                    case 1: (void) LinuxPathInternFind(&id, &table, NULL, paths + (i * stride)); break;
+                    case 2: matches += (Utf8StringCompare(paths + (i * stride), paths + (((i + 1) % BENCH_PATH_COUNT) * stride)) == 0); break;
+                    case 3: matches += (ids[i] == ids[(i + 1) % BENCH_PATH_COUNT]); break;
+                }
+                if ((m == 0 && ids[i] != i) || (m == 1 && id != i)) {
+                    fprintf(stderr, "ERROR: Path %s was not interned with id %u." END_OF_LINE, paths + (i * stride), i);
+                    result = -1;
+                    goto cleanup_and_exit;
+                }
+            }
+            double t1 = TimestampSeconds();
+            if ((t1 - t0) < time[m]) {
+                time[m] = t1 - t0;
+            }
+            if (m == 0 && r + 1 < BENCH_REPEAT_COUNT) {
+                LinuxPathInternTableDelete(&table);
+            }
+        }
+    }
+    printf("intern: %u Linux path strings, %zu matches" END_OF_LINE, (unsigned) BENCH_PATH_COUNT, matches);
+    for (m = 0; m < 4; ++m) {
+        printf("  %-16s %8.1f ns/path" END_OF_LINE, MODES[m], time[m] / BENCH_PATH_COUNT * 1.0e9);
+        BenchRecord("pathlib", MODES[m], time[m] / BENCH_PATH_COUNT * 1.0e9, "ns/path");
+    }
+
+cleanup_and_exit:
+    LinuxPathInternTableDelete(&table);
+    free(ids);
+    free(paths);
+    return result;
+}
+
+/* @summary Compare two path strings without regard to case, for use with qsort.
+ */
+static int
+CompareNamesNoCase
+(
+    void const *a,
+    void const *b
+)
+{
+    return Utf8StringCompareNoCase(*(char8_t const* const*) a, *(char8_t const* const*) b);
+}
+
+/* @summary Compare two case-folded keys, for use with qsort.
+ */
+static int
+CompareFoldedKeys
+(
+    void const *a,
+    void const *b
+)
+{
+    return Utf8StringCompare(*(char8_t const* const*) a, *(char8_t const* const*) b);
+}
+
+/* @summary Time sorting and deduplicating a set of file names without regard to case, comparing the names directly and comparing precomputed case-folded keys.
+ * Computing the keys and sorting them are timed separately, since the keys are computed once but may be sorted or searched many times.
+ * Every other name differs from its predecessor only in case, so half of the names are duplicates.
+ * @return Zero if both methods found the same number of distinct names, or -1 if an allocation failed or the methods disagree.
+ */
+static int
+BenchmarkSortNames
+(
+    void
+)
+{
+    size_t const  stride = 128;
+    char8_t       *names = (char8_t *) malloc(BENCH_PATH_COUNT * stride);
+    char8_t        *keys = (char8_t *) malloc(BENCH_PATH_COUNT * stride);
+    char8_t const **list = (char8_t const**) malloc(BENCH_PATH_COUNT * sizeof(char8_t const*));
+    uint64_t         rng = 0x9E3779B97F4A7C15ULL;
+    double       time[2] = { 1.0e30, 1.0e30 };
+    double     fold_time = 1.0e30;
+    size_t       uniq[2] = { 0, 0 };
+    int           result = 0;
+    uint32_t     i, r, m;
+
+    if (names == NULL || keys == NULL || list == NULL) {
+        fprintf(stderr, "ERROR: Failed to allocate name buffers." END_OF_LINE);
+        result = -1;
+        goto cleanup_and_exit;
+    }
+    for (i = 0; i < BENCH_PATH_COUNT; ++i) {
+        char8_t *name = names + (i * stride);
+        uint32_t    k = (uint32_t)((i >> 1) * 2654435761U) % BENCH_PATH_COUNT;
+        (void) snprintf(name, stride, "/home/user/data/mnist/shard-%04u/%s-images-idx3-ubyte", k, (k & 1) ? "train" : "t10k");
+        for ( ; *name; ++name) {
+            rng ^= rng >> 12; rng ^= rng << 25; rng ^= rng >> 27;
+            if ((rng & 1) && *name >= 'a' && *name <= 'z') {
+                *name = (char8_t)(*name - 'a' + 'A');
+            }
+        }
+    }
+    for (r = 0; r < BENCH_REPEAT_COUNT; ++r) {
+        double t0 = TimestampSeconds();
+        for (i = 0; i < BENCH_PATH_COUNT; ++i) {
+            size_t n;
+            (void) Utf8StringFoldCase(&n, keys + (i * stride), stride, names + (i * stride));
+        }
+        double t1 = TimestampSeconds();
+        if ((t1 - t0) < fold_time) {
+            fold_time = t1 - t0;
+        }
+    }
+    /* 0: compare the names, 1: compare the folded keys */
+    for (m = 0; m < 2; ++m) {
+        char8_t const *base = (m == 0) ? names : keys;
+        for (r = 0; r < BENCH_REPEAT_COUNT; ++r) {
+            double t0 = TimestampSeconds();
+            for (i = 0; i < BENCH_PATH_COUNT; ++i) {
+                list[i] = base + (i * stride);
+            }
+            qsort(list, BENCH_PATH_COUNT, sizeof(char8_t const*), (m == 0) ? CompareNamesNoCase : CompareFoldedKeys);
+            for (uniq[m] = 1, i = 1; i < BENCH_PATH_COUNT; ++i) {
+                if (((m == 0) ? CompareNamesNoCase(&list[i-1], &list[i]) : CompareFoldedKeys(&list[i-1], &list[i])) != 0) {
+                    uniq[m]++;
+                }
+            }
+            double t1 = TimestampSeconds();
+            if ((t1 - t0) < time[m]) {
+                time[m] = t1 - t0;
+            }
+        }
+    }
+    if (uniq[0] != uniq[1]) {
+        fprintf(stderr, "ERROR: Sorting by name found %zu distinct names, sorting by key found %zu." END_OF_LINE, uniq[0], uniq[1]);
+        result = -1;
+        goto cleanup_and_exit;
+    }
+    printf("sort: %u file names, %zu distinct ignoring case" END_OF_LINE, (unsigned) BENCH_PATH_COUNT, uniq[0]);
+    printf("  %-16s %8.3f ms" END_OF_LINE, "sort_nocase", time[0] * 1000.0);
+    printf("  %-16s %8.3f ms %8.1f ns/name" END_OF_LINE, "fold_keys", fold_time * 1000.0, fold_time * 1.0e9 / BENCH_PATH_COUNT);
+    printf("  %-16s %8.3f ms" END_OF_LINE, "sort_keys", time[1] * 1000.0);
+    printf("  %-16s %8.3f ms" END_OF_LINE, "sort_folded", (fold_time + time[1]) * 1000.0);
+    BenchRecord("strlib", "sort_nocase", time[0] * 1000.0, "ms");
+    BenchRecord("strlib", "fold_keys"  , fold_time * 1000.0, "ms");
+    BenchRecord("strlib", "sort_keys"  , time[1] * 1000.0, "ms");
+    BenchRecord("strlib", "sort_folded", (fold_time + time[1]) * 1000.0, "ms");
+
+cleanup_and_exit:
+    free(list);
+    free(keys);
+    free(names);
+    return result;
+}
+
+/* @summary Build the paths of one of the MNIST data sets in a directory.
+ * @param images_path The buffer receiving the image file path, of max_path bytes.
+ * @param labels_path The buffer receiving the label file path, of max_path bytes.
+ * @param max_path The size of each path buffer, in bytes.
+ * @param dir The directory containing the IDX files.
+ * @param prefix The file name prefix, "train" or "t10k".
+ * @return Zero if the paths were built, or -1 if they are too long.
+ */
+static int
+DatasetPaths
+(
+    char    *images_path,
+    char    *labels_path,
+    size_t      max_path,
+    char const      *dir,
+    char const   *prefix
+)
+{
+    if (snprintf(images_path, max_path, "%s/%s-images-idx3-ubyte", dir, prefix) >= (int) max_path ||
+        snprintf(labels_path, max_path, "%s/%s-labels-idx1-ubyte", dir, prefix) >= (int) max_path) {
+        fprintf(stderr, "ERROR: The data set directory path is too long." END_OF_LINE);
+        return -1;
+    }
+    return 0;
+}
+
+/* @summary Open one of the MNIST data sets in a directory, along with its float32 cache, the same way the train program does.
+ * @param o_dataset The MNIST_DATASET to initialize.
+ * @param o_cache The DATA_CACHE to initialize.
+ * @param o_source The MINIBATCH_SOURCE to initialize.
+ * @param dir The directory containing the IDX files.
+ * @param prefix The file name prefix, "train" or "t10k".
+ * @return Zero if the data set was opened, or -1 if an error occurred.
+ */
+static int
+OpenDataset
+(
+    MNIST_DATASET    *o_dataset,
+    DATA_CACHE         *o_cache,
+    MINIBATCH_SOURCE  *o_source,
+    char const             *dir,
+    char const          *prefix
+)
+{
+    char images_path[1024];
+    char labels_path[1024];
+    char  cache_path[1024];
+
+    memset(o_cache, 0, sizeof(DATA_CACHE));
+    if (DatasetPaths(images_path, labels_path, sizeof(images_path), dir, prefix) != 0 ||
+        snprintf(cache_path, sizeof(cache_path), "%s%s", images_path, DATA_CACHE_FILE_SUFFIX) >= (int) sizeof(cache_path)) {
+        return -1;
+    }
+    if (MnistDatasetOpen(o_dataset, images_path, labels_path) != 0) {
+        fprintf(stderr, "ERROR: Failed to open %s or %s." END_OF_LINE, images_path, labels_path);
+        return -1;
+    }
+    o_source->Dataset = o_dataset;
+    o_source->Cache   = NULL;
+    (void) DataCacheNormalization(&o_source->Scale, &o_source->Bias, o_dataset, DATA_CACHE_NORMALIZE_UNIT);
+    if (DataCacheOpenOrBuild(o_cache, o_dataset, cache_path, DATA_CACHE_NORMALIZE_UNIT) == 0) {
+        o_source->Cache = o_cache;
+    }
+    return 0;
+}
+
+/* @summary Check that IdxShardClassify accepts and rejects each path of BENCH_SHARD_NAMES, and assigns the expected shard index.
+ * @return Zero if every path is classified as expected, or -1 if any path is not.
+ */
+static int
+BenchCheckShardNames
+(
+    void
+)
+{
+    int    result = 0;
+    size_t       i;
+
+    for (i = 0; i < sizeof(BENCH_SHARD_NAMES) / sizeof(BENCH_SHARD_NAMES[0]); ++i) {
+        BENCH_SHARD_NAME const *check = &BENCH_SHARD_NAMES[i];
+        PATH_PARTS_LINUX        parts;
+        IDX_SHARD               shard;
+        int32_t                 index = -1;
+        if (LinuxPathStringParse(&parts, NULL, NULL, check->Path) == 0 && IdxShardClassify(&shard, &parts) == 0) {
+            index = (int32_t) shard.ShardIndex;
+        }
+        if (index != check->ShardIndex) {
+            fprintf(stderr, "ERROR: %s classified with shard index %d, expected %d." END_OF_LINE, check->Path, (int) index, (int) check->ShardIndex);
+            result = -1;
+        }
+    }
+    return result;
+}
+
+/* @summary Time discovering the IDX shard files under a data directory, enumerating directories on the calling thread and in parallel on a task pool.
+ * @param dir The directory to scan.
+ * The shard names of BENCH_SHARD_NAMES are checked first.
+ * @return Zero if the shard names are classified as expected and both scans found the same shards, or -1 if an error occurred.
+ */
+static int
+BenchmarkDirectoryScan
+(
+    char const *dir
+)
+{
+    static char const *MODES[] = { "scan_serial", "scan_parallel" };
+    TASK_POOL_INIT      init;
+    DIRECTORY_SCAN_INIT scan;
+    struct TASK_POOL   *pool = NULL;
+    double          time[2] = { 1.0e30, 1.0e30 };
+    uint32_t      shards[2] = { 0, 0 };
+    uint32_t          dirs = 0;
+    uint32_t         files = 0;
+    uint32_t          r, m;
+
+    if (BenchCheckShardNames() != 0) {
+        return -1;
+    }
+    init.ThreadCount = 0;
+    init.Flags       = TASK_POOL_FLAGS_NONE;
+    if (TaskPoolCreate(&pool, &init) != 0) {
+        perror("ERROR: Failed to create the task pool");
+        return -1;
+    }
+    for (m = 0; m < 2; ++m) {
+        scan.RootPath = dir;
+        scan.TaskPool = (m == 0) ? NULL : pool;
+        scan.MaxDepth = DIRECTORY_SCAN_NO_DEPTH_LIMIT;
+        for (r = 0; r < BENCH_REPEAT_COUNT; ++r) {
+            IDX_SHARD_LIST list;
+            if (IdxShardListCreate(&list, 1U << 20, 256U << 20) != 0) {
+                perror("ERROR: Failed to create the shard list");
+                TaskPoolDelete(pool);
+                return -1;
+            }
+            double t0 = TimestampSeconds();
+            if (DirectoryScanIdxShards(&list, &scan) != 0) {
+                fprintf(stderr, "ERROR: Failed to scan %s." END_OF_LINE, dir);
+                IdxShardListDelete(&list);
+                TaskPoolDelete(pool);
+                return -1;
+            }
+            double t1 = TimestampSeconds();
+            if ((t1 - t0) < time[m]) {
+                time[m] = t1 - t0;
+            }
+            shards[m] = list.ShardCount;
+            dirs      = list.DirectoryCount;
+            files     = list.FileCount;
+            IdxShardListDelete(&list);
+        }
+    }
+    printf("dirscan: %u shards in %u files, %u directories, %u threads" END_OF_LINE, shards[0], files, dirs, TaskPoolThreadCount(pool));
+    for (m = 0; m < 2; ++m) {
+        printf("  %-16s %8.3f ms" END_OF_LINE, MODES[m], time[m] * 1000.0);
+        BenchRecord("dirscan", MODES[m], time[m] * 1000.0, "ms");
+    }
+    TaskPoolDelete(pool);
+    return (shards[0] == shards[1]) ? 0 : -1;
+}
+
+/* @summary Time writing BENCH_IDX_DIMENSIONS arrays of every IDX element type with IdxFileWrite, and reading them back with IdxFileOpen and IdxFileRead.
+ * Each file is checked for the expected header, for element bytes stored MSB first, and for a payload that reads back unchanged, in full and as a range at the end.
+ * @return Zero if every element type round-trips, or -1 if a check failed or an error occurred.
+ */
+static int
+BenchmarkIdxRoundTrip
+(
+    void
+)
+{
+    static uint32_t const TYPES[] = { IDX_TYPE_U8, IDX_TYPE_I8, IDX_TYPE_I16, IDX_TYPE_I32, IDX_TYPE_F32, IDX_TYPE_F64 };
+    static char const    *NAMES[] = { "u8", "i8", "i16", "i32", "f32", "f64" };
+    uint32_t const         ndims = sizeof(BENCH_IDX_DIMENSIONS) / sizeof(BENCH_IDX_DIMENSIONS[0]);
+    uint16_t const           one = 1;
+    int const      little_endian = *((uint8_t const*) &one) == 1;
+    size_t                 count = 1;
+    uint8_t                 *src = NULL;
+    uint8_t                 *dst = NULL;
+    int                   result = 0;
+    uint32_t             t, r, d;
+    size_t                     i;
+    char                name[64];
+
+    for (d = 0; d < ndims; ++d) {
+        count *= BENCH_IDX_DIMENSIONS[d];
+    }
+    if ((src = (uint8_t*) malloc(count * sizeof(double))) == NULL || (dst = (uint8_t*) malloc(count * sizeof(double))) == NULL) {
+        fprintf(stderr, "ERROR: Failed to allocate the IDX round-trip buffers." END_OF_LINE);
+        result = -1;
+        goto cleanup_and_exit;
+    }
+    /* every byte of an element differs, so a missing or misplaced byte swap is visible */
+    for (i = 0; i < count * sizeof(double); ++i) {
+        src[i] = (uint8_t)((i * 131) + 7);
+    }
+
+    printf("idx: write and read back %u x %u x %u arrays" END_OF_LINE, BENCH_IDX_DIMENSIONS[0], BENCH_IDX_DIMENSIONS[1], BENCH_IDX_DIMENSIONS[2]);
+    for (t = 0; t < sizeof(TYPES) / sizeof(TYPES[0]); ++t) {
+        uint32_t  esize = IdxElementSize(TYPES[t]);
+        size_t   nbytes = count * esize;
+        double  best[2] = { 1.0e30, 1.0e30 };
+        for (r = 0; r < BENCH_REPEAT_COUNT; ++r) {
+            IDX_FILE   file;
+            uint8_t const *raw;
+            int          valid = 1;
+            double t0 = TimestampSeconds();
+            if (IdxFileWrite(BENCH_IDX_SCRATCH_PATH, TYPES[t], ndims, BENCH_IDX_DIMENSIONS, src) != 0) {
+                perror("ERROR: Failed to write the IDX round-trip file");
+                result = -1;
+                goto cleanup_and_exit;
+            }
+            double t1 = TimestampSeconds();
+            if (IdxFileOpen(&file, BENCH_IDX_SCRATCH_PATH, FILE_MAPPING_HINT_SEQUENTIAL) != 0 || IdxFileRead(&file, dst, 0, count) != 0) {
+                perror("ERROR: Failed to read back the IDX round-trip file");
+                IdxFileClose(&file);
+                result = -1;
+                goto cleanup_and_exit;
+            }
+            double t2 = TimestampSeconds();
+            if ((t1 - t0) < best[0]) {
+                best[0] = t1 - t0;
+            }
+            if ((t2 - t1) < best[1]) {
+                best[1] = t2 - t1;
+            }
+            if (r == 0) {
+                valid = file.Header.TypeCode == TYPES[t] && file.Header.ElementSize == esize && file.Header.DimensionCount == ndims &&
+                        file.Header.HeaderSize == 4 + (ndims * 4) && file.Header.ElementCount == count && memcmp(dst, src, nbytes) == 0;
+                for (d = 0; valid && d < ndims; ++d) {
+                    valid = file.Header.Dimensions[d] == BENCH_IDX_DIMENSIONS[d];
+                }
+                raw = (uint8_t const*) file.Data;
+                for (i = 0; valid && i < nbytes; ++i) {
+                    size_t b = i % esize;
+                    valid = raw[i] == src[little_endian ? (i - b) + (esize - 1 - b) : i];
+                }
+                /* a range ending at the last element reads back, and a range one element past the end is rejected */
+                valid = valid && IdxFileRead(&file, dst, count - 5, 5) == 0 && memcmp(dst, src + ((count - 5) * esize), 5 * esize) == 0;
+                valid = valid && IdxFileRead(&file, dst, count - 5, 6) != 0;
+            }
+            IdxFileClose(&file);
+            if (!valid) {
+                fprintf(stderr, "ERROR: The %s IDX file did not round-trip through IdxFileWrite and IdxFileRead." END_OF_LINE, NAMES[t]);
+                result = -1;
+                break;
+            }
+        }
+        printf("  %-4s write %8.3f ms %8.2f GB/s, read %8.3f ms %8.2f GB/s" END_OF_LINE, NAMES[t],
+               best[0] * 1000.0, nbytes / best[0] * 1.0e-9, best[1] * 1000.0, nbytes / best[1] * 1.0e-9);
+        (void) snprintf(name, sizeof(name), "write_%s", NAMES[t]);
+        BenchRecord("idx", name, nbytes / best[0] * 1.0e-9, "GB/s");
+        (void) snprintf(name, sizeof(name), "read_%s", NAMES[t]);
+        BenchRecord("idx", name, nbytes / best[1] * 1.0e-9, "GB/s");
+    }
+
+cleanup_and_exit:
+    (void) remove(BENCH_IDX_SCRATCH_PATH);
+    free(dst);
+    free(src);
+    return result;
+}
+
+/* @summary Time opening the MNIST training set and reading every pixel and label.
+ * @param dir The directory containing the IDX files.
+ * @return Zero if the benchmark ran, or -1 if the data set could not be opened.
+ */
+static int
+BenchmarkIdxLoad
+(
+    char const *dir
+)
+{
+    char   images_path[1024];
+    char   labels_path[1024];
+    double        best = 1.0e30;
+    size_t       bytes = 0;
+    uint32_t         r;
+
+    if (DatasetPaths(images_path, labels_path, sizeof(images_path), dir, "train") != 0) {
+        return -1;
+    }
+    for (r = 0; r < BENCH_REPEAT_COUNT; ++r) {
+        MNIST_DATASET ds;
+        uint64_t     sum = 0;
+        size_t         i;
+        double t0 = TimestampSeconds();
+        if (MnistDatasetOpen(&ds, images_path, labels_path) != 0) {
+            fprintf(stderr, "ERROR: Failed to open %s or %s." END_OF_LINE, images_path, labels_path);
+            return -1;
+        }
+        bytes = (size_t) ds.SampleCount * (ds.ImageSize + 1);
+        for (i = 0; i < (size_t) ds.SampleCount * ds.ImageSize; ++i) {
+            sum += ds.Pixels[i];
+        }
+        for (i = 0; i < ds.SampleCount; ++i) {
+            sum += ds.Labels[i];
+        }
+        MnistDatasetClose(&ds);
+        double t1 = TimestampSeconds();
+        if ((t1 - t0) < best) {
+            best = t1 - t0;
+        }
+        if (sum == 0) {
+            fprintf(stderr, "WARNING: The training set is empty or all zero." END_OF_LINE);
+        }
+    }
+    printf("idx: open and read %u KB: %8.3f ms %8.2f GB/s" END_OF_LINE, (unsigned)(bytes / 1024), best * 1000.0, bytes / best * 1.0e-9);
+    BenchRecord("idx", "open_read_train", best * 1000.0, "ms");
+    return 0;
+}
+
+/* @summary Time a shuffled minibatch gather over the MNIST training set, with and without the sparse encoding of each batch.
+ * @param dir The directory containing the IDX files.
+ * @return Zero if the benchmark ran, or -1 if the data set could not be loaded.
+ */
+static int
+BenchmarkGather
+(
+    char const *dir
+)
+{
+    MNIST_DATASET         ds;
+    DATA_CACHE         cache;
+    MINIBATCH_SOURCE  source;
+    uint32_t          *order = NULL;
+    uint64_t             rng = 0x9E3779B97F4A7C15ULL;
+    uint32_t               i;
+    uint32_t               r;
+    uint32_t          sparse;
+
+    if (OpenDataset(&ds, &cache, &source, dir, "train") != 0) {
+        return -1;
+    }
+    if ((order = (uint32_t*) malloc(ds.SampleCount * sizeof(uint32_t))) == NULL) {
+        perror("ERROR: Failed to allocate the sample order");
+        DataCacheClose(&cache);
+        MnistDatasetClose(&ds);
+        return -1;
+    }
+    for (i = 0; i < ds.SampleCount; ++i) {
+        order[i] = i;
+    }
+    MinibatchShuffle(order, ds.SampleCount, &rng);
+
+    printf("gather: %u samples, batch %u, %s" END_OF_LINE, ds.SampleCount, (unsigned) BENCH_BATCH_SIZE,
+           source.Cache != NULL ? "from the float32 cache" : "converting on the fly");
+    for (sparse = 0; sparse < 2; ++sparse) {
+        MINIBATCH batch;
+        double     best = 1.0e30;
+        int         res = sparse ? MinibatchCreateSparse(&batch, BENCH_BATCH_SIZE, ds.ImageSize) : MinibatchCreate(&batch, BENCH_BATCH_SIZE, ds.ImageSize);
+        if (res != 0) {
+            perror("ERROR: Failed to allocate the batch");
+            break;
+        }
+        for (r = 0; r < BENCH_REPEAT_COUNT; ++r) {
+            double t0 = TimestampSeconds();
+            for (i = 0; i < ds.SampleCount; i += BENCH_BATCH_SIZE) {
+                uint32_t n = ds.SampleCount - i;
+                MinibatchGather(&batch, &source, order + i, n < BENCH_BATCH_SIZE ? n : BENCH_BATCH_SIZE);
+            }
+            double t1 = TimestampSeconds();
+            if ((t1 - t0) < best) {
+                best = t1 - t0;
+            }
+        }
+        printf("  %-8s %8.3f ms/epoch %10.0f samples/s" END_OF_LINE, sparse ? "sparse" : "dense", best * 1000.0, ds.SampleCount / best);
+        BenchRecord("gather", sparse ? "sparse" : "dense", ds.SampleCount / best, "samples/s");
+        MinibatchDelete(&batch);
+    }
+
+    free(order);
+    DataCacheClose(&cache);
+    MnistDatasetClose(&ds);
+    return 0;
+}
+
+/* @summary Train a fresh network for one epoch with asynchronous (Hogwild) SGD and time it against the synchronous epoch of BenchmarkTraining.
+ * @param sizes The layer sizes of the network, as passed to MlpCreate.
+ * @param train_source The training data.
+ * @param test_source The test data.
+ * @param pool The task pool whose threads train concurrently.
+ * @return Zero if the benchmark ran, or -1 if an error occurred.
+ */
+static int
+BenchmarkHogwild
+(
+    uint32_t const               *sizes,
+    MINIBATCH_SOURCE const *train_source,
+    MINIBATCH_SOURCE const  *test_source,
+    struct TASK_POOL               *pool
+)
+{
+    MLP                mlp;
+    uint32_t         count = train_source->Dataset->SampleCount;
+    uint32_t      *indices = NULL;
+    uint64_t           rng = BENCH_TRAIN_SEED;
+    uint32_t       correct = 0;
+    double      train_time = 0.0;
+    int             result = -1;
+    uint32_t             i;
+
+    if ((indices = (uint32_t*) malloc(count * sizeof(uint32_t))) == NULL) {
+        perror("ERROR: Failed to allocate the sample indices");
+        return -1;
+    }
+    for (i = 0; i < count; ++i) {
+        indices[i] = i;
+    }
+    MinibatchShuffle(indices, count, &rng);
+    if (MlpCreate(&mlp, sizes, 3, BENCH_BATCH_SIZE, BENCH_TRAIN_SEED) != 0) {
+        perror("ERROR: Failed to create the network");
+        goto cleanup_indices;
+    }
+    if (MlpSetTaskPool(&mlp, pool) != 0) {
+        perror("ERROR: Failed to size the network frame for the task pool");
+        goto cleanup_mlp;
+    }
+    train_time = TimestampSeconds();
+    if (MlpTrainHogwild(&mlp, train_source, indices, count, BENCH_TRAIN_HOGWILD_BATCH, BENCH_TRAIN_LEARNING_RATE, NULL) != 0) {
+        perror("ERROR: Failed to train the network");
+        goto cleanup_mlp;
+    }
+    train_time = TimestampSeconds() - train_time;
+    if (MlpEvaluate(&mlp, test_source, &correct, NULL) != 0) {
+        perror("ERROR: Failed to evaluate the network");
+        goto cleanup_mlp;
+    }
+    printf("  %-8s %8.3f s %10.0f images/s, accuracy %.2f%%, batch %u" END_OF_LINE, "hogwild", train_time, count / train_time,
+           100.0 * correct / test_source->Dataset->SampleCount, (unsigned) BENCH_TRAIN_HOGWILD_BATCH);
+    BenchRecord("train", "hogwild_epoch", count / train_time, "images/s");
+    result = 0;
+
+cleanup_mlp:
+    MlpDelete(&mlp);
+cleanup_indices:
+    free(indices);
+    return result;
+}
+
+/* @summary Quantize a trained network to int8 and time the evaluation of the test set with every supported dot-product kernel.
+ * Every kernel computes identical sums, so each must classify the same number of samples correctly.
+ * @param mlp The trained network.
+ * @param train_source The training data, used for calibration.
+ * @param test_source The test data.
+ * @param pool The task pool used for evaluation, as for the float network.
+ * @param float_correct The number of test samples classified correctly by the float network.
+ * @return Zero if the benchmark ran and the kernels agree, or -1 if an error occurred.
+ */
+static int
+BenchmarkQuantized
+(
+    MLP                             *mlp,
+    MINIBATCH_SOURCE const *train_source,
+    MINIBATCH_SOURCE const  *test_source,
+    struct TASK_POOL               *pool,
+    uint32_t                float_correct
+)
+{
+    QUANT_MLP         qmlp;
+    size_t     float_bytes = 0;
+    uint32_t     reference = 0;
+    uint32_t        kernel;
+    uint32_t             l;
+    int             result = 0;
+    char          name[64];
+
+    if (QuantMlpCreate(&qmlp, mlp, train_source, BENCH_TRAIN_CALIBRATION_COUNT) != 0) {
+        perror("ERROR: Failed to quantize the network");
+        return -1;
+    }
+    if (QuantMlpSetTaskPool(&qmlp, pool) != 0) {
+        perror("ERROR: Failed to size the quantized network frame for the task pool");
+        QuantMlpDelete(&qmlp);
+        return -1;
+    }
+    for (l = 0; l < mlp->LayerCount; ++l) {
+        float_bytes += ((size_t) mlp->Layers[l].InputCount + 1) * mlp->Layers[l].OutputStride * sizeof(float);
+    }
+    printf("quant: int8 weights, 7-bit activations, calibrated on %u training samples" END_OF_LINE, (unsigned) BENCH_TRAIN_CALIBRATION_COUNT);
+    for (kernel = 0; kernel < QUANT_KERNEL_COUNT; ++kernel) {
+        uint32_t correct = 0;
+        double      best = 1.0e30;
+        uint32_t       r;
+        if (QuantSelectKernel(kernel) != 0) {
+            printf("  %-10s unsupported" END_OF_LINE, QuantKernelName(kernel));
+            continue;
+        }
+        for (r = 0; r < BENCH_REPEAT_COUNT; ++r) {
+            double t0 = TimestampSeconds();
+            if (QuantMlpEvaluate(&qmlp, test_source, &correct, NULL) != 0) {
+                perror("ERROR: Failed to evaluate the quantized network");
+                result = -1;
+                goto cleanup_and_exit;
+            }
+            double t1 = TimestampSeconds();
+            if ((t1 - t0) < best) {
+                best = t1 - t0;
+            }
+        }
+        if (kernel == QUANT_KERNEL_SCALAR) {
+            reference = correct;
+        } else if (correct != reference) {
+            fprintf(stderr, "ERROR: Quantized kernel %s classified %u samples correctly, scalar %u." END_OF_LINE, QuantKernelName(kernel), correct, reference);
+            result = -1;
+        }
+        printf("  %-10s %8.3f ms %10.0f images/s, accuracy %.2f%%" END_OF_LINE, QuantKernelName(kernel), best * 1000.0,
+               test_source->Dataset->SampleCount / best, 100.0 * correct / test_source->Dataset->SampleCount);
+        (void) snprintf(name, sizeof(name), "evaluate_%s", QuantKernelName(kernel));
+        BenchRecord("quant", name, test_source->Dataset->SampleCount / best, "images/s");
+    }
+    printf("  accuracy   float %.2f%%, int8 %.2f%%; parameters float %zu KB, int8 %zu KB" END_OF_LINE,
+           100.0 * float_correct / test_source->Dataset->SampleCount, 100.0 * reference / test_source->Dataset->SampleCount,
+           float_bytes / 1024, qmlp.Storage.Capacity / 1024);
+    BenchRecord("quant", "accuracy_float"  , 100.0 * float_correct / test_source->Dataset->SampleCount, "%");
+    BenchRecord("quant", "accuracy_int8"   , 100.0 * reference     / test_source->Dataset->SampleCount, "%");
+    BenchRecord("quant", "parameters_float", (double) float_bytes / 1024.0, "KB");
+    BenchRecord("quant", "parameters_int8" , (double) qmlp.Storage.Capacity / 1024.0, "KB");
+
+cleanup_and_exit:
+    /* restore the default kernel selection */
+    for (kernel = QUANT_KERNEL_COUNT; kernel-- > 0; ) {
+        if (QuantSelectKernel(kernel) == 0) {
+            break;
+        }
+    }
+    QuantMlpDelete(&qmlp);
+    return result;
+}
+
+/* @summary Train a 784-256-10 network for one epoch of the MNIST training set and evaluate it on the test set, exactly as the train program does, using every logical processor.
+ * @param dir The directory containing the IDX files.
+ * @return Zero if the benchmark ran, or -1 if an error occurred.
+ */
+static int
+BenchmarkTraining
+(
+    char const *dir
+)
+{
+    MNIST_DATASET               train_set;
+    MNIST_DATASET                test_set;
+    DATA_CACHE                train_cache;
+    DATA_CACHE                 test_cache;
+    MINIBATCH_SOURCE         train_source;
+    MINIBATCH_SOURCE          test_source;
+    MINIBATCH_PRODUCER_INIT          init;
+    TASK_POOL_INIT              pool_init;
+    MLP                               mlp;
+    struct MINIBATCH_PRODUCER   *producer = NULL;
+    struct TASK_POOL                *pool = NULL;
+    MINIBATCH                      *batch = NULL;
+    uint32_t                     sizes[3];
+    uint32_t                      correct = 0;
+    double                     train_time = 0.0;
+    double                      eval_time = 0.0;
+    int                            result = -1;
+
+    memset(&mlp, 0, sizeof(mlp));
+    if (OpenDataset(&train_set, &train_cache, &train_source, dir, "train") != 0) {
+        return -1;
+    }
+    if (OpenDataset(&test_set, &test_cache, &test_source, dir, "t10k") != 0) {
+        goto cleanup_train;
+    }
+    sizes[0] = train_set.ImageSize;
+    sizes[1] = BENCH_TRAIN_HIDDEN;
+    sizes[2] = 10;
+    if (MlpCreate(&mlp, sizes, 3, BENCH_BATCH_SIZE, BENCH_TRAIN_SEED) != 0) {
+        perror("ERROR: Failed to create the network");
+        goto cleanup_test;
+    }
+    memset(&pool_init, 0, sizeof(pool_init));
+    pool_init.ThreadCount = 0;
+    pool_init.Flags       = TASK_POOL_FLAG_PIN_THREADS;
+    if (TaskPoolCreate(&pool, &pool_init) != 0) {
+        perror("ERROR: Failed to create the task pool");
+        goto cleanup_mlp;
+    }
+    if (MlpSetTaskPool(&mlp, pool) != 0) {
+        perror("ERROR: Failed to size the network frame for the task pool");
+        goto cleanup_pool;
+    }
+    memset(&init, 0, sizeof(init));
+    init.Source     = train_source;
+    init.BatchSize  = BENCH_BATCH_SIZE;
+    init.RingSize   = BENCH_TRAIN_RING_SIZE;
+    init.EpochCount = 1;
+    init.Flags      = MINIBATCH_FLAG_SHUFFLE | MINIBATCH_FLAG_SPARSE;
+    init.Seed       = BENCH_TRAIN_SEED;
+
+    train_time = TimestampSeconds();
+    if (MinibatchProducerCreate(&producer, &init) != 0) {
+        perror("ERROR: Failed to start the minibatch producer");
+        goto cleanup_pool;
+    }
+    while ((batch = MinibatchProducerAcquire(producer)) != NULL) {
+        (void) MlpTrainBatch(&mlp, batch, BENCH_TRAIN_LEARNING_RATE);
+        MinibatchProducerRelease(producer, batch);
+    }
+    train_time = TimestampSeconds() - train_time;
+    MinibatchProducerDelete(producer);
+
+    eval_time = TimestampSeconds();
+    if (MlpEvaluate(&mlp, &test_source, &correct, NULL) != 0) {
+        perror("ERROR: Failed to evaluate the network");
+        goto cleanup_pool;
+    }
+    eval_time = TimestampSeconds() - eval_time;
+
+    printf("train: %u-%u-%u, batch %u, %u threads" END_OF_LINE, sizes[0], sizes[1], sizes[2], (unsigned) BENCH_BATCH_SIZE, TaskPoolThreadCount(pool));
+    printf("  %-8s %8.3f s %10.0f images/s" END_OF_LINE, "epoch"   , train_time, train_set.SampleCount / train_time);
+    printf("  %-8s %8.3f s %10.0f images/s, accuracy %.2f%%" END_OF_LINE, "evaluate", eval_time, test_set.SampleCount / eval_time,
+           100.0 * correct / test_set.SampleCount);
+    BenchRecord("train", "threads" , TaskPoolThreadCount(pool), "count");
+    BenchRecord("train", "epoch"   , train_set.SampleCount / train_time, "images/s");
+    BenchRecord("train", "evaluate", test_set.SampleCount  / eval_time , "images/s");
+    if (BenchmarkHogwild(sizes, &train_source, &test_source, pool) != 0) {
+        goto cleanup_pool;
+    }
+    result = BenchmarkQuantized(&mlp, &train_source, &test_source, pool, correct);
+
+cleanup_pool:
+    TaskPoolDelete(pool);
+cleanup_mlp:
+    MlpDelete(&mlp);
+cleanup_test:
+    DataCacheClose(&test_cache);
+    MnistDatasetClose(&test_set);
+cleanup_train:
+    DataCacheClose(&train_cache);
+    MnistDatasetClose(&train_set);
+    return result;
+}
+
+int main
+(
+    int    argc,
+    char **argv
+)
+{
+    char const *output_path = BENCH_DEFAULT_OUTPUT;
+    int              result = 0;
+
+    if (argc > 2) {
+        output_path = argv[2];
+    }
+    if ((Global_BenchOutput = fopen(output_path, "w")) != NULL) {
+        BenchWriteEnvironment(Global_BenchOutput);
+    } else {
+        fprintf(stderr, "WARNING: Failed to open %s; results are not recorded." END_OF_LINE, output_path);
+    }
+
+    if (BenchmarkConvert() != 0) {
+        fprintf(stderr, "ERROR: Conversion kernel output mismatch." END_OF_LINE);
+        result = 1;
+    }
+    if (BenchmarkGemm() != 0) {
+        result = 1;
+    }
+    if (BenchmarkGemmParallel() != 0) {
+        result = 1;
+    }
+    if (BenchmarkSparse() != 0) {
+        result = 1;
+    }
+    if (BenchmarkActivation() != 0) {
+        result = 1;
+    }
+    if (BenchmarkMixedPrecision() != 0) {
+        result = 1;
+    }
+    if (BenchmarkConv() != 0) {
+        result = 1;
+    }
+    if (BenchmarkConvAlgorithm() != 0) {
+        result = 1;
+    }
+    if (BenchmarkStrings() != 0) {
+        result = 1;
+    }
+    if (BenchmarkBase64() != 0) {
+        result = 1;
+    }
+    if (BenchmarkPaths() != 0) {
+        result = 1;
+    }
+    if (BenchmarkPathIntern() != 0) {
+        result = 1;
+    }
+    if (BenchmarkSortNames() != 0) {
+        result = 1;
+    }
+    if (BenchmarkIdxRoundTrip() != 0) {
+        result = 1;
+    }
+    if (argc > 1) {
+        if (BenchmarkDirectoryScan(argv[1]) != 0) {
+            result = 1;
+        }
+        if (BenchmarkIdxLoad(argv[1]) != 0) {
+            result = 1;
+        }
+        if (BenchmarkGather(argv[1]) != 0) {
+            result = 1;
+        }
+        if (BenchmarkTraining(argv[1]) != 0) {
+            result = 1;
+        }
+    } else {
+        printf("Usage: %s [mnist-dir] [output-file]; skipping the directory scan, IDX, gather and training benchmarks." END_OF_LINE, argv[0]);
+    }
+
+    if (Global_BenchOutput != NULL) {
+        fclose(Global_BenchOutput);
+        printf("results written to %s" END_OF_LINE, output_path);
+    }
+    return result;
+}
@@ -1,6 +1,5 @@
 #include <stddef.h>
 #include <stdint.h>
-#include <locale.h>
 #include <stdio.h>
 
 #include "strlib.h"
@@ -122,12 +121,6 @@ int main
     char8_t const     *path5 = u8"C:\\dos\\path\\to\\file.ext";
     char8_t const     *path6 = u8"\\\\?\\C:\\long\\unc\\path\\to\\file.ext";
 
-#ifdef _WIN32
-    setlocale(LC_ALL, "en-US.UTF8");
-#else
-    setlocale(LC_ALL, "en_US.utf8"); /* locale -a */
-#endif
-
     UNUSED_ARG(argc);
     UNUSED_ARG(argv);
     printf("Hello, world!\n");
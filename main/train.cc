@@ -0,0 +1,441 @@
+#include <stddef.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "cnn.h"
+#include "convert.h"
+#include "dataset.h"
+#include "datacache.h"
+#include "minibatch.h"
+#include "mlp.h"
+#include "quant.h"
+#include "taskpool.h"
+
+#ifdef _WIN32
+#include <Windows.h>
+#define END_OF_LINE    "\r\n"
+#else
+#include <time.h>
+#define END_OF_LINE    "\n"
+#endif
+
+/* @summary Define the default training hyperparameters.
+ */
+#ifndef TRAIN_DEFAULTS
+#   define TRAIN_DEFAULTS
+#   define TRAIN_DEFAULT_EPOCHS           10
+#   define TRAIN_DEFAULT_HIDDEN           256
+#   define TRAIN_DEFAULT_THREADS          0
+#   define TRAIN_BATCH_SIZE               128
+#   define TRAIN_HOGWILD_BATCH_SIZE       16
+#   define TRAIN_RING_SIZE                4
+#   define TRAIN_LEARNING_RATE            0.1f
+#   define TRAIN_SEED                     0x2545F4914F6CDD1DULL
+#   define TRAIN_CALIBRATION_COUNT        2048
+#endif
+
+/* @summary Read a monotonic clock.
+ * @return The current time, in seconds, relative to an arbitrary epoch.
+ */
+static double
+TimestampSeconds
+(
+    void
+)
+{
+#ifdef _WIN32
+    LARGE_INTEGER freq;
+    LARGE_INTEGER  now;
+    QueryPerformanceFrequency(&freq);
+    QueryPerformanceCounter(&now);
+    return (double) now.QuadPart / (double) freq.QuadPart;
+#else
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double) ts.tv_sec + ((double) ts.tv_nsec * 1.0e-9);
+#endif
+}
+
+/* @summary Open one of the MNIST data sets in a directory, along with its float32 cache.
+ * If the cache cannot be opened or built (for example, the directory is read-only), pixels are converted on the fly.
+ * @param o_dataset The MNIST_DATASET to initialize.
+ * @param o_cache The DATA_CACHE to initialize.
+ * @param o_source The MINIBATCH_SOURCE to initialize.
+ * @param dir The directory containing the IDX files.
+ * @param prefix The file name prefix, "train" or "t10k".
+ * @return Zero if the data set was opened, or -1 if an error occurred.
+ */
+static int
+OpenDataset
+(
+    MNIST_DATASET    *o_dataset,
+    DATA_CACHE         *o_cache,
+    MINIBATCH_SOURCE  *o_source,
+    char const             *dir,
+    char const          *prefix
+)
+{
+    char images_path[1024];
+    char labels_path[1024];
+    char  cache_path[1024];
+
+    if (snprintf(images_path, sizeof(images_path), "%s/%s-images-idx3-ubyte", dir, prefix) >= (int) sizeof(images_path) ||
+        snprintf(labels_path, sizeof(labels_path), "%s/%s-labels-idx1-ubyte", dir, prefix) >= (int) sizeof(labels_path) ||
+        snprintf(cache_path , sizeof(cache_path) , "%s%s", images_path, DATA_CACHE_FILE_SUFFIX) >= (int) sizeof(cache_path)) {
+        fprintf(stderr, "ERROR: The data set directory path is too long." END_OF_LINE);
+        return -1;
+    }
+    if (MnistDatasetOpen(o_dataset, images_path, labels_path) != 0) {
+        fprintf(stderr, "ERROR: Failed to open %s or %s." END_OF_LINE, images_path, labels_path);
+        return -1;
+    }
+    o_source->Dataset = o_dataset;
+    o_source->Cache   = NULL;
+    (void) DataCacheNormalization(&o_source->Scale, &o_source->Bias, o_dataset, DATA_CACHE_NORMALIZE_UNIT);
+    if (DataCacheOpenOrBuild(o_cache, o_dataset, cache_path, DATA_CACHE_NORMALIZE_UNIT) == 0) {
+        o_source->Cache = o_cache;
+    } else {
+        fprintf(stderr, "WARNING: Failed to open or build %s; converting pixels on the fly." END_OF_LINE, cache_path);
+    }
+    return 0;
+}
+
+/* @summary Define the LeNet-style layers trained when the lenet model is selected: two 5x5 convolutions, each followed by a 2x2 max-pool, feeding a 400-input head.
+ */
+static CNN_LAYER_DESC const TRAIN_LENET_LAYERS[] = {
+    { CNN_LAYER_CONV   ,  8, 5, 2 },                                           /* 28x28x1 => 28x28x8 */
+    { CNN_LAYER_MAXPOOL,  0, 2, 0 },                                           /* 28x28x8 => 14x14x8 */
+    { CNN_LAYER_CONV   , 16, 5, 0 },                                           /* 14x14x8 => 10x10x16 */
+    { CNN_LAYER_MAXPOOL,  0, 2, 0 },                                           /* 10x10x16 => 5x5x16 */
+};
+
+/* @summary Define the layers trained when the vgg model is selected: stacked 3x3 convolutions, which use the Winograd path where it pays off.
+ */
+static CNN_LAYER_DESC const TRAIN_VGG_LAYERS[] = {
+    { CNN_LAYER_CONV   , 16, 3, 1 },                                           /* 28x28x1 => 28x28x16 */
+    { CNN_LAYER_CONV   , 16, 3, 1 },                                           /* 28x28x16 => 28x28x16 */
+    { CNN_LAYER_MAXPOOL,  0, 2, 0 },                                           /* 28x28x16 => 14x14x16 */
+    { CNN_LAYER_CONV   , 32, 3, 1 },                                           /* 14x14x16 => 14x14x32 */
+    { CNN_LAYER_MAXPOOL,  0, 2, 0 },                                           /* 14x14x32 => 7x7x32 */
+};
+
+/* @summary Describe one of the models selectable on the command line.
+ */
+typedef struct TRAIN_MODEL {
+    char const                  *Name;                                         /* The name of the model on the command line. */
+    char const                  *Summary;                                      /* The layers ahead of the fully-connected layers, for the network summary line. */
+    CNN_LAYER_DESC const        *Layers;                                       /* The convolution and pooling layers, or NULL for a multi-layer perceptron. */
+    uint32_t                     LayerCount;                                   /* The number of entries in Layers. */
+} TRAIN_MODEL;
+
+/* @summary Define the models selectable on the command line. The first is the default.
+ */
+static TRAIN_MODEL const TRAIN_MODELS[] = {
+    { "mlp"  , ""                                             , NULL              , 0 },
+    { "lenet", "conv5x5x8-pool2-conv5x5x16-pool2-"            , TRAIN_LENET_LAYERS, sizeof(TRAIN_LENET_LAYERS) / sizeof(TRAIN_LENET_LAYERS[0]) },
+    { "vgg"  , "conv3x3x16-conv3x3x16-pool2-conv3x3x32-pool2-", TRAIN_VGG_LAYERS  , sizeof(TRAIN_VGG_LAYERS)   / sizeof(TRAIN_VGG_LAYERS[0])   },
+};
+
+/* @summary Evaluate the network on the test set and print a summary line for a completed epoch.
+ * @param mlp The network being trained, if cnn is NULL.
+ * @param cnn The convolutional network being trained, or NULL.
+ * @param test_source The test data.
+ * @param epoch The zero-based index of the completed epoch.
+ * @param train_loss The mean training loss over the epoch.
+ * @param seconds The time taken to train the epoch, excluding evaluation.
+ * @param train_count The number of samples in the training set.
+ */
+static void
+ReportEpoch
+(
+    MLP                            *mlp,
+    CNN                            *cnn,
+    MINIBATCH_SOURCE const *test_source,
+    uint32_t                      epoch,
+    double                   train_loss,
+    double                      seconds,
+    uint32_t                train_count
+)
+{
+    uint32_t correct = 0;
+    float  test_loss = 0.0f;
+    int       status = cnn ? CnnEvaluate(cnn, test_source, &correct, &test_loss) : MlpEvaluate(mlp, test_source, &correct, &test_loss);
+    if (status == 0) {
+        printf("epoch %3u: train loss %.4f, test loss %.4f, test accuracy %.2f%%, %.2fs (%.0f samples/s)" END_OF_LINE,
+               epoch + 1, train_loss, (double) test_loss, 100.0 * correct / test_source->Dataset->SampleCount,
+               seconds, train_count / seconds);
+    }
+}
+
+/* @summary Quantize a trained network to int8, calibrating on the start of the training set, and print its accuracy on the test set.
+ * @param mlp The trained network.
+ * @param train_source The training data, used for calibration.
+ * @param test_source The test data.
+ * @param pool The task pool used to evaluate the quantized network, or NULL.
+ * @return Zero if the network was quantized and evaluated, or -1 if an error occurred.
+ */
+static int
+ReportQuantized
+(
+    MLP                             *mlp,
+    MINIBATCH_SOURCE const *train_source,
+    MINIBATCH_SOURCE const  *test_source,
+    struct TASK_POOL               *pool
+)
+{
+    QUANT_MLP   qmlp;
+    uint32_t correct = 0;
+    float  test_loss = 0.0f;
+    double   seconds = 0.0;
+
+    if (QuantMlpCreate(&qmlp, mlp, train_source, TRAIN_CALIBRATION_COUNT) != 0) {
+        perror("ERROR: Failed to quantize the network");
+        return -1;
+    }
+    if (QuantMlpSetTaskPool(&qmlp, pool) != 0) {
+        perror("ERROR: Failed to size the quantized network frame for the task pool");
+        QuantMlpDelete(&qmlp);
+        return -1;
+    }
+    seconds = TimestampSeconds();
+    if (QuantMlpEvaluate(&qmlp, test_source, &correct, &test_loss) != 0) {
+        perror("ERROR: Failed to evaluate the quantized network");
+        QuantMlpDelete(&qmlp);
+        return -1;
+    }
+    seconds = TimestampSeconds() - seconds;
+    printf("int8: test loss %.4f, test accuracy %.2f%%, %.0f samples/s, parameters %zu KB, calibrated on %u samples" END_OF_LINE,
+           (double) test_loss, 100.0 * correct / test_source->Dataset->SampleCount, test_source->Dataset->SampleCount / seconds,
+           qmlp.Storage.Capacity / 1024, (unsigned) TRAIN_CALIBRATION_COUNT);
+    QuantMlpDelete(&qmlp);
+    return 0;
+}
+
+/* @summary Train a network with asynchronous (Hogwild) SGD, reshuffling the training set and reporting test set accuracy after each epoch.
+ * @param mlp The network to train, with its task pool attached.
+ * @param train_source The training data.
+ * @param test_source The test data.
+ * @param epochs The number of passes over the training set.
+ * @return Zero if training completed, or -1 if an error occurred.
+ */
+static int
+TrainHogwild
+(
+    MLP                             *mlp,
+    MINIBATCH_SOURCE const *train_source,
+    MINIBATCH_SOURCE const  *test_source,
+    uint32_t                      epochs
+)
+{
+    uint32_t    count = train_source->Dataset->SampleCount;
+    uint32_t *indices = NULL;
+    uint64_t      rng = TRAIN_SEED;
+    double    seconds = 0.0;
+    float        loss = 0.0f;
+    uint32_t  epoch, i;
+
+    if ((indices = (uint32_t*) malloc(count * sizeof(uint32_t))) == NULL) {
+        perror("ERROR: Failed to allocate the sample indices");
+        return -1;
+    }
+    for (i = 0; i < count; ++i) {
+        indices[i] = i;
+    }
+    for (epoch = 0; epoch < epochs; ++epoch) {
+        MinibatchShuffle(indices, count, &rng);
+        seconds = TimestampSeconds();
+        if (MlpTrainHogwild(mlp, train_source, indices, count, TRAIN_HOGWILD_BATCH_SIZE, TRAIN_LEARNING_RATE, &loss) != 0) {
+            perror("ERROR: Failed to train the network");
+            free(indices);
+            return -1;
+        }
+        ReportEpoch(mlp, NULL, test_source, epoch, loss, TimestampSeconds() - seconds, count);
+    }
+    free(indices);
+    return 0;
+}
+
+int main
+(
+    int    argc,
+    char **argv
+)
+{
+    MNIST_DATASET               train_set;
+    MNIST_DATASET                test_set;
+    DATA_CACHE                train_cache;
+    DATA_CACHE                 test_cache;
+    MINIBATCH_SOURCE         train_source;
+    MINIBATCH_SOURCE          test_source;
+    MINIBATCH_PRODUCER_INIT          init;
+    TASK_POOL_INIT              pool_init;
+    MLP                               mlp;
+    CNN                               cnn;
+    struct TASK_POOL                *pool = NULL;
+    MINIBATCH_PRODUCER          *producer = NULL;
+    MINIBATCH                      *batch = NULL;
+    uint32_t                       epochs = TRAIN_DEFAULT_EPOCHS;
+    uint32_t                       hidden = TRAIN_DEFAULT_HIDDEN;
+    uint32_t                      threads = TRAIN_DEFAULT_THREADS;
+    uint32_t                    precision = CONVERT_TYPE_F32;
+    TRAIN_MODEL const              *model = &TRAIN_MODELS[0];
+    uint32_t                         conv = 0;
+    uint32_t                      hogwild = 0;
+    uint32_t                     sizes[3];
+    uint32_t                        epoch = 0;
+    uint32_t                    batch_num = 0;
+    double                       loss_sum = 0.0;
+    double                     epoch_time = 0.0;
+    int                            result = 1;
+
+    memset(&train_cache, 0, sizeof(train_cache));
+    memset(&test_cache , 0, sizeof(test_cache));
+    memset(&mlp        , 0, sizeof(mlp));
+    memset(&cnn        , 0, sizeof(cnn));
+    if (argc < 2) {
+        fprintf(stderr, "Usage: %s <mnist-dir> [epochs] [hidden-units] [threads] [f32|bf16|f16] [mlp|lenet|vgg] [sync|hogwild]" END_OF_LINE, argv[0]);
+        return 1;
+    }
+    if (argc > 2) epochs = (uint32_t) strtoul(argv[2], NULL, 10);
+    if (argc > 3) hidden = (uint32_t) strtoul(argv[3], NULL, 10);
+    if (argc > 4) threads = (uint32_t) strtoul(argv[4], NULL, 10);
+    if (argc > 5) {
+        while (precision < CONVERT_TYPE_COUNT && strcmp(argv[5], ConvertTypeName(precision)) != 0) {
+            precision++;
+        }
+        if (precision == CONVERT_TYPE_COUNT) {
+            fprintf(stderr, "ERROR: Unknown precision %s; expected f32, bf16 or f16." END_OF_LINE, argv[5]);
+            return 1;
+        }
+    }
+    if (argc > 6) {
+        while (model < TRAIN_MODELS + (sizeof(TRAIN_MODELS) / sizeof(TRAIN_MODELS[0])) && strcmp(argv[6], model->Name) != 0) {
+            model++;
+        }
+        if (model == TRAIN_MODELS + (sizeof(TRAIN_MODELS) / sizeof(TRAIN_MODELS[0]))) {
+            fprintf(stderr, "ERROR: Unknown model %s; expected mlp, lenet or vgg." END_OF_LINE, argv[6]);
+            return 1;
+        }
+    }
+    if (argc > 7) {
+        if (strcmp(argv[7], "hogwild") == 0) {
+            hogwild = 1;
+        } else if (strcmp(argv[7], "sync") != 0) {
+            fprintf(stderr, "ERROR: Unknown training mode %s; expected sync or hogwild." END_OF_LINE, argv[7]);
+            return 1;
+        }
+    }
+    conv = model->LayerCount != 0;
+    if (conv && precision != CONVERT_TYPE_F32) {
+        fprintf(stderr, "ERROR: The %s model supports only f32 precision." END_OF_LINE, model->Name);
+        return 1;
+    }
+    if (hogwild && (conv || precision != CONVERT_TYPE_F32)) {
+        fprintf(stderr, "ERROR: Hogwild training supports only the mlp model with f32 precision." END_OF_LINE);
+        return 1;
+    }
+
+    if (OpenDataset(&train_set, &train_cache, &train_source, argv[1], "train") != 0) {
+        return 1;
+    }
+    if (OpenDataset(&test_set, &test_cache, &test_source, argv[1], "t10k") != 0) {
+        goto cleanup_train;
+    }
+    sizes[0] = train_set.ImageSize;
+    sizes[1] = hidden;
+    sizes[2] = 10;
+    if (conv) {
+        if (CnnCreate(&cnn, train_set.ImageColumns, train_set.ImageRows, model->Layers, model->LayerCount, &sizes[1], 2, TRAIN_BATCH_SIZE, TRAIN_SEED) != 0) {
+            perror("ERROR: Failed to create the network");
+            goto cleanup_test;
+        }
+        sizes[0] = cnn.Head.InputCount;
+    } else if (MlpCreate(&mlp, sizes, 3, TRAIN_BATCH_SIZE, TRAIN_SEED) != 0) {
+        perror("ERROR: Failed to create the network");
+        goto cleanup_test;
+    }
+    memset(&pool_init, 0, sizeof(pool_init));
+    pool_init.ThreadCount = threads;
+    pool_init.Flags       = TASK_POOL_FLAG_PIN_THREADS;
+    if (TaskPoolCreate(&pool, &pool_init) != 0) {
+        perror("ERROR: Failed to create the task pool");
+        goto cleanup_mlp;
+    }
+    if ((conv ? CnnSetTaskPool(&cnn, pool) : MlpSetTaskPool(&mlp, pool)) != 0) {
+        perror("ERROR: Failed to size the network frame for the task pool");
+        goto cleanup_pool;
+    }
+    if (!conv && MlpSetPrecision(&mlp, precision) != 0) {
+        perror("ERROR: Failed to allocate the 16-bit weights");
+        goto cleanup_pool;
+    }
+
+    if (hogwild) {
+        printf("network: %u-%u-%u, hogwild batch %u, learning rate %g, %u epochs, %u threads, %s" END_OF_LINE,
+               sizes[0], sizes[1], sizes[2], (unsigned) TRAIN_HOGWILD_BATCH_SIZE, (double) TRAIN_LEARNING_RATE, epochs, TaskPoolThreadCount(pool), ConvertTypeName(precision));
+        if (TrainHogwild(&mlp, &train_source, &test_source, epochs) != 0) {
+            goto cleanup_pool;
+        }
+        goto report;
+    }
+
+    memset(&init, 0, sizeof(init));
+    init.Source     = train_source;
+    init.BatchSize  = TRAIN_BATCH_SIZE;
+    init.RingSize   = TRAIN_RING_SIZE;
+    init.EpochCount = epochs;
+    init.Flags      = conv ? MINIBATCH_FLAG_SHUFFLE : MINIBATCH_FLAG_SHUFFLE | MINIBATCH_FLAG_SPARSE;
+    init.Seed       = TRAIN_SEED;
+    if (MinibatchProducerCreate(&producer, &init) != 0) {
+        perror("ERROR: Failed to start the minibatch producer");
+        goto cleanup_pool;
+    }
+
+    printf("network: %s%u-%u-%u, batch %u, learning rate %g, %u epochs, %u threads, %s" END_OF_LINE,
+           model->Summary, sizes[0], sizes[1], sizes[2], (unsigned) TRAIN_BATCH_SIZE, (double) TRAIN_LEARNING_RATE, epochs, TaskPoolThreadCount(pool), ConvertTypeName(precision));
+    epoch_time = TimestampSeconds();
+    while ((batch = MinibatchProducerAcquire(producer)) != NULL) {
+        if (batch->Epoch != epoch) {
+            ReportEpoch(&mlp, conv ? &cnn : NULL, &test_source, epoch, loss_sum / batch_num, TimestampSeconds() - epoch_time, train_set.SampleCount);
+            epoch      = batch->Epoch;
+            batch_num  = 0;
+            loss_sum   = 0.0;
+            epoch_time = TimestampSeconds();
+        }
+        loss_sum += conv ? CnnTrainBatch(&cnn, batch, TRAIN_LEARNING_RATE) : MlpTrainBatch(&mlp, batch, TRAIN_LEARNING_RATE);
+        batch_num++;
+        MinibatchProducerRelease(producer, batch);
+    }
+    if (batch_num > 0) {
+        ReportEpoch(&mlp, conv ? &cnn : NULL, &test_source, epoch, loss_sum / batch_num, TimestampSeconds() - epoch_time, train_set.SampleCount);
+    }
+report:
+    if (conv) {
+        printf("memory: parameters %zu KB, frame %zu/%zu KB high-water, %s pages" END_OF_LINE,
+               CnnParameterSize(&cnn) / 1024, cnn.Frame.HighWatermark / 1024, cnn.Frame.Capacity / 1024,
+               (cnn.Frame.Flags & ARENA_FLAG_LOCKED_PAGES) ? "huge" : "normal");
+    } else {
+        printf("memory: parameters %zu KB, frame %zu/%zu KB high-water, %s pages" END_OF_LINE,
+               (mlp.Storage.Capacity + mlp.HalfStorage.Capacity) / 1024, mlp.Frame.HighWatermark / 1024, mlp.Frame.Capacity / 1024,
+               (mlp.Frame.Flags & ARENA_FLAG_LOCKED_PAGES) ? "huge" : "normal");
+        (void) ReportQuantized(&mlp, &train_source, &test_source, pool);
+    }
+    result = 0;
+
+    MinibatchProducerDelete(producer);
+cleanup_pool:
+    TaskPoolDelete(pool);
+cleanup_mlp:
+    CnnDelete(&cnn);
+    MlpDelete(&mlp);
+cleanup_test:
+    DataCacheClose(&test_cache);
+    MnistDatasetClose(&test_set);
+cleanup_train:
+    DataCacheClose(&train_cache);
+    MnistDatasetClose(&train_set);
+    return result;
+}
+
@@ -0,0 +1,67 @@
+/**
+ * @summary Implement the platform-independent functions exported by the
+ * arena.h module. Reserving and releasing the backing memory is implemented
+ * in the platform-specific source.
+ */
+#include <stddef.h>
+#include <stdint.h>
+#include <assert.h>
+#include <errno.h>
+
+#include "arena.h"
+
+MNIST_API(void*)
+ArenaAllocate
+(
+    struct MEMORY_ARENA *arena,
+    size_t                size,
+    size_t           alignment
+)
+{
+    uintptr_t base = (uintptr_t) arena->BaseAddress;
+    uintptr_t addr;
+
+    if (alignment == 0) {
+        alignment = ARENA_ALIGNMENT;
+    }
+    assert((alignment & (alignment - 1)) == 0);
+    addr = (base + arena->Offset + (alignment - 1)) & ~(uintptr_t)(alignment - 1);
+    if (addr - base > arena->Capacity || size > arena->Capacity - (addr - base)) {
+        errno = ENOMEM;
+        return NULL;
+    }
+    arena->Offset = (size_t)(addr - base) + size;
+    if (arena->Offset > arena->HighWatermark) {
+        arena->HighWatermark = arena->Offset;
+    }
+    return (void*) addr;
+}
+
+MNIST_API(size_t)
+ArenaMark
+(
+    struct MEMORY_ARENA const *arena
+)
+{
+    return arena->Offset;
+}
+
+MNIST_API(void)
+ArenaResetToMark
+(
+    struct MEMORY_ARENA *arena,
+    size_t                mark
+)
+{
+    assert(mark <= arena->Offset);
+    arena->Offset = mark;
+}
+
+MNIST_API(void)
+ArenaReset
+(
+    struct MEMORY_ARENA *arena
+)
+{
+    arena->Offset = 0;
+}
@@ -0,0 +1,1871 @@
+/**
+ * @summary Implement the functions exported by the cnn.h module for training
+ * and evaluating convolutional networks with direct convolution kernels.
+ */
+#include <stddef.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <assert.h>
+#include <errno.h>
+
+#include "arena.h"
+#include "cpuinfo.h"
+#include "dataset.h"
+#include "gemm.h"
+#include "minibatch.h"
+#include "mlp.h"
+#include "taskpool.h"
+#include "cnn.h"
+
+#if CPU_ARCH_X86
+#include <immintrin.h>
+#endif
+
+/* @summary Round a value up to the next multiple of a power of two.
+ * @param _value The value to round.
+ * @param _pow2 The power-of-two multiple.
+ * @return The smallest multiple of _pow2 that is greater than or equal to _value.
+ */
+#ifndef AlignUp
+#define AlignUp(_value, _pow2)                                                 \
+    (((_value) + ((_pow2) - 1)) & ~((_pow2) - 1))
+#endif
+
+/* @summary Compute the minimum of two values.
+ */
+#ifndef MinValue
+#define MinValue(_a, _b)                                                       \
+    (((_a) < (_b)) ? (_a) : (_b))
+#endif
+
+/* @summary Compute the maximum of two values.
+ */
+#ifndef MaxValue
+#define MaxValue(_a, _b)                                                       \
+    (((_a) > (_b)) ? (_a) : (_b))
+#endif
+
+/* @summary Define the smallest probability passed to log when computing the cross-entropy loss.
+ */
+#ifndef CNN_MIN_PROBABILITY
+#define CNN_MIN_PROBABILITY           1.0e-12f
+#endif
+
+/* @summary Define the strides and sizes shared by every call to a convolution kernel for one image.
+ */
+typedef struct CNN_CONV_ARGS {
+    size_t                       InputPlane;                                   /* The distance between consecutive channel blocks of the input, in floats. */
+    size_t                       InputRow;                                     /* The distance between consecutive rows of the input, in floats. */
+    uint32_t                     InputChannels;                                /* The number of input channels summed into each output. */
+    uint32_t                     InputBlock;                                   /* The channel block size of the input layout, and the distance between consecutive input columns, in floats. */
+    uint32_t                     KernelSize;                                   /* The width and height of the kernel. The weights of each input channel are KernelSize * KernelSize * CNN_CBLOCK floats. */
+    uint32_t                     Relu;                                         /* Non-zero to clamp the outputs at zero. */
+} CNN_CONV_ARGS;
+
+/* @summary Define the signature of a convolution kernel.
+ * The kernel computes CNN_CBLOCK output channels for a run of adjacent output columns of one output row, out[j][o] = bias[o] + Sum(in[c][kh][kw + j] * w[c][kh][kw][o]),
+ * over every input channel c, kh in [0, kh_count) and kw in [0, kw_count). The caller clips the kernel window to the valid input rows and columns.
+ * @param out The CNN_CBLOCK values of the first output column. Consecutive columns are CNN_CBLOCK floats apart.
+ * @param in The input value under the top-left tap of the clipped window for the first output column, in channel zero.
+ * @param w The weights of the top-left tap of the clipped window, for input channel zero.
+ * @param bias The CNN_CBLOCK initial values of each output, or NULL to start from zero.
+ * @param args The strides of the input and weights.
+ * @param kh_count The number of kernel rows that overlap the input.
+ * @param kw_count The number of kernel columns that overlap the input.
+ */
+typedef void (*CNN_CONV_FUNC)
+(
+    float       * __restrict  out,
+    float const * __restrict   in,
+    float const * __restrict    w,
+    float const * __restrict bias,
+    CNN_CONV_ARGS const     *args,
+    uint32_t             kh_count,
+    uint32_t             kw_count
+);
+
+/* @summary Define the signature of a weight gradient kernel.
+ * The kernel accumulates acc[kw][o] += Sum(dout[j][o] * in[(j + kw) * in_step]) over j in [0, count) for every kw in [0, kernel_size).
+ * @param acc The KernelSize x CNN_CBLOCK accumulated gradients of one kernel row of one input channel.
+ * @param dout The CNN_CBLOCK output deltas of the first output column.
+ * @param in The input value under the first tap for the first output column.
+ * @param in_step The distance between consecutive input columns, in floats.
+ * @param count The number of output columns, every one of which has all kernel_size taps inside the input.
+ * @param kernel_size The width of the kernel.
+ */
+typedef void (*CNN_WGRAD_FUNC)
+(
+    float       * __restrict  acc,
+    float const * __restrict dout,
+    float const * __restrict   in,
+    size_t                in_step,
+    uint32_t                count,
+    uint32_t          kernel_size
+);
+
+/* @summary Define the signature of a Winograd input transform kernel.
+ * The kernel computes V = B^T d B for one 4x4 tile of one block of CNN_CBLOCK channels.
+ * @param v The CNN_CBLOCK values of the first transform position. Consecutive positions are pos floats apart.
+ * @param pos The distance between consecutive transform positions in v, in floats.
+ * @param d The CNN_CBLOCK values of the top-left input of the tile. Consecutive columns are CNN_CBLOCK floats apart.
+ * @param row The distance between consecutive rows of d, in floats.
+ */
+typedef void (*CNN_WINOGRAD_INPUT_FUNC)
+(
+    float       * __restrict    v,
+    size_t                    pos,
+    float const * __restrict    d,
+    size_t                    row
+);
+
+/* @summary Define the signature of a Winograd output transform kernel.
+ * The kernel computes Y = A^T m A for one 2x2 tile of one block of CNN_CBLOCK channels, then adds the bias and applies ReLU if requested.
+ * @param y The CNN_CBLOCK values of the top-left output of the tile. Consecutive columns are CNN_CBLOCK floats apart.
+ * @param row The distance between consecutive rows of y, in floats.
+ * @param m The CNN_CBLOCK values of the first transform position.
+ * @param pos The distance between consecutive transform positions in m, in floats.
+ * @param bias The CNN_CBLOCK bias values, or NULL.
+ * @param relu Non-zero to clamp the outputs at zero.
+ */
+typedef void (*CNN_WINOGRAD_OUTPUT_FUNC)
+(
+    float       * __restrict    y,
+    size_t                    row,
+    float const * __restrict    m,
+    size_t                    pos,
+    float const * __restrict bias,
+    uint32_t                 relu
+);
+
+/* @summary Define the set of kernels implementing one CNN_KERNEL identifier.
+ */
+typedef struct CNN_KERNEL_FUNCS {
+    CNN_CONV_FUNC                ConvBlock;                                    /* Computes CNN_OW_BLOCK adjacent output columns. */
+    CNN_CONV_FUNC                ConvColumn;                                   /* Computes a single output column. */
+    CNN_WGRAD_FUNC               WeightGrad;                                   /* Accumulates the weight gradient of one kernel row. */
+    CNN_WINOGRAD_INPUT_FUNC      WinogradInput;                                /* Transforms one input tile of one channel block. */
+    CNN_WINOGRAD_OUTPUT_FUNC     WinogradOutput;                               /* Transforms one output tile of one channel block. */
+} CNN_KERNEL_FUNCS;
+
+/* @summary Define the geometry of a convolution of one image, in the forward pass or as the input gradient of the backward pass.
+ */
+typedef struct CNN_CONV_SHAPE {
+    uint32_t                     InputChannels;                                /* The number of input channels. */
+    uint32_t                     InputBlock;                                   /* The channel block size of the input layout. */
+    uint32_t                     InputHeight;                                  /* The number of rows in each input channel. */
+    uint32_t                     InputWidth;                                   /* The number of columns in each input channel. */
+    uint32_t                     OutputBlocks;                                 /* The number of CNN_CBLOCK-channel blocks of output. */
+    uint32_t                     OutputHeight;                                 /* The number of rows in each output channel. */
+    uint32_t                     OutputWidth;                                  /* The number of columns in each output channel. */
+    uint32_t                     KernelSize;                                   /* The width and height of the kernel. */
+    uint32_t                     Padding;                                      /* The zero padding on each side of the input. */
+    uint32_t                     Relu;                                         /* Non-zero to clamp the outputs at zero. */
+} CNN_CONV_SHAPE;
+
+/* @summary Define the arguments shared by the tasks that process one layer for a batch of images.
+ */
+typedef struct CNN_LAYER_ARGS {
+    CNN_KERNEL_FUNCS const      *Kernel;                                       /* The convolution kernels. */
+    CNN_LAYER const             *Layer;                                        /* The layer being processed. */
+    float const                 *Inputs;                                       /* The inputs of the layer, one image every InputStride floats. */
+    float                       *InputDeltas;                                  /* The gradient of the loss with respect to Inputs, or NULL for the first layer. */
+    size_t                       InputStride;                                  /* The distance between the start of consecutive input images, in floats. */
+    uint32_t                     Count;                                        /* The number of images in the batch. */
+} CNN_LAYER_ARGS;
+
+/* @summary The convolution kernels used by the forward and backward passes, selected on first use or by CnnSelectKernel.
+ */
+static CNN_KERNEL_FUNCS const * volatile Global_CnnKernel = NULL;
+
+/* @summary Implement the multi-column convolution kernel in portable C.
+ */
+static void
+CnnConvBlock_Scalar
+(
+    float       * __restrict  out,
+    float const * __restrict   in,
+    float const * __restrict    w,
+    float const * __restrict bias,
+    CNN_CONV_ARGS const     *args,
+    uint32_t             kh_count,
+    uint32_t             kw_count
+)
+{
+    uint32_t const  icb = args->InputBlock;
+    uint32_t const    k = args->KernelSize;
+    float    acc[CNN_OW_BLOCK * CNN_CBLOCK];
+    uint32_t c, kh, kw, j, o;
+
+    for (j = 0; j < CNN_OW_BLOCK; ++j) {
+        for (o = 0; o < CNN_CBLOCK; ++o) {
+            acc[(j * CNN_CBLOCK) + o] = bias ? bias[o] : 0.0f;
+        }
+    }
+    for (c = 0; c < args->InputChannels; ++c) {
+        float const *ip = in + ((c / icb) * args->InputPlane) + (c % icb);
+        float const *wp = w  + ((size_t) c * k * k * CNN_CBLOCK);
+        for (kh = 0; kh < kh_count; ++kh) {
+            for (kw = 0; kw < kw_count; ++kw) {
+                float const *wv = wp + (((kh * k) + kw) * CNN_CBLOCK);
+                float const *iv = ip + (kh * args->InputRow) + (kw * icb);
+                for (j = 0; j < CNN_OW_BLOCK; ++j) {
+                    float x = iv[j * icb];
+                    for (o = 0; o < CNN_CBLOCK; ++o) {
+                        acc[(j * CNN_CBLOCK) + o] += x * wv[o];
+                    }
+                }
+            }
+        }
+    }
+    for (j = 0; j < CNN_OW_BLOCK * CNN_CBLOCK; ++j) {
+        out[j] = (args->Relu && acc[j] < 0.0f) ? 0.0f : acc[j];
+    }
+}
+
+/* @summary Implement the single-column convolution kernel in portable C.
+ */
+static void
+CnnConvColumn_Scalar
+(
+    float       * __restrict  out,
+    float const * __restrict   in,
+    float const * __restrict    w,
+    float const * __restrict bias,
+    CNN_CONV_ARGS const     *args,
+    uint32_t             kh_count,
+    uint32_t             kw_count
+)
+{
+    uint32_t const  icb = args->InputBlock;
+    uint32_t const    k = args->KernelSize;
+    float    acc[CNN_CBLOCK];
+    uint32_t c, kh, kw, o;
+
+    for (o = 0; o < CNN_CBLOCK; ++o) {
+        acc[o] = bias ? bias[o] : 0.0f;
+    }
+    for (c = 0; c < args->InputChannels; ++c) {
+        float const *ip = in + ((c / icb) * args->InputPlane) + (c % icb);
+        float const *wp = w  + ((size_t) c * k * k * CNN_CBLOCK);
+        for (kh = 0; kh < kh_count; ++kh) {
+            for (kw = 0; kw < kw_count; ++kw) {
+                float const *wv = wp + (((kh * k) + kw) * CNN_CBLOCK);
+                float         x = ip[(kh * args->InputRow) + (kw * icb)];
+                for (o = 0; o < CNN_CBLOCK; ++o) {
+                    acc[o] += x * wv[o];
+                }
+            }
+        }
+    }
+    for (o = 0; o < CNN_CBLOCK; ++o) {
+        out[o] = (args->Relu && acc[o] < 0.0f) ? 0.0f : acc[o];
+    }
+}
+
+/* @summary Implement the weight gradient kernel in portable C.
+ */
+static void
+CnnWeightGrad_Scalar
+(
+    float       * __restrict  acc,
+    float const * __restrict dout,
+    float const * __restrict   in,
+    size_t                in_step,
+    uint32_t                count,
+    uint32_t          kernel_size
+)
+{
+    uint32_t j, kw, o;
+    for (j = 0; j < count; ++j) {
+        float const *d = dout + (j * CNN_CBLOCK);
+        for (kw = 0; kw < kernel_size; ++kw) {
+            float x = in[(j + kw) * in_step];
+            for (o = 0; o < CNN_CBLOCK; ++o) {
+                acc[(kw * CNN_CBLOCK) + o] += x * d[o];
+            }
+        }
+    }
+}
+
+/* @summary Implement the Winograd input transform kernel in portable C.
+ */
+static void
+CnnWinogradInput_Scalar
+(
+    float       * __restrict    v,
+    size_t                    pos,
+    float const * __restrict    d,
+    size_t                    row
+)
+{
+    float    t[4][4][CNN_CBLOCK];
+    uint32_t i, j, o;
+    for (j = 0; j < 4; ++j) {
+        for (o = 0; o < CNN_CBLOCK; ++o) {
+            float d0 = d[(0 * row) + (j * CNN_CBLOCK) + o];
+            float d1 = d[(1 * row) + (j * CNN_CBLOCK) + o];
+            float d2 = d[(2 * row) + (j * CNN_CBLOCK) + o];
+            float d3 = d[(3 * row) + (j * CNN_CBLOCK) + o];
+            t[0][j][o] = d0 - d2;
+            t[1][j][o] = d1 + d2;
+            t[2][j][o] = d2 - d1;
+            t[3][j][o] = d1 - d3;
+        }
+    }
+    for (i = 0; i < 4; ++i) {
+        for (o = 0; o < CNN_CBLOCK; ++o) {
+            v[(((i * 4) + 0) * pos) + o] = t[i][0][o] - t[i][2][o];
+            v[(((i * 4) + 1) * pos) + o] = t[i][1][o] + t[i][2][o];
+            v[(((i * 4) + 2) * pos) + o] = t[i][2][o] - t[i][1][o];
+            v[(((i * 4) + 3) * pos) + o] = t[i][1][o] - t[i][3][o];
+        }
+    }
+}
+
+/* @summary Implement the Winograd output transform kernel in portable C.
+ */
+static void
+CnnWinogradOutput_Scalar
+(
+    float       * __restrict    y,
+    size_t                    row,
+    float const * __restrict    m,
+    size_t                    pos,
+    float const * __restrict bias,
+    uint32_t                 relu
+)
+{
+    uint32_t i, o;
+    for (o = 0; o < CNN_CBLOCK; ++o) {
+        float t[4][2], r[4];
+        float b = bias ? bias[o] : 0.0f;
+        for (i = 0; i < 4; ++i) {
+            float m0 = m[(((i * 4) + 0) * pos) + o];
+            float m1 = m[(((i * 4) + 1) * pos) + o];
+            float m2 = m[(((i * 4) + 2) * pos) + o];
+            float m3 = m[(((i * 4) + 3) * pos) + o];
+            t[i][0] = m0 + m1 + m2;
+            t[i][1] = m1 - m2 - m3;
+        }
+        r[0] = t[0][0] + t[1][0] + t[2][0] + b;
+        r[1] = t[0][1] + t[1][1] + t[2][1] + b;
+        r[2] = t[1][0] - t[2][0] - t[3][0] + b;
+        r[3] = t[1][1] - t[2][1] - t[3][1] + b;
+        for (i = 0; i < 4; ++i) {
+            r[i] = (relu && r[i] < 0.0f) ? 0.0f : r[i];
+        }
+        y[o]                    = r[0];
+        y[CNN_CBLOCK + o]       = r[1];
+        y[row + o]              = r[2];
+        y[row + CNN_CBLOCK + o] = r[3];
+    }
+}
+
+#if CPU_ARCH_X86
+/* @summary Implement the multi-column convolution kernel using AVX2 and FMA.
+ * Each of the eight output columns is held in one ymm accumulator; each tap loads one vector of weights and issues eight FMAs against broadcast inputs.
+ */
+static CPU_TARGET("avx2,fma") void
+CnnConvBlock_AVX2
+(
+    float       * __restrict  out,
+    float const * __restrict   in,
+    float const * __restrict    w,
+    float const * __restrict bias,
+    CNN_CONV_ARGS const     *args,
+    uint32_t             kh_count,
+    uint32_t             kw_count
+)
+{
+    size_t   const  icb = args->InputBlock;
+    uint32_t const    k = args->KernelSize;
+    __m256   a0, a1, a2, a3, a4, a5, a6, a7;
+    uint32_t c, kh, kw;
+
+    a0 = bias ? _mm256_loadu_ps(bias) : _mm256_setzero_ps();
+    a1 = a0; a2 = a0; a3 = a0; a4 = a0; a5 = a0; a6 = a0; a7 = a0;
+    for (c = 0; c < args->InputChannels; ++c) {
+        float const *ip = in + ((c / icb) * args->InputPlane) + (c % icb);
+        float const *wp = w  + ((size_t) c * k * k * CNN_CBLOCK);
+        for (kh = 0; kh < kh_count; ++kh) {
+            float const *irow = ip + (kh * args->InputRow);
+            float const *wrow = wp + (kh * k * CNN_CBLOCK);
+            for (kw = 0; kw < kw_count; ++kw) {
+                __m256     wv = _mm256_loadu_ps(wrow + (kw * CNN_CBLOCK));
+                float const *x = irow + (kw * icb);
+                a0 = _mm256_fmadd_ps(_mm256_broadcast_ss(x + (0 * icb)), wv, a0);
+                a1 = _mm256_fmadd_ps(_mm256_broadcast_ss(x + (1 * icb)), wv, a1);
+                a2 = _mm256_fmadd_ps(_mm256_broadcast_ss(x + (2 * icb)), wv, a2);
+                a3 = _mm256_fmadd_ps(_mm256_broadcast_ss(x + (3 * icb)), wv, a3);
+                a4 = _mm256_fmadd_ps(_mm256_broadcast_ss(x + (4 * icb)), wv, a4);
+                a5 = _mm256_fmadd_ps(_mm256_broadcast_ss(x + (5 * icb)), wv, a5);
+                a6 = _mm256_fmadd_ps(_mm256_broadcast_ss(x + (6 * icb)), wv, a6);
+                a7 = _mm256_fmadd_ps(_mm256_broadcast_ss(x + (7 * icb)), wv, a7);
+            }
+        }
+    }
+    if (args->Relu) {
+        __m256 z = _mm256_setzero_ps();
+        a0 = _mm256_max_ps(a0, z); a1 = _mm256_max_ps(a1, z); a2 = _mm256_max_ps(a2, z); a3 = _mm256_max_ps(a3, z);
+        a4 = _mm256_max_ps(a4, z); a5 = _mm256_max_ps(a5, z); a6 = _mm256_max_ps(a6, z); a7 = _mm256_max_ps(a7, z);
+    }
+    _mm256_storeu_ps(out + (0 * CNN_CBLOCK), a0); _mm256_storeu_ps(out + (1 * CNN_CBLOCK), a1);
+    _mm256_storeu_ps(out + (2 * CNN_CBLOCK), a2); _mm256_storeu_ps(out + (3 * CNN_CBLOCK), a3);
+    _mm256_storeu_ps(out + (4 * CNN_CBLOCK), a4); _mm256_storeu_ps(out + (5 * CNN_CBLOCK), a5);
+    _mm256_storeu_ps(out + (6 * CNN_CBLOCK), a6); _mm256_storeu_ps(out + (7 * CNN_CBLOCK), a7);
+}
+
+/* @summary Implement the single-column convolution kernel using AVX2 and FMA.
+ * Alternate kernel rows accumulate into separate registers to halve the length of the FMA dependency chain.
+ */
+static CPU_TARGET("avx2,fma") void
+CnnConvColumn_AVX2
+(
+    float       * __restrict  out,
+    float const * __restrict   in,
+    float const * __restrict    w,
+    float const * __restrict bias,
+    CNN_CONV_ARGS const     *args,
+    uint32_t             kh_count,
+    uint32_t             kw_count
+)
+{
+    size_t   const  icb = args->InputBlock;
+    uint32_t const    k = args->KernelSize;
+    __m256   a0 = bias ? _mm256_loadu_ps(bias) : _mm256_setzero_ps();
+    __m256   a1 = _mm256_setzero_ps();
+    uint32_t c, kh, kw;
+
+    for (c = 0; c < args->InputChannels; ++c) {
+        float const *ip = in + ((c / icb) * args->InputPlane) + (c % icb);
+        float const *wp = w  + ((size_t) c * k * k * CNN_CBLOCK);
+        for (kh = 0; kh < kh_count; ++kh) {
+            float const *irow = ip + (kh * args->InputRow);
+            float const *wrow = wp + (kh * k * CNN_CBLOCK);
+            __m256       acc = _mm256_setzero_ps();
+            for (kw = 0; kw < kw_count; ++kw) {
+                acc = _mm256_fmadd_ps(_mm256_broadcast_ss(irow + (kw * icb)), _mm256_loadu_ps(wrow + (kw * CNN_CBLOCK)), acc);
+            }
+            if (kh & 1) a1 = _mm256_add_ps(a1, acc);
+            else        a0 = _mm256_add_ps(a0, acc);
+        }
+    }
+    a0 = _mm256_add_ps(a0, a1);
+    if (args->Relu) {
+        a0 = _mm256_max_ps(a0, _mm256_setzero_ps());
+    }
+    _mm256_storeu_ps(out, a0);
+}
+
+/* @summary Implement the weight gradient kernel using AVX2 and FMA.
+ * The accumulators of every kernel column stay in registers across the row; each output column loads one vector of deltas.
+ */
+static CPU_TARGET("avx2,fma") void
+CnnWeightGrad_AVX2
+(
+    float       * __restrict  acc,
+    float const * __restrict dout,
+    float const * __restrict   in,
+    size_t                in_step,
+    uint32_t                count,
+    uint32_t          kernel_size
+)
+{
+    __m256   a[CNN_MAX_KERNEL_SIZE];
+    uint32_t j, kw;
+
+    for (kw = 0; kw < kernel_size; ++kw) {
+        a[kw] = _mm256_loadu_ps(acc + (kw * CNN_CBLOCK));
+    }
+    switch (kernel_size) {
+        /* unroll the common kernel sizes so that the accumulators are register-allocated */
+#define CNN_WGRAD_AVX2_CASE(_k)                                                \
+        case _k:                                                               \
+            for (j = 0; j < count; ++j) {                                      \
+                __m256       d = _mm256_loadu_ps(dout + (j * CNN_CBLOCK));     \
+                float const *x = in + (j * in_step);                           \
+                for (kw = 0; kw < _k; ++kw) {                                  \
+                    a[kw] = _mm256_fmadd_ps(_mm256_broadcast_ss(x + (kw * in_step)), d, a[kw]); \
+                }                                                              \
+            }                                                                  \
+            break
+        CNN_WGRAD_AVX2_CASE(3);
+        CNN_WGRAD_AVX2_CASE(5);
+#undef  CNN_WGRAD_AVX2_CASE
+        default:
+            for (j = 0; j < count; ++j) {
+                __m256       d = _mm256_loadu_ps(dout + (j * CNN_CBLOCK));
+                float const *x = in + (j * in_step);
+                for (kw = 0; kw < kernel_size; ++kw) {
+                    a[kw] = _mm256_fmadd_ps(_mm256_broadcast_ss(x + (kw * in_step)), d, a[kw]);
+                }
+            }
+            break;
+    }
+    for (kw = 0; kw < kernel_size; ++kw) {
+        _mm256_storeu_ps(acc + (kw * CNN_CBLOCK), a[kw]);
+    }
+}
+
+/* @summary Implement the Winograd input transform kernel using AVX2. Each row of the tile is one register per column.
+ */
+static CPU_TARGET("avx2,fma") void
+CnnWinogradInput_AVX2
+(
+    float       * __restrict    v,
+    size_t                    pos,
+    float const * __restrict    d,
+    size_t                    row
+)
+{
+    __m256   t[4][4];
+    uint32_t i, j;
+    for (j = 0; j < 4; ++j) {
+        __m256 d0 = _mm256_loadu_ps(d + (0 * row) + (j * CNN_CBLOCK));
+        __m256 d1 = _mm256_loadu_ps(d + (1 * row) + (j * CNN_CBLOCK));
+        __m256 d2 = _mm256_loadu_ps(d + (2 * row) + (j * CNN_CBLOCK));
+        __m256 d3 = _mm256_loadu_ps(d + (3 * row) + (j * CNN_CBLOCK));
+        t[0][j] = _mm256_sub_ps(d0, d2);
+        t[1][j] = _mm256_add_ps(d1, d2);
+        t[2][j] = _mm256_sub_ps(d2, d1);
+        t[3][j] = _mm256_sub_ps(d1, d3);
+    }
+    for (i = 0; i < 4; ++i) {
+        _mm256_storeu_ps(v + (((i * 4) + 0) * pos), _mm256_sub_ps(t[i][0], t[i][2]));
+        _mm256_storeu_ps(v + (((i * 4) + 1) * pos), _mm256_add_ps(t[i][1], t[i][2]));
+        _mm256_storeu_ps(v + (((i * 4) + 2) * pos), _mm256_sub_ps(t[i][2], t[i][1]));
+        _mm256_storeu_ps(v + (((i * 4) + 3) * pos), _mm256_sub_ps(t[i][1], t[i][3]));
+    }
+}
+
+/* @summary Implement the Winograd output transform kernel using AVX2.
+ */
+static CPU_TARGET("avx2,fma") void
+CnnWinogradOutput_AVX2
+(
+    float       * __restrict    y,
+    size_t                    row,
+    float const * __restrict    m,
+    size_t                    pos,
+    float const * __restrict bias,
+    uint32_t                 relu
+)
+{
+    __m256   b = bias ? _mm256_loadu_ps(bias) : _mm256_setzero_ps();
+    __m256   t[4][2], r[4];
+    uint32_t i;
+    for (i = 0; i < 4; ++i) {
+        __m256 m0 = _mm256_loadu_ps(m + (((i * 4) + 0) * pos));
+        __m256 m1 = _mm256_loadu_ps(m + (((i * 4) + 1) * pos));
+        __m256 m2 = _mm256_loadu_ps(m + (((i * 4) + 2) * pos));
+        __m256 m3 = _mm256_loadu_ps(m + (((i * 4) + 3) * pos));
+        t[i][0] = _mm256_add_ps(_mm256_add_ps(m0, m1), m2);
+        t[i][1] = _mm256_sub_ps(_mm256_sub_ps(m1, m2), m3);
+    }
+    r[0] = _mm256_add_ps(_mm256_add_ps(_mm256_add_ps(t[0][0], t[1][0]), t[2][0]), b);
+    r[1] = _mm256_add_ps(_mm256_add_ps(_mm256_add_ps(t[0][1], t[1][1]), t[2][1]), b);
+    r[2] = _mm256_add_ps(_mm256_sub_ps(_mm256_sub_ps(t[1][0], t[2][0]), t[3][0]), b);
+    r[3] = _mm256_add_ps(_mm256_sub_ps(_mm256_sub_ps(t[1][1], t[2][1]), t[3][1]), b);
+    if (relu) {
+        __m256 z = _mm256_setzero_ps();
+        r[0] = _mm256_max_ps(r[0], z); r[1] = _mm256_max_ps(r[1], z); r[2] = _mm256_max_ps(r[2], z); r[3] = _mm256_max_ps(r[3], z);
+    }
+    _mm256_storeu_ps(y, r[0]);
+    _mm256_storeu_ps(y + CNN_CBLOCK, r[1]);
+    _mm256_storeu_ps(y + row, r[2]);
+    _mm256_storeu_ps(y + row + CNN_CBLOCK, r[3]);
+}
+#endif /* CPU_ARCH_X86 */
+
+/* @summary The kernels implementing CNN_KERNEL_SCALAR.
+ */
+static CNN_KERNEL_FUNCS const CNN_KERNEL_FUNCS_SCALAR = {
+    CnnConvBlock_Scalar, CnnConvColumn_Scalar, CnnWeightGrad_Scalar, CnnWinogradInput_Scalar, CnnWinogradOutput_Scalar
+};
+
+#if CPU_ARCH_X86
+/* @summary The kernels implementing CNN_KERNEL_AVX2.
+ */
+static CNN_KERNEL_FUNCS const CNN_KERNEL_FUNCS_AVX2 = {
+    CnnConvBlock_AVX2, CnnConvColumn_AVX2, CnnWeightGrad_AVX2, CnnWinogradInput_AVX2, CnnWinogradOutput_AVX2
+};
+#endif
+
+/* @summary Retrieve the kernels implementing a kernel identifier.
+ * @param kernel One of the values of the CNN_KERNEL enumeration.
+ * @return The kernels, or NULL if the kernel is not supported by the host CPU.
+ */
+static CNN_KERNEL_FUNCS const*
+CnnKernel
+(
+    uint32_t kernel
+)
+{
+#if CPU_ARCH_X86
+    uint32_t cpu = CpuFeatureFlags();
+#endif
+    switch (kernel) {
+        case CNN_KERNEL_SCALAR:
+            return &CNN_KERNEL_FUNCS_SCALAR;
+#if CPU_ARCH_X86
+        case CNN_KERNEL_AVX2:
+            return ((cpu & (CPU_FEATURE_AVX2 | CPU_FEATURE_FMA)) == (CPU_FEATURE_AVX2 | CPU_FEATURE_FMA)) ? &CNN_KERNEL_FUNCS_AVX2 : NULL;
+#endif
+        default:
+            return NULL;
+    }
+}
+
+/* @summary Retrieve the selected kernels, selecting the fastest kernels supported by the host on first use.
+ * @return The convolution kernels.
+ */
+static CNN_KERNEL_FUNCS const*
+CnnCurrentKernel
+(
+    void
+)
+{
+    CNN_KERNEL_FUNCS const *kernel = Global_CnnKernel;
+    if (kernel == NULL) {
+        uint32_t id = CNN_KERNEL_COUNT;
+        while (kernel == NULL && id-- > 0) {
+            kernel = CnnKernel(id);
+        }
+        Global_CnnKernel = kernel;
+    }
+    return kernel;
+}
+
+/* @summary Generate a uniformly-distributed random value in [-1, 1) from a xorshift64* generator.
+ * @param state The generator state, updated on return. Must be non-zero.
+ * @return A pseudo-random value in [-1, 1).
+ */
+static float
+CnnRandomUniform
+(
+    uint64_t *state
+)
+{
+    uint64_t x = *state;
+    x ^= x >> 12;
+    x ^= x << 25;
+    x ^= x >> 27;
+    *state = x;
+    return ((float)((x * 0x2545F4914F6CDD1DULL) >> 40) * (2.0f / 16777216.0f)) - 1.0f;
+}
+
+/* @summary Compute the number of bytes needed for a buffer of floats, rounded up to CNN_ALIGNMENT.
+ * @param count The number of floats.
+ * @return The buffer size, in bytes.
+ */
+static size_t
+CnnBufferSize
+(
+    size_t count
+)
+{
+    return AlignUp(count * sizeof(float), (size_t) CNN_ALIGNMENT);
+}
+
+/* @summary Compute the number of CNN_CBLOCK-channel blocks needed to hold a number of channels.
+ * @param channels The number of channels.
+ * @return The number of channel blocks.
+ */
+static uint32_t
+CnnBlockCount
+(
+    uint32_t channels
+)
+{
+    return (channels + CNN_CBLOCK - 1) / CNN_CBLOCK;
+}
+
+/* @summary Compute the number of floats in the convolution weights of a layer.
+ * @param layer The layer.
+ * @return The number of floats in Weights, or zero for a max-pool layer.
+ */
+static size_t
+CnnWeightCount
+(
+    CNN_LAYER const *layer
+)
+{
+    if (layer->Type != CNN_LAYER_CONV) {
+        return 0;
+    }
+    return (size_t) CnnBlockCount(layer->OutputChannels) * layer->InputChannels * layer->KernelSize * layer->KernelSize * CNN_CBLOCK;
+}
+
+/* @summary Compute the number of floats in the flipped convolution weights of a layer, used to compute the gradient with respect to its inputs.
+ * @param layer The layer.
+ * @return The number of floats in WeightsFlipped, or zero if the layer does not propagate deltas to its inputs.
+ */
+static size_t
+CnnFlippedCount
+(
+    CNN_LAYER const *layer
+)
+{
+    if (layer->Type != CNN_LAYER_CONV || layer->InputBlock != CNN_CBLOCK) {
+        return 0;
+    }
+    return (size_t) CnnBlockCount(layer->InputChannels) * layer->OutputChannels * layer->KernelSize * layer->KernelSize * CNN_CBLOCK;
+}
+
+/* @summary Convolve one image, computing every output channel block, row and column.
+ * Output columns whose kernel window lies entirely inside the input are computed CNN_OW_BLOCK at a time; the window is clipped for the remainder.
+ * @param kernel The convolution kernels.
+ * @param shape The geometry of the convolution.
+ * @param out The output image, with dimensions [OutputBlocks][OutputHeight][OutputWidth][CNN_CBLOCK].
+ * @param in The input image, with dimensions [InputChannels / InputBlock][InputHeight][InputWidth][InputBlock].
+ * @param w The weights, with dimensions [OutputBlocks][InputChannels][KernelSize][KernelSize][CNN_CBLOCK].
+ * @param bias The bias of each output channel, OutputBlocks * CNN_CBLOCK values, or NULL.
+ */
+static void
+CnnConvImage
+(
+    CNN_KERNEL_FUNCS const *kernel,
+    CNN_CONV_SHAPE const    *shape,
+    float                     *out,
+    float const                *in,
+    float const                 *w,
+    float const              *bias
+)
+{
+    int32_t const  k = (int32_t) shape->KernelSize;
+    int32_t const  p = (int32_t) shape->Padding;
+    int32_t const ih = (int32_t) shape->InputHeight;
+    int32_t const iw = (int32_t) shape->InputWidth;
+    int32_t const ow = (int32_t) shape->OutputWidth;
+    /* output columns [lo, hi) see every kernel column inside the input */
+    int32_t const lo = MinValue(p, ow);
+    int32_t const hi = MaxValue(lo, MinValue(iw + p - k + 1, ow));
+    CNN_CONV_ARGS args;
+    uint32_t      b;
+    int32_t    y, x;
+
+    args.InputPlane    = (size_t) shape->InputHeight * shape->InputWidth * shape->InputBlock;
+    args.InputRow      = (size_t) shape->InputWidth  * shape->InputBlock;
+    args.InputChannels = shape->InputChannels;
+    args.InputBlock    = shape->InputBlock;
+    args.KernelSize    = shape->KernelSize;
+    args.Relu          = shape->Relu;
+    for (b = 0; b < shape->OutputBlocks; ++b) {
+        float const *wb = w + ((size_t) b * shape->InputChannels * k * k * CNN_CBLOCK);
+        float const *bb = bias ? bias + (b * CNN_CBLOCK) : NULL;
+        float       *ob = out + ((size_t) b * shape->OutputHeight * ow * CNN_CBLOCK);
+        for (y = 0; y < (int32_t) shape->OutputHeight; ++y) {
+            int32_t      kh0 = MaxValue(0, p - y);
+            int32_t      kh1 = MaxValue(kh0, MinValue(k, ih + p - y));
+            float const *row = in + ((size_t)(y + kh0 - p) * args.InputRow);
+            float const *wkh = wb + ((size_t) kh0 * k * CNN_CBLOCK);
+            float       *orow = ob + ((size_t) y * ow * CNN_CBLOCK);
+            for (x = 0; x < ow; ) {
+                if (x >= lo && x + CNN_OW_BLOCK <= hi) {
+                    kernel->ConvBlock(orow + (x * CNN_CBLOCK), row + ((x - p) * shape->InputBlock), wkh, bb, &args, kh1 - kh0, k);
+                    x += CNN_OW_BLOCK;
+                } else {
+                    int32_t kw0 = MaxValue(0, p - x);
+                    int32_t kw1 = MaxValue(kw0, MinValue(k, iw + p - x));
+                    kernel->ConvColumn(orow + (x * CNN_CBLOCK), row + ((x + kw0 - p) * shape->InputBlock), wkh + (kw0 * CNN_CBLOCK), bb, &args, kh1 - kh0, kw1 - kw0);
+                    x += 1;
+                }
+            }
+        }
+    }
+}
+
+/* @summary Describe the forward convolution of a layer.
+ * @param o_shape On return, the geometry of the convolution.
+ * @param layer The convolution layer.
+ */
+static void
+CnnForwardShape
+(
+    CNN_CONV_SHAPE *o_shape,
+    CNN_LAYER const *layer
+)
+{
+    o_shape->InputChannels = layer->InputChannels;
+    o_shape->InputBlock    = layer->InputBlock;
+    o_shape->InputHeight   = layer->InputHeight;
+    o_shape->InputWidth    = layer->InputWidth;
+    o_shape->OutputBlocks  = CnnBlockCount(layer->OutputChannels);
+    o_shape->OutputHeight  = layer->OutputHeight;
+    o_shape->OutputWidth   = layer->OutputWidth;
+    o_shape->KernelSize    = layer->KernelSize;
+    o_shape->Padding       = layer->Padding;
+    o_shape->Relu          = 1;
+}
+
+/* @summary Describe the convolution that computes the gradient with respect to the inputs of a layer from its output deltas.
+ * This is a convolution of the deltas with the flipped weights, padded so that the result has the dimensions of the layer input.
+ * @param o_shape On return, the geometry of the convolution.
+ * @param layer The convolution layer.
+ */
+static void
+CnnInputGradShape
+(
+    CNN_CONV_SHAPE *o_shape,
+    CNN_LAYER const *layer
+)
+{
+    o_shape->InputChannels = layer->OutputChannels;
+    o_shape->InputBlock    = CNN_CBLOCK;
+    o_shape->InputHeight   = layer->OutputHeight;
+    o_shape->InputWidth    = layer->OutputWidth;
+    o_shape->OutputBlocks  = CnnBlockCount(layer->InputChannels);
+    o_shape->OutputHeight  = layer->InputHeight;
+    o_shape->OutputWidth   = layer->InputWidth;
+    o_shape->KernelSize    = layer->KernelSize;
+    o_shape->Padding       = layer->KernelSize - 1 - layer->Padding;
+    o_shape->Relu          = 0;
+}
+
+/* @summary Compute the max-pool of one image.
+ * @param layer The max-pool layer.
+ * @param out The output image, with dimensions [OutputBlocks][OutputHeight][OutputWidth][CNN_CBLOCK].
+ * @param in The input image, with dimensions [OutputBlocks][InputHeight][InputWidth][CNN_CBLOCK].
+ */
+static void
+CnnPoolImage
+(
+    CNN_LAYER const *layer,
+    float             *out,
+    float const        *in
+)
+{
+    uint32_t const s = layer->KernelSize;
+    uint32_t b, y, x, dy, dx, o;
+    for (b = 0; b < CnnBlockCount(layer->OutputChannels); ++b) {
+        float const *ib = in + ((size_t) b * layer->InputHeight * layer->InputWidth * CNN_CBLOCK);
+        for (y = 0; y < layer->OutputHeight; ++y) {
+            for (x = 0; x < layer->OutputWidth; ++x) {
+                float m[CNN_CBLOCK];
+                memcpy(m, ib + ((((size_t) y * s * layer->InputWidth) + (x * s)) * CNN_CBLOCK), sizeof(m));
+                for (dy = 0; dy < s; ++dy) {
+                    float const *r = ib + ((((size_t)((y * s) + dy) * layer->InputWidth) + (x * s)) * CNN_CBLOCK);
+                    for (dx = 0; dx < s; ++dx) {
+                        for (o = 0; o < CNN_CBLOCK; ++o) {
+                            m[o] = r[(dx * CNN_CBLOCK) + o] > m[o] ? r[(dx * CNN_CBLOCK) + o] : m[o];
+                        }
+                    }
+                }
+                memcpy(out, m, sizeof(m));
+                out += CNN_CBLOCK;
+            }
+        }
+    }
+}
+
+/* @summary Route the output deltas of a max-pool of one image to the input that produced each maximum, the first in row-major order if several are equal.
+ * Inputs that did not produce a maximum, including rows and columns past the last whole window, receive zero.
+ * @param layer The max-pool layer.
+ * @param din The input deltas, with the dimensions of the input image.
+ * @param dout The output deltas, with the dimensions of the output image.
+ * @param in The input image.
+ * @param out The output image.
+ */
+static void
+CnnPoolBackwardImage
+(
+    CNN_LAYER const *layer,
+    float             *din,
+    float const      *dout,
+    float const        *in,
+    float const       *out
+)
+{
+    uint32_t const s = layer->KernelSize;
+    uint32_t b, y, x, dy, dx, o;
+    memset(din, 0, (size_t) CnnBlockCount(layer->InputChannels) * layer->InputHeight * layer->InputWidth * CNN_CBLOCK * sizeof(float));
+    for (b = 0; b < CnnBlockCount(layer->OutputChannels); ++b) {
+        size_t   base = (size_t) b * layer->InputHeight * layer->InputWidth * CNN_CBLOCK;
+        for (y = 0; y < layer->OutputHeight; ++y) {
+            for (x = 0; x < layer->OutputWidth; ++x) {
+                for (o = 0; o < CNN_CBLOCK; ++o) {
+                    float m = out[o];
+                    for (dy = 0; dy < s; ++dy) {
+                        size_t i = base + ((((size_t)((y * s) + dy) * layer->InputWidth) + (x * s)) * CNN_CBLOCK) + o;
+                        for (dx = 0; dx < s; ++dx, i += CNN_CBLOCK) {
+                            if (in[i] == m) {
+                                din[i] = dout[o];
+                                goto next_lane;
+                            }
+                        }
+                    }
+next_lane:;
+                }
+                out  += CNN_CBLOCK;
+                dout += CNN_CBLOCK;
+            }
+        }
+    }
+}
+
+/* @summary Run the forward pass of one layer for a range of images.
+ * @param argp Pointer to the CNN_LAYER_ARGS.
+ * @param begin The first image index.
+ * @param end One past the last image index.
+ * @param thread_index The index of the calling thread. Unused.
+ */
+static void
+CnnForwardImages
+(
+    void          *argp,
+    uint32_t      begin,
+    uint32_t        end,
+    uint32_t thread_index
+)
+{
+    CNN_LAYER_ARGS const *args = (CNN_LAYER_ARGS const*) argp;
+    CNN_LAYER const     *layer = args->Layer;
+    CNN_CONV_SHAPE       shape;
+    uint32_t                 i;
+
+    (void) thread_index;
+    CnnForwardShape(&shape, layer);
+    for (i = begin; i < end; ++i) {
+        float const *in  = args->Inputs   + (i * args->InputStride);
+        float       *out = layer->Outputs + ((size_t) i * layer->OutputStride);
+        if (layer->Type == CNN_LAYER_CONV) {
+            CnnConvImage(args->Kernel, &shape, out, in, layer->Weights, layer->Bias);
+        } else {
+            CnnPoolImage(layer, out, in);
+        }
+    }
+}
+
+/* @summary Run the part of the backward pass of one layer that is independent for each image, for a range of images.
+ * For a convolution, the output deltas are masked by the ReLU derivative, and the input deltas are computed if requested.
+ * For a max-pool, the output deltas are routed to the input deltas.
+ * @param argp Pointer to the CNN_LAYER_ARGS.
+ * @param begin The first image index.
+ * @param end One past the last image index.
+ * @param thread_index The index of the calling thread. Unused.
+ */
+static void
+CnnBackwardImages
+(
+    void          *argp,
+    uint32_t      begin,
+    uint32_t        end,
+    uint32_t thread_index
+)
+{
+    CNN_LAYER_ARGS const *args = (CNN_LAYER_ARGS const*) argp;
+    CNN_LAYER const     *layer = args->Layer;
+    size_t const         count = (size_t) CnnBlockCount(layer->OutputChannels) * layer->OutputHeight * layer->OutputWidth * CNN_CBLOCK;
+    CNN_CONV_SHAPE       shape;
+    uint32_t              i, j;
+
+    (void) thread_index;
+    CnnInputGradShape(&shape, layer);
+    for (i = begin; i < end; ++i) {
+        float const *y  = layer->Outputs + ((size_t) i * layer->OutputStride);
+        float       *dy = layer->Deltas  + ((size_t) i * layer->OutputStride);
+        float       *dx = args->InputDeltas ? args->InputDeltas + (i * args->InputStride) : NULL;
+        if (layer->Type == CNN_LAYER_CONV) {
+            for (j = 0; j < count; ++j) {
+                dy[j] = y[j] > 0.0f ? dy[j] : 0.0f;
+            }
+            if (dx != NULL) {
+                CnnConvImage(args->Kernel, &shape, dx, dy, layer->WeightsFlipped, NULL);
+            }
+        } else if (dx != NULL) {
+            CnnPoolBackwardImage(layer, dx, dy, args->Inputs + (i * args->InputStride), y);
+        }
+    }
+}
+
+/* @summary Compute the weight and bias gradients of a convolution layer over every image of the batch, for a range of kernel rows.
+ * Kernel row r is row (r % KernelSize) of input channel ((r / KernelSize) % InputChannels) of output block (r / (KernelSize * InputChannels)), so no two tasks write the same gradient.
+ * @param argp Pointer to the CNN_LAYER_ARGS.
+ * @param begin The first kernel row.
+ * @param end One past the last kernel row.
+ * @param thread_index The index of the calling thread. Unused.
+ */
+static void
+CnnWeightGradRows
+(
+    void          *argp,
+    uint32_t      begin,
+    uint32_t        end,
+    uint32_t thread_index
+)
+{
+    CNN_LAYER_ARGS const *args = (CNN_LAYER_ARGS const*) argp;
+    CNN_LAYER const     *layer = args->Layer;
+    int32_t const            k = (int32_t) layer->KernelSize;
+    int32_t const            p = (int32_t) layer->Padding;
+    int32_t const           iw = (int32_t) layer->InputWidth;
+    int32_t const           ow = (int32_t) layer->OutputWidth;
+    uint32_t const         icb = layer->InputBlock;
+    size_t const         plane = (size_t) layer->OutputHeight * ow * CNN_CBLOCK;
+    /* output columns [lo, hi) see every kernel column inside the input */
+    int32_t const           lo = MinValue(p, ow);
+    int32_t const           hi = MaxValue(lo, MinValue(iw + p - k + 1, ow));
+    uint32_t r, i, o;
+    int32_t  y, x, kw;
+
+    (void) thread_index;
+    for (r = begin; r < end; ++r) {
+        uint32_t  kh = r % k;
+        uint32_t   c = (r / k) % layer->InputChannels;
+        uint32_t   b = r / (k * layer->InputChannels);
+        float   *acc = layer->WeightGrad + (((((size_t) b * layer->InputChannels) + c) * k + kh) * k * CNN_CBLOCK);
+        memset(acc, 0, (size_t) k * CNN_CBLOCK * sizeof(float));
+        for (i = 0; i < args->Count; ++i) {
+            float const *in = args->Inputs  + (i * args->InputStride) + ((c / icb) * (size_t) layer->InputHeight * iw * icb) + (c % icb);
+            float const *dy = layer->Deltas + ((size_t) i * layer->OutputStride) + (b * plane);
+            for (y = 0; y < (int32_t) layer->OutputHeight; ++y) {
+                int32_t       iy = y + (int32_t) kh - p;
+                float const *row = in + ((size_t) iy * iw * icb);
+                float const *dyr = dy + ((size_t) y * ow * CNN_CBLOCK);
+                if (iy < 0 || iy >= (int32_t) layer->InputHeight) {
+                    continue;
+                }
+                if (hi > lo) {
+                    args->Kernel->WeightGrad(acc, dyr + (lo * CNN_CBLOCK), row + ((lo - p) * (int32_t) icb), icb, hi - lo, k);
+                }
+                for (x = 0; x < ow; x = (x + 1 == lo) ? hi : x + 1) {
+                    if (x >= lo && x < hi) {
+                        continue;
+                    }
+                    for (kw = MaxValue(0, p - x); kw < MinValue(k, iw + p - x); ++kw) {
+                        float v = row[(x + kw - p) * (int32_t) icb];
+                        for (o = 0; o < CNN_CBLOCK; ++o) {
+                            acc[(kw * CNN_CBLOCK) + o] += v * dyr[(x * CNN_CBLOCK) + o];
+                        }
+                    }
+                }
+            }
+        }
+        if (c == 0 && kh == 0) {
+            /* one task per output block also sums the bias gradient */
+            float *db = layer->BiasGrad + (b * CNN_CBLOCK);
+            memset(db, 0, CNN_CBLOCK * sizeof(float));
+            for (i = 0; i < args->Count; ++i) {
+                float const *dy = layer->Deltas + ((size_t) i * layer->OutputStride) + (b * plane);
+                size_t       j;
+                for (j = 0; j < plane; j += CNN_CBLOCK) {
+                    for (o = 0; o < CNN_CBLOCK; ++o) {
+                        db[o] += dy[j + o];
+                    }
+                }
+            }
+        }
+    }
+}
+
+/* @summary Rebuild the flipped weights of a convolution layer from its current weights.
+ * WeightsFlipped[ib][oc][kh][kw][il] = Weights[oc / CNN_CBLOCK][(ib * CNN_CBLOCK) + il][K - 1 - kh][K - 1 - kw][oc % CNN_CBLOCK], or zero past InputChannels.
+ * @param layer The convolution layer.
+ */
+static void
+CnnFlipWeights
+(
+    CNN_LAYER *layer
+)
+{
+    uint32_t const k = layer->KernelSize;
+    uint32_t ib, oc, kh, kw, il;
+    for (ib = 0; ib < CnnBlockCount(layer->InputChannels); ++ib) {
+        for (oc = 0; oc < layer->OutputChannels; ++oc) {
+            float *dst = layer->WeightsFlipped + ((((size_t) ib * layer->OutputChannels) + oc) * k * k * CNN_CBLOCK);
+            for (kh = 0; kh < k; ++kh) {
+                for (kw = 0; kw < k; ++kw) {
+                    for (il = 0; il < CNN_CBLOCK; ++il) {
+                        uint32_t ic = (ib * CNN_CBLOCK) + il;
+                        float     v = 0.0f;
+                        if (ic < layer->InputChannels) {
+                            v = layer->Weights[(((((((size_t)(oc / CNN_CBLOCK) * layer->InputChannels) + ic) * k) + (k - 1 - kh)) * k + (k - 1 - kw)) * CNN_CBLOCK) + (oc % CNN_CBLOCK)];
+                        }
+                        *dst++ = v;
+                    }
+                }
+            }
+        }
+    }
+}
+
+/* @summary Define the arguments shared by the tasks that transform the tiles of a group of images for the Winograd path.
+ */
+typedef struct CNN_WINOGRAD_ARGS {
+    CNN_KERNEL_FUNCS const      *Kernel;                                       /* The transform kernels. */
+    CNN_CONV_SHAPE const        *Shape;                                        /* The geometry of the convolution. */
+    float const                 *Inputs;                                       /* The first input image of the group. */
+    float                       *Outputs;                                      /* The first output image of the group. */
+    float const                 *Bias;                                         /* The bias of each output channel, or NULL. */
+    float                       *TileInputs;                                   /* The transformed input tiles, with dimensions [16][TileCount][InputLd]. */
+    float const                 *TileProducts;                                 /* The transformed output tiles, with dimensions [16][TileCount][OutputLd]. */
+    size_t                       InputStride;                                  /* The distance between the start of consecutive input images, in floats. */
+    size_t                       OutputStride;                                 /* The distance between the start of consecutive output images, in floats. */
+    uint32_t                     TilesX;                                       /* The number of 2x2 output tiles across each image. */
+    uint32_t                     TilesY;                                       /* The number of 2x2 output tiles down each image. */
+    uint32_t                     TileCount;                                    /* The number of tiles in the group, the distance between consecutive transform positions. */
+    uint32_t                     InputLd;                                      /* The distance between consecutive tiles of TileInputs, in floats. */
+    uint32_t                     OutputLd;                                     /* The distance between consecutive tiles of TileProducts, in floats. */
+} CNN_WINOGRAD_ARGS;
+
+/* @summary Compute how many images the Winograd path transforms together for a convolution.
+ * @param shape The geometry of the convolution.
+ * @param max_count The largest number of images in a batch.
+ * @param o_tiles On return, the number of tiles in a group of images.
+ * @return The number of images in each group.
+ */
+static uint32_t
+CnnWinogradGroup
+(
+    CNN_CONV_SHAPE const *shape,
+    uint32_t          max_count,
+    uint32_t           *o_tiles
+)
+{
+    uint32_t tiles = ((shape->OutputHeight + 1) / 2) * ((shape->OutputWidth + 1) / 2);
+    uint32_t group = MaxValue(1U, MinValue(max_count, CNN_WINOGRAD_TILES / tiles));
+    *o_tiles = group * tiles;
+    return group;
+}
+
+/* @summary Compute the Winograd weight transform U = G g G^T of every 3x3 kernel of a convolution.
+ * @param shape The geometry of the convolution.
+ * @param w The weights, with dimensions [OutputBlocks][InputChannels][3][3][CNN_CBLOCK].
+ * @param u The transformed weights, with dimensions [16][InputChannels][OutputBlocks * CNN_CBLOCK].
+ */
+static void
+CnnWinogradWeights
+(
+    CNN_CONV_SHAPE const *shape,
+    float const              *w,
+    float                    *u
+)
+{
+    size_t const ldu = (size_t) shape->OutputBlocks * CNN_CBLOCK;
+    size_t const pos = (size_t) shape->InputChannels * ldu;
+    uint32_t b, c, i, o;
+    for (b = 0; b < shape->OutputBlocks; ++b) {
+        for (c = 0; c < shape->InputChannels; ++c) {
+            float const *g = w + ((((size_t) b * shape->InputChannels) + c) * 9 * CNN_CBLOCK);
+            float       *d = u + ((size_t) c * ldu) + (b * CNN_CBLOCK);
+            for (o = 0; o < CNN_CBLOCK; ++o) {
+                float t[4][3];
+                for (i = 0; i < 3; ++i) {
+                    float g0 = g[((0 * 3) + i) * CNN_CBLOCK + o];
+                    float g1 = g[((1 * 3) + i) * CNN_CBLOCK + o];
+                    float g2 = g[((2 * 3) + i) * CNN_CBLOCK + o];
+                    t[0][i] = g0;
+                    t[1][i] = 0.5f * (g0 + g1 + g2);
+                    t[2][i] = 0.5f * (g0 - g1 + g2);
+                    t[3][i] = g2;
+                }
+                for (i = 0; i < 4; ++i) {
+                    d[(((i * 4) + 0) * pos) + o] = t[i][0];
+                    d[(((i * 4) + 1) * pos) + o] = 0.5f * (t[i][0] + t[i][1] + t[i][2]);
+                    d[(((i * 4) + 2) * pos) + o] = 0.5f * (t[i][0] - t[i][1] + t[i][2]);
+                    d[(((i * 4) + 3) * pos) + o] = t[i][2];
+                }
+            }
+        }
+    }
+}
+
+/* @summary Compute the Winograd input transform V = B^T d B of every 4x4 input tile of a range of images in a group.
+ * Tiles overlap by two rows and columns; values outside the input, including the padding, are zero.
+ * Tiles that lie inside a channel-blocked input are read in place; other tiles are first copied to a zero-filled buffer.
+ * @param argp Pointer to the CNN_WINOGRAD_ARGS.
+ * @param begin The index within the group of the first image.
+ * @param end One past the index within the group of the last image.
+ * @param thread_index The index of the calling thread. Unused.
+ */
+static void
+CnnWinogradInputTiles
+(
+    void          *argp,
+    uint32_t      begin,
+    uint32_t        end,
+    uint32_t thread_index
+)
+{
+    CNN_WINOGRAD_ARGS const *args = (CNN_WINOGRAD_ARGS const*) argp;
+    CNN_CONV_SHAPE const   *shape = args->Shape;
+    uint32_t const            icb = shape->InputBlock;
+    int32_t const               p = (int32_t) shape->Padding;
+    int32_t const              ih = (int32_t) shape->InputHeight;
+    int32_t const              iw = (int32_t) shape->InputWidth;
+    size_t const              row = (size_t) iw * icb;
+    size_t const            plane = (size_t) ih * row;
+    size_t const              pos = (size_t) args->TileCount * args->InputLd;
+    uint32_t const         blocks = (shape->InputChannels + icb - 1) / icb;
+    float       d[4 * 4 * CNN_CBLOCK];
+    uint32_t    n, tx, ty, b, o;
+    int32_t     i, j;
+
+    (void) thread_index;
+    for (n = begin; n < end; ++n) {
+        float const *image = args->Inputs + (n * args->InputStride);
+        for (ty = 0; ty < args->TilesY; ++ty) {
+            int32_t y0 = (int32_t)(2 * ty) - p;
+            for (tx = 0; tx < args->TilesX; ++tx) {
+                int32_t  x0 = (int32_t)(2 * tx) - p;
+                int32_t  in = (y0 >= 0 && y0 + 4 <= ih && x0 >= 0 && x0 + 4 <= iw);
+                size_t tile = (((size_t) n * args->TilesY) + ty) * args->TilesX + tx;
+                for (b = 0; b < blocks; ++b) {
+                    float const *src = image + (b * plane);
+                    float       *dst = args->TileInputs + (tile * args->InputLd) + (b * icb);
+                    if (icb == CNN_CBLOCK && in) {
+                        args->Kernel->WinogradInput(dst, pos, src + ((size_t) y0 * row) + ((size_t) x0 * icb), row);
+                        continue;
+                    }
+                    /* gather the tile, with zeros outside the input, as CNN_CBLOCK lanes of which the first icb are used */
+                    memset(d, 0, sizeof(d));
+                    for (i = 0; i < 4; ++i) {
+                        for (j = 0; j < 4; ++j) {
+                            int32_t y = y0 + i;
+                            int32_t x = x0 + j;
+                            if (y >= 0 && y < ih && x >= 0 && x < iw) {
+                                memcpy(&d[((i * 4) + j) * CNN_CBLOCK], src + ((size_t) y * row) + ((size_t) x * icb), icb * sizeof(float));
+                            }
+                        }
+                    }
+                    if (icb == CNN_CBLOCK) {
+                        args->Kernel->WinogradInput(dst, pos, d, 4 * CNN_CBLOCK);
+                    } else {
+                        float v[16 * CNN_CBLOCK];
+                        args->Kernel->WinogradInput(v, CNN_CBLOCK, d, 4 * CNN_CBLOCK);
+                        for (i = 0; i < 16; ++i) {
+                            for (o = 0; o < icb; ++o) {
+                                dst[(i * pos) + o] = v[(i * CNN_CBLOCK) + o];
+                            }
+                        }
+                    }
+                }
+            }
+        }
+    }
+}
+
+/* @summary Compute the Winograd output transform Y = A^T m A of every tile of a range of images in a group, and add the bias and apply ReLU if requested.
+ * Outputs of the last tile row or column that fall outside an odd-sized output are discarded.
+ * @param argp Pointer to the CNN_WINOGRAD_ARGS.
+ * @param begin The index within the group of the first image.
+ * @param end One past the index within the group of the last image.
+ * @param thread_index The index of the calling thread. Unused.
+ */
+static void
+CnnWinogradOutputTiles
+(
+    void          *argp,
+    uint32_t      begin,
+    uint32_t        end,
+    uint32_t thread_index
+)
+{
+    CNN_WINOGRAD_ARGS const *args = (CNN_WINOGRAD_ARGS const*) argp;
+    CNN_CONV_SHAPE const   *shape = args->Shape;
+    uint32_t const             oh = shape->OutputHeight;
+    uint32_t const             ow = shape->OutputWidth;
+    size_t const              row = (size_t) ow * CNN_CBLOCK;
+    size_t const            plane = (size_t) oh * row;
+    size_t const              pos = (size_t) args->TileCount * args->OutputLd;
+    float       y[2 * 2 * CNN_CBLOCK];
+    uint32_t    n, tx, ty, b, i, j;
+
+    (void) thread_index;
+    for (n = begin; n < end; ++n) {
+        float *image = args->Outputs + (n * args->OutputStride);
+        for (ty = 0; ty < args->TilesY; ++ty) {
+            for (tx = 0; tx < args->TilesX; ++tx) {
+                size_t tile = (((size_t) n * args->TilesY) + ty) * args->TilesX + tx;
+                int32_t in = ((2 * ty) + 2 <= oh && (2 * tx) + 2 <= ow);
+                for (b = 0; b < shape->OutputBlocks; ++b) {
+                    float const *src = args->TileProducts + (tile * args->OutputLd) + (b * CNN_CBLOCK);
+                    float       *dst = image + (b * plane) + ((size_t)(2 * ty) * row) + ((size_t)(2 * tx) * CNN_CBLOCK);
+                    float const *bias = args->Bias ? args->Bias + (b * CNN_CBLOCK) : NULL;
+                    if (in) {
+                        args->Kernel->WinogradOutput(dst, row, src, pos, bias, shape->Relu);
+                        continue;
+                    }
+                    args->Kernel->WinogradOutput(y, 2 * CNN_CBLOCK, src, pos, bias, shape->Relu);
+                    for (i = 0; i < 2 && (2 * ty) + i < oh; ++i) {
+                        for (j = 0; j < 2 && (2 * tx) + j < ow; ++j) {
+                            memcpy(dst + (i * row) + (j * CNN_CBLOCK), &y[((i * 2) + j) * CNN_CBLOCK], CNN_CBLOCK * sizeof(float));
+                        }
+                    }
+                }
+            }
+        }
+    }
+}
+
+/* @summary Compute a 3x3 convolution of a batch of images with the Winograd F(2x2,3x3) algorithm.
+ * Images are processed in groups of up to CNN_WINOGRAD_TILES output tiles. For each group, the input tiles are transformed, each of the 16 transform positions is a GEMM of [tiles x InputChannels] by [InputChannels x OutputChannels], and the products are transformed back.
+ * @param cnn The network, whose frame holds the Winograd scratch buffers and whose task pool runs the transforms and GEMMs.
+ * @param shape The geometry of the convolution. KernelSize must be 3.
+ * @param w The weights, with dimensions [OutputBlocks][InputChannels][3][3][CNN_CBLOCK].
+ * @param bias The bias of each output channel, OutputBlocks * CNN_CBLOCK values, or NULL.
+ * @param inputs The input images, with dimensions [count][input_stride].
+ * @param input_stride The distance between the start of consecutive input images, in floats.
+ * @param outputs The output images, with dimensions [count][output_stride].
+ * @param output_stride The distance between the start of consecutive output images, in floats.
+ * @param count The number of images.
+ */
+static void
+CnnWinogradConv
+(
+    CNN                      *cnn,
+    CNN_CONV_SHAPE const   *shape,
+    float const                *w,
+    float const             *bias,
+    float const           *inputs,
+    size_t           input_stride,
+    float                *outputs,
+    size_t          output_stride,
+    uint32_t                count
+)
+{
+    CNN_WINOGRAD_ARGS args;
+    uint32_t          tiles;
+    uint32_t          group = CnnWinogradGroup(shape, cnn->MaxBatchSize, &tiles);
+    size_t const        ldu = (size_t) shape->OutputBlocks * CNN_CBLOCK;
+    uint32_t         base, n, i;
+
+    assert(shape->KernelSize == 3 && cnn->WinogradWeights != NULL);
+    CnnWinogradWeights(shape, w, cnn->WinogradWeights);
+    args.Kernel       = CnnCurrentKernel();
+    args.Shape        = shape;
+    args.Bias         = bias;
+    args.TileInputs   = cnn->WinogradInputs;
+    args.TileProducts = cnn->WinogradProducts;
+    args.InputStride  = input_stride;
+    args.OutputStride = output_stride;
+    args.TilesX       = (shape->OutputWidth  + 1) / 2;
+    args.TilesY       = (shape->OutputHeight + 1) / 2;
+    args.InputLd      = ((shape->InputChannels + shape->InputBlock - 1) / shape->InputBlock) * shape->InputBlock;
+    args.OutputLd     = (uint32_t) ldu;
+    for (base = 0; base < count; base += n) {
+        n = MinValue(count - base, group);
+        args.Inputs    = inputs  + (base * input_stride);
+        args.Outputs   = outputs + (base * output_stride);
+        args.TileCount = n * args.TilesX * args.TilesY;
+        TaskPoolParallelFor(cnn->TaskPool, n, 1, CnnWinogradInputTiles, &args);
+        for (i = 0; i < 16; ++i) {
+            (void) GemmF32Parallel(cnn->TaskPool, GEMM_OP_NONE, GEMM_OP_NONE, args.TileCount, (uint32_t) ldu, shape->InputChannels, 1.0f,
+                                   cnn->WinogradInputs + ((size_t) i * args.TileCount * args.InputLd), args.InputLd,
+                                   cnn->WinogradWeights + ((size_t) i * shape->InputChannels * ldu), (uint32_t) ldu, 0.0f,
+                                   cnn->WinogradProducts + ((size_t) i * args.TileCount * ldu), (uint32_t) ldu, cnn->WinogradWorkspace);
+        }
+        TaskPoolParallelFor(cnn->TaskPool, n, 1, CnnWinogradOutputTiles, &args);
+    }
+}
+
+/* @summary Compute the number of floats needed by each Winograd scratch buffer, over every 3x3 convolution of a network in both passes.
+ * @param cnn The network, with its layers initialized.
+ * @param o_floats On return, the sizes of WinogradWeights, WinogradInputs, WinogradProducts and WinogradWorkspace, in floats, or all zero if the network has no 3x3 convolution.
+ */
+static void
+CnnWinogradScratch
+(
+    CNN const      *cnn,
+    size_t *o_floats
+)
+{
+    uint32_t l, pass;
+    memset(o_floats, 0, 4 * sizeof(size_t));
+    for (l = 0; l < cnn->LayerCount; ++l) {
+        CNN_LAYER const *layer = &cnn->Layers[l];
+        if (layer->Type != CNN_LAYER_CONV || layer->KernelSize != 3) {
+            continue;
+        }
+        for (pass = 0; pass < 2; ++pass) {
+            CNN_CONV_SHAPE shape;
+            uint32_t       tiles;
+            size_t      ldv, ldu;
+            if (pass == 0) {
+                CnnForwardShape(&shape, layer);
+            } else if (CnnFlippedCount(layer) != 0) {
+                CnnInputGradShape(&shape, layer);
+            } else {
+                break;
+            }
+            (void) CnnWinogradGroup(&shape, cnn->MaxBatchSize, &tiles);
+            ldv = ((shape.InputChannels + shape.InputBlock - 1) / shape.InputBlock) * shape.InputBlock;
+            ldu = (size_t) shape.OutputBlocks * CNN_CBLOCK;
+            o_floats[0] = MaxValue(o_floats[0], 16 * shape.InputChannels * ldu);
+            o_floats[1] = MaxValue(o_floats[1], 16 * tiles * ldv);
+            o_floats[2] = MaxValue(o_floats[2], 16 * tiles * ldu);
+            o_floats[3] = MaxValue(o_floats[3], MaxValue((size_t) GEMM_WORKSPACE_FLOATS, GEMM_PARALLEL_WORKSPACE_FLOATS(tiles)));
+        }
+    }
+}
+
+/* @summary Decide whether a convolution layer uses the Winograd path.
+ * @param layer The layer.
+ * @param algorithm One of the values of the CNN_ALGORITHM enumeration.
+ * @return Non-zero if the layer should use the Winograd path.
+ */
+static uint32_t
+CnnUseWinograd
+(
+    CNN_LAYER const *layer,
+    uint32_t     algorithm
+)
+{
+    if (layer->Type != CNN_LAYER_CONV || layer->KernelSize != 3 || algorithm == CNN_ALGORITHM_DIRECT) {
+        return 0;
+    }
+    if (algorithm == CNN_ALGORITHM_WINOGRAD) {
+        return 1;
+    }
+    return (layer->InputChannels >= CNN_WINOGRAD_MIN_CHANNELS && layer->OutputChannels >= CNN_WINOGRAD_MIN_CHANNELS) ? 1 : 0;
+}
+
+/* @summary Compute the capacity of the frame arena needed for a batch.
+ * @param cnn The network, with its layers initialized.
+ * @return The required frame arena capacity, in bytes.
+ */
+static size_t
+CnnFrameSize
+(
+    CNN const *cnn
+)
+{
+    size_t total = 0;
+    size_t  scratch[4];
+    uint32_t   l;
+    for (l = 0; l < cnn->LayerCount; ++l) {
+        total += 2 * CnnBufferSize((size_t) cnn->MaxBatchSize * cnn->Layers[l].OutputStride); /* Outputs, Deltas */
+    }
+    CnnWinogradScratch(cnn, scratch);
+    for (l = 0; l < 4; ++l) {
+        total += CnnBufferSize(scratch[l]);
+    }
+    return total;
+}
+
+/* @summary Reset the frame arena and allocate the activation and delta buffers of every layer for a batch.
+ * @param cnn The network.
+ * @param count The number of images in the batch, at most MaxBatchSize.
+ */
+static void
+CnnBeginFrame
+(
+    CNN        *cnn,
+    uint32_t   count
+)
+{
+    size_t scratch[4];
+    uint32_t     l;
+    ArenaReset(&cnn->Frame);
+    CnnWinogradScratch(cnn, scratch);
+    if (scratch[0] != 0) {
+        cnn->WinogradWeights   = (float*) ArenaAllocate(&cnn->Frame, CnnBufferSize(scratch[0]), CNN_ALIGNMENT);
+        cnn->WinogradInputs    = (float*) ArenaAllocate(&cnn->Frame, CnnBufferSize(scratch[1]), CNN_ALIGNMENT);
+        cnn->WinogradProducts  = (float*) ArenaAllocate(&cnn->Frame, CnnBufferSize(scratch[2]), CNN_ALIGNMENT);
+        cnn->WinogradWorkspace = (float*) ArenaAllocate(&cnn->Frame, CnnBufferSize(scratch[3]), CNN_ALIGNMENT);
+    }
+    for (l = 0; l < cnn->LayerCount; ++l) {
+        CNN_LAYER *layer = &cnn->Layers[l];
+        size_t    nbytes = CnnBufferSize((size_t) count * layer->OutputStride);
+        layer->Outputs   = (float*) ArenaAllocate(&cnn->Frame, nbytes, CNN_ALIGNMENT);
+        layer->Deltas    = (float*) ArenaAllocate(&cnn->Frame, nbytes, CNN_ALIGNMENT);
+        /* the frame arena is sized for MaxBatchSize images in CnnCreate */
+        assert(layer->Outputs != NULL && layer->Deltas != NULL);
+    }
+}
+
+/* @summary Run the forward pass of every convolution and pooling layer, and of the head, for a batch of images.
+ * @param cnn The network.
+ * @param inputs The images, with dimensions [count][input_stride].
+ * @param input_stride The distance between the start of consecutive images, in floats.
+ * @param count The number of images.
+ */
+static void
+CnnForwardLayers
+(
+    CNN                  *cnn,
+    float const       *inputs,
+    uint32_t     input_stride,
+    uint32_t            count
+)
+{
+    CNN_LAYER_ARGS args;
+    CNN_LAYER     *last = &cnn->Layers[cnn->LayerCount - 1];
+    uint32_t          l;
+
+    args.Kernel      = CnnCurrentKernel();
+    args.InputDeltas = NULL;
+    args.Count       = count;
+    args.Inputs      = inputs;
+    args.InputStride = input_stride;
+    for (l = 0; l < cnn->LayerCount; ++l) {
+        CNN_LAYER *layer = &cnn->Layers[l];
+        args.Layer = layer;
+        if (layer->Winograd) {
+            CNN_CONV_SHAPE shape;
+            CnnForwardShape(&shape, layer);
+            CnnWinogradConv(cnn, &shape, layer->Weights, layer->Bias, args.Inputs, args.InputStride, layer->Outputs, layer->OutputStride, count);
+        } else {
+            TaskPoolParallelFor(cnn->TaskPool, count, 1, CnnForwardImages, &args);
+        }
+        args.Inputs      = cnn->Layers[l].Outputs;
+        args.InputStride = cnn->Layers[l].OutputStride;
+    }
+    MlpForward(&cnn->Head, last->Outputs, last->OutputStride, count);
+}
+
+MNIST_API(int)
+CnnCreate
+(
+    struct CNN                      *o_cnn,
+    uint32_t                   input_width,
+    uint32_t                  input_height,
+    struct CNN_LAYER_DESC const    *layers,
+    uint32_t                   layer_count,
+    uint32_t const             *head_sizes,
+    uint32_t                    head_count,
+    uint32_t                max_batch_size,
+    uint64_t                          seed
+)
+{
+    uint64_t       rng = seed ? seed : 0x9E3779B97F4A7C15ULL;
+    uint32_t     sizes[MLP_MAX_LAYERS + 1];
+    uint32_t  channels = 1;
+    uint32_t     block = 1;
+    uint32_t    height = input_height;
+    uint32_t     width = input_width;
+    size_t       total = 0;
+    uint32_t      l, i;
+    size_t           j;
+
+    assert(o_cnn != NULL);
+    memset(o_cnn, 0, sizeof(CNN));
+
+    if (layers == NULL || layer_count == 0 || layer_count > CNN_MAX_LAYERS || layers[0].Type != CNN_LAYER_CONV ||
+        head_sizes == NULL || head_count == 0 || head_count > MLP_MAX_LAYERS || max_batch_size == 0) {
+        errno = EINVAL;
+        return -1;
+    }
+    for (l = 0; l < layer_count; ++l) {
+        CNN_LAYER_DESC const *desc = &layers[l];
+        CNN_LAYER           *layer = &o_cnn->Layers[l];
+        uint32_t                 k = desc->KernelSize;
+        if (k == 0 || k > CNN_MAX_KERNEL_SIZE || (desc->Type == CNN_LAYER_CONV && (desc->OutputChannels == 0 || desc->Padding >= k))) {
+            errno = EINVAL;
+            return -1;
+        }
+        if (desc->Type == CNN_LAYER_CONV) {
+            if (height + (2 * desc->Padding) < k || width + (2 * desc->Padding) < k) {
+                errno = EINVAL;
+                return -1;
+            }
+            layer->Padding        = desc->Padding;
+            layer->OutputChannels = desc->OutputChannels;
+            layer->OutputHeight   = height + (2 * desc->Padding) - k + 1;
+            layer->OutputWidth    = width  + (2 * desc->Padding) - k + 1;
+        } else if (desc->Type == CNN_LAYER_MAXPOOL) {
+            if (height < k || width < k) {
+                errno = EINVAL;
+                return -1;
+            }
+            layer->OutputChannels = channels;
+            layer->OutputHeight   = height / k;
+            layer->OutputWidth    = width  / k;
+        } else {
+            errno = EINVAL;
+            return -1;
+        }
+        layer->Type          = desc->Type;
+        layer->KernelSize    = k;
+        layer->InputChannels = channels;
+        layer->InputBlock    = block;
+        layer->InputHeight   = height;
+        layer->InputWidth    = width;
+        layer->OutputStride  = (uint32_t) AlignUp((size_t) CnnBlockCount(layer->OutputChannels) * layer->OutputHeight * layer->OutputWidth * CNN_CBLOCK,
+                                                   CNN_ALIGNMENT / sizeof(float));
+        if (layer->Type == CNN_LAYER_CONV) {
+            total += 2 * CnnBufferSize(CnnWeightCount(layer));                                  /* Weights, WeightGrad */
+            total += 2 * CnnBufferSize(CnnBlockCount(layer->OutputChannels) * CNN_CBLOCK);     /* Bias, BiasGrad */
+            total += CnnBufferSize(CnnFlippedCount(layer));                                     /* WeightsFlipped */
+        }
+        channels = layer->OutputChannels;
+        block    = CNN_CBLOCK;
+        height   = layer->OutputHeight;
+        width    = layer->OutputWidth;
+    }
+    /* the head reads the flattened channel blocks of the last layer, including any padding channels, which are always zero */
+    sizes[0] = CnnBlockCount(channels) * height * width * CNN_CBLOCK;
+    for (i = 0; i < head_count; ++i) {
+        sizes[i + 1] = head_sizes[i];
+    }
+    o_cnn->LayerCount   = layer_count;
+    o_cnn->InputWidth   = input_width;
+    o_cnn->InputHeight  = input_height;
+    o_cnn->MaxBatchSize = max_batch_size;
+    if (MlpCreate(&o_cnn->Head, sizes, head_count + 1, max_batch_size, seed) != 0) {
+        memset(o_cnn, 0, sizeof(CNN));
+        return -1;
+    }
+    if (MinibatchCreate(&o_cnn->EvaluateBatch, max_batch_size, input_width * input_height) != 0) {
+        goto cleanup_head;
+    }
+    /* the storage arena is sized exactly, and fresh arena memory is zeroed, which keeps the weights of padding channels zero */
+    if (ArenaCreate(&o_cnn->Storage, total, ARENA_FLAG_HUGE_PAGES) != 0) {
+        goto cleanup_batch;
+    }
+    if (ArenaCreate(&o_cnn->Frame, CnnFrameSize(o_cnn), ARENA_FLAG_HUGE_PAGES) != 0) {
+        goto cleanup_storage;
+    }
+    for (l = 0; l < layer_count; ++l) {
+        CNN_LAYER *layer = &o_cnn->Layers[l];
+        size_t         n = CnnWeightCount(layer);
+        uint32_t       k = layer->KernelSize;
+        float      limit = sqrtf(6.0f / (float)(layer->InputChannels * k * k));
+        if (layer->Type != CNN_LAYER_CONV) {
+            continue;
+        }
+        layer->Weights    = (float*) ArenaAllocate(&o_cnn->Storage, CnnBufferSize(n), CNN_ALIGNMENT);
+        layer->WeightGrad = (float*) ArenaAllocate(&o_cnn->Storage, CnnBufferSize(n), CNN_ALIGNMENT);
+        layer->Bias       = (float*) ArenaAllocate(&o_cnn->Storage, CnnBufferSize(CnnBlockCount(layer->OutputChannels) * CNN_CBLOCK), CNN_ALIGNMENT);
+        layer->BiasGrad   = (float*) ArenaAllocate(&o_cnn->Storage, CnnBufferSize(CnnBlockCount(layer->OutputChannels) * CNN_CBLOCK), CNN_ALIGNMENT);
+        if (CnnFlippedCount(layer) != 0) {
+            layer->WeightsFlipped = (float*) ArenaAllocate(&o_cnn->Storage, CnnBufferSize(CnnFlippedCount(layer)), CNN_ALIGNMENT);
+        }
+        layer->Winograd = CnnUseWinograd(layer, CNN_ALGORITHM_AUTO);
+        for (j = 0; j < n; ++j) {
+            /* the lane index of each weight is its output channel within the block */
+            uint32_t oc = (uint32_t)(((j / ((size_t) layer->InputChannels * k * k * CNN_CBLOCK)) * CNN_CBLOCK) + (j % CNN_CBLOCK));
+            if (oc < layer->OutputChannels) {
+                layer->Weights[j] = limit * CnnRandomUniform(&rng);
+            }
+        }
+    }
+    return 0;
+
+cleanup_storage:
+    ArenaDelete(&o_cnn->Storage);
+cleanup_batch:
+    MinibatchDelete(&o_cnn->EvaluateBatch);
+cleanup_head:
+    MlpDelete(&o_cnn->Head);
+    memset(o_cnn, 0, sizeof(CNN));
+    return -1;
+}
+
+MNIST_API(void)
+CnnDelete
+(
+    struct CNN *cnn
+)
+{
+    if (cnn != NULL) {
+        ArenaDelete(&cnn->Frame);
+        ArenaDelete(&cnn->Storage);
+        MinibatchDelete(&cnn->EvaluateBatch);
+        MlpDelete(&cnn->Head);
+        memset(cnn, 0, sizeof(CNN));
+    }
+}
+
+MNIST_API(int)
+CnnSetTaskPool
+(
+    struct CNN        *cnn,
+    struct TASK_POOL *pool
+)
+{
+    if (MlpSetTaskPool(&cnn->Head, pool) != 0) {
+        return -1;
+    }
+    cnn->TaskPool = pool;
+    return 0;
+}
+
+MNIST_API(int)
+CnnSetAlgorithm
+(
+    struct CNN      *cnn,
+    uint32_t   algorithm
+)
+{
+    uint32_t l;
+    if (algorithm > CNN_ALGORITHM_WINOGRAD) {
+        errno = EINVAL;
+        return -1;
+    }
+    for (l = 0; l < cnn->LayerCount; ++l) {
+        cnn->Layers[l].Winograd = CnnUseWinograd(&cnn->Layers[l], algorithm);
+    }
+    return 0;
+}
+
+MNIST_API(void)
+CnnForward
+(
+    struct CNN           *cnn,
+    float const       *inputs,
+    uint32_t     input_stride,
+    uint32_t            count
+)
+{
+    assert(count <= cnn->MaxBatchSize);
+    CnnBeginFrame(cnn, count);
+    CnnForwardLayers(cnn, inputs, input_stride, count);
+}
+
+MNIST_API(float)
+CnnTrainBatch
+(
+    struct CNN              *cnn,
+    struct MINIBATCH const *batch,
+    float           learning_rate
+)
+{
+    CNN_LAYER       *last = &cnn->Layers[cnn->LayerCount - 1];
+    MLP_LAYER const *head = &cnn->Head.Layers[0];
+    uint32_t const  count = batch->SampleCount;
+    CNN_LAYER_ARGS   args;
+    float            loss;
+    uint32_t         l, k;
+    size_t           i, n;
+
+    assert(batch->FeatureCount == cnn->InputWidth * cnn->InputHeight);
+    assert(count > 0 && count <= cnn->MaxBatchSize);
+    CnnBeginFrame(cnn, count);
+    CnnForwardLayers(cnn, batch->Inputs, batch->RowStride, count);
+    loss = MlpBackward(&cnn->Head, last->Outputs, last->OutputStride, batch->Labels, count);
+    /* the head does not propagate deltas to its inputs, so compute them here before the head weights are updated */
+    (void) GemmF32Parallel(cnn->TaskPool, GEMM_OP_NONE, GEMM_OP_TRANSPOSE, count, head->InputCount, head->OutputCount,
+                           1.0f, head->Deltas, head->OutputStride, head->Weights, head->OutputStride, 0.0f, last->Deltas, last->OutputStride, cnn->Head.Workspace);
+    MlpUpdate(&cnn->Head, learning_rate);
+
+    args.Kernel = CnnCurrentKernel();
+    args.Count  = count;
+    for (l = cnn->LayerCount; l-- > 0; ) {
+        CNN_LAYER *layer = &cnn->Layers[l];
+        args.Layer       = layer;
+        args.Inputs      = (l == 0) ? batch->Inputs    : cnn->Layers[l - 1].Outputs;
+        args.InputStride = (l == 0) ? batch->RowStride : cnn->Layers[l - 1].OutputStride;
+        args.InputDeltas = (l == 0) ? NULL             : cnn->Layers[l - 1].Deltas;
+        if (layer->WeightsFlipped != NULL) {
+            CnnFlipWeights(layer);
+        }
+        if (layer->Winograd && args.InputDeltas != NULL) {
+            /* mask the deltas per image, then compute the input gradient for the whole batch */
+            CNN_CONV_SHAPE shape;
+            args.InputDeltas = NULL;
+            TaskPoolParallelFor(cnn->TaskPool, count, 1, CnnBackwardImages, &args);
+            CnnInputGradShape(&shape, layer);
+            CnnWinogradConv(cnn, &shape, layer->WeightsFlipped, NULL, layer->Deltas, layer->OutputStride, cnn->Layers[l - 1].Deltas, cnn->Layers[l - 1].OutputStride, count);
+        } else {
+            TaskPoolParallelFor(cnn->TaskPool, count, 1, CnnBackwardImages, &args);
+        }
+        if (layer->Type == CNN_LAYER_CONV) {
+            k = layer->KernelSize;
+            TaskPoolParallelFor(cnn->TaskPool, CnnBlockCount(layer->OutputChannels) * layer->InputChannels * k, 1, CnnWeightGradRows, &args);
+        }
+    }
+    for (l = 0; l < cnn->LayerCount; ++l) {
+        CNN_LAYER *layer = &cnn->Layers[l];
+        if (layer->Type != CNN_LAYER_CONV) {
+            continue;
+        }
+        n = CnnWeightCount(layer);
+        for (i = 0; i < n; ++i) {
+            layer->Weights[i] -= learning_rate * layer->WeightGrad[i];
+        }
+        n = CnnBlockCount(layer->OutputChannels) * CNN_CBLOCK;
+        for (i = 0; i < n; ++i) {
+            layer->Bias[i] -= learning_rate * layer->BiasGrad[i];
+        }
+    }
+    return loss;
+}
+
+MNIST_API(int)
+CnnEvaluate
+(
+    struct CNN                      *cnn,
+    struct MINIBATCH_SOURCE const *source,
+    uint32_t                    *o_correct,
+    float                          *o_loss
+)
+{
+    MINIBATCH        *batch = &cnn->EvaluateBatch;
+    MLP_LAYER const    *out = &cnn->Head.Layers[cnn->Head.LayerCount - 1];
+    uint32_t    sample_count = source->Dataset->SampleCount;
+    uint32_t         correct = 0;
+    double              loss = 0.0;
+    uint32_t   base, count, i;
+
+    assert(o_correct != NULL);
+    *o_correct = 0;
+    if (o_loss != NULL) {
+        *o_loss = 0.0f;
+    }
+    if (source->Dataset->ImageSize != cnn->InputWidth * cnn->InputHeight) {
+        errno = EINVAL;
+        return -1;
+    }
+    for (base = 0; base < sample_count; base += count) {
+        count = MinValue(sample_count - base, cnn->MaxBatchSize);
+        for (i = 0; i < count; ++i) {
+            batch->Indices[i] = base + i;
+        }
+        /* MinibatchGather copies each index back into the same slot of batch->Indices */
+        MinibatchGather(batch, source, batch->Indices, count);
+        CnnForward(cnn, batch->Inputs, batch->RowStride, count);
+        for (i = 0; i < count; ++i) {
+            float const *p = out->Outputs + ((size_t) i * out->OutputStride);
+            uint8_t      y = batch->Labels[i];
+            if (MlpPredict(&cnn->Head, i) == y) {
+                correct++;
+            }
+            loss -= log(p[y] > CNN_MIN_PROBABILITY ? p[y] : CNN_MIN_PROBABILITY);
+        }
+    }
+    *o_correct = correct;
+    if (o_loss != NULL && sample_count > 0) {
+        *o_loss = (float)(loss / sample_count);
+    }
+    return 0;
+}
+
+MNIST_API(size_t)
+CnnParameterSize
+(
+    struct CNN const *cnn
+)
+{
+    return cnn->Storage.Capacity + cnn->Head.Storage.Capacity + cnn->Head.HalfStorage.Capacity;
+}
+
+MNIST_API(int)
+CnnSelectKernel
+(
+    uint32_t kernel
+)
+{
+    CNN_KERNEL_FUNCS const *func = CnnKernel(kernel);
+    if (func == NULL) {
+        errno = ENOTSUP;
+        return -1;
+    }
+    Global_CnnKernel = func;
+    return 0;
+}
+
+MNIST_API(char const*)
+CnnKernelName
+(
+    uint32_t kernel
+)
+{
+    switch (kernel) {
+        case CNN_KERNEL_SCALAR: return "scalar";
+        case CNN_KERNEL_AVX2  : return "avx2";
+        default               : return "unknown";
+    }
+}
@@ -0,0 +1,589 @@
+/**
+ * @summary Implement the functions exported by the convert.h module for
+ * converting 8-bit pixel data to float32, and float32 to and from 16-bit
+ * floating-point formats.
+ */
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+#include <assert.h>
+
+#include "cpuinfo.h"
+#include "convert.h"
+
+#if CPU_ARCH_X86
+#include <immintrin.h>
+#endif
+
+/* @summary The kernel selected by ConvertU8ToF32 on first use.
+ * Concurrent first calls may each select a kernel; they all store the same value.
+ */
+static CONVERT_U8_F32_FUNC volatile Global_ConvertU8ToF32 = NULL;
+
+/* @summary Define the signatures of the kernels that convert between float32 and a 16-bit format.
+ */
+typedef void (*CONVERT_F32_HALF_FUNC)(uint16_t * __restrict dst, float const * __restrict src, size_t count);
+typedef void (*CONVERT_HALF_F32_FUNC)(float * __restrict dst, uint16_t const * __restrict src, size_t count);
+
+/* @summary The float32 to 16-bit kernels selected by ConvertF32ToHalf on first use, indexed by CONVERT_TYPE.
+ */
+static CONVERT_F32_HALF_FUNC volatile Global_ConvertF32ToHalf[CONVERT_TYPE_COUNT] = { NULL, NULL, NULL };
+
+/* @summary The 16-bit to float32 kernels selected by ConvertHalfToF32 on first use, indexed by CONVERT_TYPE.
+ */
+static CONVERT_HALF_F32_FUNC volatile Global_ConvertHalfToF32[CONVERT_TYPE_COUNT] = { NULL, NULL, NULL };
+
+/* @summary Reinterpret the bits of a float32 value as an unsigned integer.
+ * @param f The value.
+ * @return The IEEE 754 bit pattern of f.
+ */
+static inline uint32_t
+ConvertFloatBits
+(
+    float f
+)
+{
+    uint32_t u;
+    memcpy(&u, &f, sizeof(u));
+    return u;
+}
+
+/* @summary Reinterpret an unsigned integer as the bits of a float32 value.
+ * @param u The IEEE 754 bit pattern.
+ * @return The float32 value with bit pattern u.
+ */
+static inline float
+ConvertBitsFloat
+(
+    uint32_t u
+)
+{
+    float f;
+    memcpy(&f, &u, sizeof(f));
+    return f;
+}
+
+/* @summary Convert 8-bit values to float32 one element at a time.
+ * @param dst The destination buffer.
+ * @param src The source buffer.
+ * @param count The number of values to convert.
+ * @param scale The scale applied to each source value.
+ * @param bias The bias added to each scaled value.
+ */
+static void
+ConvertU8ToF32_Scalar
+(
+    float         * __restrict dst,
+    uint8_t const * __restrict src,
+    size_t                   count,
+    float                    scale,
+    float                     bias
+)
+{
+    size_t i;
+    for (i = 0; i < count; ++i) {
+        dst[i] = ((float) src[i] * scale) + bias;
+    }
+}
+
+/* @summary Convert float32 values to bfloat16 one element at a time, rounding to nearest even.
+ * @param dst The destination buffer.
+ * @param src The source buffer.
+ * @param count The number of values to convert.
+ */
+static void
+ConvertF32ToBF16_Scalar
+(
+    uint16_t    * __restrict dst,
+    float const * __restrict src,
+    size_t                 count
+)
+{
+    size_t i;
+    for (i = 0; i < count; ++i) {
+        uint32_t u = ConvertFloatBits(src[i]);
+        if ((u & 0x7F800000U) == 0) {
+            /* zero or denormal: flush to signed zero */
+            dst[i] = (uint16_t)((u >> 16) & 0x8000U);
+        } else if ((u & 0x7FFFFFFFU) > 0x7F800000U) {
+            /* NaN: truncate and set the quiet bit so that the payload cannot round to infinity */
+            dst[i] = (uint16_t)((u >> 16) | 0x0040U);
+        } else {
+            dst[i] = (uint16_t)((u + 0x7FFFU + ((u >> 16) & 1U)) >> 16);
+        }
+    }
+}
+
+/* @summary Widen bfloat16 values to float32 one element at a time.
+ * @param dst The destination buffer.
+ * @param src The source buffer.
+ * @param count The number of values to convert.
+ */
+static void
+ConvertBF16ToF32_Scalar
+(
+    float          * __restrict dst,
+    uint16_t const * __restrict src,
+    size_t                    count
+)
+{
+    size_t i;
+    for (i = 0; i < count; ++i) {
+        dst[i] = ConvertBitsFloat((uint32_t) src[i] << 16);
+    }
+}
+
+/* @summary Convert float32 values to IEEE half precision one element at a time, rounding to nearest even.
+ * @param dst The destination buffer.
+ * @param src The source buffer.
+ * @param count The number of values to convert.
+ */
+static void
+ConvertF32ToF16_Scalar
+(
+    uint16_t    * __restrict dst,
+    float const * __restrict src,
+    size_t                 count
+)
+{
+    size_t i;
+    for (i = 0; i < count; ++i) {
+        uint32_t    u = ConvertFloatBits(src[i]);
+        uint32_t sign = (u >> 16) & 0x8000U;
+        uint32_t    h;
+        u &= 0x7FFFFFFFU;
+        if (u >= 0x47800000U) {
+            /* 2^16 and above overflow; infinity stays infinity and NaN becomes a quiet NaN */
+            h = (u > 0x7F800000U) ? 0x7E00U : 0x7C00U;
+        } else if (u < 0x38800000U) {
+            /* below 2^-14 the result is a half denormal; adding 0.5 aligns the mantissa so the FPU rounds it */
+            h = ConvertFloatBits(ConvertBitsFloat(u) + 0.5f) - 0x3F000000U;
+        } else {
+            /* rebias the exponent, then round to nearest even on the 13 discarded mantissa bits */
+            u += ((uint32_t)(15 - 127) << 23) + 0xFFFU + ((u >> 13) & 1U);
+            h  = u >> 13;
+        }
+        dst[i] = (uint16_t)(h | sign);
+    }
+}
+
+/* @summary Widen IEEE half-precision values to float32 one element at a time.
+ * @param dst The destination buffer.
+ * @param src The source buffer.
+ * @param count The number of values to convert.
+ */
+static void
+ConvertF16ToF32_Scalar
+(
+    float          * __restrict dst,
+    uint16_t const * __restrict src,
+    size_t                    count
+)
+{
+    size_t i;
+    for (i = 0; i < count; ++i) {
+        uint32_t   h = src[i];
+        uint32_t   u = (h & 0x7FFFU) << 13;
+        uint32_t exp = u & 0x0F800000U;
+        u += (uint32_t)(127 - 15) << 23;
+        if (exp == 0x0F800000U) {
+            /* infinity or NaN */
+            u += (uint32_t)(128 - 16) << 23;
+        } else if (exp == 0) {
+            /* zero or denormal: renormalize by subtracting the implicit leading one */
+            u = ConvertFloatBits(ConvertBitsFloat(u + (1U << 23)) - ConvertBitsFloat(113U << 23));
+        }
+        dst[i] = ConvertBitsFloat(u | ((h & 0x8000U) << 16));
+    }
+}
+
+#if CPU_ARCH_X86
+/* @summary Convert 8-bit values to float32 16 elements at a time using SSE4.1 pmovzxbd.
+ * @param dst The destination buffer.
+ * @param src The source buffer.
+ * @param count The number of values to convert.
+ * @param scale The scale applied to each source value.
+ * @param bias The bias added to each scaled value.
+ */
+static CPU_TARGET("sse4.1") void
+ConvertU8ToF32_SSE41
+(
+    float         * __restrict dst,
+    uint8_t const * __restrict src,
+    size_t                   count,
+    float                    scale,
+    float                     bias
+)
+{
+    __m128 vs = _mm_set1_ps(scale);
+    __m128 vb = _mm_set1_ps(bias);
+    size_t  n = count & ~(size_t) 15;
+    size_t  i;
+
+    for (i = 0; i < n; i += 16) {
+        __m128i b  = _mm_loadu_si128((__m128i const*)(src + i));
+        __m128  f0 = _mm_cvtepi32_ps(_mm_cvtepu8_epi32(b));
+        __m128  f1 = _mm_cvtepi32_ps(_mm_cvtepu8_epi32(_mm_srli_si128(b,  4)));
+        __m128  f2 = _mm_cvtepi32_ps(_mm_cvtepu8_epi32(_mm_srli_si128(b,  8)));
+        __m128  f3 = _mm_cvtepi32_ps(_mm_cvtepu8_epi32(_mm_srli_si128(b, 12)));
+        _mm_storeu_ps(dst + i +  0, _mm_add_ps(_mm_mul_ps(f0, vs), vb));
+        _mm_storeu_ps(dst + i +  4, _mm_add_ps(_mm_mul_ps(f1, vs), vb));
+        _mm_storeu_ps(dst + i +  8, _mm_add_ps(_mm_mul_ps(f2, vs), vb));
+        _mm_storeu_ps(dst + i + 12, _mm_add_ps(_mm_mul_ps(f3, vs), vb));
+    }
+    ConvertU8ToF32_Scalar(dst + n, src + n, count - n, scale, bias);
+}
+
+/* @summary Convert 8-bit values to float32 32 elements at a time using AVX2 vpmovzxbd and FMA.
+ * @param dst The destination buffer.
+ * @param src The source buffer.
+ * @param count The number of values to convert.
+ * @param scale The scale applied to each source value.
+ * @param bias The bias added to each scaled value.
+ */
+static CPU_TARGET("avx2,fma") void
+ConvertU8ToF32_AVX2
+(
+    float         * __restrict dst,
+    uint8_t const * __restrict src,
+    size_t                   count,
+    float                    scale,
+    float                     bias
+)
+{
+    __m256 vs = _mm256_set1_ps(scale);
+    __m256 vb = _mm256_set1_ps(bias);
+    size_t  n = count & ~(size_t) 31;
+    size_t  i;
+
+    for (i = 0; i < n; i += 32) {
+        __m128i b0 = _mm_loadu_si128((__m128i const*)(src + i +  0));
+        __m128i b1 = _mm_loadu_si128((__m128i const*)(src + i + 16));
+        __m256  f0 = _mm256_cvtepi32_ps(_mm256_cvtepu8_epi32(b0));
+        __m256  f1 = _mm256_cvtepi32_ps(_mm256_cvtepu8_epi32(_mm_srli_si128(b0, 8)));
+        __m256  f2 = _mm256_cvtepi32_ps(_mm256_cvtepu8_epi32(b1));
+        __m256  f3 = _mm256_cvtepi32_ps(_mm256_cvtepu8_epi32(_mm_srli_si128(b1, 8)));
+        _mm256_storeu_ps(dst + i +  0, _mm256_fmadd_ps(f0, vs, vb));
+        _mm256_storeu_ps(dst + i +  8, _mm256_fmadd_ps(f1, vs, vb));
+        _mm256_storeu_ps(dst + i + 16, _mm256_fmadd_ps(f2, vs, vb));
+        _mm256_storeu_ps(dst + i + 24, _mm256_fmadd_ps(f3, vs, vb));
+    }
+    if (count - n >= 16) { /* MNIST rows (784 = 24*32 + 16) end with a 16-element block */
+        __m128i b0 = _mm_loadu_si128((__m128i const*)(src + n));
+        __m256  f0 = _mm256_cvtepi32_ps(_mm256_cvtepu8_epi32(b0));
+        __m256  f1 = _mm256_cvtepi32_ps(_mm256_cvtepu8_epi32(_mm_srli_si128(b0, 8)));
+        _mm256_storeu_ps(dst + n + 0, _mm256_fmadd_ps(f0, vs, vb));
+        _mm256_storeu_ps(dst + n + 8, _mm256_fmadd_ps(f1, vs, vb));
+        n += 16;
+    }
+    ConvertU8ToF32_Scalar(dst + n, src + n, count - n, scale, bias);
+}
+
+/* @summary Convert 8-bit values to float32 64 elements at a time using AVX-512F vpmovzxbd and FMA.
+ * @param dst The destination buffer.
+ * @param src The source buffer.
+ * @param count The number of values to convert.
+ * @param scale The scale applied to each source value.
+ * @param bias The bias added to each scaled value.
+ */
+static CPU_TARGET("avx512f") void
+ConvertU8ToF32_AVX512
+(
+    float         * __restrict dst,
+    uint8_t const * __restrict src,
+    size_t                   count,
+    float                    scale,
+    float                     bias
+)
+{
+    __m512 vs = _mm512_set1_ps(scale);
+    __m512 vb = _mm512_set1_ps(bias);
+    size_t  n = count & ~(size_t) 63;
+    size_t  i;
+
+    /* the zero-masked forms generate the same instructions as the unmasked ones, but GCC 12 reports
+     * -Wmaybe-uninitialized for the _mm512_undefined_* merge source used by the unmasked intrinsics */
+    for (i = 0; i < n; i += 64) {
+        __m512  f0 = _mm512_maskz_cvtepi32_ps(0xFFFF, _mm512_maskz_cvtepu8_epi32(0xFFFF, _mm_loadu_si128((__m128i const*)(src + i +  0))));
+        __m512  f1 = _mm512_maskz_cvtepi32_ps(0xFFFF, _mm512_maskz_cvtepu8_epi32(0xFFFF, _mm_loadu_si128((__m128i const*)(src + i + 16))));
+        __m512  f2 = _mm512_maskz_cvtepi32_ps(0xFFFF, _mm512_maskz_cvtepu8_epi32(0xFFFF, _mm_loadu_si128((__m128i const*)(src + i + 32))));
+        __m512  f3 = _mm512_maskz_cvtepi32_ps(0xFFFF, _mm512_maskz_cvtepu8_epi32(0xFFFF, _mm_loadu_si128((__m128i const*)(src + i + 48))));
+        _mm512_storeu_ps(dst + i +  0, _mm512_fmadd_ps(f0, vs, vb));
+        _mm512_storeu_ps(dst + i + 16, _mm512_fmadd_ps(f1, vs, vb));
+        _mm512_storeu_ps(dst + i + 32, _mm512_fmadd_ps(f2, vs, vb));
+        _mm512_storeu_ps(dst + i + 48, _mm512_fmadd_ps(f3, vs, vb));
+    }
+    for ( ; n + 16 <= count; n += 16) { /* MNIST rows (784 = 12*64 + 16) end with a 16-element block */
+        __m128i b = _mm_loadu_si128((__m128i const*)(src + n));
+        __m512  f = _mm512_maskz_cvtepi32_ps(0xFFFF, _mm512_maskz_cvtepu8_epi32(0xFFFF, b));
+        _mm512_storeu_ps(dst + n, _mm512_fmadd_ps(f, vs, vb));
+    }
+    ConvertU8ToF32_Scalar(dst + n, src + n, count - n, scale, bias);
+}
+
+/* @summary Convert float32 values to bfloat16 16 elements at a time using AVX2 integer rounding.
+ * @param dst The destination buffer.
+ * @param src The source buffer.
+ * @param count The number of values to convert.
+ */
+static CPU_TARGET("avx2") void
+ConvertF32ToBF16_AVX2
+(
+    uint16_t    * __restrict dst,
+    float const * __restrict src,
+    size_t                 count
+)
+{
+    __m256i const round = _mm256_set1_epi32(0x7FFF);
+    __m256i const   one = _mm256_set1_epi32(1);
+    __m256i const quiet = _mm256_set1_epi32(0x0040);
+    __m256i const  sign = _mm256_set1_epi32(0x8000);
+    __m256i const   exp = _mm256_set1_epi32(0x7F800000);
+    size_t            n = count & ~(size_t) 15;
+    size_t            i;
+    for (i = 0; i < n; i += 16) {
+        __m256i h[2];
+        uint32_t k;
+        for (k = 0; k < 2; ++k) {
+            __m256  v = _mm256_loadu_ps(src + i + (k * 8));
+            __m256i u = _mm256_castps_si256(v);
+            __m256i t = _mm256_srli_epi32(u, 16);
+            __m256i r = _mm256_srli_epi32(_mm256_add_epi32(u, _mm256_add_epi32(round, _mm256_and_si256(t, one))), 16);
+            __m256i z = _mm256_cmpeq_epi32(_mm256_and_si256(u, exp), _mm256_setzero_si256());
+            __m256  q = _mm256_cmp_ps(v, v, _CMP_UNORD_Q);
+            r    = _mm256_blendv_epi8(r, _mm256_or_si256(t, quiet), _mm256_castps_si256(q));
+            h[k] = _mm256_blendv_epi8(r, _mm256_and_si256(t, sign), z);
+        }
+        /* packus works within 128-bit lanes; restore element order across the lanes */
+        _mm256_storeu_si256((__m256i*)(dst + i), _mm256_permute4x64_epi64(_mm256_packus_epi32(h[0], h[1]), 0xD8));
+    }
+    ConvertF32ToBF16_Scalar(dst + n, src + n, count - n);
+}
+
+/* @summary Widen bfloat16 values to float32 16 elements at a time using AVX2.
+ * @param dst The destination buffer.
+ * @param src The source buffer.
+ * @param count The number of values to convert.
+ */
+static CPU_TARGET("avx2") void
+ConvertBF16ToF32_AVX2
+(
+    float          * __restrict dst,
+    uint16_t const * __restrict src,
+    size_t                    count
+)
+{
+    size_t n = count & ~(size_t) 15;
+    size_t i;
+    for (i = 0; i < n; i += 16) {
+        __m128i h0 = _mm_loadu_si128((__m128i const*)(src + i + 0));
+        __m128i h1 = _mm_loadu_si128((__m128i const*)(src + i + 8));
+        _mm256_storeu_si256((__m256i*)(dst + i + 0), _mm256_slli_epi32(_mm256_cvtepu16_epi32(h0), 16));
+        _mm256_storeu_si256((__m256i*)(dst + i + 8), _mm256_slli_epi32(_mm256_cvtepu16_epi32(h1), 16));
+    }
+    ConvertBF16ToF32_Scalar(dst + n, src + n, count - n);
+}
+
+/* @summary Convert float32 values to bfloat16 16 elements at a time using the AVX-512 BF16 vcvtneps2bf16 instruction.
+ * @param dst The destination buffer.
+ * @param src The source buffer.
+ * @param count The number of values to convert.
+ */
+static CPU_TARGET("avx512f,avx512bf16") void
+ConvertF32ToBF16_AVX512BF16
+(
+    uint16_t    * __restrict dst,
+    float const * __restrict src,
+    size_t                 count
+)
+{
+    size_t n = count & ~(size_t) 15;
+    size_t i;
+    for (i = 0; i < n; i += 16) {
+        _mm256_storeu_si256((__m256i*)(dst + i), (__m256i) _mm512_cvtneps_pbh(_mm512_loadu_ps(src + i)));
+    }
+    ConvertF32ToBF16_Scalar(dst + n, src + n, count - n);
+}
+
+/* @summary Convert float32 values to IEEE half precision 16 elements at a time using F16C vcvtps2ph.
+ * @param dst The destination buffer.
+ * @param src The source buffer.
+ * @param count The number of values to convert.
+ */
+static CPU_TARGET("avx,f16c") void
+ConvertF32ToF16_F16C
+(
+    uint16_t    * __restrict dst,
+    float const * __restrict src,
+    size_t                 count
+)
+{
+    size_t n = count & ~(size_t) 15;
+    size_t i;
+    for (i = 0; i < n; i += 16) {
+        _mm_storeu_si128((__m128i*)(dst + i + 0), _mm256_cvtps_ph(_mm256_loadu_ps(src + i + 0), _MM_FROUND_TO_NEAREST_INT | _MM_FROUND_NO_EXC));
+        _mm_storeu_si128((__m128i*)(dst + i + 8), _mm256_cvtps_ph(_mm256_loadu_ps(src + i + 8), _MM_FROUND_TO_NEAREST_INT | _MM_FROUND_NO_EXC));
+    }
+    ConvertF32ToF16_Scalar(dst + n, src + n, count - n);
+}
+
+/* @summary Widen IEEE half-precision values to float32 16 elements at a time using F16C vcvtph2ps.
+ * @param dst The destination buffer.
+ * @param src The source buffer.
+ * @param count The number of values to convert.
+ */
+static CPU_TARGET("avx,f16c") void
+ConvertF16ToF32_F16C
+(
+    float          * __restrict dst,
+    uint16_t const * __restrict src,
+    size_t                    count
+)
+{
+    size_t n = count & ~(size_t) 15;
+    size_t i;
+    for (i = 0; i < n; i += 16) {
+        _mm256_storeu_ps(dst + i + 0, _mm256_cvtph_ps(_mm_loadu_si128((__m128i const*)(src + i + 0))));
+        _mm256_storeu_ps(dst + i + 8, _mm256_cvtph_ps(_mm_loadu_si128((__m128i const*)(src + i + 8))));
+    }
+    ConvertF16ToF32_Scalar(dst + n, src + n, count - n);
+}
+#endif /* CPU_ARCH_X86 */
+
+MNIST_API(void)
+ConvertU8ToF32
+(
+    float         * __restrict dst,
+    uint8_t const * __restrict src,
+    size_t                   count,
+    float                    scale,
+    float                     bias
+)
+{
+    CONVERT_U8_F32_FUNC func = Global_ConvertU8ToF32;
+    if (func == NULL) {
+        uint32_t kernel = CONVERT_KERNEL_COUNT;
+        while (func == NULL && kernel-- > 0) {
+            func = ConvertU8ToF32Kernel(kernel);
+        }
+        Global_ConvertU8ToF32 = func;
+    }
+    func(dst, src, count, scale, bias);
+}
+
+MNIST_API(CONVERT_U8_F32_FUNC)
+ConvertU8ToF32Kernel
+(
+    uint32_t kernel
+)
+{
+#if CPU_ARCH_X86
+    uint32_t cpu = CpuFeatureFlags();
+#endif
+    switch (kernel) {
+        case CONVERT_KERNEL_SCALAR:
+            return ConvertU8ToF32_Scalar;
+#if CPU_ARCH_X86
+        case CONVERT_KERNEL_SSE41:
+            return (cpu & CPU_FEATURE_SSE41) ? ConvertU8ToF32_SSE41 : NULL;
+        case CONVERT_KERNEL_AVX2:
+            return ((cpu & (CPU_FEATURE_AVX2 | CPU_FEATURE_FMA)) == (CPU_FEATURE_AVX2 | CPU_FEATURE_FMA)) ? ConvertU8ToF32_AVX2 : NULL;
+        case CONVERT_KERNEL_AVX512:
+            return (cpu & CPU_FEATURE_AVX512F) ? ConvertU8ToF32_AVX512 : NULL;
+#endif
+        default:
+            return NULL;
+    }
+}
+
+MNIST_API(void)
+ConvertF32ToHalf
+(
+    uint16_t    * __restrict dst,
+    float const * __restrict src,
+    size_t                 count,
+    uint32_t                type
+)
+{
+    CONVERT_F32_HALF_FUNC func;
+    assert(type == CONVERT_TYPE_BF16 || type == CONVERT_TYPE_F16);
+    if ((func = Global_ConvertF32ToHalf[type]) == NULL) {
+#if CPU_ARCH_X86
+        uint32_t cpu = CpuFeatureFlags();
+#endif
+        func = (type == CONVERT_TYPE_BF16) ? ConvertF32ToBF16_Scalar : ConvertF32ToF16_Scalar;
+#if CPU_ARCH_X86
+        if (type == CONVERT_TYPE_BF16) {
+            if ((cpu & (CPU_FEATURE_AVX512F | CPU_FEATURE_AVX512BF16)) == (CPU_FEATURE_AVX512F | CPU_FEATURE_AVX512BF16)) {
+                func = ConvertF32ToBF16_AVX512BF16;
+            } else if (cpu & CPU_FEATURE_AVX2) {
+                func = ConvertF32ToBF16_AVX2;
+            }
+        } else if ((cpu & (CPU_FEATURE_AVX | CPU_FEATURE_F16C)) == (CPU_FEATURE_AVX | CPU_FEATURE_F16C)) {
+            func = ConvertF32ToF16_F16C;
+        }
+#endif
+        Global_ConvertF32ToHalf[type] = func;
+    }
+    func(dst, src, count);
+}
+
+MNIST_API(void)
+ConvertHalfToF32
+(
+    float          * __restrict dst,
+    uint16_t const * __restrict src,
+    size_t                    count,
+    uint32_t                   type
+)
+{
+    CONVERT_HALF_F32_FUNC func;
+    assert(type == CONVERT_TYPE_BF16 || type == CONVERT_TYPE_F16);
+    if ((func = Global_ConvertHalfToF32[type]) == NULL) {
+#if CPU_ARCH_X86
+        uint32_t cpu = CpuFeatureFlags();
+#endif
+        func = (type == CONVERT_TYPE_BF16) ? ConvertBF16ToF32_Scalar : ConvertF16ToF32_Scalar;
+#if CPU_ARCH_X86
+        if (type == CONVERT_TYPE_BF16) {
+            if (cpu & CPU_FEATURE_AVX2) {
+                func = ConvertBF16ToF32_AVX2;
+            }
+        } else if ((cpu & (CPU_FEATURE_AVX | CPU_FEATURE_F16C)) == (CPU_FEATURE_AVX | CPU_FEATURE_F16C)) {
+            func = ConvertF16ToF32_F16C;
+        }
+#endif
+        Global_ConvertHalfToF32[type] = func;
+    }
+    func(dst, src, count);
+}
+
+MNIST_API(char const*)
+ConvertTypeName
+(
+    uint32_t type
+)
+{
+    switch (type) {
+        case CONVERT_TYPE_F32 : return "f32";
+        case CONVERT_TYPE_BF16: return "bf16";
+        case CONVERT_TYPE_F16 : return "f16";
+        default               : return "unknown";
+    }
+}
+
+MNIST_API(char const*)
+ConvertKernelName
+(
+    uint32_t kernel
+)
+{
+    switch (kernel) {
+        case CONVERT_KERNEL_SCALAR: return "scalar";
+        case CONVERT_KERNEL_SSE41 : return "sse4.1";
+        case CONVERT_KERNEL_AVX2  : return "avx2";
+        case CONVERT_KERNEL_AVX512: return "avx512";
+        default                   : return "unknown";
+    }
+}
+
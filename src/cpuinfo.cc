@@ -0,0 +1,189 @@
+/**
+ * @summary Implement the functions exported by the cpuinfo.h module using the
+ * CPUID and XGETBV instructions.
+ */
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "cpuinfo.h"
+
+#if CPU_ARCH_X86
+#   if defined(_MSC_VER)
+#       include <intrin.h>
+#   else
+#       include <cpuid.h>
+#   endif
+#endif
+
+/* @summary The cached result of CpuFeatureFlags.
+ * CPU_FEATURES_QUERY_PENDING is never a valid feature mask, and indicates that the CPU has not been queried yet.
+ * Concurrent first calls may each query the CPU; they all store the same value.
+ */
+#define CPU_FEATURES_QUERY_PENDING    0xFFFFFFFFUL
+static uint32_t volatile Global_CpuFeatureFlags = CPU_FEATURES_QUERY_PENDING;
+
+#if CPU_ARCH_X86
+/* @summary Execute the CPUID instruction.
+ * @param o_regs An array of four values that on return store EAX, EBX, ECX and EDX.
+ * @param leaf The value to load into EAX.
+ * @param subleaf The value to load into ECX.
+ */
+static void
+CpuId
+(
+    uint32_t *o_regs,
+    uint32_t    leaf,
+    uint32_t subleaf
+)
+{
+#if defined(_MSC_VER)
+    int regs[4];
+    __cpuidex(regs, (int) leaf, (int) subleaf);
+    o_regs[0] = (uint32_t) regs[0]; o_regs[1] = (uint32_t) regs[1];
+    o_regs[2] = (uint32_t) regs[2]; o_regs[3] = (uint32_t) regs[3];
+#else
+    __cpuid_count(leaf, subleaf, o_regs[0], o_regs[1], o_regs[2], o_regs[3]);
+#endif
+}
+
+/* @summary Read the XCR0 extended control register to determine which register states the operating system saves on context switch.
+ * The caller must have verified that CPUID reports OSXSAVE.
+ * @return The low 32 bits of XCR0.
+ */
+static uint32_t
+ReadXcr0
+(
+    void
+)
+{
+#if defined(_MSC_VER)
+    return (uint32_t) _xgetbv(0);
+#else
+    uint32_t eax, edx;
+    __asm__ __volatile__("xgetbv" : "=a"(eax), "=d"(edx) : "c"(0));
+    (void) edx;
+    return eax;
+#endif
+}
+
+/* @summary Query the CPU and operating system for supported instruction set extensions.
+ * @return One or more bitwise-OR'd values of the CPU_FEATURE_FLAGS enumeration.
+ */
+static uint32_t
+QueryCpuFeatureFlags
+(
+    void
+)
+{
+    uint32_t regs[4];
+    uint32_t max_leaf = 0;
+    uint32_t    flags = CPU_FEATURES_NONE;
+    uint32_t     xcr0 = 0;
+    int     os_avx    = 0;
+    int     os_avx512 = 0;
+
+    CpuId(regs, 0, 0);
+    max_leaf = regs[0];
+    if (max_leaf < 1) {
+        return CPU_FEATURES_NONE;
+    }
+
+    CpuId(regs, 1, 0);
+    if (regs[3] & (1UL << 26)) flags |= CPU_FEATURE_SSE2;
+    if (regs[2] & (1UL <<  9)) flags |= CPU_FEATURE_SSSE3;
+    if (regs[2] & (1UL << 19)) flags |= CPU_FEATURE_SSE41;
+    if (regs[2] & (1UL << 20)) flags |= CPU_FEATURE_SSE42;
+    if (regs[2] & (1UL << 23)) flags |= CPU_FEATURE_POPCNT;
+    if (regs[2] & (1UL << 27)) { /* OSXSAVE - safe to read XCR0 */
+        xcr0      = ReadXcr0();
+        os_avx    =((xcr0 & 0x06) == 0x06); /* XMM and YMM state */
+        os_avx512 =((xcr0 & 0xE6) == 0xE6); /* XMM, YMM, opmask, ZMM_Hi256 and Hi16_ZMM state */
+    }
+    if (os_avx) {
+        if (regs[2] & (1UL << 28)) flags |= CPU_FEATURE_AVX;
+        if (regs[2] & (1UL << 12)) flags |= CPU_FEATURE_FMA;
+        if (regs[2] & (1UL << 29)) flags |= CPU_FEATURE_F16C;
+    }
+    if (max_leaf >= 7) {
+        uint32_t max_subleaf;
+        CpuId(regs, 7, 0);
+        max_subleaf = regs[0];
+        if (regs[1] & (1UL <<  8)) flags |= CPU_FEATURE_BMI2;
+        if (os_avx && (flags & CPU_FEATURE_AVX)) {
+            if (regs[1] & (1UL <<  5)) flags |= CPU_FEATURE_AVX2;
+        }
+        if (os_avx512) {
+            if (regs[1] & (1UL << 16)) flags |= CPU_FEATURE_AVX512F;
+            if (regs[1] & (1UL << 30)) flags |= CPU_FEATURE_AVX512BW;
+            if (regs[1] & (1UL << 31)) flags |= CPU_FEATURE_AVX512VL;
+            if (regs[2] & (1UL << 11)) flags |= CPU_FEATURE_AVX512VNNI;
+        }
+        if (max_subleaf >= 1) {
+            CpuId(regs, 7, 1);
+            if (os_avx    && (regs[0] & (1UL << 4))) flags |= CPU_FEATURE_AVXVNNI;
+            if (os_avx512 && (regs[0] & (1UL << 5))) flags |= CPU_FEATURE_AVX512BF16;
+        }
+    }
+    return flags;
+}
+#endif /* CPU_ARCH_X86 */
+
+MNIST_API(uint32_t)
+CpuFeatureFlags
+(
+    void
+)
+{
+    uint32_t flags = Global_CpuFeatureFlags;
+    if (flags == CPU_FEATURES_QUERY_PENDING) {
+#if CPU_ARCH_X86
+        flags = QueryCpuFeatureFlags();
+#else
+        flags = CPU_FEATURES_NONE;
+#endif
+        Global_CpuFeatureFlags = flags;
+    }
+    return flags;
+}
+
+MNIST_API(size_t)
+CpuBrandString
+(
+    char    *dst,
+    size_t max_dst
+)
+{
+    char     brand[CPU_BRAND_STRING_MAX];
+    char     *beg = brand;
+    size_t    len;
+
+    memset(brand, 0, sizeof(brand));
+#if CPU_ARCH_X86
+    {
+        uint32_t regs[4];
+        uint32_t    i;
+        CpuId(regs, 0x80000000UL, 0);
+        if (regs[0] >= 0x80000004UL) {
+            /* leaves 0x80000002-0x80000004 each return 16 characters of the brand string in EAX, EBX, ECX, EDX */
+            for (i = 0; i < 3; ++i) {
+                CpuId(regs, 0x80000002UL + i, 0);
+                memcpy(brand + (i * 16), regs, 16);
+            }
+        }
+    }
+#endif
+    while (*beg == ' ') {
+        beg++;
+    }
+    if (*beg == 0) {
+        beg = (char*) "unknown";
+    }
+    len = strlen(beg);
+    if (dst != NULL && max_dst > 0) {
+        size_t n = len < (max_dst - 1) ? len : (max_dst - 1);
+        memcpy(dst, beg, n);
+        dst[n] = 0;
+    }
+    return len;
+}
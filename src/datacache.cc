@@ -0,0 +1,344 @@
+/**
+ * @summary Implement the functions exported by the datacache.h module for
+ * building and loading float32 image caches.
+ */
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <assert.h>
+#include <errno.h>
+
+#include "filemap.h"
+#include "convert.h"
+#include "dataset.h"
+#include "datacache.h"
+
+/* @summary Define the errno value used to report that a cache file exists but must be rebuilt.
+ * Visual C++ does not define ESTALE.
+ */
+#ifndef ESTALE
+#define ESTALE                        ENOEXEC
+#endif
+
+/* @summary Define the number of sample rows converted and written per call to fwrite when building a cache.
+ */
+#ifndef DATA_CACHE_ROWS_PER_CHUNK
+#define DATA_CACHE_ROWS_PER_CHUNK     256
+#endif
+
+/* @summary Round a value up to the next multiple of a power of two.
+ * @param _value The value to round.
+ * @param _pow2 The power-of-two multiple.
+ * @return The smallest multiple of _pow2 that is greater than or equal to _value.
+ */
+#ifndef AlignUp
+#define AlignUp(_value, _pow2)                                                 \
+    (((_value) + ((_pow2) - 1)) & ~((_pow2) - 1))
+#endif
+
+/* @summary Compute the row stride, in floats, for samples with a given number of features.
+ * @param feature_count The number of float values in each sample.
+ * @return The number of floats between the start of consecutive rows, such that every row starts on a DATA_CACHE_ALIGNMENT boundary.
+ */
+static uint32_t
+DataCacheRowStride
+(
+    uint32_t feature_count
+)
+{
+    uint32_t const floats_per_line = DATA_CACHE_ALIGNMENT / sizeof(float);
+    return AlignUp(feature_count, floats_per_line);
+}
+
+/* @summary Convert a set of 8-bit samples to float32 rows.
+ * @param dst The destination buffer, with space for count * row_stride floats.
+ * @param src The source pixels, stored as count consecutive samples of feature_count bytes.
+ * @param count The number of samples to convert.
+ * @param feature_count The number of pixels in each sample.
+ * @param row_stride The distance between the start of consecutive destination rows, in floats. Padding floats are set to zero.
+ * @param scale The scale applied to each pixel value.
+ * @param bias The bias added to each scaled pixel value.
+ */
+static void
+ConvertSampleRows
+(
+    float         * __restrict dst,
+    uint8_t const * __restrict src,
+    uint32_t                 count,
+    uint32_t         feature_count,
+    uint32_t            row_stride,
+    float                    scale,
+    float                     bias
+)
+{
+    uint32_t i;
+    for (i = 0; i < count; ++i) {
+        ConvertU8ToF32(dst, src, feature_count, scale, bias);
+        memset(dst + feature_count, 0, (row_stride - feature_count) * sizeof(float));
+        dst += row_stride;
+        src += feature_count;
+    }
+}
+
+MNIST_API(int)
+DataCacheNormalization
+(
+    float                      *o_scale,
+    float                       *o_bias,
+    struct MNIST_DATASET const *dataset,
+    uint32_t             normalize_mode
+)
+{
+    switch (normalize_mode) {
+        case DATA_CACHE_NORMALIZE_UNIT:
+            { *o_scale = 1.0f / 255.0f;
+              *o_bias  = 0.0f;
+            } return 0;
+        case DATA_CACHE_NORMALIZE_STANDARD:
+            { /* pixels take only 256 distinct values, so a histogram gives exact statistics in one pass */
+              uint64_t hist[256];
+              uint64_t    n = (uint64_t) dataset->SampleCount * dataset->ImageSize;
+              uint8_t const *p = dataset->Pixels;
+              double    sum = 0.0;
+              double  sumsq = 0.0;
+              double   mean = 0.0;
+              double stddev = 1.0;
+              uint64_t    i;
+              memset(hist, 0, sizeof(hist));
+              for (i = 0; i < n; ++i) {
+                  hist[p[i]]++;
+              }
+              for (i = 0; i < 256; ++i) {
+                  double x = (double) i / 255.0;
+                  sum     += (double) hist[i] * x;
+                  sumsq   += (double) hist[i] * x * x;
+              }
+              if (n > 0) {
+                  mean   = sum / (double) n;
+                  stddev = sqrt((sumsq / (double) n) - (mean * mean));
+              }
+              if (stddev <= 0.0) {
+                  stddev = 1.0;
+              }
+              *o_scale = (float)(1.0 / (255.0 * stddev));
+              *o_bias  = (float)(-mean / stddev);
+            } return 0;
+        default:
+            break;
+    }
+    errno = EINVAL;
+    return -1;
+}
+
+MNIST_API(int)
+DataCacheBuild
+(
+    struct MNIST_DATASET const *dataset,
+    char const              *cache_path,
+    uint32_t             normalize_mode
+)
+{
+    DATA_CACHE_HEADER header;
+    uint8_t      pad[DATA_CACHE_ALIGNMENT];
+    char         *tmp_path = NULL;
+    float           *rows = NULL;
+    FILE              *fp = NULL;
+    size_t       path_len = 0;
+    uint32_t   row_stride = 0;
+    uint32_t         base = 0;
+    float           scale = 1.0f;
+    float            bias = 0.0f;
+    int               err = 0;
+
+    if (dataset == NULL || dataset->Pixels == NULL || cache_path == NULL) {
+        errno = EINVAL;
+        return -1;
+    }
+    if (DataCacheNormalization(&scale, &bias, dataset, normalize_mode) != 0) {
+        return -1;
+    }
+    row_stride = DataCacheRowStride(dataset->ImageSize);
+    path_len   = strlen(cache_path);
+    if ((tmp_path = (char*) malloc(path_len + 5)) == NULL) {
+        return -1;
+    }
+    memcpy(tmp_path, cache_path, path_len);
+    memcpy(tmp_path + path_len, ".tmp", 5);
+    if ((rows = (float*) malloc((size_t) DATA_CACHE_ROWS_PER_CHUNK * row_stride * sizeof(float))) == NULL) {
+        goto cleanup_and_fail;
+    }
+
+    memset(&header, 0, sizeof(DATA_CACHE_HEADER));
+    header.Magic           = DATA_CACHE_MAGIC;
+    header.Version         = DATA_CACHE_VERSION;
+    header.ByteOrderMark   = DATA_CACHE_BYTE_ORDER_MARK;
+    header.NormalizeMode   = normalize_mode;
+    header.SampleCount     = dataset->SampleCount;
+    header.FeatureCount    = dataset->ImageSize;
+    header.RowStride       = row_stride;
+    header.DataOffset      = AlignUp((uint32_t) sizeof(DATA_CACHE_HEADER), DATA_CACHE_ALIGNMENT);
+    header.SourceSize      = dataset->ImageFile.Mapping.FileSize;
+    header.SourceWriteTime = dataset->ImageFile.Mapping.LastWriteTime;
+    header.Scale           = scale;
+    header.Bias            = bias;
+    memset(pad, 0, sizeof(pad));
+
+    if ((fp = fopen(tmp_path, "wb")) == NULL) {
+        goto cleanup_and_fail;
+    }
+    if (fwrite(&header, sizeof(DATA_CACHE_HEADER), 1, fp) != 1) {
+        goto cleanup_and_fail;
+    }
+    if (header.DataOffset > sizeof(DATA_CACHE_HEADER)) {
+        size_t npad = header.DataOffset - sizeof(DATA_CACHE_HEADER);
+        if (fwrite(pad, 1, npad, fp) != npad) {
+            goto cleanup_and_fail;
+        }
+    }
+    for (base = 0; base < dataset->SampleCount; base += DATA_CACHE_ROWS_PER_CHUNK) {
+        uint32_t n = dataset->SampleCount - base;
+        if (n > DATA_CACHE_ROWS_PER_CHUNK) {
+            n = DATA_CACHE_ROWS_PER_CHUNK;
+        }
+        ConvertSampleRows(rows, MnistDatasetImage(dataset, base), n, dataset->ImageSize, row_stride, scale, bias);
+        if (fwrite(rows, sizeof(float) * row_stride, n, fp) != n) {
+            goto cleanup_and_fail;
+        }
+    }
+    if (fclose(fp) != 0) {
+        fp = NULL;
+        goto cleanup_and_fail;
+    }
+    fp = NULL;
+#ifdef _WIN32
+    (void) remove(cache_path); /* rename does not replace an existing file on Windows */
+#endif
+    if (rename(tmp_path, cache_path) != 0) {
+        goto cleanup_and_fail;
+    }
+    free(rows);
+    free(tmp_path);
+    return 0;
+
+cleanup_and_fail:
+    err = errno ? errno : EIO;
+    if (fp != NULL) {
+        fclose(fp);
+    }
+    if (tmp_path != NULL) {
+        (void) remove(tmp_path);
+    }
+    free(rows);
+    free(tmp_path);
+    errno = err;
+    return -1;
+}
+
+MNIST_API(int)
+DataCacheOpen
+(
+    struct DATA_CACHE             *o_cache,
+    struct MNIST_DATASET const    *dataset,
+    char const                 *cache_path,
+    uint32_t                normalize_mode
+)
+{
+    DATA_CACHE_HEADER const *h = NULL;
+    uint64_t     expected_size = 0;
+
+    assert(o_cache != NULL);
+    memset(o_cache, 0, sizeof(DATA_CACHE));
+
+    if (dataset == NULL || cache_path == NULL) {
+        errno = EINVAL;
+        return -1;
+    }
+    if (FileMappingOpen(&o_cache->Mapping, cache_path, FILE_MAPPING_HINT_WILLNEED) != 0) {
+        return -1;
+    }
+    if (o_cache->Mapping.Size < sizeof(DATA_CACHE_HEADER)) {
+        goto stale;
+    }
+    h = (DATA_CACHE_HEADER const*) o_cache->Mapping.Base;
+    if (h->Magic != DATA_CACHE_MAGIC || h->Version != DATA_CACHE_VERSION || h->ByteOrderMark != DATA_CACHE_BYTE_ORDER_MARK) {
+        goto stale;
+    }
+    if (h->NormalizeMode != normalize_mode) {
+        goto stale;
+    }
+    if (h->SourceSize != dataset->ImageFile.Mapping.FileSize || h->SourceWriteTime != dataset->ImageFile.Mapping.LastWriteTime) {
+        goto stale;
+    }
+    if (h->SampleCount != dataset->SampleCount || h->FeatureCount != dataset->ImageSize) {
+        goto stale;
+    }
+    if (h->RowStride < h->FeatureCount || (h->DataOffset % DATA_CACHE_ALIGNMENT) != 0 || ((h->RowStride * sizeof(float)) % DATA_CACHE_ALIGNMENT) != 0) {
+        goto stale;
+    }
+    expected_size = (uint64_t) h->DataOffset + ((uint64_t) h->SampleCount * h->RowStride * sizeof(float));
+    if (o_cache->Mapping.FileSize != expected_size) {
+        goto stale;
+    }
+    o_cache->Header       = h;
+    o_cache->Samples      =(float const*)(((uint8_t const*) o_cache->Mapping.Base) + h->DataOffset);
+    o_cache->SampleCount  = h->SampleCount;
+    o_cache->FeatureCount = h->FeatureCount;
+    o_cache->RowStride    = h->RowStride;
+    o_cache->Scale        = h->Scale;
+    o_cache->Bias         = h->Bias;
+    return 0;
+
+stale:
+    FileMappingClose(&o_cache->Mapping);
+    memset(o_cache, 0, sizeof(DATA_CACHE));
+    errno = ESTALE;
+    return -1;
+}
+
+MNIST_API(int)
+DataCacheOpenOrBuild
+(
+    struct DATA_CACHE             *o_cache,
+    struct MNIST_DATASET const    *dataset,
+    char const                 *cache_path,
+    uint32_t                normalize_mode
+)
+{
+    if (DataCacheOpen(o_cache, dataset, cache_path, normalize_mode) == 0) {
+        return 0;
+    }
+    if (errno != ENOENT && errno != ESTALE) {
+        return -1;
+    }
+    if (DataCacheBuild(dataset, cache_path, normalize_mode) != 0) {
+        return -1;
+    }
+    return DataCacheOpen(o_cache, dataset, cache_path, normalize_mode);
+}
+
+MNIST_API(void)
+DataCacheClose
+(
+    struct DATA_CACHE *cache
+)
+{
+    if (cache != NULL) {
+        FileMappingClose(&cache->Mapping);
+        memset(cache, 0, sizeof(DATA_CACHE));
+    }
+}
+
+MNIST_API(float const*)
+DataCacheSample
+(
+    struct DATA_CACHE const *cache,
+    uint32_t                 index
+)
+{
+    assert(index < cache->SampleCount);
+    return cache->Samples + ((size_t) index * cache->RowStride);
+}
+
@@ -0,0 +1,115 @@
+/**
+ * @summary Implement the functions exported by the dataset.h module for opening
+ * MNIST-style image/label data sets.
+ */
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+#include <assert.h>
+#include <errno.h>
+
+#include "idxfile.h"
+#include "dataset.h"
+
+MNIST_API(int)
+MnistDatasetOpen
+(
+    struct MNIST_DATASET *o_dataset,
+    char const         *images_path,
+    char const         *labels_path
+)
+{
+    IDX_HEADER const *ih = NULL;
+    IDX_HEADER const *lh = NULL;
+    uint8_t const    *lp = NULL;
+    uint32_t           i = 0;
+    int              err = 0;
+
+    assert(o_dataset != NULL);
+    memset(o_dataset, 0, sizeof(MNIST_DATASET));
+
+    /* batch assembly touches the whole image file; start reading it in now */
+    if (IdxFileOpen(&o_dataset->ImageFile, images_path, FILE_MAPPING_HINT_WILLNEED) != 0) {
+        return -1;
+    }
+    if (IdxFileOpen(&o_dataset->LabelFile, labels_path, FILE_MAPPING_HINT_WILLNEED) != 0) {
+        goto cleanup_and_fail;
+    }
+    ih = &o_dataset->ImageFile.Header;
+    lh = &o_dataset->LabelFile.Header;
+    if (ih->TypeCode != IDX_TYPE_U8 || ih->DimensionCount != 3) {
+        errno = EINVAL;
+        goto cleanup_and_fail;
+    }
+    if (lh->TypeCode != IDX_TYPE_U8 || lh->DimensionCount != 1) {
+        errno = EINVAL;
+        goto cleanup_and_fail;
+    }
+    if (ih->Dimensions[0] != lh->Dimensions[0]) {
+        errno = EINVAL;
+        goto cleanup_and_fail;
+    }
+    if (ih->Dimensions[1] == 0 || ih->Dimensions[2] == 0 || ih->Dimensions[1] > (UINT32_MAX / ih->Dimensions[2])) {
+        errno = EINVAL;
+        goto cleanup_and_fail;
+    }
+    /* the label file is small; check it once here rather than on every use */
+    lp = IdxFileDataU8(&o_dataset->LabelFile);
+    for (i = 0; i < lh->Dimensions[0]; ++i) {
+        if (lp[i] >= MNIST_CLASS_COUNT) {
+            errno = EINVAL;
+            goto cleanup_and_fail;
+        }
+    }
+    o_dataset->Pixels       = IdxFileDataU8(&o_dataset->ImageFile);
+    o_dataset->Labels       = lp;
+    o_dataset->SampleCount  = ih->Dimensions[0];
+    o_dataset->ImageRows    = ih->Dimensions[1];
+    o_dataset->ImageColumns = ih->Dimensions[2];
+    o_dataset->ImageSize    = ih->Dimensions[1] * ih->Dimensions[2];
+    return 0;
+
+cleanup_and_fail:
+    err = errno;
+    IdxFileClose(&o_dataset->LabelFile);
+    IdxFileClose(&o_dataset->ImageFile);
+    memset(o_dataset, 0, sizeof(MNIST_DATASET));
+    errno = err;
+    return -1;
+}
+
+MNIST_API(void)
+MnistDatasetClose
+(
+    struct MNIST_DATASET *dataset
+)
+{
+    if (dataset != NULL) {
+        IdxFileClose(&dataset->LabelFile);
+        IdxFileClose(&dataset->ImageFile);
+        memset(dataset, 0, sizeof(MNIST_DATASET));
+    }
+}
+
+MNIST_API(uint8_t const*)
+MnistDatasetImage
+(
+    struct MNIST_DATASET const *dataset,
+    uint32_t                      index
+)
+{
+    assert(index < dataset->SampleCount);
+    return dataset->Pixels + ((size_t) index * dataset->ImageSize);
+}
+
+MNIST_API(uint8_t)
+MnistDatasetLabel
+(
+    struct MNIST_DATASET const *dataset,
+    uint32_t                      index
+)
+{
+    assert(index < dataset->SampleCount);
+    return dataset->Labels[index];
+}
+
@@ -0,0 +1,364 @@
+/**
+ * @summary Implement the platform-independent functions exported by the
+ * dirscan.h module for classifying and collecting IDX shard files. The
+ * directory walk itself is implemented in the platform-specific files.
+ */
+#include <stddef.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+#include <errno.h>
+
+#include "strlib.h"
+#include "pathlib.h"
+#include "taskpool.h"
+#include "dirscan.h"
+
+/* @summary Define the number of paths parsed by each call to LinuxPathStringParseBatch in IdxShardListAddPaths.
+ */
+#ifndef IDX_SHARD_PARSE_BATCH_SIZE
+#   define IDX_SHARD_PARSE_BATCH_SIZE     1024
+#endif
+
+/* @summary Define the data associated with a shard path awaiting insertion into an IDX_SHARD_LIST.
+ */
+typedef struct IDX_SHARD_CANDIDATE {
+    char8_t const               *Path;                                         /* The nul-terminated path of the shard file. */
+    IDX_SHARD                    Shard;                                        /* The attributes of the shard derived from the path. */
+} IDX_SHARD_CANDIDATE;
+
+/* @summary Determine whether a range of characters starts with a lowercase ASCII token, ignoring case.
+ * @param beg The first character of the range.
+ * @param end One past the last character of the range.
+ * @param token The nul-terminated, lowercase token.
+ * @return Non-zero if the range starts with the token.
+ */
+static int
+IdxNameStartsWith
+(
+    char8_t const *beg,
+    char8_t const *end,
+    char const  *token
+)
+{
+    for ( ; *token; ++beg, ++token) {
+        if (beg == end || (*beg | 0x20) != *token) {
+            return 0;
+        }
+    }
+    return 1;
+}
+
+/* @summary Search a range of characters for a lowercase ASCII token, ignoring case.
+ * @param beg The first character of the range.
+ * @param end One past the last character of the range.
+ * @param token The nul-terminated, lowercase token.
+ * @return A pointer to the first occurrence of the token, or NULL if the range does not contain it.
+ */
+static char8_t const*
+IdxNameFind
+(
+    char8_t const *beg,
+    char8_t const *end,
+    char const  *token
+)
+{
+    for ( ; beg != end; ++beg) {
+        if (IdxNameStartsWith(beg, end, token)) {
+            return beg;
+        }
+    }
+    return NULL;
+}
+
+/* @summary Determine the data set named by the start of a file or directory name.
+ * @return One of the values of the IDX_SHARD_SET enumeration.
+ */
+static uint32_t
+IdxNameDataSet
+(
+    char8_t const *beg,
+    char8_t const *end
+)
+{
+    if (IdxNameStartsWith(beg, end, "train")) {
+        return IDX_SHARD_SET_TRAINING;
+    }
+    if (IdxNameStartsWith(beg, end, "t10k") || IdxNameStartsWith(beg, end, "test")) {
+        return IDX_SHARD_SET_TEST;
+    }
+    return IDX_SHARD_SET_UNKNOWN;
+}
+
+/* @summary Determine whether the characters after "ubyte" in a file name form a valid shard suffix: nothing, or '.' or '-' followed only by digits.
+ * This rejects files derived from a shard, such as the ".f32cache" files written next to the images.
+ * @return Non-zero if the suffix is valid.
+ */
+static int
+IdxNameShardSuffix
+(
+    char8_t const *beg,
+    char8_t const *end
+)
+{
+    if (beg == end) {
+        return 1;
+    }
+    if ((*beg != '.' && *beg != '-') || ++beg == end) {
+        return 0;
+    }
+    for ( ; beg != end; ++beg) {
+        if (*beg < '0' || *beg > '9') {
+            return 0;
+        }
+    }
+    return 1;
+}
+
+/* @summary Parse the run of decimal digits at the end of a range of characters.
+ * @param o_value On return, the value of the digits, saturated to UINT32_MAX.
+ * @return Non-zero if the range ends with at least one digit.
+ */
+static int
+IdxNameTrailingNumber
+(
+    uint32_t     *o_value,
+    char8_t const   *beg,
+    char8_t const   *end
+)
+{
+    char8_t const *p = end;
+    uint64_t       v = 0;
+
+    while (p != beg && p[-1] >= '0' && p[-1] <= '9') {
+        p--;
+    }
+    if (p == end) {
+        return 0;
+    }
+    for ( ; p != end; ++p) {
+        v = (v * 10) + (uint64_t)(*p - '0');
+        if (v > 0xFFFFFFFFULL) {
+            v = 0xFFFFFFFFULL;
+        }
+    }
+   *o_value = (uint32_t) v;
+    return 1;
+}
+
+/* @summary Order candidate shard paths lexicographically, for use with qsort.
+ */
+static int
+IdxShardCandidateCompare
+(
+    void const *a,
+    void const *b
+)
+{
+    return Utf8StringCompare(((IDX_SHARD_CANDIDATE const*) a)->Path, ((IDX_SHARD_CANDIDATE const*) b)->Path);
+}
+
+/* @summary Order shards by data set, content, shard index and path id, for use with qsort.
+ */
+static int
+IdxShardCompare
+(
+    void const *a,
+    void const *b
+)
+{
+    IDX_SHARD const *sa = (IDX_SHARD const*) a;
+    IDX_SHARD const *sb = (IDX_SHARD const*) b;
+    if (sa->DataSet    != sb->DataSet   ) return (sa->DataSet    < sb->DataSet   ) ? -1 : 1;
+    if (sa->Content    != sb->Content   ) return (sa->Content    < sb->Content   ) ? -1 : 1;
+    if (sa->ShardIndex != sb->ShardIndex) return (sa->ShardIndex < sb->ShardIndex) ? -1 : 1;
+    if (sa->PathId     != sb->PathId    ) return (sa->PathId     < sb->PathId    ) ? -1 : 1;
+    return 0;
+}
+
+MNIST_API(int)
+IdxShardListCreate
+(
+    struct IDX_SHARD_LIST *o_list,
+    uint32_t             capacity,
+    size_t           string_bytes
+)
+{
+    assert(o_list != NULL);
+    memset(o_list, 0, sizeof(IDX_SHARD_LIST));
+
+    if (LinuxPathInternTableCreate(&o_list->Paths, capacity, string_bytes) != 0) {
+        return -1;
+    }
+    if ((o_list->Shards = (IDX_SHARD*) malloc(capacity * sizeof(IDX_SHARD))) == NULL) {
+        LinuxPathInternTableDelete(&o_list->Paths);
+        return -1;
+    }
+    o_list->Capacity = capacity;
+    return 0;
+}
+
+MNIST_API(void)
+IdxShardListDelete
+(
+    struct IDX_SHARD_LIST *list
+)
+{
+    if (list != NULL) {
+        LinuxPathInternTableDelete(&list->Paths);
+        free(list->Shards);
+        memset(list, 0, sizeof(IDX_SHARD_LIST));
+    }
+}
+
+MNIST_API(int)
+IdxShardClassify
+(
+    struct IDX_SHARD             *o_shard,
+    struct PATH_PARTS_LINUX const *parts
+)
+{
+    char8_t const  *str = parts->Root;
+    char8_t const  *end = str + strlen(str);
+    char8_t const *name = end;
+    char8_t const  *idx = NULL;
+    char8_t const  *tag = NULL;
+    char8_t const  *dir;
+    uint32_t      index = 0;
+
+    if (parts->PathFlags & PATH_FLAG_INVALID) {
+        return -1;
+    }
+    if (parts->PathFlags & PATH_FLAG_FILENAME) {
+        name = parts->Filename;
+    } else {
+        /* a file name without an extension is parsed as the last directory component */
+        while (name != str && name[-1] != '/') {
+            name--;
+        }
+    }
+    /* the file name must contain "idx", the number of dimensions, and "ubyte" */
+    for (idx = name; (idx = IdxNameFind(idx, end, "idx")) != NULL; idx++) {
+        if (idx + 3 != end && idx[3] >= '0' && idx[3] <= '9') {
+            break;
+        }
+    }
+    if (idx == NULL || (tag = IdxNameFind(idx, end, "ubyte")) == NULL || !IdxNameShardSuffix(tag + 5, end)) {
+        return -1;
+    }
+    if (IdxNameFind(name, end, "labels") != NULL) {
+        o_shard->Content = IDX_SHARD_CONTENT_LABELS;
+    } else if (IdxNameFind(name, end, "images") != NULL) {
+        o_shard->Content = IDX_SHARD_CONTENT_IMAGES;
+    } else {
+        o_shard->Content = (idx[3] == '1') ? IDX_SHARD_CONTENT_LABELS : IDX_SHARD_CONTENT_IMAGES;
+    }
+    /* the data set comes from the file name, or else from the nearest directory that names one */
+    o_shard->DataSet = IdxNameDataSet(name, end);
+    dir = name;
+    while (o_shard->DataSet == IDX_SHARD_SET_UNKNOWN && dir != str) {
+        char8_t const *dir_end = dir - 1;
+        for (dir = dir_end; dir != str && dir[-1] != '/'; --dir) {
+            /* empty */
+        }
+        o_shard->DataSet = IdxNameDataSet(dir, dir_end);
+    }
+    /* the shard index follows "ubyte", as in ".0003", or else ends the parent directory name, as in "shard-0003/" */
+    if (!IdxNameTrailingNumber(&index, tag + 5, end) && name != str) {
+        char8_t const *dir_end = name - 1;
+        for (dir = dir_end; dir != str && dir[-1] != '/'; --dir) {
+            /* empty */
+        }
+        (void) IdxNameTrailingNumber(&index, dir, dir_end);
+    }
+    o_shard->ShardIndex = index;
+    return 0;
+}
+
+MNIST_API(int)
+IdxShardListAddPaths
+(
+    struct IDX_SHARD_LIST *list,
+    char8_t                *blob,
+    size_t            blob_bytes
+)
+{
+    PATH_PARTS_LINUX_BATCH batch;
+    IDX_SHARD_CANDIDATE    *cand = NULL;
+    size_t               ncand = 0;
+    size_t              maxcand = 0;
+    size_t               offset = 0;
+    size_t                    i;
+    int                  result = 0;
+
+    if (LinuxPathBatchCreate(&batch, IDX_SHARD_PARSE_BATCH_SIZE) != 0) {
+        return -1;
+    }
+    while (offset < blob_bytes) {
+        size_t consumed = 0;
+        if (LinuxPathStringParseBatch(&batch, &consumed, blob + offset, blob_bytes - offset) != 0) {
+            result = -1;
+            goto cleanup_and_exit;
+        }
+        if (consumed == 0) {
+            break; /* no nul-terminated paths remain */
+        }
+        for (i = 0; i < batch.PathCount; ++i) {
+            PATH_PARTS_LINUX parts;
+            IDX_SHARD        shard;
+            parts.Root         = batch.Base + batch.Root[i];
+            parts.RootEnd      = batch.Base + batch.RootEnd[i];
+            parts.Path         = batch.Base + batch.Path[i];
+            parts.PathEnd      = batch.Base + batch.PathEnd[i];
+            parts.Filename     = batch.Base + batch.Filename[i];
+            parts.FilenameEnd  = batch.Base + batch.FilenameEnd[i];
+            parts.Extension    = batch.Base + batch.Extension[i];
+            parts.ExtensionEnd = batch.Base + batch.ExtensionEnd[i];
+            parts.PathFlags    = batch.PathFlags[i];
+            if (IdxShardClassify(&shard, &parts) != 0) {
+                continue;
+            }
+            if (ncand == maxcand) {
+                size_t             newmax = (maxcand == 0) ? 256 : maxcand * 2;
+                IDX_SHARD_CANDIDATE *newc = (IDX_SHARD_CANDIDATE*) realloc(cand, newmax * sizeof(IDX_SHARD_CANDIDATE));
+                if (newc == NULL) {
+                    result = -1;
+                    goto cleanup_and_exit;
+                }
+                cand    = newc;
+                maxcand = newmax;
+            }
+            cand[ncand].Path  = parts.Root;
+            cand[ncand].Shard = shard;
+            ncand++;
+        }
+        offset += consumed;
+    }
+    /* intern in path order so that ties in the final sort are broken by path */
+    if (ncand > 1) {
+        qsort(cand, ncand, sizeof(IDX_SHARD_CANDIDATE), IdxShardCandidateCompare);
+    }
+    for (i = 0; i < ncand; ++i) {
+        uint32_t count = list->Paths.PathCount;
+        uint32_t    id = PATH_INTERN_INVALID_ID;
+        if (LinuxPathIntern(&id, &list->Paths, NULL, cand[i].Path) != 0) {
+            result = -1;
+            break;
+        }
+        if (list->Paths.PathCount == count) {
+            continue; /* the shard is already in the list */
+        }
+        list->Shards[list->ShardCount] = cand[i].Shard;
+        list->Shards[list->ShardCount].PathId = id;
+        list->ShardCount++;
+    }
+    if (list->ShardCount > 1) {
+        qsort(list->Shards, list->ShardCount, sizeof(IDX_SHARD), IdxShardCompare);
+    }
+
+cleanup_and_exit:
+    LinuxPathBatchDelete(&batch);
+    free(cand);
+    return result;
+}
@@ -0,0 +1,851 @@
+/**
+ * @summary Implement the functions exported by the gemm.h module for
+ * single-precision matrix multiplication, with inputs optionally stored in
+ * a 16-bit format and widened to float32 as they are packed.
+ */
+#include <stddef.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+
+#include "cpuinfo.h"
+#include "convert.h"
+#include "taskpool.h"
+#include "gemm.h"
+
+#if CPU_ARCH_X86
+#include <immintrin.h>
+#endif
+
+/* @summary Round a value up to the next multiple of a power of two.
+ * @param _value The value to round.
+ * @param _pow2 The power-of-two multiple.
+ * @return The smallest multiple of _pow2 that is greater than or equal to _value.
+ */
+#ifndef AlignUp
+#define AlignUp(_value, _pow2)                                                 \
+    (((_value) + ((_pow2) - 1)) & ~((_pow2) - 1))
+#endif
+
+/* @summary Compute the minimum of two values.
+ */
+#ifndef MinValue
+#define MinValue(_a, _b)                                                       \
+    (((_a) < (_b)) ? (_a) : (_b))
+#endif
+
+/* @summary Define the signature of a GEMM micro-kernel.
+ * The micro-kernel computes the MR x NR product of a packed MR x kc sliver of A and a packed kc x NR sliver of B,
+ * and writes C[0:mr, 0:nr] = alpha * product + beta * C[0:mr, 0:nr].
+ * @param kc The depth of the product.
+ * @param ap The packed sliver of A, storing MR values for each of kc steps.
+ * @param bp The packed sliver of B, storing NR values for each of kc steps. Must be aligned to 32 bytes.
+ * @param c The first element of the tile of C.
+ * @param ldc The distance between the start of consecutive rows of C, in floats.
+ * @param alpha The scale applied to the product.
+ * @param beta The scale applied to C. If zero, C is not read.
+ * @param mr The number of valid rows in the tile, in [1, MR].
+ * @param nr The number of valid columns in the tile, in [1, NR].
+ */
+typedef void (*GEMM_MICROKERNEL_FUNC)
+(
+    uint32_t                 kc,
+    float const * __restrict ap,
+    float const * __restrict bp,
+    float       * __restrict  c,
+    size_t                  ldc,
+    float                 alpha,
+    float                  beta,
+    uint32_t                 mr,
+    uint32_t                 nr
+);
+
+/* @summary Define the state shared by the tasks of a parallel GEMM for a single KC x NC panel.
+ */
+typedef struct GEMM_PARALLEL_ARGS {
+    GEMM_MICROKERNEL_FUNC        Kernel;                                       /* The micro-kernel. */
+    void const                  *A;                                            /* The first element of column pc of op(A). */
+    void const                  *B;                                            /* The first element of row pc, column jc of op(B). */
+    float                       *C;                                            /* The first element of column jc of C. */
+    float                       *PackedA;                                      /* The packed slivers of op(A), for all M rows. */
+    float                       *PackedB;                                      /* The packed slivers of op(B), for all NC columns. */
+    size_t                       RowStrideA;                                   /* The distance between consecutive rows of op(A), in elements. */
+    size_t                       ColStrideA;                                   /* The distance between consecutive columns of op(A), in elements. */
+    size_t                       RowStrideB;                                   /* The distance between consecutive rows of op(B), in elements. */
+    size_t                       ColStrideB;                                   /* The distance between consecutive columns of op(B), in elements. */
+    size_t                       Ldc;                                          /* The distance between the start of consecutive rows of C, in floats. */
+    float                        Alpha;                                        /* The scale applied to the product. */
+    float                        Beta;                                         /* The scale applied to C for this panel. */
+    uint32_t                     TypeA;                                        /* The storage format of A, one of the values of the CONVERT_TYPE enumeration. */
+    uint32_t                     TypeB;                                        /* The storage format of B, one of the values of the CONVERT_TYPE enumeration. */
+    uint32_t                     M;                                            /* The number of rows of C. */
+    uint32_t                     NC;                                           /* The number of columns in the panel. */
+    uint32_t                     KC;                                           /* The depth of the panel. */
+    uint32_t                     SliverCountB;                                 /* The number of NR-column slivers of op(B). */
+    uint32_t                     TileCountN;                                   /* The number of GEMM_TILE_N column tiles in the panel. */
+} GEMM_PARALLEL_ARGS;
+
+/* @summary The micro-kernel used by GemmF32, selected on first use or by GemmSelectKernel.
+ */
+static GEMM_MICROKERNEL_FUNC volatile Global_GemmMicroKernel = NULL;
+
+/* @summary Write a computed tile, or part of a tile, to C.
+ * @param acc The MR x NR tile of accumulated products, stored row-major.
+ * @param c The first element of the tile of C.
+ * @param ldc The distance between the start of consecutive rows of C, in floats.
+ * @param alpha The scale applied to the product.
+ * @param beta The scale applied to C. If zero, C is not read.
+ * @param mr The number of valid rows in the tile.
+ * @param nr The number of valid columns in the tile.
+ */
+static void
+GemmStoreTile
+(
+    float const * __restrict acc,
+    float       * __restrict   c,
+    size_t                   ldc,
+    float                  alpha,
+    float                   beta,
+    uint32_t                  mr,
+    uint32_t                  nr
+)
+{
+    uint32_t i, j;
+    for (i = 0; i < mr; ++i) {
+        float       *crow = c + (i * ldc);
+        float const *arow = acc + (i * GEMM_NR);
+        if (beta == 0.0f) {
+            for (j = 0; j < nr; ++j) {
+                crow[j] = alpha * arow[j];
+            }
+        } else {
+            for (j = 0; j < nr; ++j) {
+                crow[j] = (alpha * arow[j]) + (beta * crow[j]);
+            }
+        }
+    }
+}
+
+/* @summary Implement the micro-kernel in portable C.
+ */
+static void
+GemmMicroKernel_Scalar
+(
+    uint32_t                 kc,
+    float const * __restrict ap,
+    float const * __restrict bp,
+    float       * __restrict  c,
+    size_t                  ldc,
+    float                 alpha,
+    float                  beta,
+    uint32_t                 mr,
+    uint32_t                 nr
+)
+{
+    float    acc[GEMM_MR * GEMM_NR];
+    uint32_t p, i, j;
+
+    memset(acc, 0, sizeof(acc));
+    for (p = 0; p < kc; ++p) {
+        for (i = 0; i < GEMM_MR; ++i) {
+            float  av = ap[i];
+            float *ar = acc + (i * GEMM_NR);
+            for (j = 0; j < GEMM_NR; ++j) {
+                ar[j] += av * bp[j];
+            }
+        }
+        ap += GEMM_MR;
+        bp += GEMM_NR;
+    }
+    GemmStoreTile(acc, c, ldc, alpha, beta, mr, nr);
+}
+
+#if CPU_ARCH_X86
+/* @summary Implement the micro-kernel using AVX2 and FMA.
+ * Each of the six rows of the tile is held in two ymm accumulators; each step broadcasts one value of A per row
+ * and issues two FMAs against the 16 values of B.
+ */
+static CPU_TARGET("avx2,fma") void
+GemmMicroKernel_AVX2
+(
+    uint32_t                 kc,
+    float const * __restrict ap,
+    float const * __restrict bp,
+    float       * __restrict  c,
+    size_t                  ldc,
+    float                 alpha,
+    float                  beta,
+    uint32_t                 mr,
+    uint32_t                 nr
+)
+{
+    __m256 c00 = _mm256_setzero_ps(), c01 = _mm256_setzero_ps();
+    __m256 c10 = _mm256_setzero_ps(), c11 = _mm256_setzero_ps();
+    __m256 c20 = _mm256_setzero_ps(), c21 = _mm256_setzero_ps();
+    __m256 c30 = _mm256_setzero_ps(), c31 = _mm256_setzero_ps();
+    __m256 c40 = _mm256_setzero_ps(), c41 = _mm256_setzero_ps();
+    __m256 c50 = _mm256_setzero_ps(), c51 = _mm256_setzero_ps();
+    uint32_t p;
+
+#define GEMM_AVX2_STEP(_ap, _bp)                                               \
+    do {                                                                       \
+        __m256 b0 = _mm256_load_ps((_bp) + 0);                                 \
+        __m256 b1 = _mm256_load_ps((_bp) + 8);                                 \
+        __m256 av;                                                             \
+        av  = _mm256_broadcast_ss((_ap) + 0);                                  \
+        c00 = _mm256_fmadd_ps(av, b0, c00); c01 = _mm256_fmadd_ps(av, b1, c01); \
+        av  = _mm256_broadcast_ss((_ap) + 1);                                  \
+        c10 = _mm256_fmadd_ps(av, b0, c10); c11 = _mm256_fmadd_ps(av, b1, c11); \
+        av  = _mm256_broadcast_ss((_ap) + 2);                                  \
+        c20 = _mm256_fmadd_ps(av, b0, c20); c21 = _mm256_fmadd_ps(av, b1, c21); \
+        av  = _mm256_broadcast_ss((_ap) + 3);                                  \
+        c30 = _mm256_fmadd_ps(av, b0, c30); c31 = _mm256_fmadd_ps(av, b1, c31); \
+        av  = _mm256_broadcast_ss((_ap) + 4);                                  \
+        c40 = _mm256_fmadd_ps(av, b0, c40); c41 = _mm256_fmadd_ps(av, b1, c41); \
+        av  = _mm256_broadcast_ss((_ap) + 5);                                  \
+        c50 = _mm256_fmadd_ps(av, b0, c50); c51 = _mm256_fmadd_ps(av, b1, c51); \
+    } while (0)
+
+    /* unroll by four to amortize loop overhead against the 12 FMAs per step */
+    for (p = 0; p + 4 <= kc; p += 4) {
+        GEMM_AVX2_STEP(ap + 0 * GEMM_MR, bp + 0 * GEMM_NR);
+        GEMM_AVX2_STEP(ap + 1 * GEMM_MR, bp + 1 * GEMM_NR);
+        GEMM_AVX2_STEP(ap + 2 * GEMM_MR, bp + 2 * GEMM_NR);
+        GEMM_AVX2_STEP(ap + 3 * GEMM_MR, bp + 3 * GEMM_NR);
+        ap += 4 * GEMM_MR;
+        bp += 4 * GEMM_NR;
+    }
+    for ( ; p < kc; ++p) {
+        GEMM_AVX2_STEP(ap, bp);
+        ap += GEMM_MR;
+        bp += GEMM_NR;
+    }
+#undef  GEMM_AVX2_STEP
+
+    if (mr == GEMM_MR && nr == GEMM_NR) {
+        __m256 va = _mm256_set1_ps(alpha);
+        if (beta == 0.0f) {
+            _mm256_storeu_ps(c + 0 * ldc + 0, _mm256_mul_ps(va, c00)); _mm256_storeu_ps(c + 0 * ldc + 8, _mm256_mul_ps(va, c01));
+            _mm256_storeu_ps(c + 1 * ldc + 0, _mm256_mul_ps(va, c10)); _mm256_storeu_ps(c + 1 * ldc + 8, _mm256_mul_ps(va, c11));
+            _mm256_storeu_ps(c + 2 * ldc + 0, _mm256_mul_ps(va, c20)); _mm256_storeu_ps(c + 2 * ldc + 8, _mm256_mul_ps(va, c21));
+            _mm256_storeu_ps(c + 3 * ldc + 0, _mm256_mul_ps(va, c30)); _mm256_storeu_ps(c + 3 * ldc + 8, _mm256_mul_ps(va, c31));
+            _mm256_storeu_ps(c + 4 * ldc + 0, _mm256_mul_ps(va, c40)); _mm256_storeu_ps(c + 4 * ldc + 8, _mm256_mul_ps(va, c41));
+            _mm256_storeu_ps(c + 5 * ldc + 0, _mm256_mul_ps(va, c50)); _mm256_storeu_ps(c + 5 * ldc + 8, _mm256_mul_ps(va, c51));
+        } else {
+            __m256 vb = _mm256_set1_ps(beta);
+#define GEMM_AVX2_UPDATE(_row, _col, _acc)                                     \
+            _mm256_storeu_ps(c + (_row) * ldc + (_col), _mm256_fmadd_ps(va, (_acc), _mm256_mul_ps(vb, _mm256_loadu_ps(c + (_row) * ldc + (_col)))))
+            GEMM_AVX2_UPDATE(0, 0, c00); GEMM_AVX2_UPDATE(0, 8, c01);
+            GEMM_AVX2_UPDATE(1, 0, c10); GEMM_AVX2_UPDATE(1, 8, c11);
+            GEMM_AVX2_UPDATE(2, 0, c20); GEMM_AVX2_UPDATE(2, 8, c21);
+            GEMM_AVX2_UPDATE(3, 0, c30); GEMM_AVX2_UPDATE(3, 8, c31);
+            GEMM_AVX2_UPDATE(4, 0, c40); GEMM_AVX2_UPDATE(4, 8, c41);
+            GEMM_AVX2_UPDATE(5, 0, c50); GEMM_AVX2_UPDATE(5, 8, c51);
+#undef  GEMM_AVX2_UPDATE
+        }
+    } else {
+        float acc[GEMM_MR * GEMM_NR];
+        _mm256_storeu_ps(acc + 0 * GEMM_NR + 0, c00); _mm256_storeu_ps(acc + 0 * GEMM_NR + 8, c01);
+        _mm256_storeu_ps(acc + 1 * GEMM_NR + 0, c10); _mm256_storeu_ps(acc + 1 * GEMM_NR + 8, c11);
+        _mm256_storeu_ps(acc + 2 * GEMM_NR + 0, c20); _mm256_storeu_ps(acc + 2 * GEMM_NR + 8, c21);
+        _mm256_storeu_ps(acc + 3 * GEMM_NR + 0, c30); _mm256_storeu_ps(acc + 3 * GEMM_NR + 8, c31);
+        _mm256_storeu_ps(acc + 4 * GEMM_NR + 0, c40); _mm256_storeu_ps(acc + 4 * GEMM_NR + 8, c41);
+        _mm256_storeu_ps(acc + 5 * GEMM_NR + 0, c50); _mm256_storeu_ps(acc + 5 * GEMM_NR + 8, c51);
+        GemmStoreTile(acc, c, ldc, alpha, beta, mr, nr);
+    }
+}
+#endif /* CPU_ARCH_X86 */
+
+/* @summary Retrieve the micro-kernel implementation for a kernel identifier.
+ * @param kernel One of the values of the GEMM_KERNEL enumeration.
+ * @return The micro-kernel, or NULL if the kernel is not supported by the host CPU.
+ */
+static GEMM_MICROKERNEL_FUNC
+GemmMicroKernel
+(
+    uint32_t kernel
+)
+{
+#if CPU_ARCH_X86
+    uint32_t cpu = CpuFeatureFlags();
+#endif
+    switch (kernel) {
+        case GEMM_KERNEL_SCALAR:
+            return GemmMicroKernel_Scalar;
+#if CPU_ARCH_X86
+        case GEMM_KERNEL_AVX2:
+            return ((cpu & (CPU_FEATURE_AVX2 | CPU_FEATURE_FMA)) == (CPU_FEATURE_AVX2 | CPU_FEATURE_FMA)) ? GemmMicroKernel_AVX2 : NULL;
+#endif
+        default:
+            return NULL;
+    }
+}
+
+/* @summary Compute the address of an element of a matrix stored in any supported format.
+ * @param base The first element of the matrix.
+ * @param type One of the values of the CONVERT_TYPE enumeration.
+ * @param index The offset of the element from base, in elements.
+ * @return The address of the element.
+ */
+static inline void const*
+GemmElement
+(
+    void const *base,
+    uint32_t    type,
+    size_t     index
+)
+{
+    return (uint8_t const*) base + (index * (type == CONVERT_TYPE_F32 ? sizeof(float) : sizeof(uint16_t)));
+}
+
+/* @summary Pack an mc x kc block of op(A) into MR-row slivers, widening 16-bit elements to float32.
+ * Each run of contiguous source elements is widened with a single call to ConvertHalfToF32.
+ * @param dst The destination buffer, with space for AlignUp(mc, MR) * kc floats.
+ * @param a The first element of the block of op(A).
+ * @param type Either CONVERT_TYPE_BF16 or CONVERT_TYPE_F16.
+ * @param rsa The distance between consecutive rows of op(A), in elements.
+ * @param csa The distance between consecutive columns of op(A), in elements.
+ * @param mc The number of rows in the block.
+ * @param kc The number of columns in the block, at most GEMM_KC.
+ */
+static void
+GemmPackAHalf
+(
+    float          * __restrict dst,
+    uint16_t const * __restrict   a,
+    uint32_t                   type,
+    size_t                      rsa,
+    size_t                      csa,
+    uint32_t                     mc,
+    uint32_t                     kc
+)
+{
+    float    row[GEMM_KC];
+    uint32_t ir, p, i;
+    for (ir = 0; ir < mc; ir += GEMM_MR) {
+        uint32_t        mr = MinValue(mc - ir, (uint32_t) GEMM_MR);
+        uint16_t const *as = a + (ir * rsa);
+        if (rsa == 1) {
+            /* the MR values of each column are contiguous */
+            for (p = 0; p < kc; ++p) {
+                ConvertHalfToF32(dst, as + (p * csa), mr, type);
+                for (i = mr; i < GEMM_MR; ++i) {
+                    dst[i] = 0.0f;
+                }
+                dst += GEMM_MR;
+            }
+            continue;
+        }
+        for (i = 0; i < mr; ++i) {
+            if (csa == 1) {
+                ConvertHalfToF32(row, as + (i * rsa), kc, type);
+            } else for (p = 0; p < kc; ++p) {
+                ConvertHalfToF32(row + p, as + (i * rsa) + (p * csa), 1, type);
+            }
+            for (p = 0; p < kc; ++p) {
+                dst[(p * GEMM_MR) + i] = row[p];
+            }
+        }
+        for ( ; i < GEMM_MR; ++i) {
+            for (p = 0; p < kc; ++p) {
+                dst[(p * GEMM_MR) + i] = 0.0f;
+            }
+        }
+        dst += kc * GEMM_MR;
+    }
+}
+
+/* @summary Pack an mc x kc block of op(A) into MR-row slivers.
+ * Within each sliver, the MR values of each column are contiguous. Rows past mc are zero-filled.
+ * @param dst The destination buffer, with space for AlignUp(mc, MR) * kc floats.
+ * @param a The first element of the block of op(A).
+ * @param type The storage format of A, one of the values of the CONVERT_TYPE enumeration.
+ * @param rsa The distance between consecutive rows of op(A), in elements.
+ * @param csa The distance between consecutive columns of op(A), in elements.
+ * @param mc The number of rows in the block.
+ * @param kc The number of columns in the block.
+ */
+static void
+GemmPackA
+(
+    float       * __restrict dst,
+    void const  * __restrict src,
+    uint32_t                type,
+    size_t                   rsa,
+    size_t                   csa,
+    uint32_t                  mc,
+    uint32_t                  kc
+)
+{
+    float const *a = (float const*) src;
+    uint32_t ir, p, i;
+    if (type != CONVERT_TYPE_F32) {
+        GemmPackAHalf(dst, (uint16_t const*) src, type, rsa, csa, mc, kc);
+        return;
+    }
+    for (ir = 0; ir < mc; ir += GEMM_MR) {
+        uint32_t     mr = MinValue(mc - ir, (uint32_t) GEMM_MR);
+        float const *as = a + (ir * rsa);
+        for (p = 0; p < kc; ++p) {
+            for (i = 0; i < mr; ++i) {
+                dst[i] = as[(i * rsa) + (p * csa)];
+            }
+            for ( ; i < GEMM_MR; ++i) {
+                dst[i] = 0.0f;
+            }
+            dst += GEMM_MR;
+        }
+    }
+}
+
+/* @summary Pack a kc x nc panel of op(B) into NR-column slivers, widening 16-bit elements to float32.
+ * Each run of contiguous source elements is widened with a single call to ConvertHalfToF32.
+ * @param dst The destination buffer, with space for kc * AlignUp(nc, NR) floats.
+ * @param b The first element of the panel of op(B).
+ * @param type Either CONVERT_TYPE_BF16 or CONVERT_TYPE_F16.
+ * @param rsb The distance between consecutive rows of op(B), in elements.
+ * @param csb The distance between consecutive columns of op(B), in elements.
+ * @param kc The number of rows in the panel, at most GEMM_KC.
+ * @param nc The number of columns in the panel.
+ */
+static void
+GemmPackBHalf
+(
+    float          * __restrict dst,
+    uint16_t const * __restrict   b,
+    uint32_t                   type,
+    size_t                      rsb,
+    size_t                      csb,
+    uint32_t                     kc,
+    uint32_t                     nc
+)
+{
+    float    col[GEMM_KC];
+    uint32_t jr, p, j;
+    for (jr = 0; jr < nc; jr += GEMM_NR) {
+        uint32_t        nr = MinValue(nc - jr, (uint32_t) GEMM_NR);
+        uint16_t const *bs = b + (jr * csb);
+        if (csb == 1) {
+            /* rows of the sliver are contiguous in memory */
+            for (p = 0; p < kc; ++p) {
+                ConvertHalfToF32(dst + (p * GEMM_NR), bs + (p * rsb), nr, type);
+                for (j = nr; j < GEMM_NR; ++j) {
+                    dst[(p * GEMM_NR) + j] = 0.0f;
+                }
+            }
+        } else {
+            for (j = 0; j < nr; ++j) {
+                if (rsb == 1) {
+                    /* columns of the sliver are contiguous in memory */
+                    ConvertHalfToF32(col, bs + (j * csb), kc, type);
+                } else for (p = 0; p < kc; ++p) {
+                    ConvertHalfToF32(col + p, bs + (j * csb) + (p * rsb), 1, type);
+                }
+                for (p = 0; p < kc; ++p) {
+                    dst[(p * GEMM_NR) + j] = col[p];
+                }
+            }
+            for (p = 0; p < kc; ++p) {
+                for (j = nr; j < GEMM_NR; ++j) {
+                    dst[(p * GEMM_NR) + j] = 0.0f;
+                }
+            }
+        }
+        dst += kc * GEMM_NR;
+    }
+}
+
+/* @summary Pack a kc x nc panel of op(B) into NR-column slivers.
+ * Within each sliver, the NR values of each row are contiguous. Columns past nc are zero-filled.
+ * @param dst The destination buffer, with space for kc * AlignUp(nc, NR) floats.
+ * @param b The first element of the panel of op(B).
+ * @param type The storage format of B, one of the values of the CONVERT_TYPE enumeration.
+ * @param rsb The distance between consecutive rows of op(B), in elements.
+ * @param csb The distance between consecutive columns of op(B), in elements.
+ * @param kc The number of rows in the panel.
+ * @param nc The number of columns in the panel.
+ */
+static void
+GemmPackB
+(
+    float       * __restrict dst,
+    void const  * __restrict src,
+    uint32_t                type,
+    size_t                   rsb,
+    size_t                   csb,
+    uint32_t                  kc,
+    uint32_t                  nc
+)
+{
+    float const *b = (float const*) src;
+    uint32_t jr, p, j;
+    if (type != CONVERT_TYPE_F32) {
+        GemmPackBHalf(dst, (uint16_t const*) src, type, rsb, csb, kc, nc);
+        return;
+    }
+    for (jr = 0; jr < nc; jr += GEMM_NR) {
+        uint32_t     nr = MinValue(nc - jr, (uint32_t) GEMM_NR);
+        float const *bs = b + (jr * csb);
+        if (csb == 1 && nr == GEMM_NR) {
+            /* rows of the sliver are contiguous in memory */
+            for (p = 0; p < kc; ++p) {
+                memcpy(dst + (p * GEMM_NR), bs + (p * rsb), GEMM_NR * sizeof(float));
+            }
+        } else if (rsb == 1) {
+            /* columns of the sliver are contiguous in memory; read them sequentially */
+            for (j = 0; j < nr; ++j) {
+                for (p = 0; p < kc; ++p) {
+                    dst[(p * GEMM_NR) + j] = bs[(j * csb) + p];
+                }
+            }
+            for (p = 0; p < kc; ++p) {
+                for (j = nr; j < GEMM_NR; ++j) {
+                    dst[(p * GEMM_NR) + j] = 0.0f;
+                }
+            }
+        } else {
+            for (p = 0; p < kc; ++p) {
+                for (j = 0; j < nr; ++j) {
+                    dst[(p * GEMM_NR) + j] = bs[(p * rsb) + (j * csb)];
+                }
+                for ( ; j < GEMM_NR; ++j) {
+                    dst[(p * GEMM_NR) + j] = 0.0f;
+                }
+            }
+        }
+        dst += kc * GEMM_NR;
+    }
+}
+
+/* @summary Compute C = beta * C for an m x n matrix. If beta is zero, C is cleared without being read.
+ */
+static void
+GemmScaleC
+(
+    uint32_t    m,
+    uint32_t    n,
+    float    beta,
+    float      *c,
+    uint32_t  ldc
+)
+{
+    uint32_t i, j;
+    for (i = 0; i < m; ++i) {
+        float *crow = c + ((size_t) i * ldc);
+        if (beta == 0.0f) {
+            memset(crow, 0, n * sizeof(float));
+        } else if (beta != 1.0f) {
+            for (j = 0; j < n; ++j) {
+                crow[j] *= beta;
+            }
+        }
+    }
+}
+
+/* @summary Compute C = alpha * op(A) * op(B) + beta * C on the calling thread, with A and B stored in any supported format.
+ * Arguments are the same as for GemmMixedParallel, without the task pool.
+ */
+static int
+GemmSerial
+(
+    uint32_t            type_a,
+    uint32_t           trans_a,
+    uint32_t            type_b,
+    uint32_t           trans_b,
+    uint32_t                 m,
+    uint32_t                 n,
+    uint32_t                 k,
+    float                alpha,
+    void const              *a,
+    uint32_t               lda,
+    void const              *b,
+    uint32_t               ldb,
+    float                 beta,
+    float                   *c,
+    uint32_t               ldc,
+    float           *workspace
+)
+{
+    GEMM_MICROKERNEL_FUNC kernel = Global_GemmMicroKernel;
+    void                  *alloc = NULL;
+    float                    *pa = NULL;
+    float                    *pb = NULL;
+    size_t const             rsa = trans_a ? 1   : lda;
+    size_t const             csa = trans_a ? lda : 1;
+    size_t const             rsb = trans_b ? 1   : ldb;
+    size_t const             csb = trans_b ? ldb : 1;
+    uint32_t        jc, pc, ic, jr, ir;
+
+    if (m == 0 || n == 0) {
+        return 0;
+    }
+    if (k == 0 || alpha == 0.0f) {
+        GemmScaleC(m, n, beta, c, ldc);
+        return 0;
+    }
+    if (kernel == NULL) {
+        uint32_t id = GEMM_KERNEL_COUNT;
+        while (kernel == NULL && id-- > 0) {
+            kernel = GemmMicroKernel(id);
+        }
+        Global_GemmMicroKernel = kernel;
+    }
+    if (workspace == NULL) {
+        if ((alloc = malloc((GEMM_WORKSPACE_FLOATS * sizeof(float)) + GEMM_ALIGNMENT)) == NULL) {
+            errno = ENOMEM;
+            return -1;
+        }
+        workspace = (float*) AlignUp((uintptr_t) alloc, (uintptr_t) GEMM_ALIGNMENT);
+    }
+    pb = workspace;
+    pa = workspace + (GEMM_KC * GEMM_NC);
+
+    for (jc = 0; jc < n; jc += GEMM_NC) {
+        uint32_t nc = MinValue(n - jc, (uint32_t) GEMM_NC);
+        for (pc = 0; pc < k; pc += GEMM_KC) {
+            uint32_t  kc = MinValue(k - pc, (uint32_t) GEMM_KC);
+            float  beta_ = (pc == 0) ? beta : 1.0f;
+            GemmPackB(pb, GemmElement(b, type_b, (pc * rsb) + (jc * csb)), type_b, rsb, csb, kc, nc);
+            for (ic = 0; ic < m; ic += GEMM_MC) {
+                uint32_t mc = MinValue(m - ic, (uint32_t) GEMM_MC);
+                GemmPackA(pa, GemmElement(a, type_a, (ic * rsa) + (pc * csa)), type_a, rsa, csa, mc, kc);
+                for (jr = 0; jr < nc; jr += GEMM_NR) {
+                    uint32_t     nr = MinValue(nc - jr, (uint32_t) GEMM_NR);
+                    float const *bs = pb + ((size_t) jr * kc);
+                    for (ir = 0; ir < mc; ir += GEMM_MR) {
+                        uint32_t mr = MinValue(mc - ir, (uint32_t) GEMM_MR);
+                        float   *ct = c + ((size_t)(ic + ir) * ldc) + (jc + jr);
+                        kernel(kc, pa + ((size_t) ir * kc), bs, ct, ldc, alpha, beta_, mr, nr);
+                    }
+                }
+            }
+        }
+    }
+    free(alloc);
+    return 0;
+}
+
+MNIST_API(int)
+GemmF32
+(
+    uint32_t           trans_a,
+    uint32_t           trans_b,
+    uint32_t                 m,
+    uint32_t                 n,
+    uint32_t                 k,
+    float                alpha,
+    float const             *a,
+    uint32_t               lda,
+    float const             *b,
+    uint32_t               ldb,
+    float                 beta,
+    float                   *c,
+    uint32_t               ldc,
+    float           *workspace
+)
+{
+    return GemmSerial(CONVERT_TYPE_F32, trans_a, CONVERT_TYPE_F32, trans_b, m, n, k, alpha, a, lda, b, ldb, beta, c, ldc, workspace);
+}
+
+/* @summary Pack a range of slivers of op(A) and op(B) for a parallel GEMM. Indices below SliverCountB identify slivers of B; the rest identify slivers of A.
+ * @param argp Pointer to the GEMM_PARALLEL_ARGS.
+ * @param begin The first sliver index.
+ * @param end One past the last sliver index.
+ * @param thread_index The index of the calling thread. Unused.
+ */
+static void
+GemmParallelPack
+(
+    void          *argp,
+    uint32_t      begin,
+    uint32_t        end,
+    uint32_t thread_index
+)
+{
+    GEMM_PARALLEL_ARGS const *args = (GEMM_PARALLEL_ARGS const*) argp;
+    uint32_t i;
+
+    (void) thread_index;
+    for (i = begin; i < end; ++i) {
+        if (i < args->SliverCountB) {
+            uint32_t jr = i * GEMM_NR;
+            GemmPackB(args->PackedB + ((size_t) jr * args->KC), GemmElement(args->B, args->TypeB, jr * args->ColStrideB), args->TypeB,
+                      args->RowStrideB, args->ColStrideB, args->KC, MinValue(args->NC - jr, (uint32_t) GEMM_NR));
+        } else {
+            uint32_t ir = (i - args->SliverCountB) * GEMM_MR;
+            GemmPackA(args->PackedA + ((size_t) ir * args->KC), GemmElement(args->A, args->TypeA, ir * args->RowStrideA), args->TypeA,
+                      args->RowStrideA, args->ColStrideA, MinValue(args->M - ir, (uint32_t) GEMM_MR), args->KC);
+        }
+    }
+}
+
+/* @summary Compute a range of GEMM_TILE_M x GEMM_TILE_N tiles of C for a parallel GEMM. Tiles are numbered in row-major order.
+ * @param argp Pointer to the GEMM_PARALLEL_ARGS.
+ * @param begin The first tile index.
+ * @param end One past the last tile index.
+ * @param thread_index The index of the calling thread. Unused.
+ */
+static void
+GemmParallelCompute
+(
+    void          *argp,
+    uint32_t      begin,
+    uint32_t        end,
+    uint32_t thread_index
+)
+{
+    GEMM_PARALLEL_ARGS const *args = (GEMM_PARALLEL_ARGS const*) argp;
+    uint32_t t, ir, jr;
+
+    (void) thread_index;
+    for (t = begin; t < end; ++t) {
+        uint32_t i0 = (t / args->TileCountN) * GEMM_TILE_M;
+        uint32_t j0 = (t % args->TileCountN) * GEMM_TILE_N;
+        uint32_t i1 = MinValue(i0 + GEMM_TILE_M, args->M);
+        uint32_t j1 = MinValue(j0 + GEMM_TILE_N, args->NC);
+        for (jr = j0; jr < j1; jr += GEMM_NR) {
+            uint32_t     nr = MinValue(j1 - jr, (uint32_t) GEMM_NR);
+            float const *bs = args->PackedB + ((size_t) jr * args->KC);
+            for (ir = i0; ir < i1; ir += GEMM_MR) {
+                uint32_t mr = MinValue(i1 - ir, (uint32_t) GEMM_MR);
+                args->Kernel(args->KC, args->PackedA + ((size_t) ir * args->KC), bs, args->C + (ir * args->Ldc) + jr,
+                             args->Ldc, args->Alpha, args->Beta, mr, nr);
+            }
+        }
+    }
+}
+
+MNIST_API(int)
+GemmMixedParallel
+(
+    struct TASK_POOL     *pool,
+    uint32_t            type_a,
+    uint32_t           trans_a,
+    uint32_t            type_b,
+    uint32_t           trans_b,
+    uint32_t                 m,
+    uint32_t                 n,
+    uint32_t                 k,
+    float                alpha,
+    void const              *a,
+    uint32_t               lda,
+    void const              *b,
+    uint32_t               ldb,
+    float                 beta,
+    float                   *c,
+    uint32_t               ldc,
+    float           *workspace
+)
+{
+    GEMM_PARALLEL_ARGS args;
+    void             *alloc = NULL;
+    uint32_t        jc, pc;
+
+    if (TaskPoolThreadCount(pool) <= 1) {
+        return GemmSerial(type_a, trans_a, type_b, trans_b, m, n, k, alpha, a, lda, b, ldb, beta, c, ldc, workspace);
+    }
+    if (m == 0 || n == 0) {
+        return 0;
+    }
+    if (k == 0 || alpha == 0.0f) {
+        GemmScaleC(m, n, beta, c, ldc);
+        return 0;
+    }
+    if (Global_GemmMicroKernel == NULL) {
+        uint32_t id = GEMM_KERNEL_COUNT;
+        while (Global_GemmMicroKernel == NULL && id-- > 0) {
+            Global_GemmMicroKernel = GemmMicroKernel(id);
+        }
+    }
+    if (workspace == NULL) {
+        if ((alloc = malloc((GEMM_PARALLEL_WORKSPACE_FLOATS(m) * sizeof(float)) + GEMM_ALIGNMENT)) == NULL) {
+            errno = ENOMEM;
+            return -1;
+        }
+        workspace = (float*) AlignUp((uintptr_t) alloc, (uintptr_t) GEMM_ALIGNMENT);
+    }
+    args.Kernel     = Global_GemmMicroKernel;
+    args.PackedB    = workspace;
+    args.PackedA    = workspace + (GEMM_KC * GEMM_NC);
+    args.RowStrideA = trans_a ? 1   : lda;
+    args.ColStrideA = trans_a ? lda : 1;
+    args.RowStrideB = trans_b ? 1   : ldb;
+    args.ColStrideB = trans_b ? ldb : 1;
+    args.Ldc        = ldc;
+    args.Alpha      = alpha;
+    args.TypeA      = type_a;
+    args.TypeB      = type_b;
+    args.M          = m;
+
+    for (jc = 0; jc < n; jc += GEMM_NC) {
+        args.NC           = MinValue(n - jc, (uint32_t) GEMM_NC);
+        args.C            = c + jc;
+        args.SliverCountB = (args.NC + GEMM_NR - 1) / GEMM_NR;
+        args.TileCountN   = (args.NC + GEMM_TILE_N - 1) / GEMM_TILE_N;
+        for (pc = 0; pc < k; pc += GEMM_KC) {
+            uint32_t nsliver = args.SliverCountB + ((m + GEMM_MR - 1) / GEMM_MR);
+            uint32_t   ntile = ((m + GEMM_TILE_M - 1) / GEMM_TILE_M) * args.TileCountN;
+            args.KC   = MinValue(k - pc, (uint32_t) GEMM_KC);
+            args.Beta = (pc == 0) ? beta : 1.0f;
+            args.A    = GemmElement(a, type_a, pc * args.ColStrideA);
+            args.B    = GemmElement(b, type_b, (pc * args.RowStrideB) + (jc * args.ColStrideB));
+            TaskPoolParallelFor(pool, nsliver, 4, GemmParallelPack, &args);
+            TaskPoolParallelFor(pool, ntile  , 1, GemmParallelCompute, &args);
+        }
+    }
+    free(alloc);
+    return 0;
+}
+
+MNIST_API(int)
+GemmF32Parallel
+(
+    struct TASK_POOL     *pool,
+    uint32_t           trans_a,
+    uint32_t           trans_b,
+    uint32_t                 m,
+    uint32_t                 n,
+    uint32_t                 k,
+    float                alpha,
+    float const             *a,
+    uint32_t               lda,
+    float const             *b,
+    uint32_t               ldb,
+    float                 beta,
+    float                   *c,
+    uint32_t               ldc,
+    float           *workspace
+)
+{
+    return GemmMixedParallel(pool, CONVERT_TYPE_F32, trans_a, CONVERT_TYPE_F32, trans_b, m, n, k, alpha, a, lda, b, ldb, beta, c, ldc, workspace);
+}
+
+MNIST_API(int)
+GemmSelectKernel
+(
+    uint32_t kernel
+)
+{
+    GEMM_MICROKERNEL_FUNC func = GemmMicroKernel(kernel);
+    if (func == NULL) {
+        errno = ENOTSUP;
+        return -1;
+    }
+    Global_GemmMicroKernel = func;
+    return 0;
+}
+
+MNIST_API(char const*)
+GemmKernelName
+(
+    uint32_t kernel
+)
+{
+    switch (kernel) {
+        case GEMM_KERNEL_SCALAR: return "scalar";
+        case GEMM_KERNEL_AVX2  : return "avx2";
+        default                : return "unknown";
+    }
+}
+
@@ -0,0 +1,456 @@
+/**
+ * @summary Implement the functions exported by the idxfile.h module for
+ * validating and accessing memory-mapped IDX files.
+ */
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+#include <errno.h>
+
+#include "cpuinfo.h"
+#include "filemap.h"
+#include "idxfile.h"
+
+#if CPU_ARCH_X86
+#include <immintrin.h>
+#endif
+
+/* @summary Define IDX_HOST_IS_BIG_ENDIAN to 1 if the host stores multi-byte values MSB first, in which case IDX element data needs no conversion.
+ */
+#ifndef IDX_HOST_IS_BIG_ENDIAN
+#   if defined(__BYTE_ORDER__) && (__BYTE_ORDER__ == __ORDER_BIG_ENDIAN__)
+#       define IDX_HOST_IS_BIG_ENDIAN     1
+#   else
+#       define IDX_HOST_IS_BIG_ENDIAN     0
+#   endif
+#endif
+
+/* @summary Define the size of the staging buffer used when converting element data for IdxFileWrite, in bytes.
+ */
+#ifndef IDX_WRITE_CHUNK_SIZE
+#define IDX_WRITE_CHUNK_SIZE          (64 * 1024)
+#endif
+
+/* @summary Load a 32-bit unsigned integer stored MSB first.
+ * @param p A pointer to the first byte of the value. The address need not be aligned.
+ * @return The value in host byte order.
+ */
+static inline uint32_t
+LoadBigEndianU32
+(
+    void const *p
+)
+{
+    uint8_t const *b = (uint8_t const*) p;
+    return ((uint32_t) b[0] << 24) | ((uint32_t) b[1] << 16) | ((uint32_t) b[2] << 8) | (uint32_t) b[3];
+}
+
+/* @summary Store a 32-bit unsigned integer MSB first.
+ * @param p A pointer to the first byte of the destination. The address need not be aligned.
+ * @param v The value to store, in host byte order.
+ */
+static inline void
+StoreBigEndianU32
+(
+    void     *p,
+    uint32_t  v
+)
+{
+    uint8_t *b = (uint8_t*) p;
+    b[0] = (uint8_t)(v >> 24); b[1] = (uint8_t)(v >> 16);
+    b[2] = (uint8_t)(v >>  8); b[3] = (uint8_t)(v >>  0);
+}
+
+/* @summary Reverse the byte order of each element in a buffer, one element at a time.
+ * @param dst The destination buffer.
+ * @param src The source buffer.
+ * @param count The number of elements to convert.
+ * @param element_size The size of a single element, in bytes.
+ */
+static void
+SwapBytes_Scalar
+(
+    uint8_t       * __restrict dst,
+    uint8_t const * __restrict src,
+    size_t                   count,
+    uint32_t          element_size
+)
+{
+    size_t   i;
+    uint32_t j;
+    for (i = 0; i < count; ++i) {
+        for (j = 0; j < element_size; ++j) {
+            dst[j] = src[element_size - 1 - j];
+        }
+        dst += element_size;
+        src += element_size;
+    }
+}
+
+#if CPU_ARCH_X86
+/* @summary Build a pshufb control mask that reverses the bytes within each element of a 128-bit lane.
+ * @param element_size The size of a single element, in bytes. Must be 2, 4 or 8.
+ * @param o_mask An array of 16 bytes that on return stores the shuffle control mask.
+ */
+static void
+SwapBytesShuffleMask
+(
+    uint8_t  *o_mask,
+    uint32_t  element_size
+)
+{
+    uint32_t i;
+    for (i = 0; i < 16; ++i) {
+        uint32_t base = i - (i % element_size);
+        o_mask[i] = (uint8_t)(base + (element_size - 1 - (i % element_size)));
+    }
+}
+
+/* @summary Reverse the byte order of each element in a buffer, 16 bytes at a time, using SSSE3 pshufb.
+ * @param dst The destination buffer.
+ * @param src The source buffer.
+ * @param count The number of elements to convert.
+ * @param element_size The size of a single element, in bytes. Must be 2, 4 or 8.
+ */
+static CPU_TARGET("ssse3") void
+SwapBytes_SSSE3
+(
+    uint8_t       * __restrict dst,
+    uint8_t const * __restrict src,
+    size_t                   count,
+    uint32_t          element_size
+)
+{
+    uint8_t mask[16];
+    size_t  nbytes = count * element_size;
+    size_t  nvec   = nbytes & ~(size_t) 15;
+    size_t  i;
+    __m128i shuf;
+
+    SwapBytesShuffleMask(mask, element_size);
+    shuf = _mm_loadu_si128((__m128i const*) mask);
+    for (i = 0; i < nvec; i += 16) {
+        __m128i v = _mm_loadu_si128((__m128i const*)(src + i));
+        _mm_storeu_si128((__m128i*)(dst + i), _mm_shuffle_epi8(v, shuf));
+    }
+    SwapBytes_Scalar(dst + nvec, src + nvec, (nbytes - nvec) / element_size, element_size);
+}
+
+/* @summary Reverse the byte order of each element in a buffer, 64 bytes per iteration, using AVX2 vpshufb.
+ * vpshufb shuffles within 128-bit lanes, which is sufficient because no element straddles a lane boundary.
+ * @param dst The destination buffer.
+ * @param src The source buffer.
+ * @param count The number of elements to convert.
+ * @param element_size The size of a single element, in bytes. Must be 2, 4 or 8.
+ */
+static CPU_TARGET("avx2") void
+SwapBytes_AVX2
+(
+    uint8_t       * __restrict dst,
+    uint8_t const * __restrict src,
+    size_t                   count,
+    uint32_t          element_size
+)
+{
+    uint8_t mask[16];
+    size_t  nbytes = count * element_size;
+    size_t  nvec   = nbytes & ~(size_t) 63;
+    size_t  nrem   = 0;
+    size_t  i;
+    __m256i shuf;
+
+    SwapBytesShuffleMask(mask, element_size);
+    shuf = _mm256_broadcastsi128_si256(_mm_loadu_si128((__m128i const*) mask));
+    for (i = 0; i < nvec; i += 64) {
+        __m256i a = _mm256_loadu_si256((__m256i const*)(src + i));
+        __m256i b = _mm256_loadu_si256((__m256i const*)(src + i + 32));
+        _mm256_storeu_si256((__m256i*)(dst + i     ), _mm256_shuffle_epi8(a, shuf));
+        _mm256_storeu_si256((__m256i*)(dst + i + 32), _mm256_shuffle_epi8(b, shuf));
+    }
+    nrem = nbytes - nvec;
+    if (nrem > 0) {
+        SwapBytes_SSSE3(dst + nvec, src + nvec, nrem / element_size, element_size);
+    }
+}
+#endif /* CPU_ARCH_X86 */
+
+MNIST_API(uint32_t)
+IdxElementSize
+(
+    uint32_t type_code
+)
+{
+    switch (type_code) {
+        case IDX_TYPE_U8 : return 1;
+        case IDX_TYPE_I8 : return 1;
+        case IDX_TYPE_I16: return 2;
+        case IDX_TYPE_I32: return 4;
+        case IDX_TYPE_F32: return 4;
+        case IDX_TYPE_F64: return 8;
+        default          : return 0;
+    }
+}
+
+MNIST_API(int)
+IdxHeaderParse
+(
+    struct IDX_HEADER *o_header,
+    void const             *buf,
+    size_t             buf_size
+)
+{
+    uint8_t const *p = (uint8_t const*) buf;
+    uint64_t   count = 1;
+    uint32_t   esize = 0;
+    uint32_t   ndims = 0;
+    uint32_t   hsize = 0;
+    uint32_t       i;
+
+    assert(o_header != NULL);
+    memset(o_header, 0, sizeof(IDX_HEADER));
+
+    if (p == NULL || buf_size < IDX_MIN_HEADER_SIZE) {
+        errno = EINVAL;
+        return -1;
+    }
+    /* the first two bytes of the magic number are always zero */
+    if (p[0] != 0 || p[1] != 0) {
+        errno = EINVAL;
+        return -1;
+    }
+    if ((esize = IdxElementSize(p[2])) == 0) {
+        errno = EINVAL;
+        return -1;
+    }
+    if ((ndims = p[3]) == 0) {
+        errno = EINVAL;
+        return -1;
+    }
+    hsize = 4 + (ndims * 4);
+    if (buf_size < hsize) {
+        errno = EINVAL;
+        return -1;
+    }
+    for (i = 0; i < ndims; ++i) {
+        uint32_t dim = LoadBigEndianU32(p + 4 + (i * 4));
+        if (dim != 0 && count > (UINT64_MAX / esize) / dim) {
+            errno = EOVERFLOW;
+            return -1;
+        }
+        o_header->Dimensions[i] = dim;
+        count *= dim;
+    }
+    /* the file must contain at least as much data as the header describes */
+    if ((buf_size - hsize) < (count * esize)) {
+        errno = EINVAL;
+        return -1;
+    }
+    o_header->TypeCode       = p[2];
+    o_header->ElementSize    = esize;
+    o_header->DimensionCount = ndims;
+    o_header->HeaderSize     = hsize;
+    o_header->ElementCount   = count;
+    o_header->DataSize       = count * esize;
+    return 0;
+}
+
+MNIST_API(int)
+IdxFileOpen
+(
+    struct IDX_FILE *o_file,
+    char const        *path,
+    uint32_t          hints
+)
+{
+    int err;
+
+    assert(o_file != NULL);
+    memset(o_file, 0, sizeof(IDX_FILE));
+
+    if (FileMappingOpen(&o_file->Mapping, path, hints) != 0) {
+        return -1;
+    }
+    if (IdxHeaderParse(&o_file->Header, o_file->Mapping.Base, o_file->Mapping.Size) != 0) {
+        err = errno;
+        FileMappingClose(&o_file->Mapping);
+        memset(o_file, 0, sizeof(IDX_FILE));
+        errno = err;
+        return -1;
+    }
+    o_file->Data = ((uint8_t const*) o_file->Mapping.Base) + o_file->Header.HeaderSize;
+    return 0;
+}
+
+MNIST_API(void)
+IdxFileClose
+(
+    struct IDX_FILE *file
+)
+{
+    if (file != NULL) {
+        FileMappingClose(&file->Mapping);
+        memset(file, 0, sizeof(IDX_FILE));
+    }
+}
+
+MNIST_API(uint8_t const*)
+IdxFileDataU8
+(
+    struct IDX_FILE const *file
+)
+{
+    if (file != NULL && file->Header.TypeCode == IDX_TYPE_U8) {
+        return (uint8_t const*) file->Data;
+    }
+    return NULL;
+}
+
+MNIST_API(void)
+IdxSwapToHost
+(
+    void       * __restrict dst,
+    void const * __restrict src,
+    size_t                count,
+    uint32_t       element_size
+)
+{
+    uint8_t       *d = (uint8_t      *) dst;
+    uint8_t const *s = (uint8_t const*) src;
+
+    assert(element_size == 1 || element_size == 2 || element_size == 4 || element_size == 8);
+
+    if (element_size == 1 || IDX_HOST_IS_BIG_ENDIAN) {
+        memcpy(d, s, count * element_size);
+        return;
+    }
+#if CPU_ARCH_X86
+    {
+        uint32_t cpu = CpuFeatureFlags();
+        if (cpu & CPU_FEATURE_AVX2) {
+            SwapBytes_AVX2(d, s, count, element_size);
+            return;
+        }
+        if (cpu & CPU_FEATURE_SSSE3) {
+            SwapBytes_SSSE3(d, s, count, element_size);
+            return;
+        }
+    }
+#endif
+    SwapBytes_Scalar(d, s, count, element_size);
+}
+
+MNIST_API(int)
+IdxFileRead
+(
+    struct IDX_FILE const *file,
+    void                   *dst,
+    uint64_t              first,
+    uint64_t              count
+)
+{
+    uint32_t esize;
+
+    if (file == NULL || file->Data == NULL || (dst == NULL && count > 0)) {
+        errno = EINVAL;
+        return -1;
+    }
+    if (first > file->Header.ElementCount || count > (file->Header.ElementCount - first)) {
+        errno = ERANGE;
+        return -1;
+    }
+    esize = file->Header.ElementSize;
+    IdxSwapToHost(dst, ((uint8_t const*) file->Data) + (first * esize), (size_t) count, esize);
+    return 0;
+}
+
+MNIST_API(int)
+IdxFileWrite
+(
+    char const            *path,
+    uint32_t          type_code,
+    uint32_t    dimension_count,
+    uint32_t const  *dimensions,
+    void const            *data
+)
+{
+    uint8_t           header[4 + (IDX_MAX_DIMENSIONS * 4)];
+    uint8_t           *chunk = NULL;
+    uint8_t const       *src = (uint8_t const*) data;
+    uint64_t           count = 1;
+    uint64_t       remaining = 0;
+    size_t       chunk_elems = 0;
+    uint32_t           esize = IdxElementSize(type_code);
+    FILE                 *fp = NULL;
+    int                  err = 0;
+    uint32_t               i;
+
+    if (path == NULL || esize == 0 || dimension_count == 0 || dimension_count > IDX_MAX_DIMENSIONS || dimensions == NULL) {
+        errno = EINVAL;
+        return -1;
+    }
+    for (i = 0; i < dimension_count; ++i) {
+        if (dimensions[i] != 0 && count > (UINT64_MAX / esize) / dimensions[i]) {
+            errno = EOVERFLOW;
+            return -1;
+        }
+        count *= dimensions[i];
+    }
+    if (data == NULL && count > 0) {
+        errno = EINVAL;
+        return -1;
+    }
+
+    header[0] = 0;
+    header[1] = 0;
+    header[2] =(uint8_t) type_code;
+    header[3] =(uint8_t) dimension_count;
+    for (i = 0; i < dimension_count; ++i) {
+        StoreBigEndianU32(&header[4 + (i * 4)], dimensions[i]);
+    }
+    if (esize > 1 && !IDX_HOST_IS_BIG_ENDIAN) {
+        if ((chunk = (uint8_t*) malloc(IDX_WRITE_CHUNK_SIZE)) == NULL) {
+            return -1;
+        }
+    }
+    if ((fp = fopen(path, "wb")) == NULL) {
+        goto cleanup_and_fail;
+    }
+    if (fwrite(header, 1, 4 + (dimension_count * 4), fp) != 4 + (dimension_count * 4)) {
+        goto cleanup_and_fail;
+    }
+    if (chunk == NULL) { /* no conversion required - write directly from the source buffer */
+        if (count > 0 && fwrite(src, esize, (size_t) count, fp) != (size_t) count) {
+            goto cleanup_and_fail;
+        }
+    } else {
+        chunk_elems = IDX_WRITE_CHUNK_SIZE / esize;
+        for (remaining = count; remaining > 0; ) {
+            size_t n = remaining < chunk_elems ? (size_t) remaining : chunk_elems;
+            IdxSwapToHost(chunk, src, n, esize);
+            if (fwrite(chunk, esize, n, fp) != n) {
+                goto cleanup_and_fail;
+            }
+            src       += n * esize;
+            remaining -= n;
+        }
+    }
+    if (fclose(fp) != 0) {
+        fp = NULL;
+        goto cleanup_and_fail;
+    }
+    free(chunk);
+    return 0;
+
+cleanup_and_fail:
+    err = errno ? errno : EIO;
+    if (fp != NULL) {
+        fclose(fp);
+    }
+    free(chunk);
+    errno = err;
+    return -1;
+}
+
@@ -0,0 +1,75 @@
+/**
+ * @summary Implement the functions exported by the arena.h module for Linux
+ * using mmap, with MAP_HUGETLB or a transparent huge page hint.
+ */
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+#include <sys/mman.h>
+
+#include "arena.h"
+
+MNIST_API(int)
+ArenaCreate
+(
+    struct MEMORY_ARENA *o_arena,
+    size_t              capacity,
+    uint32_t               flags
+)
+{
+    size_t page_size = (size_t) sysconf(_SC_PAGESIZE);
+    void       *base = MAP_FAILED;
+
+    memset(o_arena, 0, sizeof(MEMORY_ARENA));
+
+    if (capacity == 0) {
+        errno = EINVAL;
+        return -1;
+    }
+#ifdef MAP_HUGETLB
+    if (flags & ARENA_FLAG_HUGE_PAGES) {
+        /* hugetlb pages are reserved up front, so this fails cleanly if the pool is too small */
+        size_t size = (capacity + ARENA_HUGE_PAGE_SIZE - 1) & ~(size_t)(ARENA_HUGE_PAGE_SIZE - 1);
+        base = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+        if (base != MAP_FAILED) {
+            o_arena->Capacity = size;
+            o_arena->PageSize = ARENA_HUGE_PAGE_SIZE;
+            flags |= ARENA_FLAG_LOCKED_PAGES;
+        }
+    }
+#endif
+    if (base == MAP_FAILED) {
+        size_t size = (capacity + page_size - 1) & ~(page_size - 1);
+        if ((base = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0)) == MAP_FAILED) {
+            return -1;
+        }
+#ifdef MADV_HUGEPAGE
+        if (flags & ARENA_FLAG_HUGE_PAGES) {
+            /* best-effort; THP may be disabled */
+            (void) madvise(base, size, MADV_HUGEPAGE);
+        }
+#endif
+        o_arena->Capacity = size;
+        o_arena->PageSize = page_size;
+        flags &= ~(uint32_t) ARENA_FLAG_LOCKED_PAGES;
+    }
+    o_arena->BaseAddress = (uint8_t*) base;
+    o_arena->Flags       = flags;
+    return 0;
+}
+
+MNIST_API(void)
+ArenaDelete
+(
+    struct MEMORY_ARENA *arena
+)
+{
+    if (arena != NULL) {
+        if (arena->BaseAddress != NULL) {
+            (void) munmap(arena->BaseAddress, arena->Capacity);
+        }
+        memset(arena, 0, sizeof(MEMORY_ARENA));
+    }
+}
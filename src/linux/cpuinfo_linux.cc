@@ -0,0 +1,73 @@
+/**
+ * @summary Implement the processor count and thread affinity functions
+ * exported by the cpuinfo.h module for Linux.
+ */
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE /* sched_getaffinity, CPU_COUNT, pthread_setaffinity_np */
+#endif
+
+#include <stddef.h>
+#include <stdint.h>
+#include <errno.h>
+#include <sched.h>
+#include <pthread.h>
+#include <unistd.h>
+
+#include "cpuinfo.h"
+
+MNIST_API(uint32_t)
+CpuLogicalCount
+(
+    void
+)
+{
+    cpu_set_t set;
+    long    count;
+
+    CPU_ZERO(&set);
+    if (sched_getaffinity(0, sizeof(set), &set) == 0 && (count = CPU_COUNT(&set)) > 0) {
+        return (uint32_t) count;
+    }
+    if ((count = sysconf(_SC_NPROCESSORS_ONLN)) > 0) {
+        return (uint32_t) count;
+    }
+    return 1;
+}
+
+MNIST_API(int)
+CpuPinCurrentThread
+(
+    uint32_t cpu_index
+)
+{
+    cpu_set_t allowed;
+    cpu_set_t     pin;
+    int         count;
+    int           cpu;
+    int            nth;
+    int           err;
+
+    /* map the index onto the nth processor in the process affinity mask */
+    CPU_ZERO(&allowed);
+    if (sched_getaffinity(0, sizeof(allowed), &allowed) != 0) {
+        return -1;
+    }
+    if ((count = CPU_COUNT(&allowed)) <= 0) {
+        errno = EINVAL;
+        return -1;
+    }
+    nth = (int)(cpu_index % (uint32_t) count);
+    for (cpu = 0; cpu < CPU_SETSIZE; ++cpu) {
+        if (CPU_ISSET(cpu, &allowed) && nth-- == 0) {
+            break;
+        }
+    }
+    CPU_ZERO(&pin);
+    CPU_SET(cpu, &pin);
+    if ((err = pthread_setaffinity_np(pthread_self(), sizeof(pin), &pin)) != 0) {
+        errno = err;
+        return -1;
+    }
+    return 0;
+}
+
@@ -0,0 +1,226 @@
+/**
+ * @summary Implement the functions exported by the data.h module for Linux.
+ * The executable path is read from /proc/self/exe, and the table of absolute
+ * paths is filled exactly once using pthread_once.
+ */
+#include <stddef.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <limits.h>
+#include <pthread.h>
+#include <unistd.h>
+
+#include "strlib.h"
+#include "pathlib.h"
+#include "data.h"
+
+/* @summary Define the indices of the default data files within DATA_PATH_TABLE.
+ */
+typedef enum DATA_PATH_INDEX {
+    DATA_PATH_TRAINING_IMAGES    = 0,                                          /* The training set images. */
+    DATA_PATH_TRAINING_LABELS    = 1,                                          /* The training set labels. */
+    DATA_PATH_TEST_IMAGES        = 2,                                          /* The test set images. */
+    DATA_PATH_TEST_LABELS        = 3,                                          /* The test set labels. */
+    DATA_PATH_COUNT              = 4,                                          /* The number of default data files. */
+} DATA_PATH_INDEX;
+
+/* @summary Define the table of absolute paths to the default data files. The table is written once, by ResolveDataPaths, and only read afterwards.
+ */
+typedef struct DATA_PATH_TABLE {
+    char8_t                      Storage[DATA_PATH_COUNT][PATH_BUFFER_MAX_BYTES]; /* The nul-terminated absolute paths. */
+    STRING_INFO                  Info[DATA_PATH_COUNT];                        /* The attributes of each path string. */
+    int                          Error;                                        /* The errno value describing why the paths could not be resolved, or zero. */
+} DATA_PATH_TABLE;
+
+/* @summary The paths to the default data files, relative to the directory containing the executable. Each starts with DATA_DIRECTORY_DEFAULT and a separator.
+ */
+static char const * const DATA_PATH_RELATIVE[DATA_PATH_COUNT] = {
+    DATA_DIRECTORY_DEFAULT "/train/train-images-idx3-ubyte",
+    DATA_DIRECTORY_DEFAULT "/train/train-labels-idx1-ubyte",
+    DATA_DIRECTORY_DEFAULT "/test/t10k-images-idx3-ubyte",
+    DATA_DIRECTORY_DEFAULT "/test/t10k-labels-idx1-ubyte"
+};
+
+static DATA_PATH_TABLE Global_DataPaths;
+static pthread_once_t  Global_DataPathsOnce = PTHREAD_ONCE_INIT;
+
+/* @summary Resolve the data directory and fill Global_DataPaths. Called exactly once, through pthread_once.
+ */
+static void
+ResolveDataPaths
+(
+    void
+)
+{
+    char8_t      root[PATH_BUFFER_MAX_BYTES];
+    STRING_INFO rinfo;
+    char const   *env = getenv(DATA_DIRECTORY_ENVIRONMENT_VARIABLE);
+    ssize_t         n = 0;
+    uint32_t        i;
+
+    if (env != NULL && env[0] != 0) {
+        /* a relative override is resolved against the working directory */
+        root[0] = 0;
+        if (env[0] != '/' && getcwd(root, sizeof(root)) == NULL) {
+            goto cleanup_and_fail;
+        }
+        if (LinuxPathBufferAppend(&rinfo, NULL, NULL, root, env) == NULL) {
+            goto cleanup_and_fail;
+        }
+    } else {
+        /* /proc/self/exe is already absolute; removing the last component leaves the directory containing the executable */
+        if ((n = readlink("/proc/self/exe", root, sizeof(root) - 1)) < 0) {
+            goto cleanup_and_fail;
+        }
+        root[n] = 0;
+        if (LinuxPathBufferAppend(&rinfo, NULL , NULL, root, "..") == NULL || LinuxPathBufferAppend(&rinfo, &rinfo, NULL, root, DATA_DIRECTORY_DEFAULT) == NULL) {
+            goto cleanup_and_fail;
+        }
+    }
+    for (i = 0; i < DATA_PATH_COUNT; ++i) {
+        char8_t *buf = Global_DataPaths.Storage[i];
+        memcpy(buf, root, rinfo.LengthBytes);
+        if (LinuxPathBufferAppend(&Global_DataPaths.Info[i], &rinfo, NULL, buf, DATA_PATH_RELATIVE[i] + sizeof(DATA_DIRECTORY_DEFAULT)) == NULL) {
+            goto cleanup_and_fail;
+        }
+    }
+    Global_DataPaths.Error = 0;
+    return;
+
+cleanup_and_fail:
+    Global_DataPaths.Error = (errno != 0) ? errno : ENOENT;
+}
+
+/* @summary Retrieve one of the relative paths to the default data files.
+ * @return The nul-terminated relative path.
+ */
+static char const*
+GetRelativeDataPath
+(
+    size_t  *len_chars,
+    size_t  *len_bytes,
+    uint32_t     index
+)
+{
+    char const *path = DATA_PATH_RELATIVE[index];
+    size_t    nbytes = strlen(path);
+
+    /* the relative paths are ASCII */
+    if (len_chars) *len_chars = nbytes;
+    if (len_bytes) *len_bytes = nbytes + 1;
+    return path;
+}
+
+/* @summary Retrieve one of the absolute paths to the default data files, resolving the table on first use.
+ * @return The nul-terminated absolute path, or NULL if the paths could not be resolved.
+ */
+static char const*
+GetAbsoluteDataPath
+(
+    size_t  *len_chars,
+    size_t  *len_bytes,
+    uint32_t     index
+)
+{
+    (void) pthread_once(&Global_DataPathsOnce, ResolveDataPaths);
+    if (Global_DataPaths.Error != 0) {
+        if (len_chars) *len_chars = 0;
+        if (len_bytes) *len_bytes = 0;
+        errno = Global_DataPaths.Error;
+        return NULL;
+    }
+    if (len_chars) *len_chars = Global_DataPaths.Info[index].LengthChars;
+    if (len_bytes) *len_bytes = Global_DataPaths.Info[index].LengthBytes;
+    return Global_DataPaths.Info[index].Buffer;
+}
+
+MNIST_API(size_t)
+GetMaxSystemPathChars
+(
+    void
+)
+{
+    return PATH_MAX - 1;
+}
+
+MNIST_API(char const*)
+TrainingSetImages_GetDefaultRelativePath
+(
+    size_t *len_chars, 
+    size_t *len_bytes
+)
+{
+    return GetRelativeDataPath(len_chars, len_bytes, DATA_PATH_TRAINING_IMAGES);
+}
+
+MNIST_API(char const*)
+TrainingSetLabels_GetDefaultRelativePath
+(
+    size_t *len_chars, 
+    size_t *len_bytes
+)
+{
+    return GetRelativeDataPath(len_chars, len_bytes, DATA_PATH_TRAINING_LABELS);
+}
+
+MNIST_API(char const*)
+TestSetImages_GetDefaultRelativePath
+(
+    size_t *len_chars, 
+    size_t *len_bytes
+)
+{
+    return GetRelativeDataPath(len_chars, len_bytes, DATA_PATH_TEST_IMAGES);
+}
+
+MNIST_API(char const*)
+TestSetLabels_GetDefaultRelativePath
+(
+    size_t *len_chars, 
+    size_t *len_bytes
+)
+{
+    return GetRelativeDataPath(len_chars, len_bytes, DATA_PATH_TEST_LABELS);
+}
+
+MNIST_API(char const*)
+TrainingSetImages_GetDefaultAbsolutePath
+(
+    size_t *len_chars, 
+    size_t *len_bytes
+)
+{
+    return GetAbsoluteDataPath(len_chars, len_bytes, DATA_PATH_TRAINING_IMAGES);
+}
+
+MNIST_API(char const*)
+TrainingSetLabels_GetDefaultAbsolutePath
+(
+    size_t *len_chars, 
+    size_t *len_bytes
+)
+{
+    return GetAbsoluteDataPath(len_chars, len_bytes, DATA_PATH_TRAINING_LABELS);
+}
+
+MNIST_API(char const*)
+TestSetImages_GetDefaultAbsolutePath
+(
+    size_t *len_chars, 
+    size_t *len_bytes
+)
+{
+    return GetAbsoluteDataPath(len_chars, len_bytes, DATA_PATH_TEST_IMAGES);
+}
+
+MNIST_API(char const*)
+TestSetLabels_GetDefaultAbsolutePath
+(
+    size_t *len_chars, 
+    size_t *len_bytes
+)
+{
+    return GetAbsoluteDataPath(len_chars, len_bytes, DATA_PATH_TEST_LABELS);
+}
@@ -0,0 +1,374 @@
+/**
+ * @summary Implement the directory walk exported by the dirscan.h module for
+ * Linux using the getdents64 system call, which returns a buffer full of
+ * directory entries, including their file types, per call.
+ */
+#include <stddef.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+
+#include "pathlib.h"
+#include "taskpool.h"
+#include "dirscan.h"
+
+/* @summary Define the layout of a directory entry returned by getdents64. The C library does not declare it.
+ */
+typedef struct LINUX_DIRENT64 {
+    uint64_t                     d_ino;                                        /* The inode number of the entry. */
+    int64_t                      d_off;                                        /* The offset of the next entry. */
+    uint16_t                     d_reclen;                                     /* The size of this entry, in bytes. */
+    uint8_t                      d_type;                                       /* One of the DT_* file type values. */
+    char                         d_name[1];                                    /* The nul-terminated entry name. */
+} LINUX_DIRENT64;
+
+/* @summary Define the DT_* file type values reported in LINUX_DIRENT64::d_type.
+ */
+#ifndef DT_UNKNOWN
+#   define DT_UNKNOWN                     0
+#   define DT_DIR                         4
+#   define DT_REG                         8
+#   define DT_LNK                         10
+#endif
+
+/* @summary Define a growable buffer of packed, nul-terminated path strings.
+ */
+typedef struct DIRECTORY_SCAN_BUFFER {
+    char8_t                     *Data;                                         /* The packed path strings. */
+    size_t                       Size;                                         /* The number of bytes of Data in use. */
+    size_t                       Capacity;                                     /* The number of bytes allocated for Data. */
+    uint32_t                     Count;                                        /* The number of path strings in Data. */
+} DIRECTORY_SCAN_BUFFER;
+
+/* @summary Define the state owned by each thread taking part in a directory walk.
+ */
+typedef struct DIRECTORY_SCAN_THREAD {
+    DIRECTORY_SCAN_BUFFER        Files;                                        /* The paths of the candidate files found by this thread. */
+    DIRECTORY_SCAN_BUFFER        Subdirs;                                      /* The paths of the subdirectories to visit on the next level. */
+    uint8_t                     *Entries;                                      /* The DIRECTORY_SCAN_BUFFER_SIZE byte buffer receiving directory entries. */
+    uint32_t                     DirectoryCount;                               /* The number of directories enumerated by this thread. */
+    uint32_t                     FileCount;                                    /* The number of files examined by this thread. */
+    uint32_t                     SkippedCount;                                 /* The number of directories or paths this thread could not process. */
+    int                          Error;                                        /* The errno value of the first allocation failure, or zero. */
+} DIRECTORY_SCAN_THREAD;
+
+/* @summary Define the arguments passed to DirectoryScanRange for one level of the walk.
+ */
+typedef struct DIRECTORY_SCAN_LEVEL {
+    DIRECTORY_SCAN_THREAD       *Threads;                                      /* The per-thread state, indexed by thread index. */
+    char8_t const               *Paths;                                        /* The packed paths of the directories on this level. */
+    size_t const                *Offsets;                                      /* The offset of each path within Paths. */
+    int                          Descend;                                      /* Non-zero if subdirectories should be recorded for the next level. */
+} DIRECTORY_SCAN_LEVEL;
+
+/* @summary Append the path dir/name to a buffer of packed path strings, growing the buffer as necessary.
+ * @return Zero if the path was appended, or -1 if memory allocation failed.
+ */
+static int
+DirectoryScanBufferAppend
+(
+    struct DIRECTORY_SCAN_BUFFER *buf,
+    char8_t const                *dir,
+    size_t                    dir_len,
+    char8_t const               *name,
+    size_t                   name_len
+)
+{
+    size_t need = dir_len + 1 + name_len + 1;
+    size_t    w = buf->Size;
+
+    if (buf->Size + need > buf->Capacity) {
+        size_t   newcap = (buf->Capacity == 0) ? 64 * 1024 : buf->Capacity * 2;
+        char8_t *newbuf = NULL;
+        while (newcap < buf->Size + need) {
+            newcap *= 2;
+        }
+        if ((newbuf = (char8_t*) realloc(buf->Data, newcap)) == NULL) {
+            return -1;
+        }
+        buf->Data     = newbuf;
+        buf->Capacity = newcap;
+    }
+    memcpy(buf->Data + w, dir, dir_len);
+    w += dir_len;
+    if (dir_len > 0 && dir[dir_len-1] != '/') {
+        buf->Data[w++] = '/';
+    }
+    memcpy(buf->Data + w, name, name_len);
+    w += name_len;
+    buf->Data[w++] = 0;
+    buf->Size = w;
+    buf->Count++;
+    return 0;
+}
+
+/* @summary Determine whether a file name could name an IDX shard, which requires it to contain "ubyte".
+ * @return Non-zero if the name contains "ubyte", ignoring case.
+ */
+static int
+DirectoryScanIsCandidate
+(
+    char const *name,
+    size_t      len
+)
+{
+    size_t i;
+    for (i = 0; i + 5 <= len; ++i) {
+        if ((name[i] | 0x20) == 'u' && (name[i+1] | 0x20) == 'b' && (name[i+2] | 0x20) == 'y' && (name[i+3] | 0x20) == 't' && (name[i+4] | 0x20) == 'e') {
+            return 1;
+        }
+    }
+    return 0;
+}
+
+/* @summary Enumerate a single directory, recording candidate files and, optionally, subdirectories.
+ * @param t The state of the calling thread.
+ * @param path The nul-terminated path of the directory.
+ * @param descend Non-zero if subdirectories should be recorded.
+ */
+static void
+DirectoryScanOne
+(
+    struct DIRECTORY_SCAN_THREAD *t,
+    char8_t const             *path,
+    int                      descend
+)
+{
+    size_t path_len = strlen(path);
+    long     nbytes = 0;
+    int          fd = -1;
+
+    if (t->Entries == NULL && (t->Entries = (uint8_t*) malloc(DIRECTORY_SCAN_BUFFER_SIZE)) == NULL) {
+        t->Error = ENOMEM;
+        return;
+    }
+    if ((fd = open(path, O_RDONLY | O_DIRECTORY | O_CLOEXEC)) == -1) {
+        t->SkippedCount++;
+        return;
+    }
+    while ((nbytes = syscall(SYS_getdents64, fd, t->Entries, DIRECTORY_SCAN_BUFFER_SIZE)) > 0) {
+        long pos = 0;
+        while (pos < nbytes) {
+            LINUX_DIRENT64 *ent = (LINUX_DIRENT64*)(t->Entries + pos);
+            char const    *name = ent->d_name;
+            size_t     name_len = strlen(name);
+            uint8_t        type = ent->d_type;
+            pos += ent->d_reclen;
+
+            if (name[0] == '.' && (name[1] == 0 || (name[1] == '.' && name[2] == 0))) {
+                continue;
+            }
+            if (type == DT_UNKNOWN || type == DT_LNK) {
+                /* symbolic links are resolved so links to files are found, but linked directories are not descended into */
+                struct stat st;
+                if (fstatat(fd, name, &st, (type == DT_LNK) ? 0 : AT_SYMLINK_NOFOLLOW) != 0) {
+                    continue;
+                }
+                if (S_ISREG(st.st_mode)) {
+                    type = DT_REG;
+                } else if (S_ISDIR(st.st_mode) && type == DT_UNKNOWN) {
+                    type = DT_DIR;
+                } else {
+                    continue;
+                }
+            }
+            if (type == DT_REG) {
+                t->FileCount++;
+                if (!DirectoryScanIsCandidate(name, name_len)) {
+                    continue;
+                }
+            } else if (type != DT_DIR || !descend) {
+                continue;
+            }
+            if (path_len + 1 + name_len + 1 > PATH_BUFFER_MAX_BYTES) {
+                t->SkippedCount++;
+                continue;
+            }
+            if (DirectoryScanBufferAppend((type == DT_REG) ? &t->Files : &t->Subdirs, path, path_len, (char8_t const*) name, name_len) != 0) {
+                t->Error = ENOMEM;
+                break;
+            }
+        }
+    }
+    if (nbytes < 0) {
+        t->SkippedCount++;
+    }
+    t->DirectoryCount++;
+    close(fd);
+}
+
+/* @summary Enumerate a range of the directories on the current level of a walk. Called by TaskPoolParallelFor.
+ */
+static void
+DirectoryScanRange
+(
+    void          *argp,
+    uint32_t      begin,
+    uint32_t        end,
+    uint32_t thread_index
+)
+{
+    DIRECTORY_SCAN_LEVEL  *level = (DIRECTORY_SCAN_LEVEL*) argp;
+    DIRECTORY_SCAN_THREAD     *t = &level->Threads[thread_index];
+    uint32_t                   i;
+
+    for (i = begin; i < end && t->Error == 0; ++i) {
+        DirectoryScanOne(t, level->Paths + level->Offsets[i], level->Descend);
+    }
+}
+
+MNIST_API(int)
+DirectoryScanIdxShards
+(
+    struct IDX_SHARD_LIST           *list,
+    struct DIRECTORY_SCAN_INIT const *init
+)
+{
+    DIRECTORY_SCAN_THREAD *threads = NULL;
+    DIRECTORY_SCAN_BUFFER     cur;
+    DIRECTORY_SCAN_BUFFER   files;
+    DIRECTORY_SCAN_LEVEL    level;
+    size_t               *offsets = NULL;
+    size_t            max_offsets = 0;
+    size_t               root_len = 0;
+    uint32_t             nthreads = TaskPoolThreadCount(init->TaskPool);
+    uint32_t                depth = 0;
+    uint32_t                 i, n;
+    int                       err = 0;
+    int                    result = 0;
+    int                        fd = -1;
+
+    assert(list != NULL);
+    assert(init != NULL);
+    memset(&cur  , 0, sizeof(DIRECTORY_SCAN_BUFFER));
+    memset(&files, 0, sizeof(DIRECTORY_SCAN_BUFFER));
+
+    if (init->RootPath == NULL || (root_len = strlen(init->RootPath)) == 0) {
+        errno = EINVAL;
+        return -1;
+    }
+    if (root_len + 1 > PATH_BUFFER_MAX_BYTES) {
+        errno = ENAMETOOLONG;
+        return -1;
+    }
+    if ((fd = open(init->RootPath, O_RDONLY | O_DIRECTORY | O_CLOEXEC)) == -1) {
+        return -1;
+    }
+    close(fd);
+    if ((threads = (DIRECTORY_SCAN_THREAD*) calloc(nthreads, sizeof(DIRECTORY_SCAN_THREAD))) == NULL) {
+        return -1;
+    }
+    /* the root is the only directory on the first level */
+    while (root_len > 1 && init->RootPath[root_len-1] == '/') {
+        root_len--;
+    }
+    if ((cur.Data = (char8_t*) malloc(root_len + 1)) == NULL) {
+        err = ENOMEM;
+        goto cleanup_and_exit;
+    }
+    memcpy(cur.Data, init->RootPath, root_len);
+    cur.Data[root_len] = 0;
+    cur.Size     = root_len + 1;
+    cur.Capacity = root_len + 1;
+    cur.Count    = 1;
+
+    while (cur.Count > 0) {
+        size_t pos = 0;
+        if (cur.Count > max_offsets) {
+            size_t *newo = (size_t*) realloc(offsets, cur.Count * sizeof(size_t));
+            if (newo == NULL) {
+                err = ENOMEM;
+                goto cleanup_and_exit;
+            }
+            offsets     = newo;
+            max_offsets = cur.Count;
+        }
+        for (i = 0; i < cur.Count; ++i) {
+            offsets[i] = pos;
+            pos += strlen(cur.Data + pos) + 1;
+        }
+        level.Threads = threads;
+        level.Paths   = cur.Data;
+        level.Offsets = offsets;
+        level.Descend = (init->MaxDepth == DIRECTORY_SCAN_NO_DEPTH_LIMIT || depth < init->MaxDepth);
+        TaskPoolParallelFor(init->TaskPool, cur.Count, 1, DirectoryScanRange, &level);
+
+        /* the subdirectories found by every thread make up the next level */
+        cur.Size  = 0;
+        cur.Count = 0;
+        for (n = 0; n < nthreads; ++n) {
+            DIRECTORY_SCAN_THREAD *t = &threads[n];
+            if (t->Error != 0) {
+                err = t->Error;
+                goto cleanup_and_exit;
+            }
+            if (t->Subdirs.Size > 0) {
+                if (cur.Size + t->Subdirs.Size > cur.Capacity) {
+                    char8_t *newd = (char8_t*) realloc(cur.Data, cur.Size + t->Subdirs.Size);
+                    if (newd == NULL) {
+                        err = ENOMEM;
+                        goto cleanup_and_exit;
+                    }
+                    cur.Data     = newd;
+                    cur.Capacity = cur.Size + t->Subdirs.Size;
+                }
+                memcpy(cur.Data + cur.Size, t->Subdirs.Data, t->Subdirs.Size);
+                cur.Size  += t->Subdirs.Size;
+                cur.Count += t->Subdirs.Count;
+                t->Subdirs.Size  = 0;
+                t->Subdirs.Count = 0;
+            }
+        }
+        depth++;
+    }
+
+    /* classify the candidate files found by every thread as one set, so shard paths are interned in a deterministic order */
+    list->DirectoryCount = 0;
+    list->FileCount      = 0;
+    list->SkippedCount   = 0;
+    for (n = 0; n < nthreads; ++n) {
+        DIRECTORY_SCAN_THREAD *t = &threads[n];
+        list->DirectoryCount += t->DirectoryCount;
+        list->FileCount      += t->FileCount;
+        list->SkippedCount   += t->SkippedCount;
+        if (t->Files.Size > 0) {
+            if (files.Size + t->Files.Size > files.Capacity) {
+                char8_t *newf = (char8_t*) realloc(files.Data, files.Size + t->Files.Size);
+                if (newf == NULL) {
+                    err = ENOMEM;
+                    goto cleanup_and_exit;
+                }
+                files.Data     = newf;
+                files.Capacity = files.Size + t->Files.Size;
+            }
+            memcpy(files.Data + files.Size, t->Files.Data, t->Files.Size);
+            files.Size  += t->Files.Size;
+            files.Count += t->Files.Count;
+        }
+    }
+    if (files.Size > 0 && IdxShardListAddPaths(list, files.Data, files.Size) != 0) {
+        err = errno;
+    }
+
+cleanup_and_exit:
+    for (n = 0; n < nthreads; ++n) {
+        free(threads[n].Files.Data);
+        free(threads[n].Subdirs.Data);
+        free(threads[n].Entries);
+    }
+    free(threads);
+    free(offsets);
+    free(files.Data);
+    free(cur.Data);
+    if (err != 0) {
+        errno  = err;
+        result = -1;
+    }
+    return result;
+}
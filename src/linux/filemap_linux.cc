@@ -0,0 +1,97 @@
+/**
+ * @summary Implement the functions exported by the filemap.h module for Linux
+ * using open/fstat/mmap.
+ */
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "filemap.h"
+
+MNIST_API(int)
+FileMappingOpen
+(
+    struct FILE_MAPPING *o_mapping,
+    char const               *path,
+    uint32_t                 hints
+)
+{
+    struct stat st;
+    void     *base = NULL;
+    int      flags = MAP_SHARED;
+    int         fd = -1;
+    int        err = 0;
+
+    memset(o_mapping, 0, sizeof(FILE_MAPPING));
+
+    if (path == NULL) {
+        errno = EINVAL;
+        return -1;
+    }
+    if ((fd = open(path, O_RDONLY | O_CLOEXEC)) == -1) {
+        return -1;
+    }
+    if (fstat(fd, &st) == -1) {
+        goto cleanup_and_fail;
+    }
+    if (!S_ISREG(st.st_mode)) {
+        errno = EINVAL;
+        goto cleanup_and_fail;
+    }
+    if ((uint64_t) st.st_size > (uint64_t) SIZE_MAX) {
+        errno = EFBIG;
+        goto cleanup_and_fail;
+    }
+    if (st.st_size > 0) {
+        if (hints & FILE_MAPPING_HINT_POPULATE) {
+            flags |= MAP_POPULATE;
+        }
+        if ((base = mmap(NULL, (size_t) st.st_size, PROT_READ, flags, fd, 0)) == MAP_FAILED) {
+            goto cleanup_and_fail;
+        }
+        /* access pattern hints are advisory - ignore any failure */
+        if (hints & FILE_MAPPING_HINT_SEQUENTIAL) {
+            (void) madvise(base, (size_t) st.st_size, MADV_SEQUENTIAL);
+        }
+        if (hints & FILE_MAPPING_HINT_RANDOM) {
+            (void) madvise(base, (size_t) st.st_size, MADV_RANDOM);
+        }
+        if (hints & FILE_MAPPING_HINT_WILLNEED) {
+            (void) madvise(base, (size_t) st.st_size, MADV_WILLNEED);
+        }
+    }
+    /* the mapping holds its own reference to the file */
+    close(fd);
+
+    o_mapping->Base          = base;
+    o_mapping->Size          =(size_t  ) st.st_size;
+    o_mapping->FileSize      =(uint64_t) st.st_size;
+    o_mapping->LastWriteTime =((uint64_t) st.st_mtim.tv_sec * 1000000000ULL) + (uint64_t) st.st_mtim.tv_nsec;
+    return 0;
+
+cleanup_and_fail:
+    err = errno;
+    close(fd);
+    errno = err;
+    return -1;
+}
+
+MNIST_API(void)
+FileMappingClose
+(
+    struct FILE_MAPPING *mapping
+)
+{
+    if (mapping != NULL) {
+        if (mapping->Base != NULL && mapping->Size > 0) {
+            munmap((void*) mapping->Base, mapping->Size);
+        }
+        memset(mapping, 0, sizeof(FILE_MAPPING));
+    }
+}
+
@@ -0,0 +1,319 @@
+/**
+ * @summary Implement the platform-independent functions exported by the
+ * minibatch.h module for allocating, shuffling and gathering minibatches.
+ * The background producer is implemented in the platform-specific source.
+ */
+#include <stddef.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+#include <errno.h>
+
+#include "convert.h"
+#include "dataset.h"
+#include "datacache.h"
+#include "sparse.h"
+#include "minibatch.h"
+
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+
+/* @summary Round a value up to the next multiple of a power of two.
+ * @param _value The value to round.
+ * @param _pow2 The power-of-two multiple.
+ * @return The smallest multiple of _pow2 that is greater than or equal to _value.
+ */
+#ifndef AlignUp
+#define AlignUp(_value, _pow2)                                                 \
+    (((_value) + ((_pow2) - 1)) & ~((_pow2) - 1))
+#endif
+
+/* @summary Hint that a cache line will be read soon.
+ * @param _addr The address to prefetch.
+ */
+#ifndef PrefetchRead
+#   if defined(_MSC_VER)
+#       define PrefetchRead(_addr)        _mm_prefetch((char const*)(_addr), _MM_HINT_T0)
+#   else
+#       define PrefetchRead(_addr)        __builtin_prefetch((_addr), 0, 3)
+#   endif
+#endif
+
+/* @summary Define the number of samples ahead of the current sample whose source data is prefetched during a gather.
+ */
+#ifndef MINIBATCH_PREFETCH_DISTANCE
+#define MINIBATCH_PREFETCH_DISTANCE   4
+#endif
+
+/* @summary Generate the next value from a xorshift64* random number generator.
+ * @param state The generator state, updated on return. Must be non-zero.
+ * @return A pseudo-random 64-bit value.
+ */
+static inline uint64_t
+XorShift64Star
+(
+    uint64_t *state
+)
+{
+    uint64_t x = *state;
+    x ^= x >> 12;
+    x ^= x << 25;
+    x ^= x >> 27;
+    *state = x;
+    return x * 0x2545F4914F6CDD1DULL;
+}
+
+/* @summary Prefetch the source data for a single sample.
+ * @param source The data from which the sample will be gathered.
+ * @param index The index of the sample within the data set.
+ */
+static inline void
+PrefetchSample
+(
+    struct MINIBATCH_SOURCE const *source,
+    uint32_t                        index
+)
+{
+    uint8_t const *p;
+    size_t     nbyte;
+    size_t         i;
+    if (source->Cache != NULL) {
+        p     =(uint8_t const*) DataCacheSample(source->Cache, index);
+        nbyte = source->Cache->FeatureCount * sizeof(float);
+    } else {
+        p     = MnistDatasetImage(source->Dataset, index);
+        nbyte = source->Dataset->ImageSize;
+    }
+    for (i = 0; i < nbyte; i += 64) {
+        PrefetchRead(p + i);
+    }
+}
+
+/* @summary Compute the layout of the buffers for a minibatch within a single block of memory, and optionally assign the buffer pointers.
+ * @param o_batch If non-NULL, the MINIBATCH whose buffer pointers and dimensions are set. Memory and MemorySize are not modified.
+ * @param base The MINIBATCH_ALIGNMENT-aligned start of the block. May be NULL if o_batch is NULL.
+ * @param capacity The maximum number of samples the batch can hold.
+ * @param feature_count The number of floats in each input row.
+ * @param sparse Non-zero to include the Nonzeros and NonzerosByFeature buffers.
+ * @return The size of the block, in bytes.
+ */
+static size_t
+MinibatchLayout
+(
+    struct MINIBATCH *o_batch,
+    uint8_t             *base,
+    uint32_t         capacity,
+    uint32_t    feature_count,
+    int                sparse
+)
+{
+    size_t row_stride = AlignUp(feature_count, MINIBATCH_ALIGNMENT / sizeof(float));
+    size_t input_size = AlignUp(capacity * row_stride * sizeof(float), MINIBATCH_ALIGNMENT);
+    size_t index_size = AlignUp(capacity * sizeof(uint32_t), MINIBATCH_ALIGNMENT);
+    size_t label_size = AlignUp(capacity * sizeof(uint8_t) , MINIBATCH_ALIGNMENT);
+    size_t  nzof_size = sparse ? AlignUp((capacity + 1) * sizeof(uint32_t), MINIBATCH_ALIGNMENT) : 0;
+    size_t  nzcl_size = sparse ? AlignUp((size_t) capacity * feature_count * sizeof(uint32_t), MINIBATCH_ALIGNMENT) : 0;
+    size_t  nzvl_size = sparse ? AlignUp((size_t) capacity * feature_count * sizeof(float), MINIBATCH_ALIGNMENT) : 0;
+    size_t  nzft_size = sparse ? AlignUp((feature_count + 1) * sizeof(uint32_t), MINIBATCH_ALIGNMENT) : 0;
+
+    if (o_batch != NULL) {
+        o_batch->Inputs       =(float   *)(base);
+        o_batch->Indices      =(uint32_t*)(base + input_size);
+        o_batch->Labels       =(uint8_t *)(base + input_size + index_size);
+        o_batch->SampleCount  = 0;
+        o_batch->Capacity     = capacity;
+        o_batch->FeatureCount = feature_count;
+        o_batch->RowStride    =(uint32_t) row_stride;
+        if (sparse) {
+            base += input_size + index_size + label_size;
+            o_batch->Nonzeros.RowOffsets  =(uint32_t*)(base);
+            o_batch->Nonzeros.Columns     =(uint32_t*)(base + nzof_size);
+            o_batch->Nonzeros.Values      =(float   *)(base + nzof_size + nzcl_size);
+            o_batch->Nonzeros.ColumnCount = feature_count;
+            base += nzof_size + nzcl_size + nzvl_size;
+            o_batch->NonzerosByFeature.RowOffsets =(uint32_t*)(base);
+            o_batch->NonzerosByFeature.Columns    =(uint32_t*)(base + nzft_size);
+            o_batch->NonzerosByFeature.Values     =(float   *)(base + nzft_size + nzcl_size);
+            o_batch->NonzerosByFeature.RowCount   = feature_count;
+        }
+    }
+    return input_size + index_size + label_size + nzof_size + nzft_size + (2 * (nzcl_size + nzvl_size));
+}
+
+/* @summary Allocate the buffers for a minibatch, optionally including space for a CSR encoding of its inputs.
+ * @param o_batch The MINIBATCH to initialize. On failure, the structure is zero-initialized.
+ * @param capacity The maximum number of samples the batch can hold.
+ * @param feature_count The number of floats in each input row.
+ * @param flags Zero, or MINIBATCH_FLAG_SPARSE to allocate the Nonzeros buffers.
+ * @return Zero if the buffers are allocated successfully, or -1 if an error occurred.
+ */
+static int
+MinibatchAllocate
+(
+    struct MINIBATCH *o_batch,
+    uint32_t         capacity,
+    uint32_t    feature_count,
+    uint32_t            flags
+)
+{
+    size_t   size = MinibatchLayout(NULL, NULL, capacity, feature_count, (flags & MINIBATCH_FLAG_SPARSE) != 0);
+    uint8_t  *mem = NULL;
+
+    assert(o_batch != NULL);
+    memset(o_batch, 0, sizeof(MINIBATCH));
+
+    if (capacity == 0 || feature_count == 0) {
+        errno = EINVAL;
+        return -1;
+    }
+    if ((mem = (uint8_t*) malloc(size + MINIBATCH_ALIGNMENT)) == NULL) {
+        return -1;
+    }
+    (void) MinibatchInitialize(o_batch, (void*) AlignUp((uintptr_t) mem, (uintptr_t) MINIBATCH_ALIGNMENT), capacity, feature_count, flags);
+    o_batch->Memory     = mem;
+    o_batch->MemorySize = size + MINIBATCH_ALIGNMENT;
+    return 0;
+}
+
+MNIST_API(size_t)
+MinibatchMemorySize
+(
+    uint32_t      capacity,
+    uint32_t feature_count,
+    uint32_t         flags
+)
+{
+    return MinibatchLayout(NULL, NULL, capacity, feature_count, (flags & MINIBATCH_FLAG_SPARSE) != 0);
+}
+
+MNIST_API(int)
+MinibatchInitialize
+(
+    struct MINIBATCH *o_batch,
+    void              *memory,
+    uint32_t         capacity,
+    uint32_t    feature_count,
+    uint32_t            flags
+)
+{
+    size_t size;
+
+    assert(o_batch != NULL);
+    memset(o_batch, 0, sizeof(MINIBATCH));
+
+    if (memory == NULL || ((uintptr_t) memory & (MINIBATCH_ALIGNMENT - 1)) != 0 || capacity == 0 || feature_count == 0) {
+        errno = EINVAL;
+        return -1;
+    }
+    size = MinibatchLayout(o_batch, (uint8_t*) memory, capacity, feature_count, (flags & MINIBATCH_FLAG_SPARSE) != 0);
+    memset(memory, 0, size);
+    o_batch->MemorySize = size;
+    return 0;
+}
+
+MNIST_API(int)
+MinibatchCreate
+(
+    struct MINIBATCH *o_batch,
+    uint32_t         capacity,
+    uint32_t    feature_count
+)
+{
+    return MinibatchAllocate(o_batch, capacity, feature_count, MINIBATCH_FLAGS_NONE);
+}
+
+MNIST_API(int)
+MinibatchCreateSparse
+(
+    struct MINIBATCH *o_batch,
+    uint32_t         capacity,
+    uint32_t    feature_count
+)
+{
+    return MinibatchAllocate(o_batch, capacity, feature_count, MINIBATCH_FLAG_SPARSE);
+}
+
+MNIST_API(void)
+MinibatchDelete
+(
+    struct MINIBATCH *batch
+)
+{
+    if (batch != NULL) {
+        free(batch->Memory);
+        memset(batch, 0, sizeof(MINIBATCH));
+    }
+}
+
+MNIST_API(void)
+MinibatchGather
+(
+    struct MINIBATCH              *batch,
+    struct MINIBATCH_SOURCE const *source,
+    uint32_t const               *indices,
+    uint32_t                        count
+)
+{
+    MNIST_DATASET const *ds = source->Dataset;
+    SPARSE_CSR          *nz = &batch->Nonzeros;
+    uint32_t         nfeat  = batch->FeatureCount;
+    uint32_t        stride  = batch->RowStride;
+    uint32_t           nnz  = 0;
+    uint32_t             i;
+
+    assert(count <= batch->Capacity);
+    assert(nfeat == ds->ImageSize);
+
+    for (i = 0; i < count && i < MINIBATCH_PREFETCH_DISTANCE; ++i) {
+        PrefetchSample(source, indices[i]);
+    }
+    for (i = 0; i < count; ++i) {
+        uint32_t index = indices[i];
+        float     *dst = batch->Inputs + ((size_t) i * stride);
+        if (i + MINIBATCH_PREFETCH_DISTANCE < count) {
+            PrefetchSample(source, indices[i + MINIBATCH_PREFETCH_DISTANCE]);
+        }
+        if (source->Cache != NULL) {
+            memcpy(dst, DataCacheSample(source->Cache, index), nfeat * sizeof(float));
+        } else {
+            ConvertU8ToF32(dst, MnistDatasetImage(ds, index), nfeat, source->Scale, source->Bias);
+        }
+        if (nz->RowOffsets != NULL) {
+            /* encode while the row is still in L1 */
+            nz->RowOffsets[i] = nnz;
+            nnz += SparseEncodeRowF32(nz->Columns + nnz, nz->Values + nnz, dst, nfeat);
+        }
+        batch->Indices[i] = index;
+        batch->Labels [i] = MnistDatasetLabel(ds, index);
+    }
+    if (nz->RowOffsets != NULL) {
+        nz->RowOffsets[count] = nnz;
+        nz->RowCount          = count;
+        nz->NonzeroCount      = nnz;
+        SparseTranspose(&batch->NonzerosByFeature, nz);
+    }
+    batch->SampleCount = count;
+}
+
+MNIST_API(void)
+MinibatchShuffle
+(
+    uint32_t   *indices,
+    uint32_t      count,
+    uint64_t *rng_state
+)
+{
+    uint32_t i;
+    assert(rng_state != NULL && *rng_state != 0);
+    for (i = count; i > 1; --i) {
+        /* map a 32-bit random value onto [0, i) with a multiply-shift */
+        uint32_t r = (uint32_t)(XorShift64Star(rng_state) >> 32);
+        uint32_t j = (uint32_t)(((uint64_t) r * i) >> 32);
+        uint32_t t = indices[i - 1];
+        indices[i - 1] = indices[j];
+        indices[j] = t;
+    }
+}
+
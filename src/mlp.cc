@@ -0,0 +1,1102 @@
+/**
+ * @summary Implement the functions exported by the mlp.h module for training
+ * and evaluating multi-layer perceptrons.
+ */
+#include <stddef.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <assert.h>
+#include <errno.h>
+
+#include "arena.h"
+#include "convert.h"
+#include "gemm.h"
+#include "dataset.h"
+#include "minibatch.h"
+#include "sparse.h"
+#include "taskpool.h"
+#include "mlp.h"
+
+/* @summary Round a value up to the next multiple of a power of two.
+ * @param _value The value to round.
+ * @param _pow2 The power-of-two multiple.
+ * @return The smallest multiple of _pow2 that is greater than or equal to _value.
+ */
+#ifndef AlignUp
+#define AlignUp(_value, _pow2)                                                 \
+    (((_value) + ((_pow2) - 1)) & ~((_pow2) - 1))
+#endif
+
+/* @summary Define the smallest probability passed to log when computing the cross-entropy loss.
+ */
+#ifndef MLP_MIN_PROBABILITY
+#define MLP_MIN_PROBABILITY           1.0e-12f
+#endif
+
+/* @summary Define the number of weights updated by MlpUpdate before they are converted to the 16-bit copy, so that the conversion reads them from the L1 cache.
+ */
+#ifndef MLP_UPDATE_CHUNK
+#define MLP_UPDATE_CHUNK              2048
+#endif
+
+/* @summary Generate a uniformly-distributed random value in [-1, 1) from a xorshift64* generator.
+ * @param state The generator state, updated on return. Must be non-zero.
+ * @return A pseudo-random value in [-1, 1).
+ */
+static float
+RandomUniform
+(
+    uint64_t *state
+)
+{
+    uint64_t x = *state;
+    x ^= x >> 12;
+    x ^= x << 25;
+    x ^= x >> 27;
+    *state = x;
+    /* the top 24 bits map exactly onto the float mantissa */
+    return ((float)((x * 0x2545F4914F6CDD1DULL) >> 40) * (2.0f / 16777216.0f)) - 1.0f;
+}
+
+/* @summary Compute the number of bytes needed for a buffer of floats, rounded up to MLP_ALIGNMENT.
+ * @param count The number of floats.
+ * @return The buffer size, in bytes.
+ */
+static size_t
+MlpBufferSize
+(
+    size_t count
+)
+{
+    return AlignUp(count * sizeof(float), (size_t) MLP_ALIGNMENT);
+}
+
+/* @summary Compute the number of bytes needed for a buffer of 16-bit values, rounded up to MLP_ALIGNMENT.
+ * @param count The number of 16-bit values.
+ * @return The buffer size, in bytes.
+ */
+static size_t
+MlpHalfBufferSize
+(
+    size_t count
+)
+{
+    return AlignUp(count * sizeof(uint16_t), (size_t) MLP_ALIGNMENT);
+}
+
+/* @summary Compute the number of bytes needed for the activation buffers of every layer.
+ * In mixed-precision mode, each hidden layer keeps only its 16-bit activations, and the float32 GEMM results of all hidden layers share one buffer.
+ * @param mlp The network, with its layers initialized.
+ * @param precision One of the values of the CONVERT_TYPE enumeration.
+ * @param rows The number of rows in each activation buffer.
+ * @return The total size of the buffers allocated by MlpAllocateActivations, in bytes.
+ */
+static size_t
+MlpActivationSize
+(
+    MLP const       *mlp,
+    uint32_t   precision,
+    uint32_t        rows
+)
+{
+    size_t  total = MlpBufferSize((size_t) rows * mlp->Layers[mlp->LayerCount - 1].OutputStride);
+    size_t shared = 0;
+    uint32_t    l;
+    for (l = 0; l + 1 < mlp->LayerCount; ++l) {
+        size_t nbytes = MlpBufferSize((size_t) rows * mlp->Layers[l].OutputStride);
+        if (precision != CONVERT_TYPE_F32) {
+            shared = nbytes > shared ? nbytes : shared;
+            total += MlpHalfBufferSize((size_t) rows * mlp->Layers[l].OutputStride);
+        } else {
+            total += nbytes;
+        }
+    }
+    return total + shared;
+}
+
+/* @summary Allocate the activation buffers of every layer from an arena, as sized by MlpActivationSize.
+ * In mixed-precision mode, the Outputs of the hidden layers all point to one buffer, which holds only the most recent layer.
+ * @param outputs An array of LayerCount entries receiving the float32 activation buffer of each layer.
+ * @param outputs_half An array of LayerCount entries receiving the 16-bit activation buffer of each hidden layer in mixed-precision mode. The other entries are set to NULL.
+ * @param mlp The network.
+ * @param arena The arena to allocate from.
+ * @param rows The number of rows in each activation buffer.
+ * @return Zero if the buffers are allocated, or -1 if the arena does not have enough space.
+ */
+static int
+MlpAllocateActivations
+(
+    float        **outputs,
+    uint16_t **outputs_half,
+    MLP const         *mlp,
+    MEMORY_ARENA    *arena,
+    uint32_t          rows
+)
+{
+    float       *shared = NULL;
+    size_t   shared_size = 0;
+    uint32_t           l;
+    if (mlp->Precision != CONVERT_TYPE_F32) {
+        for (l = 0; l + 1 < mlp->LayerCount; ++l) {
+            size_t nbytes = MlpBufferSize((size_t) rows * mlp->Layers[l].OutputStride);
+            shared_size = nbytes > shared_size ? nbytes : shared_size;
+        }
+        if (shared_size > 0 && (shared = (float*) ArenaAllocate(arena, shared_size, MLP_ALIGNMENT)) == NULL) {
+            return -1;
+        }
+    }
+    for (l = 0; l < mlp->LayerCount; ++l) {
+        size_t count = (size_t) rows * mlp->Layers[l].OutputStride;
+        outputs_half[l] = NULL;
+        if (shared != NULL && l + 1 < mlp->LayerCount) {
+            /* the next layer reads the 16-bit copy, so the float32 result is only needed until it is converted */
+            if ((outputs_half[l] = (uint16_t*) ArenaAllocate(arena, MlpHalfBufferSize(count), MLP_ALIGNMENT)) == NULL) {
+                return -1;
+            }
+            outputs[l] = shared;
+        } else if ((outputs[l] = (float*) ArenaAllocate(arena, MlpBufferSize(count), MLP_ALIGNMENT)) == NULL) {
+            return -1;
+        }
+    }
+    return 0;
+}
+
+MNIST_API(void)
+MlpActivate
+(
+    struct MLP_LAYER const *layer,
+    float                *outputs,
+    uint32_t                count
+)
+{
+    uint32_t const nout = layer->OutputCount;
+    uint32_t i, j;
+
+    for (i = 0; i < count; ++i) {
+        float *row = outputs + ((size_t) i * layer->OutputStride);
+        switch (layer->Activation) {
+            case MLP_ACTIVATION_RELU:
+                for (j = 0; j < nout; ++j) {
+                    row[j] = row[j] > 0.0f ? row[j] : 0.0f;
+                }
+                break;
+            case MLP_ACTIVATION_SOFTMAX: {
+                float max_value = row[0];
+                float       sum = 0.0f;
+                for (j = 1; j < nout; ++j) {
+                    max_value = row[j] > max_value ? row[j] : max_value;
+                }
+                for (j = 0; j < nout; ++j) {
+                    row[j] = expf(row[j] - max_value);
+                    sum   += row[j];
+                }
+                sum = 1.0f / sum;
+                for (j = 0; j < nout; ++j) {
+                    row[j] *= sum;
+                }
+            } break;
+            default:
+                break;
+        }
+    }
+}
+
+/* @summary Decide whether the first layer should use the sparse encoding of a minibatch.
+ * @param batch The minibatch.
+ * @return The sparse encoding of the batch inputs, or NULL if the batch has none or it is too dense to be worthwhile.
+ */
+static SPARSE_CSR const*
+MlpBatchNonzeros
+(
+    MINIBATCH const *batch
+)
+{
+    SPARSE_CSR const *nz = &batch->Nonzeros;
+    if (nz->RowOffsets == NULL || nz->RowCount != batch->SampleCount) {
+        return NULL;
+    }
+    if ((float) nz->NonzeroCount > MLP_SPARSE_MAX_DENSITY * (float) batch->SampleCount * (float) batch->FeatureCount) {
+        return NULL;
+    }
+    return nz;
+}
+
+/* @summary Run the forward pass for a batch of input rows, writing the activations of each layer to caller-supplied buffers.
+ * @param mlp The network to evaluate. The network is not modified.
+ * @param outputs An array of LayerCount buffers receiving the activations of each layer, each with dimensions [count][OutputStride].
+ * @param outputs_half In mixed-precision mode, an array of buffers receiving the 16-bit activations of each hidden layer, read by the next layer. Otherwise NULL.
+ * @param inputs The input rows, with dimensions [count][input_stride].
+ * @param input_stride The distance between the start of consecutive input rows, in floats.
+ * @param nonzeros An optional sparse encoding of the input rows. If non-NULL, the first layer uses the sparse product instead of GEMM.
+ * @param count The number of input rows.
+ * @param pool The task pool used to run each GEMM, or NULL.
+ * @param workspace The GEMM workspace, sized for GemmF32Parallel with count rows if pool is non-NULL.
+ */
+static void
+MlpForwardLayers
+(
+    MLP const                *mlp,
+    float * const        *outputs,
+    uint16_t * const *outputs_half,
+    float const           *inputs,
+    uint32_t         input_stride,
+    SPARSE_CSR const     *nonzeros,
+    uint32_t                count,
+    struct TASK_POOL        *pool,
+    float              *workspace
+)
+{
+    void const *x = inputs;
+    uint32_t  ldx = input_stride;
+    uint32_t type = CONVERT_TYPE_F32;
+    uint32_t l, i;
+
+    for (l = 0; l < mlp->LayerCount; ++l) {
+        MLP_LAYER const *layer = &mlp->Layers[l];
+        uint32_t        stride = layer->OutputStride;
+        /* initialize each output row with the bias, then accumulate x * W */
+        for (i = 0; i < count; ++i) {
+            memcpy(outputs[l] + ((size_t) i * stride), layer->Bias, stride * sizeof(float));
+        }
+        if (l == 0 && nonzeros != NULL) {
+            SparseGemmF32Parallel(pool, GEMM_OP_NONE, layer->OutputCount, nonzeros, layer->Weights, stride, 1.0f, outputs[l], stride);
+        } else if (mlp->Precision != CONVERT_TYPE_F32) {
+            (void) GemmMixedParallel(pool, type, GEMM_OP_NONE, mlp->Precision, GEMM_OP_NONE, count, layer->OutputCount, layer->InputCount,
+                                     1.0f, x, ldx, layer->WeightsHalf, stride, 1.0f, outputs[l], stride, workspace);
+        } else {
+            (void) GemmF32Parallel(pool, GEMM_OP_NONE, GEMM_OP_NONE, count, layer->OutputCount, layer->InputCount,
+                                   1.0f, (float const*) x, ldx, layer->Weights, stride, 1.0f, outputs[l], stride, workspace);
+        }
+        MlpActivate(layer, outputs[l], count);
+        if (outputs_half != NULL && l + 1 < mlp->LayerCount) {
+            /* the next layer, the weight gradient and the ReLU mask all read the 16-bit copy, so the float32 buffer is reused by the next hidden layer */
+            ConvertF32ToHalf(outputs_half[l], outputs[l], (size_t) count * stride, mlp->Precision);
+            x    = outputs_half[l];
+            type = mlp->Precision;
+        } else {
+            x    = outputs[l];
+            type = CONVERT_TYPE_F32;
+        }
+        ldx = stride;
+    }
+}
+
+/* @summary Define the scratch state used by one thread of MlpEvaluate or MlpTrainHogwild.
+ */
+typedef struct MLP_EVALUATE_THREAD {
+    MINIBATCH                    Batch;                                        /* The gathered input rows and labels. */
+    float                       *Outputs[MLP_MAX_LAYERS];                      /* The activations of each layer, with dimensions [MaxBatchSize][OutputStride]. */
+    uint16_t                    *OutputsHalf[MLP_MAX_LAYERS];                  /* In mixed-precision mode, the 16-bit activations of each hidden layer. Otherwise NULL. */
+    float                       *Deltas[MLP_MAX_LAYERS];                       /* The loss gradient with respect to the pre-activation values of each layer, used by MlpTrainHogwild. */
+    float                       *Workspace;                                    /* The GEMM packing workspace, GEMM_WORKSPACE_FLOATS floats. */
+    uint32_t                    *Indices;                                      /* The sample indices of the batch, MaxBatchSize entries. */
+    double                       Loss;                                         /* The sum of the cross-entropy loss of the samples classified by this thread. */
+    uint32_t                     Correct;                                      /* The number of samples correctly classified by this thread. */
+} MLP_EVALUATE_THREAD;
+
+/* @summary Define the arguments shared by the tasks of MlpEvaluate.
+ */
+typedef struct MLP_EVALUATE_ARGS {
+    MLP const                   *Network;                                      /* The network being evaluated. */
+    MINIBATCH_SOURCE const      *Source;                                       /* The data being classified. */
+    MLP_EVALUATE_THREAD         *Threads;                                      /* Scratch state for each thread of the pool. */
+} MLP_EVALUATE_ARGS;
+
+/* @summary Compute the amount of frame arena memory used by one thread of MlpEvaluate or MlpTrainHogwild.
+ * @param mlp The network being evaluated.
+ * @param precision The storage format of the hidden activations, one of the values of the CONVERT_TYPE enumeration.
+ * @return The number of bytes allocated by MlpEvaluateThreadCreate.
+ */
+static size_t
+MlpEvaluateThreadSize
+(
+    MLP const       *mlp,
+    uint32_t   precision
+)
+{
+    size_t total = MlpBufferSize(GEMM_WORKSPACE_FLOATS) + MlpBufferSize(mlp->MaxBatchSize);
+    uint32_t   l;
+    for (l = 0; l < mlp->LayerCount; ++l) {
+        total += MlpBufferSize((size_t) mlp->MaxBatchSize * mlp->Layers[l].OutputStride); /* Deltas */
+    }
+    total += MlpActivationSize(mlp, precision, mlp->MaxBatchSize);
+    return total + AlignUp(MinibatchMemorySize(mlp->MaxBatchSize, mlp->InputCount, MINIBATCH_FLAG_SPARSE), (size_t) MLP_ALIGNMENT);
+}
+
+/* @summary Allocate the scratch state for one thread of MlpEvaluate or MlpTrainHogwild from an arena.
+ * @param o_thread The MLP_EVALUATE_THREAD to initialize.
+ * @param mlp The network being evaluated.
+ * @param arena The arena to allocate from.
+ * @return Zero if the state is allocated, or -1 if the arena does not have enough space.
+ */
+static int
+MlpEvaluateThreadCreate
+(
+    MLP_EVALUATE_THREAD *o_thread,
+    MLP const                *mlp,
+    MEMORY_ARENA           *arena
+)
+{
+    size_t    batch_size = MinibatchMemorySize(mlp->MaxBatchSize, mlp->InputCount, MINIBATCH_FLAG_SPARSE);
+    void     *batch_mem  = NULL;
+    uint32_t           l;
+
+    memset(o_thread, 0, sizeof(MLP_EVALUATE_THREAD));
+    if ((o_thread->Workspace = (float   *) ArenaAllocate(arena, MlpBufferSize(GEMM_WORKSPACE_FLOATS), MLP_ALIGNMENT)) == NULL ||
+        (o_thread->Indices   = (uint32_t*) ArenaAllocate(arena, MlpBufferSize(mlp->MaxBatchSize)   , MLP_ALIGNMENT)) == NULL ||
+        (batch_mem           =             ArenaAllocate(arena, batch_size                         , MLP_ALIGNMENT)) == NULL) {
+        return -1;
+    }
+    if (MlpAllocateActivations(o_thread->Outputs, o_thread->OutputsHalf, mlp, arena, mlp->MaxBatchSize) != 0) {
+        return -1;
+    }
+    for (l = 0; l < mlp->LayerCount; ++l) {
+        size_t nbytes = MlpBufferSize((size_t) mlp->MaxBatchSize * mlp->Layers[l].OutputStride);
+        if ((o_thread->Deltas[l] = (float*) ArenaAllocate(arena, nbytes, MLP_ALIGNMENT)) == NULL) {
+            return -1;
+        }
+    }
+    return MinibatchInitialize(&o_thread->Batch, batch_mem, mlp->MaxBatchSize, mlp->InputCount, MINIBATCH_FLAG_SPARSE);
+}
+
+/* @summary Classify a range of batches for MlpEvaluate. Batch b contains samples [b * MaxBatchSize, (b + 1) * MaxBatchSize).
+ * @param argp Pointer to the MLP_EVALUATE_ARGS.
+ * @param begin The first batch index.
+ * @param end One past the last batch index.
+ * @param thread_index The index of the calling thread, selecting its scratch state.
+ */
+static void
+MlpEvaluateBatches
+(
+    void          *argp,
+    uint32_t      begin,
+    uint32_t        end,
+    uint32_t thread_index
+)
+{
+    MLP_EVALUATE_ARGS const *args = (MLP_EVALUATE_ARGS const*) argp;
+    MLP const                *mlp = args->Network;
+    MLP_LAYER const          *out = &mlp->Layers[mlp->LayerCount - 1];
+    MLP_EVALUATE_THREAD   *thread = &args->Threads[thread_index];
+    float const           *probs = thread->Outputs[mlp->LayerCount - 1];
+    uint32_t         sample_count = args->Source->Dataset->SampleCount;
+    uint32_t b, i, j;
+
+    for (b = begin; b < end; ++b) {
+        uint32_t  base = b * mlp->MaxBatchSize;
+        uint32_t count = sample_count - base;
+        if (count > mlp->MaxBatchSize) {
+            count = mlp->MaxBatchSize;
+        }
+        for (i = 0; i < count; ++i) {
+            thread->Indices[i] = base + i;
+        }
+        MinibatchGather(&thread->Batch, args->Source, thread->Indices, count);
+        MlpForwardLayers(mlp, thread->Outputs, mlp->Precision != CONVERT_TYPE_F32 ? thread->OutputsHalf : NULL, thread->Batch.Inputs, thread->Batch.RowStride, MlpBatchNonzeros(&thread->Batch),
+                         count, NULL, thread->Workspace);
+        for (i = 0; i < count; ++i) {
+            float const *p = probs + ((size_t) i * out->OutputStride);
+            uint8_t      y = thread->Batch.Labels[i];
+            uint32_t  best = 0;
+            for (j = 1; j < out->OutputCount; ++j) {
+                if (p[j] > p[best]) {
+                    best = j;
+                }
+            }
+            if (best == y) {
+                thread->Correct++;
+            }
+            thread->Loss -= log(p[y] > MLP_MIN_PROBABILITY ? p[y] : MLP_MIN_PROBABILITY);
+        }
+    }
+}
+
+/* @summary Define the arguments shared by the tasks of MlpTrainHogwild.
+ */
+typedef struct MLP_HOGWILD_ARGS {
+    MLP                         *Network;                                      /* The network being trained. Its weights are updated by every task without locks. */
+    MINIBATCH_SOURCE const      *Source;                                       /* The training data. */
+    uint32_t const              *Indices;                                      /* The sample indices to train on. */
+    MLP_EVALUATE_THREAD         *Threads;                                      /* Scratch state for each thread of the pool. */
+    uint32_t                     IndexCount;                                   /* The number of entries in Indices. */
+    uint32_t                     RangeCount;                                   /* The number of disjoint slices Indices is divided into. */
+    uint32_t                     BatchSize;                                    /* The number of samples in each minibatch. */
+    float                        LearningRate;                                 /* The step size. */
+} MLP_HOGWILD_ARGS;
+
+/* @summary Run the backward pass for one minibatch of MlpTrainHogwild and apply the update directly to the shared weights.
+ * The deltas carry the factor -learning_rate / count, which backpropagates unchanged, so each layer adds x^T * delta to its weights.
+ * Each layer computes the deltas of the layer below from its weights before updating them, as in MlpBackwardLayers.
+ * @param mlp The network to update.
+ * @param thread The scratch state holding the gathered batch and the activations of its forward pass.
+ * @param nonzeros The sparse encoding of the batch inputs by row, or NULL to update the first layer with GEMM.
+ * @param count The number of rows in the batch.
+ * @param learning_rate The step size.
+ * @return The sum of the cross-entropy loss over the batch.
+ */
+static double
+MlpHogwildStep
+(
+    MLP                      *mlp,
+    MLP_EVALUATE_THREAD   *thread,
+    SPARSE_CSR const    *nonzeros,
+    uint32_t                count,
+    float           learning_rate
+)
+{
+    MLP_LAYER const *out = &mlp->Layers[mlp->LayerCount - 1];
+    float const    scale = -learning_rate / (float) count;
+    double          loss = 0.0;
+    uint32_t     l, i, j;
+
+    for (i = 0; i < count; ++i) {
+        float const *p = thread->Outputs[mlp->LayerCount - 1] + ((size_t) i * out->OutputStride);
+        float       *d = thread->Deltas [mlp->LayerCount - 1] + ((size_t) i * out->OutputStride);
+        uint32_t     y = thread->Batch.Labels[i];
+        assert(y < out->OutputCount);
+        for (j = 0; j < out->OutputCount; ++j) {
+            d[j] = p[j] * scale;
+        }
+        d[y] -= scale;
+        loss -= log(p[y] > MLP_MIN_PROBABILITY ? p[y] : MLP_MIN_PROBABILITY);
+    }
+
+    for (l = mlp->LayerCount; l-- > 0; ) {
+        MLP_LAYER    *layer = &mlp->Layers[l];
+        uint32_t     stride = layer->OutputStride;
+        float const  *delta = thread->Deltas[l];
+        float const      *x = (l == 0) ? thread->Batch.Inputs    : thread->Outputs[l - 1];
+        uint32_t        ldx = (l == 0) ? thread->Batch.RowStride : mlp->Layers[l - 1].OutputStride;
+
+        if (l > 0) {
+            /* delta for the previous layer = (delta * W^T) masked by the ReLU derivative */
+            MLP_LAYER const *prev = &mlp->Layers[l - 1];
+            float       *prev_d = thread->Deltas[l - 1];
+            (void) GemmF32(GEMM_OP_NONE, GEMM_OP_TRANSPOSE, count, layer->InputCount, layer->OutputCount,
+                           1.0f, delta, stride, layer->Weights, stride, 0.0f, prev_d, prev->OutputStride, thread->Workspace);
+            if (prev->Activation == MLP_ACTIVATION_RELU) {
+                for (i = 0; i < count; ++i) {
+                    float const *y = thread->Outputs[l - 1] + ((size_t) i * prev->OutputStride);
+                    float       *d = prev_d + ((size_t) i * prev->OutputStride);
+                    for (j = 0; j < prev->OutputCount; ++j) {
+                        d[j] = y[j] > 0.0f ? d[j] : 0.0f;
+                    }
+                }
+            }
+        }
+        if (l == 0 && nonzeros != NULL) {
+            /* W += x^T * delta scatters into the rows of the nonzero inputs, so the rows of the zero inputs are never written */
+            SparseGemmF32(GEMM_OP_TRANSPOSE, layer->OutputCount, nonzeros, delta, stride, 1.0f, layer->Weights, stride);
+        } else {
+            (void) GemmF32(GEMM_OP_TRANSPOSE, GEMM_OP_NONE, layer->InputCount, layer->OutputCount, count,
+                           1.0f, x, ldx, delta, stride, 1.0f, layer->Weights, stride, thread->Workspace);
+        }
+        for (i = 0; i < count; ++i) {
+            float const *d = delta + ((size_t) i * stride);
+            for (j = 0; j < layer->OutputCount; ++j) {
+                layer->Bias[j] += d[j];
+            }
+        }
+    }
+    return loss;
+}
+
+/* @summary Train on a range of the index slices of MlpTrainHogwild. Slice r contains indices [r * IndexCount / RangeCount, (r + 1) * IndexCount / RangeCount).
+ * @param argp Pointer to the MLP_HOGWILD_ARGS.
+ * @param begin The first slice index.
+ * @param end One past the last slice index.
+ * @param thread_index The index of the calling thread, selecting its scratch state.
+ */
+static void
+MlpHogwildRanges
+(
+    void          *argp,
+    uint32_t      begin,
+    uint32_t        end,
+    uint32_t thread_index
+)
+{
+    MLP_HOGWILD_ARGS const *args = (MLP_HOGWILD_ARGS const*) argp;
+    MLP                     *mlp = args->Network;
+    MLP_EVALUATE_THREAD  *thread = &args->Threads[thread_index];
+    uint32_t r;
+
+    for (r = begin; r < end; ++r) {
+        uint32_t first = (uint32_t)(((uint64_t) r       * args->IndexCount) / args->RangeCount);
+        uint32_t  last = (uint32_t)(((uint64_t)(r + 1) * args->IndexCount) / args->RangeCount);
+        while (first < last) {
+            uint32_t count = last - first;
+            if (count > args->BatchSize) {
+                count = args->BatchSize;
+            }
+            MinibatchGather(&thread->Batch, args->Source, args->Indices + first, count);
+            MlpForwardLayers(mlp, thread->Outputs, NULL, thread->Batch.Inputs, thread->Batch.RowStride, MlpBatchNonzeros(&thread->Batch), count, NULL, thread->Workspace);
+            thread->Loss += MlpHogwildStep(mlp, thread, MlpBatchNonzeros(&thread->Batch), count, args->LearningRate);
+            first += count;
+        }
+    }
+}
+
+/* @summary Compute the capacity of the frame arena needed to train on a batch, or to evaluate or train asynchronously with a given number of threads.
+ * @param mlp The network, with its layers initialized.
+ * @param thread_count The number of threads that may run MlpEvaluate or MlpTrainHogwild tasks.
+ * @param precision The storage format of the hidden activations, one of the values of the CONVERT_TYPE enumeration.
+ * @return The required frame arena capacity, in bytes.
+ */
+static size_t
+MlpFrameSize
+(
+    MLP const          *mlp,
+    uint32_t   thread_count,
+    uint32_t      precision
+)
+{
+    size_t train = MlpActivationSize(mlp, precision, mlp->MaxBatchSize);
+    size_t  eval = AlignUp(thread_count * sizeof(MLP_EVALUATE_THREAD), (size_t) MLP_ALIGNMENT) + (thread_count * MlpEvaluateThreadSize(mlp, precision));
+    uint32_t   l;
+    for (l = 0; l < mlp->LayerCount; ++l) {
+        train += MlpBufferSize((size_t) mlp->MaxBatchSize * mlp->Layers[l].OutputStride); /* Deltas */
+    }
+    return train > eval ? train : eval;
+}
+
+/* @summary Reset the frame arena and allocate the activation and delta buffers of every layer for a batch.
+ * @param mlp The network.
+ * @param count The number of rows in the batch, at most MaxBatchSize.
+ */
+static void
+MlpBeginFrame
+(
+    MLP        *mlp,
+    uint32_t   count
+)
+{
+    float         *outputs[MLP_MAX_LAYERS];
+    uint16_t *outputs_half[MLP_MAX_LAYERS];
+    uint32_t                l;
+    int                   res;
+
+    ArenaReset(&mlp->Frame);
+    /* the frame arena is sized for MaxBatchSize rows in MlpCreate and MlpSetPrecision */
+    res = MlpAllocateActivations(outputs, outputs_half, mlp, &mlp->Frame, count);
+    assert(res == 0); (void) res;
+    for (l = 0; l < mlp->LayerCount; ++l) {
+        MLP_LAYER *layer   = &mlp->Layers[l];
+        layer->Outputs     = outputs[l];
+        layer->OutputsHalf = outputs_half[l];
+        layer->Deltas      = (float*) ArenaAllocate(&mlp->Frame, MlpBufferSize((size_t) count * layer->OutputStride), MLP_ALIGNMENT);
+        assert(layer->Deltas != NULL);
+    }
+}
+
+MNIST_API(int)
+MlpCreate
+(
+    struct MLP              *o_mlp,
+    uint32_t const    *layer_sizes,
+    uint32_t            size_count,
+    uint32_t        max_batch_size,
+    uint64_t                  seed
+)
+{
+    uint64_t   rng = seed ? seed : 0x9E3779B97F4A7C15ULL;
+    size_t   total = 0;
+    size_t  wsfloats;
+    uint32_t max_rows;
+    uint32_t     l;
+    size_t       i;
+
+    assert(o_mlp != NULL);
+    memset(o_mlp, 0, sizeof(MLP));
+
+    if (layer_sizes == NULL || size_count < 2 || size_count > MLP_MAX_LAYERS + 1 || max_batch_size == 0) {
+        errno = EINVAL;
+        return -1;
+    }
+    for (l = 0; l < size_count; ++l) {
+        if (layer_sizes[l] == 0) {
+            errno = EINVAL;
+            return -1;
+        }
+    }
+    /* the parallel GEMM packs all rows of op(A): the batch in the forward pass, and the layer inputs for dW */
+    max_rows = max_batch_size;
+    for (l = 0; l + 1 < size_count; ++l) {
+        max_rows = layer_sizes[l] > max_rows ? layer_sizes[l] : max_rows;
+    }
+    wsfloats = GEMM_PARALLEL_WORKSPACE_FLOATS(max_rows);
+    wsfloats = wsfloats > GEMM_WORKSPACE_FLOATS ? wsfloats : GEMM_WORKSPACE_FLOATS;
+    total   += MlpBufferSize(wsfloats);
+    for (l = 0; l + 1 < size_count; ++l) {
+        size_t nin    = layer_sizes[l];
+        size_t stride = AlignUp((size_t) layer_sizes[l + 1], MLP_ALIGNMENT / sizeof(float));
+        total += 2 * MlpBufferSize(nin * stride);            /* Weights, WeightGrad */
+        total += 2 * MlpBufferSize(stride);                  /* Bias, BiasGrad */
+    }
+    /* the storage arena is sized exactly, and fresh arena memory is zeroed, which keeps every padding column zero */
+    if (ArenaCreate(&o_mlp->Storage, total, ARENA_FLAG_HUGE_PAGES) != 0) {
+        return -1;
+    }
+    o_mlp->Workspace = (float*) ArenaAllocate(&o_mlp->Storage, MlpBufferSize(wsfloats), MLP_ALIGNMENT);
+    for (l = 0; l + 1 < size_count; ++l) {
+        MLP_LAYER *layer = &o_mlp->Layers[l];
+        uint32_t     nin = layer_sizes[l];
+        uint32_t    nout = layer_sizes[l + 1];
+        uint32_t  stride = AlignUp(nout, (uint32_t)(MLP_ALIGNMENT / sizeof(float)));
+        float      limit = sqrtf(6.0f / (float) nin);
+
+        layer->InputCount   = nin;
+        layer->OutputCount  = nout;
+        layer->OutputStride = stride;
+        layer->Activation   = (l + 2 == size_count) ? MLP_ACTIVATION_SOFTMAX : MLP_ACTIVATION_RELU;
+        layer->Weights      = (float*) ArenaAllocate(&o_mlp->Storage, MlpBufferSize((size_t) nin * stride), MLP_ALIGNMENT);
+        layer->WeightGrad   = (float*) ArenaAllocate(&o_mlp->Storage, MlpBufferSize((size_t) nin * stride), MLP_ALIGNMENT);
+        layer->Bias         = (float*) ArenaAllocate(&o_mlp->Storage, MlpBufferSize(stride), MLP_ALIGNMENT);
+        layer->BiasGrad     = (float*) ArenaAllocate(&o_mlp->Storage, MlpBufferSize(stride), MLP_ALIGNMENT);
+        for (i = 0; i < nin; ++i) {
+            float   *row = layer->Weights + (i * stride);
+            uint32_t   j;
+            for (j = 0; j < nout; ++j) {
+                row[j] = limit * RandomUniform(&rng);
+            }
+        }
+    }
+    o_mlp->LayerCount   = size_count - 1;
+    o_mlp->InputCount   = layer_sizes[0];
+    o_mlp->OutputCount  = layer_sizes[size_count - 1];
+    o_mlp->MaxBatchSize = max_batch_size;
+    if (ArenaCreate(&o_mlp->Frame, MlpFrameSize(o_mlp, 1, CONVERT_TYPE_F32), ARENA_FLAG_HUGE_PAGES) != 0) {
+        ArenaDelete(&o_mlp->Storage);
+        memset(o_mlp, 0, sizeof(MLP));
+        return -1;
+    }
+    return 0;
+}
+
+MNIST_API(void)
+MlpDelete
+(
+    struct MLP *mlp
+)
+{
+    if (mlp != NULL) {
+        ArenaDelete(&mlp->HalfStorage);
+        ArenaDelete(&mlp->Frame);
+        ArenaDelete(&mlp->Storage);
+        memset(mlp, 0, sizeof(MLP));
+    }
+}
+
+MNIST_API(int)
+MlpSetTaskPool
+(
+    struct MLP        *mlp,
+    struct TASK_POOL *pool
+)
+{
+    size_t need = MlpFrameSize(mlp, TaskPoolThreadCount(pool), mlp->Precision);
+    if (need > mlp->Frame.Capacity) {
+        MEMORY_ARENA frame;
+        if (ArenaCreate(&frame, need, ARENA_FLAG_HUGE_PAGES) != 0) {
+            return -1;
+        }
+        frame.HighWatermark = mlp->Frame.HighWatermark;
+        ArenaDelete(&mlp->Frame);
+        mlp->Frame = frame;
+    }
+    mlp->TaskPool = pool;
+    return 0;
+}
+
+MNIST_API(int)
+MlpSetPrecision
+(
+    struct MLP        *mlp,
+    uint32_t     precision
+)
+{
+    MEMORY_ARENA half;
+    size_t       need = 0;
+    size_t      total = 0;
+    uint32_t        l;
+
+    if (precision >= CONVERT_TYPE_COUNT || mlp->LayerCount == 0) {
+        errno = EINVAL;
+        return -1;
+    }
+    need = MlpFrameSize(mlp, TaskPoolThreadCount(mlp->TaskPool), precision);
+    if (precision == CONVERT_TYPE_F32) {
+        ArenaDelete(&mlp->HalfStorage);
+        for (l = 0; l < mlp->LayerCount; ++l) {
+            mlp->Layers[l].WeightsHalf = NULL;
+            mlp->Layers[l].OutputsHalf = NULL;
+        }
+        mlp->Precision = CONVERT_TYPE_F32;
+        return 0;
+    }
+    for (l = 0; l < mlp->LayerCount; ++l) {
+        total += MlpHalfBufferSize((size_t) mlp->Layers[l].InputCount * mlp->Layers[l].OutputStride);
+    }
+    memset(&half, 0, sizeof(MEMORY_ARENA));
+    if (mlp->HalfStorage.Capacity < total && ArenaCreate(&half, total, ARENA_FLAG_HUGE_PAGES) != 0) {
+        return -1;
+    }
+    if (need > mlp->Frame.Capacity) {
+        MEMORY_ARENA frame;
+        if (ArenaCreate(&frame, need, ARENA_FLAG_HUGE_PAGES) != 0) {
+            ArenaDelete(&half);
+            return -1;
+        }
+        frame.HighWatermark = mlp->Frame.HighWatermark;
+        ArenaDelete(&mlp->Frame);
+        mlp->Frame = frame;
+    }
+    if (half.Capacity > 0) {
+        ArenaDelete(&mlp->HalfStorage);
+        mlp->HalfStorage = half;
+    }
+    /* converting the master weights also keeps the padding columns of the 16-bit copy zero */
+    ArenaReset(&mlp->HalfStorage);
+    for (l = 0; l < mlp->LayerCount; ++l) {
+        MLP_LAYER *layer = &mlp->Layers[l];
+        size_t         n = (size_t) layer->InputCount * layer->OutputStride;
+        layer->WeightsHalf = (uint16_t*) ArenaAllocate(&mlp->HalfStorage, MlpHalfBufferSize(n), MLP_ALIGNMENT);
+        ConvertF32ToHalf(layer->WeightsHalf, layer->Weights, n, precision);
+    }
+    mlp->Precision = precision;
+    return 0;
+}
+
+MNIST_API(void)
+MlpForward
+(
+    struct MLP           *mlp,
+    float const       *inputs,
+    uint32_t     input_stride,
+    uint32_t            count
+)
+{
+    float       *outputs[MLP_MAX_LAYERS];
+    uint16_t *outputs_half[MLP_MAX_LAYERS];
+    uint32_t            l;
+
+    assert(count <= mlp->MaxBatchSize);
+    MlpBeginFrame(mlp, count);
+    for (l = 0; l < mlp->LayerCount; ++l) {
+        outputs[l]      = mlp->Layers[l].Outputs;
+        outputs_half[l] = mlp->Layers[l].OutputsHalf;
+    }
+    MlpForwardLayers(mlp, outputs, mlp->Precision != CONVERT_TYPE_F32 ? outputs_half : NULL, inputs, input_stride, NULL, count, mlp->TaskPool, mlp->Workspace);
+}
+
+/* @summary Run the backward pass for the batch most recently passed to the forward pass.
+ * @param mlp The network.
+ * @param inputs The input rows passed to the forward pass.
+ * @param input_stride The distance between the start of consecutive input rows, in floats.
+ * @param nonzeros_t An optional sparse encoding of the transpose of the input rows. If non-NULL, the weight gradient of the first layer uses the sparse product instead of GEMM.
+ * @param labels The class label of each input row.
+ * @param count The number of input rows.
+ * @return The mean cross-entropy loss over the batch.
+ */
+static float
+MlpBackwardLayers
+(
+    MLP                  *mlp,
+    float const       *inputs,
+    uint32_t     input_stride,
+    SPARSE_CSR const *nonzeros_t,
+    uint8_t const     *labels,
+    uint32_t            count
+)
+{
+    MLP_LAYER  *out = &mlp->Layers[mlp->LayerCount - 1];
+    float const inv = 1.0f / (float) count;
+    double     loss = 0.0;
+    uint32_t  l, i, j;
+
+    assert(count > 0 && count <= mlp->MaxBatchSize);
+
+    /* softmax with cross-entropy: dL/dz = (p - onehot(label)) / count */
+    for (i = 0; i < count; ++i) {
+        float const *p = out->Outputs + ((size_t) i * out->OutputStride);
+        float       *d = out->Deltas  + ((size_t) i * out->OutputStride);
+        uint32_t     y = labels[i];
+        assert(y < out->OutputCount);
+        for (j = 0; j < out->OutputCount; ++j) {
+            d[j] = p[j] * inv;
+        }
+        d[y] -= inv;
+        loss -= log(p[y] > MLP_MIN_PROBABILITY ? p[y] : MLP_MIN_PROBABILITY);
+    }
+
+    for (l = mlp->LayerCount; l-- > 0; ) {
+        MLP_LAYER   *layer = &mlp->Layers[l];
+        uint32_t    stride = layer->OutputStride;
+        float const     *x = (l == 0) ? inputs       : mlp->Layers[l - 1].Outputs;
+        uint32_t       ldx = (l == 0) ? input_stride : mlp->Layers[l - 1].OutputStride;
+        uint32_t      half = mlp->Precision;
+
+        /* dW = x^T * delta, db = column sums of delta */
+        if (l == 0 && nonzeros_t != NULL) {
+            SparseGemmF32Parallel(mlp->TaskPool, GEMM_OP_NONE, layer->OutputCount, nonzeros_t, layer->Deltas, stride, 0.0f, layer->WeightGrad, stride);
+        } else if (l > 0 && half != CONVERT_TYPE_F32) {
+            (void) GemmMixedParallel(mlp->TaskPool, half, GEMM_OP_TRANSPOSE, CONVERT_TYPE_F32, GEMM_OP_NONE, layer->InputCount, layer->OutputCount, count,
+                                     1.0f, mlp->Layers[l - 1].OutputsHalf, ldx, layer->Deltas, stride, 0.0f, layer->WeightGrad, stride, mlp->Workspace);
+        } else {
+            (void) GemmF32Parallel(mlp->TaskPool, GEMM_OP_TRANSPOSE, GEMM_OP_NONE, layer->InputCount, layer->OutputCount, count,
+                                   1.0f, x, ldx, layer->Deltas, stride, 0.0f, layer->WeightGrad, stride, mlp->Workspace);
+        }
+        memset(layer->BiasGrad, 0, stride * sizeof(float));
+        for (i = 0; i < count; ++i) {
+            float const *d = layer->Deltas + ((size_t) i * stride);
+            for (j = 0; j < layer->OutputCount; ++j) {
+                layer->BiasGrad[j] += d[j];
+            }
+        }
+        if (l > 0) {
+            /* delta for the previous layer = (delta * W^T) masked by the ReLU derivative */
+            MLP_LAYER *prev = &mlp->Layers[l - 1];
+            if (half != CONVERT_TYPE_F32) {
+                (void) GemmMixedParallel(mlp->TaskPool, CONVERT_TYPE_F32, GEMM_OP_NONE, half, GEMM_OP_TRANSPOSE, count, layer->InputCount, layer->OutputCount,
+                                         1.0f, layer->Deltas, stride, layer->WeightsHalf, stride, 0.0f, prev->Deltas, prev->OutputStride, mlp->Workspace);
+            } else {
+                (void) GemmF32Parallel(mlp->TaskPool, GEMM_OP_NONE, GEMM_OP_TRANSPOSE, count, layer->InputCount, layer->OutputCount,
+                                       1.0f, layer->Deltas, stride, layer->Weights, stride, 0.0f, prev->Deltas, prev->OutputStride, mlp->Workspace);
+            }
+            if (prev->Activation == MLP_ACTIVATION_RELU && prev->OutputsHalf != NULL) {
+                /* ReLU outputs are never negative, so a nonzero 16-bit value marks exactly the units the next layer saw as active */
+                for (i = 0; i < count; ++i) {
+                    uint16_t const *y = prev->OutputsHalf + ((size_t) i * prev->OutputStride);
+                    float          *d = prev->Deltas      + ((size_t) i * prev->OutputStride);
+                    for (j = 0; j < prev->OutputCount; ++j) {
+                        d[j] = y[j] != 0 ? d[j] : 0.0f;
+                    }
+                }
+            } else if (prev->Activation == MLP_ACTIVATION_RELU) {
+                for (i = 0; i < count; ++i) {
+                    float const *y = prev->Outputs + ((size_t) i * prev->OutputStride);
+                    float       *d = prev->Deltas  + ((size_t) i * prev->OutputStride);
+                    for (j = 0; j < prev->OutputCount; ++j) {
+                        d[j] = y[j] > 0.0f ? d[j] : 0.0f;
+                    }
+                }
+            }
+        }
+    }
+    return (float)(loss / count);
+}
+
+MNIST_API(float)
+MlpBackward
+(
+    struct MLP           *mlp,
+    float const       *inputs,
+    uint32_t     input_stride,
+    uint8_t const     *labels,
+    uint32_t            count
+)
+{
+    return MlpBackwardLayers(mlp, inputs, input_stride, NULL, labels, count);
+}
+
+MNIST_API(void)
+MlpUpdate
+(
+    struct MLP           *mlp,
+    float       learning_rate
+)
+{
+    uint32_t l;
+    size_t   i, j, n;
+
+    for (l = 0; l < mlp->LayerCount; ++l) {
+        MLP_LAYER *layer = &mlp->Layers[l];
+        float         *w = layer->Weights;
+        float const  *dw = layer->WeightGrad;
+        n = (size_t) layer->InputCount * layer->OutputStride;
+        if (mlp->Precision != CONVERT_TYPE_F32) {
+            /* refresh each chunk of the 16-bit copy while the updated master weights are still in cache */
+            for (i = 0; i < n; i += MLP_UPDATE_CHUNK) {
+                size_t end = (n - i) < MLP_UPDATE_CHUNK ? n : i + MLP_UPDATE_CHUNK;
+                for (j = i; j < end; ++j) {
+                    w[j] -= learning_rate * dw[j];
+                }
+                ConvertF32ToHalf(layer->WeightsHalf + i, w + i, end - i, mlp->Precision);
+            }
+        } else for (i = 0; i < n; ++i) {
+            w[i] -= learning_rate * dw[i];
+        }
+        for (i = 0; i < layer->OutputCount; ++i) {
+            layer->Bias[i] -= learning_rate * layer->BiasGrad[i];
+        }
+    }
+}
+
+MNIST_API(float)
+MlpTrainBatch
+(
+    struct MLP              *mlp,
+    struct MINIBATCH const *batch,
+    float           learning_rate
+)
+{
+    SPARSE_CSR const *nz = MlpBatchNonzeros(batch);
+    float         *outputs[MLP_MAX_LAYERS];
+    uint16_t *outputs_half[MLP_MAX_LAYERS];
+    float               loss;
+    uint32_t               l;
+
+    assert(batch->FeatureCount == mlp->InputCount);
+    assert(batch->SampleCount  <= mlp->MaxBatchSize);
+    MlpBeginFrame(mlp, batch->SampleCount);
+    for (l = 0; l < mlp->LayerCount; ++l) {
+        outputs[l]      = mlp->Layers[l].Outputs;
+        outputs_half[l] = mlp->Layers[l].OutputsHalf;
+    }
+    MlpForwardLayers(mlp, outputs, mlp->Precision != CONVERT_TYPE_F32 ? outputs_half : NULL, batch->Inputs, batch->RowStride, nz, batch->SampleCount, mlp->TaskPool, mlp->Workspace);
+    loss = MlpBackwardLayers(mlp, batch->Inputs, batch->RowStride, nz ? &batch->NonzerosByFeature : NULL, batch->Labels, batch->SampleCount);
+    MlpUpdate(mlp, learning_rate);
+    return loss;
+}
+
+MNIST_API(uint32_t)
+MlpPredict
+(
+    struct MLP const *mlp,
+    uint32_t          row
+)
+{
+    MLP_LAYER const *out = &mlp->Layers[mlp->LayerCount - 1];
+    float const       *p = out->Outputs + ((size_t) row * out->OutputStride);
+    uint32_t        best = 0;
+    uint32_t           j;
+    for (j = 1; j < out->OutputCount; ++j) {
+        if (p[j] > p[best]) {
+            best = j;
+        }
+    }
+    return best;
+}
+
+MNIST_API(int)
+MlpEvaluate
+(
+    struct MLP                      *mlp,
+    struct MINIBATCH_SOURCE const *source,
+    uint32_t                    *o_correct,
+    float                          *o_loss
+)
+{
+    MLP_EVALUATE_ARGS     args;
+    MLP_EVALUATE_THREAD *threads = NULL;
+    uint32_t        thread_count = TaskPoolThreadCount(mlp->TaskPool);
+    uint32_t         batch_count;
+    uint32_t             correct = 0;
+    double                  loss = 0.0;
+    uint32_t                t, l;
+
+    assert(o_correct != NULL);
+    *o_correct = 0;
+    if (o_loss != NULL) {
+        *o_loss = 0.0f;
+    }
+    assert(source->Dataset->ImageSize == mlp->InputCount);
+    /* evaluation scratch reuses the frame arena, so the activations of the last forward pass are discarded */
+    ArenaReset(&mlp->Frame);
+    if ((threads = (MLP_EVALUATE_THREAD*) ArenaAllocate(&mlp->Frame, thread_count * sizeof(MLP_EVALUATE_THREAD), MLP_ALIGNMENT)) == NULL) {
+        return -1;
+    }
+    for (t = 0; t < thread_count; ++t) {
+        if (MlpEvaluateThreadCreate(&threads[t], mlp, &mlp->Frame) != 0) {
+            return -1;
+        }
+    }
+    for (l = 0; l < mlp->LayerCount; ++l) {
+        mlp->Layers[l].Outputs     = NULL;
+        mlp->Layers[l].Deltas      = NULL;
+        mlp->Layers[l].OutputsHalf = NULL;
+    }
+    args.Network = mlp;
+    args.Source  = source;
+    args.Threads = threads;
+    batch_count  = (source->Dataset->SampleCount + mlp->MaxBatchSize - 1) / mlp->MaxBatchSize;
+    TaskPoolParallelFor(mlp->TaskPool, batch_count, 1, MlpEvaluateBatches, &args);
+    for (t = 0; t < thread_count; ++t) {
+        correct += threads[t].Correct;
+        loss    += threads[t].Loss;
+    }
+    *o_correct = correct;
+    if (o_loss != NULL && source->Dataset->SampleCount > 0) {
+        *o_loss = (float)(loss / source->Dataset->SampleCount);
+    }
+    return 0;
+}
+
+MNIST_API(int)
+MlpTrainHogwild
+(
+    struct MLP                      *mlp,
+    struct MINIBATCH_SOURCE const *source,
+    uint32_t const               *indices,
+    uint32_t                        count,
+    uint32_t                   batch_size,
+    float                   learning_rate,
+    float                          *o_loss
+)
+{
+    MLP_HOGWILD_ARGS      args;
+    MLP_EVALUATE_THREAD *threads = NULL;
+    uint32_t        thread_count = TaskPoolThreadCount(mlp->TaskPool);
+    double                  loss = 0.0;
+    uint32_t                t, l;
+
+    if (o_loss != NULL) {
+        *o_loss = 0.0f;
+    }
+    if (mlp->Precision != CONVERT_TYPE_F32) {
+        /* the lock-free updates are applied to the float32 weights, which the 16-bit copies would not see */
+        errno = ENOTSUP;
+        return -1;
+    }
+    if (batch_size == 0 || batch_size > mlp->MaxBatchSize) {
+        errno = EINVAL;
+        return -1;
+    }
+    assert(source->Dataset->ImageSize == mlp->InputCount);
+    /* the per-thread scratch reuses the frame arena, so the activations of the last forward pass are discarded */
+    ArenaReset(&mlp->Frame);
+    if ((threads = (MLP_EVALUATE_THREAD*) ArenaAllocate(&mlp->Frame, thread_count * sizeof(MLP_EVALUATE_THREAD), MLP_ALIGNMENT)) == NULL) {
+        errno = ENOMEM;
+        return -1;
+    }
+    for (t = 0; t < thread_count; ++t) {
+        if (MlpEvaluateThreadCreate(&threads[t], mlp, &mlp->Frame) != 0) {
+            errno = ENOMEM;
+            return -1;
+        }
+    }
+    for (l = 0; l < mlp->LayerCount; ++l) {
+        mlp->Layers[l].Outputs     = NULL;
+        mlp->Layers[l].Deltas      = NULL;
+        mlp->Layers[l].OutputsHalf = NULL;
+    }
+    /* one slice per thread; each thread updates the shared weights after every batch, with no barrier between threads */
+    args.Network      = mlp;
+    args.Source       = source;
+    args.Indices      = indices;
+    args.Threads      = threads;
+    args.IndexCount   = count;
+    args.RangeCount   = count < thread_count ? (count > 0 ? count : 1) : thread_count;
+    args.BatchSize    = batch_size;
+    args.LearningRate = learning_rate;
+    TaskPoolParallelFor(mlp->TaskPool, args.RangeCount, 1, MlpHogwildRanges, &args);
+    for (t = 0; t < thread_count; ++t) {
+        loss += threads[t].Loss;
+    }
+    if (o_loss != NULL && count > 0) {
+        *o_loss = (float)(loss / count);
+    }
+    return 0;
+}
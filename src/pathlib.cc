@@ -8,87 +8,471 @@
 #include <memory.h>
 #include <assert.h>
 #include <errno.h>
+#include "cpuinfo.h"
 #include "strlib.h"
+#include "arena.h"
 #include "pathlib.h"
 
-/* @summary Figure out the starting and ending points of the directory, filename and extension information in a Linux path string.
- * @oaram o_parts The PATH_PARTS_LINUX to update. The Root, RootEnd and PathFlags fields must be initialized by the caller.
- * @param strinfo Information about the input path string.
+#if CPU_ARCH_X86
+#   include <immintrin.h>
+#   if defined(_MSC_VER)
+#       include <intrin.h>
+#   endif
+#endif
+
+/* @summary Initialize a path buffer in storage of PATH_BUFFER_MAX_BYTES bytes. This is the common implementation of the path buffer creation functions.
+ * @param o_strinfo Pointer to an optional STRING_INFO that if supplied will be initialized with the attributes of the returned string.
+ * @param o_bufinfo Pointer to an optional STRING_INFO that if supplied will be initialized with the attributes of the returned buffer.
+ * @param storage The storage for the path buffer, or NULL to only check the length of the initial string.
+ * @param strinfo Pointer to an optional STRING_INFO that if supplied contains information about the string pointed to by strbuf.
+ * @param strbuf Pointer to an optional UTF-8 encoded, nul-terminated string that will be used as the initial contents of the buffer.
+ * @return Zero if the initial string fits in a path buffer, or -1 if it is too long (errno is ENAMETOOLONG).
  */
 static int
-LinuxPathExtractPathParts
+PathBufferInitStorage
 (
-    struct PATH_PARTS_LINUX *o_parts,
-    struct STRING_INFO      *strinfo
+    struct STRING_INFO *o_strinfo,
+    struct STRING_INFO *o_bufinfo,
+    char8_t              *storage,
+    struct STRING_INFO   *strinfo,
+    char8_t const         *strbuf
 )
 {
-    char8_t     *iter = strinfo->BufferEnd;
-    char8_t *path_end = strinfo->BufferEnd;
-    char8_t *extn_beg = strinfo->BufferEnd;
-    char8_t *extn_end = strinfo->BufferEnd;
-    char8_t *name_beg = o_parts->RootEnd;
-    char8_t *name_end = o_parts->RootEnd;
-    char8_t *dirs_beg = o_parts->RootEnd;
-    char8_t *dirs_end = o_parts->RootEnd;
-    uint32_t    flags = o_parts->PathFlags;
+    size_t init_bytes = UTF8_NUL_BYTES;
+    size_t init_chars = 0;
 
-    while (name_end < path_end) {
-        if (name_end[0] == '\\') { /* normalize to system standard */
-            name_end[0] = (char8_t) '/';
-        }
-        if (name_end[0] != '/') {
-            name_end = Utf8StringNextCodepoint(NULL, NULL, name_end);
+    if (strbuf != NULL) {
+        if (strinfo != NULL) {
+            init_bytes = strinfo->LengthBytes;
+            init_chars = strinfo->LengthChars;
         } else {
-            /* encountered a path separator.
-             * update the end of the directory path string.
-             * reset the filename string to be zero length.
-             */
-            dirs_end = name_end;
-            name_beg = name_end + 1;
-            name_end = name_end + 1;
-            flags   |= PATH_FLAG_DIRECTORY;
+            (void) Utf8StringValidate(&init_bytes, &init_chars, strbuf);
+            init_bytes += UTF8_NUL_BYTES;
+        }
+    }
+    if (init_bytes > PATH_BUFFER_MAX_BYTES) {
+        if (o_strinfo) {
+            memset(o_strinfo, 0, sizeof(STRING_INFO));
+        }
+        if (o_bufinfo) {
+            memset(o_bufinfo, 0, sizeof(STRING_INFO));
+        } errno = ENAMETOOLONG;
+        return -1;
+    }
+    if (storage == NULL) {
+        return 0;
+    }
+    if (strbuf != NULL) {
+        /* copy the input string, including nul */
+        memcpy(storage, strbuf, init_bytes);
+    } else {
+        storage[0] = 0;
+    }
+    storage[PATH_BUFFER_MAX_BYTES-1] = 0;
+    if (o_strinfo) {
+        o_strinfo->Buffer      = storage;
+        o_strinfo->BufferEnd   = storage + init_bytes;
+        o_strinfo->LengthBytes = init_bytes;
+        o_strinfo->LengthChars = init_chars;
+    }
+    if (o_bufinfo) {
+        o_bufinfo->Buffer      = storage;
+        o_bufinfo->BufferEnd   = storage + PATH_BUFFER_MAX_BYTES;
+        o_bufinfo->LengthBytes = PATH_BUFFER_MAX_BYTES;
+        o_bufinfo->LengthChars =(PATH_BUFFER_MAX_BYTES - UTF8_NUL_BYTES) / UTF8_MAX_BYTES_PER_CODEPOINT;
+    }
+    return 0;
+}
+
+/* @summary Measure the initial string of a path buffer, so that the length check and the copy share a single validation pass.
+ * @param o_info The STRING_INFO to initialize if the string must be measured.
+ * @param strinfo Pointer to an optional STRING_INFO that if supplied contains information about the string pointed to by strbuf.
+ * @param strbuf Pointer to an optional UTF-8 encoded, nul-terminated string that will be used as the initial contents of the buffer.
+ * @return strinfo if it is supplied or strbuf is NULL, otherwise o_info.
+ */
+static STRING_INFO*
+PathBufferMeasure
+(
+    struct STRING_INFO  *o_info,
+    struct STRING_INFO *strinfo,
+    char8_t const       *strbuf
+)
+{
+    if (strinfo != NULL || strbuf == NULL) {
+        return strinfo;
+    }
+    (void) Utf8StringValidate(&o_info->LengthBytes, &o_info->LengthChars, strbuf);
+    o_info->LengthBytes += UTF8_NUL_BYTES;
+    o_info->Buffer       = (char8_t*) strbuf;
+    o_info->BufferEnd    = (char8_t*) strbuf + o_info->LengthBytes;
+    return o_info;
+}
+
+/* @summary Allocate a path buffer from the heap.
+ * @return A pointer to the buffer, or NULL if memory allocation failed or the initial string is too long.
+ */
+static char8_t*
+PathBufferCreateHeap
+(
+    struct STRING_INFO *o_strinfo,
+    struct STRING_INFO *o_bufinfo,
+    struct STRING_INFO   *strinfo,
+    char8_t const         *strbuf
+)
+{
+    STRING_INFO  info;
+    char8_t     *buf = NULL;
+
+    strinfo = PathBufferMeasure(&info, strinfo, strbuf);
+    if (PathBufferInitStorage(o_strinfo, o_bufinfo, NULL, strinfo, strbuf) != 0) {
+        return NULL;
+    }
+    if ((buf = (char8_t*) malloc(PATH_BUFFER_MAX_BYTES)) == NULL) {
+        if (o_strinfo) {
+            memset(o_strinfo, 0, sizeof(STRING_INFO));
+        }
+        if (o_bufinfo) {
+            memset(o_bufinfo, 0, sizeof(STRING_INFO));
+        } return NULL;
+    }
+    (void) PathBufferInitStorage(o_strinfo, o_bufinfo, buf, strinfo, strbuf);
+    return buf;
+}
+
+/* @summary Allocate a path buffer from a memory arena. Nothing is allocated if the initial string is too long.
+ * @return A pointer to the buffer, or NULL if the arena is full or the initial string is too long.
+ */
+static char8_t*
+PathBufferCreateArena
+(
+    struct STRING_INFO  *o_strinfo,
+    struct STRING_INFO  *o_bufinfo,
+    struct MEMORY_ARENA     *arena,
+    struct STRING_INFO    *strinfo,
+    char8_t const          *strbuf
+)
+{
+    STRING_INFO  info;
+    char8_t     *buf = NULL;
+
+    strinfo = PathBufferMeasure(&info, strinfo, strbuf);
+    if (PathBufferInitStorage(o_strinfo, o_bufinfo, NULL, strinfo, strbuf) != 0) {
+        return NULL;
+    }
+    if ((buf = (char8_t*) ArenaAllocate(arena, PATH_BUFFER_MAX_BYTES, 0)) == NULL) {
+        if (o_strinfo) {
+            memset(o_strinfo, 0, sizeof(STRING_INFO));
         }
+        if (o_bufinfo) {
+            memset(o_bufinfo, 0, sizeof(STRING_INFO));
+        } return NULL;
+    }
+    (void) PathBufferInitStorage(o_strinfo, o_bufinfo, buf, strinfo, strbuf);
+    return buf;
+}
+
+/* @summary Define the number of bytes examined by one call to a path scanning kernel.
+ */
+#ifndef PATH_SCAN_BLOCK_SIZE
+#define PATH_SCAN_BLOCK_SIZE    32
+#endif
+
+/* @summary Define a value used to mark a missing separator or dot offset while scanning a path.
+ */
+#ifndef PATH_SCAN_NONE
+#define PATH_SCAN_NONE          0xFFFFFFFFU
+#endif
+
+/* @summary Define the signature of a path scanning kernel, which classifies the bytes of one PATH_SCAN_BLOCK_SIZE-byte block.
+ * @param o_nul On return, bit i is set if byte i is a nul.
+ * @param o_sep On return, bit i is set if byte i is a forward or backward slash.
+ * @param o_dot On return, bit i is set if byte i is a period.
+ * @param block The bytes to classify.
+ */
+typedef void (*PATH_SCAN_BLOCK_FUNC)
+(
+    uint32_t     *o_nul,
+    uint32_t     *o_sep,
+    uint32_t     *o_dot,
+    uint8_t const *block
+);
+
+static void
+PathScanBlock_Scalar
+(
+    uint32_t     *o_nul,
+    uint32_t     *o_sep,
+    uint32_t     *o_dot,
+    uint8_t const *block
+)
+{
+    uint32_t nul = 0;
+    uint32_t sep = 0;
+    uint32_t dot = 0;
+    uint32_t   i;
+    for (i = 0; i < PATH_SCAN_BLOCK_SIZE; ++i) {
+        nul |= (uint32_t)(block[i] == 0   ) << i;
+        sep |= (uint32_t)(block[i] == '/' || block[i] == '\\') << i;
+        dot |= (uint32_t)(block[i] == '.' ) << i;
+    }
+   *o_nul = nul;
+   *o_sep = sep;
+   *o_dot = dot;
+}
+
+#if CPU_ARCH_X86
+static CPU_TARGET("sse2") void
+PathScanBlock_SSE2
+(
+    uint32_t     *o_nul,
+    uint32_t     *o_sep,
+    uint32_t     *o_dot,
+    uint8_t const *block
+)
+{
+    __m128i const zero = _mm_setzero_si128();
+    __m128i const  fwd = _mm_set1_epi8('/');
+    __m128i const  bwd = _mm_set1_epi8('\\');
+    __m128i const  per = _mm_set1_epi8('.');
+    __m128i const   lo = _mm_loadu_si128((__m128i const*)(block     ));
+    __m128i const   hi = _mm_loadu_si128((__m128i const*)(block + 16));
+   *o_nul = (uint32_t) _mm_movemask_epi8(_mm_cmpeq_epi8(lo, zero)) | ((uint32_t) _mm_movemask_epi8(_mm_cmpeq_epi8(hi, zero)) << 16);
+   *o_sep = (uint32_t) _mm_movemask_epi8(_mm_or_si128(_mm_cmpeq_epi8(lo, fwd), _mm_cmpeq_epi8(lo, bwd))) |
+           ((uint32_t) _mm_movemask_epi8(_mm_or_si128(_mm_cmpeq_epi8(hi, fwd), _mm_cmpeq_epi8(hi, bwd))) << 16);
+   *o_dot = (uint32_t) _mm_movemask_epi8(_mm_cmpeq_epi8(lo, per)) | ((uint32_t) _mm_movemask_epi8(_mm_cmpeq_epi8(hi, per)) << 16);
+}
+
+static CPU_TARGET("avx2") void
+PathScanBlock_AVX2
+(
+    uint32_t     *o_nul,
+    uint32_t     *o_sep,
+    uint32_t     *o_dot,
+    uint8_t const *block
+)
+{
+    __m256i const    v = _mm256_loadu_si256((__m256i const*) block);
+   *o_nul = (uint32_t) _mm256_movemask_epi8(_mm256_cmpeq_epi8(v, _mm256_setzero_si256()));
+   *o_sep = (uint32_t) _mm256_movemask_epi8(_mm256_or_si256(_mm256_cmpeq_epi8(v, _mm256_set1_epi8('/')), _mm256_cmpeq_epi8(v, _mm256_set1_epi8('\\'))));
+   *o_dot = (uint32_t) _mm256_movemask_epi8(_mm256_cmpeq_epi8(v, _mm256_set1_epi8('.')));
+}
+#endif /* CPU_ARCH_X86 */
+
+/* @summary Select the fastest path scanning kernel supported by the host CPU.
+ * @return The kernel function.
+ */
+static PATH_SCAN_BLOCK_FUNC
+PathScanKernel
+(
+    void
+)
+{
+#if CPU_ARCH_X86
+    uint32_t cpu = CpuFeatureFlags();
+    if (cpu & CPU_FEATURE_AVX2) {
+        return PathScanBlock_AVX2;
+    }
+    if (cpu & CPU_FEATURE_SSE2) {
+        return PathScanBlock_SSE2;
     }
-    if (dirs_beg[0] == '/') {
+#endif
+    return PathScanBlock_Scalar;
+}
+
+/* @summary Find the index of the least-significant set bit of a non-zero value.
+ * @param mask The value to search. Must be non-zero.
+ * @return The zero-based index of the lowest set bit.
+ */
+static inline uint32_t
+PathLowestSetBit
+(
+    uint32_t mask
+)
+{
+#if defined(_MSC_VER)
+    unsigned long index;
+    _BitScanForward(&index, mask);
+    return (uint32_t) index;
+#else
+    return (uint32_t) __builtin_ctz(mask);
+#endif
+}
+
+/* @summary Define the state carried between the bytes of the path string being scanned by LinuxPathScanStrings.
+ */
+typedef struct PATH_SCAN_STATE {
+    uint32_t                     Start;                                        /* The offset of the first byte of the path string. */
+    uint32_t                     RootEnd;                                      /* The offset one-past the root component; the root is a leading forward slash. */
+    uint32_t                     LastSep;                                      /* The offset of the last separator following the root, or PATH_SCAN_NONE. */
+    uint32_t                     FirstDot;                                     /* The offset of the first period in the current component, not counting a leading period, or PATH_SCAN_NONE. */
+} PATH_SCAN_STATE;
+
+/* @summary Begin scanning the path string at a given offset.
+ * @param state The scanning state to reset.
+ * @param blob The packed path strings.
+ * @param start The offset of the first byte of the path string. The byte must not have been normalized yet.
+ */
+static inline void
+LinuxPathScanBegin
+(
+    PATH_SCAN_STATE *state,
+    char8_t const    *blob,
+    uint32_t         start
+)
+{
+    state->Start    = start;
+    state->RootEnd  = start + (blob[start] == '/' ? 1 : 0);
+    state->LastSep  = PATH_SCAN_NONE;
+    state->FirstDot = PATH_SCAN_NONE;
+}
+
+/* @summary Store the components of a scanned path string. This is the logic of LinuxPathStringParse expressed with offsets.
+ * The filename is the text after the last separator. It has an extension if it contains a period other than at its first byte, and the first such period separates the two.
+ * A final component without an extension is treated as part of the directory tree. End offsets that reach the end of the string point one-past the nul.
+ * @param batch The batch receiving the components.
+ * @param index The zero-based index of the path within the batch.
+ * @param state The state at the end of the path string.
+ * @param blob The packed path strings.
+ * @param nul The offset of the nul terminating the path string.
+ */
+static void
+LinuxPathScanEnd
+(
+    PATH_PARTS_LINUX_BATCH *batch,
+    uint32_t                index,
+    PATH_SCAN_STATE const  *state,
+    char8_t const           *blob,
+    uint32_t                  nul
+)
+{
+    uint32_t      end = nul + 1;
+    uint32_t     dirs = state->RootEnd;
+    uint32_t dirs_end = state->RootEnd;
+    uint32_t     name = state->RootEnd;
+    uint32_t name_end = end;
+    uint32_t     extn = end;
+    uint32_t    flags;
+
+    if (nul == state->Start) {
+        batch->Root        [index] = state->Start;
+        batch->RootEnd     [index] = end;
+        batch->Path        [index] = end;
+        batch->PathEnd     [index] = end;
+        batch->Filename    [index] = end;
+        batch->FilenameEnd [index] = end;
+        batch->Extension   [index] = end;
+        batch->ExtensionEnd[index] = end;
+        batch->PathFlags   [index] = PATH_FLAG_INVALID;
+        return;
+    }
+    flags = (state->RootEnd != state->Start) ? (PATH_FLAG_ABSOLUTE | PATH_FLAG_ROOT) : PATH_FLAG_RELATIVE;
+    if (state->LastSep != PATH_SCAN_NONE) {
+        dirs_end = state->LastSep;
+        name     = state->LastSep + 1;
+        flags   |= PATH_FLAG_DIRECTORY;
+    }
+    if (blob[dirs] == '/') {
         /* skip the leading path separator */
-        if (dirs_beg == dirs_end) {
+        if (dirs == dirs_end) {
             /* there is no actual path component - something like "/" */
             flags &= ~PATH_FLAG_DIRECTORY;
             dirs_end++;
         }
-        dirs_beg++;
+        dirs++;
     }
-    if (name_beg != name_end) {
-        /* is this a filename or part of the directory path?
-         * consider 'a.b' and '.a.b' and 'a.' to be filenames, but not '.a'.
-         */
-        while (iter >= name_beg) {
-            if (*iter == '.' && iter != name_beg) {
-                name_end = iter;
-                extn_beg = iter + 1;
-                flags    = PATH_FLAG_FILENAME | PATH_FLAG_EXTENSION | flags;
-            }
-            iter = Utf8StringPrevCodepoint(NULL, NULL, iter);
+    if (state->FirstDot != PATH_SCAN_NONE) {
+        name_end = state->FirstDot;
+        extn     = state->FirstDot + 1;
+        flags   |= PATH_FLAG_FILENAME | PATH_FLAG_EXTENSION;
+    } else {
+        dirs_end = end;
+        name     = end;
+        flags   |= PATH_FLAG_DIRECTORY;
+    }
+    batch->Root        [index] = state->Start;
+    batch->RootEnd     [index] = state->RootEnd;
+    batch->Path        [index] = dirs;
+    batch->PathEnd     [index] = dirs_end;
+    batch->Filename    [index] = name;
+    batch->FilenameEnd [index] = name_end;
+    batch->Extension   [index] = extn;
+    batch->ExtensionEnd[index] = end;
+    batch->PathFlags   [index] = flags;
+}
+
+/* @summary Parse packed, nul-terminated Linux-style path strings in one pass, normalizing backslashes to forward slashes in place.
+ * Each block is classified by a vector kernel, and only the nul, separator and period bytes are visited individually.
+ * @param batch The batch receiving the components. PathCount is updated with the number of paths parsed, up to Capacity.
+ * @param blob The packed path strings.
+ * @param blob_bytes The number of bytes in blob. Must be less than 4 GB.
+ * @return The number of bytes consumed, which is one-past the nul of the last path parsed.
+ */
+static size_t
+LinuxPathScanStrings
+(
+    PATH_PARTS_LINUX_BATCH *batch,
+    char8_t                 *blob,
+    size_t             blob_bytes
+)
+{
+    PATH_SCAN_BLOCK_FUNC scan = PathScanKernel();
+    PATH_SCAN_STATE     state;
+    uint8_t             block[PATH_SCAN_BLOCK_SIZE];
+    uint32_t const     nbytes =(uint32_t) blob_bytes;
+    uint32_t            count = 0;
+    uint32_t         consumed = 0;
+    uint32_t             base;
+
+    batch->Base      = blob;
+    batch->PathCount = 0;
+    if (nbytes == 0 || batch->Capacity == 0) {
+        return 0;
+    }
+    LinuxPathScanBegin(&state, blob, 0);
+    for (base = 0; base < nbytes; base += PATH_SCAN_BLOCK_SIZE) {
+        uint32_t nul, sep, dot, events;
+        if (nbytes - base >= PATH_SCAN_BLOCK_SIZE) {
+            scan(&nul, &sep, &dot, (uint8_t const*) blob + base);
+        } else { /* classify the tail from a zero-padded copy, then discard the padding */
+            uint32_t valid = (1U << (nbytes - base)) - 1;
+            memset(block, 0, sizeof(block));
+            memcpy(block, blob + base, nbytes - base);
+            scan(&nul, &sep, &dot, block);
+            nul &= valid;
+            sep &= valid;
+            dot &= valid;
         }
-        if ((flags & PATH_FLAG_FILENAME) == 0) {
-            dirs_end = name_end;
-            flags   |= PATH_FLAG_DIRECTORY;
-            name_beg = path_end;
-            name_end = path_end;
+        events = nul | sep | dot;
+        while (events != 0) {
+            uint32_t bit = PathLowestSetBit(events);
+            uint32_t   i = base + bit;
+            events &= events - 1;
+            if (nul & (1U << bit)) {
+                LinuxPathScanEnd(batch, count, &state, blob, i);
+                consumed = i + 1;
+                if (++count == batch->Capacity || consumed == nbytes) {
+                    batch->PathCount = count;
+                    return consumed;
+                }
+                LinuxPathScanBegin(&state, blob, i + 1);
+            } else if (sep & (1U << bit)) {
+                if (i >= state.RootEnd) {
+                    if (blob[i] == '\\') { /* normalize to system standard */
+                        blob[i] = '/';
+                    }
+                    state.LastSep  = i;
+                    state.FirstDot = PATH_SCAN_NONE;
+                }
+            } else { /* period; one at the start of the component does not begin an extension */
+                uint32_t name = (state.LastSep != PATH_SCAN_NONE) ? state.LastSep + 1 : state.RootEnd;
+                if (state.FirstDot == PATH_SCAN_NONE && i != name) {
+                    state.FirstDot = i;
+                }
+            }
         }
-    } else {
-        /* no filename is present */
-        name_beg  = path_end;
-        name_end  = path_end;
     }
-    o_parts->Path         = dirs_beg;
-    o_parts->PathEnd      = dirs_end;
-    o_parts->Filename     = name_beg;
-    o_parts->FilenameEnd  = name_end;
-    o_parts->Extension    = extn_beg;
-    o_parts->ExtensionEnd = extn_end;
-    o_parts->PathFlags    = flags;
-    return 0;
+    batch->PathCount = count;
+    return consumed;
 }
 
 /* @summary Figure out the starting and ending points of the directory, filename and extension information in a Win32 path string.
@@ -102,7 +486,7 @@ Win32PathExtractPathParts
     struct STRING_INFO      *strinfo
 )
 {
-    char8_t     *iter = strinfo->BufferEnd;
+    char8_t     *iter = strinfo->BufferEnd - 1; /* the terminating nul */
     char8_t *path_end = strinfo->BufferEnd;
     char8_t *extn_beg = strinfo->BufferEnd;
     char8_t *extn_end = strinfo->BufferEnd;
@@ -189,6 +573,255 @@ Win32PathStringGetMaxChars
     return WIN32_PATH_STRING_MAX_CHARS;
 }
 
+/* @summary Define the signature of a function that measures the root component at the start of a path string.
+ * @param o_absolute On return, set to non-zero if '..' components cannot remove anything above the root.
+ * @param str The path string.
+ * @param len The length of the path string, in bytes.
+ * @return The length of the root component, in bytes, including any separator that ends it.
+ */
+typedef size_t (*PATH_ROOT_FUNC)
+(
+    int         *o_absolute,
+    char8_t const     *str,
+    size_t             len
+);
+
+/* @summary Determine whether a byte is a forward or backward slash.
+ */
+static inline int
+PathIsSeparator
+(
+    char8_t ch
+)
+{
+    return (ch == '/' || ch == '\\');
+}
+
+/* @summary Measure the root of a Linux-style path string, which is a single leading separator.
+ */
+static size_t
+LinuxPathRootLength
+(
+    int         *o_absolute,
+    char8_t const     *str,
+    size_t             len
+)
+{
+   *o_absolute = (len > 0 && PathIsSeparator(str[0]));
+    return (size_t)(*o_absolute);
+}
+
+/* @summary Measure the components of a Win32-style path string starting at a given offset, up to and not including the separator that ends the last one.
+ * @return The offset following the last component measured.
+ */
+static size_t
+Win32PathSkipComponents
+(
+    char8_t const *str,
+    size_t         len,
+    size_t         pos,
+    uint32_t     count
+)
+{
+    while (count-- > 0 && pos < len) {
+        if (PathIsSeparator(str[pos])) {
+            pos++;
+        }
+        while (pos < len && !PathIsSeparator(str[pos])) {
+            pos++;
+        }
+    }
+    return pos;
+}
+
+/* @summary Measure the root of a Win32-style path string: a drive letter, a leading separator, a UNC share, or a device or long path prefix with its first component.
+ */
+static size_t
+Win32PathRootLength
+(
+    int         *o_absolute,
+    char8_t const     *str,
+    size_t             len
+)
+{
+   *o_absolute = 1;
+    if (len >= 2 && PathIsSeparator(str[0]) && PathIsSeparator(str[1])) {
+        if (len >= 4 && (str[2] == '?' || str[2] == '.') && PathIsSeparator(str[3])) {
+            /* device or long path; a long UNC path names the server and share after "UNC" */
+            size_t end = Win32PathSkipComponents(str, len, 3, 1);
+            if (end - 4 == 3 && (str[4] == 'U' || str[4] == 'u') && (str[5] == 'N' || str[5] == 'n') && (str[6] == 'C' || str[6] == 'c')) {
+                end = Win32PathSkipComponents(str, len, end, 2);
+            }
+            return (end < len) ? end + 1 : end;
+        }
+        /* UNC path; the root is the server and share */
+        size_t end = Win32PathSkipComponents(str, len, 1, 2);
+        return (end < len) ? end + 1 : end;
+    }
+    if (len >= 2 && ((str[0] >= 'A' && str[0] <= 'Z') || (str[0] >= 'a' && str[0] <= 'z')) && str[1] == ':') {
+        /* drive letter; without a separator the path is relative to the current directory of that drive */
+        if (len >= 3 && PathIsSeparator(str[2])) {
+            return 3;
+        }
+       *o_absolute = 0;
+        return 2;
+    }
+    if (len >= 1 && PathIsSeparator(str[0])) {
+        return 1;
+    }
+   *o_absolute = 0;
+    return 0;
+}
+
+/* @summary Append one path fragment to a path buffer, normalizing the combined path in a single pass over the bytes.
+ * Separators are converted to sep, and empty, '.' and '..' components are resolved. The existing contents are compacted in place.
+ * @param sep The separator character of the path style, '/' or '\\'.
+ * @param measure_root The function used to find the root of the path.
+ * @return A pointer to the destination path buffer, or NULL if an error occurred.
+ */
+static char8_t*
+PathBufferAppendNormalized
+(
+    struct STRING_INFO *o_dstinfo,
+    struct STRING_INFO   *dstinfo,
+    struct STRING_INFO   *appinfo,
+    char8_t               *dstbuf,
+    char8_t const         *appstr,
+    char8_t                   sep,
+    PATH_ROOT_FUNC   measure_root
+)
+{
+    char8_t const *src[2];
+    size_t     src_len[2];
+    size_t      dst_len = 0;
+    size_t      app_len = 0;
+    size_t     root_len = 0;
+    size_t        chars = 0;
+    size_t        depth = 0;
+    size_t            w = 0;
+    size_t            i;
+    int        absolute = 0;
+    int       allocated = 0;
+    uint32_t          s;
+
+    if (appstr != NULL) {
+        app_len = (appinfo != NULL && appinfo->LengthBytes > 0) ? appinfo->LengthBytes - UTF8_NUL_BYTES : strlen(appstr);
+    }
+    if (dstbuf == NULL) {
+        if ((dstbuf = PathBufferCreateHeap(NULL, NULL, NULL, NULL)) == NULL) {
+            goto cleanup_and_fail;
+        }
+        allocated = 1;
+    } else {
+        dst_len = (dstinfo != NULL && dstinfo->LengthBytes > 0) ? dstinfo->LengthBytes - UTF8_NUL_BYTES : strlen(dstbuf);
+    }
+    if ((root_len = measure_root(&absolute, appstr, app_len)) > 0) {
+        /* a fragment with a root replaces the existing path */
+        if (app_len + 2 > PATH_BUFFER_MAX_BYTES) {
+            errno = ENAMETOOLONG;
+            goto cleanup_and_fail;
+        }
+        for (i = 0; i < root_len; ++i) {
+            dstbuf[i] = PathIsSeparator(appstr[i]) ? sep : appstr[i];
+        }
+        src[0] = NULL;              src_len[0] = 0;
+        src[1] = appstr + root_len; src_len[1] = app_len - root_len;
+    } else {
+        if (dst_len + app_len + 2 > PATH_BUFFER_MAX_BYTES) {
+            errno = ENAMETOOLONG;
+            goto cleanup_and_fail;
+        }
+        root_len = measure_root(&absolute, dstbuf, dst_len);
+        for (i = 0; i < root_len; ++i) {
+            dstbuf[i] = PathIsSeparator(dstbuf[i]) ? sep : dstbuf[i];
+        }
+        src[0] = dstbuf + root_len; src_len[0] = dst_len - root_len;
+        src[1] = appstr;            src_len[1] = app_len;
+    }
+    for (i = 0; i < root_len; ++i) {
+        chars += ((dstbuf[i] & 0xC0) != 0x80);
+    }
+
+    /* walk the components of the existing path and then the fragment.
+     * the output never grows faster than the input, so the existing path is compacted in place.
+     */
+    w = root_len;
+    for (s = 0; s < 2; ++s) {
+        char8_t const *p = src[s];
+        char8_t const *e = src[s] + src_len[s];
+        while (p < e) {
+            char8_t const *beg = p;
+            size_t       nchar = 0;
+            size_t         len;
+            while (p < e && !PathIsSeparator(*p)) {
+                nchar += ((*p & 0xC0) != 0x80);
+                p++;
+            }
+            len = (size_t)(p - beg);
+            if (p < e) {
+                p++; /* skip the separator */
+            }
+            if (len == 0 || (len == 1 && beg[0] == '.')) {
+                continue;
+            }
+            if (len == 2 && beg[0] == '.' && beg[1] == '.') {
+                if (depth > 0) { /* remove the last component */
+                    size_t end = w;
+                    while (w > root_len && dstbuf[w-1] != sep) {
+                        w--;
+                    }
+                    for (i = w; i < end; ++i) {
+                        chars -= ((dstbuf[i] & 0xC0) != 0x80);
+                    }
+                    if (w > root_len) {
+                        w--;     /* and the separator preceding it */
+                        chars--;
+                    }
+                    depth--;
+                    continue;
+                }
+                if (absolute) { /* nothing above the root */
+                    continue;
+                }
+            } else {
+                depth++;
+            }
+            if (w > 0 && dstbuf[w-1] != sep && (w > root_len || absolute)) {
+                dstbuf[w++] = sep;
+                chars++;
+            }
+            memmove(dstbuf + w, beg, len);
+            w     += len;
+            chars += nchar;
+        }
+    }
+    if (w == 0) { /* an empty relative path refers to the current directory */
+        dstbuf[w++] = '.';
+        chars++;
+    }
+    dstbuf[w] = 0;
+    if (o_dstinfo) {
+        o_dstinfo->Buffer      = dstbuf;
+        o_dstinfo->BufferEnd   = dstbuf + w + UTF8_NUL_BYTES;
+        o_dstinfo->LengthBytes = w + UTF8_NUL_BYTES;
+        o_dstinfo->LengthChars = chars;
+    }
+    return dstbuf;
+
+cleanup_and_fail:
+    if (allocated) {
+        PathBufferDelete(dstbuf);
+    }
+    if (o_dstinfo) {
+        if (dstinfo != NULL && !allocated) {
+            memmove(o_dstinfo, dstinfo, sizeof(STRING_INFO));
+        } else {
+            memset(o_dstinfo, 0, sizeof(STRING_INFO));
+        }
+    }
+    return NULL;
+}
+
 PATHLIB_API(char8_t*)
 LinuxPathBufferCreate
 (
@@ -198,7 +831,7 @@ LinuxPathBufferCreate
     char8_t const         *strbuf
 )
 {
-    return Utf8StringCreate(o_strinfo, o_bufinfo, strinfo, LINUX_PATH_STRING_MAX_CHARS, strbuf);
+    return PathBufferCreateHeap(o_strinfo, o_bufinfo, strinfo, strbuf);
 }
 
 PATHLIB_API(char8_t*)
@@ -210,7 +843,69 @@ Win32PathBufferCreate
     char8_t const         *strbuf
 )
 {
-    return Utf8StringCreate(o_strinfo, o_bufinfo, strinfo, WIN32_PATH_STRING_MAX_CHARS, strbuf);
+    return PathBufferCreateHeap(o_strinfo, o_bufinfo, strinfo, strbuf);
+}
+
+PATHLIB_API(char8_t*)
+LinuxPathBufferInit
+(
+    struct STRING_INFO *o_strinfo,
+    struct STRING_INFO *o_bufinfo,
+    char8_t              *storage,
+    struct STRING_INFO   *strinfo,
+    char8_t const         *strbuf
+)
+{
+    if (storage == NULL) {
+        assert(storage != NULL);
+        errno = EINVAL;
+        return NULL;
+    }
+    return (PathBufferInitStorage(o_strinfo, o_bufinfo, storage, strinfo, strbuf) == 0) ? storage : NULL;
+}
+
+PATHLIB_API(char8_t*)
+Win32PathBufferInit
+(
+    struct STRING_INFO *o_strinfo,
+    struct STRING_INFO *o_bufinfo,
+    char8_t              *storage,
+    struct STRING_INFO   *strinfo,
+    char8_t const         *strbuf
+)
+{
+    if (storage == NULL) {
+        assert(storage != NULL);
+        errno = EINVAL;
+        return NULL;
+    }
+    return (PathBufferInitStorage(o_strinfo, o_bufinfo, storage, strinfo, strbuf) == 0) ? storage : NULL;
+}
+
+PATHLIB_API(char8_t*)
+LinuxPathBufferCreateInArena
+(
+    struct STRING_INFO  *o_strinfo,
+    struct STRING_INFO  *o_bufinfo,
+    struct MEMORY_ARENA     *arena,
+    struct STRING_INFO    *strinfo,
+    char8_t const          *strbuf
+)
+{
+    return PathBufferCreateArena(o_strinfo, o_bufinfo, arena, strinfo, strbuf);
+}
+
+PATHLIB_API(char8_t*)
+Win32PathBufferCreateInArena
+(
+    struct STRING_INFO  *o_strinfo,
+    struct STRING_INFO  *o_bufinfo,
+    struct MEMORY_ARENA     *arena,
+    struct STRING_INFO    *strinfo,
+    char8_t const          *strbuf
+)
+{
+    return PathBufferCreateArena(o_strinfo, o_bufinfo, arena, strinfo, strbuf);
 }
 
 PATHLIB_API(void)
@@ -231,10 +926,10 @@ LinuxPathStringParse
     char8_t const            *strbuf
 )
 {
+    PATH_PARTS_LINUX_BATCH batch;
     STRING_INFO sinfo;
-    char8_t *path_beg = NULL;
-    char8_t *path_end = NULL;
-    size_t  inp_chars = 0;
+    uint32_t    offsets[9];
+    char8_t    *path_beg = NULL;
 
     if (o_parts == NULL) {
         assert(o_parts != NULL);
@@ -258,35 +953,147 @@ LinuxPathStringParse
         } errno = EINVAL;
         return -1;
     }
-
-    inp_chars          = sinfo.LengthChars;
-    path_beg           = sinfo.Buffer;
-    path_end           = sinfo.BufferEnd;
-    o_parts->Root      = path_beg; o_parts->RootEnd      = path_end;
-    o_parts->Path      = path_end; o_parts->PathEnd      = path_end;
-    o_parts->Filename  = path_end; o_parts->FilenameEnd  = path_end;
-    o_parts->Extension = path_end; o_parts->ExtensionEnd = path_end;
-    o_parts->PathFlags = PATH_FLAGS_NONE;
     if (o_strinfo) {
         memcpy(o_strinfo, &sinfo, sizeof(STRING_INFO));
     }
 
-    if (inp_chars >= 1) {
-        if (path_beg[0] == '/') {
-            o_parts->Root      = path_beg;
-            o_parts->RootEnd   = path_beg + 1;
-            o_parts->PathFlags = PATH_FLAG_ABSOLUTE | PATH_FLAG_ROOT;
-        } else {
-            o_parts->Root      = path_beg;
-            o_parts->RootEnd   = path_beg;
-            o_parts->PathFlags = PATH_FLAG_RELATIVE;
-        }
-        return LinuxPathExtractPathParts(o_parts, &sinfo);
-    } else {
+    /* parse the string as a batch of one */
+    memset(&batch, 0, sizeof(PATH_PARTS_LINUX_BATCH));
+    batch.Root         = &offsets[0];
+    batch.RootEnd      = &offsets[1];
+    batch.Path         = &offsets[2];
+    batch.PathEnd      = &offsets[3];
+    batch.Filename     = &offsets[4];
+    batch.FilenameEnd  = &offsets[5];
+    batch.Extension    = &offsets[6];
+    batch.ExtensionEnd = &offsets[7];
+    batch.PathFlags    = &offsets[8];
+    batch.Capacity     = 1;
+    path_beg           = sinfo.Buffer;
+    (void) LinuxPathScanStrings(&batch, path_beg, sinfo.LengthBytes);
+    if (batch.PathCount == 0 || (offsets[8] & PATH_FLAG_INVALID)) {
+        o_parts->Root      = path_beg; o_parts->RootEnd      = sinfo.BufferEnd;
+        o_parts->Path      = sinfo.BufferEnd; o_parts->PathEnd      = sinfo.BufferEnd;
+        o_parts->Filename  = sinfo.BufferEnd; o_parts->FilenameEnd  = sinfo.BufferEnd;
+        o_parts->Extension = sinfo.BufferEnd; o_parts->ExtensionEnd = sinfo.BufferEnd;
         o_parts->PathFlags = PATH_FLAG_INVALID;
         errno = EINVAL;
         return -1;
     }
+    o_parts->Root         = path_beg + offsets[0];
+    o_parts->RootEnd      = path_beg + offsets[1];
+    o_parts->Path         = path_beg + offsets[2];
+    o_parts->PathEnd      = path_beg + offsets[3];
+    o_parts->Filename     = path_beg + offsets[4];
+    o_parts->FilenameEnd  = path_beg + offsets[5];
+    o_parts->Extension    = path_beg + offsets[6];
+    o_parts->ExtensionEnd = path_beg + offsets[7];
+    o_parts->PathFlags    = offsets[8];
+    return 0;
+}
+
+PATHLIB_API(size_t)
+LinuxPathBatchMemorySize
+(
+    uint32_t capacity
+)
+{   /* nine arrays, each padded to a multiple of 64 bytes */
+    return 9 * ((((size_t) capacity * sizeof(uint32_t)) + 63) & ~(size_t) 63);
+}
+
+PATHLIB_API(int)
+LinuxPathBatchInitialize
+(
+    struct PATH_PARTS_LINUX_BATCH *o_batch,
+    void                           *memory,
+    uint32_t                      capacity
+)
+{
+    uint8_t *p = (uint8_t*) memory;
+    size_t   n = (((size_t) capacity * sizeof(uint32_t)) + 63) & ~(size_t) 63;
+
+    assert(o_batch != NULL);
+    memset(o_batch, 0, sizeof(PATH_PARTS_LINUX_BATCH));
+
+    if (memory == NULL || ((uintptr_t) memory & 3) != 0 || capacity == 0) {
+        errno = EINVAL;
+        return -1;
+    }
+    o_batch->Root         = (uint32_t*)(p + (0 * n));
+    o_batch->RootEnd      = (uint32_t*)(p + (1 * n));
+    o_batch->Path         = (uint32_t*)(p + (2 * n));
+    o_batch->PathEnd      = (uint32_t*)(p + (3 * n));
+    o_batch->Filename     = (uint32_t*)(p + (4 * n));
+    o_batch->FilenameEnd  = (uint32_t*)(p + (5 * n));
+    o_batch->Extension    = (uint32_t*)(p + (6 * n));
+    o_batch->ExtensionEnd = (uint32_t*)(p + (7 * n));
+    o_batch->PathFlags    = (uint32_t*)(p + (8 * n));
+    o_batch->Capacity     = capacity;
+    o_batch->MemorySize   = 9 * n;
+    return 0;
+}
+
+PATHLIB_API(int)
+LinuxPathBatchCreate
+(
+    struct PATH_PARTS_LINUX_BATCH *o_batch,
+    uint32_t                      capacity
+)
+{
+    void *mem = NULL;
+
+    assert(o_batch != NULL);
+    memset(o_batch, 0, sizeof(PATH_PARTS_LINUX_BATCH));
+
+    if (capacity == 0) {
+        errno = EINVAL;
+        return -1;
+    }
+    if ((mem = malloc(LinuxPathBatchMemorySize(capacity))) == NULL) {
+        return -1;
+    }
+    (void) LinuxPathBatchInitialize(o_batch, mem, capacity);
+    o_batch->Memory = mem;
+    return 0;
+}
+
+PATHLIB_API(void)
+LinuxPathBatchDelete
+(
+    struct PATH_PARTS_LINUX_BATCH *batch
+)
+{
+    if (batch != NULL) {
+        free(batch->Memory);
+        memset(batch, 0, sizeof(PATH_PARTS_LINUX_BATCH));
+    }
+}
+
+PATHLIB_API(int)
+LinuxPathStringParseBatch
+(
+    struct PATH_PARTS_LINUX_BATCH *batch,
+    size_t                    *o_consumed,
+    char8_t                          *blob,
+    size_t                      blob_bytes
+)
+{
+    size_t consumed = 0;
+
+    if (batch == NULL || (blob == NULL && blob_bytes != 0) || blob_bytes > (size_t) 0xFFFFFFFFU) {
+        if (batch) {
+            batch->PathCount = 0;
+        }
+        if (o_consumed) {
+           *o_consumed = 0;
+        } errno = EINVAL;
+        return -1;
+    }
+    consumed = LinuxPathScanStrings(batch, blob, blob_bytes);
+    if (o_consumed) {
+       *o_consumed = consumed;
+    }
+    return 0;
 }
 
 PATHLIB_API(int)
@@ -470,92 +1277,297 @@ scan_for_end_of_root:
     return Win32PathExtractPathParts(o_parts, &sinfo);
 }
 
-#if 0
 PATHLIB_API(char8_t*)
 LinuxPathBufferAppend
 (
-    struct STRING_INFO_UTF8 *o_dstinfo, 
-    struct STRING_INFO_UTF8   *dstinfo, 
-    struct STRING_INFO_UTF8   *appinfo, 
-    char8_t                    *dstbuf, 
-    char8_t const              *appstr
-);
+    struct STRING_INFO *o_dstinfo, 
+    struct STRING_INFO   *dstinfo, 
+    struct STRING_INFO   *appinfo, 
+    char8_t               *dstbuf, 
+    char8_t const         *appstr
+)
+{
+    return PathBufferAppendNormalized(o_dstinfo, dstinfo, appinfo, dstbuf, appstr, '/', LinuxPathRootLength);
+}
 
-PATHLIB_API(char16_t*)
+PATHLIB_API(char8_t*)
 Win32PathBufferAppend
 (
-    struct STRING_INFO_UTF16 *o_dstinfo, 
-    struct STRING_INFO_UTF16   *dstinfo, 
-    struct STRING_INFO_UTF16   *appinfo, 
-    char16_t                    *dstbuf, 
-    char16_t const              *appstr
+    struct STRING_INFO *o_dstinfo, 
+    struct STRING_INFO   *dstinfo, 
+    struct STRING_INFO   *appinfo, 
+    char8_t               *dstbuf, 
+    char8_t const         *appstr
 )
 {
-    STRING_INFO_UTF16 dsinfo;
-    STRING_INFO_UTF16 ssinfo;
-    
-    memset(&dsinfo, 0, sizeof(STRING_INFO_UTF16));
-    memset(&ssinfo, 0, sizeof(STRING_INFO_UTF16));
+    return PathBufferAppendNormalized(o_dstinfo, dstinfo, appinfo, dstbuf, appstr, '\\', Win32PathRootLength);
+}
 
-    if (appstr != NULL) {
-        if (appinfo != NULL) {
-            memcpy(&ssinfo, appinfo, sizeof(STRING_INFO_UTF16));
-        } else {
-            Utf16StringInfo(&ssinfo, appstr);
-        }
+/* @summary Compute a 64-bit hash of a byte string, consuming eight bytes at a time.
+ * @param str The bytes to hash.
+ * @param len The number of bytes to hash.
+ * @return The hash value.
+ */
+static uint64_t
+PathHashBytes
+(
+    char8_t const *str,
+    size_t         len
+)
+{
+    uint64_t h = 0x9E3779B97F4A7C15ULL ^ (uint64_t) len;
+    uint64_t w;
+
+    while (len >= 8) {
+        memcpy(&w, str, 8);
+        h   = (h ^ w) * 0xBF58476D1CE4E5B9ULL;
+        h  ^=  h >> 29;
+        str += 8;
+        len -= 8;
     }
-    if (dstbuf != NULL) {
-        if (dstinfo != NULL) {
-            memcpy(&dsinfo, dstinfo, sizeof(STRING_INFO_UTF16));
-        } else {
-            Utf16StringInfo(&dsinfo, dstbuf);
+    if (len > 0) {
+        w = 0;
+        memcpy(&w, str, len);
+        h   = (h ^ w) * 0xBF58476D1CE4E5B9ULL;
+        h  ^=  h >> 29;
+    }
+    h ^= h >> 32;
+    h *= 0x94D049BB133111EBULL;
+    h ^= h >> 31;
+    return h;
+}
+
+/* @summary Normalize a path string into a path buffer and search a table of interned paths for it.
+ * @param o_id On return, the id of the path, or PATH_INTERN_INVALID_ID if the path is not in the table.
+ * @param o_slot On return, the index of the slot holding the path, or of the empty slot where it would be inserted.
+ * @param o_tag On return, the upper 32 bits of the hash, which are stored in the slot alongside the id.
+ * @param o_info On return, the attributes of the normalized path string stored in buf.
+ * @param buf A path buffer of PATH_BUFFER_MAX_BYTES bytes that receives the normalized path string.
+ * @return Zero if the table was searched, or -1 if the path cannot be normalized.
+ */
+static int
+LinuxPathInternProbe
+(
+    uint32_t                   *o_id,
+    uint32_t                 *o_slot,
+    uint64_t                  *o_tag,
+    struct STRING_INFO       *o_info,
+    char8_t                     *buf,
+    struct PATH_INTERN_TABLE  *table,
+    struct STRING_INFO      *strinfo,
+    char8_t const            *strbuf
+)
+{
+    STRING_INFO empty;
+    uint64_t     hash;
+    uint64_t      tag;
+    uint32_t     slot;
+
+    empty.Buffer      = buf;
+    empty.BufferEnd   = buf + UTF8_NUL_BYTES;
+    empty.LengthBytes = UTF8_NUL_BYTES;
+    empty.LengthChars = 0;
+    buf[0]            = 0;
+   *o_id = PATH_INTERN_INVALID_ID;
+    if (LinuxPathBufferAppend(o_info, &empty, strinfo, buf, strbuf) == NULL) {
+        return -1;
+    }
+    hash = PathHashBytes(buf, o_info->LengthBytes - UTF8_NUL_BYTES);
+    tag  = hash & 0xFFFFFFFF00000000ULL;
+    slot =(uint32_t) hash & table->SlotMask;
+    for ( ; ; ) {
+        uint64_t entry = table->Slots[slot];
+        if (entry == 0) {
+            break;
         }
+        if ((entry & 0xFFFFFFFF00000000ULL) == tag) {
+            uint32_t id = (uint32_t)(entry & 0xFFFFFFFFU) - 1;
+            if (table->Lengths[id] == o_info->LengthBytes - UTF8_NUL_BYTES && memcmp(table->Strings.BaseAddress + table->Offsets[id], buf, table->Lengths[id]) == 0) {
+               *o_id = id;
+                break;
+            }
+        }
+        slot = (slot + 1) & table->SlotMask;
     }
-    
-    if (ssinfo.LengthChars == 0) { /* nothing to append */
-        if (o_dstinfo) {
-            memcpy(o_dstinfo, &dsinfo, sizeof(STRING_INFO_UTF16));
-        } return dstbuf;
+   *o_slot = slot;
+   *o_tag  = tag;
+    return 0;
+}
+
+PATHLIB_API(int)
+LinuxPathInternTableCreate
+(
+    struct PATH_INTERN_TABLE *o_table,
+    uint32_t                 capacity,
+    size_t               string_bytes
+)
+{
+    uint8_t    *mem = NULL;
+    size_t   nslots = 2;
+    size_t   n_slot;
+    size_t   n_u32;
+    size_t   n_part;
+
+    assert(o_table != NULL);
+    memset(o_table, 0, sizeof(PATH_INTERN_TABLE));
+
+    if (capacity == 0 || capacity >= 0x80000000U || string_bytes == 0 || string_bytes > 0xFFFFFFFFU) {
+        errno = EINVAL;
+        return -1;
     }
-    if (dsinfo.LengthChars + ssinfo.LengthChars > WIN32_PATH_STRING_MAX_CHARS) {
-        if (o_dstinfo) {
-            memcpy(o_dstinfo, &dsinfo, sizeof(STRING_INFO_UTF16));
-        } errno = ENAMETOOLONG;
-        return NULL;
+    /* keep the load factor at or below one half so probe sequences stay short */
+    while (nslots < 2 * (size_t) capacity) {
+        nslots *= 2;
     }
+    n_slot = ((nslots * sizeof(uint64_t)) + 63) & ~(size_t) 63;
+    n_u32  = (((size_t) capacity * sizeof(uint32_t)) + 63) & ~(size_t) 63;
+    n_part = (((size_t) capacity * sizeof(PATH_PARTS_LINUX)) + 63) & ~(size_t) 63;
+    if ((mem = (uint8_t*) malloc(n_slot + (3 * n_u32) + n_part)) == NULL) {
+        return -1;
+    }
+    if (ArenaCreate(&o_table->Strings, string_bytes, ARENA_FLAGS_NONE) != 0) {
+        free(mem);
+        return -1;
+    }
+    memset(mem, 0, n_slot);
+    o_table->Slots      = (uint64_t        *)(mem);
+    o_table->Offsets    = (uint32_t        *)(mem + n_slot);
+    o_table->Lengths    = (uint32_t        *)(mem + n_slot + (1 * n_u32));
+    o_table->Chars      = (uint32_t        *)(mem + n_slot + (2 * n_u32));
+    o_table->Parts      = (PATH_PARTS_LINUX*)(mem + n_slot + (3 * n_u32));
+    o_table->PathCount  = 0;
+    o_table->Capacity   = capacity;
+    o_table->SlotMask   = (uint32_t)(nslots - 1);
+    o_table->Memory     = mem;
+    o_table->MemorySize = n_slot + (3 * n_u32) + n_part;
+    return 0;
+}
 
-    if (dstbuf == NULL) {
-        if ((dstbuf = Win32PathBufferCreate(&dsinfo, NULL, appinfo, appstr)) != NULL) {
-            while (dstbuf && *dstbuf) {
-                if (*dstbuf == '/') {
-                    *dstbuf = '\\';
-                } dstbuf = Utf16StringNextCodepoint(NULL, NULL, dstbuf);
-            }
-            if (o_dstinfo) {
-                memcpy(o_dstinfo, &dsinfo, sizeof(STRING_INFO_UTF16));
-            } return dsinfo.Buffer;
-        } else {
-            if (o_dstinfo) {
-                memset(o_dstinfo, 0, sizeof(STRING_INFO_UTF16));
-            } return NULL; /* allocation failed */
-        }
+PATHLIB_API(void)
+LinuxPathInternTableDelete
+(
+    struct PATH_INTERN_TABLE *table
+)
+{
+    if (table != NULL) {
+        ArenaDelete(&table->Strings);
+        free(table->Memory);
+        memset(table, 0, sizeof(PATH_INTERN_TABLE));
     }
+}
 
-    if (dsinfo.LengthChars > 0 && dsinfo.BufferEnd[-2] != '\\') {
-        if (dsinfo.LengthChars + ssinfo.LengthChars + 1 > WIN32_PATH_STRING_MAX_CHARS) {
-            if (o_dstinfo) {
-                memcpy(o_dstinfo, &dsinfo, sizeof(STRING_INFO_UTF16));
-            } errno = ENAMETOOLONG;
-            return NULL;
-        }
-        dsinfo.BufferEnd[-1] = '\\';
+PATHLIB_API(int)
+LinuxPathIntern
+(
+    uint32_t                    *o_id,
+    struct PATH_INTERN_TABLE   *table,
+    struct STRING_INFO       *strinfo,
+    char8_t const             *strbuf
+)
+{
+    char8_t     buf[PATH_BUFFER_MAX_BYTES];
+    STRING_INFO info;
+    char8_t    *str = NULL;
+    uint64_t    tag = 0;
+    uint32_t   slot = 0;
+    uint32_t     id = PATH_INTERN_INVALID_ID;
+
+    assert(o_id  != NULL);
+    assert(table != NULL);
+
+    if (LinuxPathInternProbe(&id, &slot, &tag, &info, buf, table, strinfo, strbuf) != 0) {
+        goto cleanup_and_fail;
     }
-    while (ssinfo.Buffer != ssinfo.BufferEnd) {
-        if (ssinfo.Buffer[0] != '/') {
-            dsinfo.BufferEnd[-1] = ssinfo.Buffer++;
-        } else {
-        }
+    if (id != PATH_INTERN_INVALID_ID) {
+       *o_id = id;
+        return 0;
+    }
+    if (table->PathCount == table->Capacity) {
+        errno = ENOSPC;
+        goto cleanup_and_fail;
+    }
+    if ((str = (char8_t*) ArenaAllocate(&table->Strings, info.LengthBytes, 1)) == NULL) {
+        goto cleanup_and_fail;
     }
+    memcpy(str, buf, info.LengthBytes);
+    info.Buffer    = str;
+    info.BufferEnd = str + info.LengthBytes;
+    id = table->PathCount;
+    if (LinuxPathStringParse(&table->Parts[id], NULL, &info, str) != 0) {
+        ArenaResetToMark(&table->Strings, (size_t)(str - (char8_t*) table->Strings.BaseAddress));
+        goto cleanup_and_fail;
+    }
+    table->Offsets[id]   = (uint32_t)(str - (char8_t*) table->Strings.BaseAddress);
+    table->Lengths[id]   = (uint32_t)(info.LengthBytes - UTF8_NUL_BYTES);
+    table->Chars[id]     = (uint32_t) info.LengthChars;
+    table->Slots[slot]   = tag | (uint64_t)(id + 1);
+    table->PathCount     = id + 1;
+   *o_id = id;
+    return 0;
+
+cleanup_and_fail:
+   *o_id = PATH_INTERN_INVALID_ID;
+    return -1;
 }
-#endif
 
+PATHLIB_API(int)
+LinuxPathInternFind
+(
+    uint32_t                    *o_id,
+    struct PATH_INTERN_TABLE   *table,
+    struct STRING_INFO       *strinfo,
+    char8_t const             *strbuf
+)
+{
+    char8_t     buf[PATH_BUFFER_MAX_BYTES];
+    STRING_INFO info;
+    uint64_t    tag = 0;
+    uint32_t   slot = 0;
+
+    assert(o_id  != NULL);
+    assert(table != NULL);
+
+    if (LinuxPathInternProbe(o_id, &slot, &tag, &info, buf, table, strinfo, strbuf) != 0) {
+        return -1;
+    }
+    if (*o_id == PATH_INTERN_INVALID_ID) {
+        errno = ENOENT;
+        return -1;
+    }
+    return 0;
+}
+
+PATHLIB_API(char8_t const*)
+LinuxPathInternString
+(
+    struct STRING_INFO     *o_strinfo,
+    struct PATH_INTERN_TABLE   *table,
+    uint32_t                       id
+)
+{
+    char8_t *str = NULL;
+
+    if (id >= table->PathCount) {
+        if (o_strinfo) {
+            memset(o_strinfo, 0, sizeof(STRING_INFO));
+        } return NULL;
+    }
+    str = (char8_t*) table->Strings.BaseAddress + table->Offsets[id];
+    if (o_strinfo) {
+        o_strinfo->Buffer      = str;
+        o_strinfo->BufferEnd   = str + table->Lengths[id] + UTF8_NUL_BYTES;
+        o_strinfo->LengthBytes = table->Lengths[id] + UTF8_NUL_BYTES;
+        o_strinfo->LengthChars = table->Chars[id];
+    }
+    return str;
+}
+
+PATHLIB_API(PATH_PARTS_LINUX const*)
+LinuxPathInternParts
+(
+    struct PATH_INTERN_TABLE *table,
+    uint32_t                     id
+)
+{
+    return (id < table->PathCount) ? &table->Parts[id] : NULL;
+}
@@ -0,0 +1,881 @@
+/**
+ * @summary Implement the functions exported by the quant.h module for
+ * calibrating, quantizing and evaluating int8 multi-layer perceptrons.
+ */
+#include <stddef.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <assert.h>
+#include <errno.h>
+
+#include "arena.h"
+#include "cpuinfo.h"
+#include "dataset.h"
+#include "minibatch.h"
+#include "mlp.h"
+#include "taskpool.h"
+#include "quant.h"
+
+#if CPU_ARCH_X86
+#include <immintrin.h>
+#endif
+
+/* @summary Round a value up to the next multiple of a power of two.
+ * @param _value The value to round.
+ * @param _pow2 The power-of-two multiple.
+ * @return The smallest multiple of _pow2 that is greater than or equal to _value.
+ */
+#ifndef AlignUp
+#define AlignUp(_value, _pow2)                                                 \
+    (((_value) + ((_pow2) - 1)) & ~((_pow2) - 1))
+#endif
+
+/* @summary Define the smallest probability passed to log when computing the cross-entropy loss.
+ */
+#ifndef QUANT_MIN_PROBABILITY
+#define QUANT_MIN_PROBABILITY         1.0e-12f
+#endif
+
+/* @summary Define the signature of an int8 dot-product kernel.
+ * The kernel computes the QUANT_MR x QUANT_NR tile c[r][j] = Sum(a[r][k] * w[k][j]) for k in [0, groups * QUANT_KR).
+ * @param groups The depth of the product, in groups of QUANT_KR inputs.
+ * @param a The first quantized input of the first of QUANT_MR rows. Every row must be readable for groups * QUANT_KR bytes.
+ * @param lda The distance between the start of consecutive rows of a, in bytes.
+ * @param w The packed panel of weights, storing QUANT_NR x QUANT_KR values for each group. Must be aligned to QUANT_ALIGNMENT bytes.
+ * @param c The first element of the tile of sums.
+ * @param ldc The distance between the start of consecutive rows of c, in int32 values.
+ */
+typedef void (*QUANT_KERNEL_FUNC)
+(
+    uint32_t                   groups,
+    uint8_t const * __restrict      a,
+    size_t                        lda,
+    int8_t  const * __restrict      w,
+    int32_t       * __restrict      c,
+    size_t                        ldc
+);
+
+/* @summary Define the scratch state used by one thread of QuantMlpClassify or QuantMlpEvaluate.
+ */
+typedef struct QUANT_EVALUATE_THREAD {
+    uint8_t                     *Inputs[MLP_MAX_LAYERS];                       /* The quantized inputs of each layer, with dimensions [AlignUp(MaxBatchSize, QUANT_MR)][InputStride]. */
+    int32_t                     *Sums;                                         /* The dot products of the current layer, with dimensions [AlignUp(MaxBatchSize, QUANT_MR)][OutputStride]. */
+    float                       *Logits;                                       /* The outputs of the last layer, with dimensions [MaxBatchSize][OutputStride]. */
+    double                       Loss;                                         /* The sum of the cross-entropy loss of the samples classified by this thread. */
+    uint32_t                     Correct;                                      /* The number of samples correctly classified by this thread. */
+} QUANT_EVALUATE_THREAD;
+
+/* @summary Define the arguments shared by the tasks of QuantMlpEvaluate.
+ */
+typedef struct QUANT_EVALUATE_ARGS {
+    QUANT_MLP const             *Network;                                      /* The network being evaluated. */
+    QUANT_KERNEL_FUNC            Kernel;                                       /* The dot-product kernel. */
+    MINIBATCH_SOURCE const      *Source;                                       /* The data being classified. */
+    QUANT_EVALUATE_THREAD       *Threads;                                      /* Scratch state for each thread of the pool. */
+} QUANT_EVALUATE_ARGS;
+
+/* @summary The dot-product kernel used by QuantMlpClassify and QuantMlpEvaluate, selected on first use or by QuantSelectKernel.
+ */
+static QUANT_KERNEL_FUNC volatile Global_QuantKernel = NULL;
+
+/* @summary Load four consecutive quantized inputs as a single 32-bit value.
+ * @param p The first input. No alignment is required.
+ * @return The four bytes at p.
+ */
+static inline int32_t
+QuantLoadGroup
+(
+    uint8_t const *p
+)
+{
+    int32_t v;
+    memcpy(&v, p, sizeof(v));
+    return v;
+}
+
+/* @summary Implement the dot-product kernel in portable C.
+ */
+static void
+QuantKernel_Scalar
+(
+    uint32_t                   groups,
+    uint8_t const * __restrict      a,
+    size_t                        lda,
+    int8_t  const * __restrict      w,
+    int32_t       * __restrict      c,
+    size_t                        ldc
+)
+{
+    int32_t  acc[QUANT_MR][QUANT_NR];
+    uint32_t g, r, j, t;
+
+    memset(acc, 0, sizeof(acc));
+    for (g = 0; g < groups; ++g) {
+        int8_t const *wg = w + ((size_t) g * QUANT_NR * QUANT_KR);
+        for (r = 0; r < QUANT_MR; ++r) {
+            uint8_t const *ag = a + (r * lda) + (g * QUANT_KR);
+            for (j = 0; j < QUANT_NR; ++j) {
+                int32_t sum = 0;
+                for (t = 0; t < QUANT_KR; ++t) {
+                    sum += (int32_t) ag[t] * (int32_t) wg[j * QUANT_KR + t];
+                }
+                acc[r][j] += sum;
+            }
+        }
+    }
+    for (r = 0; r < QUANT_MR; ++r) {
+        memcpy(c + (r * ldc), acc[r], QUANT_NR * sizeof(int32_t));
+    }
+}
+
+#if CPU_ARCH_X86
+/* @summary Implement the dot-product kernel using AVX2.
+ * The tile is computed as two 16-column halves, each holding four rows in two ymm accumulators. vpmaddubsw multiplies
+ * unsigned inputs by signed weights and adds adjacent pairs into int16 lanes, which cannot saturate because inputs are
+ * at most QUANT_ACTIVATION_MAX; vpmaddwd against a vector of ones then completes each group of QUANT_KR in int32.
+ */
+static CPU_TARGET("avx2") void
+QuantKernel_AVX2
+(
+    uint32_t                   groups,
+    uint8_t const * __restrict      a,
+    size_t                        lda,
+    int8_t  const * __restrict      w,
+    int32_t       * __restrict      c,
+    size_t                        ldc
+)
+{
+    __m256i const ones = _mm256_set1_epi16(1);
+    uint32_t half, g;
+
+    for (half = 0; half < 2; ++half) {
+        __m256i      c00 = _mm256_setzero_si256(), c01 = _mm256_setzero_si256();
+        __m256i      c10 = _mm256_setzero_si256(), c11 = _mm256_setzero_si256();
+        __m256i      c20 = _mm256_setzero_si256(), c21 = _mm256_setzero_si256();
+        __m256i      c30 = _mm256_setzero_si256(), c31 = _mm256_setzero_si256();
+        int8_t const *wp = w + (half * (QUANT_NR / 2) * QUANT_KR);
+
+        for (g = 0; g < groups; ++g) {
+            __m256i w0 = _mm256_load_si256((__m256i const*)(wp +  0));
+            __m256i w1 = _mm256_load_si256((__m256i const*)(wp + 32));
+            __m256i av;
+#define QUANT_AVX2_STEP(_row, _acc0, _acc1)                                    \
+            av    = _mm256_set1_epi32(QuantLoadGroup(a + ((_row) * lda) + (g * QUANT_KR))); \
+            _acc0 = _mm256_add_epi32(_acc0, _mm256_madd_epi16(_mm256_maddubs_epi16(av, w0), ones)); \
+            _acc1 = _mm256_add_epi32(_acc1, _mm256_madd_epi16(_mm256_maddubs_epi16(av, w1), ones))
+            QUANT_AVX2_STEP(0, c00, c01);
+            QUANT_AVX2_STEP(1, c10, c11);
+            QUANT_AVX2_STEP(2, c20, c21);
+            QUANT_AVX2_STEP(3, c30, c31);
+#undef  QUANT_AVX2_STEP
+            wp += QUANT_NR * QUANT_KR;
+        }
+        _mm256_storeu_si256((__m256i*)(c + 0 * ldc + half * 16 + 0), c00); _mm256_storeu_si256((__m256i*)(c + 0 * ldc + half * 16 + 8), c01);
+        _mm256_storeu_si256((__m256i*)(c + 1 * ldc + half * 16 + 0), c10); _mm256_storeu_si256((__m256i*)(c + 1 * ldc + half * 16 + 8), c11);
+        _mm256_storeu_si256((__m256i*)(c + 2 * ldc + half * 16 + 0), c20); _mm256_storeu_si256((__m256i*)(c + 2 * ldc + half * 16 + 8), c21);
+        _mm256_storeu_si256((__m256i*)(c + 3 * ldc + half * 16 + 0), c30); _mm256_storeu_si256((__m256i*)(c + 3 * ldc + half * 16 + 8), c31);
+    }
+}
+
+/* @summary Implement the dot-product kernel using the VEX-encoded AVX-VNNI vpdpbusd, which multiplies and accumulates each group of QUANT_KR in a single instruction.
+ * The tile is computed as two 16-column halves, as for the AVX2 kernel.
+ */
+static CPU_TARGET("avx2,avxvnni") void
+QuantKernel_AVXVNNI
+(
+    uint32_t                   groups,
+    uint8_t const * __restrict      a,
+    size_t                        lda,
+    int8_t  const * __restrict      w,
+    int32_t       * __restrict      c,
+    size_t                        ldc
+)
+{
+    uint32_t half, g;
+
+    for (half = 0; half < 2; ++half) {
+        __m256i      c00 = _mm256_setzero_si256(), c01 = _mm256_setzero_si256();
+        __m256i      c10 = _mm256_setzero_si256(), c11 = _mm256_setzero_si256();
+        __m256i      c20 = _mm256_setzero_si256(), c21 = _mm256_setzero_si256();
+        __m256i      c30 = _mm256_setzero_si256(), c31 = _mm256_setzero_si256();
+        int8_t const *wp = w + (half * (QUANT_NR / 2) * QUANT_KR);
+
+        for (g = 0; g < groups; ++g) {
+            __m256i w0 = _mm256_load_si256((__m256i const*)(wp +  0));
+            __m256i w1 = _mm256_load_si256((__m256i const*)(wp + 32));
+            __m256i av;
+#define QUANT_AVXVNNI_STEP(_row, _acc0, _acc1)                                 \
+            av    = _mm256_set1_epi32(QuantLoadGroup(a + ((_row) * lda) + (g * QUANT_KR))); \
+            _acc0 = _mm256_dpbusd_avx_epi32(_acc0, av, w0);                    \
+            _acc1 = _mm256_dpbusd_avx_epi32(_acc1, av, w1)
+            QUANT_AVXVNNI_STEP(0, c00, c01);
+            QUANT_AVXVNNI_STEP(1, c10, c11);
+            QUANT_AVXVNNI_STEP(2, c20, c21);
+            QUANT_AVXVNNI_STEP(3, c30, c31);
+#undef  QUANT_AVXVNNI_STEP
+            wp += QUANT_NR * QUANT_KR;
+        }
+        _mm256_storeu_si256((__m256i*)(c + 0 * ldc + half * 16 + 0), c00); _mm256_storeu_si256((__m256i*)(c + 0 * ldc + half * 16 + 8), c01);
+        _mm256_storeu_si256((__m256i*)(c + 1 * ldc + half * 16 + 0), c10); _mm256_storeu_si256((__m256i*)(c + 1 * ldc + half * 16 + 8), c11);
+        _mm256_storeu_si256((__m256i*)(c + 2 * ldc + half * 16 + 0), c20); _mm256_storeu_si256((__m256i*)(c + 2 * ldc + half * 16 + 8), c21);
+        _mm256_storeu_si256((__m256i*)(c + 3 * ldc + half * 16 + 0), c30); _mm256_storeu_si256((__m256i*)(c + 3 * ldc + half * 16 + 8), c31);
+    }
+}
+
+/* @summary Implement the dot-product kernel using AVX-512 VNNI.
+ * Each of the four rows of the tile is held in two zmm accumulators covering all QUANT_NR columns, so each group loads
+ * the 128 bytes of weights once and issues eight vpdpbusd.
+ */
+static CPU_TARGET("avx512f,avx512bw,avx512vnni") void
+QuantKernel_AVX512VNNI
+(
+    uint32_t                   groups,
+    uint8_t const * __restrict      a,
+    size_t                        lda,
+    int8_t  const * __restrict      w,
+    int32_t       * __restrict      c,
+    size_t                        ldc
+)
+{
+    __m512i c00 = _mm512_setzero_si512(), c01 = _mm512_setzero_si512();
+    __m512i c10 = _mm512_setzero_si512(), c11 = _mm512_setzero_si512();
+    __m512i c20 = _mm512_setzero_si512(), c21 = _mm512_setzero_si512();
+    __m512i c30 = _mm512_setzero_si512(), c31 = _mm512_setzero_si512();
+    uint32_t g;
+
+    for (g = 0; g < groups; ++g) {
+        __m512i w0 = _mm512_load_si512((void const*)(w +  0));
+        __m512i w1 = _mm512_load_si512((void const*)(w + 64));
+        __m512i av;
+#define QUANT_AVX512_STEP(_row, _acc0, _acc1)                                  \
+        av    = _mm512_set1_epi32(QuantLoadGroup(a + ((_row) * lda) + (g * QUANT_KR))); \
+        _acc0 = _mm512_dpbusd_epi32(_acc0, av, w0);                            \
+        _acc1 = _mm512_dpbusd_epi32(_acc1, av, w1)
+        QUANT_AVX512_STEP(0, c00, c01);
+        QUANT_AVX512_STEP(1, c10, c11);
+        QUANT_AVX512_STEP(2, c20, c21);
+        QUANT_AVX512_STEP(3, c30, c31);
+#undef  QUANT_AVX512_STEP
+        w += QUANT_NR * QUANT_KR;
+    }
+    _mm512_storeu_si512((void*)(c + 0 * ldc + 0), c00); _mm512_storeu_si512((void*)(c + 0 * ldc + 16), c01);
+    _mm512_storeu_si512((void*)(c + 1 * ldc + 0), c10); _mm512_storeu_si512((void*)(c + 1 * ldc + 16), c11);
+    _mm512_storeu_si512((void*)(c + 2 * ldc + 0), c20); _mm512_storeu_si512((void*)(c + 2 * ldc + 16), c21);
+    _mm512_storeu_si512((void*)(c + 3 * ldc + 0), c30); _mm512_storeu_si512((void*)(c + 3 * ldc + 16), c31);
+}
+#endif /* CPU_ARCH_X86 */
+
+/* @summary Retrieve the dot-product kernel implementation for a kernel identifier.
+ * @param kernel One of the values of the QUANT_KERNEL enumeration.
+ * @return The kernel, or NULL if the kernel is not supported by the host CPU.
+ */
+static QUANT_KERNEL_FUNC
+QuantKernel
+(
+    uint32_t kernel
+)
+{
+#if CPU_ARCH_X86
+    uint32_t const avx512 = CPU_FEATURE_AVX512F | CPU_FEATURE_AVX512BW | CPU_FEATURE_AVX512VNNI;
+    uint32_t const    cpu = CpuFeatureFlags();
+#endif
+    switch (kernel) {
+        case QUANT_KERNEL_SCALAR:
+            return QuantKernel_Scalar;
+#if CPU_ARCH_X86
+        case QUANT_KERNEL_AVX2:
+            return (cpu & CPU_FEATURE_AVX2) ? QuantKernel_AVX2 : NULL;
+        case QUANT_KERNEL_AVXVNNI:
+            return ((cpu & (CPU_FEATURE_AVX2 | CPU_FEATURE_AVXVNNI)) == (CPU_FEATURE_AVX2 | CPU_FEATURE_AVXVNNI)) ? QuantKernel_AVXVNNI : NULL;
+        case QUANT_KERNEL_AVX512VNNI:
+            return ((cpu & avx512) == avx512) ? QuantKernel_AVX512VNNI : NULL;
+#endif
+        default:
+            return NULL;
+    }
+}
+
+/* @summary Retrieve the selected dot-product kernel, selecting the fastest kernel supported by the host on first use.
+ * @return The dot-product kernel.
+ */
+static QUANT_KERNEL_FUNC
+QuantCurrentKernel
+(
+    void
+)
+{
+    QUANT_KERNEL_FUNC kernel = Global_QuantKernel;
+    if (kernel == NULL) {
+        uint32_t id = QUANT_KERNEL_COUNT;
+        while (kernel == NULL && id-- > 0) {
+            kernel = QuantKernel(id);
+        }
+        Global_QuantKernel = kernel;
+    }
+    return kernel;
+}
+
+/* @summary Compute the number of bytes needed for a buffer, rounded up to QUANT_ALIGNMENT.
+ * @param nbytes The number of bytes.
+ * @return The buffer size, in bytes.
+ */
+static size_t
+QuantBufferSize
+(
+    size_t nbytes
+)
+{
+    return AlignUp(nbytes, (size_t) QUANT_ALIGNMENT);
+}
+
+/* @summary Compute the amount of frame arena memory used by one thread of QuantMlpClassify or QuantMlpEvaluate.
+ * @param qmlp The network being evaluated, with its layers initialized.
+ * @return The number of bytes allocated by QuantEvaluateThreadCreate.
+ */
+static size_t
+QuantEvaluateThreadSize
+(
+    QUANT_MLP const *qmlp
+)
+{
+    QUANT_LAYER const *out = &qmlp->Layers[qmlp->LayerCount - 1];
+    size_t const      rows = AlignUp((size_t) qmlp->MaxBatchSize, (size_t) QUANT_MR);
+    size_t      max_stride = 0;
+    size_t           total = QuantBufferSize(rows * out->OutputStride * sizeof(float));
+    uint32_t             l;
+    for (l = 0; l < qmlp->LayerCount; ++l) {
+        QUANT_LAYER const *layer = &qmlp->Layers[l];
+        total     += QuantBufferSize(rows * layer->InputStride);
+        max_stride = layer->OutputStride > max_stride ? layer->OutputStride : max_stride;
+    }
+    return total + QuantBufferSize(rows * max_stride * sizeof(int32_t));
+}
+
+/* @summary Compute the capacity of the frame arena needed to evaluate with a given number of threads.
+ * @param qmlp The network, with its layers initialized.
+ * @param thread_count The number of threads that may run QuantMlpEvaluate tasks.
+ * @return The required frame arena capacity, in bytes.
+ */
+static size_t
+QuantFrameSize
+(
+    QUANT_MLP const   *qmlp,
+    uint32_t   thread_count
+)
+{
+    return QuantBufferSize(thread_count * sizeof(QUANT_EVALUATE_THREAD)) + (thread_count * QuantEvaluateThreadSize(qmlp));
+}
+
+/* @summary Allocate the scratch state for one thread of QuantMlpClassify or QuantMlpEvaluate from an arena.
+ * Fresh arena memory is zeroed, so the padding bytes of every input row read by the kernels hold defined values.
+ * @param o_thread The QUANT_EVALUATE_THREAD to initialize.
+ * @param qmlp The network being evaluated.
+ * @param arena The arena to allocate from.
+ * @return Zero if the state is allocated, or -1 if the arena does not have enough space.
+ */
+static int
+QuantEvaluateThreadCreate
+(
+    QUANT_EVALUATE_THREAD *o_thread,
+    QUANT_MLP const           *qmlp,
+    MEMORY_ARENA             *arena
+)
+{
+    QUANT_LAYER const *out = &qmlp->Layers[qmlp->LayerCount - 1];
+    size_t const      rows = AlignUp((size_t) qmlp->MaxBatchSize, (size_t) QUANT_MR);
+    size_t      max_stride = 0;
+    uint32_t             l;
+
+    memset(o_thread, 0, sizeof(QUANT_EVALUATE_THREAD));
+    for (l = 0; l < qmlp->LayerCount; ++l) {
+        QUANT_LAYER const *layer = &qmlp->Layers[l];
+        if ((o_thread->Inputs[l] = (uint8_t*) ArenaAllocate(arena, QuantBufferSize(rows * layer->InputStride), QUANT_ALIGNMENT)) == NULL) {
+            return -1;
+        }
+        max_stride = layer->OutputStride > max_stride ? layer->OutputStride : max_stride;
+    }
+    if ((o_thread->Sums   = (int32_t*) ArenaAllocate(arena, QuantBufferSize(rows * max_stride * sizeof(int32_t))     , QUANT_ALIGNMENT)) == NULL ||
+        (o_thread->Logits = (float  *) ArenaAllocate(arena, QuantBufferSize(rows * out->OutputStride * sizeof(float)), QUANT_ALIGNMENT)) == NULL) {
+        return -1;
+    }
+    return 0;
+}
+
+/* @summary Run the forward pass for a batch whose first-layer inputs have been written to thread->Inputs[0].
+ * Each weight panel is applied to every row of the batch before moving to the next, so a panel is read from memory once per batch.
+ * @param qmlp The network.
+ * @param kernel The dot-product kernel.
+ * @param thread The scratch state holding the inputs. On return, Logits holds the outputs of the last layer.
+ * @param count The number of rows in the batch, at most MaxBatchSize.
+ */
+static void
+QuantForwardLayers
+(
+    QUANT_MLP const           *qmlp,
+    QUANT_KERNEL_FUNC        kernel,
+    QUANT_EVALUATE_THREAD    *thread,
+    uint32_t                  count
+)
+{
+    uint32_t const rows = AlignUp(count, (uint32_t) QUANT_MR);
+    uint32_t l, p, i, j;
+
+    for (l = 0; l < qmlp->LayerCount; ++l) {
+        QUANT_LAYER const *layer = &qmlp->Layers[l];
+        uint8_t const         *x = thread->Inputs[l];
+        size_t const         ldc = layer->OutputStride;
+        size_t const  panel_size = (size_t) layer->GroupCount * QUANT_NR * QUANT_KR;
+
+        for (p = 0; p < layer->OutputStride / QUANT_NR; ++p) {
+            int8_t const *wp = layer->Weights + (p * panel_size);
+            for (i = 0; i < rows; i += QUANT_MR) {
+                kernel(layer->GroupCount, x + ((size_t) i * layer->InputStride), layer->InputStride, wp, thread->Sums + (i * ldc) + (p * QUANT_NR), ldc);
+            }
+        }
+        if (l + 1 < qmlp->LayerCount) {
+            /* fused ReLU and requantization; the padding channels have zero multiplier and bias, and so quantize to zero */
+            QUANT_LAYER const *next = &qmlp->Layers[l + 1];
+            float const        inv = 1.0f / layer->OutputScale;
+            for (i = 0; i < count; ++i) {
+                int32_t const *s = thread->Sums + (i * ldc);
+                uint8_t       *y = thread->Inputs[l + 1] + ((size_t) i * next->InputStride);
+                for (j = 0; j < layer->OutputStride; ++j) {
+                    float v = (((float) s[j] * layer->Multiplier[j]) + layer->Bias[j]) * inv;
+                    v    = v > 0.0f ? v + 0.5f : 0.0f;
+                    y[j] = (uint8_t)(v < (float) QUANT_ACTIVATION_MAX ? v : (float) QUANT_ACTIVATION_MAX);
+                }
+            }
+        } else {
+            for (i = 0; i < count; ++i) {
+                int32_t const *s = thread->Sums   + (i * ldc);
+                float         *z = thread->Logits + (i * ldc);
+                for (j = 0; j < layer->OutputCount; ++j) {
+                    z[j] = ((float) s[j] * layer->Multiplier[j]) + layer->Bias[j];
+                }
+            }
+        }
+    }
+}
+
+/* @summary Quantize a batch of images into the first-layer inputs of a thread's scratch state.
+ * @param qmlp The network.
+ * @param thread The scratch state to fill.
+ * @param pixels The first pixel of the first image.
+ * @param pixel_stride The distance between the start of consecutive images, in bytes.
+ * @param count The number of images, at most MaxBatchSize.
+ */
+static void
+QuantLoadInputs
+(
+    QUANT_MLP const           *qmlp,
+    QUANT_EVALUATE_THREAD    *thread,
+    uint8_t const            *pixels,
+    size_t              pixel_stride,
+    uint32_t                   count
+)
+{
+    uint32_t const stride = qmlp->Layers[0].InputStride;
+    uint32_t i, k;
+    for (i = 0; i < count; ++i) {
+        uint8_t const *src = pixels + (i * pixel_stride);
+        uint8_t       *dst = thread->Inputs[0] + ((size_t) i * stride);
+        for (k = 0; k < qmlp->InputCount; ++k) {
+            dst[k] = qmlp->PixelTable[src[k]];
+        }
+    }
+}
+
+/* @summary Find the largest logit of a row.
+ * @param z The logits.
+ * @param count The number of logits.
+ * @return The index of the largest logit.
+ */
+static uint32_t
+QuantArgMax
+(
+    float const *z,
+    uint32_t count
+)
+{
+    uint32_t best = 0;
+    uint32_t    j;
+    for (j = 1; j < count; ++j) {
+        if (z[j] > z[best]) {
+            best = j;
+        }
+    }
+    return best;
+}
+
+/* @summary Classify a range of batches for QuantMlpEvaluate. Batch b contains samples [b * MaxBatchSize, (b + 1) * MaxBatchSize).
+ * @param argp Pointer to the QUANT_EVALUATE_ARGS.
+ * @param begin The first batch index.
+ * @param end One past the last batch index.
+ * @param thread_index The index of the calling thread, selecting its scratch state.
+ */
+static void
+QuantEvaluateBatches
+(
+    void          *argp,
+    uint32_t      begin,
+    uint32_t        end,
+    uint32_t thread_index
+)
+{
+    QUANT_EVALUATE_ARGS const *args = (QUANT_EVALUATE_ARGS const*) argp;
+    QUANT_MLP const           *qmlp = args->Network;
+    QUANT_LAYER const          *out = &qmlp->Layers[qmlp->LayerCount - 1];
+    QUANT_EVALUATE_THREAD   *thread = &args->Threads[thread_index];
+    MNIST_DATASET const         *ds = args->Source->Dataset;
+    uint32_t b, i, j;
+
+    for (b = begin; b < end; ++b) {
+        uint32_t  base = b * qmlp->MaxBatchSize;
+        uint32_t count = ds->SampleCount - base;
+        if (count > qmlp->MaxBatchSize) {
+            count = qmlp->MaxBatchSize;
+        }
+        QuantLoadInputs(qmlp, thread, MnistDatasetImage(ds, base), ds->ImageSize, count);
+        QuantForwardLayers(qmlp, args->Kernel, thread, count);
+        for (i = 0; i < count; ++i) {
+            float const *z = thread->Logits + ((size_t) i * out->OutputStride);
+            uint32_t     y = MnistDatasetLabel(ds, base + i);
+            uint32_t  best = QuantArgMax(z, out->OutputCount);
+            double     sum = 0.0;
+            double       p;
+            if (best == y) {
+                thread->Correct++;
+            }
+            for (j = 0; j < out->OutputCount; ++j) {
+                sum += exp((double)(z[j] - z[best]));
+            }
+            p = exp((double)(z[y] - z[best])) / sum;
+            thread->Loss -= log(p > QUANT_MIN_PROBABILITY ? p : QUANT_MIN_PROBABILITY);
+        }
+    }
+}
+
+/* @summary Find the largest hidden-layer activations of the float network over a slice of a data set.
+ * @param o_max On return, the largest output of each hidden layer, LayerCount - 1 entries.
+ * @param mlp The float network.
+ * @param source The calibration data.
+ * @param count The number of samples to run, from the start of the data set.
+ * @return Zero if the activations were measured, or -1 if memory could not be allocated.
+ */
+static int
+QuantCalibrate
+(
+    float                   *o_max,
+    MLP                       *mlp,
+    MINIBATCH_SOURCE const *source,
+    uint32_t                 count
+)
+{
+    MINIBATCH      batch;
+    uint32_t   *indices = NULL;
+    float          *row = NULL;
+    size_t   max_stride = 0;
+    uint32_t base, i, j;
+    uint32_t         l;
+
+    for (l = 0; l + 1 < mlp->LayerCount; ++l) {
+        o_max[l]   = 0.0f;
+        max_stride = mlp->Layers[l].OutputStride > max_stride ? mlp->Layers[l].OutputStride : max_stride;
+    }
+    /* in mixed-precision mode only the 16-bit hidden activations are kept; each row is widened into row before it is scanned */
+    if ((indices = (uint32_t*) malloc(mlp->MaxBatchSize * sizeof(uint32_t))) == NULL ||
+        (row     = (float   *) malloc((max_stride + 1) * sizeof(float))) == NULL) {
+        free(indices);
+        errno = ENOMEM;
+        return -1;
+    }
+    if (MinibatchCreate(&batch, mlp->MaxBatchSize, mlp->InputCount) != 0) {
+        free(row);
+        free(indices);
+        return -1;
+    }
+    for (base = 0; base < count; base += mlp->MaxBatchSize) {
+        uint32_t n = count - base;
+        if (n > mlp->MaxBatchSize) {
+            n = mlp->MaxBatchSize;
+        }
+        for (i = 0; i < n; ++i) {
+            indices[i] = base + i;
+        }
+        MinibatchGather(&batch, source, indices, n);
+        MlpForward(mlp, batch.Inputs, batch.RowStride, n);
+        for (l = 0; l + 1 < mlp->LayerCount; ++l) {
+            MLP_LAYER const *layer = &mlp->Layers[l];
+            float          max_out = o_max[l];
+            for (i = 0; i < n; ++i) {
+                float const *y = layer->Outputs + ((size_t) i * layer->OutputStride);
+                if (layer->OutputsHalf != NULL) {
+                    ConvertHalfToF32(row, layer->OutputsHalf + ((size_t) i * layer->OutputStride), layer->OutputCount, mlp->Precision);
+                    y = row;
+                }
+                for (j = 0; j < layer->OutputCount; ++j) {
+                    max_out = y[j] > max_out ? y[j] : max_out;
+                }
+            }
+            o_max[l] = max_out;
+        }
+    }
+    MinibatchDelete(&batch);
+    free(row);
+    free(indices);
+    return 0;
+}
+
+/* @summary Quantize the weights of a float layer with one scale per output channel, and pack them for the dot-product kernels.
+ * @param qlayer The quantized layer, with its counts, strides, InputScale and buffers set. Weights, Multiplier and Bias must be zeroed.
+ * @param layer The float layer.
+ * @param input_bias The real value represented by a quantized input of zero. The bias absorbs input_bias times each weight column sum.
+ */
+static void
+QuantPackLayer
+(
+    QUANT_LAYER     *qlayer,
+    MLP_LAYER const  *layer,
+    float         input_bias
+)
+{
+    size_t const panel_size = (size_t) qlayer->GroupCount * QUANT_NR * QUANT_KR;
+    uint32_t i, j;
+
+    for (j = 0; j < layer->OutputCount; ++j) {
+        int8_t *wp = qlayer->Weights + ((j / QUANT_NR) * panel_size) + ((j % QUANT_NR) * QUANT_KR);
+        float  max_abs = 0.0f;
+        double col_sum = 0.0;
+        float    scale;
+        float      inv;
+        for (i = 0; i < layer->InputCount; ++i) {
+            float w  = layer->Weights[(size_t) i * layer->OutputStride + j];
+            max_abs  = fabsf(w) > max_abs ? fabsf(w) : max_abs;
+            col_sum += w;
+        }
+        scale = max_abs > 0.0f ? max_abs / (float) QUANT_WEIGHT_MAX : 1.0f;
+        inv   = 1.0f / scale;
+        for (i = 0; i < layer->InputCount; ++i) {
+            float q = layer->Weights[(size_t) i * layer->OutputStride + j] * inv;
+            q = q < 0.0f ? q - 0.5f : q + 0.5f;
+            q = q >  (float) QUANT_WEIGHT_MAX ?  (float) QUANT_WEIGHT_MAX : q;
+            q = q < -(float) QUANT_WEIGHT_MAX ? -(float) QUANT_WEIGHT_MAX : q;
+            wp[((i / QUANT_KR) * QUANT_NR * QUANT_KR) + (i % QUANT_KR)] = (int8_t) q;
+        }
+        qlayer->Multiplier[j] = qlayer->InputScale * scale;
+        qlayer->Bias[j]       = layer->Bias[j] + (float)(input_bias * col_sum);
+    }
+}
+
+MNIST_API(int)
+QuantMlpCreate
+(
+    struct QUANT_MLP                   *o_qmlp,
+    struct MLP                            *mlp,
+    struct MINIBATCH_SOURCE const *calibration,
+    uint32_t                 calibration_count
+)
+{
+    float max_out[MLP_MAX_LAYERS];
+    size_t     total = 0;
+    uint32_t       l;
+    uint32_t       p;
+
+    assert(o_qmlp != NULL);
+    memset(o_qmlp, 0, sizeof(QUANT_MLP));
+
+    if (mlp == NULL || mlp->LayerCount == 0 || calibration == NULL || calibration->Dataset == NULL ||
+        calibration->Dataset->ImageSize != mlp->InputCount || !(calibration->Scale > 0.0f)) {
+        errno = EINVAL;
+        return -1;
+    }
+    if (calibration_count > calibration->Dataset->SampleCount) {
+        calibration_count = calibration->Dataset->SampleCount;
+    }
+    if (QuantCalibrate(max_out, mlp, calibration, calibration_count) != 0) {
+        return -1;
+    }
+    o_qmlp->LayerCount   = mlp->LayerCount;
+    o_qmlp->InputCount   = mlp->InputCount;
+    o_qmlp->OutputCount  = mlp->OutputCount;
+    o_qmlp->MaxBatchSize = mlp->MaxBatchSize;
+    for (l = 0; l < mlp->LayerCount; ++l) {
+        MLP_LAYER const *layer = &mlp->Layers[l];
+        QUANT_LAYER    *qlayer = &o_qmlp->Layers[l];
+        qlayer->InputCount     = layer->InputCount;
+        qlayer->OutputCount    = layer->OutputCount;
+        qlayer->GroupCount     = (layer->InputCount + QUANT_KR - 1) / QUANT_KR;
+        qlayer->InputStride    = AlignUp(layer->InputCount , (uint32_t) QUANT_ALIGNMENT);
+        qlayer->OutputStride   = AlignUp(layer->OutputCount, (uint32_t) QUANT_NR);
+        /* pixels map onto [0, QUANT_ACTIVATION_MAX]; a hidden layer's largest calibrated output maps onto QUANT_ACTIVATION_MAX */
+        qlayer->InputScale     = (l == 0) ? calibration->Scale * 255.0f / (float) QUANT_ACTIVATION_MAX : o_qmlp->Layers[l - 1].OutputScale;
+        qlayer->OutputScale    = 0.0f;
+        if (l + 1 < mlp->LayerCount) {
+            qlayer->OutputScale = max_out[l] > 0.0f ? max_out[l] / (float) QUANT_ACTIVATION_MAX : 1.0f;
+        }
+        total += QuantBufferSize((size_t)(qlayer->OutputStride / QUANT_NR) * qlayer->GroupCount * QUANT_NR * QUANT_KR);
+        total += 2 * QuantBufferSize(qlayer->OutputStride * sizeof(float));
+    }
+    for (p = 0; p < 256; ++p) {
+        o_qmlp->PixelTable[p] = (uint8_t)(((p * QUANT_ACTIVATION_MAX * 2) + 255) / (2 * 255));
+    }
+    /* the storage arena is sized exactly, and fresh arena memory is zeroed, which keeps every padding weight, multiplier and bias zero */
+    if (ArenaCreate(&o_qmlp->Storage, total, ARENA_FLAGS_NONE) != 0) {
+        memset(o_qmlp, 0, sizeof(QUANT_MLP));
+        return -1;
+    }
+    for (l = 0; l < mlp->LayerCount; ++l) {
+        QUANT_LAYER *qlayer = &o_qmlp->Layers[l];
+        qlayer->Weights     = (int8_t*) ArenaAllocate(&o_qmlp->Storage, QuantBufferSize((size_t)(qlayer->OutputStride / QUANT_NR) * qlayer->GroupCount * QUANT_NR * QUANT_KR), QUANT_ALIGNMENT);
+        qlayer->Multiplier  = (float *) ArenaAllocate(&o_qmlp->Storage, QuantBufferSize(qlayer->OutputStride * sizeof(float)), QUANT_ALIGNMENT);
+        qlayer->Bias        = (float *) ArenaAllocate(&o_qmlp->Storage, QuantBufferSize(qlayer->OutputStride * sizeof(float)), QUANT_ALIGNMENT);
+        QuantPackLayer(qlayer, &mlp->Layers[l], (l == 0) ? calibration->Bias : 0.0f);
+    }
+    if (ArenaCreate(&o_qmlp->Frame, QuantFrameSize(o_qmlp, 1), ARENA_FLAGS_NONE) != 0) {
+        ArenaDelete(&o_qmlp->Storage);
+        memset(o_qmlp, 0, sizeof(QUANT_MLP));
+        return -1;
+    }
+    return 0;
+}
+
+MNIST_API(void)
+QuantMlpDelete
+(
+    struct QUANT_MLP *qmlp
+)
+{
+    if (qmlp != NULL) {
+        ArenaDelete(&qmlp->Frame);
+        ArenaDelete(&qmlp->Storage);
+        memset(qmlp, 0, sizeof(QUANT_MLP));
+    }
+}
+
+MNIST_API(int)
+QuantMlpSetTaskPool
+(
+    struct QUANT_MLP *qmlp,
+    struct TASK_POOL *pool
+)
+{
+    size_t need = QuantFrameSize(qmlp, TaskPoolThreadCount(pool));
+    if (need > qmlp->Frame.Capacity) {
+        MEMORY_ARENA frame;
+        if (ArenaCreate(&frame, need, ARENA_FLAGS_NONE) != 0) {
+            return -1;
+        }
+        ArenaDelete(&qmlp->Frame);
+        qmlp->Frame = frame;
+    }
+    qmlp->TaskPool = pool;
+    return 0;
+}
+
+MNIST_API(void)
+QuantMlpClassify
+(
+    struct QUANT_MLP     *qmlp,
+    uint8_t const      *pixels,
+    size_t        pixel_stride,
+    uint32_t             count,
+    uint8_t         *o_classes
+)
+{
+    QUANT_LAYER const *out = &qmlp->Layers[qmlp->LayerCount - 1];
+    QUANT_EVALUATE_THREAD thread;
+    uint32_t   i;
+    int      res;
+
+    assert(count <= qmlp->MaxBatchSize);
+    ArenaReset(&qmlp->Frame);
+    res = QuantEvaluateThreadCreate(&thread, qmlp, &qmlp->Frame);
+    /* the frame arena is sized for at least one thread in QuantMlpCreate */
+    assert(res == 0); (void) res;
+    QuantLoadInputs(qmlp, &thread, pixels, pixel_stride, count);
+    QuantForwardLayers(qmlp, QuantCurrentKernel(), &thread, count);
+    for (i = 0; i < count; ++i) {
+        o_classes[i] = (uint8_t) QuantArgMax(thread.Logits + ((size_t) i * out->OutputStride), out->OutputCount);
+    }
+}
+
+MNIST_API(int)
+QuantMlpEvaluate
+(
+    struct QUANT_MLP                *qmlp,
+    struct MINIBATCH_SOURCE const *source,
+    uint32_t                    *o_correct,
+    float                          *o_loss
+)
+{
+    QUANT_EVALUATE_ARGS     args;
+    QUANT_EVALUATE_THREAD *threads = NULL;
+    uint32_t          thread_count = TaskPoolThreadCount(qmlp->TaskPool);
+    uint32_t           batch_count;
+    uint32_t               correct = 0;
+    double                    loss = 0.0;
+    uint32_t                     t;
+
+    assert(o_correct != NULL);
+    *o_correct = 0;
+    if (o_loss != NULL) {
+        *o_loss = 0.0f;
+    }
+    assert(source->Dataset->ImageSize == qmlp->InputCount);
+    ArenaReset(&qmlp->Frame);
+    if ((threads = (QUANT_EVALUATE_THREAD*) ArenaAllocate(&qmlp->Frame, thread_count * sizeof(QUANT_EVALUATE_THREAD), QUANT_ALIGNMENT)) == NULL) {
+        return -1;
+    }
+    for (t = 0; t < thread_count; ++t) {
+        if (QuantEvaluateThreadCreate(&threads[t], qmlp, &qmlp->Frame) != 0) {
+            return -1;
+        }
+    }
+    args.Network = qmlp;
+    args.Kernel  = QuantCurrentKernel();
+    args.Source  = source;
+    args.Threads = threads;
+    batch_count  = (source->Dataset->SampleCount + qmlp->MaxBatchSize - 1) / qmlp->MaxBatchSize;
+    TaskPoolParallelFor(qmlp->TaskPool, batch_count, 1, QuantEvaluateBatches, &args);
+    for (t = 0; t < thread_count; ++t) {
+        correct += threads[t].Correct;
+        loss    += threads[t].Loss;
+    }
+    *o_correct = correct;
+    if (o_loss != NULL && source->Dataset->SampleCount > 0) {
+        *o_loss = (float)(loss / source->Dataset->SampleCount);
+    }
+    return 0;
+}
+
+MNIST_API(int)
+QuantSelectKernel
+(
+    uint32_t kernel
+)
+{
+    QUANT_KERNEL_FUNC func = QuantKernel(kernel);
+    if (func == NULL) {
+        errno = ENOTSUP;
+        return -1;
+    }
+    Global_QuantKernel = func;
+    return 0;
+}
+
+MNIST_API(char const*)
+QuantKernelName
+(
+    uint32_t kernel
+)
+{
+    switch (kernel) {
+        case QUANT_KERNEL_SCALAR    : return "scalar";
+        case QUANT_KERNEL_AVX2      : return "avx2";
+        case QUANT_KERNEL_AVXVNNI   : return "avxvnni";
+        case QUANT_KERNEL_AVX512VNNI: return "avx512vnni";
+        default                     : return "unknown";
+    }
+}
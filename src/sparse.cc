@@ -0,0 +1,471 @@
+/**
+ * @summary Implement the functions exported by the sparse.h module for
+ * multiplying CSR matrices by dense matrices.
+ */
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+#include <errno.h>
+
+#include "cpuinfo.h"
+#include "taskpool.h"
+#include "sparse.h"
+
+#if CPU_ARCH_X86
+#include <immintrin.h>
+#endif
+
+/* @summary Retrieve the smaller of two values.
+ */
+#ifndef MinValue
+#define MinValue(_a, _b)                                                       \
+    (((_a) < (_b)) ? (_a) : (_b))
+#endif
+
+/* @summary Define the signature of a sparse product kernel, which computes C = op(A) * B + beta * C.
+ * @param trans_a Zero to use A, or non-zero to use its transpose.
+ * @param n The number of columns in B and C.
+ * @param a The sparse matrix.
+ * @param b The dense matrix B.
+ * @param ldb The distance between the start of consecutive rows of B, in floats.
+ * @param beta The scale applied to C. If zero, C is not read. With a transpose, the rows of C are scattered, so beta must be one and the caller scales C beforehand.
+ * @param c The dense matrix C.
+ * @param ldc The distance between the start of consecutive rows of C, in floats.
+ */
+typedef void (*SPARSE_GEMM_FUNC)
+(
+    uint32_t            trans_a,
+    uint32_t                  n,
+    SPARSE_CSR const         *a,
+    float const * __restrict  b,
+    size_t                  ldb,
+    float                  beta,
+    float       * __restrict  c,
+    size_t                  ldc
+);
+
+/* @summary Define the arguments shared by the tasks of SparseGemmF32Parallel.
+ */
+typedef struct SPARSE_PARALLEL_ARGS {
+    SPARSE_GEMM_FUNC             Kernel;                                       /* The sparse product kernel. */
+    SPARSE_CSR const            *A;                                            /* The sparse matrix. */
+    float const                 *B;                                            /* The dense matrix B. */
+    float                       *C;                                            /* The dense matrix C. */
+    size_t                       Ldb;                                          /* The distance between the start of consecutive rows of B, in floats. */
+    size_t                       Ldc;                                          /* The distance between the start of consecutive rows of C, in floats. */
+    float                        Beta;                                         /* The scale applied to C. */
+    uint32_t                     TransA;                                       /* Non-zero if the transpose of A is used. */
+    uint32_t                     M;                                            /* The number of rows of C. */
+    uint32_t                     N;                                            /* The number of columns of B and C. */
+    uint32_t                     TileCountN;                                   /* The number of SPARSE_TILE_N column tiles. */
+} SPARSE_PARALLEL_ARGS;
+
+/* @summary The kernel used by SparseGemmF32, selected on first use or by SparseSelectKernel.
+ */
+static SPARSE_GEMM_FUNC volatile Global_SparseGemm = NULL;
+
+/* @summary Compute C = beta * C for an m x n matrix. If beta is zero, C is cleared without being read.
+ */
+static void
+SparseScaleC
+(
+    uint32_t    m,
+    uint32_t    n,
+    float    beta,
+    float      *c,
+    size_t    ldc
+)
+{
+    uint32_t i, j;
+    for (i = 0; i < m; ++i) {
+        float *crow = c + (i * ldc);
+        if (beta == 0.0f) {
+            memset(crow, 0, n * sizeof(float));
+        } else if (beta != 1.0f) {
+            for (j = 0; j < n; ++j) {
+                crow[j] *= beta;
+            }
+        }
+    }
+}
+
+/* @summary Compute C = op(A) * B + beta * C one element at a time.
+ */
+static void
+SparseGemm_Scalar
+(
+    uint32_t            trans_a,
+    uint32_t                  n,
+    SPARSE_CSR const         *a,
+    float const * __restrict  b,
+    size_t                  ldb,
+    float                  beta,
+    float       * __restrict  c,
+    size_t                  ldc
+)
+{
+    uint32_t i, p, j;
+    for (i = 0; i < a->RowCount; ++i) {
+        if (trans_a == 0) {
+            SparseScaleC(1, n, beta, c + (i * ldc), ldc);
+        }
+        for (p = a->RowOffsets[i]; p < a->RowOffsets[i + 1]; ++p) {
+            float const  v = a->Values[p];
+            float const *x = trans_a ? b + (i * ldb) : b + (a->Columns[p] * ldb);
+            float       *y = trans_a ? c + (a->Columns[p] * ldc) : c + (i * ldc);
+            for (j = 0; j < n; ++j) {
+                y[j] += v * x[j];
+            }
+        }
+    }
+}
+
+#if CPU_ARCH_X86
+/* @summary Compute C = op(A) * B + beta * C using AVX2 and FMA.
+ * Without a transpose, each 64-column strip of a row of C is accumulated in eight registers across every nonzero of the row of A.
+ * With a transpose, each 64-column strip of a row of B is held in eight registers and scattered into the rows of C selected by the nonzeros of the row of A.
+ */
+static CPU_TARGET("avx2,fma") void
+SparseGemm_AVX2
+(
+    uint32_t            trans_a,
+    uint32_t                  n,
+    SPARSE_CSR const         *a,
+    float const * __restrict  b,
+    size_t                  ldb,
+    float                  beta,
+    float       * __restrict  c,
+    size_t                  ldc
+)
+{
+    __m256 const vbeta = _mm256_set1_ps(beta);
+    uint32_t i, p, j;
+
+    /* when beta is zero C is never read, so the accumulators start from zero instead of a cleared C */
+#define SPARSE_AVX2_LOAD_C(_p)                                                 \
+    ((beta == 0.0f) ? _mm256_setzero_ps() : _mm256_mul_ps(vbeta, _mm256_loadu_ps(_p)))
+
+    for (i = 0; i < a->RowCount; ++i) {
+        uint32_t const p0 = a->RowOffsets[i];
+        uint32_t const p1 = a->RowOffsets[i + 1];
+        if (trans_a == 0) {
+            float *crow = c + (i * ldc);
+            for (j = 0; j + 64 <= n; j += 64) {
+                __m256 c0 = SPARSE_AVX2_LOAD_C(crow + j +  0);
+                __m256 c1 = SPARSE_AVX2_LOAD_C(crow + j +  8);
+                __m256 c2 = SPARSE_AVX2_LOAD_C(crow + j + 16);
+                __m256 c3 = SPARSE_AVX2_LOAD_C(crow + j + 24);
+                __m256 c4 = SPARSE_AVX2_LOAD_C(crow + j + 32);
+                __m256 c5 = SPARSE_AVX2_LOAD_C(crow + j + 40);
+                __m256 c6 = SPARSE_AVX2_LOAD_C(crow + j + 48);
+                __m256 c7 = SPARSE_AVX2_LOAD_C(crow + j + 56);
+                for (p = p0; p < p1; ++p) {
+                    __m256 const     v = _mm256_set1_ps(a->Values[p]);
+                    float const *brow = b + (a->Columns[p] * ldb) + j;
+                    c0 = _mm256_fmadd_ps(v, _mm256_loadu_ps(brow +  0), c0);
+                    c1 = _mm256_fmadd_ps(v, _mm256_loadu_ps(brow +  8), c1);
+                    c2 = _mm256_fmadd_ps(v, _mm256_loadu_ps(brow + 16), c2);
+                    c3 = _mm256_fmadd_ps(v, _mm256_loadu_ps(brow + 24), c3);
+                    c4 = _mm256_fmadd_ps(v, _mm256_loadu_ps(brow + 32), c4);
+                    c5 = _mm256_fmadd_ps(v, _mm256_loadu_ps(brow + 40), c5);
+                    c6 = _mm256_fmadd_ps(v, _mm256_loadu_ps(brow + 48), c6);
+                    c7 = _mm256_fmadd_ps(v, _mm256_loadu_ps(brow + 56), c7);
+                }
+                _mm256_storeu_ps(crow + j +  0, c0);
+                _mm256_storeu_ps(crow + j +  8, c1);
+                _mm256_storeu_ps(crow + j + 16, c2);
+                _mm256_storeu_ps(crow + j + 24, c3);
+                _mm256_storeu_ps(crow + j + 32, c4);
+                _mm256_storeu_ps(crow + j + 40, c5);
+                _mm256_storeu_ps(crow + j + 48, c6);
+                _mm256_storeu_ps(crow + j + 56, c7);
+            }
+            for ( ; j + 8 <= n; j += 8) {
+                __m256 acc = SPARSE_AVX2_LOAD_C(crow + j);
+                for (p = p0; p < p1; ++p) {
+                    acc = _mm256_fmadd_ps(_mm256_set1_ps(a->Values[p]), _mm256_loadu_ps(b + (a->Columns[p] * ldb) + j), acc);
+                }
+                _mm256_storeu_ps(crow + j, acc);
+            }
+            for ( ; j < n; ++j) {
+                float acc = (beta == 0.0f) ? 0.0f : beta * crow[j];
+                for (p = p0; p < p1; ++p) {
+                    acc += a->Values[p] * b[(a->Columns[p] * ldb) + j];
+                }
+                crow[j] = acc;
+            }
+        } else {
+            float const *brow = b + (i * ldb);
+            for (j = 0; j + 64 <= n; j += 64) {
+                __m256 const x0 = _mm256_loadu_ps(brow + j +  0);
+                __m256 const x1 = _mm256_loadu_ps(brow + j +  8);
+                __m256 const x2 = _mm256_loadu_ps(brow + j + 16);
+                __m256 const x3 = _mm256_loadu_ps(brow + j + 24);
+                __m256 const x4 = _mm256_loadu_ps(brow + j + 32);
+                __m256 const x5 = _mm256_loadu_ps(brow + j + 40);
+                __m256 const x6 = _mm256_loadu_ps(brow + j + 48);
+                __m256 const x7 = _mm256_loadu_ps(brow + j + 56);
+                for (p = p0; p < p1; ++p) {
+                    __m256 const    v = _mm256_set1_ps(a->Values[p]);
+                    float       *crow = c + (a->Columns[p] * ldc) + j;
+                    _mm256_storeu_ps(crow +  0, _mm256_fmadd_ps(v, x0, _mm256_loadu_ps(crow +  0)));
+                    _mm256_storeu_ps(crow +  8, _mm256_fmadd_ps(v, x1, _mm256_loadu_ps(crow +  8)));
+                    _mm256_storeu_ps(crow + 16, _mm256_fmadd_ps(v, x2, _mm256_loadu_ps(crow + 16)));
+                    _mm256_storeu_ps(crow + 24, _mm256_fmadd_ps(v, x3, _mm256_loadu_ps(crow + 24)));
+                    _mm256_storeu_ps(crow + 32, _mm256_fmadd_ps(v, x4, _mm256_loadu_ps(crow + 32)));
+                    _mm256_storeu_ps(crow + 40, _mm256_fmadd_ps(v, x5, _mm256_loadu_ps(crow + 40)));
+                    _mm256_storeu_ps(crow + 48, _mm256_fmadd_ps(v, x6, _mm256_loadu_ps(crow + 48)));
+                    _mm256_storeu_ps(crow + 56, _mm256_fmadd_ps(v, x7, _mm256_loadu_ps(crow + 56)));
+                }
+            }
+            for ( ; j + 8 <= n; j += 8) {
+                __m256 const x = _mm256_loadu_ps(brow + j);
+                for (p = p0; p < p1; ++p) {
+                    float *crow = c + (a->Columns[p] * ldc) + j;
+                    _mm256_storeu_ps(crow, _mm256_fmadd_ps(_mm256_set1_ps(a->Values[p]), x, _mm256_loadu_ps(crow)));
+                }
+            }
+            for ( ; j < n; ++j) {
+                for (p = p0; p < p1; ++p) {
+                    c[(a->Columns[p] * ldc) + j] += a->Values[p] * brow[j];
+                }
+            }
+        }
+    }
+#undef  SPARSE_AVX2_LOAD_C
+}
+#endif /* CPU_ARCH_X86 */
+
+/* @summary Retrieve the sparse product implementation for a kernel identifier.
+ * @param kernel One of the values of the SPARSE_KERNEL enumeration.
+ * @return The kernel, or NULL if the kernel is not supported by the host CPU.
+ */
+static SPARSE_GEMM_FUNC
+SparseGemmKernel
+(
+    uint32_t kernel
+)
+{
+#if CPU_ARCH_X86
+    uint32_t cpu = CpuFeatureFlags();
+#endif
+    switch (kernel) {
+        case SPARSE_KERNEL_SCALAR:
+            return SparseGemm_Scalar;
+#if CPU_ARCH_X86
+        case SPARSE_KERNEL_AVX2:
+            return ((cpu & (CPU_FEATURE_AVX2 | CPU_FEATURE_FMA)) == (CPU_FEATURE_AVX2 | CPU_FEATURE_FMA)) ? SparseGemm_AVX2 : NULL;
+#endif
+        default:
+            return NULL;
+    }
+}
+
+/* @summary Retrieve the kernel used by SparseGemmF32, selecting the best supported kernel on first use.
+ * @return The sparse product kernel.
+ */
+static SPARSE_GEMM_FUNC
+SparseGemmCurrentKernel
+(
+    void
+)
+{
+    SPARSE_GEMM_FUNC func = Global_SparseGemm;
+    if (func == NULL) {
+        uint32_t kernel = SPARSE_KERNEL_COUNT;
+        while (func == NULL && kernel-- > 0) {
+            func = SparseGemmKernel(kernel);
+        }
+        Global_SparseGemm = func;
+    }
+    return func;
+}
+
+/* @summary Compute a range of tiles of C for SparseGemmF32Parallel.
+ * Without a transpose, tiles are SPARSE_TILE_M x SPARSE_TILE_N and numbered in row-major order; with a transpose, tiles are full-height column strips.
+ * @param argp Pointer to the SPARSE_PARALLEL_ARGS.
+ * @param begin The first tile index.
+ * @param end One past the last tile index.
+ * @param thread_index The index of the calling thread. Unused.
+ */
+static void
+SparseParallelCompute
+(
+    void          *argp,
+    uint32_t      begin,
+    uint32_t        end,
+    uint32_t thread_index
+)
+{
+    SPARSE_PARALLEL_ARGS const *args = (SPARSE_PARALLEL_ARGS const*) argp;
+    uint32_t t;
+
+    (void) thread_index;
+    for (t = begin; t < end; ++t) {
+        uint32_t   j0 = (t % args->TileCountN) * SPARSE_TILE_N;
+        uint32_t   nc = MinValue(args->N - j0, (uint32_t) SPARSE_TILE_N);
+        SPARSE_CSR view = *args->A;
+        uint32_t   i0 = 0;
+        uint32_t   mc = args->M;
+        if (args->TransA == 0) {
+            i0 = (t / args->TileCountN) * SPARSE_TILE_M;
+            mc = MinValue(args->M - i0, (uint32_t) SPARSE_TILE_M);
+            view.RowOffsets  += i0;
+            view.RowCount     = mc;
+            view.NonzeroCount = view.RowOffsets[mc] - view.RowOffsets[0];
+        }
+        if (args->TransA) {
+            SparseScaleC(mc, nc, args->Beta, args->C + j0, args->Ldc);
+        }
+        args->Kernel(args->TransA, nc, &view, args->B + j0, args->Ldb, args->TransA ? 1.0f : args->Beta, args->C + (i0 * args->Ldc) + j0, args->Ldc);
+    }
+}
+
+MNIST_API(uint32_t)
+SparseEncodeRowF32
+(
+    uint32_t * __restrict columns,
+    float    * __restrict  values,
+    float const *             src,
+    uint32_t                count
+)
+{
+    uint32_t nnz = 0;
+    uint32_t   j;
+    /* write every element and advance only past nonzeros, so the loop has no data-dependent branch */
+    for (j = 0; j < count; ++j) {
+        float x = src[j];
+        columns[nnz] = j;
+        values [nnz] = x;
+        nnz += (x != 0.0f) ? 1 : 0;
+    }
+    return nnz;
+}
+
+MNIST_API(void)
+SparseTranspose
+(
+    struct SPARSE_CSR       *dst,
+    struct SPARSE_CSR const *src
+)
+{
+    uint32_t const base = src->RowOffsets[0];
+    uint32_t i, p, sum;
+
+    /* counting sort by column; visiting rows in order keeps each output row sorted */
+    memset(dst->RowOffsets, 0, (src->ColumnCount + 1) * sizeof(uint32_t));
+    for (p = src->RowOffsets[0]; p < src->RowOffsets[src->RowCount]; ++p) {
+        dst->RowOffsets[src->Columns[p] + 1]++;
+    }
+    for (i = 0, sum = 0; i <= src->ColumnCount; ++i) {
+        sum += dst->RowOffsets[i];
+        dst->RowOffsets[i] = sum;
+    }
+    for (i = 0; i < src->RowCount; ++i) {
+        for (p = src->RowOffsets[i]; p < src->RowOffsets[i + 1]; ++p) {
+            uint32_t q = dst->RowOffsets[src->Columns[p]]++;
+            dst->Columns[q] = i;
+            dst->Values [q] = src->Values[p];
+        }
+    }
+    /* each offset now holds the end of its row; shift back to the starts */
+    memmove(dst->RowOffsets + 1, dst->RowOffsets, src->ColumnCount * sizeof(uint32_t));
+    dst->RowOffsets[0] = 0;
+    dst->RowCount      = src->ColumnCount;
+    dst->ColumnCount   = src->RowCount;
+    dst->NonzeroCount  = src->RowOffsets[src->RowCount] - base;
+}
+
+MNIST_API(void)
+SparseGemmF32
+(
+    uint32_t            trans_a,
+    uint32_t                  n,
+    struct SPARSE_CSR const  *a,
+    float const              *b,
+    uint32_t                ldb,
+    float                  beta,
+    float                    *c,
+    uint32_t                ldc
+)
+{
+    uint32_t m = trans_a ? a->ColumnCount : a->RowCount;
+    if (m == 0 || n == 0) {
+        return;
+    }
+    if (trans_a) {
+        SparseScaleC(m, n, beta, c, ldc);
+        beta = 1.0f;
+    }
+    SparseGemmCurrentKernel()(trans_a, n, a, b, ldb, beta, c, ldc);
+}
+
+MNIST_API(void)
+SparseGemmF32Parallel
+(
+    struct TASK_POOL       *pool,
+    uint32_t            trans_a,
+    uint32_t                  n,
+    struct SPARSE_CSR const  *a,
+    float const              *b,
+    uint32_t                ldb,
+    float                  beta,
+    float                    *c,
+    uint32_t                ldc
+)
+{
+    SPARSE_PARALLEL_ARGS args;
+    uint32_t       tile_count;
+
+    if (TaskPoolThreadCount(pool) <= 1) {
+        SparseGemmF32(trans_a, n, a, b, ldb, beta, c, ldc);
+        return;
+    }
+    args.Kernel     = SparseGemmCurrentKernel();
+    args.A          = a;
+    args.B          = b;
+    args.C          = c;
+    args.Ldb        = ldb;
+    args.Ldc        = ldc;
+    args.Beta       = beta;
+    args.TransA     = trans_a;
+    args.M          = trans_a ? a->ColumnCount : a->RowCount;
+    args.N          = n;
+    args.TileCountN = (n + SPARSE_TILE_N - 1) / SPARSE_TILE_N;
+    if (args.M == 0 || n == 0) {
+        return;
+    }
+    tile_count = args.TileCountN;
+    if (trans_a == 0) {
+        tile_count *= (args.M + SPARSE_TILE_M - 1) / SPARSE_TILE_M;
+    }
+    TaskPoolParallelFor(pool, tile_count, 1, SparseParallelCompute, &args);
+}
+
+MNIST_API(int)
+SparseSelectKernel
+(
+    uint32_t kernel
+)
+{
+    SPARSE_GEMM_FUNC func = SparseGemmKernel(kernel);
+    if (func == NULL) {
+        errno = ENOTSUP;
+        return -1;
+    }
+    Global_SparseGemm = func;
+    return 0;
+}
+
+MNIST_API(char const*)
+SparseKernelName
+(
+    uint32_t kernel
+)
+{
+    switch (kernel) {
+        case SPARSE_KERNEL_SCALAR: return "scalar";
+        case SPARSE_KERNEL_AVX2  : return "avx2";
+        default                  : return "unknown";
+    }
+}
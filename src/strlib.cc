@@ -7,155 +7,1771 @@
 #include <assert.h>
 #include <errno.h>
 
+#include "cpuinfo.h"
 #include "strlib.h"
 
+#if CPU_ARCH_X86
+#   include <immintrin.h>
+#   if defined(_MSC_VER)
+#       include <intrin.h>
+#   endif
+#endif
+
 /* @summary Count the number of bytes between two pointer values.
  * @param _beg A pointer to the start of the range (inclusive).
  * @param _end A pointer to one-past the end of the range (exclusive).
  * @return The number of bytes between _beg and _end.
  */
-#ifndef CountBytesInRange
-#define CountBytesInRange(_beg, _end)                                          \
-    (((uint8_t const*)(_end))-((uint8_t const*)(_beg)))
-#endif
+#ifndef CountBytesInRange
+#define CountBytesInRange(_beg, _end)                                          \
+    (((uint8_t const*)(_end))-((uint8_t const*)(_beg)))
+#endif
+
+/* @summary Search a UTF-8 string for a nul-terminator.
+ * @param start A pointer to the first codepoint to examine.
+ * @return A pointer to the terminating nul.
+ */
+static inline char8_t*
+Utf8FindNul
+(
+    char8_t const *start
+)
+{
+    char8_t *b =(char8_t*) start;
+    size_t len = 0;
+    if (start != NULL) {
+        len = strlen(start);
+    }
+    return (char8_t*)(b + len);
+}
+
+/* @summary Search a UTF-16 string for a nul-terminator.
+ * @param start A pointer to the first codepoint to examine.
+ * @return A pointer to the terminating nul.
+ */
+static inline char16_t*
+Utf16FindNul
+(
+    char16_t const *start
+)
+{
+    char16_t *nul = (char16_t*) start;
+    if (start != NULL) {
+        while (*nul) {
+            ++nul;
+        }
+    } return nul;
+}
+
+/* @summary Search a UTF-32 string for a nul-terminator.
+ * @param start A pointer to the first codepoint to examine.
+ * @return A pointer to the terminating nul.
+ */
+static inline char32_t*
+Utf32FindNul
+(
+    char32_t const *start
+)
+{
+    char32_t *nul = (char32_t*) start;
+    if (start != NULL) {
+        while (*nul) {
+            ++nul;
+        }
+    } return nul;
+}
+
+/* @summary Define the signature of a UTF-8 validation kernel. The arguments and return value are the same as for Utf8StringValidate.
+ */
+typedef int (*UTF8_VALIDATE_FUNC)
+(
+    size_t   *o_bytecount,
+    size_t   *o_charcount,
+    char8_t const *strbuf
+);
+
+/* @summary Mark a function that deliberately reads past the end of a string within an aligned block, which never crosses a page boundary.
+ */
+#ifndef STRLIB_NO_SANITIZE_ADDRESS
+#   if defined(__GNUC__) || defined(__clang__)
+#       define STRLIB_NO_SANITIZE_ADDRESS  __attribute__((no_sanitize_address))
+#   else
+#       define STRLIB_NO_SANITIZE_ADDRESS
+#   endif
+#endif
+
+/* @summary Validate a nul-terminated UTF-8 string and count its bytes and codepoints one codepoint at a time.
+ * The accepted byte sequences are those of table 3-7 of the Unicode standard.
+ */
+static int
+Utf8Validate_Scalar
+(
+    size_t   *o_bytecount,
+    size_t   *o_charcount,
+    char8_t const *strbuf
+)
+{
+    uint8_t const *p = (uint8_t const*) strbuf;
+    size_t     chars = 0;
+    int        valid = 1;
+    uint8_t        c;
+
+    while ((c = p[0]) != 0) {
+        size_t n = 0;
+        if (c < 0x80) {
+            n = 1;
+        } else if (c >= 0xC2 && c <= 0xDF) {
+            n = ((p[1] & 0xC0) == 0x80) ? 2 : 0;
+        } else if (c >= 0xE0 && c <= 0xEF) {
+            uint8_t lo = (c == 0xE0) ? 0xA0 : 0x80;
+            uint8_t hi = (c == 0xED) ? 0x9F : 0xBF;
+            n = (p[1] >= lo && p[1] <= hi && (p[2] & 0xC0) == 0x80) ? 3 : 0;
+        } else if (c >= 0xF0 && c <= 0xF4) {
+            uint8_t lo = (c == 0xF0) ? 0x90 : 0x80;
+            uint8_t hi = (c == 0xF4) ? 0x8F : 0xBF;
+            n = (p[1] >= lo && p[1] <= hi && (p[2] & 0xC0) == 0x80 && (p[3] & 0xC0) == 0x80) ? 4 : 0;
+        }
+        if (n != 0) {
+            p     += n;
+            chars += 1;
+        } else { /* skip the offending byte; the range checks above never step over the nul */
+            chars += ((c & 0xC0) != 0x80);
+            valid  = 0;
+            p     += 1;
+        }
+    }
+    if (o_bytecount) *o_bytecount = (size_t)(p - (uint8_t const*) strbuf);
+    if (o_charcount) *o_charcount = chars;
+    if (!valid) {
+        errno = EILSEQ;
+        return -1;
+    }
+    return 0;
+}
+
+/* @summary Define the first codepoint past the last one with a lower case mapping.
+ */
+#ifndef UTF32_CASEFOLD_LIMIT
+#define UTF32_CASEFOLD_LIMIT    0x0400
+#endif
+
+/* @summary Define the two-level table used to convert codepoints to lower case.
+ * The first level maps each block of 64 codepoints to a row of the second level, which holds the signed distance from each codepoint to its lower case form.
+ * Blocks without any mapping share row zero. The mappings are those of https://github.com/sheredom/utf8.h/blob/master/utf8.h, covering Latin, Latin Extended and Greek.
+ */
+static uint8_t const UTF32_CASEFOLD_STAGE1[UTF32_CASEFOLD_LIMIT >> 6] = {
+     0,  1,  0,  2,  3,  4,  5,  6,  7,  8,  0,  0,  0,  9, 10, 11
+};
+static int16_t const UTF32_CASEFOLD_STAGE2[12][64] = {
+    { /* no mappings */
+           0,    0,    0,    0,    0,    0,    0,    0,    0,    0,    0,    0,    0,    0,    0,    0,
+           0,    0,    0,    0,    0,    0,    0,    0,    0,    0,    0,    0,    0,    0,    0,    0,
+           0,    0,    0,    0,    0,    0,    0,    0,    0,    0,    0,    0,    0,    0,    0,    0,
+           0,    0,    0,    0,    0,    0,    0,    0,    0,    0,    0,    0,    0,    0,    0,    0
+    },
+    { /* U+0040-U+007F */
+           0,   32,   32,   32,   32,   32,   32,   32,   32,   32,   32,   32,   32,   32,   32,   32,
+          32,   32,   32,   32,   32,   32,   32,   32,   32,   32,   32,    0,    0,    0,    0,    0,
+           0,    0,    0,    0,    0,    0,    0,    0,    0,    0,    0,    0,    0,    0,    0,    0,
+           0,    0,    0,    0,    0,    0,    0,    0,    0,    0,    0,    0,    0,    0,    0,    0
+    },
+    { /* U+00C0-U+00FF */
+          32,   32,   32,   32,   32,   32,   32,   32,   32,   32,   32,   32,   32,   32,   32,   32,
+          32,   32,   32,   32,   32,   32,   32,    0,   32,   32,   32,   32,   32,   32,   32,    0,
+           0,    0,    0,    0,    0,    0,    0,    0,    0,    0,    0,    0,    0,    0,    0,    0,
+           0,    0,    0,    0,    0,    0,    0,    0,    0,    0,    0,    0,    0,    0,    0,    0
+    },
+    { /* U+0100-U+013F */
+           1,    0,    1,    0,    1,    0,    1,    0,    1,    0,    1,    0,    1,    0,    1,    0,
+           1,    0,    1,    0,    1,    0,    1,    0,    1,    0,    1,    0,    1,    0,    1,    0,
+           1,    0,    1,    0,    1,    0,    1,    0,    1,    0,    1,    0,    1,    0,    1,    0,
+           0,    0,    1,    0,    1,    0,    1,    0,    0,    1,    0,    1,    0,    1,    0,    1
+    },
+    { /* U+0140-U+017F */
+           0,    1,    0,    1,    0,    1,    0,    1,    0,    0,    1,    0,    1,    0,    1,    0,
+           1,    0,    1,    0,    1,    0,    1,    0,    1,    0,    1,    0,    1,    0,    1,    0,
+           1,    0,    1,    0,    1,    0,    1,    0,    1,    0,    1,    0,    1,    0,    1,    0,
+           1,    0,    1,    0,    1,    0,    1,    0, -121,    1,    0,    1,    0,    1,    0,    0
+    },
+    { /* U+0180-U+01BF */
+           0,    0,    1,    0,    1,    0,    0,    1,    0,    0,    0,    1,    0,    0,   79,    0,
+           0,    1,    0,    0,    0,    0,    0,    0,    1,    0,    0,    0,    0,    0,    0,    0,
+           1,    0,    1,    0,    1,    0,    0,    1,    0,    0,    0,    0,    1,    0,    0,    1,
+           0,    0,    0,    1,    0,    1,    0,  219,    1,    0,    0,    0,    1,    0,    0,    0
+    },
+    { /* U+01C0-U+01FF */
+           0,    0,    0,    0,    2,    0,    0,    2,    0,    0,    2,    0,    0,    1,    0,    1,
+           0,    1,    0,    1,    0,    1,    0,    1,    0,    1,    0,    1,    0,    0,    1,    0,
+           1,    0,    1,    0,    1,    0,    1,    0,    1,    0,    1,    0,    1,    0,    1,    0,
+           0,    2,    0,    0,    1,    0,    0,  -56,    1,    0,    1,    0,    1,    0,    1,    0
+    },
+    { /* U+0200-U+023F */
+           1,    0,    1,    0,    1,    0,    1,    0,    1,    0,    1,    0,    1,    0,    1,    0,
+           1,    0,    1,    0,    1,    0,    1,    0,    1,    0,    1,    0,    1,    0,    1,    0,
+        -130,    0,    1,    0,    1,    0,    1,    0,    1,    0,    1,    0,    1,    0,    1,    0,
+           1,    0,    1,    0,    0,    0,    0,    0,    0,    0,    0,    1,    0, -163,    0,    0
+    },
+    { /* U+0240-U+027F */
+           0,    1,    0, -195,    0,    0,    1,    0,    1,    0,    1,    0,    1,    0,    1,    0,
+           0,    0,    0,    0,    0,    0,    0,    0,    0,    0,    0,    0,    0,    0,    0,    0,
+           0,    0,    0,    0,    0,    0,    0,    0,    0,    0,    0,    0,    0,    0,    0,    0,
+           0,    0,    0,    0,    0,    0,    0,    0,    0,    0,    0,    0,    0,    0,    0,    0
+    },
+    { /* U+0340-U+037F */
+           0,    0,    0,    0,    0,    0,    0,    0,    0,    0,    0,    0,    0,    0,    0,    0,
+           0,    0,    0,    0,    0,    0,    0,    0,    0,    0,    0,    0,    0,    0,    0,    0,
+           0,    0,    0,    0,    0,    0,    0,    0,    0,    0,    0,    0,    0,    0,    0,    0,
+           1,    0,    1,    0,    0,    0,    1,    0,    0,    0,    0,    0,    0,    0,    0,  116
+    },
+    { /* U+0380-U+03BF */
+           0,    0,    0,    0,    0,    0,   38,    0,   37,   37,   37,    0,   64,    0,   63,   63,
+           0,   32,   32,   32,   32,   32,   32,   32,   32,   32,   32,   32,   32,   32,   32,   32,
+          32,   32,    0,   32,   32,   32,   32,   32,   32,   32,   32,   32,    0,    0,    0,    0,
+           0,    0,    0,    0,    0,    0,    0,    0,    0,    0,    0,    0,    0,    0,    0,    0
+    },
+    { /* U+03C0-U+03FF */
+           0,    0,    0,    0,    0,    0,    0,    0,    0,    0,    0,    0,    0,    0,    0,    8,
+           0,    0,    0,    0,    0,    0,    0,    0,    1,    0,    1,    0,    1,    0,    1,    0,
+           1,    0,    1,    0,    1,    0,    1,    0,    1,    0,    1,    0,    1,    0,    1,    0,
+           0,    0,    0,    0,  -35,    0,    0,    1,    0,   -7,    1,    0,    0, -130, -130, -130
+    }
+};
+
+/* @summary Convert a UCS-4 codepoint to lower case with a two-level table lookup.
+ * @param cp The UCS-4 codepoint to convert.
+ * @return The corresponding 'lower case' codepoint.
+ */
+static inline uint32_t
+Utf32ToLower
+(
+    uint32_t cp
+)
+{
+    if (cp < UTF32_CASEFOLD_LIMIT) {
+        cp = (uint32_t)((int32_t) cp + UTF32_CASEFOLD_STAGE2[UTF32_CASEFOLD_STAGE1[cp >> 6]][cp & 63]);
+    }
+    return cp;
+}
+
+/* @summary Compare the next codepoint of two UTF-8 strings without regard to case, advancing both strings.
+ * An invalid sequence compares as the end of the string, as it does for Utf8StringNextCodepoint.
+ * @param o_result On return, set to -1, 0 or +1 if the comparison is decided.
+ * @param io_a On input, the current position in the first string. On return, the position following the codepoint.
+ * @param io_b On input, the current position in the second string. On return, the position following the codepoint.
+ * @return Non-zero if the comparison is decided and o_result is set, or zero if both codepoints are equal and the comparison continues.
+ */
+static inline int
+Utf8CompareNoCaseStep
+(
+    int         *o_result,
+    char8_t const **io_a,
+    char8_t const **io_b
+)
+{
+    char32_t cpa;
+    char32_t cpb;
+   *io_a = Utf8StringNextCodepoint(&cpa, NULL, *io_a);
+   *io_b = Utf8StringNextCodepoint(&cpb, NULL, *io_b);
+    cpa  = Utf32ToLower(cpa);
+    cpb  = Utf32ToLower(cpb);
+    if (cpa != cpb) {
+       *o_result = (cpa < cpb) ? -1 : +1;
+        return 1;
+    }
+    if (cpa == 0) {
+       *o_result = 0;
+        return 1;
+    }
+    return 0;
+}
+
+/* @summary Compare two nul-terminated UTF-8 strings without regard to case one codepoint at a time.
+ * The arguments and return value are the same as for Utf8StringCompareNoCase.
+ */
+static int
+Utf8CompareNoCase_Scalar
+(
+    char8_t const *a,
+    char8_t const *b
+)
+{
+    int res;
+    while (!Utf8CompareNoCaseStep(&res, &a, &b))
+        { /* empty */ }
+    return res;
+}
+
+/* @summary Define the signatures of the block kernels used by the transcoding functions.
+ * Each kernel converts the leading run of ASCII code units in src a vector at a time, and returns at the first non-ASCII unit or when less than a vector remains.
+ * Vector kernels store whole vectors, so units up to the end of the last vector may be written past the returned count; callers limit num_src to the space available.
+ * If dst is NULL the run is measured but not written.
+ * @return The number of code units converted.
+ */
+typedef size_t (*UTF8_ASCII_TO_UTF16_FUNC)
+(
+    char16_t      * __restrict dst,
+    uint8_t const * __restrict src,
+    size_t                 num_src
+);
+typedef size_t (*UTF8_ASCII_TO_UTF32_FUNC)
+(
+    char32_t      * __restrict dst,
+    uint8_t const * __restrict src,
+    size_t                 num_src
+);
+typedef size_t (*UTF16_ASCII_TO_UTF8_FUNC)
+(
+    char8_t        * __restrict dst,
+    char16_t const * __restrict src,
+    size_t                  num_src
+);
+typedef size_t (*UTF32_ASCII_TO_UTF8_FUNC)
+(
+    char8_t        * __restrict dst,
+    char32_t const * __restrict src,
+    size_t                  num_src
+);
+typedef size_t (*UTF8_ASCII_FOLD_CASE_FUNC)
+(
+    char8_t       * __restrict dst,
+    uint8_t const * __restrict src,
+    size_t                 num_src
+);
+
+/* @summary Define the signature of a case-insensitive comparison kernel. The arguments and return value are the same as for Utf8StringCompareNoCase.
+ */
+typedef int (*UTF8_COMPARE_NOCASE_FUNC)
+(
+    char8_t const *a,
+    char8_t const *b
+);
+
+/* @summary Define the set of functions making up one implementation of the UTF-8 kernels.
+ */
+typedef struct UTF8_KERNEL_FUNCS {
+    UTF8_VALIDATE_FUNC           Validate;                                     /* Validate and measure a nul-terminated UTF-8 string. */
+    UTF8_ASCII_TO_UTF16_FUNC     Utf8AsciiToUtf16;                             /* Widen a run of ASCII bytes to UTF-16. */
+    UTF8_ASCII_TO_UTF32_FUNC     Utf8AsciiToUtf32;                             /* Widen a run of ASCII bytes to UTF-32. */
+    UTF16_ASCII_TO_UTF8_FUNC     Utf16AsciiToUtf8;                             /* Narrow a run of ASCII UTF-16 units to bytes. */
+    UTF32_ASCII_TO_UTF8_FUNC     Utf32AsciiToUtf8;                             /* Narrow a run of ASCII UTF-32 units to bytes. */
+    UTF8_ASCII_FOLD_CASE_FUNC    Utf8AsciiFoldCase;                            /* Convert a run of ASCII bytes to lower case. */
+    UTF8_COMPARE_NOCASE_FUNC     CompareNoCase;                                /* Compare two nul-terminated strings without regard to case. */
+} UTF8_KERNEL_FUNCS;
+
+/* @summary The scalar kernels have no ASCII fast path; the transcoding loops handle ASCII one unit at a time.
+ */
+static size_t
+Utf8AsciiToUtf16_Scalar
+(
+    char16_t      * __restrict dst,
+    uint8_t const * __restrict src,
+    size_t                 num_src
+)
+{
+    (void) dst; (void) src; (void) num_src;
+    return 0;
+}
+
+static size_t
+Utf8AsciiToUtf32_Scalar
+(
+    char32_t      * __restrict dst,
+    uint8_t const * __restrict src,
+    size_t                 num_src
+)
+{
+    (void) dst; (void) src; (void) num_src;
+    return 0;
+}
+
+static size_t
+Utf16AsciiToUtf8_Scalar
+(
+    char8_t        * __restrict dst,
+    char16_t const * __restrict src,
+    size_t                  num_src
+)
+{
+    (void) dst; (void) src; (void) num_src;
+    return 0;
+}
+
+static size_t
+Utf32AsciiToUtf8_Scalar
+(
+    char8_t        * __restrict dst,
+    char32_t const * __restrict src,
+    size_t                  num_src
+)
+{
+    (void) dst; (void) src; (void) num_src;
+    return 0;
+}
+
+static size_t
+Utf8AsciiFoldCase_Scalar
+(
+    char8_t       * __restrict dst,
+    uint8_t const * __restrict src,
+    size_t                 num_src
+)
+{
+    (void) dst; (void) src; (void) num_src;
+    return 0;
+}
+
+#if CPU_ARCH_X86
+/* @summary Define the error bits produced by the lookup-table UTF-8 validation algorithm of Keiser and Lemire, "Validating UTF-8 In Less Than One Instruction Per Byte".
+ * Each byte is classified by the high nibble of the preceding byte, the low nibble of the preceding byte, and the high nibble of the byte itself.
+ * The three classifications are ANDed; any bit that survives is an error, except that a 3- or 4-byte sequence legitimately produces TWO_CONTS.
+ */
+#define UTF8_TOO_SHORT               (1 << 0) /* A lead byte is followed by a lead byte or ASCII. */
+#define UTF8_TOO_LONG                (1 << 1) /* ASCII is followed by a continuation byte. */
+#define UTF8_OVERLONG_3              (1 << 2) /* E0 followed by 80..9F. */
+#define UTF8_TOO_LARGE               (1 << 3) /* F4 followed by 90..BF, or F5..FF. */
+#define UTF8_SURROGATE               (1 << 4) /* ED followed by A0..BF. */
+#define UTF8_OVERLONG_2              (1 << 5) /* C0 or C1. */
+#define UTF8_TOO_LARGE_1000          (1 << 6) /* F5..FF followed by 80..8F. */
+#define UTF8_OVERLONG_4              (1 << 6) /* F0 followed by 80..8F. */
+#define UTF8_TWO_CONTS               (1 << 7) /* Two consecutive continuation bytes. */
+#define UTF8_CARRY                   (UTF8_TOO_SHORT | UTF8_TOO_LONG | UTF8_TWO_CONTS)
+
+/* @summary Define the three 16-entry classification tables of the lookup algorithm, indexed by the high nibble of the previous byte, the low nibble of the previous byte and the high nibble of the current byte.
+ */
+static int8_t const UTF8_BYTE_1_HIGH[16] = {
+    UTF8_TOO_LONG , UTF8_TOO_LONG , UTF8_TOO_LONG , UTF8_TOO_LONG ,
+    UTF8_TOO_LONG , UTF8_TOO_LONG , UTF8_TOO_LONG , UTF8_TOO_LONG ,
+    (int8_t) UTF8_TWO_CONTS, (int8_t) UTF8_TWO_CONTS, (int8_t) UTF8_TWO_CONTS, (int8_t) UTF8_TWO_CONTS,
+    UTF8_TOO_SHORT | UTF8_OVERLONG_2,
+    UTF8_TOO_SHORT,
+    UTF8_TOO_SHORT | UTF8_OVERLONG_3 | UTF8_SURROGATE,
+    UTF8_TOO_SHORT | UTF8_TOO_LARGE  | UTF8_TOO_LARGE_1000 | UTF8_OVERLONG_4
+};
+static int8_t const UTF8_BYTE_1_LOW[16] = {
+    (int8_t)(UTF8_CARRY | UTF8_OVERLONG_3 | UTF8_OVERLONG_2 | UTF8_OVERLONG_4),
+    (int8_t)(UTF8_CARRY | UTF8_OVERLONG_2),
+    (int8_t)(UTF8_CARRY),
+    (int8_t)(UTF8_CARRY),
+    (int8_t)(UTF8_CARRY | UTF8_TOO_LARGE),
+    (int8_t)(UTF8_CARRY | UTF8_TOO_LARGE | UTF8_TOO_LARGE_1000),
+    (int8_t)(UTF8_CARRY | UTF8_TOO_LARGE | UTF8_TOO_LARGE_1000),
+    (int8_t)(UTF8_CARRY | UTF8_TOO_LARGE | UTF8_TOO_LARGE_1000),
+    (int8_t)(UTF8_CARRY | UTF8_TOO_LARGE | UTF8_TOO_LARGE_1000),
+    (int8_t)(UTF8_CARRY | UTF8_TOO_LARGE | UTF8_TOO_LARGE_1000),
+    (int8_t)(UTF8_CARRY | UTF8_TOO_LARGE | UTF8_TOO_LARGE_1000),
+    (int8_t)(UTF8_CARRY | UTF8_TOO_LARGE | UTF8_TOO_LARGE_1000),
+    (int8_t)(UTF8_CARRY | UTF8_TOO_LARGE | UTF8_TOO_LARGE_1000),
+    (int8_t)(UTF8_CARRY | UTF8_TOO_LARGE | UTF8_TOO_LARGE_1000 | UTF8_SURROGATE),
+    (int8_t)(UTF8_CARRY | UTF8_TOO_LARGE | UTF8_TOO_LARGE_1000),
+    (int8_t)(UTF8_CARRY | UTF8_TOO_LARGE | UTF8_TOO_LARGE_1000)
+};
+static int8_t const UTF8_BYTE_2_HIGH[16] = {
+    UTF8_TOO_SHORT, UTF8_TOO_SHORT, UTF8_TOO_SHORT, UTF8_TOO_SHORT,
+    UTF8_TOO_SHORT, UTF8_TOO_SHORT, UTF8_TOO_SHORT, UTF8_TOO_SHORT,
+    (int8_t)(UTF8_TOO_LONG | UTF8_OVERLONG_2 | UTF8_TWO_CONTS | UTF8_OVERLONG_3 | UTF8_TOO_LARGE_1000 | UTF8_OVERLONG_4),
+    (int8_t)(UTF8_TOO_LONG | UTF8_OVERLONG_2 | UTF8_TWO_CONTS | UTF8_OVERLONG_3 | UTF8_TOO_LARGE),
+    (int8_t)(UTF8_TOO_LONG | UTF8_OVERLONG_2 | UTF8_TWO_CONTS | UTF8_SURROGATE  | UTF8_TOO_LARGE),
+    (int8_t)(UTF8_TOO_LONG | UTF8_OVERLONG_2 | UTF8_TWO_CONTS | UTF8_SURROGATE  | UTF8_TOO_LARGE),
+    UTF8_TOO_SHORT, UTF8_TOO_SHORT, UTF8_TOO_SHORT, UTF8_TOO_SHORT
+};
+
+/* @summary Define a table used to build lane masks. Loading 16 or 32 bytes at UTF8_LANE_MASK + 32 - n yields n lanes of zeroes followed by lanes of 0xFF.
+ */
+static uint8_t const UTF8_LANE_MASK[64] = {
+    0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+    0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+    0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+    0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF
+};
+
+/* @summary Find the index of the least-significant set bit of a non-zero value.
+ * @param mask The value to search. Must be non-zero.
+ * @return The zero-based index of the lowest set bit.
+ */
+static inline uint32_t
+Utf8LowestSetBit
+(
+    uint32_t mask
+)
+{
+#if defined(_MSC_VER)
+    unsigned long index;
+    _BitScanForward(&index, mask);
+    return (uint32_t) index;
+#else
+    return (uint32_t) __builtin_ctz(mask);
+#endif
+}
+
+/* @summary Define the smallest page size of any supported platform. Vector loads that stay within one page of this size cannot fault.
+ */
+#ifndef STRLIB_MIN_PAGE_SIZE
+#define STRLIB_MIN_PAGE_SIZE    4096
+#endif
+
+/* @summary Determine whether an unaligned block of bytes lies within a single page.
+ * @param p The address of the first byte of the block.
+ * @param size The size of the block, in bytes.
+ * @return Non-zero if the block does not cross a page boundary.
+ */
+static inline int
+Utf8BlockInPage
+(
+    void const *p,
+    size_t   size
+)
+{
+    return ((uintptr_t) p & (STRLIB_MIN_PAGE_SIZE - 1)) <= (STRLIB_MIN_PAGE_SIZE - size);
+}
+
+/* @summary Validate a nul-terminated UTF-8 string and count its bytes and codepoints 16 bytes at a time using SSSE3.
+ * Blocks are loaded from 16-byte aligned addresses so that no load crosses a page boundary. Lanes before the start of the string and after the nul are replaced with zeroes, which are valid ASCII.
+ * A sequence truncated by the nul is detected because the nul occupies a position where a continuation byte is required.
+ */
+static CPU_TARGET("ssse3,popcnt") STRLIB_NO_SANITIZE_ADDRESS int
+Utf8Validate_SSSE3
+(
+    size_t   *o_bytecount,
+    size_t   *o_charcount,
+    char8_t const *strbuf
+)
+{
+    __m128i const t1 = _mm_loadu_si128((__m128i const*) UTF8_BYTE_1_HIGH);
+    __m128i const t2 = _mm_loadu_si128((__m128i const*) UTF8_BYTE_1_LOW);
+    __m128i const t3 = _mm_loadu_si128((__m128i const*) UTF8_BYTE_2_HIGH);
+    __m128i const lo = _mm_set1_epi8(0x0F);
+    __m128i const c3 = _mm_set1_epi8((char)(0xE0 - 0x80));
+    __m128i const c4 = _mm_set1_epi8((char)(0xF0 - 0x80));
+    __m128i const hb = _mm_set1_epi8((char) 0x80);
+    __m128i const cb = _mm_set1_epi8(-65); /* bytes greater than 0xBF, as signed values, are not continuation bytes */
+    __m128i const zr = _mm_setzero_si128();
+    uint8_t const *p = (uint8_t const*)((uintptr_t) strbuf & ~(uintptr_t) 15);
+    uint32_t    skip = (uint32_t)((uint8_t const*) strbuf - p);
+    uint32_t    keep = 0xFFFFU << skip;
+    __m128i     prev = zr;
+    __m128i      err = zr;
+    __m128i       in = _mm_and_si128(_mm_load_si128((__m128i const*) p), _mm_loadu_si128((__m128i const*)(UTF8_LANE_MASK + 32 - skip)));
+    size_t     chars = 0;
+    uint32_t     end = 16;
+
+    for ( ; ; ) {
+        uint32_t nul = (uint32_t) _mm_movemask_epi8(_mm_cmpeq_epi8(in, zr)) & keep;
+        __m128i prev1, prev2, prev3, sc, m23;
+        if (nul != 0) {
+            end  = Utf8LowestSetBit(nul);
+            keep&= (1U << end) - 1;
+            in   = _mm_andnot_si128(_mm_loadu_si128((__m128i const*)(UTF8_LANE_MASK + 32 - end)), in);
+        }
+        chars += (size_t) _mm_popcnt_u32((uint32_t) _mm_movemask_epi8(_mm_cmpgt_epi8(in, cb)) & keep);
+        prev1  = _mm_alignr_epi8(in, prev, 15);
+        prev2  = _mm_alignr_epi8(in, prev, 14);
+        prev3  = _mm_alignr_epi8(in, prev, 13);
+        sc     = _mm_and_si128(_mm_and_si128(
+                     _mm_shuffle_epi8(t1, _mm_and_si128(_mm_srli_epi16(prev1, 4), lo)),
+                     _mm_shuffle_epi8(t2, _mm_and_si128(prev1, lo))),
+                     _mm_shuffle_epi8(t3, _mm_and_si128(_mm_srli_epi16(in, 4), lo)));
+        m23    = _mm_and_si128(_mm_or_si128(_mm_subs_epu8(prev2, c3), _mm_subs_epu8(prev3, c4)), hb);
+        err    = _mm_or_si128(err, _mm_xor_si128(m23, sc));
+        if (nul != 0) {
+            break;
+        }
+        prev = in;
+        keep = 0xFFFFU;
+        p   += 16;
+        in   = _mm_load_si128((__m128i const*) p);
+    }
+    if (o_bytecount) *o_bytecount = (size_t)((p + end) - (uint8_t const*) strbuf);
+    if (o_charcount) *o_charcount = chars;
+    if (_mm_movemask_epi8(_mm_cmpeq_epi8(err, zr)) != 0xFFFF) {
+        errno = EILSEQ;
+        return -1;
+    }
+    return 0;
+}
+
+/* @summary Validate a nul-terminated UTF-8 string and count its bytes and codepoints 32 bytes at a time using AVX2.
+ * This is the same algorithm as Utf8Validate_SSSE3; the previous-byte vectors are formed across the two 128-bit lanes with vperm2i128.
+ */
+static CPU_TARGET("avx2,popcnt") STRLIB_NO_SANITIZE_ADDRESS int
+Utf8Validate_AVX2
+(
+    size_t   *o_bytecount,
+    size_t   *o_charcount,
+    char8_t const *strbuf
+)
+{
+    __m256i const t1 = _mm256_broadcastsi128_si256(_mm_loadu_si128((__m128i const*) UTF8_BYTE_1_HIGH));
+    __m256i const t2 = _mm256_broadcastsi128_si256(_mm_loadu_si128((__m128i const*) UTF8_BYTE_1_LOW));
+    __m256i const t3 = _mm256_broadcastsi128_si256(_mm_loadu_si128((__m128i const*) UTF8_BYTE_2_HIGH));
+    __m256i const lo = _mm256_set1_epi8(0x0F);
+    __m256i const c3 = _mm256_set1_epi8((char)(0xE0 - 0x80));
+    __m256i const c4 = _mm256_set1_epi8((char)(0xF0 - 0x80));
+    __m256i const hb = _mm256_set1_epi8((char) 0x80);
+    __m256i const cb = _mm256_set1_epi8(-65);
+    __m256i const zr = _mm256_setzero_si256();
+    uint8_t const *p = (uint8_t const*)((uintptr_t) strbuf & ~(uintptr_t) 31);
+    uint32_t    skip = (uint32_t)((uint8_t const*) strbuf - p);
+    uint32_t    keep = 0xFFFFFFFFU << skip;
+    __m256i     prev = zr;
+    __m256i      err = zr;
+    __m256i       in = _mm256_and_si256(_mm256_load_si256((__m256i const*) p), _mm256_loadu_si256((__m256i const*)(UTF8_LANE_MASK + 32 - skip)));
+    size_t     chars = 0;
+    uint32_t     end = 32;
+
+    for ( ; ; ) {
+        uint32_t nul = (uint32_t) _mm256_movemask_epi8(_mm256_cmpeq_epi8(in, zr)) & keep;
+        __m256i shift, prev1, prev2, prev3, sc, m23;
+        if (nul != 0) {
+            end  = Utf8LowestSetBit(nul);
+            keep&= end < 32 ? ((1U << end) - 1) : 0xFFFFFFFFU;
+            in   = _mm256_andnot_si256(_mm256_loadu_si256((__m256i const*)(UTF8_LANE_MASK + 32 - end)), in);
+        }
+        chars += (size_t) _mm_popcnt_u32((uint32_t) _mm256_movemask_epi8(_mm256_cmpgt_epi8(in, cb)) & keep);
+        shift  = _mm256_permute2x128_si256(prev, in, 0x21); /* [high half of prev, low half of in] */
+        prev1  = _mm256_alignr_epi8(in, shift, 15);
+        prev2  = _mm256_alignr_epi8(in, shift, 14);
+        prev3  = _mm256_alignr_epi8(in, shift, 13);
+        sc     = _mm256_and_si256(_mm256_and_si256(
+                     _mm256_shuffle_epi8(t1, _mm256_and_si256(_mm256_srli_epi16(prev1, 4), lo)),
+                     _mm256_shuffle_epi8(t2, _mm256_and_si256(prev1, lo))),
+                     _mm256_shuffle_epi8(t3, _mm256_and_si256(_mm256_srli_epi16(in, 4), lo)));
+        m23    = _mm256_and_si256(_mm256_or_si256(_mm256_subs_epu8(prev2, c3), _mm256_subs_epu8(prev3, c4)), hb);
+        err    = _mm256_or_si256(err, _mm256_xor_si256(m23, sc));
+        if (nul != 0) {
+            break;
+        }
+        prev = in;
+        keep = 0xFFFFFFFFU;
+        p   += 32;
+        in   = _mm256_load_si256((__m256i const*) p);
+    }
+    if (o_bytecount) *o_bytecount = (size_t)((p + end) - (uint8_t const*) strbuf);
+    if (o_charcount) *o_charcount = chars;
+    if (!_mm256_testz_si256(err, err)) {
+        errno = EILSEQ;
+        return -1;
+    }
+    return 0;
+}
+/* @summary Widen ASCII bytes to UTF-16 16 bytes at a time with SSE2 instructions, as part of the SSSE3 kernel set.
+ * The whole vector is stored before it is checked; the units following the first non-ASCII byte are overwritten by the caller.
+ */
+static CPU_TARGET("ssse3") size_t
+Utf8AsciiToUtf16_SSSE3
+(
+    char16_t      * __restrict dst,
+    uint8_t const * __restrict src,
+    size_t                 num_src
+)
+{
+    __m128i const zero = _mm_setzero_si128();
+    size_t i;
+    for (i = 0; num_src - i >= 16; i += 16) {
+        __m128i   in = _mm_loadu_si128((__m128i const*)(src + i));
+        uint32_t hib = (uint32_t) _mm_movemask_epi8(in);
+        if (dst != NULL) {
+            _mm_storeu_si128((__m128i*)(dst + i    ), _mm_unpacklo_epi8(in, zero));
+            _mm_storeu_si128((__m128i*)(dst + i + 8), _mm_unpackhi_epi8(in, zero));
+        }
+        if (hib != 0) {
+            return i + Utf8LowestSetBit(hib);
+        }
+    }
+    return i;
+}
+
+/* @summary Widen ASCII bytes to UTF-32 16 bytes at a time with SSE2 instructions, as part of the SSSE3 kernel set.
+ */
+static CPU_TARGET("ssse3") size_t
+Utf8AsciiToUtf32_SSSE3
+(
+    char32_t      * __restrict dst,
+    uint8_t const * __restrict src,
+    size_t                 num_src
+)
+{
+    __m128i const zero = _mm_setzero_si128();
+    size_t i;
+    for (i = 0; num_src - i >= 16; i += 16) {
+        __m128i   in = _mm_loadu_si128((__m128i const*)(src + i));
+        uint32_t hib = (uint32_t) _mm_movemask_epi8(in);
+        if (dst != NULL) {
+            __m128i lo = _mm_unpacklo_epi8(in, zero);
+            __m128i hi = _mm_unpackhi_epi8(in, zero);
+            _mm_storeu_si128((__m128i*)(dst + i     ), _mm_unpacklo_epi16(lo, zero));
+            _mm_storeu_si128((__m128i*)(dst + i +  4), _mm_unpackhi_epi16(lo, zero));
+            _mm_storeu_si128((__m128i*)(dst + i +  8), _mm_unpacklo_epi16(hi, zero));
+            _mm_storeu_si128((__m128i*)(dst + i + 12), _mm_unpackhi_epi16(hi, zero));
+        }
+        if (hib != 0) {
+            return i + Utf8LowestSetBit(hib);
+        }
+    }
+    return i;
+}
+
+/* @summary Narrow ASCII UTF-16 units to bytes 16 units at a time with SSE2 instructions, as part of the SSSE3 kernel set.
+ */
+static CPU_TARGET("ssse3") size_t
+Utf16AsciiToUtf8_SSSE3
+(
+    char8_t        * __restrict dst,
+    char16_t const * __restrict src,
+    size_t                  num_src
+)
+{
+    __m128i const high = _mm_set1_epi16((short) 0xFF80);
+    __m128i const zero = _mm_setzero_si128();
+    size_t i;
+    for (i = 0; num_src - i >= 16; i += 16) {
+        __m128i    a = _mm_loadu_si128((__m128i const*)(src + i    ));
+        __m128i    b = _mm_loadu_si128((__m128i const*)(src + i + 8));
+        uint32_t hib = (uint32_t) _mm_movemask_epi8(_mm_packs_epi16(_mm_cmpeq_epi16(_mm_and_si128(a, high), zero), _mm_cmpeq_epi16(_mm_and_si128(b, high), zero))) ^ 0xFFFFU;
+        if (dst != NULL) {
+            _mm_storeu_si128((__m128i*)(dst + i), _mm_packus_epi16(a, b));
+        }
+        if (hib != 0) {
+            return i + Utf8LowestSetBit(hib);
+        }
+    }
+    return i;
+}
+
+/* @summary Narrow ASCII UTF-32 units to bytes 16 units at a time with SSE2 instructions, as part of the SSSE3 kernel set.
+ */
+static CPU_TARGET("ssse3") size_t
+Utf32AsciiToUtf8_SSSE3
+(
+    char8_t        * __restrict dst,
+    char32_t const * __restrict src,
+    size_t                  num_src
+)
+{
+    __m128i const high = _mm_set1_epi32((int) 0xFFFFFF80);
+    __m128i const zero = _mm_setzero_si128();
+    size_t i;
+    for (i = 0; num_src - i >= 16; i += 16) {
+        __m128i    a = _mm_loadu_si128((__m128i const*)(src + i     ));
+        __m128i    b = _mm_loadu_si128((__m128i const*)(src + i +  4));
+        __m128i    c = _mm_loadu_si128((__m128i const*)(src + i +  8));
+        __m128i    d = _mm_loadu_si128((__m128i const*)(src + i + 12));
+        __m128i   ab = _mm_packs_epi32(_mm_cmpeq_epi32(_mm_and_si128(a, high), zero), _mm_cmpeq_epi32(_mm_and_si128(b, high), zero));
+        __m128i   cd = _mm_packs_epi32(_mm_cmpeq_epi32(_mm_and_si128(c, high), zero), _mm_cmpeq_epi32(_mm_and_si128(d, high), zero));
+        uint32_t hib = (uint32_t) _mm_movemask_epi8(_mm_packs_epi16(ab, cd)) ^ 0xFFFFU;
+        if (dst != NULL) { /* signed saturation is exact for ASCII; other lanes are overwritten by the caller */
+            _mm_storeu_si128((__m128i*)(dst + i), _mm_packus_epi16(_mm_packs_epi32(a, b), _mm_packs_epi32(c, d)));
+        }
+        if (hib != 0) {
+            return i + Utf8LowestSetBit(hib);
+        }
+    }
+    return i;
+}
+
+/* @summary Convert the ASCII upper case letters in a vector of bytes to lower case. Other bytes, including those with the high bit set, are unchanged.
+ */
+static CPU_TARGET("ssse3") inline __m128i
+Utf8FoldAscii_SSSE3
+(
+    __m128i v
+)
+{
+    __m128i upper = _mm_and_si128(_mm_cmpgt_epi8(v, _mm_set1_epi8('A' - 1)), _mm_cmpgt_epi8(_mm_set1_epi8('Z' + 1), v));
+    return _mm_add_epi8(v, _mm_and_si128(upper, _mm_set1_epi8(0x20)));
+}
+
+/* @summary Convert ASCII bytes to lower case 16 bytes at a time with SSE2 instructions, as part of the SSSE3 kernel set.
+ */
+static CPU_TARGET("ssse3") size_t
+Utf8AsciiFoldCase_SSSE3
+(
+    char8_t       * __restrict dst,
+    uint8_t const * __restrict src,
+    size_t                 num_src
+)
+{
+    size_t i;
+    for (i = 0; num_src - i >= 16; i += 16) {
+        __m128i   in = _mm_loadu_si128((__m128i const*)(src + i));
+        uint32_t hib = (uint32_t) _mm_movemask_epi8(in);
+        if (dst != NULL) {
+            _mm_storeu_si128((__m128i*)(dst + i), Utf8FoldAscii_SSSE3(in));
+        }
+        if (hib != 0) {
+            return i + Utf8LowestSetBit(hib);
+        }
+    }
+    return i;
+}
+
+/* @summary Compare two nul-terminated UTF-8 strings without regard to case 16 bytes at a time with SSE2 instructions, as part of the SSSE3 kernel set.
+ * Blocks where both strings are ASCII up to the first difference or nul are compared with vector instructions; the comparison steps over other codepoints one at a time.
+ * A block is only loaded if it does not cross a page boundary in either string, so the loads never fault even though they may read past the nul.
+ */
+static CPU_TARGET("ssse3") STRLIB_NO_SANITIZE_ADDRESS int
+Utf8CompareNoCase_SSSE3
+(
+    char8_t const *a,
+    char8_t const *b
+)
+{
+    __m128i const zero = _mm_setzero_si128();
+    int res;
+    for ( ; ; ) {
+        if (Utf8BlockInPage(a, 16) && Utf8BlockInPage(b, 16)) {
+            __m128i    va = _mm_loadu_si128((__m128i const*) a);
+            __m128i    vb = _mm_loadu_si128((__m128i const*) b);
+            uint32_t  neq = (uint32_t) _mm_movemask_epi8(_mm_cmpeq_epi8(Utf8FoldAscii_SSSE3(va), Utf8FoldAscii_SSSE3(vb))) ^ 0xFFFFU;
+            uint32_t  nul = (uint32_t) _mm_movemask_epi8(_mm_cmpeq_epi8(va, zero));
+            uint32_t  hib = (uint32_t) _mm_movemask_epi8(_mm_or_si128(va, vb));
+            uint32_t stop = neq | nul | hib;
+            uint32_t  idx;
+            if (stop == 0) {
+                a += 16;
+                b += 16;
+                continue;
+            }
+            idx = Utf8LowestSetBit(stop);
+            if ((hib & (1U << idx)) == 0) {
+                uint32_t ca = Utf32ToLower((uint8_t) a[idx]);
+                uint32_t cb = Utf32ToLower((uint8_t) b[idx]);
+                return (ca == cb) ? 0 : ((ca < cb) ? -1 : +1);
+            }
+            a += idx;
+            b += idx;
+        }
+        if (Utf8CompareNoCaseStep(&res, &a, &b)) {
+            return res;
+        }
+    }
+}
+
+/* @summary Widen ASCII bytes to UTF-16 32 bytes at a time using AVX2.
+ */
+static CPU_TARGET("avx2") size_t
+Utf8AsciiToUtf16_AVX2
+(
+    char16_t      * __restrict dst,
+    uint8_t const * __restrict src,
+    size_t                 num_src
+)
+{
+    size_t i;
+    for (i = 0; num_src - i >= 32; i += 32) {
+        __m256i   in = _mm256_loadu_si256((__m256i const*)(src + i));
+        uint32_t hib = (uint32_t) _mm256_movemask_epi8(in);
+        if (dst != NULL) {
+            _mm256_storeu_si256((__m256i*)(dst + i     ), _mm256_cvtepu8_epi16(_mm256_castsi256_si128(in)));
+            _mm256_storeu_si256((__m256i*)(dst + i + 16), _mm256_cvtepu8_epi16(_mm256_extracti128_si256(in, 1)));
+        }
+        if (hib != 0) {
+            return i + Utf8LowestSetBit(hib);
+        }
+    }
+    return i;
+}
+
+/* @summary Widen ASCII bytes to UTF-32 32 bytes at a time using AVX2.
+ */
+static CPU_TARGET("avx2") size_t
+Utf8AsciiToUtf32_AVX2
+(
+    char32_t      * __restrict dst,
+    uint8_t const * __restrict src,
+    size_t                 num_src
+)
+{
+    size_t i;
+    for (i = 0; num_src - i >= 32; i += 32) {
+        __m256i   in = _mm256_loadu_si256((__m256i const*)(src + i));
+        uint32_t hib = (uint32_t) _mm256_movemask_epi8(in);
+        if (dst != NULL) {
+            __m128i lo = _mm256_castsi256_si128(in);
+            __m128i hi = _mm256_extracti128_si256(in, 1);
+            _mm256_storeu_si256((__m256i*)(dst + i     ), _mm256_cvtepu8_epi32(lo));
+            _mm256_storeu_si256((__m256i*)(dst + i +  8), _mm256_cvtepu8_epi32(_mm_srli_si128(lo, 8)));
+            _mm256_storeu_si256((__m256i*)(dst + i + 16), _mm256_cvtepu8_epi32(hi));
+            _mm256_storeu_si256((__m256i*)(dst + i + 24), _mm256_cvtepu8_epi32(_mm_srli_si128(hi, 8)));
+        }
+        if (hib != 0) {
+            return i + Utf8LowestSetBit(hib);
+        }
+    }
+    return i;
+}
+
+/* @summary Narrow ASCII UTF-16 units to bytes 32 units at a time using AVX2.
+ * packus and packs interleave the 128-bit lanes; permuting the 64-bit quarters restores unit order for both the bytes and the mask.
+ */
+static CPU_TARGET("avx2") size_t
+Utf16AsciiToUtf8_AVX2
+(
+    char8_t        * __restrict dst,
+    char16_t const * __restrict src,
+    size_t                  num_src
+)
+{
+    __m256i const high = _mm256_set1_epi16((short) 0xFF80);
+    __m256i const zero = _mm256_setzero_si256();
+    size_t i;
+    for (i = 0; num_src - i >= 32; i += 32) {
+        __m256i    a = _mm256_loadu_si256((__m256i const*)(src + i     ));
+        __m256i    b = _mm256_loadu_si256((__m256i const*)(src + i + 16));
+        __m256i   ok = _mm256_packs_epi16(_mm256_cmpeq_epi16(_mm256_and_si256(a, high), zero), _mm256_cmpeq_epi16(_mm256_and_si256(b, high), zero));
+        uint32_t hib = ~(uint32_t) _mm256_movemask_epi8(_mm256_permute4x64_epi64(ok, 0xD8));
+        if (dst != NULL) {
+            _mm256_storeu_si256((__m256i*)(dst + i), _mm256_permute4x64_epi64(_mm256_packus_epi16(a, b), 0xD8));
+        }
+        if (hib != 0) {
+            return i + Utf8LowestSetBit(hib);
+        }
+    }
+    return i;
+}
+
+/* @summary Narrow ASCII UTF-32 units to bytes 32 units at a time using AVX2.
+ */
+static CPU_TARGET("avx2") size_t
+Utf32AsciiToUtf8_AVX2
+(
+    char8_t        * __restrict dst,
+    char32_t const * __restrict src,
+    size_t                  num_src
+)
+{
+    __m256i const high = _mm256_set1_epi32((int) 0xFFFFFF80);
+    __m256i const zero = _mm256_setzero_si256();
+    __m256i const perm = _mm256_setr_epi32(0, 4, 1, 5, 2, 6, 3, 7);
+    size_t i;
+    for (i = 0; num_src - i >= 32; i += 32) {
+        __m256i    a = _mm256_loadu_si256((__m256i const*)(src + i     ));
+        __m256i    b = _mm256_loadu_si256((__m256i const*)(src + i +  8));
+        __m256i    c = _mm256_loadu_si256((__m256i const*)(src + i + 16));
+        __m256i    d = _mm256_loadu_si256((__m256i const*)(src + i + 24));
+        __m256i   ab = _mm256_packs_epi32(_mm256_cmpeq_epi32(_mm256_and_si256(a, high), zero), _mm256_cmpeq_epi32(_mm256_and_si256(b, high), zero));
+        __m256i   cd = _mm256_packs_epi32(_mm256_cmpeq_epi32(_mm256_and_si256(c, high), zero), _mm256_cmpeq_epi32(_mm256_and_si256(d, high), zero));
+        uint32_t hib = ~(uint32_t) _mm256_movemask_epi8(_mm256_permutevar8x32_epi32(_mm256_packs_epi16(ab, cd), perm));
+        if (dst != NULL) {
+            __m256i v = _mm256_packus_epi16(_mm256_packs_epi32(a, b), _mm256_packs_epi32(c, d));
+            _mm256_storeu_si256((__m256i*)(dst + i), _mm256_permutevar8x32_epi32(v, perm));
+        }
+        if (hib != 0) {
+            return i + Utf8LowestSetBit(hib);
+        }
+    }
+    return i;
+}
+
+/* @summary Convert the ASCII upper case letters in a vector of bytes to lower case. Other bytes, including those with the high bit set, are unchanged.
+ */
+static CPU_TARGET("avx2") inline __m256i
+Utf8FoldAscii_AVX2
+(
+    __m256i v
+)
+{
+    __m256i upper = _mm256_and_si256(_mm256_cmpgt_epi8(v, _mm256_set1_epi8('A' - 1)), _mm256_cmpgt_epi8(_mm256_set1_epi8('Z' + 1), v));
+    return _mm256_add_epi8(v, _mm256_and_si256(upper, _mm256_set1_epi8(0x20)));
+}
+
+/* @summary Convert ASCII bytes to lower case 32 bytes at a time using AVX2.
+ */
+static CPU_TARGET("avx2") size_t
+Utf8AsciiFoldCase_AVX2
+(
+    char8_t       * __restrict dst,
+    uint8_t const * __restrict src,
+    size_t                 num_src
+)
+{
+    size_t i;
+    for (i = 0; num_src - i >= 32; i += 32) {
+        __m256i   in = _mm256_loadu_si256((__m256i const*)(src + i));
+        uint32_t hib = (uint32_t) _mm256_movemask_epi8(in);
+        if (dst != NULL) {
+            _mm256_storeu_si256((__m256i*)(dst + i), Utf8FoldAscii_AVX2(in));
+        }
+        if (hib != 0) {
+            return i + Utf8LowestSetBit(hib);
+        }
+    }
+    return i;
+}
+
+/* @summary Compare two nul-terminated UTF-8 strings without regard to case 32 bytes at a time using AVX2.
+ * See Utf8CompareNoCase_SSSE3.
+ */
+static CPU_TARGET("avx2") STRLIB_NO_SANITIZE_ADDRESS int
+Utf8CompareNoCase_AVX2
+(
+    char8_t const *a,
+    char8_t const *b
+)
+{
+    __m256i const zero = _mm256_setzero_si256();
+    int res;
+    for ( ; ; ) {
+        if (Utf8BlockInPage(a, 32) && Utf8BlockInPage(b, 32)) {
+            __m256i    va = _mm256_loadu_si256((__m256i const*) a);
+            __m256i    vb = _mm256_loadu_si256((__m256i const*) b);
+            uint32_t  neq = ~(uint32_t) _mm256_movemask_epi8(_mm256_cmpeq_epi8(Utf8FoldAscii_AVX2(va), Utf8FoldAscii_AVX2(vb)));
+            uint32_t  nul = (uint32_t) _mm256_movemask_epi8(_mm256_cmpeq_epi8(va, zero));
+            uint32_t  hib = (uint32_t) _mm256_movemask_epi8(_mm256_or_si256(va, vb));
+            uint32_t stop = neq | nul | hib;
+            uint32_t  idx;
+            if (stop == 0) {
+                a += 32;
+                b += 32;
+                continue;
+            }
+            idx = Utf8LowestSetBit(stop);
+            if ((hib & (1U << idx)) == 0) {
+                uint32_t ca = Utf32ToLower((uint8_t) a[idx]);
+                uint32_t cb = Utf32ToLower((uint8_t) b[idx]);
+                return (ca == cb) ? 0 : ((ca < cb) ? -1 : +1);
+            }
+            a += idx;
+            b += idx;
+        }
+        if (Utf8CompareNoCaseStep(&res, &a, &b)) {
+            return res;
+        }
+    }
+}
+#endif /* CPU_ARCH_X86 */
+
+/* @summary Define the function tables for each implementation of the UTF-8 kernels.
+ */
+static UTF8_KERNEL_FUNCS const UTF8_KERNEL_FUNCS_SCALAR = {
+    Utf8Validate_Scalar,
+    Utf8AsciiToUtf16_Scalar,
+    Utf8AsciiToUtf32_Scalar,
+    Utf16AsciiToUtf8_Scalar,
+    Utf32AsciiToUtf8_Scalar,
+    Utf8AsciiFoldCase_Scalar,
+    Utf8CompareNoCase_Scalar
+};
+#if CPU_ARCH_X86
+static UTF8_KERNEL_FUNCS const UTF8_KERNEL_FUNCS_SSSE3 = {
+    Utf8Validate_SSSE3,
+    Utf8AsciiToUtf16_SSSE3,
+    Utf8AsciiToUtf32_SSSE3,
+    Utf16AsciiToUtf8_SSSE3,
+    Utf32AsciiToUtf8_SSSE3,
+    Utf8AsciiFoldCase_SSSE3,
+    Utf8CompareNoCase_SSSE3
+};
+static UTF8_KERNEL_FUNCS const UTF8_KERNEL_FUNCS_AVX2 = {
+    Utf8Validate_AVX2,
+    Utf8AsciiToUtf16_AVX2,
+    Utf8AsciiToUtf32_AVX2,
+    Utf16AsciiToUtf8_AVX2,
+    Utf32AsciiToUtf8_AVX2,
+    Utf8AsciiFoldCase_AVX2,
+    Utf8CompareNoCase_AVX2
+};
+#endif
+
+/* @summary The kernels used by Utf8StringValidate and the transcoding functions, or NULL if they have not been selected yet.
+ */
+static UTF8_KERNEL_FUNCS const * volatile Global_Utf8Kernel = NULL;
+
+/* @summary Retrieve a specific implementation of the UTF-8 kernels.
+ * @param kernel One of the values of the UTF8_KERNEL enumeration.
+ * @return A pointer to the kernel functions, or NULL if the kernel is not supported by the host CPU.
+ */
+static UTF8_KERNEL_FUNCS const*
+Utf8Kernel
+(
+    uint32_t kernel
+)
+{
+#if CPU_ARCH_X86
+    uint32_t cpu = CpuFeatureFlags();
+#endif
+    switch (kernel) {
+        case UTF8_KERNEL_SCALAR:
+            return &UTF8_KERNEL_FUNCS_SCALAR;
+#if CPU_ARCH_X86
+        case UTF8_KERNEL_SSSE3:
+            return ((cpu & (CPU_FEATURE_SSSE3 | CPU_FEATURE_POPCNT)) == (CPU_FEATURE_SSSE3 | CPU_FEATURE_POPCNT)) ? &UTF8_KERNEL_FUNCS_SSSE3 : NULL;
+        case UTF8_KERNEL_AVX2:
+            return ((cpu & (CPU_FEATURE_AVX2 | CPU_FEATURE_POPCNT)) == (CPU_FEATURE_AVX2 | CPU_FEATURE_POPCNT)) ? &UTF8_KERNEL_FUNCS_AVX2 : NULL;
+#endif
+        default:
+            return NULL;
+    }
+}
+
+/* @summary Retrieve the selected UTF-8 kernels, selecting the fastest implementation supported by the host CPU on first use.
+ * @return A pointer to the kernel functions.
+ */
+static UTF8_KERNEL_FUNCS const*
+Utf8EnsureKernel
+(
+    void
+)
+{
+    UTF8_KERNEL_FUNCS const *funcs = Global_Utf8Kernel;
+    if (funcs == NULL) {
+        uint32_t kernel = UTF8_KERNEL_COUNT;
+        while (funcs == NULL && kernel-- > 0) {
+            funcs = Utf8Kernel(kernel);
+        }
+        Global_Utf8Kernel = funcs;
+    }
+    return funcs;
+}
+
+/* @summary Define the number of code units the transcoding loops convert one at a time before trying the vector ASCII path again.
+ */
+#ifndef UTF8_TRANSCODE_SCALAR_RUN
+#define UTF8_TRANSCODE_SCALAR_RUN    32
+#endif
+
+/* @summary Decode one codepoint from a UTF-8 byte sequence, rejecting the sequences that table 3-7 of the Unicode standard does not allow.
+ * @param o_codepoint On return, the decoded codepoint.
+ * @param src The first byte of the sequence.
+ * @param avail The number of bytes available at src.
+ * @return The length of the sequence in bytes, or zero if the sequence is malformed or truncated.
+ */
+static inline size_t
+Utf8DecodeCodepoint
+(
+    char32_t *o_codepoint,
+    uint8_t const    *src,
+    size_t          avail
+)
+{
+    uint8_t c = src[0];
+    if (c < 0x80) {
+       *o_codepoint = c;
+        return 1;
+    }
+    if (c >= 0xC2 && c <= 0xDF) {
+        if (avail >= 2 && (src[1] & 0xC0) == 0x80) {
+           *o_codepoint = ((char32_t)(c & 0x1F) << 6) | (src[1] & 0x3F);
+            return 2;
+        } return 0;
+    }
+    if (c >= 0xE0 && c <= 0xEF) {
+        uint8_t lo = (c == 0xE0) ? 0xA0 : 0x80;
+        uint8_t hi = (c == 0xED) ? 0x9F : 0xBF;
+        if (avail >= 3 && src[1] >= lo && src[1] <= hi && (src[2] & 0xC0) == 0x80) {
+           *o_codepoint = ((char32_t)(c & 0x0F) << 12) | ((char32_t)(src[1] & 0x3F) << 6) | (src[2] & 0x3F);
+            return 3;
+        } return 0;
+    }
+    if (c >= 0xF0 && c <= 0xF4) {
+        uint8_t lo = (c == 0xF0) ? 0x90 : 0x80;
+        uint8_t hi = (c == 0xF4) ? 0x8F : 0xBF;
+        if (avail >= 4 && src[1] >= lo && src[1] <= hi && (src[2] & 0xC0) == 0x80 && (src[3] & 0xC0) == 0x80) {
+           *o_codepoint = ((char32_t)(c & 0x07) << 18) | ((char32_t)(src[1] & 0x3F) << 12) | ((char32_t)(src[2] & 0x3F) << 6) | (src[3] & 0x3F);
+            return 4;
+        } return 0;
+    }
+    return 0;
+}
+
+/* @summary Encode one codepoint as UTF-8. The codepoint must be a valid Unicode scalar value.
+ * @param dst The destination for up to four bytes, or NULL to only compute the length.
+ * @param cp The codepoint to encode.
+ * @return The number of bytes in the encoding.
+ */
+static inline size_t
+Utf8EncodeCodepoint
+(
+    char8_t *dst,
+    char32_t  cp
+)
+{
+    if (cp < 0x80) {
+        if (dst) {
+            dst[0] = (char8_t) cp;
+        } return 1;
+    }
+    if (cp < 0x800) {
+        if (dst) {
+            dst[0] = (char8_t)(0xC0 | (cp >> 6));
+            dst[1] = (char8_t)(0x80 | (cp & 0x3F));
+        } return 2;
+    }
+    if (cp < 0x10000) {
+        if (dst) {
+            dst[0] = (char8_t)(0xE0 |  (cp >> 12));
+            dst[1] = (char8_t)(0x80 | ((cp >>  6) & 0x3F));
+            dst[2] = (char8_t)(0x80 |  (cp        & 0x3F));
+        } return 3;
+    }
+    if (dst) {
+        dst[0] = (char8_t)(0xF0 |  (cp >> 18));
+        dst[1] = (char8_t)(0x80 | ((cp >> 12) & 0x3F));
+        dst[2] = (char8_t)(0x80 | ((cp >>  6) & 0x3F));
+        dst[3] = (char8_t)(0x80 |  (cp        & 0x3F));
+    } return 4;
+}
+
+/* @summary Transcode UTF-8 to UTF-16 or UTF-32 in a single pass.
+ * @param o_numdst On return, the number of code units produced, not including the nul.
+ * @param o_numchars On return, the number of codepoints converted.
+ * @param dst16 The UTF-16 destination, or NULL.
+ * @param dst32 The UTF-32 destination, or NULL. At most one of dst16 and dst32 may be non-NULL; if both are NULL the output is only measured.
+ * @param max_dst The capacity of the destination in code units, not including space for the nul.
+ * @param src The UTF-8 source.
+ * @param num_src The number of bytes in src.
+ * @return Zero on success, or -1 with errno set to EILSEQ or ENOBUFS.
+ */
+static int
+Utf8TranscodeToWide
+(
+    size_t             *o_numdst,
+    size_t           *o_numchars,
+    char16_t              *dst16,
+    char32_t              *dst32,
+    size_t               max_dst,
+    uint8_t const           *src,
+    size_t               num_src
+)
+{
+    UTF8_KERNEL_FUNCS const *funcs = Utf8EnsureKernel();
+    int                    measure = (dst16 == NULL && dst32 == NULL);
+    size_t                       i = 0;
+    size_t                       o = 0;
+    size_t                       c = 0;
+
+    while (i < num_src) {
+        size_t stop;
+        size_t    n = num_src - i;
+        if (!measure && n > max_dst - o) { /* never let the vector path write past the destination */
+            n = max_dst - o;
+        }
+        n  = dst16 != NULL ? funcs->Utf8AsciiToUtf16(dst16 + o, src + i, n)
+           : dst32 != NULL ? funcs->Utf8AsciiToUtf32(dst32 + o, src + i, n)
+           :                 funcs->Utf8AsciiToUtf16(NULL     , src + i, n);
+        i += n;
+        o += n;
+        c += n;
+        stop = (num_src - i) < UTF8_TRANSCODE_SCALAR_RUN ? num_src : i + UTF8_TRANSCODE_SCALAR_RUN;
+        while (i < stop) {
+            char32_t cp = 0;
+            size_t   nb = Utf8DecodeCodepoint(&cp, src + i, num_src - i);
+            size_t   nu = (dst32 == NULL && cp >= 0x10000) ? 2 : 1;
+            if (nb == 0) {
+                *o_numdst = o;
+                *o_numchars = c;
+                errno = EILSEQ;
+                return -1;
+            }
+            if (!measure && nu > max_dst - o) {
+                *o_numdst = o;
+                *o_numchars = c;
+                errno = ENOBUFS;
+                return -1;
+            }
+            if (dst32 != NULL) {
+                dst32[o] = cp;
+            } else if (dst16 != NULL) {
+                if (nu == 1) {
+                    dst16[o + 0] = (char16_t) cp;
+                } else {
+                    dst16[o + 0] = (char16_t)(0xD800 + ((cp - 0x10000) >> 10));
+                    dst16[o + 1] = (char16_t)(0xDC00 + ((cp - 0x10000) & 0x3FF));
+                }
+            }
+            i += nb;
+            o += nu;
+            c += 1;
+        }
+    }
+    *o_numdst = o;
+    *o_numchars = c;
+    return 0;
+}
+
+/* @summary Transcode UTF-16 or UTF-32 to UTF-8 in a single pass.
+ * @param o_numdst On return, the number of bytes produced, not including the nul.
+ * @param o_numchars On return, the number of codepoints converted.
+ * @param dst The UTF-8 destination, or NULL to only measure the output.
+ * @param max_dst The capacity of the destination in bytes, not including space for the nul.
+ * @param src16 The UTF-16 source, or NULL.
+ * @param src32 The UTF-32 source, or NULL. Exactly one of src16 and src32 must be non-NULL.
+ * @param num_src The number of code units in the source.
+ * @return Zero on success, or -1 with errno set to EILSEQ or ENOBUFS.
+ */
+static int
+Utf8TranscodeFromWide
+(
+    size_t             *o_numdst,
+    size_t           *o_numchars,
+    char8_t                 *dst,
+    size_t               max_dst,
+    char16_t const        *src16,
+    char32_t const        *src32,
+    size_t               num_src
+)
+{
+    UTF8_KERNEL_FUNCS const *funcs = Utf8EnsureKernel();
+    size_t                       i = 0;
+    size_t                       o = 0;
+    size_t                       c = 0;
+
+    while (i < num_src) {
+        size_t stop;
+        size_t    n = num_src - i;
+        if (dst != NULL && n > max_dst - o) {
+            n = max_dst - o;
+        }
+        n  = src16 != NULL ? funcs->Utf16AsciiToUtf8(dst ? dst + o : NULL, src16 + i, n)
+           :                 funcs->Utf32AsciiToUtf8(dst ? dst + o : NULL, src32 + i, n);
+        i += n;
+        o += n;
+        c += n;
+        stop = (num_src - i) < UTF8_TRANSCODE_SCALAR_RUN ? num_src : i + UTF8_TRANSCODE_SCALAR_RUN;
+        while (i < stop) {
+            char32_t cp;
+            size_t   nu = 1;
+            size_t   nb;
+            if (src16 != NULL) {
+                cp = src16[i];
+                if (cp >= 0xD800 && cp <= 0xDBFF && (i + 1) < num_src && src16[i+1] >= 0xDC00 && src16[i+1] <= 0xDFFF) {
+                    cp = ((cp - 0xD800) << 10) + (src16[i+1] - 0xDC00) + 0x10000;
+                    nu = 2;
+                }
+            } else {
+                cp = src32[i];
+            }
+            if ((cp >= 0xD800 && cp <= 0xDFFF) || cp > 0x10FFFF) { /* unpaired surrogate or out of range */
+                *o_numdst = o;
+                *o_numchars = c;
+                errno = EILSEQ;
+                return -1;
+            }
+            nb = Utf8EncodeCodepoint(NULL, cp);
+            if (dst != NULL) {
+                if (nb > max_dst - o) {
+                    *o_numdst = o;
+                    *o_numchars = c;
+                    errno = ENOBUFS;
+                    return -1;
+                }
+                (void) Utf8EncodeCodepoint(dst + o, cp);
+            }
+            i += nu;
+            o += nb;
+            c += 1;
+        }
+    }
+    *o_numdst = o;
+    *o_numchars = c;
+    return 0;
+}
+
+/* @summary Define the signature of a base64 encoding kernel. The kernel encodes every complete group of three bytes in the source buffer.
+ * @param dst The destination buffer, with space for at least (num_src / 3) * 4 characters.
+ * @param src The source data.
+ * @param num_src The number of bytes of source data.
+ * @return The number of source bytes consumed, a multiple of three.
+ */
+typedef size_t (*BASE64_ENCODE_FUNC)
+(
+    char          * __restrict dst,
+    uint8_t const * __restrict src,
+    size_t                 num_src
+);
 
-/* @summary Search a UTF-8 string for a nul-terminator.
- * @param start A pointer to the first codepoint to examine.
- * @return A pointer to the terminating nul.
+/* @summary Define the signature of a base64 decoding kernel. The kernel decodes complete groups of four characters and stops at the first group containing padding or a character outside the alphabet.
+ * @param dst The destination buffer.
+ * @param max_dst The size of the destination buffer, which must be at least (num_src / 4) * 3 bytes. Vector kernels use any space beyond that as slack for full-width stores.
+ * @param src The base64-encoded characters.
+ * @param num_src The number of characters.
+ * @return The number of characters consumed, a multiple of four.
  */
-static inline char8_t*
-Utf8FindNul
+typedef size_t (*BASE64_DECODE_FUNC)
 (
-    char8_t const *start
+    uint8_t    * __restrict dst,
+    size_t              max_dst,
+    char const * __restrict src,
+    size_t              num_src
+);
+
+/* @summary The kernels used by the base64 functions, or NULL if they have not been selected yet.
+ */
+static BASE64_ENCODE_FUNC volatile Global_Base64Encode = NULL;
+static BASE64_DECODE_FUNC volatile Global_Base64Decode = NULL;
+
+/* @summary The base64 alphabet, indexed by 6-bit value.
+ */
+static char const BASE64_ALPHABET[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+
+/* @summary A lookup table to map the 256 possible byte values to a value in [0, 63] or -1 if the value is not valid in a base64-encoded input stream.
+ */
+static signed char const BASE64_DECODE_TABLE[256] = {
+    -1, -1, -1, -1, -1, -1, -1, -1,
+    -1, -1, -1, -1, -1, -1, -1, -1,
+    -1, -1, -1, -1, -1, -1, -1, -1,
+    -1, -1, -1, -1, -1, -1, -1, -1,
+
+    -1, -1, -1, -1, -1, -1, -1, -1,
+    -1, -1, -1, 62, -1, -1, -1, 63,  /* ... , '+', ... '/' */
+    52, 53, 54, 55, 56, 57, 58, 59,  /* '0' - '7'          */
+    60, 61, -1, -1, -1, -1, -1, -1,  /* '8', '9', ...      */
+
+    -1, 0,  1,  2,  3,  4,  5,  6,   /* ..., 'A' - 'G'     */
+     7, 8,  9,  10, 11, 12, 13, 14,  /* 'H' - 'O'          */
+    15, 16, 17, 18, 19, 20, 21, 22,  /* 'P' - 'W'          */
+    23, 24, 25, -1, -1, -1, -1, -1,  /* 'X', 'Y', 'Z', ... */
+
+    -1, 26, 27, 28, 29, 30, 31, 32,  /* ..., 'a' - 'g'     */
+    33, 34, 35, 36, 37, 38, 39, 40,  /* 'h' - 'o'          */
+    41, 42, 43, 44, 45, 46, 47, 48,  /* 'p' - 'w'          */
+    49, 50, 51, -1, -1, -1, -1, -1,  /* 'x', 'y', 'z', ... */
+
+    -1, -1, -1, -1, -1, -1, -1, -1,
+    -1, -1, -1, -1, -1, -1, -1, -1,
+    -1, -1, -1, -1, -1, -1, -1, -1,
+    -1, -1, -1, -1, -1, -1, -1, -1,
+
+    -1, -1, -1, -1, -1, -1, -1, -1,
+    -1, -1, -1, -1, -1, -1, -1, -1,
+    -1, -1, -1, -1, -1, -1, -1, -1,
+    -1, -1, -1, -1, -1, -1, -1, -1,
+
+    -1, -1, -1, -1, -1, -1, -1, -1,
+    -1, -1, -1, -1, -1, -1, -1, -1,
+    -1, -1, -1, -1, -1, -1, -1, -1,
+    -1, -1, -1, -1, -1, -1, -1, -1,
+
+    -1, -1, -1, -1, -1, -1, -1, -1,
+    -1, -1, -1, -1, -1, -1, -1, -1,
+    -1, -1, -1, -1, -1, -1, -1, -1,
+    -1, -1, -1, -1, -1, -1, -1, -1
+};
+
+/* @summary Encode complete groups of three bytes one group at a time.
+ */
+static size_t
+Base64Encode_Scalar
+(
+    char          * __restrict dst,
+    uint8_t const * __restrict src,
+    size_t                 num_src
 )
 {
-    char8_t *b =(char8_t*) start;
-    size_t len = 0;
-    if (start != NULL) {
-        len = strlen(start);
+    size_t i;
+    for (i = 0; num_src - i >= 3; i += 3, dst += 4) {
+        /* buf[0] = left  6 bits of inp[0].
+         * buf[1] = right 2 bits of inp[0], left 4 bits if inp[1].
+         * buf[2] = right 4 bits of inp[1], left 2 bits of inp[2].
+         * buf[3] = right 6 bits of inp[2]. */
+        dst[0] = BASE64_ALPHABET[  (src[i+0] & 0xFC) >> 2];
+        dst[1] = BASE64_ALPHABET[((src[i+0] & 0x03) << 4) + ((src[i+1] & 0xF0) >> 4)];
+        dst[2] = BASE64_ALPHABET[((src[i+1] & 0x0F) << 2) + ((src[i+2] & 0xC0) >> 6)];
+        dst[3] = BASE64_ALPHABET[  (src[i+2] & 0x3F)];
     }
-    return (char8_t*)(b + len);
+    return i;
 }
 
-/* @summary Search a UTF-16 string for a nul-terminator.
- * @param start A pointer to the first codepoint to examine.
- * @return A pointer to the terminating nul.
+/* @summary Decode complete groups of four characters one group at a time, stopping at the first group that contains padding or an invalid character.
  */
-static inline char16_t*
-Utf16FindNul
+static size_t
+Base64Decode_Scalar
 (
-    char16_t const *start
+    uint8_t    * __restrict dst,
+    size_t              max_dst,
+    char const * __restrict src,
+    size_t              num_src
 )
 {
-    char16_t *nul = (char16_t*) start;
-    if (start != NULL) {
-        while (*nul) {
-            ++nul;
+    size_t i;
+    (void) max_dst;
+    for (i = 0; num_src - i >= 4; i += 4, dst += 3) {
+        signed char a = BASE64_DECODE_TABLE[(unsigned char) src[i+0]];
+        signed char b = BASE64_DECODE_TABLE[(unsigned char) src[i+1]];
+        signed char c = BASE64_DECODE_TABLE[(unsigned char) src[i+2]];
+        signed char d = BASE64_DECODE_TABLE[(unsigned char) src[i+3]];
+        if ((a | b | c | d) < 0) {
+            break;
         }
-    } return nul;
+        dst[0] = (uint8_t)((a << 2) + ((b & 0x30) >> 4));
+        dst[1] = (uint8_t)(((b & 0x0F) << 4) + ((c & 0x3C) >> 2));
+        dst[2] = (uint8_t)(((c & 0x03) << 6) + d);
+    }
+    return i;
 }
 
-/* @summary Search a UTF-32 string for a nul-terminator.
- * @param start A pointer to the first codepoint to examine.
- * @return A pointer to the terminating nul.
+#if CPU_ARCH_X86
+/* @summary Convert 6-bit values in each byte lane to base64 characters.
+ * Values 0-25 map to 'A'-'Z', 26-51 to 'a'-'z', 52-61 to '0'-'9', 62 to '+' and 63 to '/'.
+ * A saturating subtract and a compare reduce each value to one of 14 range classes, and pshufb looks up the offset to add for that class.
  */
-static inline char32_t*
-Utf32FindNul
+static CPU_TARGET("ssse3") inline __m128i
+Base64Translate_SSSE3
 (
-    char32_t const *start
+    __m128i idx
 )
 {
-    char32_t *nul = (char32_t*) start;
-    if (start != NULL) {
-        while (*nul) {
-            ++nul;
+    __m128i const shift = _mm_setr_epi8('a' - 26, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '+' - 62, '/' - 63, 'A', 0, 0);
+    __m128i   cls = _mm_subs_epu8(idx, _mm_set1_epi8(51));
+    __m128i  less = _mm_cmpgt_epi8(_mm_set1_epi8(26), idx);
+    cls = _mm_or_si128(cls, _mm_and_si128(less, _mm_set1_epi8(13)));
+    return _mm_add_epi8(idx, _mm_shuffle_epi8(shift, cls));
+}
+
+/* @summary Split groups of three bytes into four 6-bit values, one per byte lane.
+ * The input must already be shuffled so that each 32-bit lane holds the bytes [b1, b0, b2, b1] of one group.
+ * The multiplies shift the four bit fields into place without variable shifts (W. Mula, "Base64 encoding with SIMD instructions").
+ */
+static CPU_TARGET("ssse3") inline __m128i
+Base64Unpack_SSSE3
+(
+    __m128i in
+)
+{
+    __m128i t0 = _mm_mulhi_epu16(_mm_and_si128(in, _mm_set1_epi32(0x0FC0FC00)), _mm_set1_epi32(0x04000040));
+    __m128i t1 = _mm_mullo_epi16(_mm_and_si128(in, _mm_set1_epi32(0x003F03F0)), _mm_set1_epi32(0x01000010));
+    return _mm_or_si128(t0, t1);
+}
+
+/* @summary Encode 12 input bytes to 16 characters per iteration using SSSE3. Each iteration loads 16 bytes, so the loop stops while at least 16 bytes remain and the scalar kernel finishes.
+ */
+static CPU_TARGET("ssse3") size_t
+Base64Encode_SSSE3
+(
+    char          * __restrict dst,
+    uint8_t const * __restrict src,
+    size_t                 num_src
+)
+{
+    __m128i const spread = _mm_setr_epi8(1, 0, 2, 1, 4, 3, 5, 4, 7, 6, 8, 7, 10, 9, 11, 10);
+    size_t i;
+    for (i = 0; num_src - i >= 16; i += 12, dst += 16) {
+        __m128i in = _mm_shuffle_epi8(_mm_loadu_si128((__m128i const*)(src + i)), spread);
+        _mm_storeu_si128((__m128i*) dst, Base64Translate_SSSE3(Base64Unpack_SSSE3(in)));
+    }
+    return i + Base64Encode_Scalar(dst, src + i, num_src - i);
+}
+
+/* @summary Encode 24 input bytes to 32 characters per iteration using AVX2. Each 128-bit lane encodes 12 bytes, loaded from offsets 0 and 12.
+ */
+static CPU_TARGET("avx2") size_t
+Base64Encode_AVX2
+(
+    char          * __restrict dst,
+    uint8_t const * __restrict src,
+    size_t                 num_src
+)
+{
+    __m256i const spread = _mm256_setr_epi8(1, 0, 2, 1, 4, 3, 5, 4, 7, 6, 8, 7, 10, 9, 11, 10, 1, 0, 2, 1, 4, 3, 5, 4, 7, 6, 8, 7, 10, 9, 11, 10);
+    __m256i const shift  = _mm256_setr_epi8('a' - 26, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '+' - 62, '/' - 63, 'A', 0, 0,
+                                             'a' - 26, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '+' - 62, '/' - 63, 'A', 0, 0);
+    size_t i;
+    for (i = 0; num_src - i >= 28; i += 24, dst += 32) {
+        __m256i in  = _mm256_inserti128_si256(_mm256_castsi128_si256(_mm_loadu_si128((__m128i const*)(src + i))), _mm_loadu_si128((__m128i const*)(src + i + 12)), 1);
+        __m256i t0, t1, idx, cls;
+        in  = _mm256_shuffle_epi8(in, spread);
+        t0  = _mm256_mulhi_epu16(_mm256_and_si256(in, _mm256_set1_epi32(0x0FC0FC00)), _mm256_set1_epi32(0x04000040));
+        t1  = _mm256_mullo_epi16(_mm256_and_si256(in, _mm256_set1_epi32(0x003F03F0)), _mm256_set1_epi32(0x01000010));
+        idx = _mm256_or_si256(t0, t1);
+        cls = _mm256_subs_epu8(idx, _mm256_set1_epi8(51));
+        cls = _mm256_or_si256(cls, _mm256_and_si256(_mm256_cmpgt_epi8(_mm256_set1_epi8(26), idx), _mm256_set1_epi8(13)));
+        _mm256_storeu_si256((__m256i*) dst, _mm256_add_epi8(idx, _mm256_shuffle_epi8(shift, cls)));
+    }
+    return i + Base64Encode_Scalar(dst, src + i, num_src - i);
+}
+
+/* @summary Define the tables used to validate and translate base64 characters with pshufb (W. Mula, "Base64 decoding with SIMD instructions").
+ * A character is valid if the entries selected by its low and high nibbles share no bits. The roll table gives the value to add to a valid character, indexed by its high nibble, with '/' moved to its own entry.
+ */
+static int8_t const BASE64_LUT_LO[16] = {
+    0x15, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x13, 0x1A, 0x1B, 0x1B, 0x1B, 0x1A
+};
+static int8_t const BASE64_LUT_HI[16] = {
+    0x10, 0x10, 0x01, 0x02, 0x04, 0x08, 0x04, 0x08, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10
+};
+static int8_t const BASE64_LUT_ROLL[16] = {
+    0, 16, 19, 4, -65, -65, -71, -71, 0, 0, 0, 0, 0, 0, 0, 0
+};
+
+/* @summary Decode 16 characters to 12 bytes per iteration using SSSE3. Each iteration stores 16 bytes, so the loop requires 16 bytes of destination space.
+ * The loop stops at the first block containing padding or an invalid character, and the scalar kernel continues from there.
+ */
+static CPU_TARGET("ssse3") size_t
+Base64Decode_SSSE3
+(
+    uint8_t    * __restrict dst,
+    size_t              max_dst,
+    char const * __restrict src,
+    size_t              num_src
+)
+{
+    __m128i const lut_lo = _mm_loadu_si128((__m128i const*) BASE64_LUT_LO);
+    __m128i const lut_hi = _mm_loadu_si128((__m128i const*) BASE64_LUT_HI);
+    __m128i const roll   = _mm_loadu_si128((__m128i const*) BASE64_LUT_ROLL);
+    __m128i const nibble = _mm_set1_epi8(0x0F);
+    __m128i const pack   = _mm_setr_epi8(2, 1, 0, 6, 5, 4, 10, 9, 8, 14, 13, 12, -1, -1, -1, -1);
+    size_t  i = 0;
+    size_t  o = 0;
+    for ( ; num_src - i >= 16 && max_dst - o >= 16; i += 16, o += 12) {
+        __m128i in = _mm_loadu_si128((__m128i const*)(src + i));
+        __m128i hi = _mm_and_si128(_mm_srli_epi32(in, 4), nibble);
+        __m128i lo = _mm_shuffle_epi8(lut_lo, _mm_and_si128(in, nibble));
+        __m128i v;
+        if (_mm_movemask_epi8(_mm_cmpeq_epi8(_mm_and_si128(lo, _mm_shuffle_epi8(lut_hi, hi)), _mm_setzero_si128())) != 0xFFFF) {
+            break;
         }
-    } return nul;
+        v = _mm_add_epi8(in, _mm_shuffle_epi8(roll, _mm_add_epi8(_mm_cmpeq_epi8(in, _mm_set1_epi8('/')), hi)));
+        v = _mm_maddubs_epi16(v, _mm_set1_epi32(0x01400140)); /* merge pairs of 6-bit values into 12-bit values */
+        v = _mm_madd_epi16(v, _mm_set1_epi32(0x00011000));    /* merge pairs of 12-bit values into 24-bit values */
+        _mm_storeu_si128((__m128i*)(dst + o), _mm_shuffle_epi8(v, pack));
+    }
+    return i + Base64Decode_Scalar(dst + o, max_dst - o, src + i, num_src - i);
 }
 
-/* @summary Brute-force convert a UCS-4 codepoint to lower case.
- * Taken from https://github.com/sheredom/utf8.h/blob/master/utf8.h.
- * @param cp The UCS-4 codepoint to convert.
- * @return The corresponding 'lower case' codepoint.
+/* @summary Decode 32 characters to 24 bytes per iteration using AVX2. Each iteration stores 32 bytes, so the loop requires 32 bytes of destination space.
  */
-static uint32_t
-Utf32ToLower
+static CPU_TARGET("avx2") size_t
+Base64Decode_AVX2
 (
-    uint32_t cp
+    uint8_t    * __restrict dst,
+    size_t              max_dst,
+    char const * __restrict src,
+    size_t              num_src
 )
 {
-    if (((0x0041 <= cp) && (0x005a >= cp)) ||
-        ((0x00c0 <= cp) && (0x00d6 >= cp)) ||
-        ((0x00d8 <= cp) && (0x00de >= cp)) ||
-        ((0x0391 <= cp) && (0x03a1 >= cp)) ||
-        ((0x03a3 <= cp) && (0x03ab >= cp))) {
-        cp += 32;
-    } else if (((0x0100 <= cp) && (0x012f >= cp)) ||
-               ((0x0132 <= cp) && (0x0137 >= cp)) ||
-               ((0x014a <= cp) && (0x0177 >= cp)) ||
-               ((0x0182 <= cp) && (0x0185 >= cp)) ||
-               ((0x01a0 <= cp) && (0x01a5 >= cp)) ||
-               ((0x01de <= cp) && (0x01ef >= cp)) ||
-               ((0x01f8 <= cp) && (0x021f >= cp)) ||
-               ((0x0222 <= cp) && (0x0233 >= cp)) ||
-               ((0x0246 <= cp) && (0x024f >= cp)) ||
-               ((0x03d8 <= cp) && (0x03ef >= cp))) {
-        cp |= 0x1;
-    } else if (((0x0139 <= cp) && (0x0148 >= cp)) ||
-               ((0x0179 <= cp) && (0x017e >= cp)) ||
-               ((0x01af <= cp) && (0x01b0 >= cp)) ||
-               ((0x01b3 <= cp) && (0x01b6 >= cp)) ||
-               ((0x01cd <= cp) && (0x01dc >= cp))) {
-        cp += 1;
-        cp &=~0x1;
+    __m256i const lut_lo = _mm256_broadcastsi128_si256(_mm_loadu_si128((__m128i const*) BASE64_LUT_LO));
+    __m256i const lut_hi = _mm256_broadcastsi128_si256(_mm_loadu_si128((__m128i const*) BASE64_LUT_HI));
+    __m256i const roll   = _mm256_broadcastsi128_si256(_mm_loadu_si128((__m128i const*) BASE64_LUT_ROLL));
+    __m256i const nibble = _mm256_set1_epi8(0x0F);
+    __m256i const pack   = _mm256_setr_epi8(2, 1, 0, 6, 5, 4, 10, 9, 8, 14, 13, 12, -1, -1, -1, -1, 2, 1, 0, 6, 5, 4, 10, 9, 8, 14, 13, 12, -1, -1, -1, -1);
+    __m256i const gather = _mm256_setr_epi32(0, 1, 2, 4, 5, 6, 3, 7);
+    size_t  i = 0;
+    size_t  o = 0;
+    for ( ; num_src - i >= 32 && max_dst - o >= 32; i += 32, o += 24) {
+        __m256i in = _mm256_loadu_si256((__m256i const*)(src + i));
+        __m256i hi = _mm256_and_si256(_mm256_srli_epi32(in, 4), nibble);
+        __m256i lo = _mm256_shuffle_epi8(lut_lo, _mm256_and_si256(in, nibble));
+        __m256i v;
+        if (!_mm256_testz_si256(lo, _mm256_shuffle_epi8(lut_hi, hi))) {
+            break;
+        }
+        v = _mm256_add_epi8(in, _mm256_shuffle_epi8(roll, _mm256_add_epi8(_mm256_cmpeq_epi8(in, _mm256_set1_epi8('/')), hi)));
+        v = _mm256_maddubs_epi16(v, _mm256_set1_epi32(0x01400140));
+        v = _mm256_madd_epi16(v, _mm256_set1_epi32(0x00011000));
+        v = _mm256_shuffle_epi8(v, pack);
+        _mm256_storeu_si256((__m256i*)(dst + o), _mm256_permutevar8x32_epi32(v, gather)); /* move the 12 bytes of the high lane down next to the low lane */
+    }
+    return i + Base64Decode_Scalar(dst + o, max_dst - o, src + i, num_src - i);
+}
+#endif /* CPU_ARCH_X86 */
+
+/* @summary Retrieve a specific implementation of the base64 kernels.
+ * @param o_encode On return, set to the encoding kernel, or NULL if the kernel is not supported by the host CPU.
+ * @param o_decode On return, set to the decoding kernel, or NULL if the kernel is not supported by the host CPU.
+ * @param kernel One of the values of the BASE64_KERNEL enumeration.
+ * @return Zero if the kernel is supported, or -1 if it is not.
+ */
+static int
+Base64Kernel
+(
+    BASE64_ENCODE_FUNC *o_encode,
+    BASE64_DECODE_FUNC *o_decode,
+    uint32_t              kernel
+)
+{
+#if CPU_ARCH_X86
+    uint32_t cpu = CpuFeatureFlags();
+#endif
+    *o_encode = NULL;
+    *o_decode = NULL;
+    switch (kernel) {
+        case BASE64_KERNEL_SCALAR:
+            *o_encode = Base64Encode_Scalar;
+            *o_decode = Base64Decode_Scalar;
+            return 0;
+#if CPU_ARCH_X86
+        case BASE64_KERNEL_SSSE3:
+            if (cpu & CPU_FEATURE_SSSE3) {
+                *o_encode = Base64Encode_SSSE3;
+                *o_decode = Base64Decode_SSSE3;
+                return 0;
+            } return -1;
+        case BASE64_KERNEL_AVX2:
+            if (cpu & CPU_FEATURE_AVX2) {
+                *o_encode = Base64Encode_AVX2;
+                *o_decode = Base64Decode_AVX2;
+                return 0;
+            } return -1;
+#endif
+        default:
+            return -1;
+    }
+}
+
+/* @summary Select the fastest base64 kernels supported by the host CPU, if no kernel has been selected yet.
+ */
+static void
+Base64EnsureKernel
+(
+    void
+)
+{
+    if (Global_Base64Encode == NULL || Global_Base64Decode == NULL) {
+        BASE64_ENCODE_FUNC enc = NULL;
+        BASE64_DECODE_FUNC dec = NULL;
+        uint32_t        kernel = BASE64_KERNEL_COUNT;
+        while (kernel-- > 0 && Base64Kernel(&enc, &dec, kernel) != 0) {
+            /* empty */
+        }
+        Global_Base64Decode = dec;
+        Global_Base64Encode = enc;
+    }
+}
+
+/* @summary Append one character to the group being assembled by a streaming base64 decoder, and write the decoded bytes when the group is complete.
+ * @param stream The stream state.
+ * @param o_numout On return, the number of bytes written to out (zero to three).
+ * @param out The destination for the decoded bytes of a completed group.
+ * @param ch The input character.
+ * @return Zero if the character was accepted, or -1 if it is invalid at this position.
+ */
+static int
+Base64StreamPushChar
+(
+    struct BASE64_STREAM *stream,
+    size_t             *o_numout,
+    uint8_t                 *out,
+    char                      ch
+)
+{
+    uint8_t *v = stream->Carry;
+    *o_numout  = 0;
+    if (stream->Finished) {
+        return -1;
+    }
+    if (ch == '=') { /* padding may only occupy the last one or two positions of a group */
+        if (stream->CarryCount < 2) {
+            return -1;
+        }
+        stream->PadCount++;
+        v[stream->CarryCount++] = 0;
     } else {
-        switch (cp) {
-            case 0x0178: cp = 0x00ff; break;
-            case 0x0243: cp = 0x0180; break;
-            case 0x018e: cp = 0x01dd; break;
-            case 0x023d: cp = 0x019a; break;
-            case 0x0220: cp = 0x019e; break;
-            case 0x01b7: cp = 0x0292; break;
-            case 0x01c4: cp = 0x01c6; break;
-            case 0x01c7: cp = 0x01c9; break;
-            case 0x01ca: cp = 0x01cc; break;
-            case 0x01f1: cp = 0x01f3; break;
-            case 0x01f7: cp = 0x01bf; break;
-            case 0x0187: cp = 0x0188; break;
-            case 0x018b: cp = 0x018c; break;
-            case 0x0191: cp = 0x0192; break;
-            case 0x0198: cp = 0x0199; break;
-            case 0x01a7: cp = 0x01a8; break;
-            case 0x01ac: cp = 0x01ad; break;
-            case 0x01af: cp = 0x01b0; break;
-            case 0x01b8: cp = 0x01b9; break;
-            case 0x01bc: cp = 0x01bd; break;
-            case 0x01f4: cp = 0x01f5; break;
-            case 0x023b: cp = 0x023c; break;
-            case 0x0241: cp = 0x0242; break;
-            case 0x03fd: cp = 0x037b; break;
-            case 0x03fe: cp = 0x037c; break;
-            case 0x03ff: cp = 0x037d; break;
-            case 0x037f: cp = 0x03f3; break;
-            case 0x0386: cp = 0x03ac; break;
-            case 0x0388: cp = 0x03ad; break;
-            case 0x0389: cp = 0x03ae; break;
-            case 0x038a: cp = 0x03af; break;
-            case 0x038c: cp = 0x03cc; break;
-            case 0x038e: cp = 0x03cd; break;
-            case 0x038f: cp = 0x03ce; break;
-            case 0x0370: cp = 0x0371; break;
-            case 0x0372: cp = 0x0373; break;
-            case 0x0376: cp = 0x0377; break;
-            case 0x03f4: cp = 0x03d1; break;
-            case 0x03cf: cp = 0x03d7; break;
-            case 0x03f9: cp = 0x03f2; break;
-            case 0x03f7: cp = 0x03f8; break;
-            case 0x03fa: cp = 0x03fb; break;
-            default: break;
+        signed char chi = BASE64_DECODE_TABLE[(unsigned char) ch];
+        if (chi < 0 || stream->PadCount != 0) {
+            return -1;
         }
+        v[stream->CarryCount++] = (uint8_t) chi;
     }
-    return cp;
+    if (stream->CarryCount == 4) {
+        size_t n = 3 - stream->PadCount;
+        out[0] = (uint8_t)((v[0] << 2) + ((v[1] & 0x30) >> 4));
+        if (n > 1) out[1] = (uint8_t)(((v[1] & 0x0F) << 4) + ((v[2] & 0x3C) >> 2));
+        if (n > 2) out[2] = (uint8_t)(((v[2] & 0x03) << 6) + v[3]);
+        stream->Finished   = (stream->PadCount != 0);
+        stream->CarryCount = 0;
+        stream->PadCount   = 0;
+       *o_numout = n;
+    }
+    return 0;
 }
 
 /* @summary Brute-force convert a UCS-4 codepoint to upper case.
@@ -365,8 +1981,8 @@ Utf8StringCreate
             init_bytes = strinfo->LengthBytes;
             init_chars = strinfo->LengthChars;
         } else {
-            init_bytes = strlen(strbuf) + UTF8_NUL_BYTES;
-            init_chars = mbstowcs(NULL, strbuf, 0);
+            (void) Utf8StringValidate(&init_bytes, &init_chars, strbuf);
+            init_bytes += UTF8_NUL_BYTES;
         }
     }
     /* allocate at least enough data to store the string copy */
@@ -490,104 +2106,46 @@ Utf8StringCreateFromUtf16
 )
 {
     size_t     max_bytes =(max_chars * UTF8_MAX_BYTES_PER_CODEPOINT) + UTF8_NUL_BYTES;
+    size_t     num_units =(size_t)(Utf16FindNul(strbuf) - strbuf);
     size_t    init_chars = 0;
-    size_t    init_bytes = 1;
+    size_t    init_bytes = 0;
     char8_t         *buf = NULL;
-    char8_t         *dit = NULL;
-    char16_t const  *sit = NULL;
-    uint32_t const bmask = 0xBF;
-    uint32_t const bmark = 0x80;
-    char32_t      ch, c2;
-    uint8_t           nb = 0;
-    uint8_t  const  F[7] = { 0x00, 0x00, 0xC0, 0xE0, 0xF0, 0xF8, 0xFC };
 
-    if (strbuf) { /* determine the number of bytes required to store the converted string */
-        for (sit = strbuf; ; ++sit) {
-            ch = *sit;
-            if (ch >= 0xD800 && ch <= 0xDBFF) { /* convert surrogate pairs to UTF-32 */
-                c2 = *(sit+1);
-                if (c2 >= 0xDC00 && c2 <= 0xDFFF) {
-                    ch = ((ch - 0xD800) << 10) + (c2 - 0xDC00) + 0x10000;
-                }
-            }
-            if (ch < 0x80) {
-                init_bytes++;
-                if (ch != 0) {
-                    init_chars++;
-                } else break;
-            } else if (ch < 0x800) {
-                init_bytes += 2;
-                init_chars++;
-            } else if (ch < 0x10000) {
-                init_bytes += 3;
-                init_chars++;
-            } else if (ch < 0x110000) {
-                init_bytes += 4;
-                init_chars++;
-            } else {
-                if (o_strinfo) {
-                    memset(o_strinfo, 0, sizeof(STRING_INFO));
-                }
-                if (o_bufinfo) {
-                    memset(o_bufinfo, 0, sizeof(STRING_INFO));
-                } errno = EILSEQ;
-                return NULL;
-            }
-        }
+    /* measure the converted string; this also rejects unpaired surrogates */
+    if (Utf8TranscodeFromWide(&init_bytes, &init_chars, NULL, 0, strbuf, NULL, num_units) != 0) {
+        goto cleanup_and_fail;
     }
+    init_bytes += UTF8_NUL_BYTES;
     if (max_bytes < init_bytes) { /* need at least enough data to store the string copy */
         max_bytes = init_bytes;
     }
-    if ((buf = (char8_t*) malloc(max_bytes)) != NULL) { /* allocate the required memory */
-        if (strbuf) { /* transcode data in strbuf */
-            for (dit = buf, sit = strbuf; ; ++sit) {
-                ch = *sit;
-                if (ch >= 0xD800 && ch <= 0xDBFF) { /* convert surrogate pairs to UTF-32 */
-                    c2 = *(sit+1);
-                    if (c2 >= 0xDC00 && c2 <= 0xDFFF) {
-                        ch = ((ch - 0xD800) << 10) + (c2 - 0xDC00) + 0x10000;
-                        sit++; /* also consume low surrogate */
-                    }
-                }
-                if      (ch < 0x80    ) nb = 1;
-                else if (ch < 0x800   ) nb = 2;
-                else if (ch < 0x10000 ) nb = 3;
-                else if (ch < 0x110000) nb = 4;
-                switch (nb) {
-                    case 4: dit[3] = (char8_t)((ch | bmark) & bmask); ch >>= 6; /* fallthrough */
-                    case 3: dit[2] = (char8_t)((ch | bmark) & bmask); ch >>= 6; /* fallthrough */
-                    case 2: dit[1] = (char8_t)((ch | bmark) & bmask); ch >>= 6; /* fallthrough */
-                    case 1: dit[0] = (char8_t) (ch | F[nb]); /* fallthrough */
-                } dit += nb;
-                if (ch == 0) {
-                    break;
-                }
-            }
-        } else {
-            buf[0] = 0;
-        }
-        if (o_strinfo) {
-            o_strinfo->Buffer      = buf;
-            o_strinfo->BufferEnd   = buf + init_bytes;
-            o_strinfo->LengthBytes = init_bytes;
-            o_strinfo->LengthChars = init_chars;
-        }
-        if (o_bufinfo) {
-            o_bufinfo->Buffer      = buf;
-            o_bufinfo->BufferEnd   = buf + max_bytes;
-            o_bufinfo->LengthBytes = max_bytes;
-            o_bufinfo->LengthChars =(max_bytes - UTF8_NUL_BYTES) / UTF8_MAX_BYTES_PER_CODEPOINT;
-        }
-        return buf;
-    } else { /* memory allocation failed */
-        if (o_strinfo) {
-            memset(o_strinfo, 0, sizeof(STRING_INFO));
-        } 
-        if (o_bufinfo) {
-            memset(o_bufinfo, 0, sizeof(STRING_INFO));
-        }
-        return NULL;
+    if ((buf = (char8_t*) malloc(max_bytes)) == NULL) {
+        goto cleanup_and_fail;
+    }
+    (void) Utf8TranscodeFromWide(&init_bytes, &init_chars, buf, max_bytes - UTF8_NUL_BYTES, strbuf, NULL, num_units);
+    buf[init_bytes++] = 0;
+    if (o_strinfo) {
+        o_strinfo->Buffer      = buf;
+        o_strinfo->BufferEnd   = buf + init_bytes;
+        o_strinfo->LengthBytes = init_bytes;
+        o_strinfo->LengthChars = init_chars;
+    }
+    if (o_bufinfo) {
+        o_bufinfo->Buffer      = buf;
+        o_bufinfo->BufferEnd   = buf + max_bytes;
+        o_bufinfo->LengthBytes = max_bytes;
+        o_bufinfo->LengthChars =(max_bytes - UTF8_NUL_BYTES) / UTF8_MAX_BYTES_PER_CODEPOINT;
     }
+    return buf;
+
+cleanup_and_fail:
+    if (o_strinfo) {
+        memset(o_strinfo, 0, sizeof(STRING_INFO));
+    }
+    if (o_bufinfo) {
+        memset(o_bufinfo, 0, sizeof(STRING_INFO));
+    }
+    return NULL;
 }
 
 STRLIB_API(char8_t*)
@@ -600,91 +2158,46 @@ Utf8StringCreateFromUtf32
 )
 {
     size_t     max_bytes =(max_chars * UTF8_MAX_BYTES_PER_CODEPOINT) + UTF8_NUL_BYTES;
+    size_t     num_units =(size_t)(Utf32FindNul(strbuf) - strbuf);
     size_t    init_chars = 0;
-    size_t    init_bytes = 1;
+    size_t    init_bytes = 0;
     char8_t         *buf = NULL;
-    char8_t         *dit = NULL;
-    char32_t const  *sit = NULL;
-    uint32_t const bmask = 0xBF;
-    uint32_t const bmark = 0x80;
-    char32_t          ch = 0;
-    uint8_t           nb = 0;
-    uint8_t  const  F[7] = { 0x00, 0x00, 0xC0, 0xE0, 0xF0, 0xF8, 0xFC };
 
-    if (strbuf) { /* determine the number of bytes required to store the converted string */
-        for (sit = strbuf; ; ++sit) {
-            ch = *sit;
-            if (ch < 0x80) {
-                init_bytes++;
-                if (ch != 0) {
-                    init_chars++;
-                } else break;
-            } else if (ch < 0x800) {
-                init_bytes += 2;
-                init_chars++;
-            } else if (ch < 0x10000) {
-                init_bytes += 3;
-                init_chars++;
-            } else if (ch < 0x10FFFF) {
-                init_bytes += 4;
-                init_chars++;
-            } else {
-                if (o_strinfo) {
-                    memset(o_strinfo, 0, sizeof(STRING_INFO));
-                }
-                if (o_bufinfo) {
-                    memset(o_bufinfo, 0, sizeof(STRING_INFO));
-                } errno = EILSEQ;
-                return NULL;
-            }
-        }
+    /* measure the converted string; this also rejects surrogates and values above U+10FFFF */
+    if (Utf8TranscodeFromWide(&init_bytes, &init_chars, NULL, 0, NULL, strbuf, num_units) != 0) {
+        goto cleanup_and_fail;
     }
+    init_bytes += UTF8_NUL_BYTES;
     if (max_bytes < init_bytes) { /* need at least enough data to store the string copy */
         max_bytes = init_bytes;
     }
-    if ((buf = (char8_t*) malloc(max_bytes)) != NULL) { /* allocate the required memory */
-        if (strbuf) { /* transcode data in strbuf */
-            for (dit = buf, sit = strbuf; ; ++sit) {
-                ch = *sit;
-                if      (ch < 0x80    ) nb = 1;
-                else if (ch < 0x800   ) nb = 2;
-                else if (ch < 0x10000 ) nb = 3;
-                else if (ch < 0x10FFFF) nb = 4;
-                switch (nb) {
-                    case 4: dit[3] = (char8_t)((ch | bmark) & bmask); ch >>= 6; /* fallthrough */
-                    case 3: dit[2] = (char8_t)((ch | bmark) & bmask); ch >>= 6; /* fallthrough */
-                    case 2: dit[1] = (char8_t)((ch | bmark) & bmask); ch >>= 6; /* fallthrough */
-                    case 1: dit[0] = (char8_t) (ch | F[nb]); /* fallthrough */
-                } dit += nb;
-                if (ch == 0) {
-                    break;
-                }
-            }
-        } else {
-            buf[0] = 0;
-        }
-        if (o_strinfo) {
-            o_strinfo->Buffer      = buf;
-            o_strinfo->BufferEnd   = buf + init_bytes;
-            o_strinfo->LengthBytes = init_bytes;
-            o_strinfo->LengthChars = init_chars;
-        }
-        if (o_bufinfo) {
-            o_bufinfo->Buffer      = buf;
-            o_bufinfo->BufferEnd   = buf + max_bytes;
-            o_bufinfo->LengthBytes = max_bytes;
-            o_bufinfo->LengthChars =(max_bytes - UTF8_NUL_BYTES) / UTF8_MAX_BYTES_PER_CODEPOINT;
-        }
-        return buf;
-    } else { /* memory allocation failed */
-        if (o_strinfo) {
-            memset(o_strinfo, 0, sizeof(STRING_INFO));
-        } 
-        if (o_bufinfo) {
-            memset(o_bufinfo, 0, sizeof(STRING_INFO));
-        }
-        return NULL;
+    if ((buf = (char8_t*) malloc(max_bytes)) == NULL) {
+        goto cleanup_and_fail;
+    }
+    (void) Utf8TranscodeFromWide(&init_bytes, &init_chars, buf, max_bytes - UTF8_NUL_BYTES, NULL, strbuf, num_units);
+    buf[init_bytes++] = 0;
+    if (o_strinfo) {
+        o_strinfo->Buffer      = buf;
+        o_strinfo->BufferEnd   = buf + init_bytes;
+        o_strinfo->LengthBytes = init_bytes;
+        o_strinfo->LengthChars = init_chars;
+    }
+    if (o_bufinfo) {
+        o_bufinfo->Buffer      = buf;
+        o_bufinfo->BufferEnd   = buf + max_bytes;
+        o_bufinfo->LengthBytes = max_bytes;
+        o_bufinfo->LengthChars =(max_bytes - UTF8_NUL_BYTES) / UTF8_MAX_BYTES_PER_CODEPOINT;
     }
+    return buf;
+
+cleanup_and_fail:
+    if (o_strinfo) {
+        memset(o_strinfo, 0, sizeof(STRING_INFO));
+    }
+    if (o_bufinfo) {
+        memset(o_bufinfo, 0, sizeof(STRING_INFO));
+    }
+    return NULL;
 }
 
 STRLIB_API(char16_t*)
@@ -697,11 +2210,9 @@ Utf8StringConvertToUtf16
 {
     STRING_INFO  sinfo;
     size_t   max_bytes = 0;
-    char32_t     utf32 = 0;
-    uint32_t    nbytes = 0;
-    uint32_t    nchars = 0;
+    size_t   num_units = 0;
+    size_t   num_chars = 0;
     char16_t      *buf = NULL;
-    char16_t      *dit = NULL;
 
     if (strbuf) {
         if (strinfo) {
@@ -711,41 +2222,31 @@ Utf8StringConvertToUtf16
         }
     } else {
         memset(&sinfo, 0, sizeof(STRING_INFO));
+        sinfo.LengthBytes = UTF8_NUL_BYTES;
     }
-    max_bytes = (sinfo.LengthChars * UTF16_MAX_BYTES_PER_CODEPOINT) + UTF16_NUL_BYTES;
-    if ((buf  = (char16_t*) malloc(max_bytes)) != NULL) {
-        if (strbuf) {
-            for (dit = buf; sinfo.Buffer != sinfo.BufferEnd; ) {
-                sinfo.Buffer = Utf8StringNextCodepoint(&utf32, &nbytes, sinfo.Buffer);
-                if (utf32 <= 0xFFFF) { /* basic multilingual plane */
-                    *dit++ =(char16_t) utf32;
-                } else if (utf32 <= 0x10FFFF) { /* surrogate pair */
-                    utf32 -= 0x10000;
-                    *dit++ =(char16_t)((utf32 >>   10) + 0xD800);
-                    *dit++ =(char16_t)((utf32 & 0x3FF) + 0xDBFF);
-                } else { /* invalid - use replacement character */
-                    *dit++ = 0xFFFD;
-                }
-                if (utf32 != 0) {
-                    nchars++;
-                }
-            }
-        } else {
-            buf[0] = 0;
-        }
-        if (o_u16info) {
-            o_u16info->Buffer      = (char8_t*) buf;
-            o_u16info->BufferEnd   =((char8_t*) buf) + max_bytes;
-            o_u16info->LengthBytes = max_bytes;
-            o_u16info->LengthChars = sinfo.LengthChars;
-        }
-        return buf;
-    } else { /* memory allocation failed */
-        if (o_u16info) {
-            memset(o_u16info, 0, sizeof(STRING_INFO));
-        }
-        return NULL;
+    /* measure the converted string; this also rejects malformed UTF-8 */
+    if (Utf8TranscodeToWide(&num_units, &num_chars, NULL, NULL, 0, (uint8_t const*) sinfo.Buffer, sinfo.LengthBytes - UTF8_NUL_BYTES) != 0) {
+        goto cleanup_and_fail;
+    }
+    max_bytes = (num_units * sizeof(char16_t)) + UTF16_NUL_BYTES;
+    if ((buf  = (char16_t*) malloc(max_bytes)) == NULL) {
+        goto cleanup_and_fail;
     }
+    (void) Utf8TranscodeToWide(&num_units, &num_chars, buf, NULL, num_units, (uint8_t const*) sinfo.Buffer, sinfo.LengthBytes - UTF8_NUL_BYTES);
+    buf[num_units] = 0;
+    if (o_u16info) {
+        o_u16info->Buffer      = (char8_t*) buf;
+        o_u16info->BufferEnd   =((char8_t*) buf) + max_bytes;
+        o_u16info->LengthBytes = max_bytes;
+        o_u16info->LengthChars = num_chars;
+    }
+    return buf;
+
+cleanup_and_fail:
+    if (o_u16info) {
+        memset(o_u16info, 0, sizeof(STRING_INFO));
+    }
+    return NULL;
 }
 
 STRLIB_API(char32_t*)
@@ -758,11 +2259,9 @@ Utf8StringConvertToUtf32
 {
     STRING_INFO  sinfo;
     size_t   max_bytes = 0;
-    char32_t     utf32 = 0;
-    uint32_t    nbytes = 0;
-    uint32_t    nchars = 0;
+    size_t   num_units = 0;
+    size_t   num_chars = 0;
     char32_t      *buf = NULL;
-    char32_t      *dit = NULL;
 
     if (strbuf) {
         if (strinfo) {
@@ -772,37 +2271,203 @@ Utf8StringConvertToUtf32
         }
     } else {
         memset(&sinfo, 0, sizeof(STRING_INFO));
+        sinfo.LengthBytes = UTF8_NUL_BYTES;
     }
-    max_bytes = (sinfo.LengthChars * UTF32_MAX_BYTES_PER_CODEPOINT) + UTF32_NUL_BYTES;
-    if ((buf  = (char32_t*) malloc(max_bytes)) != NULL) {
-        if (strbuf) {
-            for (dit = buf; sinfo.Buffer != sinfo.BufferEnd; ) {
-                sinfo.Buffer = Utf8StringNextCodepoint(&utf32, &nbytes, sinfo.Buffer);
-                if (utf32 <= 0x10FFFF) {
-                    *dit++ = utf32;
-                } else { /* use replacement character */
-                    *dit++ = 0xFFFD;
-                }
-                if (utf32 != 0) {
-                    nchars++;
-                }
-            }
-        } else {
-            buf[0] = 0;
+    /* measure the converted string; this also rejects malformed UTF-8 */
+    if (Utf8TranscodeToWide(&num_units, &num_chars, NULL, NULL, 0, (uint8_t const*) sinfo.Buffer, sinfo.LengthBytes - UTF8_NUL_BYTES) != 0) {
+        goto cleanup_and_fail;
+    }
+    max_bytes = (num_units * sizeof(char32_t)) + UTF32_NUL_BYTES;
+    if ((buf  = (char32_t*) malloc(max_bytes)) == NULL) {
+        goto cleanup_and_fail;
+    }
+    (void) Utf8TranscodeToWide(&num_units, &num_chars, NULL, buf, num_units, (uint8_t const*) sinfo.Buffer, sinfo.LengthBytes - UTF8_NUL_BYTES);
+    buf[num_units] = 0;
+    if (o_u32info) {
+        o_u32info->Buffer      = (char8_t*) buf;
+        o_u32info->BufferEnd   =((char8_t*) buf) + max_bytes;
+        o_u32info->LengthBytes = max_bytes;
+        o_u32info->LengthChars = num_chars;
+    }
+    return buf;
+
+cleanup_and_fail:
+    if (o_u32info) {
+        memset(o_u32info, 0, sizeof(STRING_INFO));
+    }
+    return NULL;
+}
+
+STRLIB_API(int)
+Utf8TranscodeToUtf16
+(
+    size_t         * __restrict o_numdst,
+    char16_t       * __restrict      dst,
+    size_t                       max_dst,
+    char8_t const  * __restrict      src,
+    size_t                       num_src
+)
+{
+    size_t num_units = 0;
+    size_t num_chars = 0;
+    if (src != NULL && num_src == 0) {
+        num_src = (size_t)(Utf8FindNul(src) - src);
+    }
+    if (dst == NULL && max_dst == 0) { /* exact size query */
+        if (Utf8TranscodeToWide(&num_units, &num_chars, NULL, NULL, 0, (uint8_t const*) src, num_src) != 0) {
+            if (o_numdst) {
+               *o_numdst = num_units;
+            } return -1;
         }
-        if (o_u32info) {
-            o_u32info->Buffer      = (char8_t*) buf;
-            o_u32info->BufferEnd   =((char8_t*) buf) + max_bytes;
-            o_u32info->LengthBytes = max_bytes;
-            o_u32info->LengthChars = sinfo.LengthChars;
+        if (o_numdst) {
+           *o_numdst = num_units + 1;
+        } return 0;
+    }
+    if (max_dst == 0) {
+        if (o_numdst) {
+           *o_numdst = 0;
+        } errno = ENOBUFS;
+        return -1;
+    }
+    if (Utf8TranscodeToWide(&num_units, &num_chars, dst, NULL, max_dst - 1, (uint8_t const*) src, num_src) != 0) {
+        if (o_numdst) {
+           *o_numdst = (errno == ENOBUFS) ? 0 : num_units;
+        } return -1;
+    }
+    dst[num_units] = 0;
+    if (o_numdst) {
+       *o_numdst = num_units + 1;
+    }
+    return 0;
+}
+
+STRLIB_API(int)
+Utf8TranscodeToUtf32
+(
+    size_t         * __restrict o_numdst,
+    char32_t       * __restrict      dst,
+    size_t                       max_dst,
+    char8_t const  * __restrict      src,
+    size_t                       num_src
+)
+{
+    size_t num_units = 0;
+    size_t num_chars = 0;
+    if (src != NULL && num_src == 0) {
+        num_src = (size_t)(Utf8FindNul(src) - src);
+    }
+    if (dst == NULL && max_dst == 0) { /* exact size query */
+        if (Utf8TranscodeToWide(&num_units, &num_chars, NULL, NULL, 0, (uint8_t const*) src, num_src) != 0) {
+            if (o_numdst) {
+               *o_numdst = num_chars;
+            } return -1;
         }
-        return buf;
-    } else { /* memory allocation failed */
-        if (o_u32info) {
-            memset(o_u32info, 0, sizeof(STRING_INFO));
+        if (o_numdst) { /* one UTF-32 code unit per codepoint */
+           *o_numdst = num_chars + 1;
+        } return 0;
+    }
+    if (max_dst == 0) {
+        if (o_numdst) {
+           *o_numdst = 0;
+        } errno = ENOBUFS;
+        return -1;
+    }
+    if (Utf8TranscodeToWide(&num_units, &num_chars, NULL, dst, max_dst - 1, (uint8_t const*) src, num_src) != 0) {
+        if (o_numdst) {
+           *o_numdst = (errno == ENOBUFS) ? 0 : num_units;
+        } return -1;
+    }
+    dst[num_units] = 0;
+    if (o_numdst) {
+       *o_numdst = num_units + 1;
+    }
+    return 0;
+}
+
+STRLIB_API(int)
+Utf8TranscodeFromUtf16
+(
+    size_t         * __restrict o_numdst,
+    char8_t        * __restrict      dst,
+    size_t                       max_dst,
+    char16_t const * __restrict      src,
+    size_t                       num_src
+)
+{
+    size_t num_bytes = 0;
+    size_t num_chars = 0;
+    if (src != NULL && num_src == 0) {
+        num_src = (size_t)(Utf16FindNul(src) - src);
+    }
+    if (dst == NULL && max_dst == 0) { /* exact size query */
+        if (Utf8TranscodeFromWide(&num_bytes, &num_chars, NULL, 0, src, NULL, num_src) != 0) {
+            if (o_numdst) {
+               *o_numdst = num_bytes;
+            } return -1;
         }
-        return NULL;
+        if (o_numdst) {
+           *o_numdst = num_bytes + UTF8_NUL_BYTES;
+        } return 0;
+    }
+    if (max_dst == 0) {
+        if (o_numdst) {
+           *o_numdst = 0;
+        } errno = ENOBUFS;
+        return -1;
+    }
+    if (Utf8TranscodeFromWide(&num_bytes, &num_chars, dst, max_dst - UTF8_NUL_BYTES, src, NULL, num_src) != 0) {
+        if (o_numdst) {
+           *o_numdst = (errno == ENOBUFS) ? 0 : num_bytes;
+        } return -1;
+    }
+    dst[num_bytes] = 0;
+    if (o_numdst) {
+       *o_numdst = num_bytes + UTF8_NUL_BYTES;
+    }
+    return 0;
+}
+
+STRLIB_API(int)
+Utf8TranscodeFromUtf32
+(
+    size_t         * __restrict o_numdst,
+    char8_t        * __restrict      dst,
+    size_t                       max_dst,
+    char32_t const * __restrict      src,
+    size_t                       num_src
+)
+{
+    size_t num_bytes = 0;
+    size_t num_chars = 0;
+    if (src != NULL && num_src == 0) {
+        num_src = (size_t)(Utf32FindNul(src) - src);
+    }
+    if (dst == NULL && max_dst == 0) { /* exact size query */
+        if (Utf8TranscodeFromWide(&num_bytes, &num_chars, NULL, 0, NULL, src, num_src) != 0) {
+            if (o_numdst) {
+               *o_numdst = num_bytes;
+            } return -1;
+        }
+        if (o_numdst) {
+           *o_numdst = num_bytes + UTF8_NUL_BYTES;
+        } return 0;
+    }
+    if (max_dst == 0) {
+        if (o_numdst) {
+           *o_numdst = 0;
+        } errno = ENOBUFS;
+        return -1;
     }
+    if (Utf8TranscodeFromWide(&num_bytes, &num_chars, dst, max_dst - UTF8_NUL_BYTES, NULL, src, num_src) != 0) {
+        if (o_numdst) {
+           *o_numdst = (errno == ENOBUFS) ? 0 : num_bytes;
+        } return -1;
+    }
+    dst[num_bytes] = 0;
+    if (o_numdst) {
+       *o_numdst = num_bytes + UTF8_NUL_BYTES;
+    }
+    return 0;
 }
 
 STRLIB_API(void)
@@ -865,8 +2530,8 @@ Utf8StringInfo
     assert(o_strinfo != NULL);
 
     if (strbuf) {
-        len_bytes = strlen(strbuf) + UTF8_NUL_BYTES;
-        len_chars = mbstowcs(NULL, strbuf, 0);
+        (void) Utf8StringValidate(&len_bytes, &len_chars, strbuf);
+        len_bytes += UTF8_NUL_BYTES;
     }
     o_strinfo->Buffer      =(char8_t*) strbuf;
     o_strinfo->BufferEnd   =(char8_t*) strbuf + len_bytes;
@@ -874,6 +2539,46 @@ Utf8StringInfo
     o_strinfo->LengthChars = len_chars;
 }
 
+STRLIB_API(int)
+Utf8StringValidate
+(
+    size_t   *o_bytecount,
+    size_t   *o_charcount,
+    char8_t const *strbuf
+)
+{
+    return Utf8EnsureKernel()->Validate(o_bytecount, o_charcount, strbuf);
+}
+
+STRLIB_API(int)
+Utf8SelectKernel
+(
+    uint32_t kernel
+)
+{
+    UTF8_KERNEL_FUNCS const *funcs = Utf8Kernel(kernel);
+    if (funcs == NULL) {
+        errno = ENOTSUP;
+        return -1;
+    }
+    Global_Utf8Kernel = funcs;
+    return 0;
+}
+
+STRLIB_API(char const*)
+Utf8KernelName
+(
+    uint32_t kernel
+)
+{
+    switch (kernel) {
+        case UTF8_KERNEL_SCALAR: return "scalar";
+        case UTF8_KERNEL_SSSE3 : return "ssse3";
+        case UTF8_KERNEL_AVX2  : return "avx2";
+        default                : return "unknown";
+    }
+}
+
 STRLIB_API(int)
 Utf8StringCompare
 (
@@ -891,26 +2596,75 @@ Utf8StringCompareNoCase
     char8_t const *b
 )
 {
-    char8_t *ita =(char8_t*) a;
-    char8_t *itb =(char8_t*) b;
-    char32_t cpa;
-    char32_t cpb;
+    return Utf8EnsureKernel()->CompareNoCase(a, b);
+}
 
-    for ( ; ; ) {
-        ita = Utf8StringNextCodepoint(&cpa, NULL, ita);
-        itb = Utf8StringNextCodepoint(&cpb, NULL, itb);
-        cpa = Utf32ToLower(cpa);
-        cpb = Utf32ToLower(cpb);
-        if (cpa == cpb) {
-            if (cpa == 0) {
-                return 0;
+STRLIB_API(int)
+Utf8StringFoldCase
+(
+    size_t  *o_numdst,
+    char8_t      *dst,
+    size_t    max_dst,
+    char8_t const *src
+)
+{
+    UTF8_KERNEL_FUNCS const *funcs = Utf8EnsureKernel();
+    size_t                 num_src = (size_t)(Utf8FindNul(src) - src);
+    size_t                   limit = (dst != NULL) ? max_dst - 1 : SIZE_MAX;
+    size_t                       i = 0;
+    size_t                       n = 0;
+
+    if (dst != NULL && max_dst == 0) {
+        goto cleanup_and_fail;
+    }
+    while (i < num_src) {
+        size_t run = num_src - i;
+        size_t   j;
+        if (run > limit - n) {
+            run = limit - n;
+        }
+        run = funcs->Utf8AsciiFoldCase(dst != NULL ? dst + n : NULL, (uint8_t const*) src + i, run);
+        i  += run;
+        n  += run;
+        /* the kernels stop at the last whole block; fold the rest of an ASCII run a byte at a time rather than per codepoint */
+        for ( ; i < num_src && n < limit && ((uint8_t) src[i] & 0x80) == 0; ++i, ++n) {
+            if (dst != NULL) {
+                dst[n] = (src[i] >= 'A' && src[i] <= 'Z') ? (char8_t)(src[i] + 0x20) : src[i];
             }
-        } else if (cpa < cpb) {
-            return -1;
-        } else {
-            return +1;
+        }
+        for (j = 0; j < UTF8_TRANSCODE_SCALAR_RUN && i < num_src; ++j) {
+            char32_t  cp;
+            uint32_t len;
+            size_t   enc;
+            if (Utf8StringNextCodepoint(&cp, &len, src + i) == NULL || cp == 0) {
+                num_src = i; /* the key ends where Utf8StringCompareNoCase stops */
+                break;
+            }
+            cp  = Utf32ToLower(cp);
+            enc = Utf8EncodeCodepoint(NULL, cp);
+            if (enc > limit - n) {
+                goto cleanup_and_fail;
+            }
+            if (dst != NULL) {
+                Utf8EncodeCodepoint(dst + n, cp);
+            }
+            i += len;
+            n += enc;
         }
     }
+    if (dst != NULL) {
+        dst[n] = 0;
+    }
+    if (o_numdst) {
+       *o_numdst = n + 1;
+    }
+    return 0;
+
+cleanup_and_fail:
+    if (o_numdst) {
+       *o_numdst = 0;
+    } errno = ENOBUFS;
+    return -1;
 }
 
 STRLIB_API(char8_t*)
@@ -960,7 +2714,7 @@ Utf8StringPrevCodepoint
     if (bufitr) {
         char8_t   *p;
         uint32_t   n = 0;
-        if ((*bufitr & 0x80) == 0) { /* bufitr points at the start of a codepoint */
+        if ((*bufitr & 0xC0) != 0x80) { /* bufitr points at the start of a codepoint */
             p = (char8_t*)(bufitr - 1);
         } else { /* bufitr points within a codepoint */
             p = (char8_t*)(bufitr);
@@ -1141,8 +2895,7 @@ Base64Encode
     size_t               ins = num_src;
     uint8_t const       *inp =(uint8_t const*) src;
     char                *out =(char         *) dst;
-    uint8_t           buf[4] ={ 0x00, 0x00, 0x00, 0x00 };
-    char const        B64[ ] ="ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+    size_t              done = 0;
 
     if (src == NULL || num_src == 0) { /* no input data */
         if (o_numdst) {
@@ -1163,26 +2916,16 @@ Base64Encode
         errno = ENOBUFS;
         return -1;
     }
-    while (ins > 3) {
-        /* process input three bytes at a time.
-         * buf[0] = left  6 bits of inp[0].
-         * buf[1] = right 2 bits of inp[0], left 4 bits if inp[1].
-         * buf[2] = right 4 bits of inp[1], left 2 bits of inp[2].
-         * buf[3] = right 6 bits of inp[2]. 
-         * produce four output bytes at a time. */
-        buf[0] = (uint8_t)  ((inp[0] & 0xFC) >> 2);
-        buf[1] = (uint8_t) (((inp[0] & 0x03) << 4) + ((inp[1] & 0xF0) >> 4));
-        buf[2] = (uint8_t) (((inp[1] & 0x0F) << 2) + ((inp[2] & 0xC0) >> 6));
-        buf[3] = (uint8_t)   (inp[2] & 0x3F);
-       *out++  = B64[buf[0]];
-       *out++  = B64[buf[1]];
-       *out++  = B64[buf[2]];
-       *out++  = B64[buf[2]];
-        inp   += 3; ins -= 3;
-    }
+    /* encode every complete group of three bytes with the selected kernel */
+    Base64EnsureKernel();
+    done  = Global_Base64Encode(out, inp, ins);
+    out  += (done / 3) * 4;
+    inp  += done;
+    ins  -= done;
     if (ins > 0) {
         /* pad any remaining input (either 1 or 2 bytes) to three bytes */
         uint8_t  s[3];
+        char     e[4];
         size_t      i;
         for (i = 0; i < ins; ++i) { /* copy remaining data from source buffer */
             s[i] = *inp++;
@@ -1190,17 +2933,11 @@ Base64Encode
         for (     ; i != 3; ++i) { /* set pad bytes to nul */
             s[i] = 0;
         }
-        buf[0] = (uint8_t)  ((s[0] & 0xFC) >> 2);
-        buf[1] = (uint8_t) (((s[0] & 0x03) << 4) + ((s[1] & 0xF0) >> 4));
-        buf[2] = (uint8_t) (((s[1] & 0x0F) << 2) + ((s[2] & 0xC0) >> 6));
-        buf[3] = (uint8_t)   (s[2] & 0x3F);
-       *out++  = B64[buf[0]];
-       *out++  = B64[buf[1]];
-       *out++  = B64[buf[2]];
-       *out++  = B64[buf[2]];
-        for (out += 1 + ins; ins++ != 3; ) {
-            *out++ = '=';
-        }
+        (void) Base64Encode_Scalar(e, s, 3);
+       *out++  = e[0];
+       *out++  = e[1];
+       *out++  =(ins == 2) ? e[2] : '=';
+       *out++  = '=';
     }
     /* nul-terminate the destination buffer */
     *out++ = 0;
@@ -1226,55 +2963,11 @@ Base64Decode
     size_t              cur = 0;
     size_t              pad = 0;
     size_t        req_bytes = 0;
+    size_t             done = 0;
     signed char      idx[4];
     signed char         chi;
     char                 ch;
 
-    /* a lookup table to map the 256 possible byte values to a value in [0, 63] 
-     * or -1 if the value is not valid in a base64-encoded input stream. 
-     */
-    signed char const B64[ ] = {
-        -1, -1, -1, -1, -1, -1, -1, -1,
-        -1, -1, -1, -1, -1, -1, -1, -1,
-        -1, -1, -1, -1, -1, -1, -1, -1,
-        -1, -1, -1, -1, -1, -1, -1, -1,
-
-        -1, -1, -1, -1, -1, -1, -1, -1,
-        -1, -1, -1, 62, -1, -1, -1, 63,  /* ... , '+', ... '/' */
-        52, 53, 54, 55, 56, 57, 58, 59,  /* '0' - '7'          */
-        60, 61, -1, -1, -1, -1, -1, -1,  /* '8', '9', ...      */
-
-        -1, 0,  1,  2,  3,  4,  5,  6,   /* ..., 'A' - 'G'     */
-         7, 8,  9,  10, 11, 12, 13, 14,  /* 'H' - 'O'          */
-        15, 16, 17, 18, 19, 20, 21, 22,  /* 'P' - 'W'          */
-        23, 24, 25, -1, -1, -1, -1, -1,  /* 'X', 'Y', 'Z', ... */
-
-        -1, 26, 27, 28, 29, 30, 31, 32,  /* ..., 'a' - 'g'     */
-        33, 34, 35, 36, 37, 38, 39, 40,  /* 'h' - 'o'          */
-        41, 42, 43, 44, 45, 46, 47, 48,  /* 'p' - 'w'          */
-        49, 50, 51, -1, -1, -1, -1, -1,  /* 'x', 'y', 'z', ... */
-
-        -1, -1, -1, -1, -1, -1, -1, -1,
-        -1, -1, -1, -1, -1, -1, -1, -1,
-        -1, -1, -1, -1, -1, -1, -1, -1,
-        -1, -1, -1, -1, -1, -1, -1, -1,
-
-        -1, -1, -1, -1, -1, -1, -1, -1,
-        -1, -1, -1, -1, -1, -1, -1, -1,
-        -1, -1, -1, -1, -1, -1, -1, -1,
-        -1, -1, -1, -1, -1, -1, -1, -1,
-
-        -1, -1, -1, -1, -1, -1, -1, -1,
-        -1, -1, -1, -1, -1, -1, -1, -1,
-        -1, -1, -1, -1, -1, -1, -1, -1,
-        -1, -1, -1, -1, -1, -1, -1, -1,
-
-        -1, -1, -1, -1, -1, -1, -1, -1,
-        -1, -1, -1, -1, -1, -1, -1, -1,
-        -1, -1, -1, -1, -1, -1, -1, -1,
-        -1, -1, -1, -1, -1, -1, -1, -1
-    };
-
     if (src == NULL) { /* no input data */
         if (o_numdst) {
            *o_numdst = 0;
@@ -1301,9 +2994,15 @@ Base64Decode
         } errno = ENOBUFS;
         return -1;
     }
+    /* decode the leading run of complete, unpadded groups with the selected kernel.
+     * the scalar loop below handles padding, trailing data and error reporting. */
+    Base64EnsureKernel();
+    done = Global_Base64Decode(out, max_dst, inp, num_src);
+    out += (done / 4) * 3;
+    inp +=  done;
     while (inp != end) {
         if ((ch = *inp++) != '=') {
-            if ((chi =B64[(unsigned)ch]) != -1) { /* valid base64 input character */
+            if ((chi =BASE64_DECODE_TABLE[(unsigned char)ch]) != -1) { /* valid base64 input character */
                 idx[cur++] = chi;
             } else {
                 if (o_numdst) {
@@ -1332,3 +3031,199 @@ Base64Decode
     return 0;
 }
 
+STRLIB_API(int)
+Base64SelectKernel
+(
+    uint32_t kernel
+)
+{
+    BASE64_ENCODE_FUNC enc = NULL;
+    BASE64_DECODE_FUNC dec = NULL;
+    if (Base64Kernel(&enc, &dec, kernel) != 0) {
+        errno = ENOTSUP;
+        return -1;
+    }
+    Global_Base64Encode = enc;
+    Global_Base64Decode = dec;
+    return 0;
+}
+
+STRLIB_API(char const*)
+Base64KernelName
+(
+    uint32_t kernel
+)
+{
+    switch (kernel) {
+        case BASE64_KERNEL_SCALAR: return "scalar";
+        case BASE64_KERNEL_SSSE3 : return "ssse3";
+        case BASE64_KERNEL_AVX2  : return "avx2";
+        default                  : return "unknown";
+    }
+}
+
+STRLIB_API(void)
+Base64StreamInit
+(
+    struct BASE64_STREAM *stream
+)
+{
+    memset(stream, 0, sizeof(BASE64_STREAM));
+}
+
+STRLIB_API(int)
+Base64EncodeStreamUpdate
+(
+    struct BASE64_STREAM   *stream,
+    size_t     * __restrict o_numdst,
+    void       * __restrict      dst,
+    size_t                   max_dst,
+    void const * __restrict      src,
+    size_t                   num_src
+)
+{
+    uint8_t const *inp = (uint8_t const*) src;
+    char          *out = (char         *) dst;
+    size_t   req_bytes = ((stream->CarryCount + num_src) / 3) * 4;
+    size_t        done = 0;
+
+    if (dst == NULL && max_dst == 0) {
+        if (o_numdst) {
+           *o_numdst = req_bytes;
+        } return 0;
+    }
+    if (req_bytes > max_dst) {
+        if (o_numdst) {
+           *o_numdst = 0;
+        } errno = ENOBUFS;
+        return -1;
+    }
+    if (stream->CarryCount > 0) { /* complete the group carried from the previous chunk */
+        while (stream->CarryCount < 3 && num_src > 0) {
+            stream->Carry[stream->CarryCount++] = *inp++;
+            num_src--;
+        }
+        if (stream->CarryCount < 3) {
+            if (o_numdst) {
+               *o_numdst = 0;
+            } return 0;
+        }
+        out += (Base64Encode_Scalar(out, stream->Carry, 3) / 3) * 4;
+        stream->CarryCount = 0;
+    }
+    Base64EnsureKernel();
+    done = Global_Base64Encode(out, inp, num_src);
+    out += (done / 3) * 4;
+    while (done < num_src) {
+        stream->Carry[stream->CarryCount++] = inp[done++];
+    }
+    if (o_numdst) {
+       *o_numdst = (size_t)(out - (char*) dst);
+    }
+    return 0;
+}
+
+STRLIB_API(int)
+Base64EncodeStreamFinal
+(
+    struct BASE64_STREAM *stream,
+    size_t             *o_numdst,
+    void                    *dst,
+    size_t               max_dst
+)
+{
+    char *out = (char*) dst;
+    if (stream->CarryCount > 0) {
+        uint8_t s[3] = { 0, 0, 0 };
+        char    e[4];
+        if (max_dst < 4) {
+            if (o_numdst) {
+               *o_numdst = 0;
+            } errno = ENOBUFS;
+            return -1;
+        }
+        memcpy(s, stream->Carry, stream->CarryCount);
+        (void) Base64Encode_Scalar(e, s, 3);
+        out[0] = e[0];
+        out[1] = e[1];
+        out[2] =(stream->CarryCount == 2) ? e[2] : '=';
+        out[3] = '=';
+        out   += 4;
+    }
+    Base64StreamInit(stream);
+    if (o_numdst) {
+       *o_numdst = (size_t)(out - (char*) dst);
+    }
+    return 0;
+}
+
+STRLIB_API(int)
+Base64DecodeStreamUpdate
+(
+    struct BASE64_STREAM   *stream,
+    size_t     * __restrict o_numdst,
+    void       * __restrict      dst,
+    size_t                   max_dst,
+    void const * __restrict      src,
+    size_t                   num_src
+)
+{
+    char const    *inp = (char const*) src;
+    char const    *end = (char const*) src + num_src;
+    uint8_t       *out = (uint8_t   *) dst;
+    size_t   req_bytes = ((stream->CarryCount + num_src) / 4) * 3;
+    size_t           n = 0;
+
+    if (dst == NULL && max_dst == 0) {
+        if (o_numdst) {
+           *o_numdst = req_bytes;
+        } return 0;
+    }
+    if (req_bytes > max_dst) {
+        if (o_numdst) {
+           *o_numdst = 0;
+        } errno = ENOBUFS;
+        return -1;
+    }
+    while (inp != end && stream->CarryCount > 0) { /* complete the group carried from the previous chunk */
+        if (Base64StreamPushChar(stream, &n, out, *inp++) != 0) {
+            goto error_invalid;
+        } out += n;
+    }
+    if (!stream->Finished) {
+        size_t done;
+        Base64EnsureKernel();
+        done = Global_Base64Decode(out, max_dst - (size_t)(out - (uint8_t*) dst), inp, (size_t)(end - inp));
+        out += (done / 4) * 3;
+        inp +=  done;
+    }
+    while (inp != end) {
+        if (Base64StreamPushChar(stream, &n, out, *inp++) != 0) {
+            goto error_invalid;
+        } out += n;
+    }
+    if (o_numdst) {
+       *o_numdst = (size_t)(out - (uint8_t*) dst);
+    }
+    return 0;
+
+error_invalid:
+    if (o_numdst) {
+       *o_numdst = (size_t)(out - (uint8_t*) dst);
+    } errno = EILSEQ;
+    return -1;
+}
+
+STRLIB_API(int)
+Base64DecodeStreamFinal
+(
+    struct BASE64_STREAM *stream
+)
+{
+    if (stream->CarryCount != 0) {
+        errno = EILSEQ;
+        return -1;
+    }
+    Base64StreamInit(stream);
+    return 0;
+}
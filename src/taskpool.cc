@@ -0,0 +1,414 @@
+/**
+ * @summary Implement the functions exported by the taskpool.h module.
+ * Ranges are stored in fixed-capacity Chase-Lev deques; the owning thread
+ * pushes and pops at the bottom while thieves take from the top. Threads and
+ * the sleep/wake protocol use the C++11 standard library so that the same
+ * implementation serves every platform.
+ */
+#if !defined(_WIN32) && !defined(_GNU_SOURCE)
+#define _GNU_SOURCE /* libstdc++ <mutex> and <condition_variable> use glibc extensions */
+#endif
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+
+#include <new>
+#include <atomic>
+#include <mutex>
+#include <thread>
+#include <condition_variable>
+
+#include "cpuinfo.h"
+#include "taskpool.h"
+
+#if CPU_ARCH_X86
+#include <immintrin.h>
+#define TaskPoolSpinPause()           _mm_pause()
+#else
+#define TaskPoolSpinPause()
+#endif
+
+/* @summary Define the number of failed steal attempts after which an idle thread yields its time slice.
+ */
+#ifndef TASK_POOL_SPIN_COUNT
+#define TASK_POOL_SPIN_COUNT          64
+#endif
+
+/* @summary Round a value up to the next multiple of a power of two.
+ * @param _value The value to round.
+ * @param _pow2 The power-of-two multiple.
+ * @return The smallest multiple of _pow2 that is greater than or equal to _value.
+ */
+#ifndef AlignUp
+#define AlignUp(_value, _pow2)                                                 \
+    (((_value) + ((_pow2) - 1)) & ~((_pow2) - 1))
+#endif
+
+/* @summary Pack a range of loop indices into a single deque entry.
+ */
+#define TaskRangePack(_begin, _end)                                            \
+    ((((uint64_t)(_begin)) << 32) | ((uint64_t)(_end)))
+
+/* @summary Define a fixed-capacity work-stealing deque of packed index ranges.
+ * Top and Bottom are kept on separate cache lines so that thieves do not contend with the owner.
+ */
+struct TASK_DEQUE {
+    std::atomic<int64_t>         Top;                                          /* The index of the oldest entry. Advanced by thieves, and by the owner when taking the last entry. */
+    char                         Pad0[64 - sizeof(std::atomic<int64_t>)];
+    std::atomic<int64_t>         Bottom;                                       /* One past the index of the newest entry. Written only by the owner. */
+    char                         Pad1[64 - sizeof(std::atomic<int64_t>)];
+    std::atomic<uint64_t>        Items[TASK_POOL_DEQUE_CAPACITY];              /* The packed ranges, indexed modulo the capacity. */
+};
+
+/* @summary Define the state of a task pool.
+ */
+struct TASK_POOL {
+    TASK_DEQUE                  *Deques;                                       /* One 64-byte aligned deque per thread; index zero belongs to the submitting thread. */
+    void                        *DequeMemory;                                  /* The allocation backing Deques. */
+    std::thread                 *Threads;                                      /* The ThreadCount - 1 worker threads. */
+    uint32_t                     ThreadCount;                                  /* The number of threads that execute work, including the submitting thread. */
+    uint32_t                     Flags;                                        /* The TASK_POOL_FLAGS supplied at creation time. */
+    std::mutex                   SubmitLock;                                   /* Serializes calls to TaskPoolParallelFor. */
+    std::mutex                   WakeLock;                                     /* Protects the transitions of Active and Stop observed by sleeping workers. */
+    std::condition_variable      WakeCond;                                     /* Signaled when a loop is submitted or the pool is stopping. */
+    std::atomic<int>             Active;                                       /* Non-zero while a loop is executing. */
+    std::atomic<int>             Stop;                                         /* Non-zero when the pool is being deleted. */
+    std::atomic<uint32_t>        Remaining;                                    /* The number of loop indices not yet processed. */
+    TASK_RANGE_FUNC              Func;                                         /* The function for the current loop. */
+    void                        *Argp;                                         /* The argument for the current loop. */
+    uint32_t                     Grain;                                        /* The split threshold for the current loop. */
+};
+
+/* @summary Identify the pool and thread index of the calling thread while it is executing pool work.
+ * Used to run nested loops inline rather than deadlocking on SubmitLock.
+ */
+static thread_local TASK_POOL *Tls_TaskPool       = NULL;
+static thread_local uint32_t   Tls_TaskPoolThread = 0;
+
+/* @summary Push a range onto the bottom of a deque. May only be called by the owning thread.
+ * @param dq The deque.
+ * @param item The packed range.
+ * @return true if the range was pushed, or false if the deque is full.
+ */
+static bool
+TaskDequePush
+(
+    TASK_DEQUE *dq,
+    uint64_t  item
+)
+{
+    int64_t b = dq->Bottom.load(std::memory_order_relaxed);
+    int64_t t = dq->Top.load(std::memory_order_acquire);
+    if (b - t >= TASK_POOL_DEQUE_CAPACITY) {
+        return false;
+    }
+    dq->Items[b & (TASK_POOL_DEQUE_CAPACITY - 1)].store(item, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    dq->Bottom.store(b + 1, std::memory_order_relaxed);
+    return true;
+}
+
+/* @summary Pop the newest range from the bottom of a deque. May only be called by the owning thread.
+ * @param dq The deque.
+ * @param o_item On return, set to the packed range if one was popped.
+ * @return true if a range was popped, or false if the deque is empty or a thief took the last entry.
+ */
+static bool
+TaskDequePop
+(
+    TASK_DEQUE *dq,
+    uint64_t *o_item
+)
+{
+    int64_t b = dq->Bottom.load(std::memory_order_relaxed) - 1;
+    int64_t t;
+    bool   ok = true;
+
+    dq->Bottom.store(b, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    t = dq->Top.load(std::memory_order_relaxed);
+    if (t > b) {
+        dq->Bottom.store(b + 1, std::memory_order_relaxed);
+        return false;
+    }
+    *o_item = dq->Items[b & (TASK_POOL_DEQUE_CAPACITY - 1)].load(std::memory_order_relaxed);
+    if (t == b) {
+        /* last entry; race against thieves for it */
+        ok = dq->Top.compare_exchange_strong(t, t + 1, std::memory_order_seq_cst, std::memory_order_relaxed);
+        dq->Bottom.store(b + 1, std::memory_order_relaxed);
+    }
+    return ok;
+}
+
+/* @summary Steal the oldest range from the top of a deque. May be called by any thread.
+ * @param dq The deque.
+ * @param o_item On return, set to the packed range if one was stolen.
+ * @return true if a range was stolen, or false if the deque is empty or another thread won the race.
+ */
+static bool
+TaskDequeSteal
+(
+    TASK_DEQUE *dq,
+    uint64_t *o_item
+)
+{
+    int64_t t = dq->Top.load(std::memory_order_acquire);
+    int64_t b;
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    b = dq->Bottom.load(std::memory_order_acquire);
+    if (t >= b) {
+        return false;
+    }
+    *o_item = dq->Items[t & (TASK_POOL_DEQUE_CAPACITY - 1)].load(std::memory_order_relaxed);
+    return dq->Top.compare_exchange_strong(t, t + 1, std::memory_order_seq_cst, std::memory_order_relaxed);
+}
+
+/* @summary Process a range of loop indices, splitting off the upper half onto the thread's deque until the range is no larger than the grain.
+ * @param pool The pool executing the loop.
+ * @param thread_index The index of the calling thread.
+ * @param begin The first index in the range.
+ * @param end One past the last index in the range.
+ */
+static void
+TaskPoolRunRange
+(
+    TASK_POOL      *pool,
+    uint32_t thread_index,
+    uint32_t        begin,
+    uint32_t          end
+)
+{
+    TASK_DEQUE *dq = &pool->Deques[thread_index];
+    while (end - begin > pool->Grain) {
+        uint32_t mid = begin + ((end - begin) / 2);
+        if (!TaskDequePush(dq, TaskRangePack(mid, end))) {
+            break;
+        }
+        end = mid;
+    }
+    pool->Func(pool->Argp, begin, end, thread_index);
+    pool->Remaining.fetch_sub(end - begin, std::memory_order_acq_rel);
+}
+
+/* @summary Find and process one range, first from the calling thread's own deque and then by stealing from another thread.
+ * @param pool The pool executing the loop.
+ * @param thread_index The index of the calling thread.
+ * @param rng The state of the calling thread's victim selection random number generator.
+ * @return true if a range was processed, or false if no work was found.
+ */
+static bool
+TaskPoolRunOne
+(
+    TASK_POOL      *pool,
+    uint32_t thread_index,
+    uint32_t         *rng
+)
+{
+    uint64_t item;
+    uint32_t    n = pool->ThreadCount;
+    uint32_t    i;
+
+    if (TaskDequePop(&pool->Deques[thread_index], &item)) {
+        TaskPoolRunRange(pool, thread_index, (uint32_t)(item >> 32), (uint32_t) item);
+        return true;
+    }
+    /* start at a random victim so that thieves spread out */
+    *rng ^= *rng << 13;
+    *rng ^= *rng >> 17;
+    *rng ^= *rng << 5;
+    for (i = 0; i < n; ++i) {
+        uint32_t victim = (*rng + i) % n;
+        if (victim != thread_index && TaskDequeSteal(&pool->Deques[victim], &item)) {
+            TaskPoolRunRange(pool, thread_index, (uint32_t)(item >> 32), (uint32_t) item);
+            return true;
+        }
+    }
+    return false;
+}
+
+/* @summary Implement the entry point of a worker thread.
+ * @param pool The pool that owns the thread.
+ * @param thread_index The index of the thread, in [1, ThreadCount).
+ */
+static void
+TaskPoolWorkerMain
+(
+    TASK_POOL      *pool,
+    uint32_t thread_index
+)
+{
+    uint32_t rng = 0x9E3779B9U * (thread_index + 1);
+
+    if (pool->Flags & TASK_POOL_FLAG_PIN_THREADS) {
+        (void) CpuPinCurrentThread(thread_index);
+    }
+    Tls_TaskPool       = pool;
+    Tls_TaskPoolThread = thread_index;
+    for ( ; ; ) {
+        uint32_t spin = 0;
+        {
+            std::unique_lock<std::mutex> lock(pool->WakeLock);
+            while (!pool->Stop.load(std::memory_order_relaxed) && !pool->Active.load(std::memory_order_relaxed)) {
+                pool->WakeCond.wait(lock);
+            }
+            if (pool->Stop.load(std::memory_order_relaxed)) {
+                break;
+            }
+        }
+        /* keep looking for work until the loop completes; new ranges appear as other threads split theirs */
+        while (pool->Active.load(std::memory_order_acquire)) {
+            if (TaskPoolRunOne(pool, thread_index, &rng)) {
+                spin = 0;
+            } else if (++spin < TASK_POOL_SPIN_COUNT) {
+                TaskPoolSpinPause();
+            } else {
+                std::this_thread::yield();
+            }
+        }
+    }
+}
+
+MNIST_API(int)
+TaskPoolCreate
+(
+    struct TASK_POOL          **o_pool,
+    struct TASK_POOL_INIT const *init
+)
+{
+    TASK_POOL *pool = NULL;
+    uint32_t nthread;
+    uint32_t       i;
+
+    *o_pool = NULL;
+    nthread = (init != NULL && init->ThreadCount != 0) ? init->ThreadCount : CpuLogicalCount();
+    if (nthread > TASK_POOL_MAX_THREADS) {
+        nthread = TASK_POOL_MAX_THREADS;
+    }
+    if ((pool = new (std::nothrow) TASK_POOL) == NULL) {
+        errno = ENOMEM;
+        return -1;
+    }
+    if ((pool->DequeMemory = malloc((nthread * sizeof(TASK_DEQUE)) + 64)) == NULL) {
+        delete pool;
+        errno = ENOMEM;
+        return -1;
+    }
+    memset(pool->DequeMemory, 0, (nthread * sizeof(TASK_DEQUE)) + 64);
+    pool->Deques = (TASK_DEQUE*) AlignUp((uintptr_t) pool->DequeMemory, (uintptr_t) 64);
+    for (i = 0; i < nthread; ++i) {
+        pool->Deques[i].Top.store(0, std::memory_order_relaxed);
+        pool->Deques[i].Bottom.store(0, std::memory_order_relaxed);
+    }
+    pool->ThreadCount = nthread;
+    pool->Flags       = init != NULL ? init->Flags : (uint32_t) TASK_POOL_FLAGS_NONE;
+    pool->Func        = NULL;
+    pool->Argp        = NULL;
+    pool->Grain       = 1;
+    pool->Active.store(0);
+    pool->Stop.store(0);
+    pool->Remaining.store(0);
+    pool->Threads     = NULL;
+    if (nthread > 1) {
+        if ((pool->Threads = (std::thread*) malloc((nthread - 1) * sizeof(std::thread))) == NULL) {
+            free(pool->DequeMemory);
+            delete pool;
+            errno = ENOMEM;
+            return -1;
+        }
+        for (i = 1; i < nthread; ++i) {
+            try {
+                new (&pool->Threads[i - 1]) std::thread(TaskPoolWorkerMain, pool, i);
+            } catch (...) {
+                /* stop and join the threads started so far */
+                pool->ThreadCount = i;
+                TaskPoolDelete(pool);
+                errno = EAGAIN;
+                return -1;
+            }
+        }
+    }
+    *o_pool = pool;
+    return 0;
+}
+
+MNIST_API(void)
+TaskPoolDelete
+(
+    struct TASK_POOL *pool
+)
+{
+    uint32_t i;
+    if (pool != NULL) {
+        {
+            std::lock_guard<std::mutex> lock(pool->WakeLock);
+            pool->Stop.store(1);
+        }
+        pool->WakeCond.notify_all();
+        for (i = 1; i < pool->ThreadCount; ++i) {
+            pool->Threads[i - 1].join();
+            pool->Threads[i - 1].~thread();
+        }
+        free(pool->Threads);
+        free(pool->DequeMemory);
+        delete pool;
+    }
+}
+
+MNIST_API(uint32_t)
+TaskPoolThreadCount
+(
+    struct TASK_POOL const *pool
+)
+{
+    return pool != NULL ? pool->ThreadCount : 1;
+}
+
+MNIST_API(void)
+TaskPoolParallelFor
+(
+    struct TASK_POOL *pool,
+    uint32_t         count,
+    uint32_t         grain,
+    TASK_RANGE_FUNC   func,
+    void             *argp
+)
+{
+    uint32_t rng = 0x2545F491U;
+
+    if (count == 0) {
+        return;
+    }
+    if (grain == 0) {
+        grain = 1;
+    }
+    if (pool == NULL || pool->ThreadCount == 1 || count <= grain || Tls_TaskPool == pool) {
+        func(argp, 0, count, Tls_TaskPool == pool ? Tls_TaskPoolThread : 0);
+        return;
+    }
+
+    std::lock_guard<std::mutex> submit(pool->SubmitLock);
+    pool->Func  = func;
+    pool->Argp  = argp;
+    pool->Grain = grain;
+    pool->Remaining.store(count, std::memory_order_relaxed);
+    {
+        std::lock_guard<std::mutex> lock(pool->WakeLock);
+        pool->Active.store(1, std::memory_order_release);
+    }
+    pool->WakeCond.notify_all();
+
+    Tls_TaskPool       = pool;
+    Tls_TaskPoolThread = 0;
+    TaskPoolRunRange(pool, 0, 0, count);
+    while (pool->Remaining.load(std::memory_order_acquire) != 0) {
+        if (!TaskPoolRunOne(pool, 0, &rng)) {
+            TaskPoolSpinPause();
+        }
+    }
+    Tls_TaskPool = NULL;
+    pool->Active.store(0, std::memory_order_release);
+}
+
@@ -0,0 +1,71 @@
+/**
+ * @summary Implement the functions exported by the arena.h module for Windows
+ * using VirtualAlloc, with MEM_LARGE_PAGES where the process holds the
+ * SeLockMemoryPrivilege.
+ */
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+#include <errno.h>
+#include <Windows.h>
+
+#include "arena.h"
+
+MNIST_API(int)
+ArenaCreate
+(
+    struct MEMORY_ARENA *o_arena,
+    size_t              capacity,
+    uint32_t               flags
+)
+{
+    SYSTEM_INFO  sysinfo;
+    size_t     page_size;
+    size_t    large_size = GetLargePageMinimum();
+    void           *base = NULL;
+
+    memset(o_arena, 0, sizeof(MEMORY_ARENA));
+    GetSystemInfo(&sysinfo);
+    page_size = sysinfo.dwPageSize;
+
+    if (capacity == 0) {
+        errno = EINVAL;
+        return -1;
+    }
+    if ((flags & ARENA_FLAG_HUGE_PAGES) && large_size != 0) {
+        /* large pages are committed and locked up front; this fails without SeLockMemoryPrivilege */
+        size_t size = (capacity + large_size - 1) & ~(large_size - 1);
+        if ((base = VirtualAlloc(NULL, size, MEM_RESERVE | MEM_COMMIT | MEM_LARGE_PAGES, PAGE_READWRITE)) != NULL) {
+            o_arena->Capacity = size;
+            o_arena->PageSize = large_size;
+            flags |= ARENA_FLAG_LOCKED_PAGES;
+        }
+    }
+    if (base == NULL) {
+        size_t size = (capacity + page_size - 1) & ~(page_size - 1);
+        if ((base = VirtualAlloc(NULL, size, MEM_RESERVE | MEM_COMMIT, PAGE_READWRITE)) == NULL) {
+            errno = ENOMEM;
+            return -1;
+        }
+        o_arena->Capacity = size;
+        o_arena->PageSize = page_size;
+        flags &= ~(uint32_t) ARENA_FLAG_LOCKED_PAGES;
+    }
+    o_arena->BaseAddress = (uint8_t*) base;
+    o_arena->Flags       = flags;
+    return 0;
+}
+
+MNIST_API(void)
+ArenaDelete
+(
+    struct MEMORY_ARENA *arena
+)
+{
+    if (arena != NULL) {
+        if (arena->BaseAddress != NULL) {
+            VirtualFree(arena->BaseAddress, 0, MEM_RELEASE);
+        }
+        memset(arena, 0, sizeof(MEMORY_ARENA));
+    }
+}
@@ -0,0 +1,60 @@
+/**
+ * @summary Implement the processor count and thread affinity functions
+ * exported by the cpuinfo.h module for Windows.
+ */
+#include <stddef.h>
+#include <stdint.h>
+#include <errno.h>
+#include <Windows.h>
+
+#include "cpuinfo.h"
+
+MNIST_API(uint32_t)
+CpuLogicalCount
+(
+    void
+)
+{
+    DWORD_PTR process_mask = 0;
+    DWORD_PTR  system_mask = 0;
+    uint32_t         count = 0;
+
+    /* only the processor group of the calling process is considered */
+    if (GetProcessAffinityMask(GetCurrentProcess(), &process_mask, &system_mask)) {
+        while (process_mask != 0) {
+            count += (uint32_t)(process_mask & 1);
+            process_mask >>= 1;
+        }
+    }
+    return count > 0 ? count : 1;
+}
+
+MNIST_API(int)
+CpuPinCurrentThread
+(
+    uint32_t cpu_index
+)
+{
+    DWORD_PTR process_mask = 0;
+    DWORD_PTR  system_mask = 0;
+    DWORD_PTR          bit = 1;
+    uint32_t         count = CpuLogicalCount();
+    uint32_t           nth = cpu_index % count;
+
+    if (!GetProcessAffinityMask(GetCurrentProcess(), &process_mask, &system_mask)) {
+        errno = EINVAL;
+        return -1;
+    }
+    /* map the index onto the nth processor in the process affinity mask */
+    for (bit = 1; bit != 0; bit <<= 1) {
+        if ((process_mask & bit) != 0 && nth-- == 0) {
+            break;
+        }
+    }
+    if (bit == 0 || SetThreadAffinityMask(GetCurrentThread(), bit) == 0) {
+        errno = EINVAL;
+        return -1;
+    }
+    return 0;
+}
+
@@ -0,0 +1,258 @@
+/**
+ * @summary Implement the functions exported by the data.h module for Windows.
+ * The executable path is retrieved with GetModuleFileNameW, and the table of
+ * absolute paths is filled exactly once using InitOnceExecuteOnce.
+ */
+#include <stddef.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <Windows.h>
+
+#include "strlib.h"
+#include "pathlib.h"
+#include "data.h"
+
+/* @summary Define the indices of the default data files within DATA_PATH_TABLE.
+ */
+typedef enum DATA_PATH_INDEX {
+    DATA_PATH_TRAINING_IMAGES    = 0,                                          /* The training set images. */
+    DATA_PATH_TRAINING_LABELS    = 1,                                          /* The training set labels. */
+    DATA_PATH_TEST_IMAGES        = 2,                                          /* The test set images. */
+    DATA_PATH_TEST_LABELS        = 3,                                          /* The test set labels. */
+    DATA_PATH_COUNT              = 4,                                          /* The number of default data files. */
+} DATA_PATH_INDEX;
+
+/* @summary Define the table of absolute paths to the default data files. The table is written once, by ResolveDataPaths, and only read afterwards.
+ */
+typedef struct DATA_PATH_TABLE {
+    char8_t                      Storage[DATA_PATH_COUNT][PATH_BUFFER_MAX_BYTES]; /* The nul-terminated absolute paths. */
+    STRING_INFO                  Info[DATA_PATH_COUNT];                        /* The attributes of each path string. */
+    int                          Error;                                        /* The errno value describing why the paths could not be resolved, or zero. */
+} DATA_PATH_TABLE;
+
+/* @summary The paths to the default data files, relative to the directory containing the executable. Each starts with DATA_DIRECTORY_DEFAULT and a separator.
+ */
+static char const * const DATA_PATH_RELATIVE[DATA_PATH_COUNT] = {
+    DATA_DIRECTORY_DEFAULT "\\train\\train-images-idx3-ubyte",
+    DATA_DIRECTORY_DEFAULT "\\train\\train-labels-idx1-ubyte",
+    DATA_DIRECTORY_DEFAULT "\\test\\t10k-images-idx3-ubyte",
+    DATA_DIRECTORY_DEFAULT "\\test\\t10k-labels-idx1-ubyte"
+};
+
+static DATA_PATH_TABLE Global_DataPaths;
+static INIT_ONCE       Global_DataPathsOnce = INIT_ONCE_STATIC_INIT;
+
+/* @summary Convert a nul-terminated UTF-16 string returned by the host into a path buffer.
+ * @return Zero if the string was converted, or -1 if it does not fit.
+ */
+static int
+CopyHostPath
+(
+    char8_t       *buf,
+    WCHAR const *wpath
+)
+{
+    if (WideCharToMultiByte(CP_UTF8, 0, wpath, -1, buf, PATH_BUFFER_MAX_BYTES, NULL, NULL) == 0) {
+        errno = ENAMETOOLONG;
+        return -1;
+    }
+    return 0;
+}
+
+/* @summary Resolve the data directory and fill Global_DataPaths. Called exactly once, through InitOnceExecuteOnce.
+ */
+static BOOL CALLBACK
+ResolveDataPaths
+(
+    PINIT_ONCE once,
+    PVOID      argp,
+    PVOID   *context
+)
+{
+    WCHAR       wpath[PATH_BUFFER_MAX_BYTES];
+    char8_t      root[PATH_BUFFER_MAX_BYTES];
+    char8_t       env[PATH_BUFFER_MAX_BYTES];
+    STRING_INFO rinfo;
+    DWORD           n = GetEnvironmentVariableW(L"" DATA_DIRECTORY_ENVIRONMENT_VARIABLE, wpath, PATH_BUFFER_MAX_BYTES);
+    uint32_t        i;
+
+    (void) once; (void) argp; (void) context;
+
+    if (n > 0 && n < PATH_BUFFER_MAX_BYTES) {
+        /* a relative override is resolved against the working directory */
+        if (CopyHostPath(env, wpath) != 0) {
+            goto cleanup_and_fail;
+        }
+        root[0] = 0;
+        if (!(env[0] == '\\' || env[0] == '/' || (env[0] != 0 && env[1] == ':'))) {
+            n = GetCurrentDirectoryW(PATH_BUFFER_MAX_BYTES, wpath);
+            if (n == 0 || n >= PATH_BUFFER_MAX_BYTES || CopyHostPath(root, wpath) != 0) {
+                errno = ENAMETOOLONG;
+                goto cleanup_and_fail;
+            }
+        }
+        if (Win32PathBufferAppend(&rinfo, NULL, NULL, root, env) == NULL) {
+            goto cleanup_and_fail;
+        }
+    } else {
+        /* the module path is absolute; removing the last component leaves the directory containing the executable */
+        n = GetModuleFileNameW(NULL, wpath, PATH_BUFFER_MAX_BYTES);
+        if (n == 0 || n >= PATH_BUFFER_MAX_BYTES) {
+            errno = ENAMETOOLONG;
+            goto cleanup_and_fail;
+        }
+        if (CopyHostPath(root, wpath) != 0) {
+            goto cleanup_and_fail;
+        }
+        if (Win32PathBufferAppend(&rinfo, NULL , NULL, root, "..") == NULL || Win32PathBufferAppend(&rinfo, &rinfo, NULL, root, DATA_DIRECTORY_DEFAULT) == NULL) {
+            goto cleanup_and_fail;
+        }
+    }
+    for (i = 0; i < DATA_PATH_COUNT; ++i) {
+        char8_t *buf = Global_DataPaths.Storage[i];
+        memcpy(buf, root, rinfo.LengthBytes);
+        if (Win32PathBufferAppend(&Global_DataPaths.Info[i], &rinfo, NULL, buf, DATA_PATH_RELATIVE[i] + sizeof(DATA_DIRECTORY_DEFAULT)) == NULL) {
+            goto cleanup_and_fail;
+        }
+    }
+    Global_DataPaths.Error = 0;
+    return TRUE;
+
+cleanup_and_fail:
+    Global_DataPaths.Error = (errno != 0) ? errno : ENOENT;
+    return TRUE;
+}
+
+/* @summary Retrieve one of the relative paths to the default data files.
+ * @return The nul-terminated relative path.
+ */
+static char const*
+GetRelativeDataPath
+(
+    size_t  *len_chars,
+    size_t  *len_bytes,
+    uint32_t     index
+)
+{
+    char const *path = DATA_PATH_RELATIVE[index];
+    size_t    nbytes = strlen(path);
+
+    /* the relative paths are ASCII */
+    if (len_chars) *len_chars = nbytes;
+    if (len_bytes) *len_bytes = nbytes + 1;
+    return path;
+}
+
+/* @summary Retrieve one of the absolute paths to the default data files, resolving the table on first use.
+ * @return The nul-terminated absolute path, or NULL if the paths could not be resolved.
+ */
+static char const*
+GetAbsoluteDataPath
+(
+    size_t  *len_chars,
+    size_t  *len_bytes,
+    uint32_t     index
+)
+{
+    (void) InitOnceExecuteOnce(&Global_DataPathsOnce, ResolveDataPaths, NULL, NULL);
+    if (Global_DataPaths.Error != 0) {
+        if (len_chars) *len_chars = 0;
+        if (len_bytes) *len_bytes = 0;
+        errno = Global_DataPaths.Error;
+        return NULL;
+    }
+    if (len_chars) *len_chars = Global_DataPaths.Info[index].LengthChars;
+    if (len_bytes) *len_bytes = Global_DataPaths.Info[index].LengthBytes;
+    return Global_DataPaths.Info[index].Buffer;
+}
+
+MNIST_API(size_t)
+GetMaxSystemPathChars
+(
+    void
+)
+{
+    return 32767 - 1; /* the limit for paths with the "\\\\?\\" prefix, including the nul */
+}
+
+MNIST_API(char const*)
+TrainingSetImages_GetDefaultRelativePath
+(
+    size_t *len_chars, 
+    size_t *len_bytes
+)
+{
+    return GetRelativeDataPath(len_chars, len_bytes, DATA_PATH_TRAINING_IMAGES);
+}
+
+MNIST_API(char const*)
+TrainingSetLabels_GetDefaultRelativePath
+(
+    size_t *len_chars, 
+    size_t *len_bytes
+)
+{
+    return GetRelativeDataPath(len_chars, len_bytes, DATA_PATH_TRAINING_LABELS);
+}
+
+MNIST_API(char const*)
+TestSetImages_GetDefaultRelativePath
+(
+    size_t *len_chars, 
+    size_t *len_bytes
+)
+{
+    return GetRelativeDataPath(len_chars, len_bytes, DATA_PATH_TEST_IMAGES);
+}
+
+MNIST_API(char const*)
+TestSetLabels_GetDefaultRelativePath
+(
+    size_t *len_chars, 
+    size_t *len_bytes
+)
+{
+    return GetRelativeDataPath(len_chars, len_bytes, DATA_PATH_TEST_LABELS);
+}
+
+MNIST_API(char const*)
+TrainingSetImages_GetDefaultAbsolutePath
+(
+    size_t *len_chars, 
+    size_t *len_bytes
+)
+{
+    return GetAbsoluteDataPath(len_chars, len_bytes, DATA_PATH_TRAINING_IMAGES);
+}
+
+MNIST_API(char const*)
+TrainingSetLabels_GetDefaultAbsolutePath
+(
+    size_t *len_chars, 
+    size_t *len_bytes
+)
+{
+    return GetAbsoluteDataPath(len_chars, len_bytes, DATA_PATH_TRAINING_LABELS);
+}
+
+MNIST_API(char const*)
+TestSetImages_GetDefaultAbsolutePath
+(
+    size_t *len_chars, 
+    size_t *len_bytes
+)
+{
+    return GetAbsoluteDataPath(len_chars, len_bytes, DATA_PATH_TEST_IMAGES);
+}
+
+MNIST_API(char const*)
+TestSetLabels_GetDefaultAbsolutePath
+(
+    size_t *len_chars, 
+    size_t *len_bytes
+)
+{
+    return GetAbsoluteDataPath(len_chars, len_bytes, DATA_PATH_TEST_LABELS);
+}
@@ -0,0 +1,102 @@
+/**
+ * @summary Implement the functions exported by the filemap.h module for Windows
+ * using CreateFileMapping/MapViewOfFile.
+ */
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+#include <errno.h>
+#include <Windows.h>
+
+#include "filemap.h"
+
+MNIST_API(int)
+FileMappingOpen
+(
+    struct FILE_MAPPING *o_mapping,
+    char const               *path,
+    uint32_t                 hints
+)
+{
+    WCHAR       wpath[MAX_PATH * 4];
+    LARGE_INTEGER   size;
+    FILETIME       mtime;
+    HANDLE          file = INVALID_HANDLE_VALUE;
+    HANDLE       section = NULL;
+    void           *base = NULL;
+    DWORD          flags = FILE_ATTRIBUTE_NORMAL;
+    uint64_t       ticks = 0;
+
+    memset(o_mapping, 0, sizeof(FILE_MAPPING));
+
+    if (path == NULL) {
+        errno = EINVAL;
+        return -1;
+    }
+    if (MultiByteToWideChar(CP_UTF8, 0, path, -1, wpath, (int)(sizeof(wpath) / sizeof(wpath[0]))) == 0) {
+        errno = ENAMETOOLONG;
+        return -1;
+    }
+    if (hints & FILE_MAPPING_HINT_SEQUENTIAL) {
+        flags |= FILE_FLAG_SEQUENTIAL_SCAN;
+    }
+    if (hints & FILE_MAPPING_HINT_RANDOM) {
+        flags |= FILE_FLAG_RANDOM_ACCESS;
+    }
+    if ((file = CreateFileW(wpath, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, flags, NULL)) == INVALID_HANDLE_VALUE) {
+        errno = ENOENT;
+        return -1;
+    }
+    if (!GetFileSizeEx(file, &size) || !GetFileTime(file, NULL, NULL, &mtime)) {
+        errno = EIO;
+        goto cleanup_and_fail;
+    }
+    if ((uint64_t) size.QuadPart > (uint64_t) SIZE_MAX) {
+        errno = EFBIG;
+        goto cleanup_and_fail;
+    }
+    if (size.QuadPart > 0) {
+        if ((section = CreateFileMappingW(file, NULL, PAGE_READONLY, 0, 0, NULL)) == NULL) {
+            errno = ENOMEM;
+            goto cleanup_and_fail;
+        }
+        if ((base = MapViewOfFile(section, FILE_MAP_READ, 0, 0, 0)) == NULL) {
+            errno = ENOMEM;
+            goto cleanup_and_fail;
+        }
+        /* PrefetchVirtualMemory requires Windows 8; WILLNEED and POPULATE are ignored on Windows 7 */
+        /* the view holds its own reference to the section and file */
+        CloseHandle(section);
+    }
+    CloseHandle(file);
+
+    /* FILETIME is in 100ns units since January 1, 1601 */
+    ticks = ((uint64_t) mtime.dwHighDateTime << 32) | (uint64_t) mtime.dwLowDateTime;
+    o_mapping->Base          = base;
+    o_mapping->Size          =(size_t  ) size.QuadPart;
+    o_mapping->FileSize      =(uint64_t) size.QuadPart;
+    o_mapping->LastWriteTime =(ticks - 116444736000000000ULL) * 100ULL;
+    return 0;
+
+cleanup_and_fail:
+    if (section != NULL) {
+        CloseHandle(section);
+    }
+    CloseHandle(file);
+    return -1;
+}
+
+MNIST_API(void)
+FileMappingClose
+(
+    struct FILE_MAPPING *mapping
+)
+{
+    if (mapping != NULL) {
+        if (mapping->Base != NULL) {
+            UnmapViewOfFile(mapping->Base);
+        }
+        memset(mapping, 0, sizeof(FILE_MAPPING));
+    }
+}
+
@@ -0,0 +1,265 @@
+/**
+ * @summary Implement the background minibatch producer exported by the
+ * minibatch.h module for Windows using Win32 threads and condition variables.
+ */
+#include <stddef.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+#include <errno.h>
+#include <Windows.h>
+
+#include "dataset.h"
+#include "datacache.h"
+#include "minibatch.h"
+
+/* @summary Define the state of a background minibatch producer.
+ * Batch buffers move between two lists: the free list (owned by the producer thread) and the ready queue (owned by consumers).
+ * All list state is protected by Lock.
+ */
+struct MINIBATCH_PRODUCER {
+    HANDLE                       Thread;                                       /* The background thread gathering batches. */
+    CRITICAL_SECTION             Lock;                                         /* Protects the free list, ready queue and flags. */
+    CONDITION_VARIABLE           SlotFree;                                     /* Signaled when a batch buffer is returned to the free list, or on shutdown. */
+    CONDITION_VARIABLE           SlotReady;                                    /* Signaled when a batch is added to the ready queue, or when production ends. */
+    MINIBATCH_PRODUCER_INIT      Config;                                       /* The configuration supplied at creation time. */
+    MINIBATCH                   *Batches;                                      /* The array of RingSize batch buffers. */
+    uint32_t                    *FreeList;                                     /* A stack of indices of batch buffers available for filling. */
+    uint32_t                    *ReadyQueue;                                   /* A circular queue of indices of completed batch buffers. */
+    uint32_t                    *Order;                                        /* The sample visitation order for the current epoch. */
+    uint32_t                     FreeCount;                                    /* The number of entries in FreeList. */
+    uint32_t                     ReadyHead;                                    /* The index of the oldest entry in ReadyQueue. */
+    uint32_t                     ReadyCount;                                   /* The number of entries in ReadyQueue. */
+    int                          StopRequested;                                /* Non-zero when the producer is being deleted. */
+    int                          Finished;                                     /* Non-zero when the producer thread has produced its final batch. */
+};
+
+/* @summary Free all resources held by a producer. The producer thread must not be running.
+ * @param p The producer to free.
+ */
+static void
+FreeProducer
+(
+    struct MINIBATCH_PRODUCER *p
+)
+{
+    uint32_t i;
+    if (p->Batches != NULL) {
+        for (i = 0; i < p->Config.RingSize; ++i) {
+            if (p->Batches[i].Memory != NULL && (p->Config.Flags & MINIBATCH_FLAG_LOCK_MEMORY)) {
+                (void) VirtualUnlock(p->Batches[i].Memory, p->Batches[i].MemorySize);
+            }
+            MinibatchDelete(&p->Batches[i]);
+        }
+    }
+    free(p->Order);
+    free(p->ReadyQueue);
+    free(p->FreeList);
+    free(p->Batches);
+    free(p);
+}
+
+/* @summary Implement the entry point of the background producer thread.
+ * @param argp Pointer to the MINIBATCH_PRODUCER.
+ * @return Zero.
+ */
+static DWORD WINAPI
+ProducerThreadMain
+(
+    void *argp
+)
+{
+    struct MINIBATCH_PRODUCER *p = (struct MINIBATCH_PRODUCER*) argp;
+    MINIBATCH_PRODUCER_INIT const *cfg = &p->Config;
+    uint32_t const  nsample = cfg->Source.Dataset->SampleCount;
+    uint64_t            rng = cfg->Seed ? cfg->Seed : 0x9E3779B97F4A7C15ULL;
+    uint32_t          epoch = 0;
+    uint32_t              i;
+
+    for (i = 0; i < nsample; ++i) {
+        p->Order[i] = i;
+    }
+    for (epoch = 0; cfg->EpochCount == 0 || epoch < cfg->EpochCount; ++epoch) {
+        uint32_t batch_index = 0;
+        uint32_t        base = 0;
+        if (cfg->Flags & MINIBATCH_FLAG_SHUFFLE) {
+            MinibatchShuffle(p->Order, nsample, &rng);
+        }
+        for (base = 0; base < nsample; base += cfg->BatchSize, ++batch_index) {
+            MINIBATCH *batch;
+            uint32_t   count = nsample - base;
+            uint32_t    slot;
+            if (count > cfg->BatchSize) {
+                count = cfg->BatchSize;
+            }
+            if (count < cfg->BatchSize && (cfg->Flags & MINIBATCH_FLAG_DROP_LAST)) {
+                break;
+            }
+            /* wait for a free buffer */
+            EnterCriticalSection(&p->Lock);
+            while (p->FreeCount == 0 && !p->StopRequested) {
+                SleepConditionVariableCS(&p->SlotFree, &p->Lock, INFINITE);
+            }
+            if (p->StopRequested) {
+                LeaveCriticalSection(&p->Lock);
+                goto finished;
+            }
+            slot = p->FreeList[--p->FreeCount];
+            LeaveCriticalSection(&p->Lock);
+
+            /* gather outside of the lock so consumers are never blocked on it */
+            batch = &p->Batches[slot];
+            MinibatchGather(batch, &cfg->Source, p->Order + base, count);
+            batch->Epoch      = epoch;
+            batch->BatchIndex = batch_index;
+
+            EnterCriticalSection(&p->Lock);
+            p->ReadyQueue[(p->ReadyHead + p->ReadyCount) % cfg->RingSize] = slot;
+            p->ReadyCount++;
+            WakeConditionVariable(&p->SlotReady);
+            LeaveCriticalSection(&p->Lock);
+        }
+    }
+
+finished:
+    EnterCriticalSection(&p->Lock);
+    p->Finished = 1;
+    WakeAllConditionVariable(&p->SlotReady);
+    LeaveCriticalSection(&p->Lock);
+    return 0;
+}
+
+MNIST_API(int)
+MinibatchProducerCreate
+(
+    struct MINIBATCH_PRODUCER           **o_producer,
+    struct MINIBATCH_PRODUCER_INIT const      *init
+)
+{
+    struct MINIBATCH_PRODUCER *p = NULL;
+    uint32_t               nring = 0;
+    uint32_t             nsample = 0;
+    int                      err = 0;
+    uint32_t                   i;
+
+    assert(o_producer != NULL);
+    *o_producer = NULL;
+
+    if (init == NULL || init->Source.Dataset == NULL || init->BatchSize == 0 || init->Source.Dataset->SampleCount == 0) {
+        errno = EINVAL;
+        return -1;
+    }
+    if ((init->Flags & MINIBATCH_FLAG_DROP_LAST) && init->BatchSize > init->Source.Dataset->SampleCount) {
+        /* every epoch would drop its only batch, so the producer would never publish one */
+        errno = EINVAL;
+        return -1;
+    }
+    if (init->Source.Cache != NULL && init->Source.Cache->FeatureCount != init->Source.Dataset->ImageSize) {
+        errno = EINVAL;
+        return -1;
+    }
+    nring   = init->RingSize < MINIBATCH_MIN_RING_SIZE ? MINIBATCH_MIN_RING_SIZE : init->RingSize;
+    nsample = init->Source.Dataset->SampleCount;
+    if ((p = (struct MINIBATCH_PRODUCER*) calloc(1, sizeof(struct MINIBATCH_PRODUCER))) == NULL) {
+        return -1;
+    }
+    p->Config          = *init;
+    p->Config.RingSize = nring;
+    if ((p->Batches    = (MINIBATCH*) calloc(nring  , sizeof(MINIBATCH))) == NULL ||
+        (p->FreeList   = (uint32_t *) calloc(nring  , sizeof(uint32_t ))) == NULL ||
+        (p->ReadyQueue = (uint32_t *) calloc(nring  , sizeof(uint32_t ))) == NULL ||
+        (p->Order      = (uint32_t *) calloc(nsample, sizeof(uint32_t ))) == NULL) {
+        goto cleanup_and_fail;
+    }
+    for (i = 0; i < nring; ++i) {
+        int res = (init->Flags & MINIBATCH_FLAG_SPARSE) ?
+            MinibatchCreateSparse(&p->Batches[i], init->BatchSize, init->Source.Dataset->ImageSize) :
+            MinibatchCreate      (&p->Batches[i], init->BatchSize, init->Source.Dataset->ImageSize);
+        if (res != 0) {
+            goto cleanup_and_fail;
+        }
+        if (init->Flags & MINIBATCH_FLAG_LOCK_MEMORY) {
+            /* best-effort; the process working set may be too small */
+            (void) VirtualLock(p->Batches[i].Memory, p->Batches[i].MemorySize);
+        }
+        p->FreeList[i] = nring - 1 - i;
+    }
+    p->FreeCount = nring;
+
+    InitializeCriticalSection(&p->Lock);
+    InitializeConditionVariable(&p->SlotFree);
+    InitializeConditionVariable(&p->SlotReady);
+    if ((p->Thread = CreateThread(NULL, 0, ProducerThreadMain, p, 0, NULL)) == NULL) {
+        DeleteCriticalSection(&p->Lock);
+        errno = EAGAIN;
+        goto cleanup_and_fail;
+    }
+    *o_producer = p;
+    return 0;
+
+cleanup_and_fail:
+    err = errno;
+    FreeProducer(p);
+    errno = err;
+    return -1;
+}
+
+MNIST_API(void)
+MinibatchProducerDelete
+(
+    struct MINIBATCH_PRODUCER *producer
+)
+{
+    if (producer != NULL) {
+        EnterCriticalSection(&producer->Lock);
+        producer->StopRequested = 1;
+        WakeAllConditionVariable(&producer->SlotFree);
+        LeaveCriticalSection(&producer->Lock);
+        WaitForSingleObject(producer->Thread, INFINITE);
+        CloseHandle(producer->Thread);
+        DeleteCriticalSection(&producer->Lock);
+        FreeProducer(producer);
+    }
+}
+
+MNIST_API(struct MINIBATCH*)
+MinibatchProducerAcquire
+(
+    struct MINIBATCH_PRODUCER *producer
+)
+{
+    MINIBATCH *batch = NULL;
+    uint32_t    slot;
+
+    EnterCriticalSection(&producer->Lock);
+    while (producer->ReadyCount == 0 && !producer->Finished) {
+        SleepConditionVariableCS(&producer->SlotReady, &producer->Lock, INFINITE);
+    }
+    if (producer->ReadyCount > 0) {
+        slot  = producer->ReadyQueue[producer->ReadyHead];
+        batch =&producer->Batches[slot];
+        producer->ReadyHead = (producer->ReadyHead + 1) % producer->Config.RingSize;
+        producer->ReadyCount--;
+    }
+    LeaveCriticalSection(&producer->Lock);
+    return batch;
+}
+
+MNIST_API(void)
+MinibatchProducerRelease
+(
+    struct MINIBATCH_PRODUCER *producer,
+    struct MINIBATCH             *batch
+)
+{
+    uint32_t slot;
+
+    assert(batch >= producer->Batches && batch < producer->Batches + producer->Config.RingSize);
+    slot = (uint32_t)(batch - producer->Batches);
+    EnterCriticalSection(&producer->Lock);
+    producer->FreeList[producer->FreeCount++] = slot;
+    WakeConditionVariable(&producer->SlotFree);
+    LeaveCriticalSection(&producer->Lock);
+}
+